@@ -0,0 +1,125 @@
+// Measures channel throughput and latency between tasks. Build the
+// chan_bench target and run it with PFLANG_TASK_THREADS set to different
+// worker counts, and with PFLANG_CHAN_SHARED set to compare owned ends
+// against shared ones; the first argument is the number of values each
+// measurement sends (4000000 by default).
+
+#include "../include/runtime/pf_chan.h"
+#include "../include/runtime/pf_task.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    pf_chan* chan;
+    int64_t count;
+} Arguments;
+
+static _Atomic int64_t received;
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static void produce(void* argument) {
+    Arguments* arguments = argument;
+    for (int64_t i = 0; i < arguments->count; i++) {
+        pf_chan_i64_send(arguments->chan, i, 0);
+    }
+}
+
+static void consume(void* argument) {
+    Arguments* arguments = argument;
+    int64_t total = 0;
+    for (int64_t i = 0; i < arguments->count; i++) {
+        total += pf_chan_i64_recv(arguments->chan, 0);
+    }
+    atomic_fetch_add(&received, total);
+}
+
+// Values per second through one channel of capacity with the given
+// numbers of sending and receiving tasks
+static double throughput(int senders, int receivers, int64_t capacity, int64_t count) {
+    pf_chan* chan = pf_chan_i64_new(capacity, 0);
+    atomic_store(&received, 0);
+    double start = now();
+    for (int r = 0; r < receivers; r++) {
+        Arguments arguments = {chan, count / receivers};
+        pf_task_spawn(consume, &arguments, sizeof(arguments));
+    }
+    for (int s = 0; s < senders; s++) {
+        Arguments arguments = {chan, count / senders};
+        pf_task_spawn(produce, &arguments, sizeof(arguments));
+    }
+    pf_task_wait();
+    double seconds = now() - start;
+
+    int64_t per_sender = count / senders;
+    if (atomic_load(&received) != (int64_t)senders * (per_sender * (per_sender - 1) / 2)) {
+        fprintf(stderr, "values were lost or duplicated\n");
+        exit(1);
+    }
+    return (double)(per_sender * senders) / seconds;
+}
+
+typedef struct {
+    pf_chan* ping;
+    pf_chan* pong;
+    int64_t rounds;
+} PingArguments;
+
+static void answer(void* argument) {
+    PingArguments* arguments = argument;
+    for (int64_t i = 0; i < arguments->rounds; i++) {
+        pf_chan_i64_send(arguments->pong, pf_chan_i64_recv(arguments->ping, 0), 0);
+    }
+}
+
+static void ask(void* argument) {
+    PingArguments* arguments = argument;
+    for (int64_t i = 0; i < arguments->rounds; i++) {
+        pf_chan_i64_send(arguments->ping, i, 0);
+        if (pf_chan_i64_recv(arguments->pong, 0) != i) {
+            fprintf(stderr, "ping %lld came back wrong\n", (long long)i);
+            exit(1);
+        }
+    }
+}
+
+// Nanoseconds for a value to go to another task and back
+static double round_trip(int64_t rounds) {
+    PingArguments arguments = {pf_chan_i64_new(1, 0), pf_chan_i64_new(1, 0), rounds};
+    double start = now();
+    pf_task_spawn(answer, &arguments, sizeof(arguments));
+    pf_task_spawn(ask, &arguments, sizeof(arguments));
+    pf_task_wait();
+    return (now() - start) * 1e9 / (double)rounds;
+}
+
+int main(int argc, char** argv) {
+    int64_t count = argc > 1 ? strtoll(argv[1], NULL, 10) : 4000000;
+    if (count < 64) count = 64;
+
+    double spsc = throughput(1, 1, 1024, count);
+    double spsc_small = throughput(1, 1, 16, count);
+    double mpmc = throughput(8, 8, 1024, count);
+    double latency = round_trip(count / 20);
+
+    pf_task_statistics tasks;
+    pf_task_get_statistics(&tasks);
+    pf_chan_statistics chans;
+    pf_chan_get_statistics(&chans);
+    printf("%d workers, %s ends\n", tasks.workers, getenv("PFLANG_CHAN_SHARED") != NULL ? "shared" : "owned");
+    printf("  1 sender, 1 receiver, capacity 1024: %6.1f M values/s\n", spsc / 1e6);
+    printf("  1 sender, 1 receiver, capacity 16:   %6.1f M values/s\n", spsc_small / 1e6);
+    printf("  8 senders, 8 receivers, capacity 1024: %4.1f M values/s\n", mpmc / 1e6);
+    printf("  round trip between two tasks: %.0f ns\n", latency);
+    printf("  %llu waits, %llu ends owned, %llu shared after being owned, %llu task parks\n",
+           (unsigned long long)chans.waits, (unsigned long long)chans.owned, (unsigned long long)chans.shared,
+           (unsigned long long)tasks.parks);
+    return 0;
+}
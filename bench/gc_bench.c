@@ -0,0 +1,67 @@
+// Measures major collection pauses over a heap of lists of strings. Build
+// the gc_bench target and run it with PFLANG_GC_THREADS set to different
+// thread counts; the first argument is the heap size in MiB (256 by
+// default). Each line is the best of several collections.
+
+#include "../include/runtime/pf_array.h"
+#include "../include/runtime/pf_gc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define RUNS 5
+#define LIST_LENGTH 4096
+
+static pf_string numbered(int64_t i) {
+    char text[64];
+    int length = snprintf(text, sizeof(text), "heap string number %lld", (long long)i);
+    return pf_string_from(text, (size_t)length);
+}
+
+int main(int argc, char** argv) {
+    long megabytes = argc > 1 ? strtol(argv[1], NULL, 10) : 256;
+    // About 64 bytes per string: its cell and its slot in the list
+    int64_t lists = (int64_t)megabytes * (1 << 20) / 64 / LIST_LENGTH;
+    if (lists < 1) lists = 1;
+
+    // The lists are reached only through this array of addresses, which
+    // the collector sees as plain bytes, so it is registered as roots
+    pf_array_u64 roots = pf_array_u64_new(lists, 0);
+    pf_gc_add_roots(roots.data, (size_t)lists * sizeof(uint64_t));
+    for (int64_t l = 0; l < lists; l++) {
+        pf_list_str* list = pf_list_str_new(LIST_LENGTH, 0);
+        for (int64_t i = 0; i < LIST_LENGTH; i++) {
+            pf_list_str_append(list, numbered(l * LIST_LENGTH + i));
+        }
+        roots.data[l] = (uint64_t)(uintptr_t)list;
+    }
+
+    double best = 1e30;
+    for (int run = 0; run < RUNS; run++) {
+        pf_gc_statistics before;
+        pf_gc_statistics after;
+        pf_gc_get_statistics(&before);
+        pf_gc_collect(true);
+        pf_gc_get_statistics(&after);
+        double pause = after.major_pause_ms - before.major_pause_ms;
+        if (pause < best) best = pause;
+    }
+
+    int64_t checked = 0;
+    for (int64_t l = 0; l < lists; l += lists / 16 + 1) {
+        pf_list_str* list = (pf_list_str*)(uintptr_t)roots.data[l];
+        for (int64_t i = 0; i < LIST_LENGTH; i += 511) {
+            if (!pf_string_equal(list->data[i], numbered(l * LIST_LENGTH + i))) {
+                fprintf(stderr, "string %lld of list %lld was lost\n", (long long)i, (long long)l);
+                return 1;
+            }
+            checked++;
+        }
+    }
+
+    pf_gc_statistics statistics;
+    pf_gc_get_statistics(&statistics);
+    printf("%.1f MB old generation, %d marking threads: %.2f ms major pause (%lld strings checked)\n",
+           (double)statistics.heap_bytes / 1e6, statistics.mark_threads, best, (long long)checked);
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Measures I/O-bound tasks: thousands of loopback connections, each
+// exchanging small messages with an echo task, then many tasks writing and
+// reading files. Build the io_bench target and run it with
+// PFLANG_TASK_THREADS set to different worker counts, and with
+// PFLANG_IO_URING=0 to run file operations in place; the first argument is
+// the number of connections (10000 by default, fewer if the descriptor
+// limit is lower) and the second the round trips on each (20 by default).
+
+#include "../include/runtime/pf_io.h"
+#include "../include/runtime/pf_task.h"
+
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MESSAGE 64
+#define FILES 1000
+#define FILE_BLOCK 4096
+#define FILE_BLOCKS 64
+
+typedef struct {
+    int listening;
+    int connections;
+} Server;
+
+typedef struct {
+    int port;
+    int round_trips;
+} Client;
+
+static _Atomic int64_t round_trips_done;
+static _Atomic int failures;
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static void echo(void* argument) {
+    int fd = *(int*)argument;
+    char buffer[MESSAGE];
+    for (int64_t length = pf_io_read(fd, buffer, sizeof(buffer)); length > 0;
+         length = pf_io_read(fd, buffer, sizeof(buffer))) {
+        if (pf_io_write(fd, buffer, (size_t)length) != length) break;
+    }
+    pf_io_close(fd);
+}
+
+static void serve(void* argument) {
+    Server* server = argument;
+    for (int c = 0; c < server->connections; c++) {
+        int connection = pf_io_accept(server->listening);
+        if (connection < 0) {
+            atomic_fetch_add(&failures, server->connections - c);
+            return;
+        }
+        pf_task_spawn(echo, &connection, sizeof(connection));
+    }
+}
+
+static void call(void* argument) {
+    Client* client = argument;
+    int fd = pf_io_connect_tcp(pf_string_from_cstr("127.0.0.1"), client->port);
+    if (fd < 0) {
+        atomic_fetch_add(&failures, 1);
+        return;
+    }
+    char message[MESSAGE];
+    char reply[MESSAGE];
+    memset(message, 'x', sizeof(message));
+    for (int r = 0; r < client->round_trips; r++) {
+        if (pf_io_write(fd, message, sizeof(message)) != MESSAGE) break;
+        int64_t received = 0;
+        while (received < MESSAGE) {
+            int64_t length = pf_io_read(fd, reply + received, sizeof(reply) - (size_t)received);
+            if (length <= 0) break;
+            received += length;
+        }
+        if (received < MESSAGE) break;
+        atomic_fetch_add_explicit(&round_trips_done, 1, memory_order_relaxed);
+    }
+    pf_io_close(fd);
+}
+
+// Write a file in blocks, then read it back
+static void write_and_read_file(void* argument) {
+    int index = *(int*)argument;
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/pflang-io-bench-%d-%d", (int)getpid(), index);
+    char block[FILE_BLOCK];
+    memset(block, 'a' + index % 26, sizeof(block));
+    int fd = pf_io_open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int64_t total = 0;
+    if (fd >= 0) {
+        for (int b = 0; b < FILE_BLOCKS; b++) {
+            pf_io_write(fd, block, sizeof(block));
+        }
+        pf_io_close(fd);
+        fd = pf_io_open(path, O_RDONLY, 0);
+        for (int64_t length = pf_io_read(fd, block, sizeof(block)); length > 0;
+             length = pf_io_read(fd, block, sizeof(block))) {
+            total += length;
+        }
+        pf_io_close(fd);
+        unlink(path);
+    }
+    if (total != (int64_t)FILE_BLOCK * FILE_BLOCKS) atomic_fetch_add(&failures, 1);
+}
+
+int main(int argc, char** argv) {
+    int connections = argc > 1 ? atoi(argv[1]) : 10000;
+    int round_trips = argc > 2 ? atoi(argv[2]) : 20;
+    // Each connection takes a descriptor at both ends
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        int most = ((int)limit.rlim_cur - 64) / 2;
+        if (connections > most) connections = most;
+    }
+    if (connections < 1) connections = 1;
+    if (round_trips < 1) round_trips = 1;
+
+    int listening = pf_io_listen_tcp(0);
+    if (listening < 0) {
+        perror("listen");
+        return 1;
+    }
+    printf("%d workers, %d connections, %d round trips of %d bytes each\n", pf_task_worker_count(), connections,
+           round_trips, MESSAGE);
+
+    pf_io_statistics before;
+    pf_io_get_statistics(&before);
+    Server server = {listening, connections};
+    Client client = {pf_io_local_port(listening), round_trips};
+    double start = now();
+    pf_task_spawn(serve, &server, sizeof(server));
+    for (int c = 0; c < connections; c++) {
+        pf_task_spawn(call, &client, sizeof(client));
+    }
+    pf_task_wait();
+    double seconds = now() - start;
+    pf_io_close(listening);
+    pf_io_statistics after;
+    pf_io_get_statistics(&after);
+    int64_t done = atomic_load(&round_trips_done);
+    printf("  sockets: %lld round trips in %.2f s, %.0f/s, %llu waits\n", (long long)done, seconds,
+           (double)done / seconds, (unsigned long long)(after.waits - before.waits));
+
+    before = after;
+    start = now();
+    for (int f = 0; f < FILES; f++) {
+        pf_task_spawn(write_and_read_file, &f, sizeof(f));
+    }
+    pf_task_wait();
+    seconds = now() - start;
+    pf_io_get_statistics(&after);
+    printf("  files: %d tasks moved %.0f MiB in %.2f s, %.0f MiB/s, %llu through io_uring, %llu in place\n", FILES,
+           2.0 * FILES * FILE_BLOCK * FILE_BLOCKS / 1048576.0, seconds,
+           2.0 * FILES * FILE_BLOCK * FILE_BLOCKS / 1048576.0 / seconds,
+           (unsigned long long)(after.submitted - before.submitted),
+           (unsigned long long)(after.in_place - before.in_place));
+
+    int failed = atomic_load(&failures);
+    if (failed > 0 || done != (int64_t)connections * round_trips) {
+        fprintf(stderr, "%d operations failed, %lld round trips short\n", failed,
+                (long long)connections * round_trips - (long long)done);
+        return 1;
+    }
+    return 0;
+}
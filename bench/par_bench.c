@@ -0,0 +1,109 @@
+// Measures parallel loops against the same loop on one thread. Build the
+// par_bench target and run it with PFLANG_TASK_THREADS set to different
+// worker counts, and with PFLANG_PAR_CHUNK_US to try other chunk lengths;
+// the first argument is the number of iterations of each loop (20000000
+// by default).
+
+#include "../include/runtime/pf_par.h"
+#include "../include/runtime/pf_task.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    double* values;
+    int rounds;                 // Work per iteration
+} Arguments;
+
+static double now(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+static double work(int64_t i, int rounds) {
+    double x = (double)(i & 1023);
+    for (int r = 0; r < rounds; r++) {
+        x = sqrt(x * x + 1.0);
+    }
+    return x;
+}
+
+static void fill(void* argument, int64_t first, int64_t last) {
+    Arguments* arguments = argument;
+    for (int64_t i = first; i < last; i++) {
+        arguments->values[i] = work(i, arguments->rounds);
+    }
+}
+
+static void sum(void* argument, int64_t first, int64_t last, void* partial) {
+    Arguments* arguments = argument;
+    double total = 0;
+    for (int64_t i = first; i < last; i++) {
+        total += arguments->values[i];
+    }
+    *(double*)partial = total;
+}
+
+static void add(void* argument, void* into, const void* from) {
+    (void)argument;
+    *(double*)into += *(const double*)from;
+}
+
+// Iterations per second of fill over count values, on the pool or inline
+static double fill_rate(Arguments* arguments, int64_t count, bool parallel) {
+    double start = now();
+    if (parallel) {
+        pf_parallel_for(count, fill, arguments);
+    } else {
+        fill(arguments, 0, count);
+    }
+    return (double)count / (now() - start);
+}
+
+int main(int argc, char** argv) {
+    int64_t count = argc > 1 ? strtoll(argv[1], NULL, 10) : 20000000;
+    if (count < 1024) count = 1024;
+    Arguments arguments = {malloc((size_t)count * sizeof(double)), 0};
+    if (arguments.values == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    // Touch every page first so that the first loop measured does not pay for it
+    fill(&arguments, 0, count);
+    printf("%d workers\n", pf_task_worker_count());
+    int rounds[] = {0, 8, 64};
+    for (int r = 0; r < 3; r++) {
+        arguments.rounds = rounds[r];
+        int64_t iterations = count / (rounds[r] + 1);
+        double inline_rate = fill_rate(&arguments, iterations, false);
+        double parallel_rate = fill_rate(&arguments, iterations, true);
+        pf_par_statistics statistics;
+        pf_par_get_statistics(&statistics);
+        printf("  %2d sqrt per iteration: %7.1f M/s inline, %7.1f M/s parallel (%.1fx), grain %lld\n", rounds[r],
+               inline_rate / 1e6, parallel_rate / 1e6, parallel_rate / inline_rate, (long long)statistics.last_grain);
+    }
+
+    double expected = 0;
+    sum(&arguments, 0, count, &expected);
+    double total = 0;
+    double start = now();
+    pf_parallel_reduce(count, sum, add, &arguments, &total, sizeof(total));
+    double seconds = now() - start;
+    if (fabs(total - expected) > 1e-6 * fabs(expected)) {
+        fprintf(stderr, "the parallel sum came out wrong\n");
+        return 1;
+    }
+    printf("  sum of %lld values: %.1f M/s\n", (long long)count, (double)count / seconds / 1e6);
+
+    pf_par_statistics statistics;
+    pf_par_get_statistics(&statistics);
+    printf("  %llu loops, %llu on the caller alone, %llu chunks, %llu helper tasks\n",
+           (unsigned long long)statistics.loops, (unsigned long long)statistics.sequential,
+           (unsigned long long)statistics.chunks, (unsigned long long)statistics.helpers);
+    free(arguments.values);
+    return 0;
+}
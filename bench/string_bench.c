@@ -0,0 +1,95 @@
+// Compares the string library's kernels with the naive byte loops they
+// replace. Build the string_bench target and run it; each line is the best
+// of several runs over a 4 MiB text.
+
+#include "../include/runtime/pf_string.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define TEXT_SIZE (4 << 20)
+#define RUNS 5
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int64_t naive_count(const char* text, size_t length, const char* needle, size_t needle_length) {
+    int64_t count = 0;
+    for (size_t i = 0; i + needle_length <= length;) {
+        size_t j = 0;
+        while (j < needle_length && text[i + j] == needle[j]) j++;
+        if (j == needle_length) {
+            count++;
+            i += needle_length;
+        } else {
+            i++;
+        }
+    }
+    return count;
+}
+
+static void naive_upper(char* out, const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        out[i] = text[i] >= 'a' && text[i] <= 'z' ? (char)(text[i] - 32) : text[i];
+    }
+}
+
+static bool naive_ascii(const char* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if ((unsigned char)text[i] >= 0x80) return false;
+    }
+    return true;
+}
+
+// Prints throughput in MB/s for the best of RUNS calls
+#define MEASURE(label, call)                                              \
+    do {                                                                  \
+        double best = 1e30;                                               \
+        for (int run = 0; run < RUNS; run++) {                            \
+            double start = now_seconds();                                 \
+            call;                                                         \
+            double elapsed = now_seconds() - start;                       \
+            if (elapsed < best) best = elapsed;                           \
+        }                                                                 \
+        printf("  %-22s %9.0f MB/s\n", label, TEXT_SIZE / best / 1e6);    \
+    } while (0)
+
+int main(void) {
+    // Lowercase words with the occasional needle, like a log file
+    char* text = malloc(TEXT_SIZE);
+    char* out = malloc(TEXT_SIZE);
+    srand(1);
+    for (size_t i = 0; i < TEXT_SIZE; i++) {
+        int r = rand() % 32;
+        text[i] = r < 26 ? (char)('a' + r) : ' ';
+    }
+    for (size_t i = 1000; i + 16 < TEXT_SIZE; i += 65536) {
+        memcpy(text + i, "request_id=", 11);
+    }
+
+    pf_string haystack = pf_string_from(text, TEXT_SIZE);
+    pf_string needle = pf_string_from_cstr("request_id=");
+    volatile int64_t sink = 0;
+
+    printf("naive loops\n");
+    MEASURE("count", sink += naive_count(text, TEXT_SIZE, "request_id=", 11));
+    MEASURE("to_upper", naive_upper(out, text, TEXT_SIZE));
+    MEASURE("is_utf8 (ASCII)", sink += naive_ascii(text, TEXT_SIZE));
+
+    const char* kernel_sets[] = {"scalar", "sse2", "avx2"};
+    for (int k = 0; k < 3; k++) {
+        if (!pf_string_use_kernels(kernel_sets[k])) continue;
+        printf("%s kernels\n", pf_string_kernels());
+        MEASURE("count", sink += pf_string_count(haystack, needle));
+        MEASURE("to_upper", sink += pf_string_to_upper(haystack).length);
+        MEASURE("is_utf8 (ASCII)", sink += pf_string_is_utf8(haystack));
+    }
+
+    free(text);
+    free(out);
+    return sink == 0;
+}
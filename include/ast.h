@@ -19,12 +19,18 @@ typedef enum {
     NODE_LITERAL,
     NODE_TUPLE,
     NODE_FUNCTION_CALL,
+    NODE_ASSIGNMENT,
+    NODE_DESTRUCTURE,
+    NODE_INDEX,
+    NODE_GO,
+    NODE_SELECT,
 } NodeType;
 
 // AST node structure
 typedef struct AstNode {
     NodeType type;
     DataType data_type;
+    int line;  // Source line the node starts on (0 if unknown)
     union {
         // Function declaration
         struct {
@@ -95,6 +101,57 @@ typedef struct AstNode {
             struct AstNode* else_branch;
         } if_stmt;
 
+        // While loop
+        struct {
+            struct AstNode* condition;
+            struct AstNode* body;
+        } while_stmt;
+
+        // Counted loop: [par] for name = range(start, end, step)
+        struct {
+            char* name;
+            DataType type;              // Declared type of name, i64 when omitted
+            struct AstNode* start;      // Literal 0 when range() has one argument
+            struct AstNode* end;
+            struct AstNode* step;       // NULL for a step of 1
+            struct AstNode* body;
+            bool parallel;              // par for: iterations run at once on the task pool
+        } for_stmt;
+
+        // Assignment to an existing variable, or to one of its elements
+        struct {
+            char* name;
+            struct AstNode* index;      // NULL when assigning the whole variable
+            struct AstNode* value;
+        } assignment;
+
+        // go statement: a call run on a new task
+        struct {
+            struct AstNode* call;
+        } go_stmt;
+
+        // select statement: runs the body of a case whose channel
+        // operation can go ahead, waiting for one unless there is an else
+        struct {
+            struct AstNode** cases;     // send(c, v), recv(c), or a declaration from recv(c)
+            struct AstNode** bodies;
+            int case_count;
+            struct AstNode* else_branch;
+        } select_stmt;
+
+        // Element of an array or list
+        struct {
+            struct AstNode* target;
+            struct AstNode* index;
+        } index;
+
+        // Declaration of several variables from a multi-value call
+        struct {
+            struct AstNode** targets;   // NODE_VARIABLE without init values
+            int target_count;
+            struct AstNode* value;
+        } destructure;
+
         // Block of statements
         struct {
             struct AstNode** statements;
@@ -115,6 +172,18 @@ AstNode* create_parameter_node(char* name, DataType type);
 AstNode* create_unary_op_node(TokenType operator, AstNode* operand);
 void free_ast(AstNode* node);
 
+const char* data_type_to_string(DataType type);
+
+// Integer constants: expressions built only of integer literals, unary
+// minus and + - * / %. A literal on its own is the narrowest of i32, i64
+// and u64 that holds it, a constant expression the widest of its literals,
+// and a constant stored in a slot is computed at the slot's type unless its
+// literals need a wider one.
+bool is_integer_constant(AstNode* node);
+DataType integer_literal_type(const char* text);
+DataType integer_constant_type(AstNode* node);
+DataType integer_constant_slot_type(AstNode* node, DataType slot);
+
 // Print AST node and its children with indentation
 void print_ast(AstNode* node, int indent_level);
 
@@ -0,0 +1,52 @@
+#ifndef PFLANG_BUILTINS_H
+#define PFLANG_BUILTINS_H
+
+#include "common.h"
+
+// Functions every program can call without defining them. print and error
+// take variable arguments and are handled by each engine; the builtins
+// here have fixed signatures and map one to one onto runtime functions.
+
+#define BUILTIN_MAX_PARAMS 3
+
+typedef struct {
+    const char* name;
+    const char* runtime_name;       // Runtime function generated code calls
+    DataType return_type;
+    int param_count;
+    DataType param_types[BUILTIN_MAX_PARAMS];
+} Builtin;
+
+// The builtin called name, or NULL
+const Builtin* find_builtin(const char* name);
+
+// Builtins over a whole array or list of numbers. The element type of the
+// first argument picks the runtime function (pf_sum_u8, pf_sum_f64, ...)
+// and a list is passed as a view of its elements.
+typedef enum {
+    ARRAY_ARG_NONE,
+    ARRAY_ARG_ARRAY,            // An array or list of the same element type
+    ARRAY_ARG_ELEMENT,          // A value of the element type
+} ArrayArgument;
+
+typedef enum {
+    ARRAY_RESULT_TOTAL,         // u64 or i64 for integers, the element type for floats
+    ARRAY_RESULT_ELEMENT,
+    ARRAY_RESULT_MASK,          // array[bool]
+    ARRAY_RESULT_NULL,
+} ArrayResult;
+
+typedef struct {
+    const char* name;
+    ArrayArgument second;
+    ArrayResult result;
+    bool takes_line;            // The runtime function reports errors at the call's line
+} ArrayBuiltin;
+
+// The array builtin called name, or NULL
+const ArrayBuiltin* find_array_builtin(const char* name);
+
+// What builtin returns for an array of element
+DataType array_builtin_type(const ArrayBuiltin* builtin, DataType element);
+
+#endif // PFLANG_BUILTINS_H
@@ -0,0 +1,76 @@
+#ifndef PFLANG_CODEGEN_C_H
+#define PFLANG_CODEGEN_C_H
+
+#include "common.h"
+#include "ast.h"
+#include "ir.h"
+#include "runtime/pf_arith.h"
+
+// Ahead-of-time backend: translates a parsed program (the NODE_BLOCK of
+// functions returned by parse_program) into portable C11 that links against
+// the pflang runtime library.
+
+// Local variable or parameter visible in the function being emitted
+typedef struct {
+    const char* name;
+    DataType type;
+} CodegenLocal;
+
+typedef struct {
+    FILE* out;
+    FILE* helpers;              // Definitions that must precede the function bodies
+    const char* source_file;
+    pf_overflow_mode overflow_mode;
+    AstNode* program;
+    AstNode* function;
+    CodegenLocal* locals;
+    int local_count;
+    int local_capacity;
+    int temp_count;             // Numbers the temporaries holding call results
+    int format_count;           // Numbers the compiled format helpers
+    const char** literals;      // String literal lexemes, indexed like pf_literals
+    int literal_count;
+    int literal_capacity;
+    IrBoundsFact* bounds;       // Accesses the IR showed need no check
+    bool* bounds_active;        // Per fact: set inside the unchecked copy of its loop
+    int bounds_count;
+    IrVectorLoop* vector_loops; // For loops the IR found vectorizable, or why not
+    int vector_loop_count;
+    bool* always_inline;        // Per function: inlined by the IR at every call site
+    FILE* call_sites;           // Initializers of pf_call_sites, when counting calls
+    int call_site_count;
+    FILE* perf_symbols;         // Initializers of pf_perf_symbols, when building for perf
+    int perf_symbol_count;
+    bool* tail_calls;           // While planning: [caller * functions + callee] for tail calls of the same signature
+    int* tail_groups;           // Per function: first member of its merged tail-call group, or -1
+    bool* tail_loops;           // Per function: jumps back to its own top on a tail call of itself
+    FILE* tail_report;          // Where to list tail calls and what became of them, or NULL
+    IrAllocation* allocations;  // Where the IR placed each array() and list() call
+    int allocation_count;
+    bool region;                // The function being emitted allocates in pf_region
+    bool spawns;                // The program runs code on the task pool, so loops stop for collections
+    int spawn_count;            // Numbers the helpers of go statements and parallel loops
+    bool parallel;              // Emitting the body of a par for, whose iterations run at once
+    DataType constant_type;     // Type of the integer constant being stored in a slot, or TYPE_NULL
+    bool had_error;
+} CodegenC;
+
+typedef struct {
+    pf_overflow_mode overflow_mode;
+    const IrCallCount* call_profile;    // Call counts steering the inliner, or NULL
+    int call_profile_count;
+    bool count_calls;                   // Count each call site and write a profile at exit
+    FILE* tail_call_report;             // Where to list tail calls, or NULL
+    bool perf_map;                      // Register the functions with perf when the program starts
+} CodegenCOptions;
+
+// Write C source for the program, with integer arithmetic following
+// overflow_mode; returns false if some construct could not be translated
+bool codegen_c_emit(AstNode* program, const char* source_file, pf_overflow_mode overflow_mode, FILE* out);
+bool codegen_c_emit_with_options(AstNode* program, const char* source_file, const CodegenCOptions* options,
+                                 FILE* out);
+
+// Compile generated C into an executable with the system compiler ($CC or cc)
+bool codegen_c_compile(const char* c_path, const char* output_path);
+
+#endif // PFLANG_CODEGEN_C_H
@@ -33,6 +33,33 @@ typedef enum {
     TYPE_ARRAY,
     TYPE_LIST,
     TYPE_MAP,
+    TYPE_CHAN,
 } DataType;
 
+// An element-typed compound such as array[u8] is a single DataType: the
+// compound kind in the low bits and the element type, plus one, above them.
+// Equal compound types compare equal, and no compound is mistaken for a
+// primitive.
+#define TYPE_ELEMENT_SHIFT 8
+
+// The same as a constant expression, for static tables
+#define COMPOUND_TYPE(kind, element) ((DataType)((kind) | (((element) + 1) << TYPE_ELEMENT_SHIFT)))
+
+static inline DataType compound_type(DataType kind, DataType element) {
+    return COMPOUND_TYPE(kind, element);
+}
+
+static inline DataType type_kind(DataType type) {
+    return (DataType)(type & ((1 << TYPE_ELEMENT_SHIFT) - 1));
+}
+
+// The element type of a compound; only meaningful for compounds
+static inline DataType type_element(DataType type) {
+    return (DataType)((type >> TYPE_ELEMENT_SHIFT) - 1);
+}
+
+static inline bool is_sequence_type(DataType type) {
+    return type_kind(type) == TYPE_ARRAY || type_kind(type) == TYPE_LIST;
+}
+
 #endif // PFLANG_COMMON_H
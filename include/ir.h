@@ -0,0 +1,317 @@
+#ifndef PFLANG_IR_H
+#define PFLANG_IR_H
+
+#include <stdint.h>
+#include "common.h"
+#include "ast.h"
+#include "runtime/pf_arith.h"
+
+// SSA intermediate representation.
+//
+// A function is a list of basic blocks; each block holds instructions and
+// ends with exactly one terminator (jump, branch or return). Every
+// instruction that produces a value defines a new SSA value, and values
+// flowing in from several predecessors are merged with phi instructions whose
+// operands line up with the block's predecessor list.
+
+typedef enum {
+    // Values
+    IR_CONST,      // Numeric constant in imm
+    IR_STRING,     // String literal, text in name
+    IR_UNDEF,      // Read of a variable with no definition on some path
+    IR_PARAM,      // Function parameter number index
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_MOD,
+    IR_NEG,
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_LE,
+    IR_GT,
+    IR_GE,
+    IR_CONVERT,    // Change of DataType
+    IR_COPY,
+    IR_PHI,
+    IR_FORMAT,     // "format" % operands...; operand 0 is the format string
+    IR_CALL,       // Call of name with operands as arguments
+    IR_SPAWN,      // The same call on a new task; produces nothing
+    IR_EXTRACT,    // Value number index of the multi-value call in operand 0
+    IR_LOAD,       // Element operand 1 of the array or list in operand 0
+    IR_STORE,      // Store operand 2 into element operand 1 of operand 0
+    IR_LENGTH,     // Element count of the array or list in operand 0
+
+    // Terminators
+    IR_JUMP,       // targets[0]
+    IR_BRANCH,     // operand 0 ? targets[0] : targets[1]
+    IR_RETURN,     // Operands are the returned values
+} IrOpcode;
+
+// How a load or store checks its index, decided by ir_eliminate_bounds_checks
+typedef enum {
+    IR_BOUNDS_CHECKED,      // Compared with the length on every access
+    IR_BOUNDS_PROVEN,       // Proven to lie in [0, length)
+    IR_BOUNDS_HOISTED,      // Checked once for the whole range of its for loop
+} IrBounds;
+
+typedef struct IrBlock IrBlock;
+typedef struct IrFunction IrFunction;
+
+typedef struct IrInstr {
+    IrOpcode op;
+    DataType type;
+    int id;                     // SSA value number, printed as v<id>
+    IrBlock* block;
+    struct IrInstr** operands;
+    int operand_count;
+    int operand_capacity;
+    IrBlock* targets[2];
+    union {
+        int64_t i;
+        double f;
+    } imm;
+    char* name;
+    int index;
+    int line;
+    IrBounds bounds;            // Loads and stores only
+    const AstNode* source;      // Indexing node a load or store, or array() or list() call, was lowered from
+} IrInstr;
+
+struct IrBlock {
+    int id;
+    IrFunction* function;
+    IrInstr** instrs;
+    int instr_count;
+    int instr_capacity;
+    IrBlock** preds;
+    int pred_count;
+    int pred_capacity;
+
+    // Filled in by ir_compute_dominators
+    IrBlock* idom;
+    int rpo_index;
+
+    // Header of a for loop: the loop and its i64 counter
+    const AstNode* loop;
+    IrInstr* induction;
+};
+
+struct IrFunction {
+    char* name;
+    int line;
+    DataType* param_types;
+    int param_count;
+    DataType* return_types;
+    int return_type_count;
+    IrBlock** blocks;           // blocks[0] is the entry
+    int block_count;
+    int block_capacity;
+    int next_value_id;
+    int next_block_id;
+    pf_overflow_mode overflow_mode;     // How folding treats integer overflow
+    const AstNode* source;              // NODE_FUNCTION it was lowered from
+};
+
+// How often a profiled run made one call: caller called callee from line
+typedef struct {
+    char* caller;
+    int line;
+    char* callee;
+    uint64_t count;
+} IrCallCount;
+
+// What the inliner decided for one call of a program function
+typedef struct {
+    const char* caller;         // Names of the module's functions
+    const char* callee;
+    int line;
+    bool inlined;
+    int size;                   // Instructions of the callee
+    int budget;                 // Largest callee allowed at this call
+    char reason[96];            // Why not, when not inlined
+} IrInlineSite;
+
+typedef struct {
+    IrFunction** functions;
+    int function_count;
+    const IrCallCount* call_profile;    // Not owned; see ir_set_call_profile
+    int call_profile_count;
+    IrInlineSite* inline_sites;         // Filled in by ir_inline_module
+    int inline_site_count;
+} IrModule;
+
+// Lowering from the program NODE_BLOCK returned by parse_program; returns
+// NULL and reports to stderr if some construct cannot be lowered
+IrModule* ir_lower_program(AstNode* program);
+
+// The same without reporting, for callers that only want the IR if it exists
+IrModule* ir_lower_program_quietly(AstNode* program);
+void ir_free_module(IrModule* module);
+
+// Integer overflow semantics the passes must preserve; wrapping by default
+void ir_set_overflow_mode(IrModule* module, pf_overflow_mode mode);
+
+// Textual form, used by --dump-ir and the tests
+void ir_dump_module(IrModule* module, FILE* out);
+void ir_dump_function(IrFunction* function, FILE* out);
+const char* ir_opcode_name(IrOpcode op);
+
+// Building blocks shared by the lowering and the passes
+IrBlock* ir_new_block(IrFunction* function);
+IrInstr* ir_new_instr(IrFunction* function, IrOpcode op, DataType type);
+void ir_append_instr(IrBlock* block, IrInstr* instr);
+void ir_insert_instr(IrBlock* block, int position, IrInstr* instr);
+void ir_add_operand(IrInstr* instr, IrInstr* operand);
+void ir_add_pred(IrBlock* block, IrBlock* pred);
+void ir_remove_pred(IrBlock* block, IrBlock* pred);
+IrInstr* ir_terminator(IrBlock* block);
+int ir_successor_count(IrBlock* block);
+IrBlock* ir_successor(IrBlock* block, int index);
+bool ir_is_terminator(IrOpcode op);
+bool ir_has_side_effects(IrInstr* instr);
+bool ir_defines_value(IrInstr* instr);
+void ir_remove_instr_at(IrBlock* block, int index);
+void ir_replace_uses(IrFunction* function, IrInstr* from, IrInstr* to);
+void ir_remove_unreachable_blocks(IrFunction* function);
+
+// Fold each block entered only by a jump from a block with no other
+// successor into that block; loop headers stay where they are
+void ir_merge_blocks(IrFunction* function);
+void ir_free_instr(IrInstr* instr);
+
+// Analyses
+void ir_compute_dominators(IrFunction* function);
+bool ir_dominates(IrBlock* a, IrBlock* b);
+
+// Blocks of the natural loop headed by header, indexed by block id; the
+// caller frees the array. Needs dominators.
+bool* ir_loop_blocks(IrFunction* function, IrBlock* header);
+
+// Blocks inside any loop, indexed by block id; the caller frees the array.
+// Needs dominators.
+bool* ir_blocks_in_loops(IrFunction* function);
+
+// Optimization passes; each returns true if it changed the function
+bool ir_copy_propagation(IrFunction* function);
+bool ir_fold_constants(IrFunction* function);
+bool ir_global_value_numbering(IrFunction* function);
+bool ir_loop_invariant_code_motion(IrFunction* function);
+bool ir_dead_code_elimination(IrFunction* function);
+
+// Turn calls of a function by itself in tail position into a loop back to
+// its start, so such a function is no longer recursive
+bool ir_eliminate_tail_calls(IrFunction* function);
+
+// Eliminate tail calls, run the passes above to a fixed point, inline
+// small functions and run them again, then eliminate bounds checks
+void ir_optimize_module(IrModule* module);
+
+// Function inlining (ir_inline.c). Calls of a program's own functions are
+// replaced by a copy of the callee's body when the callee is not recursive
+// and is small enough: a few instructions anywhere, more inside a loop, and
+// more again at a call a profile shows to be hot. A call the profile never
+// saw run is left alone. Callees are inlined into before their callers, so
+// a chain of small helpers collapses from the bottom up. Returns true if
+// some call was inlined; the decisions are kept in module->inline_sites.
+bool ir_inline_module(IrModule* module);
+
+// Steer ir_inline_module with call counts; the module does not copy them,
+// so they must outlive it
+void ir_set_call_profile(IrModule* module, const IrCallCount* counts, int count);
+
+// Counts written by a program built with call counting, one "caller line
+// callee count" line per call site; NULL if path cannot be read
+IrCallCount* ir_read_call_profile(const char* path, int* count);
+void ir_free_call_profile(IrCallCount* counts, int count);
+
+// One line per call site of function: inlined, or why not
+void ir_dump_inline_report(IrModule* module, IrFunction* function, FILE* out);
+
+// True if callee has call sites and every one of them was inlined
+bool ir_inlined_everywhere(IrModule* module, const char* callee);
+
+// Bounds-check elimination (ir_bounds.c). A load or store is proven in
+// bounds when dominating branches and induction variables pin its index
+// to [0, length): a counted loop tested against the length, a check
+// repeated on the same index, or an index derived from the length. Accesses
+// of a for loop indexed by its counter that cannot be proven are hoisted:
+// the C backend checks the loop's whole range once and runs an unchecked
+// copy of the loop when it fits. Returns true if some access changed.
+bool ir_eliminate_bounds_checks(IrFunction* function);
+
+// One line per function: how many accesses were proven, hoisted or left
+void ir_dump_bounds_report(IrFunction* function, FILE* out);
+
+// What the C backend needs to know about one access that is not checked
+// on every execution
+typedef struct {
+    const AstNode* source;      // NODE_INDEX or indexed NODE_ASSIGNMENT
+    const AstNode* loop;        // NODE_FOR that checks its range, or NULL when proven
+} IrBoundsFact;
+
+// The facts of every function of an optimized module; NULL when there are none
+IrBoundsFact* ir_collect_bounds_facts(IrModule* module, int* count);
+
+// Loop vectorization analysis (ir_vector.c). A for loop can run several
+// iterations at once when it counts up by 1, its body is one block without
+// calls, every access indexes an outside array or list with the counter
+// and needs no bounds check, and the only values carried from one
+// iteration to the next are integer sums. Accesses of different arrays
+// may still overlap in memory; the backend checks that at run time.
+typedef struct {
+    const AstNode* loop;        // NODE_FOR
+    int line;
+    bool vectorized;
+    char reason[96];            // Why not, when not vectorized
+} IrVectorLoop;
+
+// Decide for each for loop of an optimized function; returns the count
+// and a malloc'd array in *loops, in source order
+int ir_vectorize_loops(IrFunction* function, IrVectorLoop** loops);
+
+// One line per for loop: vectorized, or the first reason it is not
+void ir_dump_vector_report(IrFunction* function, FILE* out);
+
+// The decisions for every function of an optimized module
+IrVectorLoop* ir_collect_vector_loops(IrModule* module, int* count);
+
+// Escape analysis (ir_escape.c). An array() or list() escapes when it, a
+// slice of it or a copy of it is returned, stored, or passed to a
+// parameter of a program function that lets it escape in turn; builtins
+// such as len() and sum() only read it. The language has no globals, so
+// nothing else outlives the call. An array that does not escape, has a
+// constant length small enough and is not created inside a loop lives in
+// the function's frame; any other allocation that does not escape goes to
+// a region the function frees when it returns.
+typedef enum {
+    IR_PLACE_HEAP,              // Escapes
+    IR_PLACE_FRAME,             // Storage declared by the function itself
+    IR_PLACE_REGION,            // Freed all at once when the call returns
+} IrPlacement;
+
+// Largest array kept in a frame, in bytes
+#define IR_FRAME_BYTES 1024
+
+typedef struct {
+    const AstNode* source;      // array() or list() call
+    const AstNode* function;    // NODE_FUNCTION it is in
+    int line;
+    DataType type;
+    IrPlacement placement;
+    int64_t length;             // Elements, for arrays in a frame
+    char reason[96];            // Why it escapes, when on the heap
+} IrAllocation;
+
+// Decide for each allocation of an optimized function; returns the count
+// and a malloc'd array in *allocations, in source order
+int ir_place_allocations(IrModule* module, IrFunction* function, IrAllocation** allocations);
+
+// One line per allocation: where it lives, or why it escapes
+void ir_dump_escape_report(IrModule* module, IrFunction* function, FILE* out);
+
+// The decisions for every function of an optimized module
+IrAllocation* ir_collect_allocations(IrModule* module, int* count);
+
+#endif // PFLANG_IR_H
@@ -25,6 +25,7 @@ typedef struct Parser {
 // Parser functions
 void init_parser(Parser* parser, Lexer* lexer);
 AstNode* parse(Parser* parser);
+AstNode* parse_program(Parser* parser);  // Every function in the file, as a NODE_BLOCK
 bool had_parser_error(Parser* parser);
 static AstNode* parse_expression(Parser* parser);
 static AstNode* parse_statement(Parser* parser);
@@ -0,0 +1,14 @@
+#ifndef PFLANG_PERF_MAP_H
+#define PFLANG_PERF_MAP_H
+
+#include "common.h"
+#include "ast.h"
+#include "runtime/pf_perf.h"
+
+// Names the C backend gives functions in the perf maps and jitdumps that
+// programs built with --perf-map write (runtime/pf_perf.h)
+
+// Format the symbol name of a function node: "pf:name (file:line)"
+void perf_symbol_name(char* buffer, size_t size, const AstNode* function, const char* source_file);
+
+#endif // PFLANG_PERF_MAP_H
@@ -0,0 +1,74 @@
+#ifndef PFLANG_REGALLOC_H
+#define PFLANG_REGALLOC_H
+
+#include <stdint.h>
+#include "common.h"
+#include "ir.h"
+
+// Linear-scan register allocation (Poletto and Sarkar) over the SSA IR.
+//
+// Blocks are laid out in reverse postorder and every instruction gets a
+// position; each value's live interval is the hull of the positions where it
+// is defined, used or live across a block boundary. Intervals are scanned in
+// order of their start, and when a register class runs out the interval
+// that ends furthest away is spilled. Spilled intervals share stack slots
+// whenever their lifetimes do not overlap.
+
+#define REGALLOC_MAX_REGISTERS 32
+
+typedef enum {
+    REG_CLASS_INT,
+    REG_CLASS_SSE,
+} RegClass;
+
+typedef struct {
+    const char* name;
+    RegClass reg_class;
+    bool callee_saved;
+} RegisterInfo;
+
+// The allocatable registers of a calling convention, in order of preference
+typedef struct {
+    const char* name;
+    RegisterInfo registers[REGALLOC_MAX_REGISTERS];
+    int register_count;
+} RegAllocTarget;
+
+typedef struct {
+    IrInstr* value;
+    RegClass reg_class;
+    int start;
+    int end;
+    bool crosses_call;          // Live across a call, so caller-saved registers are clobbered
+    bool in_loop;               // Overlaps the body of a loop
+    int reg;                    // Index into target->registers, or -1 when spilled
+    int spill_slot;             // Stack slot when spilled, or -1
+} LiveInterval;
+
+typedef struct {
+    IrFunction* function;
+    const RegAllocTarget* target;
+    LiveInterval* intervals;    // Sorted by start
+    int interval_count;
+    int* value_intervals;       // Interval index by value id, or -1
+    int value_count;
+    int spill_count;
+    int loop_spill_count;
+    int spill_slot_count;
+    uint32_t used_registers;    // Bit per target register
+} RegAllocation;
+
+// System V AMD64: rsp and rbp are reserved, every xmm register is caller-saved
+const RegAllocTarget* regalloc_target_x86_64(void);
+
+// Compute dominators (for the block order) and allocate registers for function
+RegAllocation* regalloc_function(IrFunction* function, const RegAllocTarget* target);
+void regalloc_free(RegAllocation* allocation);
+
+// Interval of a value, or NULL if it needs no location
+LiveInterval* regalloc_interval(RegAllocation* allocation, IrInstr* value);
+
+// Per-function spill summary, followed by each value's location when verbose
+void regalloc_dump(RegAllocation* allocation, bool verbose, FILE* out);
+
+#endif // PFLANG_REGALLOC_H
@@ -0,0 +1,175 @@
+#ifndef PFLANG_ARITH_H
+#define PFLANG_ARITH_H
+
+// Fixed-width integer arithmetic with defined overflow. Every integer type
+// does its arithmetic at its own width, so u8 + u8 is a u8 and no engine
+// has to promote to 64 bits and mask afterwards. Three overflow modes exist:
+//
+//   wrap      two's complement wrap-around (the default)
+//   checked   overflow is an error
+//   saturate  clamp to the type's minimum or maximum
+//
+// Both the compiler (constant folding) and generated programs include this
+// header, so they agree on every result. The overflow tests compile to a
+// flag check after the machine instruction via __builtin_*_overflow.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    PF_OVERFLOW_WRAP,
+    PF_OVERFLOW_CHECKED,
+    PF_OVERFLOW_SATURATE,
+} pf_overflow_mode;
+
+// X(data_type, suffix, c_type, min, max, is_signed); data_type names the
+// compiler's DataType and is ignored by generated programs, is_signed is 0 or 1
+#define PF_INTEGER_TYPES(X) \
+    X(TYPE_U8, u8, uint8_t, 0, UINT8_MAX, 0) \
+    X(TYPE_U16, u16, uint16_t, 0, UINT16_MAX, 0) \
+    X(TYPE_U32, u32, uint32_t, 0, UINT32_MAX, 0) \
+    X(TYPE_U64, u64, uint64_t, 0, UINT64_MAX, 0) \
+    X(TYPE_I8, i8, int8_t, INT8_MIN, INT8_MAX, 1) \
+    X(TYPE_I16, i16, int16_t, INT16_MIN, INT16_MAX, 1) \
+    X(TYPE_I32, i32, int32_t, INT32_MIN, INT32_MAX, 1) \
+    X(TYPE_I64, i64, int64_t, INT64_MIN, INT64_MAX, 1)
+
+// Report an overflow in checked mode at a .pf source line and exit
+_Noreturn void pf_arith_overflow(const char* operation, int line);
+
+// Report an integer division or remainder by zero, in any mode, and exit
+_Noreturn void pf_arith_divide_by_zero(int line);
+
+// Which bound an overflowing operation saturates to. An unsigned operand
+// is never negative, so unsigned add and mul clamp high and sub clamps low.
+#define PF_NEGATIVE_0(x) false
+#define PF_NEGATIVE_1(x) ((x) < 0)
+#define PF_SATURATE_add(a, b, min, max, is_signed) (PF_NEGATIVE_##is_signed(b) ? (min) : (max))
+#define PF_SATURATE_sub(a, b, min, max, is_signed) (PF_NEGATIVE_##is_signed(b) ? (max) : (min))
+#define PF_SATURATE_mul(a, b, min, max, is_signed) \
+    (PF_NEGATIVE_##is_signed(a) != PF_NEGATIVE_##is_signed(b) ? (min) : (max))
+
+#define PF_DEFINE_ARITH_OP(op, suffix, c_type, min, max, is_signed) \
+    static inline c_type pf_##op##_wrap_##suffix(c_type a, c_type b) { \
+        c_type result; \
+        __builtin_##op##_overflow(a, b, &result); \
+        return result; \
+    } \
+    /* Returns true on overflow, with the wrapped result in *result */ \
+    static inline bool pf_##op##_checked_##suffix(c_type a, c_type b, c_type* result) { \
+        return __builtin_##op##_overflow(a, b, result); \
+    } \
+    static inline c_type pf_##op##_check_##suffix(c_type a, c_type b, int line) { \
+        c_type result; \
+        if (__builtin_expect(__builtin_##op##_overflow(a, b, &result), 0)) { \
+            pf_arith_overflow(#suffix " " #op, line); \
+        } \
+        return result; \
+    } \
+    static inline c_type pf_##op##_sat_##suffix(c_type a, c_type b) { \
+        c_type result; \
+        if (__builtin_expect(__builtin_##op##_overflow(a, b, &result), 0)) { \
+            return PF_SATURATE_##op(a, b, (c_type)(min), (c_type)(max), is_signed); \
+        } \
+        return result; \
+    }
+
+// add, sub and mul, each backed by __builtin_<op>_overflow
+#define PF_DEFINE_ARITH(data_type, suffix, c_type, min, max, is_signed) \
+    PF_DEFINE_ARITH_OP(add, suffix, c_type, min, max, is_signed) \
+    PF_DEFINE_ARITH_OP(sub, suffix, c_type, min, max, is_signed) \
+    PF_DEFINE_ARITH_OP(mul, suffix, c_type, min, max, is_signed)
+
+PF_INTEGER_TYPES(PF_DEFINE_ARITH)
+
+#undef PF_DEFINE_ARITH
+#undef PF_DEFINE_ARITH_OP
+
+// Division and remainder. The only overflow is the minimum of a signed type
+// divided by -1: its quotient wraps to the minimum itself, is an error, or
+// saturates to the maximum, and its remainder is 0 in every mode. Division
+// by zero has no result to wrap or clamp to, so it is an error in every
+// mode, and every div and mod takes the line to report it at.
+#define PF_DIVISION_OVERFLOWS_0(a, b, min) false
+#define PF_DIVISION_OVERFLOWS_1(a, b, min) ((a) == (min) && (b) == -1)
+
+#define PF_DEFINE_DIVISION(data_type, suffix, c_type, min, max, is_signed) \
+    /* b must not be 0. Return true on overflow, with the wrapped result in *result */ \
+    static inline bool pf_div_checked_##suffix(c_type a, c_type b, c_type* result) { \
+        if (PF_DIVISION_OVERFLOWS_##is_signed(a, b, (c_type)(min))) { \
+            *result = a; \
+            return true; \
+        } \
+        *result = (c_type)(a / b); \
+        return false; \
+    } \
+    static inline bool pf_mod_checked_##suffix(c_type a, c_type b, c_type* result) { \
+        *result = PF_DIVISION_OVERFLOWS_##is_signed(a, b, (c_type)(min)) ? 0 : (c_type)(a % b); \
+        return false; \
+    } \
+    static inline c_type pf_div_wrap_##suffix(c_type a, c_type b, int line) { \
+        if (__builtin_expect(b == 0, 0)) pf_arith_divide_by_zero(line); \
+        c_type result; \
+        pf_div_checked_##suffix(a, b, &result); \
+        return result; \
+    } \
+    static inline c_type pf_div_check_##suffix(c_type a, c_type b, int line) { \
+        if (__builtin_expect(b == 0, 0)) pf_arith_divide_by_zero(line); \
+        c_type result; \
+        if (__builtin_expect(pf_div_checked_##suffix(a, b, &result), 0)) { \
+            pf_arith_overflow(#suffix " div", line); \
+        } \
+        return result; \
+    } \
+    static inline c_type pf_div_sat_##suffix(c_type a, c_type b, int line) { \
+        if (__builtin_expect(b == 0, 0)) pf_arith_divide_by_zero(line); \
+        c_type result; \
+        if (__builtin_expect(pf_div_checked_##suffix(a, b, &result), 0)) return (c_type)(max); \
+        return result; \
+    } \
+    static inline c_type pf_mod_wrap_##suffix(c_type a, c_type b, int line) { \
+        if (__builtin_expect(b == 0, 0)) pf_arith_divide_by_zero(line); \
+        c_type result; \
+        pf_mod_checked_##suffix(a, b, &result); \
+        return result; \
+    } \
+    static inline c_type pf_mod_check_##suffix(c_type a, c_type b, int line) { \
+        return pf_mod_wrap_##suffix(a, b, line); \
+    } \
+    static inline c_type pf_mod_sat_##suffix(c_type a, c_type b, int line) { \
+        return pf_mod_wrap_##suffix(a, b, line); \
+    }
+
+PF_INTEGER_TYPES(PF_DEFINE_DIVISION)
+
+#undef PF_DEFINE_DIVISION
+
+// A signed and an unsigned integer compare by value, not by C's conversion
+// to unsigned: a negative operand is below every unsigned one. Both return
+// a negative, zero or positive int to compare against 0.
+static inline int pf_compare_signed_unsigned(int64_t a, uint64_t b) {
+    if (a < 0 || (uint64_t)a < b) return -1;
+    return (uint64_t)a > b;
+}
+
+static inline int pf_compare_unsigned_signed(uint64_t a, int64_t b) {
+    return -pf_compare_signed_unsigned(b, a);
+}
+
+// Report a for loop whose range() step is zero and exit
+_Noreturn void pf_range_step_error(int line);
+
+// Iterations of for i = range(start, end, step), counted in 64 bits
+// whatever the width of i; the distance is taken unsigned so that even
+// range(INT64_MIN, INT64_MAX) does not overflow
+static inline uint64_t pf_range_count(int64_t start, int64_t end, int64_t step, int line) {
+    if (step > 0) {
+        return start < end ? ((uint64_t)end - (uint64_t)start - 1) / (uint64_t)step + 1 : 0;
+    }
+    if (step < 0) {
+        return start > end ? ((uint64_t)start - (uint64_t)end - 1) / (0 - (uint64_t)step) + 1 : 0;
+    }
+    pf_range_step_error(line);
+}
+
+#endif // PFLANG_ARITH_H
@@ -0,0 +1,203 @@
+#ifndef PFLANG_ARRAY_H
+#define PFLANG_ARRAY_H
+
+// The array[T] and list[T] types of compiled programs. Elements are stored
+// unboxed and contiguously in their own C type, so an array[u8] of a
+// million elements is a million bytes and a loop over it reads memory in
+// order.
+//
+// An array is two words passed by value: a pointer to its first element
+// and its length. Slicing an array gives another array pointing into the
+// same elements, so slices cost nothing to take and writes through a slice
+// are seen by the parent. A list is a growable array owned through a
+// pointer; appending doubles its capacity when it is full, so n appends
+// copy fewer than 2n elements in total.
+//
+// Growing a list moves its elements to a new buffer; slices taken earlier
+// keep the old one alive. Buffers live on the collected heap (pf_gc.h),
+// unless escape analysis showed they never leave the call that made them.
+// Those live in the caller's frame or in its region, which it frees when
+// it returns; a list made in a region grows there too.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "pf_string.h"
+#include "pf_gc.h"
+
+// X(data_type, suffix, c_type); data_type names the compiler's DataType and
+// is ignored by generated programs
+#define PF_ELEMENT_TYPES(X) \
+    X(TYPE_U8, u8, uint8_t) \
+    X(TYPE_U16, u16, uint16_t) \
+    X(TYPE_U32, u32, uint32_t) \
+    X(TYPE_U64, u64, uint64_t) \
+    X(TYPE_I8, i8, int8_t) \
+    X(TYPE_I16, i16, int16_t) \
+    X(TYPE_I32, i32, int32_t) \
+    X(TYPE_I64, i64, int64_t) \
+    X(TYPE_F32, f32, float) \
+    X(TYPE_F64, f64, double) \
+    X(TYPE_STR, str, pf_string) \
+    X(TYPE_BOOL, bool, bool)
+
+// Report an index outside [0, length) or a bad slice at a .pf source line
+// and exit
+_Noreturn void pf_index_error(int64_t index, int64_t length, int line);
+_Noreturn void pf_slice_error(int64_t start, int64_t end, int64_t length, int line);
+
+// Zeroed storage for count elements of the given kind on the collected
+// heap; a negative count is an error
+void* pf_array_allocate(int64_t count, size_t element_size, pf_gc_kind kind, int line);
+
+// Allocations of one call that do not outlive it. Memory is handed out
+// from blocks in order and released all at once by pf_region_free; freed
+// blocks are kept per thread for the next call, so a call that allocates
+// only a little touches malloc only the first time.
+typedef struct pf_region_block pf_region_block;
+
+typedef struct {
+    pf_region_block* blocks;
+} pf_region;
+
+#define PF_REGION_INIT {NULL}
+
+// Zeroed storage for count elements freed with region; a negative count is
+// an error
+void* pf_region_allocate(pf_region* region, int64_t count, size_t element_size, int line);
+void pf_region_free(pf_region* region);
+
+// Move a full list's elements to a buffer twice as large, from region if
+// the list lives in one and from the collected heap otherwise
+void pf_list_grow(void** data, int64_t length, int64_t* capacity, size_t element_size, pf_gc_kind kind,
+                  pf_region* region);
+
+// True if every index start, start + step, ... of a for loop running count
+// times lies in [0, length), so its accesses need no checks. The indices
+// move one way, so checking the first and the last covers them all.
+static inline bool pf_range_fits(int64_t start, uint64_t count, int64_t step, int64_t length) {
+    if (count == 0) return true;
+    uint64_t last = (uint64_t)start + (count - 1) * (uint64_t)step;
+    return (uint64_t)start < (uint64_t)length && last < (uint64_t)length;
+}
+
+// Vectorized for loops run in blocks of this many iterations, marked with
+// PF_VECTORIZE so the compiler assumes they do not depend on each other
+#define PF_VECTOR_LANES 16
+#if defined(__clang__)
+#define PF_VECTORIZE _Pragma("clang loop vectorize(assume_safety)")
+#elif defined(__GNUC__)
+#define PF_VECTORIZE _Pragma("GCC ivdep")
+#else
+#define PF_VECTORIZE
+#endif
+
+// True if a loop writing element i of one array while reading element i
+// of another is free of dependences between iterations: the arrays are
+// the same memory or do not overlap at all
+static inline bool pf_same_or_disjoint(const void* a, int64_t a_length, const void* b, int64_t b_length,
+                                       size_t element_size) {
+    uintptr_t a_start = (uintptr_t)a;
+    uintptr_t b_start = (uintptr_t)b;
+    return a_start == b_start || a_start + (uintptr_t)a_length * element_size <= b_start ||
+           b_start + (uintptr_t)b_length * element_size <= a_start;
+}
+
+// True if the two arrays share no element at all
+static inline bool pf_disjoint(const void* a, int64_t a_length, const void* b, int64_t b_length, size_t element_size) {
+    uintptr_t a_start = (uintptr_t)a;
+    uintptr_t b_start = (uintptr_t)b;
+    return a_start + (uintptr_t)a_length * element_size <= b_start ||
+           b_start + (uintptr_t)b_length * element_size <= a_start;
+}
+
+#define PF_DEFINE_ARRAY(data_type, suffix, c_type) \
+    typedef struct { \
+        c_type* data; \
+        int64_t length; \
+    } pf_array_##suffix; \
+    \
+    typedef struct { \
+        c_type* data; \
+        int64_t length; \
+        int64_t capacity; \
+        pf_region* region;  /* NULL on the collected heap */ \
+    } pf_list_##suffix; \
+    \
+    static inline pf_array_##suffix pf_array_##suffix##_new(int64_t length, int line) { \
+        pf_array_##suffix array = {pf_array_allocate(length, sizeof(c_type), PF_GC_KIND(c_type), line), length}; \
+        return array; \
+    } \
+    \
+    static inline pf_array_##suffix pf_array_##suffix##_new_in(pf_region* region, int64_t length, int line) { \
+        pf_array_##suffix array = {pf_region_allocate(region, length, sizeof(c_type), line), length}; \
+        return array; \
+    } \
+    \
+    /* Storage is the caller's, with room for length + 1 elements */ \
+    static inline pf_array_##suffix pf_array_##suffix##_on_frame(c_type* storage, int64_t length) { \
+        memset(storage, 0, sizeof(c_type) * (size_t)(length + 1)); \
+        pf_array_##suffix array = {storage, length}; \
+        return array; \
+    } \
+    \
+    static inline c_type* pf_array_##suffix##_at(pf_array_##suffix array, int64_t index, int line) { \
+        /* One unsigned compare also catches negative indexes */ \
+        if ((uint64_t)index >= (uint64_t)array.length) pf_index_error(index, array.length, line); \
+        return &array.data[index]; \
+    } \
+    \
+    /* Elements [start, end) without copying them */ \
+    static inline pf_array_##suffix pf_array_##suffix##_slice(pf_array_##suffix array, int64_t start, \
+                                                              int64_t end, int line) { \
+        if (start < 0 || end < start || end > array.length) pf_slice_error(start, end, array.length, line); \
+        pf_array_##suffix slice = {array.data + start, end - start}; \
+        return slice; \
+    } \
+    \
+    static inline pf_list_##suffix* pf_list_##suffix##_new(int64_t capacity, int line) { \
+        pf_list_##suffix* list = pf_gc_allocate(sizeof(pf_list_##suffix), PF_GC_LIST); \
+        list->data = pf_array_allocate(capacity, sizeof(c_type), PF_GC_KIND(c_type), line); \
+        list->capacity = capacity; \
+        return list; \
+    } \
+    \
+    static inline pf_list_##suffix* pf_list_##suffix##_new_in(pf_region* region, int64_t capacity, int line) { \
+        pf_list_##suffix* list = pf_region_allocate(region, 1, sizeof(pf_list_##suffix), line); \
+        list->data = pf_region_allocate(region, capacity, sizeof(c_type), line); \
+        list->capacity = capacity; \
+        list->region = region; \
+        return list; \
+    } \
+    \
+    static inline c_type* pf_list_##suffix##_at(const pf_list_##suffix* list, int64_t index, int line) { \
+        if ((uint64_t)index >= (uint64_t)list->length) pf_index_error(index, list->length, line); \
+        return &list->data[index]; \
+    } \
+    \
+    static inline void pf_list_##suffix##_append(pf_list_##suffix* list, c_type value) { \
+        if (list->length == list->capacity) { \
+            pf_list_grow((void**)&list->data, list->length, &list->capacity, sizeof(c_type), \
+                         PF_GC_KIND(c_type), list->region); \
+        } \
+        list->data[list->length] = value; \
+        if (PF_GC_KIND(c_type) == PF_GC_STRINGS) pf_gc_note_string(&list->data[list->length]); \
+        list->length++; \
+    } \
+    \
+    /* The current elements as an array; valid until the list grows */ \
+    static inline pf_array_##suffix pf_list_##suffix##_view(const pf_list_##suffix* list) { \
+        pf_array_##suffix array = {list->data, list->length}; \
+        return array; \
+    }
+
+PF_ELEMENT_TYPES(PF_DEFINE_ARRAY)
+
+#undef PF_DEFINE_ARRAY
+
+// pf_string_split into a new list on the collected heap
+pf_list_str* pf_string_split_list(pf_string string, pf_string separator);
+
+#endif // PFLANG_ARRAY_H
@@ -0,0 +1,105 @@
+#ifndef PFLANG_CHAN_H
+#define PFLANG_CHAN_H
+
+// The chan[T] type of compiled programs: typed queues between tasks.
+//
+// A bounded channel is a ring of capacity slots. Each slot has a stamp
+// saying which lap of the ring it last changed on, as in Vyukov's bounded
+// MPMC queue: a sender claims the slot at the send position by advancing
+// it, fills the slot and bumps its stamp, and a receiver does the same
+// from the receive position. Each end reads only its own position and the
+// stamps, so a busy sender and receiver do not share a cache line.
+//
+// The two ends are owned separately. The first task or thread to use an
+// end owns it, and while nobody else uses that end its operations advance
+// the position with plain stores: no compare-and-swap and no fence. When
+// another task or thread uses the end, the owner is fenced off once with
+// membarrier and the end is shared from then on, advancing its position
+// with compare-and-swap. A party that waits across from an owned end runs
+// membarrier too, so an end that keeps the other side waiting is shared
+// as well. Where membarrier is missing, or with PFLANG_CHAN_SHARED set,
+// ends start out shared.
+//
+// An unbounded channel has the same ring; when the ring is full, senders
+// queue their values behind it under a lock rather than wait, and
+// receivers take from that queue once the ring is drained.
+//
+// A task that has to wait parks (pf_task.h), leaving its worker free for
+// other tasks, and is woken by the operation that makes room or a value.
+// After close, receivers get the values still queued and then zeros;
+// sending on a closed channel is an error. A channel lives until the
+// program exits.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pf_string.h"
+#include "pf_gc.h"
+#include "pf_array.h"
+
+typedef struct pf_chan pf_chan;
+
+#define PF_CHAN_UNBOUNDED (-1)
+
+// A channel of capacity values of element_size bytes, or PF_CHAN_UNBOUNDED;
+// any other capacity below 1 is an error
+pf_chan* pf_chan_new(size_t element_size, int64_t capacity, pf_gc_kind kind, int line);
+
+// Wait for room, then send the element_size bytes at value
+void pf_chan_send(pf_chan* chan, const void* value, int line);
+
+// Wait for a value and store it at value; false, storing zeros, once the
+// channel is closed and empty
+bool pf_chan_recv(pf_chan* chan, void* value, int line);
+
+void pf_chan_close(pf_chan* chan, int line);
+
+// One operation of a select: a send of the value at value, or a receive
+// into it
+typedef struct {
+    pf_chan* chan;
+    bool send;
+    void* value;
+} pf_chan_case;
+
+// Carry out one of the cases that can go ahead and return its index, or
+// -1 when none can and blocking is false; otherwise wait until one can.
+// *ok is false when the case was a receive from a closed, empty channel.
+// When several are ready, each is as likely to be picked.
+int pf_chan_select(pf_chan_case* cases, int count, bool blocking, bool* ok, int line);
+
+typedef struct {
+    uint64_t waits;             // Times a send, receive or select parked
+    uint64_t owned;             // Ends that got an owner
+    uint64_t shared;            // Ends shared after having an owner
+} pf_chan_statistics;
+
+void pf_chan_get_statistics(pf_chan_statistics* statistics);
+
+#define PF_DEFINE_CHAN(data_type, suffix, c_type) \
+    static inline pf_chan* pf_chan_##suffix##_new(int64_t capacity, int line) { \
+        return pf_chan_new(sizeof(c_type), capacity, PF_GC_KIND(c_type), line); \
+    } \
+    \
+    static inline void pf_chan_##suffix##_send(pf_chan* chan, c_type value, int line) { \
+        pf_chan_send(chan, &value, line); \
+    } \
+    \
+    static inline c_type pf_chan_##suffix##_recv(pf_chan* chan, int line) { \
+        c_type value; \
+        pf_chan_recv(chan, &value, line); \
+        return value; \
+    } \
+    \
+    static inline c_type pf_chan_##suffix##_recv_ok(pf_chan* chan, bool* ok, int line) { \
+        c_type value; \
+        *ok = pf_chan_recv(chan, &value, line); \
+        return value; \
+    }
+
+PF_ELEMENT_TYPES(PF_DEFINE_CHAN)
+
+#undef PF_DEFINE_CHAN
+
+#endif // PFLANG_CHAN_H
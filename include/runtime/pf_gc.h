@@ -0,0 +1,183 @@
+#ifndef PFLANG_GC_H
+#define PFLANG_GC_H
+
+// The garbage-collected heap of compiled programs: array and list storage
+// and the bytes of long strings.
+//
+// It has two generations. New objects are bump-allocated from a
+// thread-local allocation buffer (TLAB), a chunk of the nursery handed to
+// one thread, so the common allocation is a compare and an add. When the
+// nursery fills up, a minor collection copies its live objects into the
+// old generation and the nursery is reused. The old generation is
+// mark-sweep over pages of equal-sized cells, plus one block per large
+// object, and is collected when it has doubled since the last time. It is
+// marked by a pool of threads that steal work from each other; its pages
+// are swept lazily, when allocation next needs cells of their size.
+//
+// Objects are traced precisely: each one's header says whether it holds
+// raw bytes, strings or a list's buffer pointer. Stacks are not, because C
+// compilers keep references in registers and temporaries no map can
+// describe. They are scanned word by word instead, and a nursery object
+// any of those words points into is pinned: it stays where it is for that
+// collection. Memory outside the heap that may hold references registers
+// itself with pf_gc_add_roots and is treated the same way; memory holding
+// nothing but strings, such as the keys of a map, registers with
+// pf_gc_add_string_roots instead and is traced precisely, so the strings
+// it refers to are promoted like any others.
+//
+// Old objects that come to point at young ones are found through a
+// remembered set, kept up to date by the write barriers below on every
+// store of a reference into the heap.
+//
+// Several threads may allocate at once. A collection stops all of them
+// first: each one stops when it next reaches a safepoint (an allocation
+// that needs a new TLAB, or a pf_gc_safepoint call compiled into its
+// loops), or is already stopped while it blocks in pf_gc_blocking.
+//
+// PFLANG_GC_NURSERY sets the nursery size in bytes (with an optional k or
+// m suffix); PFLANG_GC_THREADS the number of marking threads (one per
+// core up to 8 by default); PFLANG_GC_STATS, when set, prints
+// pf_gc_statistics at exit.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "pf_string.h"
+
+// What an object holds, which is all tracing needs to know about it
+typedef enum {
+    PF_GC_BYTES,            // No references
+    PF_GC_STRINGS,          // pf_string elements
+    PF_GC_LIST,             // A list header; its first word points to its buffer
+} pf_gc_kind;
+
+// The kind for elements of C type c_type
+#define PF_GC_KIND(c_type) _Generic(*(c_type*)0, pf_string: PF_GC_STRINGS, default: PF_GC_BYTES)
+
+// Every object is preceded by a header; payloads are 16-byte aligned
+typedef struct {
+    uint32_t size;          // Payload bytes, so objects stay under 4 GiB
+    uint8_t kind;           // pf_gc_kind
+    uint8_t flags;
+    uint16_t reserved;
+    void* forward;          // Where a promoted nursery object went; next free cell of a free old one
+} pf_gc_header;
+
+#define PF_GC_GRANULE 16
+
+// Largest payload allocated in the nursery; bigger objects start out old
+#define PF_GC_MAX_YOUNG (8192 - sizeof(pf_gc_header))
+
+typedef struct {
+    char* top;
+    char* end;
+} pf_gc_tlab;
+
+extern _Thread_local pf_gc_tlab pf_gc_local_tlab;
+extern char* pf_gc_nursery_start;
+extern char* pf_gc_nursery_end;
+extern uint8_t* pf_gc_object_starts;    // One bit per nursery granule that starts an object
+
+void* pf_gc_allocate_slow(size_t size, pf_gc_kind kind);
+
+// Zeroed storage for size bytes
+static inline void* pf_gc_allocate(size_t size, pf_gc_kind kind) {
+    pf_gc_tlab* tlab = &pf_gc_local_tlab;
+    size_t cell = (sizeof(pf_gc_header) + size + PF_GC_GRANULE - 1) & ~(size_t)(PF_GC_GRANULE - 1);
+    if (size <= PF_GC_MAX_YOUNG && cell <= (size_t)(tlab->end - tlab->top)) {
+        pf_gc_header* header = (pf_gc_header*)tlab->top;
+        tlab->top += cell;
+        header->size = (uint32_t)size;
+        header->kind = (uint8_t)kind;
+        header->flags = 0;
+        header->reserved = 0;
+        header->forward = NULL;
+        size_t granule = (size_t)((char*)header - pf_gc_nursery_start) / PF_GC_GRANULE;
+        pf_gc_object_starts[granule / 8] |= (uint8_t)(1u << (granule % 8));
+        return header + 1;
+    }
+    return pf_gc_allocate_slow(size, kind);
+}
+
+static inline bool pf_gc_is_young(const void* pointer) {
+    return (const char*)pointer >= pf_gc_nursery_start && (const char*)pointer < pf_gc_nursery_end;
+}
+
+// Record that the heap word at slot may now point into the nursery
+void pf_gc_remember(const void* slot);
+
+// Write barriers: call after storing a reference at slot
+static inline void pf_gc_note_pointer(void* const* slot) {
+    if (pf_gc_is_young(*slot) && !pf_gc_is_young(slot)) pf_gc_remember(slot);
+}
+
+static inline void pf_gc_note_string(const void* slot) {
+    const pf_string* string = (const pf_string*)slot;
+    if (!pf_string_is_inline(string) && pf_gc_is_young(string->as.data) && !pf_gc_is_young(slot)) {
+        pf_gc_remember(slot);
+    }
+}
+
+static inline void pf_gc_store_string(pf_string* slot, pf_string value) {
+    *slot = value;
+    pf_gc_note_string(slot);
+}
+
+// Scan [start, start + size) for references at every collection until it
+// is removed again
+void pf_gc_add_roots(const void* start, size_t size);
+// The same for count strings at strings, whose byte pointers the collector
+// may rewrite while every thread is stopped
+void pf_gc_add_string_roots(const pf_string* strings, size_t count);
+void pf_gc_remove_roots(const void* start);
+
+// Collect now: the nursery, and with major the old generation too
+void pf_gc_collect(bool major);
+
+// Set while a collection waits for the other threads to stop
+extern _Atomic int pf_gc_stop_requested;
+
+// Stop the calling thread until the collection under way is over
+void pf_gc_park(void);
+
+// Stop here if another thread is waiting to collect
+static inline void pf_gc_safepoint(void) {
+    if (__builtin_expect(atomic_load_explicit(&pf_gc_stop_requested, memory_order_relaxed), 0)) pf_gc_park();
+}
+
+// Run block(argument), which must not touch the heap, while collections
+// go ahead without waiting for the calling thread
+void pf_gc_blocking(void (*block)(void*), void* argument);
+
+// The calling thread now runs on a stack ending just below top, such as
+// a green thread's; returns the top it replaces. Stacks that are switched
+// out are not found by the collector on its own: walk is called during
+// every collection to report each of them as [low, high).
+const void* pf_gc_set_stack_top(const void* top);
+void pf_gc_set_stack_walker(void (*walk)(void (*visit)(const void* low, const void* high)));
+
+typedef struct {
+    uint64_t minor_collections;
+    uint64_t major_collections;
+    uint64_t bytes_allocated;       // Since the heap was set up
+    uint64_t bytes_promoted;        // Copied out of the nursery
+    uint64_t heap_bytes;            // Old generation in use
+    double minor_pause_ms;          // Total time spent in each kind of collection
+    double major_pause_ms;
+    double max_pause_ms;            // Longest single collection
+    double allocation_rate;         // Megabytes allocated per second of run time
+    int mark_threads;               // Threads marking the old generation; 0 before the first major collection
+} pf_gc_statistics;
+
+void pf_gc_get_statistics(pf_gc_statistics* statistics);
+void pf_gc_print_statistics(FILE* out);
+
+// Set up the heap and register the calling thread as one that allocates;
+// allocation does this on first use. Registered threads must keep
+// reaching safepoints until the process exits.
+void pf_gc_init(void);
+
+#endif // PFLANG_GC_H
@@ -0,0 +1,72 @@
+#ifndef PFLANG_IO_H
+#define PFLANG_IO_H
+
+// File and socket I/O that parks the calling task instead of blocking its
+// worker.
+//
+// One I/O thread, started by the first operation, waits in epoll on every
+// descriptor in use. Pipes, sockets and terminals are switched to
+// non-blocking mode and registered once, edge-triggered, for both
+// directions. An operation tries the system call first; only when it
+// would block does the task park (pf_task.h), and the I/O thread unparks
+// it when the descriptor becomes ready, after which it tries again. A
+// descriptor that is already ready costs no more than the system call.
+//
+// Regular files are always "ready" to epoll, yet reading them can wait on
+// the disk. Their reads and writes are submitted to an io_uring instead,
+// whose completions the same I/O thread reaps through epoll, and the task
+// parks until its operation is complete. Where the kernel has no io_uring,
+// or PFLANG_IO_URING=0, they run on the calling thread while collections
+// go ahead without it.
+//
+// Outside tasks the calling thread waits instead, so the same functions
+// serve main. Descriptors must be closed with pf_io_close, which wakes
+// whoever still waits on them; their operations then fail.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pf_string.h"
+
+// Up to length bytes into buffer: how many were read, 0 at the end, or -1
+// with errno set
+int64_t pf_io_read(int fd, void* buffer, size_t length);
+
+// All length bytes from buffer: length, or -1 with errno set
+int64_t pf_io_write(int fd, const void* buffer, size_t length);
+
+// Open a file with open(2) flags and mode; a descriptor, or -1
+int pf_io_open(const char* path, int flags, int mode);
+
+int pf_io_close(int fd);
+
+// A TCP socket listening on port of every address, or -1; port 0 picks a
+// free one (see pf_io_local_port)
+int pf_io_listen_tcp(int port);
+
+// Wait for a connection on a listening socket; a descriptor, or -1
+int pf_io_accept(int fd);
+
+// Connect to port on host, a name or a numeric address; a descriptor, or -1
+int pf_io_connect_tcp(pf_string host, int port);
+
+// The port a socket is bound to, or -1
+int pf_io_local_port(int fd);
+
+// The builtins of compiled programs. open_file takes "r", "w" (truncate),
+// "a" (append) or "rw"; read returns "" at the end or on an error.
+int64_t pf_io_open_file(pf_string path, pf_string mode);
+pf_string pf_io_read_string(int64_t fd, int64_t max);
+int64_t pf_io_write_string(int64_t fd, pf_string data);
+
+typedef struct {
+    uint64_t waits;             // Times an operation parked until its descriptor was ready
+    uint64_t submitted;         // File operations handed to io_uring
+    uint64_t in_place;          // File operations run on the calling thread
+    bool uring;                 // Whether io_uring is in use; false before the first operation
+} pf_io_statistics;
+
+void pf_io_get_statistics(pf_io_statistics* statistics);
+
+#endif // PFLANG_IO_H
@@ -0,0 +1,83 @@
+#ifndef PFLANG_MAP_H
+#define PFLANG_MAP_H
+
+// The map type of compiled programs: an open-addressing hash table in the
+// style of Swiss tables. Next to the slots sits one control byte per slot,
+// either PF_MAP_EMPTY or the low 7 bits of the key's hash, so a probe
+// compares 16 control bytes with one SSE2 instruction and only looks at
+// keys whose hash bits match.
+//
+// Probing is linear, one 16-byte window at a time, which lets deletion
+// shift later entries back into the hole instead of leaving tombstones:
+// a table that sees many inserts and deletes never fills up with dead
+// slots and never needs a cleanup rehash.
+//
+// Keys are stored unboxed in a layout per key type: pf_map_int for every
+// integer type (widened to 64 bits) and pf_map_str for str, which reuses
+// the hash cached in each string. Values are opaque bytes of a size fixed
+// when the map is created.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pf_string.h"
+
+#define PF_MAP_GROUP_WIDTH 16
+#define PF_MAP_EMPTY 0x80
+
+#define PF_MAP_FIELDS(key_type) \
+    uint8_t* control;       /* capacity + PF_MAP_GROUP_WIDTH - 1 bytes; the tail mirrors the head */ \
+    key_type* keys; \
+    char* values; \
+    size_t value_size; \
+    size_t count; \
+    size_t capacity;        /* Power of two, or 0 before the first insert */
+
+typedef struct {
+    PF_MAP_FIELDS(int64_t)
+} pf_map_int;
+
+typedef struct {
+    PF_MAP_FIELDS(pf_string)
+} pf_map_str;
+
+#undef PF_MAP_FIELDS
+
+// The same operations for each layout. find returns the value of key or
+// NULL; insert returns the value of key, adding it with a zeroed value if
+// it is missing; both pointers stay valid until the next insert or remove.
+// Iterate with a cursor starting at 0: next returns false after the last
+// entry and otherwise stores the entry's slot for key_at and value_at.
+#define PF_MAP_DECLARE(name, key_type) \
+    void pf_##name##_init(pf_##name* map, size_t value_size); \
+    void pf_##name##_free(pf_##name* map); \
+    void* pf_##name##_find(const pf_##name* map, key_type key); \
+    void* pf_##name##_insert(pf_##name* map, key_type key, bool* inserted); \
+    bool pf_##name##_remove(pf_##name* map, key_type key); \
+    bool pf_##name##_next(const pf_##name* map, size_t* cursor, size_t* slot); \
+    static inline key_type pf_##name##_key_at(const pf_##name* map, size_t slot) { \
+        return map->keys[slot]; \
+    } \
+    static inline void* pf_##name##_value_at(const pf_##name* map, size_t slot) { \
+        return map->values + slot * map->value_size; \
+    }
+
+PF_MAP_DECLARE(map_int, int64_t)
+PF_MAP_DECLARE(map_str, pf_string)
+
+#undef PF_MAP_DECLARE
+
+// The maps programs use through the map_* builtins: str keys and i64
+// values, held by an i64 handle like a file descriptor. A handle stays
+// valid until pf_map_free; one map must not be used by two tasks at
+// once.
+int64_t pf_map_new(void);
+void pf_map_set(int64_t map, pf_string key, int64_t value);
+int64_t pf_map_get(int64_t map, pf_string key, int64_t missing);   // missing if key is not there
+bool pf_map_has(int64_t map, pf_string key);
+bool pf_map_remove(int64_t map, pf_string key);
+int64_t pf_map_count(int64_t map);
+void pf_map_free(int64_t map);
+
+#endif // PFLANG_MAP_H
@@ -0,0 +1,63 @@
+#ifndef PFLANG_NUMERIC_H
+#define PFLANG_NUMERIC_H
+
+// Whole-array arithmetic for arrays of numbers: sums, extremes, dot
+// products, scaling and comparison masks. Each call runs one loop over the
+// elements on SSE2 or AVX2 kernels picked for the CPU on first use, with
+// scalar fallbacks everywhere else, so a program pays for dispatch once per
+// array instead of once per element.
+//
+// Sums and dot products of integers are 64 bits wide and wrap around like
+// the arithmetic of the wrap overflow mode; floats are added in their own
+// type, several lanes at a time, so the rounding may differ from a loop
+// that adds them one by one. scale multiplies in place at the element's
+// width.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <float.h>
+
+#include "pf_arith.h"
+#include "pf_array.h"
+
+// X(data_type, suffix, c_type, min, max, is_signed): the rows of
+// PF_INTEGER_TYPES and then the two float types, which count as signed
+#define PF_NUMERIC_TYPES(X) \
+    PF_INTEGER_TYPES(X) \
+    X(TYPE_F32, f32, float, -FLT_MAX, FLT_MAX, 1) \
+    X(TYPE_F64, f64, double, -DBL_MAX, DBL_MAX, 1)
+
+// pf_total_<suffix> is what sums and dot products of the type return:
+// 64-bit integers of the same signedness, or the float type itself
+#define PF_INTEGER_TOTAL_0 uint64_t
+#define PF_INTEGER_TOTAL_1 int64_t
+#define PF_DEFINE_TOTAL(data_type, suffix, c_type, min, max, is_signed) \
+    typedef PF_INTEGER_TOTAL_##is_signed pf_total_##suffix;
+PF_INTEGER_TYPES(PF_DEFINE_TOTAL)
+#undef PF_DEFINE_TOTAL
+typedef float pf_total_f32;
+typedef double pf_total_f64;
+
+// min and max of an empty array and dot of arrays of different lengths are
+// errors reported at line
+#define PF_DECLARE_NUMERIC(data_type, suffix, c_type, min, max, is_signed) \
+    pf_total_##suffix pf_sum_##suffix(pf_array_##suffix xs); \
+    pf_total_##suffix pf_dot_##suffix(pf_array_##suffix a, pf_array_##suffix b, int line); \
+    c_type pf_min_##suffix(pf_array_##suffix xs, int line); \
+    c_type pf_max_##suffix(pf_array_##suffix xs, int line); \
+    void pf_scale_##suffix(pf_array_##suffix xs, c_type factor); \
+    pf_array_bool pf_mask_lt_##suffix(pf_array_##suffix xs, c_type value, int line); \
+    pf_array_bool pf_mask_gt_##suffix(pf_array_##suffix xs, c_type value, int line); \
+    pf_array_bool pf_mask_eq_##suffix(pf_array_##suffix xs, c_type value, int line);
+
+PF_NUMERIC_TYPES(PF_DECLARE_NUMERIC)
+
+#undef PF_DECLARE_NUMERIC
+
+// Name of the kernel set in use: "avx2", "sse2" or "scalar"
+const char* pf_numeric_kernels(void);
+
+// Switch kernel sets, for tests and benchmarks; false if the CPU lacks it
+bool pf_numeric_use_kernels(const char* name);
+
+#endif // PFLANG_NUMERIC_H
@@ -0,0 +1,29 @@
+#ifndef PFLANG_OUTPUT_H
+#define PFLANG_OUTPUT_H
+
+// Buffered standard output for compiled programs. Each thread appends to
+// its own buffer; the buffer goes out when it fills, at a newline when
+// stdout is a terminal, before anything is written to stderr, and at exit.
+// Writes that do not fit are sent together with the buffered bytes in a
+// single writev instead of being copied.
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PF_OUTPUT_BUFFER_SIZE 65536
+
+typedef struct {
+    uint64_t bytes;         // Bytes handed to the kernel
+    uint64_t syscalls;      // write and writev calls
+    uint64_t flushes;       // Buffers sent out
+} pf_output_stats;
+
+// Called by pf_runtime_init: decides between line and block buffering
+void pf_output_init(void);
+
+void pf_output_write(const char* data, size_t length);
+void pf_output_flush(void);
+
+pf_output_stats pf_output_get_stats(void);
+
+#endif // PFLANG_OUTPUT_H
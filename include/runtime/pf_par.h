@@ -0,0 +1,61 @@
+#ifndef PFLANG_PAR_H
+#define PFLANG_PAR_H
+
+// Parallel loops behind par for, par_map and par_reduce.
+//
+// A loop over count iterations is cut into chunks of consecutive
+// iterations that run on the task pool (pf_task.h). The caller times the
+// first iterations itself, doubling the number it runs until they take
+// long enough to measure, and picks the grain from that: a chunk should
+// take at least PFLANG_PAR_CHUNK_US microseconds (50 by default) so that
+// handing it out costs little next to running it, and a longer loop is
+// cut into eight chunks per worker, enough that workers finishing early
+// find more.
+// A loop whose remaining iterations are too few for two chunks finishes
+// on the caller.
+//
+// The rest is handed out from a shared counter: the caller spawns one
+// helper task per worker, which idle workers take or steal, and the
+// caller and the helpers claim chunks until none are left. The caller
+// then parks until the last helper is through, so a loop started from a
+// task frees its worker meanwhile, and loops nest.
+//
+// A reduction gives each chunk its own partial result and combines the
+// partials in the order of their chunks once all are done, so the
+// combining function need only be associative.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Runs iterations first to last - 1
+typedef void (*pf_par_body)(void* context, int64_t first, int64_t last);
+
+// Runs iterations first to last - 1 into the partial result at partial,
+// which it starts itself
+typedef void (*pf_par_reduce_body)(void* context, int64_t first, int64_t last, void* partial);
+
+// Folds the partial result at from, of the iterations after those of
+// into, into into
+typedef void (*pf_par_combine)(void* context, void* into, const void* from);
+
+// Run body over iterations 0 to count - 1 and return once all are done
+void pf_parallel_for(int64_t count, pf_par_body body, void* context);
+
+// Run body over iterations 0 to count - 1 and leave the combined partial
+// results, of size bytes each, at result; result is left alone when count
+// is 0. Partial results may hold strings and arrays.
+void pf_parallel_reduce(int64_t count, pf_par_reduce_body body, pf_par_combine combine, void* context,
+                        void* result, size_t size);
+
+typedef struct {
+    uint64_t loops;             // Parallel loops started
+    uint64_t sequential;        // Loops that finished on the caller
+    uint64_t chunks;            // Chunks handed out after timing
+    uint64_t helpers;           // Helper tasks spawned
+    int64_t last_grain;         // Iterations per chunk of the latest loop that was split
+} pf_par_statistics;
+
+void pf_par_get_statistics(pf_par_statistics* statistics);
+
+#endif // PFLANG_PAR_H
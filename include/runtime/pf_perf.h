@@ -0,0 +1,62 @@
+#ifndef PFLANG_PERF_H
+#define PFLANG_PERF_H
+
+// Writers for the two interfaces Linux perf uses to symbolize generated code.
+//
+// /tmp/perf-<pid>.map is a text file with one "START SIZE name" line per
+// code region; perf report reads it directly.
+//
+// jit-<pid>.dump is the binary jitdump format. It also carries source line
+// tables; `perf inject --jit` turns it into ELF images so perf annotate and
+// flame graphs can show .pf files and lines.
+//
+// A program built with pflang --perf-map registers its functions with
+// both when it starts: the map goes to $PFLANG_PERF_MAP, or the path above,
+// and a jitdump is written into the directory $PFLANG_JITDUMP if it is set.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct {
+    FILE* file;
+} PerfMap;
+
+typedef struct {
+    FILE* file;
+    void* marker;        // Executable mapping of the dump that perf record sees
+    size_t marker_size;
+    uint64_t code_index;
+} JitDump;
+
+// perf map
+bool perf_map_open(PerfMap* map);
+bool perf_map_open_path(PerfMap* map, const char* path);
+void perf_map_write_entry(PerfMap* map, const void* code, size_t size, const char* name);
+void perf_map_close(PerfMap* map);
+
+// jitdump; the file is created as <directory>/jit-<pid>.dump
+bool jitdump_open(JitDump* dump, const char* directory);
+void jitdump_write_code_load(JitDump* dump, const void* code, size_t size, const char* name,
+                             const char* source_file, int line);
+void jitdump_close(JitDump* dump);
+
+// A function of a program built with --perf-map
+typedef struct {
+    const void* code;
+    const char* name;       // "pf:name (file:line)"
+    int line;
+} pf_perf_symbol;
+
+// The generated functions are placed in one section, in any order, so
+// each one's size is the distance to the next and the linker's end symbol
+// bounds the last
+#define PF_PERF_CODE __attribute__((section("pf_code")))
+extern const char __stop_pf_code[];
+
+// Write an entry for each symbol to the perf map, and to a jitdump if one
+// was asked for
+void pf_perf_register(const pf_perf_symbol* symbols, int count, const void* code_end, const char* source_file);
+
+#endif // PFLANG_PERF_H
@@ -0,0 +1,140 @@
+#ifndef PFLANG_RUNTIME_H
+#define PFLANG_RUNTIME_H
+
+// Runtime support for programs compiled by the C backend. Generated code
+// includes this header and links against libpflang_rt.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "pf_arith.h"
+#include "pf_output.h"
+#include "pf_string.h"
+#include "pf_gc.h"
+#include "pf_task.h"
+#include "pf_chan.h"
+#include "pf_par.h"
+#include "pf_io.h"
+#include "pf_map.h"
+#include "pf_perf.h"
+#include "pf_array.h"
+#include "pf_numeric.h"
+
+typedef const char* pf_str;
+
+// An error is one word: its message, with null meaning no error. Being
+// zero-initialized and register sized, (T, error) results come back in two
+// registers and returning "no error" costs the same as returning a plain
+// value.
+typedef struct {
+    pf_str message;
+} pf_error;
+
+_Static_assert(sizeof(pf_error) == sizeof(void*), "pf_error must stay a single word");
+
+#define PF_NO_ERROR ((pf_error){NULL})
+
+static inline bool pf_error_is_null(pf_error error) {
+    return error.message == NULL;
+}
+
+// Dynamically typed argument of the generic formatter
+typedef enum {
+    PF_VALUE_INT,
+    PF_VALUE_UINT,
+    PF_VALUE_FLOAT,
+    PF_VALUE_STR,
+    PF_VALUE_BOOL,
+} pf_value_kind;
+
+typedef struct {
+    pf_value_kind kind;
+    union {
+        int64_t i;
+        uint64_t u;
+        double f;
+        pf_str s;
+        bool b;
+    } as;
+} pf_value;
+
+#define PF_INT(x) ((pf_value){PF_VALUE_INT, {.i = (int64_t)(x)}})
+#define PF_UINT(x) ((pf_value){PF_VALUE_UINT, {.u = (uint64_t)(x)}})
+#define PF_FLOAT(x) ((pf_value){PF_VALUE_FLOAT, {.f = (double)(x)}})
+#define PF_STR(x) ((pf_value){PF_VALUE_STR, {.s = (x)}})
+#define PF_BOOL(x) ((pf_value){PF_VALUE_BOOL, {.b = (x)}})
+
+void pf_runtime_init(void);
+void pf_runtime_shutdown(void);
+
+// Functions the optimizer inlined at every call site, so the C compiler
+// inlines them too
+#if defined(__GNUC__)
+#define PF_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define PF_ALWAYS_INLINE inline
+#endif
+
+// A call in a program built to count its calls (pflang --profile-calls)
+typedef struct {
+    const char* caller;
+    int line;
+    const char* callee;
+} pf_call_site;
+
+// Write one "caller line callee count" line per call site to the file
+// named by $PFLANG_CALL_PROFILE, or pflang.prof, for pflang --inline-profile
+void pf_write_call_profile(const pf_call_site* sites, const uint64_t* counts, int count);
+
+// Never returns a null error, even for a null message
+pf_error pf_error_new(pf_str message);
+// Errors outlive the format buffers their messages are built in and move
+// between threads, so messages other than literals are copied to the
+// collected heap
+pf_error pf_error_copy(pf_str message);
+pf_error pf_error_from_string(pf_string message);
+
+void pf_print_int(int64_t value);
+void pf_print_uint(uint64_t value);
+void pf_print_float(double value);
+void pf_print_str(pf_str value);
+void pf_print_string(pf_string value);
+void pf_print_bool(bool value);
+void pf_print_error(pf_error value);
+
+// "format" % args for a format only known at run time; the result lives in
+// a small rotating set of per-thread buffers, which grow to fit it, so it is
+// only valid until a few more strings are formatted
+pf_str pf_format(pf_str format, int count, const pf_value* args);
+
+// Building blocks of formats compiled ahead of time: the compiler splits a
+// literal format into chunks and typed conversions and emits one append per
+// piece into the same rotating buffers pf_format uses
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int slot;                   // Which of the rotating buffers data belongs to
+} pf_fmt;
+
+#define PF_FMT_LITERAL(fmt, text) pf_fmt_literal((fmt), (text), sizeof(text) - 1)
+
+pf_fmt pf_fmt_begin(void);
+void pf_fmt_literal(pf_fmt* fmt, const char* text, size_t length);
+void pf_fmt_int(pf_fmt* fmt, int64_t value);
+void pf_fmt_uint(pf_fmt* fmt, uint64_t value);
+void pf_fmt_float(pf_fmt* fmt, double value);
+// %f, %e and %g with precision digits, as printf has them; precisions
+// above PF_FMT_MAX_PRECISION are cut to it
+#define PF_FMT_MAX_PRECISION 99
+void pf_fmt_fixed(pf_fmt* fmt, double value, int precision);
+void pf_fmt_exponent(pf_fmt* fmt, double value, int precision);
+void pf_fmt_general(pf_fmt* fmt, double value, int precision);
+void pf_fmt_str(pf_fmt* fmt, pf_str value);
+void pf_fmt_string(pf_fmt* fmt, pf_string value);
+void pf_fmt_bool(pf_fmt* fmt, bool value);
+void pf_fmt_error(pf_fmt* fmt, pf_error value);
+pf_str pf_fmt_end(pf_fmt* fmt);
+
+#endif // PFLANG_RUNTIME_H
@@ -0,0 +1,100 @@
+#ifndef PFLANG_STRING_H
+#define PFLANG_STRING_H
+
+// The immutable str type of compiled programs. A string is three words
+// passed by value: its length, a cached hash and either the bytes
+// themselves (up to PF_STRING_INLINE_CAPACITY, so short keys never touch
+// the heap) or a pointer to bytes owned elsewhere: a literal, a heap copy
+// or the parent a slice was taken from. Strings are not NUL-terminated.
+//
+// Long strings are never written after creation, so slices and copies of
+// a value can share them. Copies are made on the collected heap (pf_gc.h);
+// a string stored into heap memory must go through pf_gc_store_string.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#define PF_STRING_INLINE_CAPACITY 16
+
+typedef struct {
+    uint32_t length;
+    uint32_t hash;              // 0 until computed
+    union {
+        // Bytes past length are zero, so two inline strings compare as words
+        char bytes[PF_STRING_INLINE_CAPACITY];
+        const char* data;
+    } as;
+} pf_string;
+
+_Static_assert(sizeof(pf_string) == 3 * sizeof(void*), "pf_string must stay three words");
+
+#define PF_STRING_EMPTY ((pf_string){0, 0, {{0}}})
+
+// Intern a C string literal; generated programs do this once per literal
+// while loading
+#define PF_STRING_LITERAL(text) pf_string_intern((text), sizeof(text) - 1)
+
+static inline bool pf_string_is_inline(const pf_string* string) {
+    return string->length <= PF_STRING_INLINE_CAPACITY;
+}
+
+static inline const char* pf_string_data(const pf_string* string) {
+    return pf_string_is_inline(string) ? string->as.bytes : string->as.data;
+}
+
+// Copy bytes into a new string
+pf_string pf_string_from(const char* data, size_t length);
+pf_string pf_string_from_cstr(const char* text);
+
+// The canonical string for bytes with static lifetime. Identical long
+// literals share one buffer, so comparing them is a pointer test. Not
+// thread-safe: meant for load time, before other threads exist.
+pf_string pf_string_intern(const char* data, size_t length);
+
+// Bytes [start, end) of string, clamped to its length. A long slice
+// points into the parent's buffer instead of copying.
+pf_string pf_string_slice(pf_string string, size_t start, size_t end);
+
+bool pf_string_equal(pf_string a, pf_string b);
+
+// Computes and caches the hash on first use; never returns 0
+uint32_t pf_string_hash(pf_string* string);
+
+// NUL-terminated heap copy, for interfaces that want a C string
+char* pf_string_to_cstr(pf_string string);
+
+// String library. Scans run on SSE2 or AVX2 kernels picked for the CPU on
+// first use, with scalar fallbacks everywhere else.
+
+// Offset of the first needle, or -1; an empty needle is found at 0
+int64_t pf_string_find(pf_string haystack, pf_string needle);
+
+// Non-overlapping occurrences; 0 for an empty needle
+int64_t pf_string_count(pf_string haystack, pf_string needle);
+
+// Split around separator into slices of string. Returns how many parts
+// there are and stores the first max_parts of them.
+size_t pf_string_split(pf_string string, pf_string separator, pf_string* parts, size_t max_parts);
+
+bool pf_string_starts_with(pf_string string, pf_string prefix);
+bool pf_string_ends_with(pf_string string, pf_string suffix);
+
+// Bytewise order: negative, zero or positive
+int32_t pf_string_compare(pf_string a, pf_string b);
+
+// ASCII case conversion; other bytes are copied unchanged
+pf_string pf_string_to_upper(pf_string string);
+pf_string pf_string_to_lower(pf_string string);
+
+// Well-formed UTF-8: no overlong forms, surrogates or code points past U+10FFFF
+bool pf_string_is_utf8(pf_string string);
+
+// Name of the kernel set in use: "avx2", "sse2" or "scalar"
+const char* pf_string_kernels(void);
+
+// Switch kernel sets, for tests and benchmarks; false if the CPU lacks it
+bool pf_string_use_kernels(const char* name);
+
+#endif // PFLANG_STRING_H
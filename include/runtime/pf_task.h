@@ -0,0 +1,97 @@
+#ifndef PFLANG_TASK_H
+#define PFLANG_TASK_H
+
+// Green threads behind the go statement.
+//
+// A task is a function call running on a stack of its own, switched in and
+// out in user space by a few instructions instead of the kernel. Tasks run
+// M:N on a pool of worker threads started by the first spawn. Each worker
+// keeps the tasks it spawns in a work-stealing deque; a worker out of work
+// takes tasks spawned from outside the pool, then steals the oldest task
+// of another worker, and sleeps when there is none.
+//
+// A stack reserves PFLANG_TASK_STACK bytes of address space (256k by
+// default, with a k or m suffix) above a guard page. Only the pages a task
+// touches are backed by memory, so the stack grows as it goes deeper and a
+// shallow task costs a page or two; tens of thousands of tasks fit in one
+// process. Stacks of finished tasks are reused. A stack never grows past
+// its reservation: a task that recurses deeper hits the guard page, and
+// the program stops with "stack overflow in task" and the line of its go
+// statement.
+//
+// A task that has started stays on its worker: compiled code may keep the
+// address of a thread-local variable in a register across a switch, so it
+// must resume on the same thread. Only tasks that have not started yet are
+// stolen.
+//
+// PFLANG_TASK_THREADS sets the number of workers (one per core by
+// default). Output printed by a task is flushed whenever it switches out,
+// so each task's lines stay in order.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+typedef void (*pf_task_entry)(void* arguments);
+
+// Run entry on a new task, passing it a copy of the size bytes at arguments
+void pf_task_spawn(pf_task_entry entry, const void* arguments, size_t size);
+// The same for a go statement at a .pf source line, which a stack overflow
+// in the task reports
+void pf_task_spawn_at(pf_task_entry entry, const void* arguments, size_t size, int line);
+
+// Let other tasks on this worker run; outside a task, let other threads run
+void pf_task_yield(void);
+
+// Wait until every task has finished; only allowed outside tasks
+void pf_task_wait(void);
+
+// Whether the caller runs on a task
+bool pf_task_in_task(void);
+
+// The number of workers, starting them if no task was spawned yet
+int pf_task_worker_count(void);
+
+// Stands for the calling task, or for the calling thread outside tasks; no
+// two tasks or threads alive at once share one
+const void* pf_task_identity(void);
+
+// Blocking a task or a thread until another one wakes it, for channels.
+// Prepare a parker, publish it where wakers will look, check once more
+// for what it waits on, then park. A task parks by switching out, leaving
+// its worker free for other tasks; a thread outside tasks waits on a
+// condition variable and lets collections go ahead meanwhile.
+//
+// The first pf_parker_unpark wins and passes its token on; later ones
+// return false. It may come at any time after prepare, even before park,
+// which then returns at once.
+typedef struct {
+    _Atomic int state;
+    _Atomic int token;              // -1 until woken
+    struct pf_task* task;           // NULL outside tasks
+    void* thread;                   // The waiting thread's condition variable outside tasks
+} pf_parker;
+
+void pf_parker_prepare(pf_parker* parker);
+void pf_parker_park(pf_parker* parker);
+bool pf_parker_unpark(pf_parker* parker, int token);
+
+// The token of the unpark that won, or -1 if none has yet
+static inline int pf_parker_token(pf_parker* parker) {
+    return atomic_load(&parker->token);
+}
+
+typedef struct {
+    uint64_t spawned;
+    uint64_t finished;
+    uint64_t stolen;            // Tasks a worker took from another's deque
+    uint64_t switches;          // Times a worker switched into a task
+    uint64_t parks;             // Times a task switched out to wait
+    int64_t most_alive;         // Largest number of unfinished tasks at once
+    int workers;                // 0 before the first spawn
+} pf_task_statistics;
+
+void pf_task_get_statistics(pf_task_statistics* statistics);
+
+#endif // PFLANG_TASK_H
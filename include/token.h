@@ -16,6 +16,9 @@ typedef enum {
     TOKEN_BREAK,        // 'break'
     TOKEN_CONTINUE,     // 'continue'
     TOKEN_OPTIONAL,     // 'optional'
+    TOKEN_GO,           // 'go'
+    TOKEN_SELECT,       // 'select'
+    TOKEN_PAR,          // 'par'
 
     // Types
     TOKEN_U8,
@@ -62,6 +65,8 @@ typedef enum {
     TOKEN_RIGHT_PAREN,   // )
     TOKEN_LEFT_BRACE,    // {
     TOKEN_RIGHT_BRACE,   // }
+    TOKEN_LEFT_BRACKET,  // [
+    TOKEN_RIGHT_BRACKET, // ]
     TOKEN_COMMA,         // ,
     TOKEN_DOT,           // .
     TOKEN_TUPLE_TYPE,
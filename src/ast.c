@@ -1,5 +1,8 @@
 #include "../include/ast.h"
 
+#include <ctype.h>
+#include <stdint.h>
+
 static AstNode* create_node(NodeType type) {
     AstNode* node = (AstNode*)malloc(sizeof(AstNode));
     if (node == NULL) {
@@ -7,6 +10,7 @@ static AstNode* create_node(NodeType type) {
         exit(1);
     }
     node->type = type;
+    node->line = 0;
     return node;
 }
 
@@ -92,7 +96,7 @@ void free_ast(AstNode* node) {
                 free_ast(node->value.function.parameters[i]);
             }
             free(node->value.function.parameters);
-            free(node->value.function.body);
+            free_ast(node->value.function.body);
             free(node->value.function.return_types);
             break;
         case NODE_VARIABLE:
@@ -126,14 +130,63 @@ void free_ast(AstNode* node) {
             for (int i = 0; i < node->value.if_stmt.then_branches_count; i++) {
                 free_ast(node->value.if_stmt.then_branches[i]);
             }
+            free(node->value.if_stmt.then_branches);
             free_ast(node->value.if_stmt.else_branch);
             break;
+        case NODE_FUNCTION_CALL:
+            free(node->value.function_call.name);
+            for (int i = 0; i < node->value.function_call.argument_count; i++) {
+                free_ast(node->value.function_call.arguments[i]);
+            }
+            free(node->value.function_call.arguments);
+            break;
+        case NODE_WHILE:
+            free_ast(node->value.while_stmt.condition);
+            free_ast(node->value.while_stmt.body);
+            break;
+        case NODE_FOR:
+            free(node->value.for_stmt.name);
+            free_ast(node->value.for_stmt.start);
+            free_ast(node->value.for_stmt.end);
+            free_ast(node->value.for_stmt.step);
+            free_ast(node->value.for_stmt.body);
+            break;
+        case NODE_ASSIGNMENT:
+            free(node->value.assignment.name);
+            free_ast(node->value.assignment.index);
+            free_ast(node->value.assignment.value);
+            break;
+        case NODE_INDEX:
+            free_ast(node->value.index.target);
+            free_ast(node->value.index.index);
+            break;
+        case NODE_GO:
+            free_ast(node->value.go_stmt.call);
+            break;
+        case NODE_SELECT:
+            for (int i = 0; i < node->value.select_stmt.case_count; i++) {
+                free_ast(node->value.select_stmt.cases[i]);
+                free_ast(node->value.select_stmt.bodies[i]);
+            }
+            free(node->value.select_stmt.cases);
+            free(node->value.select_stmt.bodies);
+            free_ast(node->value.select_stmt.else_branch);
+            break;
+        case NODE_DESTRUCTURE:
+            for (int i = 0; i < node->value.destructure.target_count; i++) {
+                free_ast(node->value.destructure.targets[i]);
+            }
+            free(node->value.destructure.targets);
+            free_ast(node->value.destructure.value);
+            break;
         case NODE_BLOCK:
             for (int i = 0; i < node->value.block.statement_count; i++) {
                 free_ast(node->value.block.statements[i]);
             }
             free(node->value.block.statements);
             break;
+        default:
+            break;
     }
 
     free(node);
@@ -163,8 +216,83 @@ static const char* token_type_to_operator_string(TokenType type) {
     }
 }
 
+bool is_integer_constant(AstNode* node) {
+    switch (node->type) {
+        case NODE_LITERAL:
+            return node->value.literal.type == TYPE_I32 && isdigit((unsigned char)node->value.literal.value[0]) &&
+                   strchr(node->value.literal.value, '.') == NULL;
+        case NODE_UNARY_OP:
+            return node->value.unary_op.operator == TOKEN_MINUS && is_integer_constant(node->value.unary_op.operand);
+        case NODE_BINARY_OP:
+            switch (node->value.binary_op.operator) {
+                case TOKEN_PLUS:
+                case TOKEN_MINUS:
+                case TOKEN_MULTIPLY:
+                case TOKEN_DIVIDE:
+                case TOKEN_MODULO:
+                    return is_integer_constant(node->value.binary_op.left) &&
+                           is_integer_constant(node->value.binary_op.right);
+                default:
+                    return false;
+            }
+        default:
+            return false;
+    }
+}
+
+DataType integer_literal_type(const char* text) {
+    unsigned long long value = strtoull(text, NULL, 10);
+    if (value <= INT32_MAX) return TYPE_I32;
+    if (value <= INT64_MAX) return TYPE_I64;
+    return TYPE_U64;
+}
+
+// i32 < i64 < u64; the only types integer_literal_type gives
+static DataType wider_constant_type(DataType a, DataType b) {
+    if (a == TYPE_U64 || b == TYPE_U64) return TYPE_U64;
+    if (a == TYPE_I64 || b == TYPE_I64) return TYPE_I64;
+    return TYPE_I32;
+}
+
+DataType integer_constant_type(AstNode* node) {
+    switch (node->type) {
+        case NODE_LITERAL:
+            return integer_literal_type(node->value.literal.value);
+        case NODE_UNARY_OP:
+            return integer_constant_type(node->value.unary_op.operand);
+        default:
+            return wider_constant_type(integer_constant_type(node->value.binary_op.left),
+                                       integer_constant_type(node->value.binary_op.right));
+    }
+}
+
+static int integer_type_bytes(DataType type) {
+    switch (type) {
+        case TYPE_U8: case TYPE_I8: return 1;
+        case TYPE_U16: case TYPE_I16: return 2;
+        case TYPE_U32: case TYPE_I32: return 4;
+        default: return 8;
+    }
+}
+
+DataType integer_constant_slot_type(AstNode* node, DataType slot) {
+    DataType own = integer_constant_type(node);
+    return integer_type_bytes(slot) >= integer_type_bytes(own) ? slot : own;
+}
+
 // Convert data type to string
-static const char* data_type_to_string(DataType type) {
+const char* data_type_to_string(DataType type) {
+    if (type != type_kind(type)) {
+        // Compound names are built once per type; the compiler is single-threaded
+        static char names[TYPE_CHAN + 1][TYPE_CHAN + 1][32];
+        char* name = names[type_kind(type)][type_element(type)];
+        if (name[0] == '\0') {
+            snprintf(name, sizeof(names[0][0]), "%s[%s]", data_type_to_string(type_kind(type)),
+                     data_type_to_string(type_element(type)));
+        }
+        return name;
+    }
+
     switch (type) {
         case TYPE_U8: return "u8";
         case TYPE_U16: return "u16";
@@ -184,6 +312,7 @@ static const char* data_type_to_string(DataType type) {
         case TYPE_ARRAY: return "array";
         case TYPE_LIST: return "list";
         case TYPE_MAP: return "map";
+        case TYPE_CHAN: return "chan";
         default: return "unknown";
     }
 }
@@ -305,6 +434,90 @@ void print_ast(AstNode* node, int indent_level) {
             }
             break;
 
+        case NODE_WHILE:
+            print_indent(indent_level);
+            printf("WHILE:\n");
+            print_indent(indent_level + 1);
+            printf("CONDITION:\n");
+            print_ast(node->value.while_stmt.condition, indent_level + 2);
+            print_indent(indent_level + 1);
+            printf("BODY:\n");
+            print_ast(node->value.while_stmt.body, indent_level + 2);
+            break;
+
+        case NODE_FOR:
+            print_indent(indent_level);
+            printf("%sFOR: %s (%s)\n", node->value.for_stmt.parallel ? "PAR " : "", node->value.for_stmt.name,
+                   data_type_to_string(node->value.for_stmt.type));
+            print_indent(indent_level + 1);
+            printf("START:\n");
+            print_ast(node->value.for_stmt.start, indent_level + 2);
+            print_indent(indent_level + 1);
+            printf("END:\n");
+            print_ast(node->value.for_stmt.end, indent_level + 2);
+            if (node->value.for_stmt.step != NULL) {
+                print_indent(indent_level + 1);
+                printf("STEP:\n");
+                print_ast(node->value.for_stmt.step, indent_level + 2);
+            }
+            print_indent(indent_level + 1);
+            printf("BODY:\n");
+            print_ast(node->value.for_stmt.body, indent_level + 2);
+            break;
+
+        case NODE_ASSIGNMENT:
+            print_indent(indent_level);
+            printf("ASSIGNMENT: %s\n", node->value.assignment.name);
+            if (node->value.assignment.index != NULL) {
+                print_indent(indent_level + 1);
+                printf("INDEX:\n");
+                print_ast(node->value.assignment.index, indent_level + 2);
+            }
+            print_ast(node->value.assignment.value, indent_level + 1);
+            break;
+
+        case NODE_INDEX:
+            print_indent(indent_level);
+            printf("INDEX:\n");
+            print_ast(node->value.index.target, indent_level + 1);
+            print_ast(node->value.index.index, indent_level + 1);
+            break;
+
+        case NODE_GO:
+            print_indent(indent_level);
+            printf("GO:\n");
+            print_ast(node->value.go_stmt.call, indent_level + 1);
+            break;
+
+        case NODE_SELECT:
+            print_indent(indent_level);
+            printf("SELECT:\n");
+            for (int i = 0; i < node->value.select_stmt.case_count; i++) {
+                print_indent(indent_level + 1);
+                printf("CASE:\n");
+                print_ast(node->value.select_stmt.cases[i], indent_level + 2);
+                print_indent(indent_level + 1);
+                printf("BODY:\n");
+                print_ast(node->value.select_stmt.bodies[i], indent_level + 2);
+            }
+            if (node->value.select_stmt.else_branch != NULL) {
+                print_indent(indent_level + 1);
+                printf("ELSE:\n");
+                print_ast(node->value.select_stmt.else_branch, indent_level + 2);
+            }
+            break;
+
+        case NODE_DESTRUCTURE:
+            print_indent(indent_level);
+            printf("DESTRUCTURE:\n");
+            for (int i = 0; i < node->value.destructure.target_count; i++) {
+                print_ast(node->value.destructure.targets[i], indent_level + 1);
+            }
+            print_indent(indent_level + 1);
+            printf("VALUE:\n");
+            print_ast(node->value.destructure.value, indent_level + 2);
+            break;
+
         case NODE_BLOCK:
             printf("BLOCK:\n");
             for (int i = 0; i < node->value.block.statement_count; i++) {
@@ -0,0 +1,71 @@
+#include "../include/builtins.h"
+
+static const Builtin builtins[] = {
+    {"find", "pf_string_find", TYPE_I64, 2, {TYPE_STR, TYPE_STR}},
+    {"count", "pf_string_count", TYPE_I64, 2, {TYPE_STR, TYPE_STR}},
+    {"starts_with", "pf_string_starts_with", TYPE_BOOL, 2, {TYPE_STR, TYPE_STR}},
+    {"ends_with", "pf_string_ends_with", TYPE_BOOL, 2, {TYPE_STR, TYPE_STR}},
+    {"split", "pf_string_split_list", COMPOUND_TYPE(TYPE_LIST, TYPE_STR), 2, {TYPE_STR, TYPE_STR}},
+    {"compare", "pf_string_compare", TYPE_I32, 2, {TYPE_STR, TYPE_STR}},
+    {"to_upper", "pf_string_to_upper", TYPE_STR, 1, {TYPE_STR}},
+    {"to_lower", "pf_string_to_lower", TYPE_STR, 1, {TYPE_STR}},
+    {"is_utf8", "pf_string_is_utf8", TYPE_BOOL, 1, {TYPE_STR}},
+    {"yield", "pf_task_yield", TYPE_NULL, 0, {0}},
+    {"wait", "pf_task_wait", TYPE_NULL, 0, {0}},
+    {"open_file", "pf_io_open_file", TYPE_I64, 2, {TYPE_STR, TYPE_STR}},
+    {"read", "pf_io_read_string", TYPE_STR, 2, {TYPE_I64, TYPE_I64}},
+    {"write", "pf_io_write_string", TYPE_I64, 2, {TYPE_I64, TYPE_STR}},
+    {"close_fd", "pf_io_close", TYPE_NULL, 1, {TYPE_I64}},
+    {"listen_tcp", "pf_io_listen_tcp", TYPE_I64, 1, {TYPE_I64}},
+    {"accept", "pf_io_accept", TYPE_I64, 1, {TYPE_I64}},
+    {"connect_tcp", "pf_io_connect_tcp", TYPE_I64, 2, {TYPE_STR, TYPE_I64}},
+    {"local_port", "pf_io_local_port", TYPE_I64, 1, {TYPE_I64}},
+    {"map_new", "pf_map_new", TYPE_I64, 0, {0}},
+    {"map_set", "pf_map_set", TYPE_NULL, 3, {TYPE_I64, TYPE_STR, TYPE_I64}},
+    {"map_get", "pf_map_get", TYPE_I64, 3, {TYPE_I64, TYPE_STR, TYPE_I64}},
+    {"map_has", "pf_map_has", TYPE_BOOL, 2, {TYPE_I64, TYPE_STR}},
+    {"map_remove", "pf_map_remove", TYPE_BOOL, 2, {TYPE_I64, TYPE_STR}},
+    {"map_count", "pf_map_count", TYPE_I64, 1, {TYPE_I64}},
+    {"map_free", "pf_map_free", TYPE_NULL, 1, {TYPE_I64}},
+};
+
+static const ArrayBuiltin array_builtins[] = {
+    {"sum", ARRAY_ARG_NONE, ARRAY_RESULT_TOTAL, false},
+    {"dot", ARRAY_ARG_ARRAY, ARRAY_RESULT_TOTAL, true},
+    {"min", ARRAY_ARG_NONE, ARRAY_RESULT_ELEMENT, true},
+    {"max", ARRAY_ARG_NONE, ARRAY_RESULT_ELEMENT, true},
+    {"scale", ARRAY_ARG_ELEMENT, ARRAY_RESULT_NULL, false},
+    {"mask_lt", ARRAY_ARG_ELEMENT, ARRAY_RESULT_MASK, true},
+    {"mask_gt", ARRAY_ARG_ELEMENT, ARRAY_RESULT_MASK, true},
+    {"mask_eq", ARRAY_ARG_ELEMENT, ARRAY_RESULT_MASK, true},
+};
+
+const Builtin* find_builtin(const char* name) {
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+        if (strcmp(builtins[i].name, name) == 0) return &builtins[i];
+    }
+    return NULL;
+}
+
+const ArrayBuiltin* find_array_builtin(const char* name) {
+    for (size_t i = 0; i < sizeof(array_builtins) / sizeof(array_builtins[0]); i++) {
+        if (strcmp(array_builtins[i].name, name) == 0) return &array_builtins[i];
+    }
+    return NULL;
+}
+
+DataType array_builtin_type(const ArrayBuiltin* builtin, DataType element) {
+    switch (builtin->result) {
+        case ARRAY_RESULT_TOTAL:
+            if (element <= TYPE_U64) return TYPE_U64;
+            if (element <= TYPE_I64) return TYPE_I64;
+            return element;
+        case ARRAY_RESULT_ELEMENT:
+            return element;
+        case ARRAY_RESULT_MASK:
+            return compound_type(TYPE_ARRAY, TYPE_BOOL);
+        case ARRAY_RESULT_NULL:
+            return TYPE_NULL;
+    }
+    return TYPE_NULL;
+}
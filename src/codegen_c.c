@@ -0,0 +1,3298 @@
+#include "../include/codegen_c.h"
+#include "../include/builtins.h"
+#include "../include/perf_map.h"
+#include "../include/runtime/pf_array.h"
+
+#include <ctype.h>
+
+#ifndef PFLANG_RUNTIME_INCLUDE_DIR
+#define PFLANG_RUNTIME_INCLUDE_DIR "include/runtime"
+#endif
+
+#ifndef PFLANG_RUNTIME_LIB_DIR
+#define PFLANG_RUNTIME_LIB_DIR "."
+#endif
+
+static void emit_expression(CodegenC* cg, AstNode* node);
+static void emit_statement(CodegenC* cg, AstNode* node, int indent);
+
+static void codegen_error(CodegenC* cg, AstNode* node, const char* message) {
+    cg->had_error = true;
+    fprintf(stderr, "[line %d] Error: %s\n", node != NULL ? node->line : 0, message);
+}
+
+static void emit_indent(CodegenC* cg, int indent) {
+    for (int i = 0; i < indent; i++) {
+        fputs("    ", cg->out);
+    }
+}
+
+// Write text as a C string literal, quotes included; paths and names may
+// hold any byte
+static void emit_c_string(FILE* out, const char* text) {
+    fputc('"', out);
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(out, "\\%c", *c);
+        } else if (*c < 0x20 || *c >= 0x7f) {
+            fprintf(out, "\\%03o", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Point C compiler diagnostics, debuggers and profilers back at the .pf source
+static void emit_line_directive(CodegenC* cg, AstNode* node) {
+    if (cg->source_file != NULL && node->line > 0) {
+        fprintf(cg->out, "#line %d ", node->line);
+        emit_c_string(cg->out, cg->source_file);
+        fputc('\n', cg->out);
+    }
+}
+
+// Suffix of the pf_array_* and pf_list_* functions for an element type
+static const char* element_suffix(DataType type) {
+    switch (type) {
+#define ELEMENT_SUFFIX_CASE(data_type, suffix, c_type) \
+        case data_type: return #suffix;
+        PF_ELEMENT_TYPES(ELEMENT_SUFFIX_CASE)
+#undef ELEMENT_SUFFIX_CASE
+        default: return NULL;
+    }
+}
+
+static const char* c_type_name(DataType type) {
+    if (is_sequence_type(type)) {
+        // An array is passed by value, a list through its pointer
+        static char names[TYPE_BOOL + 1][2][24];
+        const char* suffix = element_suffix(type_element(type));
+        if (suffix == NULL) return NULL;
+
+        bool is_list = type_kind(type) == TYPE_LIST;
+        char* name = names[type_element(type)][is_list];
+        snprintf(name, sizeof(names[0][0]), is_list ? "pf_list_%s*" : "pf_array_%s", suffix);
+        return name;
+    }
+    if (type_kind(type) == TYPE_CHAN) {
+        return element_suffix(type_element(type)) != NULL ? "pf_chan*" : NULL;
+    }
+
+    switch (type) {
+        case TYPE_U8: return "uint8_t";
+        case TYPE_U16: return "uint16_t";
+        case TYPE_U32: return "uint32_t";
+        case TYPE_U64: return "uint64_t";
+        case TYPE_I8: return "int8_t";
+        case TYPE_I16: return "int16_t";
+        case TYPE_I32: return "int32_t";
+        case TYPE_I64: return "int64_t";
+        case TYPE_F32: return "float";
+        case TYPE_F64: return "double";
+        case TYPE_STR: return "pf_string";
+        case TYPE_BOOL: return "bool";
+        case TYPE_NULL: return "void";
+        case TYPE_ERROR: return "pf_error";
+        default: return NULL;
+    }
+}
+
+static bool is_signed_type(DataType type) {
+    return type == TYPE_I8 || type == TYPE_I16 || type == TYPE_I32 || type == TYPE_I64;
+}
+
+static bool is_unsigned_type(DataType type) {
+    return type == TYPE_U8 || type == TYPE_U16 || type == TYPE_U32 || type == TYPE_U64;
+}
+
+static bool is_float_type(DataType type) {
+    return type == TYPE_F32 || type == TYPE_F64;
+}
+
+// The parser represents variable references as I32 literals holding the name
+static bool is_identifier(AstNode* node) {
+    if (node == NULL || node->type != NODE_LITERAL) return false;
+    if (node->value.literal.type == TYPE_STR || node->value.literal.type == TYPE_NULL) return false;
+    char c = node->value.literal.value[0];
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_null_literal(AstNode* node) {
+    return node != NULL && node->type == NODE_LITERAL && node->value.literal.type == TYPE_NULL;
+}
+
+static bool is_number_literal(AstNode* node) {
+    return node != NULL && node->type == NODE_LITERAL && node->value.literal.type == TYPE_I32 &&
+           !is_identifier(node);
+}
+
+static bool is_string_literal(AstNode* node) {
+    return node != NULL && node->type == NODE_LITERAL && node->value.literal.type == TYPE_STR;
+}
+
+// "format" % value
+static bool is_format_expression(AstNode* node) {
+    return node != NULL && node->type == NODE_BINARY_OP &&
+           node->value.binary_op.operator == TOKEN_MODULO &&
+           is_string_literal(node->value.binary_op.left);
+}
+
+// String literals used as values are interned once while the program
+// loads; identical literals share one slot
+static int literal_slot(CodegenC* cg, const char* lexeme) {
+    for (int i = 0; i < cg->literal_count; i++) {
+        if (strcmp(cg->literals[i], lexeme) == 0) return i;
+    }
+    if (cg->literal_count == cg->literal_capacity) {
+        cg->literal_capacity = cg->literal_capacity == 0 ? 8 : cg->literal_capacity * 2;
+        cg->literals = realloc(cg->literals, sizeof(const char*) * cg->literal_capacity);
+    }
+    cg->literals[cg->literal_count] = lexeme;
+    return cg->literal_count++;
+}
+
+static void add_local(CodegenC* cg, const char* name, DataType type) {
+    if (cg->local_count == cg->local_capacity) {
+        cg->local_capacity = cg->local_capacity == 0 ? 8 : cg->local_capacity * 2;
+        cg->locals = realloc(cg->locals, sizeof(CodegenLocal) * cg->local_capacity);
+    }
+    cg->locals[cg->local_count].name = name;
+    cg->locals[cg->local_count].type = type;
+    cg->local_count++;
+}
+
+static CodegenLocal* find_local(CodegenC* cg, const char* name) {
+    for (int i = cg->local_count - 1; i >= 0; i--) {
+        if (strcmp(cg->locals[i].name, name) == 0) return &cg->locals[i];
+    }
+    return NULL;
+}
+
+static AstNode* find_function(CodegenC* cg, const char* name) {
+    for (int i = 0; i < cg->program->value.block.statement_count; i++) {
+        AstNode* function = cg->program->value.block.statements[i];
+        if (strcmp(function->value.function.name, name) == 0) return function;
+    }
+    return NULL;
+}
+
+// Whether visit holds for some child of node, statement or expression
+static bool any_child(AstNode* node, bool (*visit)(AstNode* child, void* data), void* data) {
+    if (node == NULL) return false;
+    AstNode* children[4] = {NULL, NULL, NULL, NULL};
+    AstNode** list = NULL;
+    int count = 0;
+    switch (node->type) {
+        case NODE_FUNCTION:
+            children[0] = node->value.function.body;
+            break;
+        case NODE_BLOCK:
+            list = node->value.block.statements;
+            count = node->value.block.statement_count;
+            break;
+        case NODE_RETURN:
+            children[0] = node->value.return_stmt.return_value;
+            break;
+        case NODE_IF:
+            children[0] = node->value.if_stmt.condition;
+            children[1] = node->value.if_stmt.else_branch;
+            list = node->value.if_stmt.then_branches;
+            count = node->value.if_stmt.then_branches_count;
+            break;
+        case NODE_WHILE:
+            children[0] = node->value.while_stmt.condition;
+            children[1] = node->value.while_stmt.body;
+            break;
+        case NODE_FOR:
+            children[0] = node->value.for_stmt.start;
+            children[1] = node->value.for_stmt.end;
+            children[2] = node->value.for_stmt.step;
+            children[3] = node->value.for_stmt.body;
+            break;
+        case NODE_BINARY_OP:
+            children[0] = node->value.binary_op.left;
+            children[1] = node->value.binary_op.right;
+            break;
+        case NODE_UNARY_OP:
+            children[0] = node->value.unary_op.operand;
+            break;
+        case NODE_VARIABLE:
+            children[0] = node->value.variable.init_value;
+            break;
+        case NODE_TUPLE:
+            list = node->value.tuple.values;
+            count = node->value.tuple.value_count;
+            break;
+        case NODE_FUNCTION_CALL:
+            list = node->value.function_call.arguments;
+            count = node->value.function_call.argument_count;
+            break;
+        case NODE_ASSIGNMENT:
+            children[0] = node->value.assignment.index;
+            children[1] = node->value.assignment.value;
+            break;
+        case NODE_DESTRUCTURE:
+            children[0] = node->value.destructure.value;
+            break;
+        case NODE_INDEX:
+            children[0] = node->value.index.target;
+            children[1] = node->value.index.index;
+            break;
+        case NODE_GO:
+            children[0] = node->value.go_stmt.call;
+            break;
+        case NODE_SELECT:
+            for (int i = 0; i < node->value.select_stmt.case_count; i++) {
+                if (visit(node->value.select_stmt.cases[i], data) || visit(node->value.select_stmt.bodies[i], data)) {
+                    return true;
+                }
+            }
+            children[0] = node->value.select_stmt.else_branch;
+            break;
+        default:
+            break;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (children[i] != NULL && visit(children[i], data)) return true;
+    }
+    for (int i = 0; i < count; i++) {
+        if (visit(list[i], data)) return true;
+    }
+    return false;
+}
+
+static bool returns_tuple(AstNode* function) {
+    return function->value.function.return_type_count > 1;
+}
+
+// array, list, len, append and slice work on every element type, and chan,
+// send, recv and close on every channel, so they are not in the builtin
+// table; a program's own functions shadow them too
+static bool is_sequence_call(CodegenC* cg, AstNode* node, const char* name) {
+    return node != NULL && node->type == NODE_FUNCTION_CALL && strcmp(node->value.function_call.name, name) == 0 &&
+           find_function(cg, name) == NULL;
+}
+
+static DataType infer_type(CodegenC* cg, AstNode* node) {
+    switch (node->type) {
+        case NODE_LITERAL:
+            if (is_identifier(node)) {
+                CodegenLocal* local = find_local(cg, node->value.literal.value);
+                return local != NULL ? local->type : TYPE_I32;
+            }
+            if (node->value.literal.type == TYPE_I32 && strchr(node->value.literal.value, '.') != NULL) {
+                return TYPE_F64;
+            }
+            if (node->value.literal.type == TYPE_I32) {
+                return cg->constant_type != TYPE_NULL ? cg->constant_type : integer_literal_type(node->value.literal.value);
+            }
+            return node->value.literal.type;
+
+        case NODE_BINARY_OP: {
+            switch (node->value.binary_op.operator) {
+                case TOKEN_EQUALS:
+                case TOKEN_NOT_EQUAL:
+                case TOKEN_LESS:
+                case TOKEN_LESS_EQUAL:
+                case TOKEN_GREATER:
+                case TOKEN_GREATER_EQUAL:
+                case TOKEN_AND:
+                case TOKEN_OR:
+                    return TYPE_BOOL;
+                default:
+                    break;
+            }
+            if (is_format_expression(node)) return TYPE_STR;
+            if (is_integer_constant(node)) {
+                return cg->constant_type != TYPE_NULL ? cg->constant_type : integer_constant_type(node);
+            }
+
+            DataType left = infer_type(cg, node->value.binary_op.left);
+            DataType right = infer_type(cg, node->value.binary_op.right);
+            if (left == TYPE_F64 || right == TYPE_F64) return TYPE_F64;
+            if (left == TYPE_F32 || right == TYPE_F32) return TYPE_F32;
+            // An integer constant takes the width of the other operand
+            if (is_integer_constant(node->value.binary_op.left)) return right;
+            return left;
+        }
+
+        case NODE_UNARY_OP:
+            return infer_type(cg, node->value.unary_op.operand);
+
+        case NODE_INDEX: {
+            DataType type = infer_type(cg, node->value.index.target);
+            return is_sequence_type(type) ? type_element(type) : TYPE_NULL;
+        }
+
+        case NODE_FUNCTION_CALL: {
+            const char* name = node->value.function_call.name;
+            if (strcmp(name, "error") == 0) return TYPE_ERROR;
+            if (strcmp(name, "print") == 0) return TYPE_NULL;
+
+            AstNode* function = find_function(cg, name);
+            if (function == NULL) {
+                // Constructors have the bare kind until emit_value sees the
+                // declared type
+                if (strcmp(name, "array") == 0) return TYPE_ARRAY;
+                if (strcmp(name, "list") == 0) return TYPE_LIST;
+                if (strcmp(name, "len") == 0) return TYPE_I64;
+                if (strcmp(name, "append") == 0) return TYPE_NULL;
+                if (strcmp(name, "chan") == 0) return TYPE_CHAN;
+                if (strcmp(name, "send") == 0 || strcmp(name, "close") == 0) return TYPE_NULL;
+                if (strcmp(name, "recv") == 0 && node->value.function_call.argument_count > 0) {
+                    DataType type = infer_type(cg, node->value.function_call.arguments[0]);
+                    return type_kind(type) == TYPE_CHAN ? type_element(type) : TYPE_NULL;
+                }
+                if (strcmp(name, "slice") == 0 && node->value.function_call.argument_count > 0) {
+                    DataType type = infer_type(cg, node->value.function_call.arguments[0]);
+                    return is_sequence_type(type) ? compound_type(TYPE_ARRAY, type_element(type)) : TYPE_NULL;
+                }
+                if (strcmp(name, "par_reduce") == 0 && node->value.function_call.argument_count > 0) {
+                    DataType type = infer_type(cg, node->value.function_call.arguments[0]);
+                    return is_sequence_type(type) ? type_element(type) : TYPE_NULL;
+                }
+                if (strcmp(name, "par_map") == 0 && node->value.function_call.argument_count > 1) {
+                    AstNode* mapped = node->value.function_call.arguments[1];
+                    AstNode* function = is_identifier(mapped) ? find_function(cg, mapped->value.literal.value) : NULL;
+                    return function != NULL && !returns_tuple(function)
+                               ? compound_type(TYPE_ARRAY, function->value.function.return_types[0]) : TYPE_NULL;
+                }
+                const ArrayBuiltin* array_builtin = find_array_builtin(name);
+                if (array_builtin != NULL && node->value.function_call.argument_count > 0) {
+                    DataType type = infer_type(cg, node->value.function_call.arguments[0]);
+                    return is_sequence_type(type) ? array_builtin_type(array_builtin, type_element(type)) : TYPE_NULL;
+                }
+
+                const Builtin* builtin = find_builtin(name);
+                return builtin != NULL ? builtin->return_type : TYPE_I32;
+            }
+            return returns_tuple(function) ? TYPE_TUPLE : function->value.function.return_types[0];
+        }
+
+        default:
+            return TYPE_NULL;
+    }
+}
+
+static const char* c_operator(TokenType operator) {
+    switch (operator) {
+        case TOKEN_PLUS: return "+";
+        case TOKEN_MINUS: return "-";
+        case TOKEN_MULTIPLY: return "*";
+        case TOKEN_DIVIDE: return "/";
+        case TOKEN_MODULO: return "%";
+        case TOKEN_EQUALS: return "==";
+        case TOKEN_NOT_EQUAL: return "!=";
+        case TOKEN_LESS: return "<";
+        case TOKEN_LESS_EQUAL: return "<=";
+        case TOKEN_GREATER: return ">";
+        case TOKEN_GREATER_EQUAL: return ">=";
+        case TOKEN_AND: return "&&";
+        case TOKEN_OR: return "||";
+        case TOKEN_INCREMENT: return "++";
+        case TOKEN_DECREMENT: return "--";
+        default: return NULL;
+    }
+}
+
+static void emit_constructor(CodegenC* cg, AstNode* node, DataType expected);
+static void emit_chan_constructor(CodegenC* cg, AstNode* node, DataType expected);
+
+// Emit a value where a specific type is expected, so null can become a
+// zero of that type and array(), list() or chan() knows its element type
+static void emit_value(CodegenC* cg, AstNode* node, DataType expected) {
+    if (is_sequence_call(cg, node, "array") || is_sequence_call(cg, node, "list")) {
+        emit_constructor(cg, node, expected);
+        return;
+    }
+    if (is_sequence_call(cg, node, "chan")) {
+        emit_chan_constructor(cg, node, expected);
+        return;
+    }
+    if (is_null_literal(node)) {
+        if (expected == TYPE_ERROR) {
+            fputs("PF_NO_ERROR", cg->out);
+        } else if (expected == TYPE_STR) {
+            fputs("PF_STRING_EMPTY", cg->out);
+        } else {
+            fputs("0", cg->out);
+        }
+        return;
+    }
+    // An integer constant is computed at the slot's width, or its literals'
+    // if wider, so i64 v = 5000000000 + 1 does not wrap at i32
+    if ((is_signed_type(expected) || is_unsigned_type(expected)) && is_integer_constant(node)) {
+        cg->constant_type = integer_constant_slot_type(node, expected);
+        emit_expression(cg, node);
+        cg->constant_type = TYPE_NULL;
+        return;
+    }
+    emit_expression(cg, node);
+}
+
+// The pf_fmt_* appender for a conversion letter and argument type, or NULL
+// if they do not match. %f and %e, and %g given a precision, take the
+// precision as a further argument.
+static const char* format_appender(char conversion, DataType type, bool has_precision) {
+    switch (conversion) {
+        case 'd':
+        case 'i':
+        case 'u':
+            if (is_signed_type(type)) return "pf_fmt_int";
+            if (is_unsigned_type(type)) return "pf_fmt_uint";
+            return NULL;
+        case 'f':
+            return is_float_type(type) ? "pf_fmt_fixed" : NULL;
+        case 'e':
+            return is_float_type(type) ? "pf_fmt_exponent" : NULL;
+        case 'g':
+            if (!is_float_type(type)) return NULL;
+            return has_precision ? "pf_fmt_general" : "pf_fmt_float";
+        case 's':
+            if (type == TYPE_STR) return "pf_fmt_string";
+            if (type == TYPE_BOOL) return "pf_fmt_bool";
+            if (type == TYPE_ERROR) return "pf_fmt_error";
+            return NULL;
+        default:
+            return NULL;
+    }
+}
+
+// "format" % first, rest...: docs.md passes additional values as further
+// arguments of the enclosing call. The literal format is split into chunks
+// and conversions here, checked against the value types, and compiled into
+// a helper of straight-line appends, so nothing parses it at run time.
+static void emit_format(CodegenC* cg, AstNode* format, AstNode** rest, int rest_count) {
+    int count = rest_count + 1;
+    AstNode** values = malloc(sizeof(AstNode*) * count);
+    values[0] = format->value.binary_op.right;
+    for (int i = 0; i < rest_count; i++) {
+        values[i + 1] = rest[i];
+    }
+
+    int helper = cg->format_count++;
+    FILE* out = cg->helpers;
+    fprintf(out, "static pf_str pf_format_%d(", helper);
+    for (int i = 0; i < count; i++) {
+        const char* c_type = c_type_name(infer_type(cg, values[i]));
+        fprintf(out, "%s%s a%d", i > 0 ? ", " : "", c_type != NULL ? c_type : "int", i);
+    }
+    fputs(") {\n    pf_fmt out = pf_fmt_begin();\n", out);
+
+    // The literal keeps its quotes and escapes; chunks are emitted verbatim
+    const char* text = format->value.binary_op.left->value.literal.value + 1;
+    size_t length = strlen(text) - 1;
+    size_t chunk = 0;
+    int arg = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '\\') {
+            i++;
+            continue;
+        }
+        if (text[i] != '%') continue;
+
+        if (i > chunk) {
+            fprintf(out, "    PF_FMT_LITERAL(&out, \"%.*s\");\n", (int)(i - chunk), text + chunk);
+        }
+        // An optional precision of up to two digits: %.2f
+        size_t next = i + 1;
+        int precision = -1;
+        if (next < length && text[next] == '.') {
+            precision = 0;
+            for (next++; next < length && next < i + 4 && isdigit((unsigned char)text[next]); next++) {
+                precision = precision * 10 + (text[next] - '0');
+            }
+        }
+        char conversion = next < length ? text[next] : '\0';
+        i = next;
+        chunk = i + 1;
+
+        if (conversion == '%') {
+            fputs("    PF_FMT_LITERAL(&out, \"%\");\n", out);
+            continue;
+        }
+        if (arg == count) {
+            codegen_error(cg, format, "Format string has more conversions than values");
+            break;
+        }
+
+        if (precision >= 0 && conversion != 'f' && conversion != 'e' && conversion != 'g') {
+            codegen_error(cg, format, "Only %f, %e and %g take a precision of up to two digits");
+            break;
+        }
+        DataType type = infer_type(cg, values[arg]);
+        const char* appender = format_appender(conversion, type, precision >= 0);
+        if (appender == NULL) {
+            char message[128];
+            snprintf(message, sizeof(message), "Format conversion '%%%c' does not take a %s value", conversion,
+                     data_type_to_string(type));
+            codegen_error(cg, values[arg], message);
+            break;
+        }
+        if (conversion == 'f' || conversion == 'e' || precision >= 0) {
+            fprintf(out, "    %s(&out, a%d, %d);\n", appender, arg, precision >= 0 ? precision : 6);
+        } else {
+            fprintf(out, "    %s(&out, a%d);\n", appender, arg);
+        }
+        arg++;
+    }
+    if (chunk < length) {
+        fprintf(out, "    PF_FMT_LITERAL(&out, \"%.*s\");\n", (int)(length - chunk), text + chunk);
+    }
+    if (arg < count && !cg->had_error) {
+        codegen_error(cg, format, "Format string has fewer conversions than values");
+    }
+    fputs("    return pf_fmt_end(&out);\n}\n\n", out);
+
+    fprintf(cg->out, "pf_format_%d(", helper);
+    for (int i = 0; i < count; i++) {
+        if (i > 0) fputs(", ", cg->out);
+        emit_expression(cg, values[i]);
+    }
+    fputs(")", cg->out);
+    free(values);
+}
+
+static void emit_print(CodegenC* cg, AstNode* node) {
+    AstNode** arguments = node->value.function_call.arguments;
+    int count = node->value.function_call.argument_count;
+
+    if (count > 0 && is_format_expression(arguments[0])) {
+        fputs("pf_print_str(", cg->out);
+        emit_format(cg, arguments[0], arguments + 1, count - 1);
+        fputs(")", cg->out);
+        return;
+    }
+
+    fputs("(", cg->out);
+    for (int i = 0; i < count; i++) {
+        DataType type = infer_type(cg, arguments[i]);
+        const char* printer;
+        if (is_signed_type(type)) {
+            printer = "pf_print_int";
+        } else if (is_unsigned_type(type)) {
+            printer = "pf_print_uint";
+        } else if (is_float_type(type)) {
+            printer = "pf_print_float";
+        } else if (type == TYPE_STR) {
+            printer = "pf_print_string";
+        } else if (type == TYPE_BOOL) {
+            printer = "pf_print_bool";
+        } else if (type == TYPE_ERROR) {
+            printer = "pf_print_error";
+        } else {
+            codegen_error(cg, arguments[i], "Value cannot be printed");
+            return;
+        }
+
+        if (i > 0) fputs(", ", cg->out);
+        fprintf(cg->out, "%s(", printer);
+        emit_expression(cg, arguments[i]);
+        fputs(")", cg->out);
+    }
+    fputs(")", cg->out);
+}
+
+static void emit_error_call(CodegenC* cg, AstNode* node) {
+    AstNode** arguments = node->value.function_call.arguments;
+    int count = node->value.function_call.argument_count;
+
+    if (count == 0) {
+        codegen_error(cg, node, "error() needs a message");
+        return;
+    }
+
+    // A literal message stays a C string literal; any other str is copied
+    if (is_string_literal(arguments[0])) {
+        fprintf(cg->out, "pf_error_new(%s)", arguments[0]->value.literal.value);
+        return;
+    }
+    if (!is_format_expression(arguments[0]) && infer_type(cg, arguments[0]) == TYPE_STR) {
+        fputs("pf_error_from_string(", cg->out);
+        emit_expression(cg, arguments[0]);
+        fputs(")", cg->out);
+        return;
+    }
+
+    fputs("pf_error_copy(", cg->out);
+    if (is_format_expression(arguments[0])) {
+        emit_format(cg, arguments[0], arguments + 1, count - 1);
+    } else {
+        emit_expression(cg, arguments[0]);
+    }
+    fputs(")", cg->out);
+}
+
+static void emit_builtin_call(CodegenC* cg, AstNode* node, const Builtin* builtin) {
+    AstNode** arguments = node->value.function_call.arguments;
+    if (node->value.function_call.argument_count != builtin->param_count) {
+        codegen_error(cg, node, "Wrong number of arguments");
+        return;
+    }
+
+    fprintf(cg->out, "%s(", builtin->runtime_name);
+    for (int i = 0; i < builtin->param_count; i++) {
+        // Integers of any width convert as C converts them
+        DataType type = infer_type(cg, arguments[i]);
+        DataType expected = builtin->param_types[i];
+        bool integers = (is_signed_type(type) || is_unsigned_type(type)) &&
+                        (is_signed_type(expected) || is_unsigned_type(expected));
+        if (type != expected && !integers) {
+            char message[128];
+            snprintf(message, sizeof(message), "Argument %d of %s() must be a %s", i + 1, builtin->name,
+                     data_type_to_string(builtin->param_types[i]));
+            codegen_error(cg, arguments[i], message);
+            return;
+        }
+        if (i > 0) fputs(", ", cg->out);
+        emit_expression(cg, arguments[i]);
+    }
+    fputs(")", cg->out);
+}
+
+static bool is_integer_expression(CodegenC* cg, AstNode* node) {
+    DataType type = infer_type(cg, node);
+    return is_signed_type(type) || is_unsigned_type(type);
+}
+
+// Where the array() or list() call source of the function being emitted
+// gets its memory, with its index in cg->allocations in *slot. Members of a
+// merged tail-call group share one C frame and re-enter it without
+// returning, and a function jumping back to its own top would reuse its
+// frame slots and grow its region on every jump, so their allocations stay
+// on the heap. The body of a par for runs outside its function's frame, on
+// many threads at once, so its allocations stay on the heap as well.
+static int function_index(CodegenC* cg, AstNode* function);
+
+static IrPlacement allocation_placement(CodegenC* cg, const AstNode* source, int* slot) {
+    int index = function_index(cg, cg->function);
+    for (int i = 0; i < cg->allocation_count; i++) {
+        if (cg->allocations[i].source != source) continue;
+        *slot = i;
+        IrPlacement placement = cg->allocations[i].placement;
+        if (cg->parallel || (index >= 0 && (cg->tail_groups[index] >= 0 || cg->tail_loops[index]))) {
+            return IR_PLACE_HEAP;
+        }
+        return placement;
+    }
+    return IR_PLACE_HEAP;
+}
+
+// array(length) and list() / list(capacity) take their element type from
+// the declaration, parameter or return value they initialize
+static void emit_constructor(CodegenC* cg, AstNode* node, DataType expected) {
+    bool is_array = strcmp(node->value.function_call.name, "array") == 0;
+    DataType kind = is_array ? TYPE_ARRAY : TYPE_LIST;
+    int count = node->value.function_call.argument_count;
+    AstNode* size = count > 0 ? node->value.function_call.arguments[0] : NULL;
+
+    if (!is_sequence_type(expected) || type_kind(expected) != kind) {
+        codegen_error(cg, node, is_array ? "array() must initialize an array[T]" : "list() must initialize a list[T]");
+        return;
+    }
+    if (is_array ? count != 1 : count > 1) {
+        codegen_error(cg, node, "Wrong number of arguments");
+        return;
+    }
+    if (size != NULL && !is_integer_expression(cg, size)) {
+        codegen_error(cg, size, "Length must be an integer");
+        return;
+    }
+
+    const char* suffix = element_suffix(type_element(expected));
+    int slot;
+    IrPlacement placement = allocation_placement(cg, node, &slot);
+    if (placement == IR_PLACE_FRAME) {
+        fprintf(cg->out, "pf_array_%s_on_frame(pf_frame_%d, %lld)", suffix, slot,
+                (long long)cg->allocations[slot].length);
+        return;
+    }
+
+    fprintf(cg->out, "pf_%s_%s_new%s", is_array ? "array" : "list", suffix,
+            placement == IR_PLACE_REGION ? "_in(&pf_region, " : "(");
+    if (size != NULL) {
+        emit_expression(cg, size);
+    } else {
+        fputs("0", cg->out);
+    }
+    fprintf(cg->out, ", %d)", node->line);
+}
+
+// Whether the access lowered from source needs no check here: the IR
+// proved it in bounds, or it sits in the unchecked copy of a for loop
+// whose whole range was checked up front
+static bool access_unchecked(CodegenC* cg, const AstNode* source) {
+    for (int i = 0; i < cg->bounds_count; i++) {
+        if (cg->bounds[i].source == source) {
+            return cg->bounds[i].loop == NULL || cg->bounds_active[i];
+        }
+    }
+    return false;
+}
+
+// Pointer to element index of a sequence given either as an expression or
+// as a variable name, for the access lowered from source; accesses are
+// bounds checked unless access_unchecked says otherwise
+static void emit_element_pointer(CodegenC* cg, AstNode* target, const char* name, AstNode* index,
+                                 const AstNode* source) {
+    DataType type;
+    if (target != NULL) {
+        type = infer_type(cg, target);
+    } else {
+        CodegenLocal* local = find_local(cg, name);
+        type = local != NULL ? local->type : TYPE_NULL;
+    }
+
+    if (!is_sequence_type(type)) {
+        codegen_error(cg, index, "Only arrays and lists can be indexed");
+        return;
+    }
+    if (!is_integer_expression(cg, index)) {
+        codegen_error(cg, index, "Index must be an integer");
+        return;
+    }
+
+    bool unchecked = access_unchecked(cg, source);
+    if (unchecked) {
+        fputs("((", cg->out);
+    } else {
+        fprintf(cg->out, "pf_%s_%s_at(", type_kind(type) == TYPE_ARRAY ? "array" : "list",
+                element_suffix(type_element(type)));
+    }
+    if (target != NULL) {
+        emit_expression(cg, target);
+    } else {
+        fputs(name, cg->out);
+    }
+    if (unchecked) {
+        fprintf(cg->out, ")%sdata + (", type_kind(type) == TYPE_ARRAY ? "." : "->");
+        emit_expression(cg, index);
+        fputs("))", cg->out);
+        return;
+    }
+    fputs(", ", cg->out);
+    emit_expression(cg, index);
+    fprintf(cg->out, ", %d)", source->line);
+}
+
+// A sequence where the runtime wants an array: lists pass a view
+static void emit_as_array(CodegenC* cg, AstNode* node, DataType type) {
+    if (type_kind(type) == TYPE_LIST) {
+        fprintf(cg->out, "pf_list_%s_view(", element_suffix(type_element(type)));
+        emit_expression(cg, node);
+        fputs(")", cg->out);
+    } else {
+        emit_expression(cg, node);
+    }
+}
+
+// sum(xs), dot(xs, ys), scale(xs, factor), ... call the runtime function
+// for the element type, which loops over the elements itself
+static void emit_array_builtin(CodegenC* cg, AstNode* node, const ArrayBuiltin* builtin) {
+    AstNode** arguments = node->value.function_call.arguments;
+    if (node->value.function_call.argument_count != (builtin->second == ARRAY_ARG_NONE ? 1 : 2)) {
+        codegen_error(cg, node, "Wrong number of arguments");
+        return;
+    }
+
+    DataType type = infer_type(cg, arguments[0]);
+    if (!is_sequence_type(type) || type_element(type) > TYPE_F64) {
+        codegen_error(cg, arguments[0], "Argument 1 must be an array or list of numbers");
+        return;
+    }
+    DataType element = type_element(type);
+
+    fprintf(cg->out, "pf_%s_%s(", builtin->name, element_suffix(element));
+    emit_as_array(cg, arguments[0], type);
+    if (builtin->second == ARRAY_ARG_ARRAY) {
+        DataType other = infer_type(cg, arguments[1]);
+        if (!is_sequence_type(other) || type_element(other) != element) {
+            codegen_error(cg, arguments[1], "Argument 2 must have the element type of argument 1");
+            return;
+        }
+        fputs(", ", cg->out);
+        emit_as_array(cg, arguments[1], other);
+    } else if (builtin->second == ARRAY_ARG_ELEMENT) {
+        DataType value = infer_type(cg, arguments[1]);
+        if (value > TYPE_F64) {
+            codegen_error(cg, arguments[1], "Argument 2 must be a number");
+            return;
+        }
+        fputs(", ", cg->out);
+        emit_value(cg, arguments[1], element);
+    }
+    if (builtin->takes_line) {
+        fprintf(cg->out, ", %d", node->line);
+    }
+    fputs(")", cg->out);
+}
+
+// len(sequence), append(list, value) and slice(sequence, start, end)
+static void emit_sequence_call(CodegenC* cg, AstNode* node) {
+    const char* name = node->value.function_call.name;
+    AstNode** arguments = node->value.function_call.arguments;
+    int count = node->value.function_call.argument_count;
+    int expected_count = strcmp(name, "len") == 0 ? 1 : strcmp(name, "append") == 0 ? 2 : 3;
+
+    if (count != expected_count) {
+        codegen_error(cg, node, "Wrong number of arguments");
+        return;
+    }
+    DataType type = infer_type(cg, arguments[0]);
+    if (!is_sequence_type(type)) {
+        codegen_error(cg, arguments[0], "Argument 1 must be an array or a list");
+        return;
+    }
+    bool is_list = type_kind(type) == TYPE_LIST;
+    DataType element = type_element(type);
+    const char* suffix = element_suffix(element);
+
+    if (strcmp(name, "len") == 0) {
+        fputs("(", cg->out);
+        emit_expression(cg, arguments[0]);
+        fputs(is_list ? ")->length" : ").length", cg->out);
+        return;
+    }
+
+    if (strcmp(name, "append") == 0) {
+        if (!is_list) {
+            codegen_error(cg, arguments[0], "Only lists can grow");
+            return;
+        }
+        if ((infer_type(cg, arguments[1]) == TYPE_STR) != (element == TYPE_STR)) {
+            codegen_error(cg, arguments[1], "Value does not match the element type");
+            return;
+        }
+        fprintf(cg->out, "pf_list_%s_append(", suffix);
+        emit_expression(cg, arguments[0]);
+        fputs(", ", cg->out);
+        emit_value(cg, arguments[1], element);
+        fputs(")", cg->out);
+        return;
+    }
+
+    if (!is_integer_expression(cg, arguments[1]) || !is_integer_expression(cg, arguments[2])) {
+        codegen_error(cg, node, "Slice bounds must be integers");
+        return;
+    }
+    fprintf(cg->out, "pf_array_%s_slice(", suffix);
+    emit_as_array(cg, arguments[0], type);
+    fputs(", ", cg->out);
+    emit_expression(cg, arguments[1]);
+    fputs(", ", cg->out);
+    emit_expression(cg, arguments[2]);
+    fprintf(cg->out, ", %d)", node->line);
+}
+
+// chan() is unbounded and chan(capacity) holds that many values before
+// senders wait; the element type comes from what it initializes
+static void emit_chan_constructor(CodegenC* cg, AstNode* node, DataType expected) {
+    int count = node->value.function_call.argument_count;
+    if (type_kind(expected) != TYPE_CHAN || expected == TYPE_CHAN) {
+        codegen_error(cg, node, "chan() must initialize a chan[T]");
+        return;
+    }
+    if (count > 1) {
+        codegen_error(cg, node, "Wrong number of arguments");
+        return;
+    }
+    AstNode* capacity = count == 1 ? node->value.function_call.arguments[0] : NULL;
+    if (capacity != NULL && !is_integer_expression(cg, capacity)) {
+        codegen_error(cg, capacity, "Capacity must be an integer");
+        return;
+    }
+
+    fprintf(cg->out, "pf_chan_%s_new(", element_suffix(type_element(expected)));
+    if (capacity != NULL) {
+        emit_expression(cg, capacity);
+    } else {
+        fputs("PF_CHAN_UNBOUNDED", cg->out);
+    }
+    fprintf(cg->out, ", %d)", node->line);
+}
+
+// The element type of the channel argument of send, recv or close, or
+// TYPE_NULL after reporting that it is not a channel
+static DataType chan_element(CodegenC* cg, AstNode* argument) {
+    DataType type = infer_type(cg, argument);
+    if (type_kind(type) != TYPE_CHAN || type == TYPE_CHAN) {
+        codegen_error(cg, argument, "Argument 1 must be a channel");
+        return TYPE_NULL;
+    }
+    return type_element(type);
+}
+
+// send(c, value), recv(c) and close(c)
+static void emit_chan_call(CodegenC* cg, AstNode* node) {
+    const char* name = node->value.function_call.name;
+    AstNode** arguments = node->value.function_call.arguments;
+    if (node->value.function_call.argument_count != (strcmp(name, "send") == 0 ? 2 : 1)) {
+        codegen_error(cg, node, "Wrong number of arguments");
+        return;
+    }
+    DataType element = chan_element(cg, arguments[0]);
+    if (element == TYPE_NULL) return;
+
+    if (strcmp(name, "close") == 0) {
+        fputs("pf_chan_close(", cg->out);
+        emit_expression(cg, arguments[0]);
+        fprintf(cg->out, ", %d)", node->line);
+        return;
+    }
+    fprintf(cg->out, "pf_chan_%s_%s(", element_suffix(element), name);
+    emit_expression(cg, arguments[0]);
+    if (strcmp(name, "send") == 0) {
+        if ((infer_type(cg, arguments[1]) == TYPE_STR) != (element == TYPE_STR)) {
+            codegen_error(cg, arguments[1], "Value does not match the element type");
+            return;
+        }
+        fputs(", ", cg->out);
+        emit_value(cg, arguments[1], element);
+    }
+    fprintf(cg->out, ", %d)", node->line);
+}
+
+// The function of the program named by argument 2 of par_map or
+// par_reduce, or NULL after reporting that it does not fit
+static AstNode* parallel_function(CodegenC* cg, AstNode* node, DataType element) {
+    bool is_map = strcmp(node->value.function_call.name, "par_map") == 0;
+    AstNode* argument = node->value.function_call.arguments[1];
+    AstNode* function = is_identifier(argument) ? find_function(cg, argument->value.literal.value) : NULL;
+    if (function == NULL || returns_tuple(function) || function->value.function.param_count != (is_map ? 1 : 2)) {
+        codegen_error(cg, argument, is_map ? "Argument 2 must name a function of the program taking one element"
+                                           : "Argument 2 must name a function of the program taking two elements");
+        return NULL;
+    }
+
+    DataType result = function->value.function.return_types[0];
+    for (int i = 0; i < function->value.function.param_count; i++) {
+        DataType parameter = function->value.function.parameters[i]->value.parameter.type;
+        bool fits = is_map ? parameter <= TYPE_BOOL && (parameter == TYPE_STR) == (element == TYPE_STR)
+                           : parameter == element;
+        if (!fits) {
+            codegen_error(cg, argument, "The function's parameters do not match the element type");
+            return NULL;
+        }
+    }
+    if (is_map ? element_suffix(result) == NULL : result != element) {
+        codegen_error(cg, argument, is_map ? "The function must return a number, str or bool"
+                                           : "The function must return the element type");
+        return NULL;
+    }
+    return function;
+}
+
+// par_map(xs, f) and par_reduce(xs, f, init) call f on the elements of xs
+// in chunks on the task pool (pf_par.h). Each call site gets helpers
+// written with the others: a chunk body, for par_reduce a combining
+// function, and a function the call itself becomes.
+static void emit_parallel_call(CodegenC* cg, AstNode* node) {
+    bool is_map = strcmp(node->value.function_call.name, "par_map") == 0;
+    AstNode** arguments = node->value.function_call.arguments;
+    if (node->value.function_call.argument_count != (is_map ? 2 : 3)) {
+        codegen_error(cg, node, "Wrong number of arguments");
+        return;
+    }
+    DataType type = infer_type(cg, arguments[0]);
+    if (!is_sequence_type(type) || element_suffix(type_element(type)) == NULL) {
+        codegen_error(cg, arguments[0], "Argument 1 must be an array or list");
+        return;
+    }
+    DataType element = type_element(type);
+    AstNode* function = parallel_function(cg, node, element);
+    if (function == NULL) return;
+
+    int spawn = cg->spawn_count++;
+    const char* name = function->value.function.name;
+    const char* input = c_type_name(compound_type(TYPE_ARRAY, element));
+    FILE* out = cg->helpers;
+    if (is_map) {
+        DataType result = function->value.function.return_types[0];
+        const char* output = c_type_name(compound_type(TYPE_ARRAY, result));
+        fprintf(out, "typedef struct {\n    %s in;\n    %s out;\n} pf_par_map_args_%d;\n\n", input, output, spawn);
+        fprintf(out, "static void pf_par_map_body_%d(void* pf_context, int64_t pf_first, int64_t pf_last) {\n", spawn);
+        fprintf(out, "    pf_par_map_args_%d* pf_par = pf_context;\n", spawn);
+        fputs("    for (int64_t pf_k = pf_first; pf_k < pf_last; pf_k++) {\n        pf_gc_safepoint();\n", out);
+        if (result == TYPE_STR) {
+            fprintf(out, "        pf_gc_store_string(&pf_par->out.data[pf_k], pf_fn_%s(pf_par->in.data[pf_k]));\n",
+                    name);
+        } else {
+            fprintf(out, "        pf_par->out.data[pf_k] = pf_fn_%s(pf_par->in.data[pf_k]);\n", name);
+        }
+        fputs("    }\n}\n\n", out);
+        fprintf(out, "static %s pf_par_map_%d(%s pf_in, int pf_line) {\n", output, spawn, input);
+        fprintf(out, "    pf_par_map_args_%d pf_par = {pf_in, pf_array_%s_new(pf_in.length, pf_line)};\n", spawn,
+                element_suffix(result));
+        fprintf(out, "    pf_parallel_for(pf_in.length, pf_par_map_body_%d, &pf_par);\n", spawn);
+        fputs("    return pf_par.out;\n}\n\n", out);
+    } else {
+        const char* c_type = c_type_name(element);
+        fprintf(out, "typedef struct {\n    %s in;\n} pf_par_reduce_args_%d;\n\n", input, spawn);
+        fprintf(out, "static void pf_par_reduce_body_%d(void* pf_context, int64_t pf_first, int64_t pf_last, "
+                     "void* pf_partial) {\n", spawn);
+        fprintf(out, "    pf_par_reduce_args_%d* pf_par = pf_context;\n", spawn);
+        fprintf(out, "    %s pf_value = pf_par->in.data[pf_first];\n", c_type);
+        fputs("    for (int64_t pf_k = pf_first + 1; pf_k < pf_last; pf_k++) {\n        pf_gc_safepoint();\n", out);
+        fprintf(out, "        pf_value = pf_fn_%s(pf_value, pf_par->in.data[pf_k]);\n    }\n", name);
+        fprintf(out, "    *(%s*)pf_partial = pf_value;\n}\n\n", c_type);
+        fprintf(out, "static void pf_par_combine_%d(void* pf_context, void* pf_into, const void* pf_from) {\n", spawn);
+        fprintf(out, "    (void)pf_context;\n    *(%s*)pf_into = pf_fn_%s(*(%s*)pf_into, *(const %s*)pf_from);\n}\n\n",
+                c_type, name, c_type, c_type);
+        fprintf(out, "static %s pf_par_reduce_%d(%s pf_in, %s pf_init) {\n", c_type, spawn, input, c_type);
+        fputs("    if (pf_in.length == 0) return pf_init;\n", out);
+        fprintf(out, "    pf_par_reduce_args_%d pf_par = {pf_in};\n    %s pf_value;\n", spawn, c_type);
+        fprintf(out, "    pf_parallel_reduce(pf_in.length, pf_par_reduce_body_%d, pf_par_combine_%d, &pf_par, &pf_value, "
+                     "sizeof(pf_value));\n", spawn, spawn);
+        fprintf(out, "    return pf_fn_%s(pf_init, pf_value);\n}\n\n", name);
+    }
+
+    fprintf(cg->out, "pf_par_%s_%d(", is_map ? "map" : "reduce", spawn);
+    emit_as_array(cg, arguments[0], type);
+    if (is_map) {
+        fprintf(cg->out, ", %d)", node->line);
+    } else {
+        fputs(", ", cg->out);
+        emit_value(cg, arguments[2], element);
+        fputs(")", cg->out);
+    }
+}
+
+static void emit_call(CodegenC* cg, AstNode* node) {
+    const char* name = node->value.function_call.name;
+
+    if (strcmp(name, "print") == 0) {
+        emit_print(cg, node);
+        return;
+    }
+    if (strcmp(name, "error") == 0) {
+        emit_error_call(cg, node);
+        return;
+    }
+
+    // A program's own functions shadow builtins of the same name
+    AstNode* function = find_function(cg, name);
+    if (function == NULL) {
+        if (strcmp(name, "array") == 0 || strcmp(name, "list") == 0) {
+            emit_constructor(cg, node, TYPE_NULL);
+            return;
+        }
+        if (strcmp(name, "len") == 0 || strcmp(name, "append") == 0 || strcmp(name, "slice") == 0) {
+            emit_sequence_call(cg, node);
+            return;
+        }
+        if (strcmp(name, "chan") == 0) {
+            emit_chan_constructor(cg, node, TYPE_NULL);
+            return;
+        }
+        if (strcmp(name, "send") == 0 || strcmp(name, "recv") == 0 || strcmp(name, "close") == 0) {
+            emit_chan_call(cg, node);
+            return;
+        }
+        if (strcmp(name, "par_map") == 0 || strcmp(name, "par_reduce") == 0) {
+            emit_parallel_call(cg, node);
+            return;
+        }
+        const ArrayBuiltin* array_builtin = find_array_builtin(name);
+        if (array_builtin != NULL) {
+            emit_array_builtin(cg, node, array_builtin);
+            return;
+        }
+
+        const Builtin* builtin = find_builtin(name);
+        if (builtin != NULL) {
+            emit_builtin_call(cg, node, builtin);
+        } else {
+            codegen_error(cg, node, "Call to undefined function");
+        }
+        return;
+    }
+    if (function->value.function.param_count != node->value.function_call.argument_count) {
+        codegen_error(cg, node, "Wrong number of arguments");
+        return;
+    }
+
+    // A counted call bumps its site's counter on the way in
+    bool counted = cg->call_sites != NULL && cg->function != NULL;
+    if (counted) {
+        fprintf(cg->call_sites, "    {\"%s\", %d, \"%s\"},\n", cg->function->value.function.name, node->line, name);
+        fprintf(cg->out, "(pf_call_counts[%d]++, ", cg->call_site_count++);
+    }
+    fprintf(cg->out, "pf_fn_%s(", name);
+    for (int i = 0; i < node->value.function_call.argument_count; i++) {
+        if (i > 0) fputs(", ", cg->out);
+        emit_value(cg, node->value.function_call.arguments[i],
+                   function->value.function.parameters[i]->value.parameter.type);
+    }
+    fputs(counted ? "))" : ")", cg->out);
+}
+
+static const char* arith_function(TokenType operator) {
+    switch (operator) {
+        case TOKEN_PLUS: return "add";
+        case TOKEN_MINUS: return "sub";
+        case TOKEN_MULTIPLY: return "mul";
+        case TOKEN_DIVIDE: return "div";
+        case TOKEN_MODULO: return "mod";
+        default: return NULL;
+    }
+}
+
+static const char* arith_suffix(DataType type) {
+    switch (type) {
+#define SUFFIX_CASE(data_type, suffix, c_type, min, max, is_signed) \
+        case data_type: return #suffix;
+        PF_INTEGER_TYPES(SUFFIX_CASE)
+#undef SUFFIX_CASE
+        default: return NULL;
+    }
+}
+
+// The pf_arith.h function for operation at the width of type under the
+// selected overflow mode, up to its opening parenthesis
+static void emit_arith_function(CodegenC* cg, const char* operation, DataType type) {
+    const char* suffix = arith_suffix(type);
+
+    switch (cg->overflow_mode) {
+        case PF_OVERFLOW_WRAP:
+            fprintf(cg->out, "pf_%s_wrap_%s(", operation, suffix);
+            break;
+        case PF_OVERFLOW_CHECKED:
+            fprintf(cg->out, "pf_%s_check_%s(", operation, suffix);
+            break;
+        case PF_OVERFLOW_SATURATE:
+            fprintf(cg->out, "pf_%s_sat_%s(", operation, suffix);
+            break;
+    }
+}
+
+// Integer arithmetic goes through pf_arith.h at the operands' own width, so
+// overflow follows the selected mode instead of C's promotion rules. div and
+// mod always take the line, since division by zero fails in every mode.
+static void emit_arith_call(CodegenC* cg, const char* operation, DataType type, AstNode* left,
+                            AstNode* right, int line) {
+    emit_arith_function(cg, operation, type);
+    if (left != NULL) {
+        emit_expression(cg, left);
+    } else {
+        fputs("0", cg->out);
+    }
+    fputs(", ", cg->out);
+    emit_expression(cg, right);
+    if (cg->overflow_mode == PF_OVERFLOW_CHECKED || strcmp(operation, "div") == 0 || strcmp(operation, "mod") == 0) {
+        fprintf(cg->out, ", %d", line);
+    }
+    fputs(")", cg->out);
+}
+
+// err == null and err != null test the error word
+static bool emit_error_test(CodegenC* cg, AstNode* node) {
+    TokenType operator = node->value.binary_op.operator;
+    if (operator != TOKEN_EQUALS && operator != TOKEN_NOT_EQUAL) return false;
+
+    AstNode* left = node->value.binary_op.left;
+    AstNode* right = node->value.binary_op.right;
+    AstNode* error = NULL;
+    if (is_null_literal(right) && infer_type(cg, left) == TYPE_ERROR) error = left;
+    if (is_null_literal(left) && infer_type(cg, right) == TYPE_ERROR) error = right;
+    if (error == NULL) return false;
+
+    fprintf(cg->out, "%spf_error_is_null(", operator == TOKEN_NOT_EQUAL ? "!" : "");
+    emit_expression(cg, error);
+    fputs(")", cg->out);
+    return true;
+}
+
+// str == str and str != str compare contents, not pointers
+static bool emit_string_test(CodegenC* cg, AstNode* node) {
+    TokenType operator = node->value.binary_op.operator;
+    if (operator != TOKEN_EQUALS && operator != TOKEN_NOT_EQUAL) return false;
+
+    AstNode* left = node->value.binary_op.left;
+    AstNode* right = node->value.binary_op.right;
+    if (infer_type(cg, left) != TYPE_STR || infer_type(cg, right) != TYPE_STR) return false;
+
+    fprintf(cg->out, "%spf_string_equal(", operator == TOKEN_NOT_EQUAL ? "!" : "");
+    emit_expression(cg, left);
+    fputs(", ", cg->out);
+    emit_expression(cg, right);
+    fputs(")", cg->out);
+    return true;
+}
+
+// A comparison of a signed with an unsigned integer compares values; C
+// would convert the signed side to unsigned, so u64 1 > i64 -1 were false.
+// A bare literal is never negative and converts exactly.
+static bool emit_mixed_sign_test(CodegenC* cg, AstNode* node) {
+    TokenType operator = node->value.binary_op.operator;
+    if (operator != TOKEN_LESS && operator != TOKEN_LESS_EQUAL && operator != TOKEN_GREATER &&
+        operator != TOKEN_GREATER_EQUAL && operator != TOKEN_EQUALS && operator != TOKEN_NOT_EQUAL) {
+        return false;
+    }
+
+    AstNode* left = node->value.binary_op.left;
+    AstNode* right = node->value.binary_op.right;
+    if (is_number_literal(left) || is_number_literal(right)) return false;
+    DataType left_type = infer_type(cg, left);
+    DataType right_type = infer_type(cg, right);
+    if (is_signed_type(left_type) && is_unsigned_type(right_type)) {
+        fputs("(pf_compare_signed_unsigned(", cg->out);
+    } else if (is_unsigned_type(left_type) && is_signed_type(right_type)) {
+        fputs("(pf_compare_unsigned_signed(", cg->out);
+    } else {
+        return false;
+    }
+    emit_expression(cg, left);
+    fputs(", ", cg->out);
+    emit_expression(cg, right);
+    fprintf(cg->out, ") %s 0)", c_operator(operator));
+    return true;
+}
+
+static void emit_expression(CodegenC* cg, AstNode* node) {
+    switch (node->type) {
+        case NODE_LITERAL:
+            if (is_null_literal(node)) {
+                fputs("0", cg->out);
+            } else if (is_string_literal(node)) {
+                fprintf(cg->out, "pf_literals[%d]", literal_slot(cg, node->value.literal.value));
+            } else if (is_identifier(node) && find_local(cg, node->value.literal.value) == NULL) {
+                codegen_error(cg, node, "Use of undeclared variable");
+            } else {
+                fputs(node->value.literal.value, cg->out);
+                // Above INT64_MAX a decimal constant has no signed C type
+                if (is_integer_constant(node) && integer_literal_type(node->value.literal.value) == TYPE_U64) {
+                    fputs("ULL", cg->out);
+                }
+            }
+            break;
+
+        case NODE_BINARY_OP:
+            if (is_format_expression(node)) {
+                // The formatted text lives in a rotating buffer; a str value
+                // gets its own copy
+                fputs("pf_string_from_cstr(", cg->out);
+                emit_format(cg, node, NULL, 0);
+                fputs(")", cg->out);
+                break;
+            }
+            if (emit_error_test(cg, node) || emit_string_test(cg, node) || emit_mixed_sign_test(cg, node)) {
+                break;
+            }
+            if (arith_function(node->value.binary_op.operator) != NULL) {
+                DataType type = infer_type(cg, node);
+                if (is_signed_type(type) || is_unsigned_type(type)) {
+                    emit_arith_call(cg, arith_function(node->value.binary_op.operator), type,
+                                    node->value.binary_op.left, node->value.binary_op.right, node->line);
+                    break;
+                }
+            }
+            fputs("(", cg->out);
+            emit_expression(cg, node->value.binary_op.left);
+            fprintf(cg->out, " %s ", c_operator(node->value.binary_op.operator));
+            emit_expression(cg, node->value.binary_op.right);
+            fputs(")", cg->out);
+            break;
+
+        case NODE_UNARY_OP:
+            if (node->value.unary_op.operator == TOKEN_MINUS) {
+                DataType type = infer_type(cg, node);
+                if (is_signed_type(type) || is_unsigned_type(type)) {
+                    emit_arith_call(cg, "sub", type, NULL, node->value.unary_op.operand, node->line);
+                    break;
+                }
+            }
+            fprintf(cg->out, "(%s", c_operator(node->value.unary_op.operator));
+            emit_expression(cg, node->value.unary_op.operand);
+            fputs(")", cg->out);
+            break;
+
+        case NODE_FUNCTION_CALL:
+            emit_call(cg, node);
+            break;
+
+        case NODE_INDEX:
+            fputs("(*", cg->out);
+            emit_element_pointer(cg, node->value.index.target, NULL, node->value.index.index, node);
+            fputs(")", cg->out);
+            break;
+
+        default:
+            codegen_error(cg, node, "Unsupported expression");
+            break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Tail calls
+//
+// A return of a call of one of the program's functions whose result needs
+// no conversion is a tail call. Tail calls that close a cycle become jumps,
+// so the recursion runs in constant stack space whatever the C compiler
+// does: a function calling only itself jumps back to its top with its
+// parameters reassigned, and functions calling each other with the same
+// parameter and return types are emitted as one C function with an entry
+// label per member.
+
+static int function_index(CodegenC* cg, AstNode* function) {
+    for (int i = 0; i < cg->program->value.block.statement_count; i++) {
+        if (cg->program->value.block.statements[i] == function) return i;
+    }
+    return -1;
+}
+
+// The program function a return statement's value calls, or NULL
+static AstNode* tail_callee(CodegenC* cg, AstNode* value) {
+    if (value == NULL || value->type != NODE_FUNCTION_CALL) return NULL;
+    AstNode* callee = find_function(cg, value->value.function_call.name);
+    if (callee == NULL || callee->value.function.param_count != value->value.function_call.argument_count) {
+        return NULL;
+    }
+    return callee;
+}
+
+// Whether one C frame layout serves both functions
+static bool same_signature(AstNode* a, AstNode* b) {
+    if (returns_tuple(a) || returns_tuple(b) ||
+        a->value.function.return_types[0] != b->value.function.return_types[0] ||
+        a->value.function.param_count != b->value.function.param_count) {
+        return false;
+    }
+    for (int i = 0; i < a->value.function.param_count; i++) {
+        if (a->value.function.parameters[i]->value.parameter.type !=
+            b->value.function.parameters[i]->value.parameter.type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Call visit on each return statement of a function body
+static void visit_returns(CodegenC* cg, AstNode* node, int caller, void (*visit)(CodegenC*, AstNode*, int)) {
+    if (node == NULL) return;
+    switch (node->type) {
+        case NODE_BLOCK:
+            for (int i = 0; i < node->value.block.statement_count; i++) {
+                visit_returns(cg, node->value.block.statements[i], caller, visit);
+            }
+            break;
+        case NODE_IF:
+            for (int i = 0; i < node->value.if_stmt.then_branches_count; i++) {
+                visit_returns(cg, node->value.if_stmt.then_branches[i], caller, visit);
+            }
+            visit_returns(cg, node->value.if_stmt.else_branch, caller, visit);
+            break;
+        case NODE_WHILE:
+            visit_returns(cg, node->value.while_stmt.body, caller, visit);
+            break;
+        case NODE_FOR:
+            // A par for body cannot return
+            if (!node->value.for_stmt.parallel) visit_returns(cg, node->value.for_stmt.body, caller, visit);
+            break;
+        case NODE_SELECT:
+            for (int i = 0; i < node->value.select_stmt.case_count; i++) {
+                visit_returns(cg, node->value.select_stmt.bodies[i], caller, visit);
+            }
+            visit_returns(cg, node->value.select_stmt.else_branch, caller, visit);
+            break;
+        case NODE_RETURN:
+            visit(cg, node, caller);
+            break;
+        default:
+            break;
+    }
+}
+
+// Record a tail call between functions of the same signature
+static void add_tail_call(CodegenC* cg, AstNode* node, int caller) {
+    AstNode* callee = tail_callee(cg, node->value.return_stmt.return_value);
+    AstNode* function = cg->program->value.block.statements[caller];
+    if (callee != NULL && same_signature(function, callee)) {
+        cg->tail_calls[caller * cg->program->value.block.statement_count + function_index(cg, callee)] = true;
+    }
+}
+
+// Whether the tail call at node becomes a jump
+static bool tail_call_jumps(CodegenC* cg, int caller, int callee) {
+    if (cg->tail_groups[caller] >= 0) return cg->tail_groups[caller] == cg->tail_groups[callee];
+    return caller == callee && cg->tail_loops[caller];
+}
+
+static void report_tail_call(CodegenC* cg, AstNode* node, int caller) {
+    AstNode* function = cg->program->value.block.statements[caller];
+    AstNode* callee = tail_callee(cg, node->value.return_stmt.return_value);
+    if (callee == NULL) return;
+
+    const char* caller_name = function->value.function.name;
+    const char* callee_name = callee->value.function.name;
+    fprintf(cg->tail_report, "function %s, line %d: tail call of %s ", caller_name, node->line, callee_name);
+    if (tail_call_jumps(cg, caller, function_index(cg, callee))) {
+        fputs("becomes a jump\n", cg->tail_report);
+    } else if (returns_tuple(function) || returns_tuple(callee)) {
+        fputs("not optimized: it returns several values\n", cg->tail_report);
+    } else if (function->value.function.return_types[0] != callee->value.function.return_types[0]) {
+        fprintf(cg->tail_report, "not optimized: its %s result is converted to %s\n",
+                data_type_to_string(callee->value.function.return_types[0]),
+                data_type_to_string(function->value.function.return_types[0]));
+    } else if (!same_signature(function, callee)) {
+        fprintf(cg->tail_report, "not optimized: %s and %s take different parameters\n", caller_name, callee_name);
+    } else {
+        fprintf(cg->tail_report, "not optimized: %s does not call %s back\n", callee_name, caller_name);
+    }
+}
+
+static void find_tail_reach(bool* tail_calls, int count, int from, bool* reached) {
+    for (int to = 0; to < count; to++) {
+        if (tail_calls[from * count + to] && !reached[to]) {
+            reached[to] = true;
+            find_tail_reach(tail_calls, count, to, reached);
+        }
+    }
+}
+
+// Decide which functions loop on themselves and which are merged, from
+// the cycles of tail calls between functions of the same signature
+static void plan_tail_calls(CodegenC* cg) {
+    int count = cg->program->value.block.statement_count;
+    AstNode** functions = cg->program->value.block.statements;
+    bool* tail_calls = calloc((size_t)count * count + 1, sizeof(bool));
+    cg->tail_calls = tail_calls;
+    bool* reach = calloc((size_t)count * count + 1, sizeof(bool));
+    cg->tail_groups = malloc(sizeof(int) * (count + 1));
+    cg->tail_loops = calloc(count + 1, sizeof(bool));
+
+    for (int i = 0; i < count; i++) {
+        visit_returns(cg, functions[i]->value.function.body, i, add_tail_call);
+    }
+    for (int i = 0; i < count; i++) {
+        find_tail_reach(tail_calls, count, i, reach + (size_t)i * count);
+    }
+
+    // A group is named after its first member
+    for (int i = 0; i < count; i++) {
+        cg->tail_groups[i] = -1;
+        int members = 0;
+        for (int j = 0; j < count; j++) {
+            if (j != i && reach[i * count + j] && reach[j * count + i]) {
+                if (members++ == 0 && j < i) cg->tail_groups[i] = cg->tail_groups[j];
+            }
+        }
+        if (members > 0 && cg->tail_groups[i] < 0) cg->tail_groups[i] = i;
+        cg->tail_loops[i] = members == 0 && tail_calls[i * count + i];
+    }
+
+    if (cg->tail_report != NULL) {
+        for (int i = 0; i < count; i++) {
+            visit_returns(cg, functions[i]->value.function.body, i, report_tail_call);
+        }
+    }
+    free(reach);
+    free(tail_calls);
+    cg->tail_calls = NULL;
+}
+
+// With tasks running on other threads, a collection waits for every
+// thread to reach a safepoint, so each loop passes one per iteration
+static void emit_safepoint(CodegenC* cg, int indent) {
+    if (!cg->spawns) return;
+    emit_indent(cg, indent);
+    fputs("pf_gc_safepoint();\n", cg->out);
+}
+
+// Emit the return of a call that becomes a jump: the arguments are
+// evaluated, then stored where the callee reads its parameters. Returns
+// false for any other return.
+static bool emit_tail_jump(CodegenC* cg, AstNode* node, int indent) {
+    AstNode* value = node->value.return_stmt.return_value;
+    AstNode* callee = tail_callee(cg, value);
+    if (callee == NULL) return false;
+    int caller_index = function_index(cg, cg->function);
+    int callee_index = function_index(cg, callee);
+    if (caller_index < 0 || !tail_call_jumps(cg, caller_index, callee_index)) return false;
+
+    AstNode** parameters = callee->value.function.parameters;
+    int count = callee->value.function.param_count;
+    bool merged = cg->tail_groups[caller_index] >= 0;
+    emit_indent(cg, indent);
+    fputs("{\n", cg->out);
+    for (int i = 0; i < count; i++) {
+        DataType type = parameters[i]->value.parameter.type;
+        emit_indent(cg, indent + 1);
+        fprintf(cg->out, "%s pf_next_%d = ", c_type_name(type), i);
+        emit_value(cg, value->value.function_call.arguments[i], type);
+        fputs(";\n", cg->out);
+    }
+    // Every argument is evaluated before any parameter changes
+    for (int i = 0; i < count; i++) {
+        emit_indent(cg, indent + 1);
+        if (merged) {
+            fprintf(cg->out, "pf_arg_%d = pf_next_%d;\n", i, i);
+        } else {
+            fprintf(cg->out, "%s = pf_next_%d;\n", parameters[i]->value.parameter.name, i);
+        }
+    }
+    emit_safepoint(cg, indent + 1);
+    emit_indent(cg, indent + 1);
+    if (merged) {
+        fprintf(cg->out, "goto pf_enter_%s;\n", callee->value.function.name);
+    } else {
+        fputs("goto pf_tail_call;\n", cg->out);
+    }
+    emit_indent(cg, indent);
+    fputs("}\n", cg->out);
+    return true;
+}
+
+// A returned value is computed into pf_result before the function's region
+// is freed, since computing it may read from the region
+static void begin_result(CodegenC* cg, const char* c_type, int indent) {
+    if (!cg->region) {
+        fputs("return ", cg->out);
+        return;
+    }
+    fputs("{\n", cg->out);
+    emit_indent(cg, indent + 1);
+    fprintf(cg->out, "%s pf_result = ", c_type);
+}
+
+static void end_result(CodegenC* cg, int indent) {
+    if (!cg->region) return;
+    emit_indent(cg, indent + 1);
+    fputs("pf_region_free(&pf_region);\n", cg->out);
+    emit_indent(cg, indent + 1);
+    fputs("return pf_result;\n", cg->out);
+    emit_indent(cg, indent);
+    fputs("}\n", cg->out);
+}
+
+static void emit_return(CodegenC* cg, AstNode* node, int indent) {
+    AstNode* function = cg->function;
+    AstNode* value = node->value.return_stmt.return_value;
+    if (emit_tail_jump(cg, node, indent)) return;
+
+    emit_indent(cg, indent);
+    if (returns_tuple(function)) {
+        if (value == NULL || value->type != NODE_TUPLE ||
+            value->value.tuple.value_count != function->value.function.return_type_count) {
+            codegen_error(cg, node, "Return value does not match the declared return types");
+            return;
+        }
+
+        char c_type[96];
+        snprintf(c_type, sizeof(c_type), "pf_ret_%s", function->value.function.name);
+        begin_result(cg, c_type, indent);
+        fprintf(cg->out, "(pf_ret_%s){", function->value.function.name);
+        for (int i = 0; i < value->value.tuple.value_count; i++) {
+            if (i > 0) fputs(", ", cg->out);
+            emit_value(cg, value->value.tuple.values[i], function->value.function.return_types[i]);
+        }
+        fputs("};\n", cg->out);
+        end_result(cg, indent);
+        return;
+    }
+
+    DataType type = function->value.function.return_types[0];
+    if (type == TYPE_NULL) {
+        if (value != NULL && !is_null_literal(value)) {
+            emit_expression(cg, value);
+            fputs(";\n", cg->out);
+            emit_indent(cg, indent);
+        }
+        if (cg->region) {
+            fputs("pf_region_free(&pf_region);\n", cg->out);
+            emit_indent(cg, indent);
+        }
+        fputs("return;\n", cg->out);
+        return;
+    }
+
+    begin_result(cg, c_type_name(type), indent);
+    emit_value(cg, value, type);
+    fputs(";\n", cg->out);
+    end_result(cg, indent);
+}
+
+static void emit_variable(CodegenC* cg, AstNode* node, int indent) {
+    DataType type = node->value.variable.type;
+    const char* c_type = c_type_name(type);
+    if (c_type == NULL || type == TYPE_NULL) {
+        codegen_error(cg, node, "Unsupported variable type");
+        return;
+    }
+
+    AstNode* init = node->value.variable.init_value;
+    emit_indent(cg, indent);
+    fprintf(cg->out, "%s %s = ", c_type, node->value.variable.name);
+    emit_value(cg, init, type);
+    fputs(";\n", cg->out);
+
+    if (node->value.variable.is_optional) {
+        emit_indent(cg, indent);
+        fprintf(cg->out, "bool %s_is_null = %s;\n", node->value.variable.name,
+                is_null_literal(init) ? "true" : "false");
+    }
+
+    add_local(cg, node->value.variable.name, type);
+}
+
+static void emit_block(CodegenC* cg, AstNode* node, int indent) {
+    int scope = cg->local_count;
+    if (node->type == NODE_BLOCK) {
+        for (int i = 0; i < node->value.block.statement_count; i++) {
+            emit_statement(cg, node->value.block.statements[i], indent);
+        }
+    } else {
+        emit_statement(cg, node, indent);
+    }
+    cg->local_count = scope;
+}
+
+static void emit_if(CodegenC* cg, AstNode* node, int indent) {
+    emit_indent(cg, indent);
+    fputs("if (", cg->out);
+    emit_expression(cg, node->value.if_stmt.condition);
+    fputs(") {\n", cg->out);
+    emit_block(cg, node->value.if_stmt.then_branches[0], indent + 1);
+
+    if (node->value.if_stmt.else_branch != NULL) {
+        emit_indent(cg, indent);
+        fputs("} else {\n", cg->out);
+        emit_block(cg, node->value.if_stmt.else_branch, indent + 1);
+    }
+
+    emit_indent(cg, indent);
+    fputs("}\n", cg->out);
+}
+
+static void emit_while(CodegenC* cg, AstNode* node, int indent) {
+    emit_indent(cg, indent);
+    fputs("while (", cg->out);
+    emit_expression(cg, node->value.while_stmt.condition);
+    fputs(") {\n", cg->out);
+    emit_safepoint(cg, indent + 1);
+    emit_block(cg, node->value.while_stmt.body, indent + 1);
+    emit_indent(cg, indent);
+    fputs("}\n", cg->out);
+}
+
+// A step written as a literal, possibly negated; false for any other step
+static bool literal_step(AstNode* step, int64_t* value) {
+    if (step == NULL) {
+        *value = 1;
+        return true;
+    }
+    bool negated = step->type == NODE_UNARY_OP && step->value.unary_op.operator == TOKEN_MINUS;
+    AstNode* literal = negated ? step->value.unary_op.operand : step;
+    if (!is_number_literal(literal) || strchr(literal->value.literal.value, '.') != NULL) return false;
+    *value = strtoll(literal->value.literal.value, NULL, 10) * (negated ? -1 : 1);
+    return true;
+}
+
+// One iteration of a for statement: the variable for iteration number
+// offset, then the body
+static void emit_iteration(CodegenC* cg, AstNode* node, const char* offset, int temp, int indent) {
+    emit_indent(cg, indent);
+    fprintf(cg->out, "%s %s = (%s)((uint64_t)pf_start_%d + %s * (uint64_t)pf_step_%d);\n",
+            c_type_name(node->value.for_stmt.type), node->value.for_stmt.name,
+            c_type_name(node->value.for_stmt.type), temp, offset, temp);
+
+    int scope = cg->local_count;
+    add_local(cg, node->value.for_stmt.name, node->value.for_stmt.type);
+    emit_block(cg, node->value.for_stmt.body, indent);
+    cg->local_count = scope;
+}
+
+// The loop of a for statement over the trip count computed by emit_for
+static void emit_counted_loop(CodegenC* cg, AstNode* node, int temp, int indent) {
+    char offset[32];
+    snprintf(offset, sizeof(offset), "pf_k_%d", temp);
+    emit_indent(cg, indent);
+    fprintf(cg->out, "for (uint64_t pf_k_%d = 0; pf_k_%d < pf_count_%d; pf_k_%d++) {\n", temp, temp, temp, temp);
+    emit_safepoint(cg, indent + 1);
+    emit_iteration(cg, node, offset, temp, indent + 1);
+    emit_indent(cg, indent);
+    fputs("}\n", cg->out);
+}
+
+// Sequences a loop body indexes, by variable name
+typedef struct {
+    const char* names[16];
+    bool written[16];
+    int count;
+} LoopSequences;
+
+// Collect the sequences node indexes; false if one is not a variable or
+// the body holds something the vectorizer never accepts
+static bool collect_sequences(AstNode* node, LoopSequences* sequences) {
+    if (node == NULL) return true;
+    const char* name = NULL;
+    bool written = false;
+    switch (node->type) {
+        case NODE_BLOCK:
+            for (int i = 0; i < node->value.block.statement_count; i++) {
+                if (!collect_sequences(node->value.block.statements[i], sequences)) return false;
+            }
+            return true;
+        case NODE_LITERAL:
+            return true;
+        case NODE_VARIABLE:
+            return collect_sequences(node->value.variable.init_value, sequences);
+        case NODE_BINARY_OP:
+            return collect_sequences(node->value.binary_op.left, sequences) &&
+                   collect_sequences(node->value.binary_op.right, sequences);
+        case NODE_UNARY_OP:
+            return collect_sequences(node->value.unary_op.operand, sequences);
+        case NODE_FUNCTION_CALL:
+            for (int i = 0; i < node->value.function_call.argument_count; i++) {
+                if (!collect_sequences(node->value.function_call.arguments[i], sequences)) return false;
+            }
+            return true;
+        case NODE_ASSIGNMENT:
+            if (!collect_sequences(node->value.assignment.value, sequences)) return false;
+            if (node->value.assignment.index == NULL) return true;
+            if (!collect_sequences(node->value.assignment.index, sequences)) return false;
+            name = node->value.assignment.name;
+            written = true;
+            break;
+        case NODE_INDEX: {
+            AstNode* target = node->value.index.target;
+            if (target->type != NODE_LITERAL || target->value.literal.type != TYPE_I32) return false;
+            if (!collect_sequences(node->value.index.index, sequences)) return false;
+            name = target->value.literal.value;
+            break;
+        }
+        default:
+            return false;
+    }
+
+    for (int i = 0; i < sequences->count; i++) {
+        if (strcmp(sequences->names[i], name) == 0) {
+            sequences->written[i] |= written;
+            return true;
+        }
+    }
+    if (sequences->count == 16) return false;
+    sequences->names[sequences->count] = name;
+    sequences->written[sequences->count] = written;
+    sequences->count++;
+    return true;
+}
+
+static bool loop_vectorized(CodegenC* cg, AstNode* node) {
+    for (int i = 0; i < cg->vector_loop_count; i++) {
+        if (cg->vector_loops[i].loop == node) return cg->vector_loops[i].vectorized;
+    }
+    return false;
+}
+
+// A loop the IR found vectorizable runs in blocks of PF_VECTOR_LANES
+// iterations: a fixed-length inner loop without dependences between its
+// iterations is what C compilers turn into SIMD code, even at -O2. The
+// iterations left over run one by one after it. Lists are read through
+// array views so that the compiler knows no store moves their elements.
+// When a written array might overlap another of its element type, the
+// blocks only run if their memory is disjoint or the same.
+static void emit_vector_loop(CodegenC* cg, AstNode* node, int temp, int indent) {
+    LoopSequences sequences = {0};
+    if (!collect_sequences(node->value.for_stmt.body, &sequences)) {
+        emit_counted_loop(cg, node, temp, indent);
+        return;
+    }
+    DataType types[16];
+    for (int i = 0; i < sequences.count; i++) {
+        CodegenLocal* local = find_local(cg, sequences.names[i]);
+        if (local == NULL || !is_sequence_type(local->type)) {
+            emit_counted_loop(cg, node, temp, indent);
+            return;
+        }
+        types[i] = local->type;
+    }
+
+    // A view named like its list shadows it; the view is taken in an outer
+    // scope because a declaration cannot read the name it declares
+    int scope = cg->local_count;
+    int lists = 0;
+    for (int i = 0; i < sequences.count; i++) {
+        if (type_kind(types[i]) != TYPE_LIST) continue;
+        const char* suffix = element_suffix(type_element(types[i]));
+        if (lists++ == 0) {
+            emit_indent(cg, indent);
+            fputs("{\n", cg->out);
+        }
+        emit_indent(cg, indent + 1);
+        fprintf(cg->out, "pf_array_%s pf_view_%d_%d = pf_list_%s_view(%s);\n", suffix, temp, i, suffix,
+                sequences.names[i]);
+    }
+    if (lists > 0) indent++;
+    emit_indent(cg, indent);
+    fputs("{\n", cg->out);
+    for (int i = 0; i < sequences.count; i++) {
+        if (type_kind(types[i]) != TYPE_LIST) continue;
+        emit_indent(cg, indent + 1);
+        fprintf(cg->out, "pf_array_%s %s = pf_view_%d_%d;\n", element_suffix(type_element(types[i])),
+                sequences.names[i], temp, i);
+        add_local(cg, sequences.names[i], compound_type(TYPE_ARRAY, type_element(types[i])));
+    }
+    indent--;
+
+    emit_indent(cg, indent + 2);
+    fprintf(cg->out, "uint64_t pf_k_%d = 0;\n", temp);
+    int conditions = 0;
+    for (int i = 0; i < sequences.count; i++) {
+        for (int j = 0; j < sequences.count; j++) {
+            if (!sequences.written[i] || i == j || (sequences.written[j] && j < i)) continue;
+            if (type_element(types[i]) != type_element(types[j])) continue;
+            if (conditions++ == 0) {
+                emit_indent(cg, indent + 2);
+                fputs("if (", cg->out);
+            } else {
+                fputs(" && ", cg->out);
+            }
+            fprintf(cg->out, "pf_same_or_disjoint(%s.data, %s.length, %s.data, %s.length, sizeof(*%s.data))",
+                    sequences.names[i], sequences.names[i], sequences.names[j], sequences.names[j],
+                    sequences.names[i]);
+        }
+    }
+    int block_indent = indent + 2;
+    if (conditions > 0) {
+        fputs(") {\n", cg->out);
+        block_indent++;
+    }
+
+    char offset[64];
+    snprintf(offset, sizeof(offset), "(pf_k_%d + pf_l_%d)", temp, temp);
+    emit_indent(cg, block_indent);
+    fprintf(cg->out, "for (; pf_k_%d + PF_VECTOR_LANES <= pf_count_%d; pf_k_%d += PF_VECTOR_LANES) {\n",
+            temp, temp, temp);
+    emit_indent(cg, block_indent + 1);
+    fputs("PF_VECTORIZE\n", cg->out);
+    emit_indent(cg, block_indent + 1);
+    fprintf(cg->out, "for (uint64_t pf_l_%d = 0; pf_l_%d < PF_VECTOR_LANES; pf_l_%d++) {\n", temp, temp, temp);
+    emit_iteration(cg, node, offset, temp, block_indent + 2);
+    emit_indent(cg, block_indent + 1);
+    fputs("}\n", cg->out);
+    emit_indent(cg, block_indent);
+    fputs("}\n", cg->out);
+    if (conditions > 0) {
+        emit_indent(cg, indent + 2);
+        fputs("}\n", cg->out);
+    }
+
+    snprintf(offset, sizeof(offset), "pf_k_%d", temp);
+    emit_indent(cg, indent + 2);
+    fprintf(cg->out, "for (; pf_k_%d < pf_count_%d; pf_k_%d++) {\n", temp, temp, temp);
+    emit_iteration(cg, node, offset, temp, indent + 3);
+    emit_indent(cg, indent + 2);
+    fputs("}\n", cg->out);
+
+    cg->local_count = scope;
+    emit_indent(cg, indent + 1);
+    fputs("}\n", cg->out);
+    if (lists > 0) {
+        emit_indent(cg, indent);
+        fputs("}\n", cg->out);
+    }
+}
+
+// for i = range(start, end, step) is a counted loop: the bounds and step
+// are evaluated once, the trip count is computed in 64 bits, and the loop
+// counts k up to it. Each iteration gives the variable start + k * step at
+// its declared width, so a u8 variable cannot make the loop run forever,
+// and assigning to it in the body does not change the iterations.
+// Whether the range() of a for statement has integer bounds and a step
+// that is not zero, reporting it if not
+static bool check_range(CodegenC* cg, AstNode* node) {
+    AstNode* bounds[3] = {node->value.for_stmt.start, node->value.for_stmt.end, node->value.for_stmt.step};
+    for (int i = 0; i < 3; i++) {
+        if (bounds[i] != NULL && !is_integer_expression(cg, bounds[i])) {
+            codegen_error(cg, bounds[i], "range() bounds and step must be integers");
+            return false;
+        }
+    }
+    int64_t step;
+    if (literal_step(bounds[2], &step) && step == 0) {
+        codegen_error(cg, node, "range() step must not be zero");
+        return false;
+    }
+    return true;
+}
+
+// The bounds of a for statement, evaluated once, and its trip count
+static void emit_range(CodegenC* cg, AstNode* node, int temp, int indent) {
+    AstNode* bounds[3] = {node->value.for_stmt.start, node->value.for_stmt.end, node->value.for_stmt.step};
+    const char* names[3] = {"start", "end", "step"};
+    for (int i = 0; i < 3; i++) {
+        emit_indent(cg, indent);
+        fprintf(cg->out, "const int64_t pf_%s_%d = ", names[i], temp);
+        if (bounds[i] != NULL) {
+            emit_value(cg, bounds[i], TYPE_I64);
+        } else {
+            fputs("1", cg->out);
+        }
+        fputs(";\n", cg->out);
+    }
+    emit_indent(cg, indent);
+    fprintf(cg->out, "const uint64_t pf_count_%d = pf_range_count(pf_start_%d, pf_end_%d, pf_step_%d, %d);\n",
+            temp, temp, temp, temp, node->line);
+}
+
+static void emit_for(CodegenC* cg, AstNode* node, int indent) {
+    if (!check_range(cg, node)) return;
+
+    int temp = cg->temp_count++;
+    emit_indent(cg, indent);
+    fputs("{\n", cg->out);
+    emit_range(cg, node, temp, indent + 1);
+
+    // Accesses indexed by the counter that the IR could not prove are
+    // checked once for the whole range: if every sequence they index can
+    // hold it, an unchecked copy of the loop runs instead
+    bool* hoisted = calloc(cg->bounds_count > 0 ? cg->bounds_count : 1, sizeof(bool));
+    const char** checked_names = malloc(sizeof(char*) * (cg->bounds_count > 0 ? cg->bounds_count : 1));
+    int checked_count = 0;
+    for (int i = 0; i < cg->bounds_count; i++) {
+        if (cg->bounds[i].loop != node) continue;
+        // Only a sequence held in a variable can be checked before the loop
+        const AstNode* source = cg->bounds[i].source;
+        const AstNode* target = source->type == NODE_INDEX ? source->value.index.target : NULL;
+        if (target != NULL && (target->type != NODE_LITERAL || target->value.literal.type != TYPE_I32)) continue;
+        const char* name = target != NULL ? target->value.literal.value : source->value.assignment.name;
+        CodegenLocal* local = find_local(cg, name);
+        if (local == NULL || !is_sequence_type(local->type)) continue;
+        hoisted[i] = true;
+
+        bool seen = false;
+        for (int j = 0; j < checked_count; j++) {
+            if (strcmp(checked_names[j], name) == 0) seen = true;
+        }
+        if (seen) continue;
+        if (checked_count == 0) {
+            emit_indent(cg, indent + 1);
+            fputs("if (", cg->out);
+        } else {
+            fputs(" && ", cg->out);
+        }
+        fprintf(cg->out, "pf_range_fits(pf_start_%d, pf_count_%d, pf_step_%d, %s%slength)", temp, temp, temp, name,
+                type_kind(local->type) == TYPE_ARRAY ? "." : "->");
+        checked_names[checked_count++] = name;
+    }
+
+    // Only the copy without checks can be vectorized
+    bool vectorized = loop_vectorized(cg, node);
+    if (checked_count == 0) {
+        (vectorized ? emit_vector_loop : emit_counted_loop)(cg, node, temp, indent + 1);
+    } else {
+        fputs(") {\n", cg->out);
+        for (int i = 0; i < cg->bounds_count; i++) {
+            if (hoisted[i]) cg->bounds_active[i] = true;
+        }
+        (vectorized ? emit_vector_loop : emit_counted_loop)(cg, node, temp, indent + 2);
+        for (int i = 0; i < cg->bounds_count; i++) {
+            if (hoisted[i]) cg->bounds_active[i] = false;
+        }
+        emit_indent(cg, indent + 1);
+        fputs("} else {\n", cg->out);
+        emit_counted_loop(cg, node, temp, indent + 2);
+        emit_indent(cg, indent + 1);
+        fputs("}\n", cg->out);
+    }
+    free(hoisted);
+    free(checked_names);
+
+    emit_indent(cg, indent);
+    fputs("}\n", cg->out);
+}
+
+// ---------------------------------------------------------------------------
+// Parallel for
+//
+// The iterations of a par for run at once, so its body may write only what
+// no other iteration touches: elements of outer arrays and lists at the
+// loop variable itself, and reduction variables. A reduction variable is
+// an outer number updated only as total = total + x (or -, *, ++, --);
+// each chunk of iterations starts its own copy from zero, or one for *,
+// and the copies are combined in order when the loop ends. Everything else
+// declared outside the loop is only read, and copied into each chunk.
+
+typedef struct {
+    const char* name;
+    DataType type;
+    TokenType operator;         // TOKEN_PLUS or TOKEN_MULTIPLY: how the chunks' copies combine
+} ParallelReduction;
+
+// A read of an outer variable, whole or one element of it
+typedef struct {
+    AstNode* node;
+    const char* name;
+    bool whole;
+    bool at_index;              // An element at the loop variable
+} ParallelRead;
+
+// What the body of one par for touches outside itself
+typedef struct {
+    CodegenC* cg;
+    AstNode* loop;
+    const char** declared;      // Names declared in the body, innermost last; the loop variable first
+    int declared_count;
+    const char** captured;      // Outer variables read, each once
+    int captured_count;
+    const char** written;       // Outer sequences whose elements are written
+    int written_count;
+    ParallelRead* reads;
+    int read_count;
+    ParallelReduction* reductions;
+    int reduction_count;
+    int capacity;               // Of every array above; each grows by at most one per node
+} ParallelBody;
+
+static void scan_parallel_statement(ParallelBody* body, AstNode* node);
+static bool scan_parallel_child(AstNode* child, void* data);
+
+static void parallel_error(ParallelBody* body, AstNode* node, const char* format, const char* name) {
+    char message[256];
+    snprintf(message, sizeof(message), format, name);
+    codegen_error(body->cg, node, message);
+}
+
+static void declare_in_body(ParallelBody* body, const char* name) {
+    body->declared[body->declared_count++] = name;
+}
+
+// Whether name refers to a variable declared outside the loop
+static bool is_outer(ParallelBody* body, const char* name) {
+    for (int i = body->declared_count - 1; i >= 0; i--) {
+        if (strcmp(body->declared[i], name) == 0) return false;
+    }
+    return find_local(body->cg, name) != NULL;
+}
+
+// Whether node is the loop variable itself
+static bool is_loop_index(ParallelBody* body, AstNode* node) {
+    if (!is_identifier(node)) return false;
+    for (int i = body->declared_count - 1; i >= 0; i--) {
+        if (strcmp(body->declared[i], node->value.literal.value) == 0) return i == 0;
+    }
+    return false;
+}
+
+static bool in_names(const char** names, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(names[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static void capture(ParallelBody* body, const char* name) {
+    if (!in_names(body->captured, body->captured_count, name)) body->captured[body->captured_count++] = name;
+}
+
+static ParallelReduction* find_reduction(ParallelBody* body, const char* name) {
+    for (int i = 0; i < body->reduction_count; i++) {
+        if (strcmp(body->reductions[i].name, name) == 0) return &body->reductions[i];
+    }
+    return NULL;
+}
+
+static void add_reduction(ParallelBody* body, AstNode* node, const char* name, TokenType operator) {
+    DataType type = find_local(body->cg, name)->type;
+    if (!is_signed_type(type) && !is_unsigned_type(type) && !is_float_type(type)) {
+        parallel_error(body, node, "par for can only change %s, declared outside it, as a number to reduce", name);
+        return;
+    }
+    ParallelReduction* reduction = find_reduction(body, name);
+    if (reduction == NULL) {
+        body->reductions[body->reduction_count++] = (ParallelReduction){name, type, operator};
+    } else if (reduction->operator != operator) {
+        parallel_error(body, node, "par for both adds to and multiplies %s", name);
+    }
+}
+
+// Whether the function writes elements of the sequence passed as
+// parameter, directly or through the functions it passes it to
+typedef struct {
+    CodegenC* cg;
+    const char* name;
+    int depth;
+} ParameterWrite;
+
+static bool writes_parameter(AstNode* function, int parameter, CodegenC* cg, int depth);
+
+static bool writes_sequence(AstNode* node, void* data) {
+    ParameterWrite* search = data;
+    if (node->type == NODE_ASSIGNMENT && node->value.assignment.index != NULL &&
+        strcmp(node->value.assignment.name, search->name) == 0) {
+        return true;
+    }
+    if (node->type == NODE_UNARY_OP && node->value.unary_op.operand->type == NODE_INDEX &&
+        (node->value.unary_op.operator == TOKEN_INCREMENT || node->value.unary_op.operator == TOKEN_DECREMENT)) {
+        AstNode* target = node->value.unary_op.operand->value.index.target;
+        if (is_identifier(target) && strcmp(target->value.literal.value, search->name) == 0) return true;
+    }
+    if (node->type == NODE_FUNCTION_CALL) {
+        AstNode** arguments = node->value.function_call.arguments;
+        AstNode* function = find_function(search->cg, node->value.function_call.name);
+        for (int i = 0; i < node->value.function_call.argument_count; i++) {
+            if (!is_identifier(arguments[i]) || strcmp(arguments[i]->value.literal.value, search->name) != 0) {
+                continue;
+            }
+            if (function != NULL) {
+                if (i < function->value.function.param_count &&
+                    writes_parameter(function, i, search->cg, search->depth + 1)) {
+                    return true;
+                }
+            } else if (i == 0 && (strcmp(node->value.function_call.name, "append") == 0 ||
+                                  (find_array_builtin(node->value.function_call.name) != NULL &&
+                                   find_array_builtin(node->value.function_call.name)->result == ARRAY_RESULT_NULL))) {
+                return true;
+            }
+        }
+    }
+    return any_child(node, writes_sequence, search);
+}
+
+static bool writes_parameter(AstNode* function, int parameter, CodegenC* cg, int depth) {
+    // Calls nested this deep are assumed to write
+    if (depth > 8) return true;
+    ParameterWrite search = {cg, function->value.function.parameters[parameter]->value.parameter.name, depth};
+    return any_child(function->value.function.body, writes_sequence, &search);
+}
+
+static void scan_parallel_expression(ParallelBody* body, AstNode* node) {
+    if (node == NULL) return;
+    switch (node->type) {
+        case NODE_LITERAL:
+            if (is_identifier(node) && is_outer(body, node->value.literal.value)) {
+                capture(body, node->value.literal.value);
+                body->reads[body->read_count++] = (ParallelRead){node, node->value.literal.value, true, false};
+            }
+            return;
+
+        case NODE_INDEX: {
+            AstNode* target = node->value.index.target;
+            if (is_identifier(target) && is_outer(body, target->value.literal.value)) {
+                capture(body, target->value.literal.value);
+                body->reads[body->read_count++] = (ParallelRead){node, target->value.literal.value, false,
+                                                                 is_loop_index(body, node->value.index.index)};
+            } else {
+                scan_parallel_expression(body, target);
+            }
+            scan_parallel_expression(body, node->value.index.index);
+            return;
+        }
+
+        case NODE_UNARY_OP:
+            if (node->value.unary_op.operator == TOKEN_INCREMENT || node->value.unary_op.operator == TOKEN_DECREMENT) {
+                AstNode* operand = node->value.unary_op.operand;
+                AstNode* target = operand->type == NODE_INDEX ? operand->value.index.target : operand;
+                if (is_identifier(target) && is_outer(body, target->value.literal.value)) {
+                    parallel_error(body, node, "par for can only change %s as a statement of its own",
+                                   target->value.literal.value);
+                    return;
+                }
+            }
+            scan_parallel_expression(body, node->value.unary_op.operand);
+            return;
+
+        case NODE_FUNCTION_CALL: {
+            const char* name = node->value.function_call.name;
+            AstNode** arguments = node->value.function_call.arguments;
+            int count = node->value.function_call.argument_count;
+            AstNode* function = find_function(body->cg, name);
+            for (int i = 0; i < count; i++) {
+                AstNode* argument = arguments[i];
+                bool outer = is_identifier(argument) && is_outer(body, argument->value.literal.value);
+                if (function == NULL && i == 1 && (strcmp(name, "par_map") == 0 || strcmp(name, "par_reduce") == 0)) {
+                    continue;   // Names a function, not a variable
+                }
+                if (outer && function == NULL && i == 0 && strcmp(name, "len") == 0) {
+                    // Writing elements leaves the length as it is
+                    capture(body, argument->value.literal.value);
+                    continue;
+                }
+                if (outer && is_sequence_type(find_local(body->cg, argument->value.literal.value)->type)) {
+                    bool writes = function != NULL
+                                      ? i < function->value.function.param_count &&
+                                            writes_parameter(function, i, body->cg, 0)
+                                      : i == 0 && (strcmp(name, "append") == 0 ||
+                                                   (find_array_builtin(name) != NULL &&
+                                                    find_array_builtin(name)->result == ARRAY_RESULT_NULL));
+                    if (writes) {
+                        parallel_error(body, argument, "par for passes %s, which every iteration shares, to a call "
+                                                       "that changes it", argument->value.literal.value);
+                        continue;
+                    }
+                }
+                scan_parallel_expression(body, argument);
+            }
+            return;
+        }
+
+        default:
+            any_child(node, scan_parallel_child, body);
+            return;
+    }
+}
+
+static bool scan_parallel_child(AstNode* child, void* data) {
+    scan_parallel_expression(data, child);
+    return false;
+}
+
+// Write to the element of an outer sequence at index
+static void write_element(ParallelBody* body, AstNode* node, const char* name, AstNode* index) {
+    if (!is_loop_index(body, index)) {
+        parallel_error(body, node, "par for can write elements of %s only at its loop variable", name);
+        return;
+    }
+    capture(body, name);
+    if (!in_names(body->written, body->written_count, name)) body->written[body->written_count++] = name;
+}
+
+static void scan_parallel_assignment(ParallelBody* body, AstNode* node) {
+    const char* name = node->value.assignment.name;
+    AstNode* value = node->value.assignment.value;
+    if (!is_outer(body, name)) {
+        scan_parallel_expression(body, node->value.assignment.index);
+        scan_parallel_expression(body, value);
+        return;
+    }
+    if (node->value.assignment.index != NULL) {
+        write_element(body, node, name, node->value.assignment.index);
+        scan_parallel_expression(body, value);
+        return;
+    }
+
+    // total = total + x, total - x or total * x; x + total or x * total
+    TokenType operator = value->type == NODE_BINARY_OP ? value->value.binary_op.operator : TOKEN_EOF;
+    bool combines = operator == TOKEN_PLUS || operator == TOKEN_MINUS || operator == TOKEN_MULTIPLY;
+    AstNode* left = combines ? value->value.binary_op.left : NULL;
+    AstNode* right = combines ? value->value.binary_op.right : NULL;
+    bool on_left = combines && is_identifier(left) && strcmp(left->value.literal.value, name) == 0;
+    bool on_right = combines && operator != TOKEN_MINUS && is_identifier(right) &&
+                    strcmp(right->value.literal.value, name) == 0;
+    if (!on_left && !on_right) {
+        parallel_error(body, node, "par for can change %s, declared outside it, only as a reduction "
+                                   "such as total = total + x", name);
+        return;
+    }
+    add_reduction(body, node, name, operator == TOKEN_MULTIPLY ? TOKEN_MULTIPLY : TOKEN_PLUS);
+    scan_parallel_expression(body, on_left ? right : left);
+}
+
+static void scan_parallel_statement(ParallelBody* body, AstNode* node) {
+    if (node == NULL) return;
+    int scope = body->declared_count;
+    switch (node->type) {
+        case NODE_BLOCK:
+            for (int i = 0; i < node->value.block.statement_count; i++) {
+                scan_parallel_statement(body, node->value.block.statements[i]);
+            }
+            body->declared_count = scope;
+            return;
+
+        case NODE_VARIABLE:
+            scan_parallel_expression(body, node->value.variable.init_value);
+            declare_in_body(body, node->value.variable.name);
+            return;
+
+        case NODE_DESTRUCTURE:
+            scan_parallel_expression(body, node->value.destructure.value);
+            for (int i = 0; i < node->value.destructure.target_count; i++) {
+                declare_in_body(body, node->value.destructure.targets[i]->value.variable.name);
+            }
+            return;
+
+        case NODE_ASSIGNMENT:
+            scan_parallel_assignment(body, node);
+            return;
+
+        case NODE_UNARY_OP: {
+            // ++total and ++xs[i] as statements
+            AstNode* operand = node->value.unary_op.operand;
+            bool step = node->value.unary_op.operator == TOKEN_INCREMENT ||
+                        node->value.unary_op.operator == TOKEN_DECREMENT;
+            if (step && is_identifier(operand) && is_outer(body, operand->value.literal.value)) {
+                add_reduction(body, node, operand->value.literal.value, TOKEN_PLUS);
+                return;
+            }
+            AstNode* target = operand->type == NODE_INDEX ? operand->value.index.target : NULL;
+            if (step && is_identifier(target) && is_outer(body, target->value.literal.value)) {
+                write_element(body, node, target->value.literal.value, operand->value.index.index);
+                scan_parallel_expression(body, operand->value.index.index);
+                return;
+            }
+            scan_parallel_expression(body, node);
+            return;
+        }
+
+        case NODE_IF:
+            scan_parallel_expression(body, node->value.if_stmt.condition);
+            for (int i = 0; i < node->value.if_stmt.then_branches_count; i++) {
+                scan_parallel_statement(body, node->value.if_stmt.then_branches[i]);
+                body->declared_count = scope;
+            }
+            scan_parallel_statement(body, node->value.if_stmt.else_branch);
+            body->declared_count = scope;
+            return;
+
+        case NODE_WHILE:
+            scan_parallel_expression(body, node->value.while_stmt.condition);
+            scan_parallel_statement(body, node->value.while_stmt.body);
+            body->declared_count = scope;
+            return;
+
+        case NODE_FOR:
+            scan_parallel_expression(body, node->value.for_stmt.start);
+            scan_parallel_expression(body, node->value.for_stmt.end);
+            scan_parallel_expression(body, node->value.for_stmt.step);
+            declare_in_body(body, node->value.for_stmt.name);
+            scan_parallel_statement(body, node->value.for_stmt.body);
+            body->declared_count = scope;
+            return;
+
+        case NODE_SELECT:
+            for (int i = 0; i < node->value.select_stmt.case_count; i++) {
+                scan_parallel_statement(body, node->value.select_stmt.cases[i]);
+                scan_parallel_statement(body, node->value.select_stmt.bodies[i]);
+                body->declared_count = scope;
+            }
+            scan_parallel_statement(body, node->value.select_stmt.else_branch);
+            body->declared_count = scope;
+            return;
+
+        case NODE_RETURN:
+            codegen_error(body->cg, node, "A par for body cannot return");
+            return;
+
+        default:
+            scan_parallel_expression(body, node);
+            return;
+    }
+}
+
+// Reads that could see what other iterations write
+static void check_parallel_reads(ParallelBody* body) {
+    for (int i = 0; i < body->read_count; i++) {
+        ParallelRead* read = &body->reads[i];
+        if (find_reduction(body, read->name) != NULL) {
+            parallel_error(body, read->node, "par for reads %s, a reduction variable, outside its own update",
+                           read->name);
+        } else if (in_names(body->written, body->written_count, read->name)) {
+            if (read->whole) {
+                parallel_error(body, read->node, "par for reads all of %s while its iterations write elements of it",
+                               read->name);
+            } else if (!read->at_index) {
+                parallel_error(body, read->node, "par for reads %s at another index than the one it writes",
+                               read->name);
+            }
+        }
+    }
+}
+
+static bool count_nodes(AstNode* node, void* data) {
+    *(int*)data += node->type == NODE_DESTRUCTURE ? 1 + node->value.destructure.target_count : 1;
+    return any_child(node, count_nodes, data);
+}
+
+// into = into + from, or into * from, at the reduction's type
+static void emit_reduction_combine(CodegenC* cg, ParallelReduction* reduction, const char* into, const char* from,
+                                   int line, int indent) {
+    emit_indent(cg, indent);
+    const char* operation = reduction->operator == TOKEN_MULTIPLY ? "mul" : "add";
+    if (is_float_type(reduction->type)) {
+        fprintf(cg->out, "%s = %s %s %s;\n", into, into, c_operator(reduction->operator), from);
+        return;
+    }
+    fprintf(cg->out, "%s = ", into);
+    emit_arith_function(cg, operation, reduction->type);
+    fprintf(cg->out, "%s, %s", into, from);
+    if (cg->overflow_mode == PF_OVERFLOW_CHECKED) fprintf(cg->out, ", %d", line);
+    fputs(");\n", cg->out);
+}
+
+// The chunk body of a par for: it copies the variables the body reads,
+// starts its own copy of each reduction variable, and runs its iterations
+static void emit_parallel_body(CodegenC* cg, AstNode* node, ParallelBody* body, int temp, int spawn) {
+    bool reduces = body->reduction_count > 0;
+    fputs("typedef struct {\n    int64_t start;\n    int64_t step;\n", cg->out);
+    for (int i = 0; i < body->captured_count; i++) {
+        const char* name = body->captured[i];
+        fprintf(cg->out, "    %s %s;\n", c_type_name(find_local(cg, name)->type), name);
+    }
+    fprintf(cg->out, "} pf_par_args_%d;\n\n", spawn);
+    if (reduces) {
+        fputs("typedef struct {\n", cg->out);
+        for (int i = 0; i < body->reduction_count; i++) {
+            fprintf(cg->out, "    %s %s;\n", c_type_name(body->reductions[i].type), body->reductions[i].name);
+        }
+        fprintf(cg->out, "} pf_par_partial_%d;\n\n", spawn);
+    }
+
+    fprintf(cg->out, "static void pf_par_body_%d(void* pf_context, int64_t pf_first, int64_t pf_last%s) {\n", spawn,
+            reduces ? ", void* pf_partial" : "");
+    fprintf(cg->out, "    pf_par_args_%d* pf_par = pf_context;\n", spawn);
+    fprintf(cg->out, "    const int64_t pf_start_%d = pf_par->start;\n", temp);
+    fprintf(cg->out, "    const int64_t pf_step_%d = pf_par->step;\n", temp);
+    for (int i = 0; i < body->captured_count; i++) {
+        const char* name = body->captured[i];
+        fprintf(cg->out, "    %s %s = pf_par->%s;\n", c_type_name(find_local(cg, name)->type), name, name);
+    }
+    for (int i = 0; i < body->reduction_count; i++) {
+        ParallelReduction* reduction = &body->reductions[i];
+        fprintf(cg->out, "    %s %s = %s;\n", c_type_name(reduction->type), reduction->name,
+                reduction->operator == TOKEN_MULTIPLY ? "1" : "0");
+    }
+    fprintf(cg->out, "    for (uint64_t pf_k_%d = (uint64_t)pf_first; pf_k_%d < (uint64_t)pf_last; pf_k_%d++) {\n",
+            temp, temp, temp);
+    emit_safepoint(cg, 2);
+    char offset[32];
+    snprintf(offset, sizeof(offset), "pf_k_%d", temp);
+    emit_iteration(cg, node, offset, temp, 2);
+    fputs("    }\n", cg->out);
+    if (reduces) {
+        fprintf(cg->out, "    pf_par_partial_%d* pf_result = pf_partial;\n", spawn);
+        for (int i = 0; i < body->reduction_count; i++) {
+            fprintf(cg->out, "    pf_result->%s = %s;\n", body->reductions[i].name, body->reductions[i].name);
+        }
+    }
+    fputs("}\n\n", cg->out);
+
+    if (!reduces) return;
+    fprintf(cg->out, "static void pf_par_combine_%d(void* pf_context, void* pf_into, const void* pf_from) {\n", spawn);
+    fprintf(cg->out, "    (void)pf_context;\n    pf_par_partial_%d* pf_result = pf_into;\n", spawn);
+    fprintf(cg->out, "    const pf_par_partial_%d* pf_chunk = pf_from;\n", spawn);
+    for (int i = 0; i < body->reduction_count; i++) {
+        char into[96];
+        char from[96];
+        snprintf(into, sizeof(into), "pf_result->%s", body->reductions[i].name);
+        snprintf(from, sizeof(from), "pf_chunk->%s", body->reductions[i].name);
+        emit_reduction_combine(cg, &body->reductions[i], into, from, node->line, 1);
+    }
+    fputs("}\n\n", cg->out);
+}
+
+// Whether the body reads name at all, and whether anywhere other than at
+// the loop variable
+static bool reads_sequence(ParallelBody* body, const char* name, bool* freely) {
+    bool reads = false;
+    *freely = false;
+    for (int i = 0; i < body->read_count; i++) {
+        if (strcmp(body->reads[i].name, name) != 0) continue;
+        reads = true;
+        if (body->reads[i].whole || !body->reads[i].at_index) *freely = true;
+    }
+    return reads;
+}
+
+// One sequence's elements for pf_same_or_disjoint and pf_disjoint
+static void emit_sequence_extent(CodegenC* cg, const char* name) {
+    const char* access = type_kind(find_local(cg, name)->type) == TYPE_LIST ? "->" : ".";
+    fprintf(cg->out, "%s%sdata, %s%slength", name, access, name, access);
+}
+
+// The checks above go by name, yet a slice shares its elements with the
+// sequence it was taken from. Each written sequence must therefore be the
+// same view as, or share nothing with, every other sequence of its element
+// type that the body touches only at the loop variable, and must share
+// nothing with one it reads anywhere else. Emits the test, if any pair
+// needs one, and returns whether it did.
+static bool emit_parallel_overlap_test(CodegenC* cg, ParallelBody* body, int indent) {
+    int conditions = 0;
+    for (int w = 0; w < body->written_count; w++) {
+        const char* written = body->written[w];
+        DataType element = type_element(find_local(cg, written)->type);
+        for (int c = 0; c < body->captured_count; c++) {
+            const char* other = body->captured[c];
+            DataType type = find_local(cg, other)->type;
+            if (strcmp(other, written) == 0 || !is_sequence_type(type) || type_element(type) != element) continue;
+            // A pair of written sequences is tested once
+            int seen = 0;
+            while (seen < w && strcmp(body->written[seen], other) != 0) {
+                seen++;
+            }
+            if (seen < w) continue;
+            // Taking only its length touches no element
+            bool freely;
+            bool reads = reads_sequence(body, other, &freely);
+            if (!reads && !in_names(body->written, body->written_count, other)) continue;
+
+            if (conditions++ == 0) {
+                emit_indent(cg, indent);
+                fputs("if (", cg->out);
+            } else {
+                fputs(" && ", cg->out);
+            }
+            fputs(freely ? "pf_disjoint(" : "pf_same_or_disjoint(", cg->out);
+            emit_sequence_extent(cg, written);
+            fputs(", ", cg->out);
+            emit_sequence_extent(cg, other);
+            fprintf(cg->out, ", sizeof(*%s%sdata))", written,
+                    type_kind(find_local(cg, written)->type) == TYPE_LIST ? "->" : ".");
+        }
+    }
+    if (conditions > 0) fputs(") {\n", cg->out);
+    return conditions > 0;
+}
+
+// par for: the body is checked, then moved into a chunk function written
+// with the helpers, and the loop becomes one call into pf_par.h
+static void emit_par_for(CodegenC* cg, AstNode* node, int indent) {
+    if (!check_range(cg, node)) return;
+
+    int capacity = 1;
+    count_nodes(node->value.for_stmt.body, &capacity);
+    ParallelBody body = {cg, node, NULL, 0, NULL, 0, NULL, 0, NULL, 0, NULL, 0, capacity};
+    body.declared = malloc(sizeof(const char*) * capacity);
+    body.captured = malloc(sizeof(const char*) * capacity);
+    body.written = malloc(sizeof(const char*) * capacity);
+    body.reads = malloc(sizeof(ParallelRead) * capacity);
+    body.reductions = malloc(sizeof(ParallelReduction) * capacity);
+    declare_in_body(&body, node->value.for_stmt.name);
+
+    bool had_error = cg->had_error;
+    cg->had_error = false;
+    scan_parallel_statement(&body, node->value.for_stmt.body);
+    check_parallel_reads(&body);
+    bool accepted = !cg->had_error;
+    cg->had_error = cg->had_error || had_error;
+
+    if (accepted) {
+        int temp = cg->temp_count++;
+        int spawn = cg->spawn_count++;
+
+        // The chunk function is buffered apart, since the helpers of what
+        // its body holds go ahead of it
+        char* code = NULL;
+        size_t size = 0;
+        FILE* out = cg->out;
+        bool region = cg->region;
+        bool parallel = cg->parallel;
+        cg->out = open_memstream(&code, &size);
+        cg->region = false;
+        cg->parallel = true;
+        emit_parallel_body(cg, node, &body, temp, spawn);
+        fclose(cg->out);
+        fwrite(code, 1, size, cg->helpers);
+        free(code);
+        cg->out = out;
+        cg->region = region;
+        cg->parallel = parallel;
+
+        emit_indent(cg, indent);
+        fputs("{\n", cg->out);
+        emit_range(cg, node, temp, indent + 1);
+        emit_indent(cg, indent + 1);
+        fprintf(cg->out, "pf_par_args_%d pf_par_%d = {pf_start_%d, pf_step_%d", spawn, spawn, temp, temp);
+        for (int i = 0; i < body.captured_count; i++) {
+            fprintf(cg->out, ", %s", body.captured[i]);
+        }
+        fputs("};\n", cg->out);
+        if (body.reduction_count > 0) {
+            emit_indent(cg, indent + 1);
+            fprintf(cg->out, "pf_par_partial_%d pf_partial_%d = {", spawn, spawn);
+            for (int i = 0; i < body.reduction_count; i++) {
+                fprintf(cg->out, "%s%s", i > 0 ? ", " : "", body.reductions[i].operator == TOKEN_MULTIPLY ? "1" : "0");
+            }
+            fputs("};\n", cg->out);
+        }
+        bool tested = emit_parallel_overlap_test(cg, &body, indent + 1);
+        emit_indent(cg, indent + 1 + tested);
+        if (body.reduction_count == 0) {
+            fprintf(cg->out, "pf_parallel_for((int64_t)pf_count_%d, pf_par_body_%d, &pf_par_%d);\n", temp, spawn,
+                    spawn);
+        } else {
+            fprintf(cg->out, "pf_parallel_reduce((int64_t)pf_count_%d, pf_par_body_%d, pf_par_combine_%d, &pf_par_%d, "
+                             "&pf_partial_%d, sizeof(pf_partial_%d));\n", temp, spawn, spawn, spawn, spawn, spawn);
+        }
+        if (tested) {
+            // Overlapping views: one chunk of every iteration, in order, as a plain for would
+            emit_indent(cg, indent + 1);
+            fputs("} else {\n", cg->out);
+            emit_indent(cg, indent + 2);
+            fprintf(cg->out, "pf_par_body_%d(&pf_par_%d, 0, (int64_t)pf_count_%d", spawn, spawn, temp);
+            if (body.reduction_count > 0) fprintf(cg->out, ", &pf_partial_%d", spawn);
+            fputs(");\n", cg->out);
+            emit_indent(cg, indent + 1);
+            fputs("}\n", cg->out);
+        }
+        for (int i = 0; i < body.reduction_count; i++) {
+            char from[96];
+            snprintf(from, sizeof(from), "pf_partial_%d.%s", spawn, body.reductions[i].name);
+            emit_reduction_combine(cg, &body.reductions[i], body.reductions[i].name, from, node->line, indent + 1);
+        }
+        emit_indent(cg, indent);
+        fputs("}\n", cg->out);
+    }
+
+    free(body.declared);
+    free(body.captured);
+    free(body.written);
+    free(body.reads);
+    free(body.reductions);
+}
+
+static void emit_assignment(CodegenC* cg, AstNode* node, int indent) {
+    CodegenLocal* local = find_local(cg, node->value.assignment.name);
+    if (local == NULL) {
+        codegen_error(cg, node, "Assignment to undeclared variable");
+        return;
+    }
+
+    emit_indent(cg, indent);
+    if (node->value.assignment.index != NULL) {
+        // xs[i] = value stores through the checked element pointer; a
+        // string goes through the collector's write barrier
+        bool barrier = is_sequence_type(local->type) && type_element(local->type) == TYPE_STR;
+        fputs(barrier ? "pf_gc_store_string(" : "*", cg->out);
+        emit_element_pointer(cg, NULL, local->name, node->value.assignment.index, node);
+        fputs(barrier ? ", " : " = ", cg->out);
+        emit_value(cg, node->value.assignment.value,
+                   is_sequence_type(local->type) ? type_element(local->type) : local->type);
+        fputs(barrier ? ");\n" : ";\n", cg->out);
+        return;
+    }
+
+    fprintf(cg->out, "%s = ", node->value.assignment.name);
+    emit_value(cg, node->value.assignment.value, local->type);
+    fputs(";\n", cg->out);
+}
+
+// "T value, bool ok = recv(c)": ok is false once c is closed and empty
+static void emit_recv_ok(CodegenC* cg, AstNode* node, int indent) {
+    AstNode* call = node->value.destructure.value;
+    AstNode* value = node->value.destructure.targets[0];
+    AstNode* ok = node->value.destructure.targets[1];
+    if (node->value.destructure.target_count != 2 || call->value.function_call.argument_count != 1) {
+        codegen_error(cg, node, "recv() gives a value and whether the channel is open");
+        return;
+    }
+    DataType element = chan_element(cg, call->value.function_call.arguments[0]);
+    if (element == TYPE_NULL) return;
+    DataType type = value->value.variable.type;
+    if (c_type_name(type) == NULL || type > TYPE_BOOL || (type == TYPE_STR) != (element == TYPE_STR)) {
+        codegen_error(cg, value, "Variable type does not match the element type");
+        return;
+    }
+    if (ok->value.variable.type != TYPE_BOOL) {
+        codegen_error(cg, ok, "The second value of recv() is a bool");
+        return;
+    }
+
+    emit_indent(cg, indent);
+    fprintf(cg->out, "bool %s;\n", ok->value.variable.name);
+    emit_indent(cg, indent);
+    fprintf(cg->out, "%s %s = pf_chan_%s_recv_ok(", c_type_name(type), value->value.variable.name,
+            element_suffix(element));
+    emit_expression(cg, call->value.function_call.arguments[0]);
+    fprintf(cg->out, ", &%s, %d);\n", ok->value.variable.name, call->line);
+    add_local(cg, value->value.variable.name, type);
+    add_local(cg, ok->value.variable.name, TYPE_BOOL);
+}
+
+// The tuple comes back by value (in registers for two words) and is
+// unpacked straight into the declared locals
+static void emit_destructure(CodegenC* cg, AstNode* node, int indent) {
+    AstNode* call = node->value.destructure.value;
+    AstNode* function = find_function(cg, call->value.function_call.name);
+    int count = node->value.destructure.target_count;
+    if (function == NULL && strcmp(call->value.function_call.name, "recv") == 0) {
+        emit_recv_ok(cg, node, indent);
+        return;
+    }
+    if (function == NULL || !returns_tuple(function) || function->value.function.return_type_count != count) {
+        codegen_error(cg, node, "Call does not return as many values as are declared");
+        return;
+    }
+
+    int temp = cg->temp_count++;
+    emit_indent(cg, indent);
+    fprintf(cg->out, "pf_ret_%s pf_tuple_%d = ", function->value.function.name, temp);
+    emit_call(cg, call);
+    fputs(";\n", cg->out);
+
+    for (int i = 0; i < count; i++) {
+        AstNode* target = node->value.destructure.targets[i];
+        DataType type = target->value.variable.type;
+        const char* c_type = c_type_name(type);
+        if (c_type == NULL || type == TYPE_NULL) {
+            codegen_error(cg, target, "Unsupported variable type");
+            return;
+        }
+        if ((type == TYPE_ERROR) != (function->value.function.return_types[i] == TYPE_ERROR)) {
+            codegen_error(cg, target, "Variable type does not match the returned value");
+            return;
+        }
+
+        emit_indent(cg, indent);
+        fprintf(cg->out, "%s %s = pf_tuple_%d.v%d;\n", c_type, target->value.variable.name, temp, i);
+        add_local(cg, target->value.variable.name, type);
+    }
+}
+
+// go f(args): the arguments are evaluated here and copied to the new
+// task, which calls f through a trampoline written with the helpers
+static void emit_go(CodegenC* cg, AstNode* node, int indent) {
+    AstNode* call = node->value.go_stmt.call;
+    AstNode* function = find_function(cg, call->value.function_call.name);
+    if (function == NULL) {
+        codegen_error(cg, node, "Only functions of the program can run with go");
+        return;
+    }
+    int count = function->value.function.param_count;
+    if (count != call->value.function_call.argument_count) {
+        codegen_error(cg, call, "Wrong number of arguments");
+        return;
+    }
+
+    int spawn = cg->spawn_count++;
+    AstNode** parameters = function->value.function.parameters;
+    fputs("typedef struct {\n", cg->helpers);
+    for (int i = 0; i < count; i++) {
+        fprintf(cg->helpers, "    %s a%d;\n", c_type_name(parameters[i]->value.parameter.type), i);
+    }
+    if (count == 0) fputs("    char unused;\n", cg->helpers);
+    fprintf(cg->helpers, "} pf_go_args_%d;\n\n", spawn);
+    fprintf(cg->helpers, "static void pf_go_%d(void* pf_arguments) {\n", spawn);
+    fprintf(cg->helpers, "    pf_go_args_%d* pf_go = pf_arguments;\n", spawn);
+    fprintf(cg->helpers, "    (void)pf_go;\n    pf_fn_%s(", function->value.function.name);
+    for (int i = 0; i < count; i++) {
+        fprintf(cg->helpers, "%spf_go->a%d", i > 0 ? ", " : "", i);
+    }
+    fputs(");\n}\n\n", cg->helpers);
+
+    emit_indent(cg, indent);
+    fputs("{\n", cg->out);
+    emit_indent(cg, indent + 1);
+    fprintf(cg->out, "pf_go_args_%d pf_go = {", spawn);
+    for (int i = 0; i < count; i++) {
+        if (i > 0) fputs(", ", cg->out);
+        emit_value(cg, call->value.function_call.arguments[i], parameters[i]->value.parameter.type);
+    }
+    fputs(count == 0 ? "0};\n" : "};\n", cg->out);
+    emit_indent(cg, indent + 1);
+    fprintf(cg->out, "pf_task_spawn_at(pf_go_%d, &pf_go, sizeof(pf_go), %d);\n", spawn, node->line);
+    emit_indent(cg, indent);
+    fputs("}\n", cg->out);
+}
+
+// The send or recv call of a select case, which may declare variables
+// from what it receives
+static AstNode* select_operation(AstNode* head) {
+    if (head->type == NODE_VARIABLE) return head->value.variable.init_value;
+    if (head->type == NODE_DESTRUCTURE) return head->value.destructure.value;
+    return head;
+}
+
+// select: every channel and value to send is evaluated first, then
+// pf_chan_select carries out one operation and the chain of ifs runs its
+// body; the received value sits in the case's temporary until then
+static void emit_select(CodegenC* cg, AstNode* node, int indent) {
+    int count = node->value.select_stmt.case_count;
+    int select = cg->temp_count++;
+    DataType* elements = malloc(sizeof(DataType) * count);
+
+    emit_indent(cg, indent);
+    fputs("{\n", cg->out);
+    emit_indent(cg, indent + 1);
+    fprintf(cg->out, "pf_chan_case pf_cases_%d[%d];\n", select, count);
+    for (int i = 0; i < count; i++) {
+        AstNode* call = select_operation(node->value.select_stmt.cases[i]);
+        bool is_send = strcmp(call->value.function_call.name, "send") == 0;
+        if (find_function(cg, call->value.function_call.name) != NULL) {
+            codegen_error(cg, call, "select cases use the builtin send and recv");
+            free(elements);
+            return;
+        }
+        AstNode** arguments = call->value.function_call.arguments;
+        elements[i] = chan_element(cg, arguments[0]);
+        if (elements[i] == TYPE_NULL) {
+            free(elements);
+            return;
+        }
+
+        emit_indent(cg, indent + 1);
+        fprintf(cg->out, "%s pf_sel_%d_%d", c_type_name(elements[i]), select, i);
+        if (is_send) {
+            if ((infer_type(cg, arguments[1]) == TYPE_STR) != (elements[i] == TYPE_STR)) {
+                codegen_error(cg, arguments[1], "Value does not match the element type");
+                free(elements);
+                return;
+            }
+            fputs(" = ", cg->out);
+            emit_value(cg, arguments[1], elements[i]);
+        }
+        fputs(";\n", cg->out);
+        emit_indent(cg, indent + 1);
+        fprintf(cg->out, "pf_cases_%d[%d] = (pf_chan_case){", select, i);
+        emit_expression(cg, arguments[0]);
+        fprintf(cg->out, ", %s, &pf_sel_%d_%d};\n", is_send ? "true" : "false", select, i);
+    }
+    emit_indent(cg, indent + 1);
+    fprintf(cg->out, "bool pf_sel_ok_%d;\n", select);
+    emit_indent(cg, indent + 1);
+    fprintf(cg->out, "int pf_sel_%d = pf_chan_select(pf_cases_%d, %d, %s, &pf_sel_ok_%d, %d);\n", select, select,
+            count, node->value.select_stmt.else_branch != NULL ? "false" : "true", select, node->line);
+
+    // An if chain rather than a switch, so break and continue in a body
+    // still reach an enclosing loop
+    for (int i = 0; i < count; i++) {
+        AstNode* head = node->value.select_stmt.cases[i];
+        emit_indent(cg, indent + 1);
+        fprintf(cg->out, "%sif (pf_sel_%d == %d) {\n", i > 0 ? "} else " : "", select, i);
+        int scope = cg->local_count;
+        AstNode* targets[2] = {NULL, NULL};
+        if (head->type == NODE_VARIABLE) {
+            targets[0] = head;
+        } else if (head->type == NODE_DESTRUCTURE) {
+            targets[0] = head->value.destructure.targets[0];
+            targets[1] = head->value.destructure.targets[1];
+        }
+        if (targets[0] != NULL) {
+            DataType type = targets[0]->value.variable.type;
+            if (c_type_name(type) == NULL || type > TYPE_BOOL || (type == TYPE_STR) != (elements[i] == TYPE_STR)) {
+                codegen_error(cg, targets[0], "Variable type does not match the element type");
+            } else {
+                emit_indent(cg, indent + 2);
+                fprintf(cg->out, "%s %s = pf_sel_%d_%d;\n", c_type_name(type), targets[0]->value.variable.name,
+                        select, i);
+                add_local(cg, targets[0]->value.variable.name, type);
+            }
+        }
+        if (targets[1] != NULL) {
+            if (targets[1]->value.variable.type != TYPE_BOOL) {
+                codegen_error(cg, targets[1], "The second value of recv() is a bool");
+            } else {
+                emit_indent(cg, indent + 2);
+                fprintf(cg->out, "bool %s = pf_sel_ok_%d;\n", targets[1]->value.variable.name, select);
+                add_local(cg, targets[1]->value.variable.name, TYPE_BOOL);
+            }
+        }
+        emit_block(cg, node->value.select_stmt.bodies[i], indent + 2);
+        cg->local_count = scope;
+    }
+    if (node->value.select_stmt.else_branch != NULL) {
+        emit_indent(cg, indent + 1);
+        fputs("} else {\n", cg->out);
+        emit_block(cg, node->value.select_stmt.else_branch, indent + 2);
+    }
+    emit_indent(cg, indent + 1);
+    fputs("}\n", cg->out);
+    emit_indent(cg, indent);
+    fputs("}\n", cg->out);
+    free(elements);
+}
+
+static void emit_statement(CodegenC* cg, AstNode* node, int indent) {
+    emit_line_directive(cg, node);
+
+    switch (node->type) {
+        case NODE_RETURN:
+            emit_return(cg, node, indent);
+            break;
+        case NODE_VARIABLE:
+            emit_variable(cg, node, indent);
+            break;
+        case NODE_IF:
+            emit_if(cg, node, indent);
+            break;
+        case NODE_WHILE:
+            emit_while(cg, node, indent);
+            break;
+        case NODE_FOR:
+            (node->value.for_stmt.parallel ? emit_par_for : emit_for)(cg, node, indent);
+            break;
+        case NODE_ASSIGNMENT:
+            emit_assignment(cg, node, indent);
+            break;
+        case NODE_DESTRUCTURE:
+            emit_destructure(cg, node, indent);
+            break;
+        case NODE_BLOCK:
+            emit_block(cg, node, indent);
+            break;
+        case NODE_GO:
+            emit_go(cg, node, indent);
+            break;
+        case NODE_SELECT:
+            emit_select(cg, node, indent);
+            break;
+        default:
+            emit_indent(cg, indent);
+            emit_expression(cg, node);
+            fputs(";\n", cg->out);
+            break;
+    }
+}
+
+static bool inlined_everywhere(CodegenC* cg, AstNode* function) {
+    for (int i = 0; i < cg->program->value.block.statement_count; i++) {
+        if (cg->program->value.block.statements[i] == function) return cg->always_inline[i];
+    }
+    return false;
+}
+
+static void emit_signature(CodegenC* cg, AstNode* function) {
+    const char* name = function->value.function.name;
+    const char* qualifiers = inlined_everywhere(cg, function) ? "static PF_ALWAYS_INLINE" : "static";
+    if (cg->perf_symbols != NULL) {
+        qualifiers = inlined_everywhere(cg, function) ? "static PF_ALWAYS_INLINE PF_PERF_CODE" : "static PF_PERF_CODE";
+    }
+
+    if (returns_tuple(function)) {
+        fprintf(cg->out, "%s pf_ret_%s pf_fn_%s(", qualifiers, name, name);
+    } else {
+        fprintf(cg->out, "%s %s pf_fn_%s(", qualifiers, c_type_name(function->value.function.return_types[0]),
+                name);
+    }
+
+    if (function->value.function.param_count == 0) {
+        fputs("void", cg->out);
+    }
+    for (int i = 0; i < function->value.function.param_count; i++) {
+        AstNode* param = function->value.function.parameters[i];
+        const char* c_type = c_type_name(param->value.parameter.type);
+        if (c_type == NULL || param->value.parameter.type == TYPE_NULL) {
+            codegen_error(cg, param, "Unsupported parameter type");
+            c_type = "int";
+        }
+        if (i > 0) fputs(", ", cg->out);
+        fprintf(cg->out, "%s %s", c_type, param->value.parameter.name);
+    }
+    fputs(")", cg->out);
+}
+
+// Whether node holds a go statement, a par for, or a call of par_map or
+// par_reduce, any of which runs code on the task pool
+static bool starts_tasks(AstNode* node, void* data) {
+    CodegenC* cg = data;
+    if (node->type == NODE_GO || (node->type == NODE_FOR && node->value.for_stmt.parallel)) return true;
+    if (is_sequence_call(cg, node, "par_map") || is_sequence_call(cg, node, "par_reduce")) return true;
+    return any_child(node, starts_tasks, cg);
+}
+
+// Multiple return values come back as a struct by value
+static void emit_tuple_struct(CodegenC* cg, AstNode* function) {
+    fputs("typedef struct {\n", cg->out);
+    for (int i = 0; i < function->value.function.return_type_count; i++) {
+        DataType type = function->value.function.return_types[i];
+        const char* c_type = c_type_name(type);
+        if (c_type == NULL || type == TYPE_NULL) {
+            codegen_error(cg, function, "Unsupported return type");
+            c_type = "int";
+        }
+        fprintf(cg->out, "    %s v%d;\n", c_type, i);
+    }
+    fprintf(cg->out, "} pf_ret_%s;\n\n", function->value.function.name);
+}
+
+static void begin_function(CodegenC* cg, AstNode* function) {
+    cg->function = function;
+    cg->local_count = 0;
+    cg->region = false;
+    for (int i = 0; i < function->value.function.param_count; i++) {
+        AstNode* param = function->value.function.parameters[i];
+        add_local(cg, param->value.parameter.name, param->value.parameter.type);
+    }
+}
+
+// The one C function of a group of functions that tail-call each other:
+// pf_entry picks the member to start in, and each member copies the
+// parameters from pf_arg_* into its own names when it is entered
+static void emit_tail_group(CodegenC* cg, int group) {
+    int count = cg->program->value.block.statement_count;
+    AstNode** functions = cg->program->value.block.statements;
+    AstNode* first = functions[group];
+    DataType return_type = first->value.function.return_types[0];
+
+    fprintf(cg->out, "static %s pf_tail_%s(int pf_entry", c_type_name(return_type), first->value.function.name);
+    for (int i = 0; i < first->value.function.param_count; i++) {
+        fprintf(cg->out, ", %s pf_arg_%d", c_type_name(first->value.function.parameters[i]->value.parameter.type), i);
+    }
+    fputs(") {\n    switch (pf_entry) {\n", cg->out);
+    int entry = 0;
+    for (int i = 0; i < count; i++) {
+        if (cg->tail_groups[i] != group) continue;
+        fprintf(cg->out, "        case %d: goto pf_enter_%s;\n", entry++, functions[i]->value.function.name);
+    }
+    fputs("    }\n", cg->out);
+
+    for (int i = 0; i < count; i++) {
+        if (cg->tail_groups[i] != group) continue;
+        AstNode* function = functions[i];
+        begin_function(cg, function);
+        emit_line_directive(cg, function);
+        fprintf(cg->out, "pf_enter_%s: {\n", function->value.function.name);
+        for (int p = 0; p < function->value.function.param_count; p++) {
+            AstNode* param = function->value.function.parameters[p];
+            fprintf(cg->out, "    %s %s = pf_arg_%d;\n", c_type_name(param->value.parameter.type),
+                    param->value.parameter.name, p);
+        }
+        emit_block(cg, function->value.function.body, 1);
+        // A null function ending without a return must not run into the next member
+        if (return_type == TYPE_NULL) fputs("    return;\n", cg->out);
+        fputs("}\n", cg->out);
+    }
+    fputs("}\n\n", cg->out);
+}
+
+// Frame slots for the arrays of the function being emitted that live in
+// its frame, and its region if anything lives there
+static void emit_allocation_storage(CodegenC* cg) {
+    for (int i = 0; i < cg->allocation_count; i++) {
+        IrAllocation* allocation = &cg->allocations[i];
+        if (allocation->function != cg->function) continue;
+        int slot;
+        IrPlacement placement = allocation_placement(cg, allocation->source, &slot);
+        if (placement == IR_PLACE_FRAME) {
+            fprintf(cg->out, "    %s pf_frame_%d[%lld];\n", c_type_name(type_element(allocation->type)), i,
+                    (long long)allocation->length + 1);
+        } else if (placement == IR_PLACE_REGION && !cg->region) {
+            fputs("    pf_region pf_region = PF_REGION_INIT;\n", cg->out);
+            cg->region = true;
+        }
+    }
+}
+
+// Add a function to the table the program registers with perf
+static void add_perf_symbol(CodegenC* cg, AstNode* function) {
+    if (cg->perf_symbols == NULL) return;
+    char name[512];
+    perf_symbol_name(name, sizeof(name), function, cg->source_file);
+    fprintf(cg->perf_symbols, "    {(const void*)pf_fn_%s, ", function->value.function.name);
+    emit_c_string(cg->perf_symbols, name);
+    fprintf(cg->perf_symbols, ", %d},\n", function->line);
+    cg->perf_symbol_count++;
+}
+
+static void emit_function(CodegenC* cg, AstNode* function) {
+    int index = function_index(cg, function);
+    add_perf_symbol(cg, function);
+    int group = index >= 0 ? cg->tail_groups[index] : -1;
+    if (group >= 0) {
+        if (group == index) emit_tail_group(cg, group);
+
+        // Members of a group are entry points into its C function
+        int entry = 0;
+        for (int i = 0; i < index; i++) {
+            if (cg->tail_groups[i] == group) entry++;
+        }
+        emit_signature(cg, function);
+        fprintf(cg->out, " {\n    %spf_tail_%s(%d",
+                function->value.function.return_types[0] == TYPE_NULL ? "" : "return ",
+                cg->program->value.block.statements[group]->value.function.name, entry);
+        for (int i = 0; i < function->value.function.param_count; i++) {
+            fprintf(cg->out, ", %s", function->value.function.parameters[i]->value.parameter.name);
+        }
+        fputs(");\n}\n\n", cg->out);
+        return;
+    }
+
+    begin_function(cg, function);
+    emit_line_directive(cg, function);
+    emit_signature(cg, function);
+    fputs(" {\n", cg->out);
+    emit_allocation_storage(cg);
+    if (index >= 0 && cg->tail_loops[index]) fputs("pf_tail_call:;\n", cg->out);
+    emit_block(cg, function->value.function.body, 1);
+    AstNode* body = function->value.function.body;
+    int statement_count = body->value.block.statement_count;
+    bool falls_off = statement_count == 0 || body->value.block.statements[statement_count - 1]->type != NODE_RETURN;
+    if (cg->region && falls_off && function->value.function.return_types[0] == TYPE_NULL) {
+        fputs("    pf_region_free(&pf_region);\n", cg->out);
+    }
+    fputs("}\n\n", cg->out);
+}
+
+static void emit_literal_table(CodegenC* cg, FILE* out) {
+    if (cg->literal_count == 0) return;
+
+    fprintf(out, "static pf_string pf_literals[%d];\n\n", cg->literal_count);
+    fputs("static void pf_intern_literals(void) {\n", out);
+    for (int i = 0; i < cg->literal_count; i++) {
+        fprintf(out, "    pf_literals[%d] = PF_STRING_LITERAL(%s);\n", i, cg->literals[i]);
+    }
+    fputs("}\n\n", out);
+}
+
+static void emit_entry_point(CodegenC* cg, AstNode* main_function) {
+    DataType type = main_function->value.function.return_types[0];
+    bool returns_int = !returns_tuple(main_function) && (is_signed_type(type) || is_unsigned_type(type));
+
+    fputs("int main(void) {\n", cg->out);
+    fputs("    pf_runtime_init();\n", cg->out);
+    if (cg->perf_symbols != NULL) {
+        fprintf(cg->out, "    pf_perf_register(pf_perf_symbols, %d, __stop_pf_code, ", cg->perf_symbol_count);
+        emit_c_string(cg->out, cg->source_file != NULL ? cg->source_file : "");
+        fputs(");\n", cg->out);
+    }
+    if (cg->literal_count > 0) {
+        fputs("    pf_intern_literals();\n", cg->out);
+    }
+    fprintf(cg->out, "    %spf_fn_main();\n", returns_int ? "int status = (int)" : "");
+    if (cg->call_sites != NULL) {
+        fprintf(cg->out, "    pf_write_call_profile(pf_call_sites, pf_call_counts, %d);\n", cg->call_site_count);
+    }
+    fputs("    pf_runtime_shutdown();\n", cg->out);
+    fprintf(cg->out, "    return %s;\n", returns_int ? "status" : "0");
+    fputs("}\n", cg->out);
+}
+
+bool codegen_c_emit(AstNode* program, const char* source_file, pf_overflow_mode overflow_mode, FILE* out) {
+    CodegenCOptions options = {.overflow_mode = overflow_mode};
+    return codegen_c_emit_with_options(program, source_file, &options, out);
+}
+
+bool codegen_c_emit_with_options(AstNode* program, const char* source_file, const CodegenCOptions* options,
+                                 FILE* out) {
+    CodegenC cg;
+    cg.out = out;
+    cg.source_file = source_file;
+    cg.overflow_mode = options->overflow_mode;
+    cg.program = program;
+    cg.function = NULL;
+    cg.locals = NULL;
+    cg.local_count = 0;
+    cg.local_capacity = 0;
+    cg.helpers = NULL;
+    cg.format_count = 0;
+    cg.temp_count = 0;
+    cg.literals = NULL;
+    cg.literal_count = 0;
+    cg.literal_capacity = 0;
+    cg.had_error = false;
+
+    // The C mirrors the AST, so what the IR learned about each access and
+    // loop carries over to the code emitted for it
+    cg.bounds = NULL;
+    cg.bounds_count = 0;
+    cg.vector_loops = NULL;
+    cg.vector_loop_count = 0;
+    cg.call_sites = NULL;
+    cg.call_site_count = 0;
+    cg.perf_symbols = NULL;
+    cg.perf_symbol_count = 0;
+    cg.tail_report = options->tail_call_report;
+    cg.allocations = NULL;
+    cg.allocation_count = 0;
+    cg.region = false;
+    cg.spawns = false;
+    cg.spawn_count = 0;
+    cg.parallel = false;
+    cg.constant_type = TYPE_NULL;
+
+    int function_count = program->value.block.statement_count;
+    AstNode** functions = program->value.block.statements;
+    cg.always_inline = calloc(function_count + 1, sizeof(bool));
+
+    IrModule* module = ir_lower_program_quietly(program);
+    if (module != NULL) {
+        ir_set_overflow_mode(module, options->overflow_mode);
+        ir_set_call_profile(module, options->call_profile, options->call_profile_count);
+        ir_optimize_module(module);
+        cg.bounds = ir_collect_bounds_facts(module, &cg.bounds_count);
+        cg.vector_loops = ir_collect_vector_loops(module, &cg.vector_loop_count);
+        cg.allocations = ir_collect_allocations(module, &cg.allocation_count);
+        // The C is still emitted function by function; the C compiler is
+        // asked to make the same inlining choices the IR did
+        for (int i = 0; i < function_count; i++) {
+            cg.always_inline[i] = ir_inlined_everywhere(module, functions[i]->value.function.name);
+        }
+        ir_free_module(module);
+    }
+    cg.bounds_active = calloc(cg.bounds_count > 0 ? cg.bounds_count : 1, sizeof(bool));
+    plan_tail_calls(&cg);
+    for (int i = 0; i < function_count; i++) {
+        if (starts_tasks(functions[i], &cg)) cg.spawns = true;
+    }
+
+    // Set before the prototypes, which place the functions in the perf section too
+    char* perf_symbols = NULL;
+    size_t perf_symbols_size = 0;
+    if (options->perf_map) cg.perf_symbols = open_memstream(&perf_symbols, &perf_symbols_size);
+
+    fputs("// Generated by pflang\n", out);
+    fputs("#include <stdint.h>\n#include <stdbool.h>\n#include \"pf_runtime.h\"\n\n", out);
+
+    for (int i = 0; i < function_count; i++) {
+        if (returns_tuple(functions[i])) emit_tuple_struct(&cg, functions[i]);
+    }
+
+    for (int i = 0; i < function_count; i++) {
+        emit_signature(&cg, functions[i]);
+        fputs(";\n", out);
+    }
+    fputs("\n", out);
+
+    // Bodies are buffered so that the format helpers they create can be
+    // written ahead of them
+    char* body = NULL;
+    size_t body_size = 0;
+    char* helpers = NULL;
+    size_t helpers_size = 0;
+    char* call_sites = NULL;
+    size_t call_sites_size = 0;
+    cg.out = open_memstream(&body, &body_size);
+    cg.helpers = open_memstream(&helpers, &helpers_size);
+    if (options->count_calls) cg.call_sites = open_memstream(&call_sites, &call_sites_size);
+
+    for (int i = 0; i < function_count; i++) {
+        emit_function(&cg, functions[i]);
+    }
+
+    AstNode* main_function = find_function(&cg, "main");
+    if (main_function != NULL) {
+        emit_entry_point(&cg, main_function);
+    }
+
+    fclose(cg.out);
+    fclose(cg.helpers);
+    emit_literal_table(&cg, out);
+    fwrite(helpers, 1, helpers_size, out);
+    if (cg.call_sites != NULL) {
+        fclose(cg.call_sites);
+        // One spare entry keeps the arrays nonempty
+        fprintf(out, "static const pf_call_site pf_call_sites[%d] = {\n", cg.call_site_count + 1);
+        fwrite(call_sites, 1, call_sites_size, out);
+        fputs("    {NULL, 0, NULL},\n};\n", out);
+        fprintf(out, "static uint64_t pf_call_counts[%d];\n\n", cg.call_site_count + 1);
+        free(call_sites);
+    }
+    if (cg.perf_symbols != NULL) {
+        fclose(cg.perf_symbols);
+        fprintf(out, "static const pf_perf_symbol pf_perf_symbols[%d] = {\n", cg.perf_symbol_count + 1);
+        fwrite(perf_symbols, 1, perf_symbols_size, out);
+        fputs("    {NULL, NULL, 0},\n};\n\n", out);
+        free(perf_symbols);
+    }
+    fwrite(body, 1, body_size, out);
+    free(helpers);
+    free(body);
+
+    free(cg.locals);
+    free(cg.literals);
+    free(cg.bounds);
+    free(cg.bounds_active);
+    free(cg.vector_loops);
+    free(cg.allocations);
+    free(cg.always_inline);
+    free(cg.tail_groups);
+    free(cg.tail_loops);
+    return !cg.had_error;
+}
+
+bool codegen_c_compile(const char* c_path, const char* output_path) {
+    const char* compiler = getenv("CC");
+    if (compiler == NULL || compiler[0] == '\0') compiler = "cc";
+
+    char command[8192];
+    snprintf(command, sizeof(command),
+             "%s -std=c11 -O2 -I\"%s\" \"%s\" -L\"%s\" -lpflang_rt -lm -pthread -o \"%s\"",
+             compiler, PFLANG_RUNTIME_INCLUDE_DIR, c_path, PFLANG_RUNTIME_LIB_DIR, output_path);
+
+    int status = system(command);
+    if (status != 0) {
+        fprintf(stderr, "Error: C compiler failed: %s\n", command);
+        return false;
+    }
+    return true;
+}
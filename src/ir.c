@@ -0,0 +1,1604 @@
+#include "../include/ir.h"
+#include "../include/builtins.h"
+
+#include <ctype.h>
+
+// Per-block state of the SSA construction (Braun et al., "Simple and
+// Efficient Construction of Static Single Assignment Form"). A block is
+// sealed once all of its predecessors are known; reads in unsealed blocks
+// create incomplete phis that are filled in when the block is sealed.
+typedef struct {
+    IrInstr** defs;         // Current definition of each variable in this block
+    IrInstr** incomplete;   // Incomplete phi of each variable
+    int capacity;
+    bool sealed;
+} IrBlockState;
+
+typedef struct {
+    char* name;
+    DataType type;
+} IrVariable;
+
+typedef struct {
+    AstNode* program;
+    IrFunction* function;
+    IrBlock* current;
+    IrVariable* variables;
+    int variable_count;
+    int variable_capacity;
+    IrBlockState* states;
+    int state_capacity;
+    bool had_error;
+    bool quiet;                 // Record errors without printing them
+    DataType constant_type;     // Type of the integer constant being stored in a slot, or TYPE_NULL
+} IrBuilder;
+
+static void* ir_alloc(size_t size) {
+    void* memory = calloc(1, size);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for IR\n");
+        exit(1);
+    }
+    return memory;
+}
+
+// ---------------------------------------------------------------------------
+// Construction helpers
+
+IrBlock* ir_new_block(IrFunction* function) {
+    IrBlock* block = ir_alloc(sizeof(IrBlock));
+    block->id = function->next_block_id++;
+    block->function = function;
+    block->rpo_index = -1;
+
+    if (function->block_count == function->block_capacity) {
+        function->block_capacity = function->block_capacity == 0 ? 8 : function->block_capacity * 2;
+        function->blocks = realloc(function->blocks, sizeof(IrBlock*) * function->block_capacity);
+    }
+    function->blocks[function->block_count++] = block;
+    return block;
+}
+
+IrInstr* ir_new_instr(IrFunction* function, IrOpcode op, DataType type) {
+    IrInstr* instr = ir_alloc(sizeof(IrInstr));
+    instr->op = op;
+    instr->type = type;
+    instr->id = function->next_value_id++;
+    return instr;
+}
+
+void ir_insert_instr(IrBlock* block, int position, IrInstr* instr) {
+    if (block->instr_count == block->instr_capacity) {
+        block->instr_capacity = block->instr_capacity == 0 ? 8 : block->instr_capacity * 2;
+        block->instrs = realloc(block->instrs, sizeof(IrInstr*) * block->instr_capacity);
+    }
+    memmove(&block->instrs[position + 1], &block->instrs[position],
+            sizeof(IrInstr*) * (block->instr_count - position));
+    block->instrs[position] = instr;
+    block->instr_count++;
+    instr->block = block;
+}
+
+void ir_append_instr(IrBlock* block, IrInstr* instr) {
+    ir_insert_instr(block, block->instr_count, instr);
+}
+
+void ir_add_operand(IrInstr* instr, IrInstr* operand) {
+    if (instr->operand_count == instr->operand_capacity) {
+        instr->operand_capacity = instr->operand_capacity == 0 ? 2 : instr->operand_capacity * 2;
+        instr->operands = realloc(instr->operands, sizeof(IrInstr*) * instr->operand_capacity);
+    }
+    instr->operands[instr->operand_count++] = operand;
+}
+
+void ir_add_pred(IrBlock* block, IrBlock* pred) {
+    if (block->pred_count == block->pred_capacity) {
+        block->pred_capacity = block->pred_capacity == 0 ? 2 : block->pred_capacity * 2;
+        block->preds = realloc(block->preds, sizeof(IrBlock*) * block->pred_capacity);
+    }
+    block->preds[block->pred_count++] = pred;
+}
+
+// Drop one edge from pred, along with the matching operand of every phi
+void ir_remove_pred(IrBlock* block, IrBlock* pred) {
+    int index = -1;
+    for (int i = 0; i < block->pred_count; i++) {
+        if (block->preds[i] == pred) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) return;
+
+    memmove(&block->preds[index], &block->preds[index + 1],
+            sizeof(IrBlock*) * (block->pred_count - index - 1));
+    block->pred_count--;
+
+    for (int i = 0; i < block->instr_count; i++) {
+        IrInstr* phi = block->instrs[i];
+        if (phi->op != IR_PHI || index >= phi->operand_count) continue;
+        memmove(&phi->operands[index], &phi->operands[index + 1],
+                sizeof(IrInstr*) * (phi->operand_count - index - 1));
+        phi->operand_count--;
+    }
+}
+
+bool ir_is_terminator(IrOpcode op) {
+    return op == IR_JUMP || op == IR_BRANCH || op == IR_RETURN;
+}
+
+IrInstr* ir_terminator(IrBlock* block) {
+    if (block->instr_count == 0) return NULL;
+    IrInstr* last = block->instrs[block->instr_count - 1];
+    return ir_is_terminator(last->op) ? last : NULL;
+}
+
+int ir_successor_count(IrBlock* block) {
+    IrInstr* terminator = ir_terminator(block);
+    if (terminator == NULL) return 0;
+    switch (terminator->op) {
+        case IR_JUMP: return 1;
+        case IR_BRANCH: return 2;
+        default: return 0;
+    }
+}
+
+IrBlock* ir_successor(IrBlock* block, int index) {
+    return ir_terminator(block)->targets[index];
+}
+
+// Element loads stay put too: they trap on a bad index and read memory
+// that stores and appends change
+bool ir_has_side_effects(IrInstr* instr) {
+    return instr->op == IR_CALL || instr->op == IR_SPAWN || instr->op == IR_LOAD || instr->op == IR_STORE || ir_is_terminator(instr->op);
+}
+
+// Print calls and terminators produce nothing; a null constant is still a
+// value that can be returned
+bool ir_defines_value(IrInstr* instr) {
+    if (ir_is_terminator(instr->op)) return false;
+    return instr->type != TYPE_NULL || instr->op == IR_CONST;
+}
+
+void ir_free_instr(IrInstr* instr) {
+    free(instr->operands);
+    free(instr->name);
+    free(instr);
+}
+
+void ir_remove_instr_at(IrBlock* block, int index) {
+    if (block->induction == block->instrs[index]) block->induction = NULL;
+    ir_free_instr(block->instrs[index]);
+    memmove(&block->instrs[index], &block->instrs[index + 1],
+            sizeof(IrInstr*) * (block->instr_count - index - 1));
+    block->instr_count--;
+}
+
+void ir_replace_uses(IrFunction* function, IrInstr* from, IrInstr* to) {
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* instr = block->instrs[i];
+            for (int o = 0; o < instr->operand_count; o++) {
+                if (instr->operands[o] == from) instr->operands[o] = to;
+            }
+        }
+    }
+}
+
+static void free_block(IrBlock* block) {
+    for (int i = 0; i < block->instr_count; i++) {
+        ir_free_instr(block->instrs[i]);
+    }
+    free(block->instrs);
+    free(block->preds);
+    free(block);
+}
+
+void ir_remove_unreachable_blocks(IrFunction* function) {
+    if (function->block_count == 0) return;
+
+    bool* reachable = ir_alloc(sizeof(bool) * function->next_block_id);
+    IrBlock** worklist = ir_alloc(sizeof(IrBlock*) * function->block_count);
+    int worklist_count = 0;
+
+    reachable[function->blocks[0]->id] = true;
+    worklist[worklist_count++] = function->blocks[0];
+    while (worklist_count > 0) {
+        IrBlock* block = worklist[--worklist_count];
+        for (int s = 0; s < ir_successor_count(block); s++) {
+            IrBlock* successor = ir_successor(block, s);
+            if (!reachable[successor->id]) {
+                reachable[successor->id] = true;
+                worklist[worklist_count++] = successor;
+            }
+        }
+    }
+
+    // Unhook dead blocks from live successors before freeing anything
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (reachable[block->id]) continue;
+        for (int s = 0; s < ir_successor_count(block); s++) {
+            IrBlock* successor = ir_successor(block, s);
+            if (reachable[successor->id]) ir_remove_pred(successor, block);
+        }
+    }
+
+    int kept = 0;
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (reachable[block->id]) {
+            function->blocks[kept++] = block;
+        } else {
+            free_block(block);
+        }
+    }
+    function->block_count = kept;
+
+    free(worklist);
+    free(reachable);
+}
+
+void ir_merge_blocks(IrFunction* function) {
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        IrInstr* jump = ir_terminator(block);
+        if (jump == NULL || jump->op != IR_JUMP) continue;
+        IrBlock* next = jump->targets[0];
+        if (next == block || next == function->blocks[0] || next->pred_count != 1 || next->loop != NULL ||
+            (next->instr_count > 0 && next->instrs[0]->op == IR_PHI)) {
+            continue;
+        }
+
+        ir_remove_instr_at(block, block->instr_count - 1);
+        for (int i = 0; i < next->instr_count; i++) {
+            ir_append_instr(block, next->instrs[i]);
+        }
+        for (int s = 0; s < ir_successor_count(block); s++) {
+            IrBlock* successor = ir_successor(block, s);
+            for (int p = 0; p < successor->pred_count; p++) {
+                if (successor->preds[p] == next) successor->preds[p] = block;
+            }
+        }
+
+        int index = 0;
+        while (function->blocks[index] != next) index++;
+        memmove(&function->blocks[index], &function->blocks[index + 1],
+                sizeof(IrBlock*) * (function->block_count - index - 1));
+        function->block_count--;
+        next->instr_count = 0;
+        free_block(next);
+
+        // The merged block may end in another jump worth following
+        b = -1;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Dominators (Cooper, Harvey and Kennedy, "A Simple, Fast Dominance
+// Algorithm"). Also reorders the block list into reverse postorder, with any
+// unreachable blocks at the end.
+
+static void postorder(IrBlock* block, bool* visited, IrBlock** order, int* count) {
+    visited[block->id] = true;
+    // Visit successors last to first so the first one comes first in RPO
+    for (int s = ir_successor_count(block) - 1; s >= 0; s--) {
+        IrBlock* successor = ir_successor(block, s);
+        if (!visited[successor->id]) postorder(successor, visited, order, count);
+    }
+    order[(*count)++] = block;
+}
+
+static IrBlock* intersect(IrBlock* a, IrBlock* b) {
+    while (a != b) {
+        while (a->rpo_index > b->rpo_index) a = a->idom;
+        while (b->rpo_index > a->rpo_index) b = b->idom;
+    }
+    return a;
+}
+
+void ir_compute_dominators(IrFunction* function) {
+    if (function->block_count == 0) return;
+
+    bool* visited = ir_alloc(sizeof(bool) * function->next_block_id);
+    IrBlock** order = ir_alloc(sizeof(IrBlock*) * function->block_count);
+    int count = 0;
+    postorder(function->blocks[0], visited, order, &count);
+
+    IrBlock** blocks = ir_alloc(sizeof(IrBlock*) * function->block_count);
+    for (int i = 0; i < count; i++) {
+        blocks[i] = order[count - 1 - i];
+        blocks[i]->rpo_index = i;
+        blocks[i]->idom = NULL;
+    }
+    int unreachable = count;
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (!visited[block->id]) {
+            block->rpo_index = -1;
+            block->idom = NULL;
+            blocks[unreachable++] = block;
+        }
+    }
+    memcpy(function->blocks, blocks, sizeof(IrBlock*) * function->block_count);
+
+    IrBlock* entry = function->blocks[0];
+    entry->idom = entry;
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i < count; i++) {
+            IrBlock* block = function->blocks[i];
+            IrBlock* new_idom = NULL;
+            for (int p = 0; p < block->pred_count; p++) {
+                IrBlock* pred = block->preds[p];
+                if (pred->idom == NULL) continue;
+                new_idom = new_idom == NULL ? pred : intersect(pred, new_idom);
+            }
+            if (new_idom != block->idom) {
+                block->idom = new_idom;
+                changed = true;
+            }
+        }
+    }
+
+    free(blocks);
+    free(order);
+    free(visited);
+}
+
+bool ir_dominates(IrBlock* a, IrBlock* b) {
+    if (b->idom == NULL) return false;
+    for (;;) {
+        if (a == b) return true;
+        if (b->idom == b) return false;
+        b = b->idom;
+    }
+}
+
+bool* ir_loop_blocks(IrFunction* function, IrBlock* header) {
+    bool* in_loop = ir_alloc(sizeof(bool) * function->next_block_id);
+    IrBlock** worklist = ir_alloc(sizeof(IrBlock*) * (function->block_count + 1));
+    int count = 0;
+
+    // Walk back from each back edge until the header
+    in_loop[header->id] = true;
+    for (int p = 0; p < header->pred_count; p++) {
+        IrBlock* latch = header->preds[p];
+        if (ir_dominates(header, latch) && !in_loop[latch->id]) {
+            in_loop[latch->id] = true;
+            worklist[count++] = latch;
+        }
+    }
+    while (count > 0) {
+        IrBlock* block = worklist[--count];
+        for (int p = 0; p < block->pred_count; p++) {
+            if (!in_loop[block->preds[p]->id]) {
+                in_loop[block->preds[p]->id] = true;
+                worklist[count++] = block->preds[p];
+            }
+        }
+    }
+    free(worklist);
+    return in_loop;
+}
+
+bool* ir_blocks_in_loops(IrFunction* function) {
+    bool* in_loops = ir_alloc(sizeof(bool) * (function->next_block_id + 1));
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* header = function->blocks[b];
+        for (int p = 0; p < header->pred_count; p++) {
+            if (!ir_dominates(header, header->preds[p])) continue;
+            bool* loop = ir_loop_blocks(function, header);
+            for (int id = 0; id < function->next_block_id; id++) {
+                in_loops[id] |= loop[id];
+            }
+            free(loop);
+            break;
+        }
+    }
+    return in_loops;
+}
+
+// ---------------------------------------------------------------------------
+// Lowering
+
+static void lower_error(IrBuilder* builder, AstNode* node, const char* message) {
+    builder->had_error = true;
+    if (builder->quiet) return;
+    fprintf(stderr, "[line %d] Error: %s\n", node != NULL ? node->line : 0, message);
+}
+
+static IrBlockState* block_state(IrBuilder* builder, IrBlock* block) {
+    if (block->id >= builder->state_capacity) {
+        int capacity = builder->state_capacity == 0 ? 16 : builder->state_capacity;
+        while (capacity <= block->id) capacity *= 2;
+        builder->states = realloc(builder->states, sizeof(IrBlockState) * capacity);
+        memset(&builder->states[builder->state_capacity], 0,
+               sizeof(IrBlockState) * (capacity - builder->state_capacity));
+        builder->state_capacity = capacity;
+    }
+
+    IrBlockState* state = &builder->states[block->id];
+    if (state->capacity < builder->variable_capacity) {
+        int capacity = builder->variable_capacity;
+        state->defs = realloc(state->defs, sizeof(IrInstr*) * capacity);
+        state->incomplete = realloc(state->incomplete, sizeof(IrInstr*) * capacity);
+        for (int i = state->capacity; i < capacity; i++) {
+            state->defs[i] = NULL;
+            state->incomplete[i] = NULL;
+        }
+        state->capacity = capacity;
+    }
+    return state;
+}
+
+static int find_variable(IrBuilder* builder, const char* name) {
+    for (int i = 0; i < builder->variable_count; i++) {
+        if (strcmp(builder->variables[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+static int declare_variable(IrBuilder* builder, const char* name, DataType type) {
+    int existing = find_variable(builder, name);
+    if (existing >= 0) {
+        builder->variables[existing].type = type;
+        return existing;
+    }
+
+    if (builder->variable_count == builder->variable_capacity) {
+        builder->variable_capacity = builder->variable_capacity == 0 ? 8 : builder->variable_capacity * 2;
+        builder->variables = realloc(builder->variables, sizeof(IrVariable) * builder->variable_capacity);
+    }
+    builder->variables[builder->variable_count].name = strdup(name);
+    builder->variables[builder->variable_count].type = type;
+    return builder->variable_count++;
+}
+
+static void write_variable(IrBuilder* builder, int variable, IrBlock* block, IrInstr* value) {
+    block_state(builder, block)->defs[variable] = value;
+}
+
+static IrInstr* read_variable(IrBuilder* builder, int variable, IrBlock* block);
+
+static void add_phi_operands(IrBuilder* builder, int variable, IrInstr* phi) {
+    IrBlock* block = phi->block;
+    for (int p = 0; p < block->pred_count; p++) {
+        ir_add_operand(phi, read_variable(builder, variable, block->preds[p]));
+    }
+}
+
+static IrInstr* new_phi(IrBuilder* builder, int variable, IrBlock* block) {
+    IrInstr* phi = ir_new_instr(builder->function, IR_PHI, builder->variables[variable].type);
+    ir_insert_instr(block, 0, phi);
+    return phi;
+}
+
+static IrInstr* read_variable_recursive(IrBuilder* builder, int variable, IrBlock* block) {
+    IrBlockState* state = block_state(builder, block);
+    IrInstr* value;
+
+    if (!state->sealed) {
+        value = new_phi(builder, variable, block);
+        state->incomplete[variable] = value;
+    } else if (block->pred_count == 0) {
+        value = ir_new_instr(builder->function, IR_UNDEF, builder->variables[variable].type);
+        ir_insert_instr(block, 0, value);
+    } else if (block->pred_count == 1) {
+        value = read_variable(builder, variable, block->preds[0]);
+    } else {
+        // Record the phi before looking at predecessors to break cycles
+        value = new_phi(builder, variable, block);
+        write_variable(builder, variable, block, value);
+        add_phi_operands(builder, variable, value);
+    }
+
+    write_variable(builder, variable, block, value);
+    return value;
+}
+
+static IrInstr* read_variable(IrBuilder* builder, int variable, IrBlock* block) {
+    IrBlockState* state = block_state(builder, block);
+    if (state->defs[variable] != NULL) return state->defs[variable];
+    return read_variable_recursive(builder, variable, block);
+}
+
+static void seal_block(IrBuilder* builder, IrBlock* block) {
+    // Reading predecessors can grow the state table, so never hold on to
+    // a state pointer across add_phi_operands
+    for (int v = 0; v < builder->variable_count; v++) {
+        IrInstr* phi = block_state(builder, block)->incomplete[v];
+        if (phi != NULL) {
+            block_state(builder, block)->incomplete[v] = NULL;
+            add_phi_operands(builder, v, phi);
+        }
+    }
+    block_state(builder, block)->sealed = true;
+}
+
+// Statements after a return land in a fresh block nothing jumps to; the
+// unreachable block is dropped when lowering finishes
+static IrBlock* current_block(IrBuilder* builder) {
+    if (builder->current == NULL) {
+        builder->current = ir_new_block(builder->function);
+        block_state(builder, builder->current)->sealed = true;
+    }
+    return builder->current;
+}
+
+static IrInstr* emit(IrBuilder* builder, IrOpcode op, DataType type, int line) {
+    IrInstr* instr = ir_new_instr(builder->function, op, type);
+    instr->line = line;
+    ir_append_instr(current_block(builder), instr);
+    return instr;
+}
+
+static void emit_jump(IrBuilder* builder, IrBlock* target, int line) {
+    IrInstr* jump = emit(builder, IR_JUMP, TYPE_NULL, line);
+    jump->targets[0] = target;
+    ir_add_pred(target, jump->block);
+    builder->current = NULL;
+}
+
+static void emit_branch(IrBuilder* builder, IrInstr* condition, IrBlock* if_true, IrBlock* if_false, int line) {
+    IrInstr* branch = emit(builder, IR_BRANCH, TYPE_NULL, line);
+    ir_add_operand(branch, condition);
+    branch->targets[0] = if_true;
+    branch->targets[1] = if_false;
+    ir_add_pred(if_true, branch->block);
+    ir_add_pred(if_false, branch->block);
+    builder->current = NULL;
+}
+
+static bool is_numeric_type(DataType type) {
+    return type <= TYPE_F64;
+}
+
+static bool is_integer_type(DataType type) {
+    return type <= TYPE_I64;
+}
+
+static bool is_unsigned_type(DataType type) {
+    return type <= TYPE_U64;
+}
+
+static bool is_identifier(AstNode* node) {
+    return node->type == NODE_LITERAL && node->value.literal.type == TYPE_I32 &&
+           (isalpha((unsigned char)node->value.literal.value[0]) || node->value.literal.value[0] == '_');
+}
+
+static bool is_number_literal(AstNode* node) {
+    return node->type == NODE_LITERAL && node->value.literal.type == TYPE_I32 && !is_identifier(node);
+}
+
+static bool is_null_literal(AstNode* node) {
+    return node != NULL && node->type == NODE_LITERAL && node->value.literal.type == TYPE_NULL;
+}
+
+static bool is_format_expression(AstNode* node) {
+    return node->type == NODE_BINARY_OP && node->value.binary_op.operator == TOKEN_MODULO &&
+           node->value.binary_op.left->type == NODE_LITERAL &&
+           node->value.binary_op.left->value.literal.type == TYPE_STR;
+}
+
+static AstNode* find_ast_function(IrBuilder* builder, const char* name) {
+    for (int i = 0; i < builder->program->value.block.statement_count; i++) {
+        AstNode* function = builder->program->value.block.statements[i];
+        if (strcmp(function->value.function.name, name) == 0) return function;
+    }
+    return NULL;
+}
+
+static IrInstr* emit_const(IrBuilder* builder, DataType type, int64_t value, int line) {
+    IrInstr* constant = emit(builder, IR_CONST, type, line);
+    constant->imm.i = value;
+    return constant;
+}
+
+// Coerce a value to the type of the slot it is stored into
+static IrInstr* coerce(IrBuilder* builder, IrInstr* value, DataType type, int line) {
+    // array() and list() learn their element type from the slot
+    if (value->op == IR_CALL && (value->type == TYPE_ARRAY || value->type == TYPE_LIST) &&
+        is_sequence_type(type) && type_kind(type) == value->type) {
+        value->type = type;
+        return value;
+    }
+    // So does chan()
+    if (value->op == IR_CALL && value->type == TYPE_CHAN && type_kind(type) == TYPE_CHAN) {
+        value->type = type;
+        return value;
+    }
+    if (value->type == type || !is_numeric_type(value->type) || !is_numeric_type(type)) {
+        return value;
+    }
+    IrInstr* convert = emit(builder, IR_CONVERT, type, line);
+    ir_add_operand(convert, value);
+    return convert;
+}
+
+static IrInstr* lower_expression(IrBuilder* builder, AstNode* node);
+
+static IrOpcode binary_opcode(TokenType operator) {
+    switch (operator) {
+        case TOKEN_PLUS: return IR_ADD;
+        case TOKEN_MINUS: return IR_SUB;
+        case TOKEN_MULTIPLY: return IR_MUL;
+        case TOKEN_DIVIDE: return IR_DIV;
+        case TOKEN_MODULO: return IR_MOD;
+        case TOKEN_EQUALS: return IR_EQ;
+        case TOKEN_NOT_EQUAL: return IR_NE;
+        case TOKEN_LESS: return IR_LT;
+        case TOKEN_LESS_EQUAL: return IR_LE;
+        case TOKEN_GREATER: return IR_GT;
+        case TOKEN_GREATER_EQUAL: return IR_GE;
+        default: return IR_UNDEF;
+    }
+}
+
+// "format" % first, rest...
+static IrInstr* lower_format(IrBuilder* builder, AstNode* format, AstNode** rest, int rest_count) {
+    IrInstr* text = emit(builder, IR_STRING, TYPE_STR, format->line);
+    text->name = strdup(format->value.binary_op.left->value.literal.value);
+
+    IrInstr* first = lower_expression(builder, format->value.binary_op.right);
+    IrInstr** values = malloc(sizeof(IrInstr*) * (rest_count + 1));
+    values[0] = first;
+    for (int i = 0; i < rest_count; i++) {
+        values[i + 1] = lower_expression(builder, rest[i]);
+    }
+
+    IrInstr* instr = emit(builder, IR_FORMAT, TYPE_STR, format->line);
+    ir_add_operand(instr, text);
+    for (int i = 0; i <= rest_count; i++) {
+        ir_add_operand(instr, values[i]);
+    }
+    free(values);
+    return instr;
+}
+
+static bool is_sequence_function(const char* name) {
+    return strcmp(name, "array") == 0 || strcmp(name, "list") == 0 || strcmp(name, "len") == 0 ||
+           strcmp(name, "append") == 0 || strcmp(name, "slice") == 0;
+}
+
+static bool is_chan_function(const char* name) {
+    return strcmp(name, "chan") == 0 || strcmp(name, "send") == 0 || strcmp(name, "recv") == 0 ||
+           strcmp(name, "close") == 0;
+}
+
+static bool is_parallel_function(const char* name) {
+    return strcmp(name, "par_map") == 0 || strcmp(name, "par_reduce") == 0;
+}
+
+// par_map(xs, f) is an array of f's results, par_reduce(xs, f, init) a
+// value of the element type; f names a function of the program rather
+// than being a value, so only xs and init are operands
+static IrInstr* lower_parallel_call(IrBuilder* builder, AstNode* node) {
+    const char* name = node->value.function_call.name;
+    AstNode** arguments = node->value.function_call.arguments;
+    int count = node->value.function_call.argument_count;
+    bool is_map = strcmp(name, "par_map") == 0;
+    if (count != (is_map ? 2 : 3)) {
+        lower_error(builder, node, "Wrong number of arguments");
+        return emit_const(builder, TYPE_I32, 0, node->line);
+    }
+    AstNode* function = is_identifier(arguments[1])
+                            ? find_ast_function(builder, arguments[1]->value.literal.value) : NULL;
+    if (function == NULL || function->value.function.param_count != (is_map ? 1 : 2) ||
+        function->value.function.return_type_count != 1) {
+        lower_error(builder, node, "Argument 2 must name a function of the program");
+        return emit_const(builder, TYPE_I32, 0, node->line);
+    }
+    IrInstr* sequence = lower_expression(builder, arguments[0]);
+    if (!is_sequence_type(sequence->type)) {
+        lower_error(builder, node, "Argument 1 must be an array or list");
+        return emit_const(builder, TYPE_I32, 0, node->line);
+    }
+
+    DataType element = type_element(sequence->type);
+    IrInstr* init = is_map ? NULL : coerce(builder, lower_expression(builder, arguments[2]), element, node->line);
+    IrInstr* call = emit(builder, IR_CALL,
+                         is_map ? compound_type(TYPE_ARRAY, function->value.function.return_types[0]) : element,
+                         node->line);
+    call->name = strdup(name);
+    ir_add_operand(call, sequence);
+    if (init != NULL) ir_add_operand(call, init);
+    return call;
+}
+
+static IrInstr* lower_call(IrBuilder* builder, AstNode* node) {
+    const char* name = node->value.function_call.name;
+    AstNode** arguments = node->value.function_call.arguments;
+    int count = node->value.function_call.argument_count;
+
+    bool is_print = strcmp(name, "print") == 0;
+    bool is_error = strcmp(name, "error") == 0;
+    // A program's own functions shadow builtins of the same name
+    bool is_builtin = find_ast_function(builder, name) == NULL;
+    const Builtin* builtin = is_builtin ? find_builtin(name) : NULL;
+    bool is_sequence = is_builtin && is_sequence_function(name);
+    bool is_chan = is_builtin && is_chan_function(name);
+    const ArrayBuiltin* array_builtin = is_builtin ? find_array_builtin(name) : NULL;
+    DataType type = TYPE_NULL;
+    AstNode* function = NULL;
+    if (is_builtin && is_parallel_function(name)) return lower_parallel_call(builder, node);
+
+    if (is_error) {
+        type = TYPE_ERROR;
+    } else if (builtin != NULL) {
+        type = builtin->return_type;
+        if (builtin->param_count != count) {
+            lower_error(builder, node, "Wrong number of arguments");
+        }
+    } else if (!is_print && !is_sequence && !is_chan && array_builtin == NULL) {
+        function = find_ast_function(builder, name);
+        if (function == NULL) {
+            lower_error(builder, node, "Call to undefined function");
+            return emit_const(builder, TYPE_I32, 0, node->line);
+        }
+        if (function->value.function.param_count != count) {
+            lower_error(builder, node, "Wrong number of arguments");
+        }
+        type = function->value.function.return_type_count > 1 ? TYPE_TUPLE : function->value.function.return_types[0];
+    }
+
+    // The generic sequence functions; len is an instruction of its own
+    if (is_sequence) {
+        if (strcmp(name, "len") == 0) {
+            IrInstr* sequence = count == 1 ? lower_expression(builder, arguments[0]) : NULL;
+            if (sequence == NULL || !is_sequence_type(sequence->type)) {
+                lower_error(builder, node, "len() takes one array or list");
+                return emit_const(builder, TYPE_I64, 0, node->line);
+            }
+            IrInstr* length = emit(builder, IR_LENGTH, TYPE_I64, node->line);
+            ir_add_operand(length, sequence);
+            return length;
+        }
+        if (strcmp(name, "array") == 0) type = TYPE_ARRAY;
+        if (strcmp(name, "list") == 0) type = TYPE_LIST;
+    }
+    if (is_chan && strcmp(name, "chan") == 0) type = TYPE_CHAN;
+
+    IrInstr** values = malloc(sizeof(IrInstr*) * (count + 1));
+    int value_count = 0;
+    if ((is_print || is_error) && count > 0 && is_format_expression(arguments[0])) {
+        values[value_count++] = lower_format(builder, arguments[0], arguments + 1, count - 1);
+    } else {
+        for (int i = 0; i < count; i++) {
+            IrInstr* value = lower_expression(builder, arguments[i]);
+            if (function != NULL && i < function->value.function.param_count) {
+                value = coerce(builder, value, function->value.function.parameters[i]->value.parameter.type,
+                               node->line);
+            } else if (builtin != NULL && i < builtin->param_count) {
+                value = coerce(builder, value, builtin->param_types[i], node->line);
+            } else if (i == 1 && is_sequence_type(values[0]->type) &&
+                       ((is_sequence && strcmp(name, "append") == 0) ||
+                        (array_builtin != NULL && array_builtin->second == ARRAY_ARG_ELEMENT))) {
+                value = coerce(builder, value, type_element(values[0]->type), node->line);
+            } else if (i == 1 && is_chan && type_kind(values[0]->type) == TYPE_CHAN) {
+                value = coerce(builder, value, type_element(values[0]->type), node->line);
+            }
+            values[value_count++] = value;
+        }
+    }
+
+    if (value_count > 0 && is_sequence_type(values[0]->type)) {
+        if (is_sequence && strcmp(name, "slice") == 0) {
+            type = compound_type(TYPE_ARRAY, type_element(values[0]->type));
+        } else if (array_builtin != NULL) {
+            type = array_builtin_type(array_builtin, type_element(values[0]->type));
+        }
+    }
+    if (is_chan && strcmp(name, "chan") != 0) {
+        if (value_count == 0 || type_kind(values[0]->type) != TYPE_CHAN || values[0]->type == TYPE_CHAN) {
+            lower_error(builder, node, "Argument 1 must be a channel");
+        } else if (strcmp(name, "recv") == 0) {
+            type = type_element(values[0]->type);
+        }
+    }
+
+    IrInstr* call = emit(builder, IR_CALL, type, node->line);
+    call->name = strdup(name);
+    if (type_kind(type) == TYPE_ARRAY && strcmp(name, "array") == 0) call->source = node;
+    if (type_kind(type) == TYPE_LIST && strcmp(name, "list") == 0) call->source = node;
+    for (int i = 0; i < value_count; i++) {
+        ir_add_operand(call, values[i]);
+    }
+    free(values);
+    return call;
+}
+
+static IrInstr* lower_expression(IrBuilder* builder, AstNode* node) {
+    switch (node->type) {
+        case NODE_LITERAL: {
+            const char* text = node->value.literal.value;
+            if (node->value.literal.type == TYPE_NULL) {
+                return emit_const(builder, TYPE_NULL, 0, node->line);
+            }
+            if (node->value.literal.type == TYPE_STR) {
+                IrInstr* string = emit(builder, IR_STRING, TYPE_STR, node->line);
+                string->name = strdup(text);
+                return string;
+            }
+            if (is_identifier(node)) {
+                int variable = find_variable(builder, text);
+                if (variable < 0) {
+                    lower_error(builder, node, "Use of undeclared variable");
+                    return emit_const(builder, TYPE_I32, 0, node->line);
+                }
+                return read_variable(builder, variable, current_block(builder));
+            }
+            if (strchr(text, '.') != NULL) {
+                IrInstr* constant = emit(builder, IR_CONST, TYPE_F64, node->line);
+                constant->imm.f = strtod(text, NULL);
+                return constant;
+            }
+            DataType type = builder->constant_type != TYPE_NULL ? builder->constant_type : integer_literal_type(text);
+            return emit_const(builder, type, (int64_t)strtoull(text, NULL, 10), node->line);
+        }
+
+        case NODE_BINARY_OP: {
+            if (is_format_expression(node)) {
+                return lower_format(builder, node, NULL, 0);
+            }
+
+            IrOpcode op = binary_opcode(node->value.binary_op.operator);
+            if (op == IR_UNDEF) {
+                lower_error(builder, node, "Unsupported operator");
+                return emit_const(builder, TYPE_I32, 0, node->line);
+            }
+
+            IrInstr* left = lower_expression(builder, node->value.binary_op.left);
+            IrInstr* right = lower_expression(builder, node->value.binary_op.right);
+
+            // Float operands win; an integer constant takes the width of the
+            // other operand, two the wider of theirs; otherwise the left
+            // operand's width is used
+            DataType type = left->type;
+            if (is_integer_constant(node)) {
+                type = builder->constant_type != TYPE_NULL ? builder->constant_type : integer_constant_type(node);
+            } else if (is_integer_constant(node->value.binary_op.left)) {
+                type = right->type;
+            }
+            if (right->type == TYPE_F64 || (right->type == TYPE_F32 && type != TYPE_F64)) {
+                type = right->type;
+            }
+
+            // A signed and an unsigned integer compare by value, so neither
+            // is converted to the other's type; a bare literal is never
+            // negative and converts exactly
+            bool comparison = op >= IR_EQ && op <= IR_GE;
+            bool mixed_sign = comparison && is_integer_type(left->type) && is_integer_type(right->type) &&
+                              is_unsigned_type(left->type) != is_unsigned_type(right->type) &&
+                              !is_number_literal(node->value.binary_op.left) &&
+                              !is_number_literal(node->value.binary_op.right);
+            if (!mixed_sign) {
+                left = coerce(builder, left, type, node->line);
+                right = coerce(builder, right, type, node->line);
+            }
+
+            IrInstr* instr = emit(builder, op, comparison ? TYPE_BOOL : type, node->line);
+            ir_add_operand(instr, left);
+            ir_add_operand(instr, right);
+            return instr;
+        }
+
+        case NODE_UNARY_OP: {
+            AstNode* operand_node = node->value.unary_op.operand;
+            IrInstr* operand = lower_expression(builder, operand_node);
+            switch (node->value.unary_op.operator) {
+                case TOKEN_PLUS:
+                    return operand;
+                case TOKEN_MINUS: {
+                    IrInstr* negate = emit(builder, IR_NEG, operand->type, node->line);
+                    ir_add_operand(negate, operand);
+                    return negate;
+                }
+                case TOKEN_INCREMENT:
+                case TOKEN_DECREMENT: {
+                    if (!is_identifier(operand_node)) {
+                        lower_error(builder, node, "Increment of something that is not a variable");
+                        return operand;
+                    }
+                    IrInstr* one = emit_const(builder, operand->type, 1, node->line);
+                    IrInstr* update = emit(builder, node->value.unary_op.operator == TOKEN_INCREMENT ? IR_ADD : IR_SUB,
+                                           operand->type, node->line);
+                    ir_add_operand(update, operand);
+                    ir_add_operand(update, one);
+                    write_variable(builder, find_variable(builder, operand_node->value.literal.value),
+                                   current_block(builder), update);
+                    return update;
+                }
+                default:
+                    lower_error(builder, node, "Unsupported unary operator");
+                    return operand;
+            }
+        }
+
+        case NODE_FUNCTION_CALL:
+            return lower_call(builder, node);
+
+        case NODE_INDEX: {
+            IrInstr* sequence = lower_expression(builder, node->value.index.target);
+            IrInstr* index = lower_expression(builder, node->value.index.index);
+            if (!is_sequence_type(sequence->type)) {
+                lower_error(builder, node, "Only arrays and lists can be indexed");
+                return emit_const(builder, TYPE_I32, 0, node->line);
+            }
+            IrInstr* load = emit(builder, IR_LOAD, type_element(sequence->type), node->line);
+            ir_add_operand(load, sequence);
+            ir_add_operand(load, index);
+            load->source = node;
+            return load;
+        }
+
+        default:
+            lower_error(builder, node, "Unsupported expression");
+            return emit_const(builder, TYPE_I32, 0, node->line);
+    }
+}
+
+static void lower_statement(IrBuilder* builder, AstNode* node);
+
+static void lower_block(IrBuilder* builder, AstNode* node) {
+    if (node->type != NODE_BLOCK) {
+        lower_statement(builder, node);
+        return;
+    }
+    for (int i = 0; i < node->value.block.statement_count; i++) {
+        lower_statement(builder, node->value.block.statements[i]);
+    }
+}
+
+// Value stored into a slot of the given type; null becomes that type's zero
+static IrInstr* lower_value(IrBuilder* builder, AstNode* node, DataType type) {
+    if (is_null_literal(node)) {
+        return emit_const(builder, type, 0, node->line);
+    }
+    // An integer constant is computed at the slot's width, or its literals'
+    // if wider
+    if (is_integer_type(type) && is_integer_constant(node)) {
+        builder->constant_type = integer_constant_slot_type(node, type);
+        IrInstr* value = lower_expression(builder, node);
+        builder->constant_type = TYPE_NULL;
+        return coerce(builder, value, type, node->line);
+    }
+    return coerce(builder, lower_expression(builder, node), type, node->line);
+}
+
+static void lower_return(IrBuilder* builder, AstNode* node) {
+    IrFunction* function = builder->function;
+    AstNode* value = node->value.return_stmt.return_value;
+
+    if (function->return_type_count > 1) {
+        if (value == NULL || value->type != NODE_TUPLE ||
+            value->value.tuple.value_count != function->return_type_count) {
+            lower_error(builder, node, "Return value does not match the declared return types");
+            return;
+        }
+
+        // Tuples never materialize: each element is a separate return operand
+        IrInstr** values = malloc(sizeof(IrInstr*) * function->return_type_count);
+        for (int i = 0; i < function->return_type_count; i++) {
+            values[i] = lower_value(builder, value->value.tuple.values[i], function->return_types[i]);
+        }
+        IrInstr* ret = emit(builder, IR_RETURN, TYPE_NULL, node->line);
+        for (int i = 0; i < function->return_type_count; i++) {
+            ir_add_operand(ret, values[i]);
+        }
+        free(values);
+    } else if (function->return_types[0] == TYPE_NULL) {
+        if (value != NULL && !is_null_literal(value)) {
+            lower_expression(builder, value);
+        }
+        emit(builder, IR_RETURN, TYPE_NULL, node->line);
+    } else {
+        IrInstr* result = lower_value(builder, value, function->return_types[0]);
+        IrInstr* ret = emit(builder, IR_RETURN, TYPE_NULL, node->line);
+        ir_add_operand(ret, result);
+    }
+
+    builder->current = NULL;
+}
+
+static void lower_if(IrBuilder* builder, AstNode* node) {
+    IrInstr* condition = lower_expression(builder, node->value.if_stmt.condition);
+    AstNode* else_node = node->value.if_stmt.else_branch;
+
+    IrBlock* then_block = ir_new_block(builder->function);
+    IrBlock* else_block = else_node != NULL ? ir_new_block(builder->function) : NULL;
+    IrBlock* merge = ir_new_block(builder->function);
+
+    emit_branch(builder, condition, then_block, else_block != NULL ? else_block : merge, node->line);
+
+    seal_block(builder, then_block);
+    builder->current = then_block;
+    lower_block(builder, node->value.if_stmt.then_branches[0]);
+    if (builder->current != NULL) emit_jump(builder, merge, node->line);
+
+    if (else_block != NULL) {
+        seal_block(builder, else_block);
+        builder->current = else_block;
+        lower_block(builder, else_node);
+        if (builder->current != NULL) emit_jump(builder, merge, node->line);
+    }
+
+    seal_block(builder, merge);
+    // Both arms returned: nothing reaches the merge block
+    builder->current = merge->pred_count > 0 ? merge : NULL;
+}
+
+static void lower_while(IrBuilder* builder, AstNode* node) {
+    IrBlock* header = ir_new_block(builder->function);
+    emit_jump(builder, header, node->line);
+
+    // The header stays unsealed until the back edge from the body exists
+    builder->current = header;
+    IrInstr* condition = lower_expression(builder, node->value.while_stmt.condition);
+
+    IrBlock* body = ir_new_block(builder->function);
+    IrBlock* exit = ir_new_block(builder->function);
+    emit_branch(builder, condition, body, exit, node->line);
+
+    seal_block(builder, body);
+    builder->current = body;
+    lower_block(builder, node->value.while_stmt.body);
+    if (builder->current != NULL) emit_jump(builder, header, node->line);
+
+    seal_block(builder, header);
+    seal_block(builder, exit);
+    builder->current = exit;
+}
+
+// A range() step written as a literal, possibly negated; false for any
+// other step, whose sign is only known at run time
+static bool literal_step(AstNode* step, int64_t* value) {
+    if (step == NULL) {
+        *value = 1;
+        return true;
+    }
+    bool negated = step->type == NODE_UNARY_OP && step->value.unary_op.operator == TOKEN_MINUS;
+    AstNode* literal = negated ? step->value.unary_op.operand : step;
+    if (!is_number_literal(literal) || strchr(literal->value.literal.value, '.') != NULL) return false;
+    *value = strtoll(literal->value.literal.value, NULL, 10) * (negated ? -1 : 1);
+    return true;
+}
+
+static IrInstr* emit_compare(IrBuilder* builder, IrOpcode op, IrInstr* left, IrInstr* right, int line) {
+    IrInstr* compare = emit(builder, op, TYPE_BOOL, line);
+    ir_add_operand(compare, left);
+    ir_add_operand(compare, right);
+    return compare;
+}
+
+// for i = range(start, end, step) counts a hidden i64 induction variable
+// from start by step; the bounds and step are evaluated once before the
+// loop and i is the counter converted to its declared type. A step whose
+// sign is only known at run time picks the comparison with a branch in the
+// header.
+static void lower_for(IrBuilder* builder, AstNode* node) {
+    int line = node->line;
+    int64_t literal;
+    int sign = 0;
+    if (literal_step(node->value.for_stmt.step, &literal)) {
+        if (literal == 0) {
+            lower_error(builder, node, "range() step must not be zero");
+            return;
+        }
+        sign = literal > 0 ? 1 : -1;
+    }
+    IrInstr* start = lower_value(builder, node->value.for_stmt.start, TYPE_I64);
+    IrInstr* end = lower_value(builder, node->value.for_stmt.end, TYPE_I64);
+    IrInstr* step = node->value.for_stmt.step != NULL
+                        ? lower_value(builder, node->value.for_stmt.step, TYPE_I64)
+                        : emit_const(builder, TYPE_I64, 1, line);
+    IrInstr* ascending = sign == 0 ? emit_compare(builder, IR_GT, step, emit_const(builder, TYPE_I64, 0, line), line)
+                                   : NULL;
+
+    char counter_name[32];
+    snprintf(counter_name, sizeof(counter_name), "range.%d", line);
+    int counter = declare_variable(builder, counter_name, TYPE_I64);
+    write_variable(builder, counter, current_block(builder), start);
+
+    IrBlock* header = ir_new_block(builder->function);
+    IrBlock* body = ir_new_block(builder->function);
+    IrBlock* exit = ir_new_block(builder->function);
+    emit_jump(builder, header, line);
+
+    // The header stays unsealed until the back edge from the body exists
+    builder->current = header;
+    IrInstr* at = read_variable(builder, counter, header);
+    header->loop = node;
+    header->induction = at;
+    if (sign != 0) {
+        emit_branch(builder, emit_compare(builder, sign > 0 ? IR_LT : IR_GT, at, end, line), body, exit, line);
+    } else {
+        IrBlock* up = ir_new_block(builder->function);
+        IrBlock* down = ir_new_block(builder->function);
+        emit_branch(builder, ascending, up, down, line);
+        seal_block(builder, up);
+        seal_block(builder, down);
+        builder->current = up;
+        emit_branch(builder, emit_compare(builder, IR_LT, at, end, line), body, exit, line);
+        builder->current = down;
+        emit_branch(builder, emit_compare(builder, IR_GT, at, end, line), body, exit, line);
+    }
+
+    seal_block(builder, body);
+    builder->current = body;
+    int variable = declare_variable(builder, node->value.for_stmt.name, node->value.for_stmt.type);
+    write_variable(builder, variable, body, coerce(builder, at, node->value.for_stmt.type, line));
+    lower_block(builder, node->value.for_stmt.body);
+    if (builder->current != NULL) {
+        IrInstr* next = emit(builder, IR_ADD, TYPE_I64, line);
+        ir_add_operand(next, read_variable(builder, counter, current_block(builder)));
+        ir_add_operand(next, step);
+        write_variable(builder, counter, current_block(builder), next);
+        emit_jump(builder, header, line);
+    }
+
+    seal_block(builder, header);
+    seal_block(builder, exit);
+    builder->current = exit;
+}
+
+// Declare the variables of "T value, bool ok" from values 1 and 2 of
+// tuple, a recv() or select call
+static void declare_received(IrBuilder* builder, AstNode** targets, int count, IrInstr* tuple, DataType element,
+                             int line) {
+    DataType types[2] = {element, TYPE_BOOL};
+    for (int i = 0; i < count; i++) {
+        IrInstr* value = emit(builder, IR_EXTRACT, types[i], line);
+        ir_add_operand(value, tuple);
+        value->index = i + 1;
+        value = coerce(builder, value, targets[i]->value.variable.type, line);
+        int variable = declare_variable(builder, targets[i]->value.variable.name, targets[i]->value.variable.type);
+        write_variable(builder, variable, current_block(builder), value);
+    }
+}
+
+// "T value, bool ok = recv(c)" calls recv for a tuple whose value 0 is
+// unused, like a select's
+static void lower_recv_ok(IrBuilder* builder, AstNode* node) {
+    IrInstr* call = lower_call(builder, node->value.destructure.value);
+    if (call->op != IR_CALL) return;
+    DataType element = call->type;
+    call->type = TYPE_TUPLE;
+    declare_received(builder, node->value.destructure.targets, 2, call, element, node->line);
+}
+
+// select becomes one call that carries out a case and returns a tuple of
+// the case's index, the value received and whether the channel was open,
+// then a branch to each case's body
+static void lower_select(IrBuilder* builder, AstNode* node) {
+    int count = node->value.select_stmt.case_count;
+    IrInstr* select = ir_new_instr(builder->function, IR_CALL, TYPE_TUPLE);
+    select->name = strdup("select");
+    select->line = node->line;
+    DataType* elements = malloc(sizeof(DataType) * count);
+    for (int i = 0; i < count; i++) {
+        AstNode* head = node->value.select_stmt.cases[i];
+        AstNode* call = head->type == NODE_VARIABLE      ? head->value.variable.init_value
+                        : head->type == NODE_DESTRUCTURE ? head->value.destructure.value
+                                                         : head;
+        AstNode** arguments = call->value.function_call.arguments;
+        IrInstr* chan = lower_expression(builder, arguments[0]);
+        elements[i] = type_kind(chan->type) == TYPE_CHAN && chan->type != TYPE_CHAN ? type_element(chan->type) : TYPE_NULL;
+        if (elements[i] == TYPE_NULL || find_ast_function(builder, call->value.function_call.name) != NULL) {
+            lower_error(builder, call, "select cases use the builtin send and recv on channels");
+        }
+        ir_add_operand(select, chan);
+        if (strcmp(call->value.function_call.name, "send") == 0) {
+            ir_add_operand(select, lower_value(builder, arguments[1], elements[i]));
+        }
+    }
+    ir_append_instr(current_block(builder), select);
+
+    IrInstr* chosen = emit(builder, IR_EXTRACT, TYPE_I32, node->line);
+    ir_add_operand(chosen, select);
+    chosen->index = 0;
+
+    IrBlock* merge = ir_new_block(builder->function);
+    AstNode* else_node = node->value.select_stmt.else_branch;
+    for (int i = 0; i < count; i++) {
+        IrBlock* body = ir_new_block(builder->function);
+        IrBlock* next = NULL;
+        if (i < count - 1 || else_node != NULL) {
+            next = ir_new_block(builder->function);
+            IrInstr* test = emit(builder, IR_EQ, TYPE_BOOL, node->line);
+            ir_add_operand(test, chosen);
+            ir_add_operand(test, emit_const(builder, TYPE_I32, i, node->line));
+            emit_branch(builder, test, body, next, node->line);
+        } else {
+            emit_jump(builder, body, node->line);
+        }
+
+        seal_block(builder, body);
+        builder->current = body;
+        AstNode* head = node->value.select_stmt.cases[i];
+        if (head->type == NODE_VARIABLE) {
+            declare_received(builder, &head, 1, select, elements[i], node->line);
+        } else if (head->type == NODE_DESTRUCTURE) {
+            declare_received(builder, head->value.destructure.targets, 2, select, elements[i], node->line);
+        }
+        lower_block(builder, node->value.select_stmt.bodies[i]);
+        if (builder->current != NULL) emit_jump(builder, merge, node->line);
+
+        if (next != NULL) {
+            seal_block(builder, next);
+            builder->current = next;
+        }
+    }
+    if (else_node != NULL) {
+        lower_block(builder, else_node);
+        if (builder->current != NULL) emit_jump(builder, merge, node->line);
+    }
+    free(elements);
+
+    seal_block(builder, merge);
+    builder->current = merge->pred_count > 0 ? merge : NULL;
+}
+
+static void lower_statement(IrBuilder* builder, AstNode* node) {
+    switch (node->type) {
+        case NODE_RETURN:
+            lower_return(builder, node);
+            break;
+
+        case NODE_VARIABLE: {
+            DataType type = node->value.variable.type;
+            IrInstr* value = lower_value(builder, node->value.variable.init_value, type);
+            int variable = declare_variable(builder, node->value.variable.name, type);
+            write_variable(builder, variable, current_block(builder), value);
+            break;
+        }
+
+        case NODE_DESTRUCTURE: {
+            AstNode* call = node->value.destructure.value;
+            AstNode* function = find_ast_function(builder, call->value.function_call.name);
+            int count = node->value.destructure.target_count;
+            if (function == NULL && strcmp(call->value.function_call.name, "recv") == 0 && count == 2) {
+                lower_recv_ok(builder, node);
+                break;
+            }
+            if (function == NULL || function->value.function.return_type_count != count) {
+                lower_error(builder, node, "Call does not return as many values as are declared");
+                break;
+            }
+
+            // The values stay separate SSA values; no tuple object exists
+            IrInstr* tuple = lower_call(builder, call);
+            for (int i = 0; i < count; i++) {
+                AstNode* target = node->value.destructure.targets[i];
+                IrInstr* value = emit(builder, IR_EXTRACT, function->value.function.return_types[i], node->line);
+                ir_add_operand(value, tuple);
+                value->index = i;
+                value = coerce(builder, value, target->value.variable.type, node->line);
+                int variable = declare_variable(builder, target->value.variable.name, target->value.variable.type);
+                write_variable(builder, variable, current_block(builder), value);
+            }
+            break;
+        }
+
+        case NODE_ASSIGNMENT: {
+            int variable = find_variable(builder, node->value.assignment.name);
+            if (variable < 0) {
+                lower_error(builder, node, "Assignment to undeclared variable");
+                break;
+            }
+            DataType type = builder->variables[variable].type;
+
+            // xs[i] = value writes the element; xs itself keeps its value
+            if (node->value.assignment.index != NULL) {
+                if (!is_sequence_type(type)) {
+                    lower_error(builder, node, "Only arrays and lists can be indexed");
+                    break;
+                }
+                IrInstr* sequence = read_variable(builder, variable, current_block(builder));
+                IrInstr* index = lower_expression(builder, node->value.assignment.index);
+                IrInstr* value = lower_value(builder, node->value.assignment.value, type_element(type));
+                IrInstr* store = emit(builder, IR_STORE, TYPE_NULL, node->line);
+                ir_add_operand(store, sequence);
+                ir_add_operand(store, index);
+                ir_add_operand(store, value);
+                store->source = node;
+                break;
+            }
+
+            IrInstr* value = lower_value(builder, node->value.assignment.value, type);
+            write_variable(builder, variable, current_block(builder), value);
+            break;
+        }
+
+        case NODE_IF:
+            lower_if(builder, node);
+            break;
+
+        case NODE_WHILE:
+            lower_while(builder, node);
+            break;
+
+        case NODE_FOR:
+            lower_for(builder, node);
+            break;
+
+        case NODE_GO: {
+            // Lowered like the call, which then runs on a new task instead
+            AstNode* call = node->value.go_stmt.call;
+            if (find_ast_function(builder, call->value.function_call.name) == NULL) {
+                lower_error(builder, node, "Only functions of the program can run with go");
+                break;
+            }
+            IrInstr* spawn = lower_call(builder, call);
+            if (spawn->op == IR_CALL) {
+                spawn->op = IR_SPAWN;
+                spawn->type = TYPE_NULL;
+            }
+            break;
+        }
+
+        case NODE_SELECT:
+            lower_select(builder, node);
+            break;
+
+        case NODE_BLOCK:
+            lower_block(builder, node);
+            break;
+
+        default:
+            lower_expression(builder, node);
+            break;
+    }
+}
+
+static IrFunction* lower_function(IrBuilder* builder, AstNode* node) {
+    IrFunction* function = ir_alloc(sizeof(IrFunction));
+    function->name = strdup(node->value.function.name);
+    function->line = node->line;
+    function->source = node;
+    function->param_count = node->value.function.param_count;
+    function->param_types = ir_alloc(sizeof(DataType) * (function->param_count + 1));
+    function->return_type_count = node->value.function.return_type_count;
+    function->return_types = ir_alloc(sizeof(DataType) * function->return_type_count);
+    memcpy(function->return_types, node->value.function.return_types,
+           sizeof(DataType) * function->return_type_count);
+
+    builder->function = function;
+    builder->current = NULL;
+    builder->variable_count = 0;
+
+    IrBlock* entry = current_block(builder);
+    for (int i = 0; i < function->param_count; i++) {
+        AstNode* param = node->value.function.parameters[i];
+        DataType type = param->value.parameter.type;
+        function->param_types[i] = type;
+
+        IrInstr* value = emit(builder, IR_PARAM, type, param->line);
+        value->index = i;
+        int variable = declare_variable(builder, param->value.parameter.name, type);
+        write_variable(builder, variable, entry, value);
+    }
+
+    lower_block(builder, node->value.function.body);
+
+    if (builder->current != NULL) {
+        if (function->return_type_count == 1 && function->return_types[0] == TYPE_NULL) {
+            emit(builder, IR_RETURN, TYPE_NULL, node->line);
+        } else {
+            lower_error(builder, node, "Function can end without returning a value");
+        }
+        builder->current = NULL;
+    }
+
+    // Drops the blocks that only hold code after a return
+    ir_remove_unreachable_blocks(function);
+
+    for (int s = 0; s < builder->state_capacity; s++) {
+        free(builder->states[s].defs);
+        free(builder->states[s].incomplete);
+    }
+    memset(builder->states, 0, sizeof(IrBlockState) * builder->state_capacity);
+    for (int v = 0; v < builder->variable_count; v++) {
+        free(builder->variables[v].name);
+    }
+
+    return function;
+}
+
+static IrModule* lower_program(AstNode* program, bool quiet) {
+    IrBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.program = program;
+    builder.quiet = quiet;
+    builder.constant_type = TYPE_NULL;
+
+    IrModule* module = ir_alloc(sizeof(IrModule));
+    module->function_count = program->value.block.statement_count;
+    module->functions = ir_alloc(sizeof(IrFunction*) * (module->function_count + 1));
+
+    for (int i = 0; i < module->function_count; i++) {
+        module->functions[i] = lower_function(&builder, program->value.block.statements[i]);
+    }
+
+    free(builder.states);
+    free(builder.variables);
+
+    if (builder.had_error) {
+        ir_free_module(module);
+        return NULL;
+    }
+    return module;
+}
+
+IrModule* ir_lower_program(AstNode* program) {
+    return lower_program(program, false);
+}
+
+IrModule* ir_lower_program_quietly(AstNode* program) {
+    return lower_program(program, true);
+}
+
+void ir_set_overflow_mode(IrModule* module, pf_overflow_mode mode) {
+    for (int f = 0; f < module->function_count; f++) {
+        module->functions[f]->overflow_mode = mode;
+    }
+}
+
+void ir_free_module(IrModule* module) {
+    if (module == NULL) return;
+
+    for (int f = 0; f < module->function_count; f++) {
+        IrFunction* function = module->functions[f];
+        for (int b = 0; b < function->block_count; b++) {
+            free_block(function->blocks[b]);
+        }
+        free(function->blocks);
+        free(function->param_types);
+        free(function->return_types);
+        free(function->name);
+        free(function);
+    }
+    free(module->functions);
+    free(module->inline_sites);
+    free(module);
+}
+
+// ---------------------------------------------------------------------------
+// Dump
+
+const char* ir_opcode_name(IrOpcode op) {
+    switch (op) {
+        case IR_CONST: return "const";
+        case IR_STRING: return "string";
+        case IR_UNDEF: return "undef";
+        case IR_PARAM: return "param";
+        case IR_ADD: return "add";
+        case IR_SUB: return "sub";
+        case IR_MUL: return "mul";
+        case IR_DIV: return "div";
+        case IR_MOD: return "mod";
+        case IR_NEG: return "neg";
+        case IR_EQ: return "eq";
+        case IR_NE: return "ne";
+        case IR_LT: return "lt";
+        case IR_LE: return "le";
+        case IR_GT: return "gt";
+        case IR_GE: return "ge";
+        case IR_CONVERT: return "convert";
+        case IR_COPY: return "copy";
+        case IR_PHI: return "phi";
+        case IR_FORMAT: return "format";
+        case IR_CALL: return "call";
+        case IR_SPAWN: return "spawn";
+        case IR_EXTRACT: return "extract";
+        case IR_LOAD: return "load";
+        case IR_STORE: return "store";
+        case IR_LENGTH: return "length";
+        case IR_JUMP: return "jump";
+        case IR_BRANCH: return "branch";
+        case IR_RETURN: return "return";
+    }
+    return "unknown";
+}
+
+static void dump_instr(IrInstr* instr, FILE* out) {
+    fputs("    ", out);
+    bool has_value = !ir_is_terminator(instr->op) && instr->type != TYPE_NULL;
+    if (ir_defines_value(instr)) {
+        fprintf(out, "v%d = ", instr->id);
+    }
+    fputs(ir_opcode_name(instr->op), out);
+
+    switch (instr->op) {
+        case IR_CONST:
+            if (instr->type == TYPE_F32 || instr->type == TYPE_F64) {
+                fprintf(out, " %g", instr->imm.f);
+            } else {
+                fprintf(out, " %lld", (long long)instr->imm.i);
+            }
+            break;
+        case IR_STRING:
+            fprintf(out, " %s", instr->name);
+            break;
+        case IR_PARAM:
+            fprintf(out, " %d", instr->index);
+            break;
+        case IR_EXTRACT:
+            fprintf(out, " v%d, %d", instr->operands[0]->id, instr->index);
+            break;
+        case IR_CALL:
+        case IR_SPAWN:
+            fprintf(out, " %s(", instr->name);
+            for (int i = 0; i < instr->operand_count; i++) {
+                fprintf(out, "%sv%d", i > 0 ? ", " : "", instr->operands[i]->id);
+            }
+            fputs(")", out);
+            break;
+        case IR_PHI:
+            for (int i = 0; i < instr->operand_count; i++) {
+                fprintf(out, "%s [v%d, bb%d]", i > 0 ? "," : "", instr->operands[i]->id,
+                        instr->block->preds[i]->id);
+            }
+            break;
+        case IR_JUMP:
+            fprintf(out, " bb%d", instr->targets[0]->id);
+            break;
+        case IR_BRANCH:
+            fprintf(out, " v%d, bb%d, bb%d", instr->operands[0]->id, instr->targets[0]->id, instr->targets[1]->id);
+            break;
+        default:
+            for (int i = 0; i < instr->operand_count; i++) {
+                fprintf(out, "%s v%d", i > 0 ? "," : "", instr->operands[i]->id);
+            }
+            break;
+    }
+
+    if (has_value) {
+        fprintf(out, " : %s", data_type_to_string(instr->type));
+    }
+    if (instr->bounds == IR_BOUNDS_PROVEN) {
+        fputs(" ; in bounds", out);
+    } else if (instr->bounds == IR_BOUNDS_HOISTED) {
+        fputs(" ; checked before the loop", out);
+    }
+    fputs("\n", out);
+}
+
+void ir_dump_function(IrFunction* function, FILE* out) {
+    fprintf(out, "function %s(", function->name);
+    for (int i = 0; i < function->param_count; i++) {
+        fprintf(out, "%s%s", i > 0 ? ", " : "", data_type_to_string(function->param_types[i]));
+    }
+    fputs(") -> ", out);
+    if (function->return_type_count > 1) fputs("(", out);
+    for (int i = 0; i < function->return_type_count; i++) {
+        fprintf(out, "%s%s", i > 0 ? ", " : "", data_type_to_string(function->return_types[i]));
+    }
+    if (function->return_type_count > 1) fputs(")", out);
+    fputs("\n", out);
+
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        fprintf(out, "bb%d:", block->id);
+        if (block->pred_count > 0) {
+            fputs(" ; preds", out);
+            for (int p = 0; p < block->pred_count; p++) {
+                fprintf(out, " bb%d", block->preds[p]->id);
+            }
+        }
+        fputs("\n", out);
+        for (int i = 0; i < block->instr_count; i++) {
+            dump_instr(block->instrs[i], out);
+        }
+    }
+}
+
+void ir_dump_module(IrModule* module, FILE* out) {
+    for (int f = 0; f < module->function_count; f++) {
+        if (f > 0) fputs("\n", out);
+        ir_dump_function(module->functions[f], out);
+    }
+}
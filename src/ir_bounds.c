@@ -0,0 +1,367 @@
+#include "../include/ir.h"
+
+// Proofs look through at most this many phis, conversions and comparisons
+#define MAX_DEPTH 8
+
+// Largest step of a counter bounded only by a length; lengths stay far
+// below 2^62, so such a counter cannot wrap
+#define MAX_LENGTH_STEP ((int64_t)1 << 32)
+
+// A place in the function: before instruction position of block
+typedef struct {
+    IrBlock* block;
+    int position;
+} IrPoint;
+
+// left < right (IR_LT) or left <= right (IR_LE), known to hold at a block
+typedef struct {
+    IrOpcode op;
+    IrInstr* left;
+    IrInstr* right;
+} IrFact;
+
+static bool is_signed_integer(DataType type) {
+    return type >= TYPE_I8 && type <= TYPE_I64;
+}
+
+static int type_bits(DataType type) {
+    switch (type) {
+        case TYPE_U8: case TYPE_I8: return 8;
+        case TYPE_U16: case TYPE_I16: return 16;
+        case TYPE_U32: case TYPE_I32: return 32;
+        default: return 64;
+    }
+}
+
+static bool is_constant_int(IrInstr* instr, int64_t* value) {
+    if (instr->op != IR_CONST || instr->type > TYPE_I64) return false;
+    *value = instr->imm.i;
+    return true;
+}
+
+// Look through conversions that keep every value as it is: to a wider
+// signed type, or from an unsigned type to a wider one
+static IrInstr* strip_widening(IrInstr* instr) {
+    while (instr->op == IR_CONVERT && instr->type <= TYPE_I64 && instr->operands[0]->type <= TYPE_I64) {
+        DataType from = instr->operands[0]->type;
+        bool widens = type_bits(instr->type) > type_bits(from) ||
+                      (type_bits(instr->type) == type_bits(from) && from == instr->type);
+        if (!widens || (is_signed_integer(from) && !is_signed_integer(instr->type))) break;
+        instr = instr->operands[0];
+    }
+    return instr;
+}
+
+static bool same_value(IrInstr* a, IrInstr* b) {
+    return strip_widening(a) == strip_widening(b);
+}
+
+static bool is_length_of(IrInstr* instr, IrInstr* sequence) {
+    instr = strip_widening(instr);
+    return instr->op == IR_LENGTH && instr->operands[0] == sequence;
+}
+
+// The fact a branch establishes on one of its edges, as left < right or
+// left <= right; false for conditions that are not integer comparisons
+static bool edge_fact(IrInstr* condition, bool taken, IrFact* fact) {
+    IrInstr* a;
+    IrInstr* b;
+    IrOpcode op = condition->op;
+    if (op < IR_LT || op > IR_GE || condition->operand_count != 2) return false;
+    a = condition->operands[0];
+    b = condition->operands[1];
+    if (!is_signed_integer(a->type) || !is_signed_integer(b->type)) return false;
+
+    // Each comparison, negated on the false edge, as < or <= with swapped
+    // operands where needed
+    switch (op) {
+        case IR_LT: *fact = taken ? (IrFact){IR_LT, a, b} : (IrFact){IR_LE, b, a}; break;
+        case IR_LE: *fact = taken ? (IrFact){IR_LE, a, b} : (IrFact){IR_LT, b, a}; break;
+        case IR_GT: *fact = taken ? (IrFact){IR_LT, b, a} : (IrFact){IR_LE, a, b}; break;
+        case IR_GE: *fact = taken ? (IrFact){IR_LE, b, a} : (IrFact){IR_LT, a, b}; break;
+        default: return false;
+    }
+    return true;
+}
+
+// Facts of the branches on the way to block: each block on its dominator
+// chain that has a single predecessor ending in a two-way branch was
+// entered through one edge of it
+static int collect_facts(IrBlock* block, IrFact* facts, int capacity) {
+    int count = 0;
+    for (IrBlock* at = block; at != NULL && count < capacity; at = at->idom == at ? NULL : at->idom) {
+        if (at->pred_count != 1) continue;
+        IrInstr* branch = ir_terminator(at->preds[0]);
+        if (branch == NULL || branch->op != IR_BRANCH || branch->targets[0] == branch->targets[1]) continue;
+        if (edge_fact(branch->operands[0], branch->targets[0] == at, &facts[count])) count++;
+    }
+    return count;
+}
+
+#define MAX_FACTS 64
+
+static bool point_dominated_by(IrPoint point, IrInstr* instr) {
+    if (instr->block == point.block) {
+        for (int i = 0; i < point.position && i < point.block->instr_count; i++) {
+            if (point.block->instrs[i] == instr) return true;
+        }
+        return false;
+    }
+    return ir_dominates(instr->block, point.block);
+}
+
+static IrPoint point_of(IrInstr* instr) {
+    IrPoint point = {instr->block, 0};
+    for (int i = 0; i < instr->block->instr_count; i++) {
+        if (instr->block->instrs[i] == instr) point.position = i;
+    }
+    return point;
+}
+
+static IrPoint end_of(IrBlock* block) {
+    return (IrPoint){block, block->instr_count};
+}
+
+// An access that is still checked and dominates point has already shown
+// that its index lies in [0, length) of its sequence; a list only grows,
+// so that stays true
+static bool checked_access_dominates(IrFunction* function, IrPoint point, IrInstr* sequence, IrInstr* index) {
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (!ir_dominates(block, point.block)) continue;
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* access = block->instrs[i];
+            if (access->op != IR_LOAD && access->op != IR_STORE) continue;
+            if (sequence != NULL && access->operands[0] != sequence) continue;
+            if (!same_value(access->operands[1], index)) continue;
+            if (point_dominated_by(point, access)) return true;
+        }
+    }
+    return false;
+}
+
+static bool is_nonnegative(IrFunction* function, IrInstr* value, IrPoint point, int depth);
+static bool is_below_length(IrFunction* function, IrInstr* value, IrInstr* sequence, IrPoint point, int depth);
+
+// add is phi + step or phi - -step for a constant step
+static bool is_phi_step(IrInstr* add, IrInstr* phi, int64_t* step) {
+    if (add->operand_count != 2) return false;
+    if (add->op == IR_SUB && add->operands[0] == phi && is_constant_int(add->operands[1], step)) {
+        if (*step == INT64_MIN) return false;
+        *step = -*step;
+        return true;
+    }
+    if (add->op != IR_ADD) return false;
+    if (add->operands[0] == phi) return is_constant_int(add->operands[1], step);
+    if (add->operands[1] == phi) return is_constant_int(add->operands[0], step);
+    return false;
+}
+
+// value at add cannot go past the top of its type when step is added: a
+// dominating test holds it below something of its own type, or below a
+// length while the step is small
+static bool step_cannot_wrap_up(IrInstr* value, int64_t step, IrInstr* add) {
+    IrFact facts[MAX_FACTS];
+    int count = collect_facts(add->block, facts, MAX_FACTS);
+    for (int f = 0; f < count; f++) {
+        if (facts[f].op != IR_LT || facts[f].left != value) continue;
+        if (step <= 1) return true;
+        IrInstr* bound = strip_widening(facts[f].right);
+        if (value->type == TYPE_I64 && bound->op == IR_LENGTH && step <= MAX_LENGTH_STEP) return true;
+    }
+    return false;
+}
+
+// The same going down: held above something of its own type, or not
+// negative while the step is small
+static bool step_cannot_wrap_down(IrFunction* function, IrInstr* value, int64_t step, IrInstr* add, int depth) {
+    IrFact facts[MAX_FACTS];
+    int count = collect_facts(add->block, facts, MAX_FACTS);
+    for (int f = 0; f < count; f++) {
+        if (facts[f].op == IR_LT && facts[f].right == value && step >= -1) return true;
+    }
+    return value->type == TYPE_I64 && step >= -MAX_LENGTH_STEP &&
+           is_nonnegative(function, value, point_of(add), depth + 1);
+}
+
+static bool is_nonnegative(IrFunction* function, IrInstr* value, IrPoint point, int depth) {
+    if (depth > MAX_DEPTH) return false;
+
+    int64_t constant;
+    if (is_constant_int(value, &constant)) {
+        return constant >= 0 && (is_signed_integer(value->type) || value->type != TYPE_U64);
+    }
+    // u64 above INT64_MAX would turn negative as an index
+    if (value->type <= TYPE_U32) return true;
+    if (value->op == IR_LENGTH) return true;
+    IrInstr* stripped = strip_widening(value);
+    if (stripped != value) return is_nonnegative(function, stripped, point, depth + 1);
+
+    IrFact facts[MAX_FACTS];
+    int count = collect_facts(point.block, facts, MAX_FACTS);
+    for (int f = 0; f < count; f++) {
+        if (!same_value(facts[f].right, value)) continue;
+        IrInstr* lower = facts[f].left;
+        if (is_constant_int(lower, &constant) && constant >= (facts[f].op == IR_LT ? -1 : 0)) return true;
+        if (lower != value && is_nonnegative(function, lower, point, depth + 1)) return true;
+    }
+
+    if (checked_access_dominates(function, point, NULL, value)) return true;
+
+    // A counter that starts at 0 or above and only counts up without wrapping
+    if (value->op == IR_PHI) {
+        for (int o = 0; o < value->operand_count; o++) {
+            IrInstr* operand = value->operands[o];
+            int64_t step;
+            if (operand == value) continue;
+            if (is_phi_step(operand, value, &step)) {
+                if (step < 0 || !step_cannot_wrap_up(value, step, operand)) return false;
+                continue;
+            }
+            if (!is_nonnegative(function, operand, end_of(value->block->preds[o]), depth + 1)) return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool is_below_length(IrFunction* function, IrInstr* value, IrInstr* sequence, IrPoint point, int depth) {
+    if (depth > MAX_DEPTH) return false;
+
+    IrFact facts[MAX_FACTS];
+    int count = collect_facts(point.block, facts, MAX_FACTS);
+    for (int f = 0; f < count; f++) {
+        if (!same_value(facts[f].left, value)) continue;
+        if (facts[f].op == IR_LT && is_length_of(facts[f].right, sequence)) return true;
+        IrInstr* upper = facts[f].right;
+        if (upper != value && is_below_length(function, upper, sequence, point, depth + 1)) return true;
+    }
+
+    if (checked_access_dominates(function, point, sequence, value)) return true;
+
+    // length - c for a constant c >= 1
+    IrInstr* stripped = strip_widening(value);
+    int64_t constant;
+    if (stripped->op == IR_SUB && is_length_of(stripped->operands[0], sequence) &&
+        is_constant_int(stripped->operands[1], &constant) && constant >= 1) {
+        return true;
+    }
+    if (stripped->op == IR_ADD && is_length_of(stripped->operands[0], sequence) &&
+        is_constant_int(stripped->operands[1], &constant) && constant <= -1) {
+        return true;
+    }
+
+    // A counter that starts below the length and only counts down without wrapping
+    if (value->op == IR_PHI) {
+        for (int o = 0; o < value->operand_count; o++) {
+            IrInstr* operand = value->operands[o];
+            int64_t step;
+            if (operand == value) continue;
+            if (is_phi_step(operand, value, &step)) {
+                if (step > 0 || !step_cannot_wrap_down(function, value, step, operand, depth)) return false;
+                continue;
+            }
+            if (!is_below_length(function, operand, sequence, end_of(value->block->preds[o]), depth + 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// Hoist access if it is indexed by the counter of a for loop it sits in
+// and its sequence is the same on every iteration
+static bool hoist_access(IrFunction* function, IrInstr* access) {
+    IrInstr* index = access->operands[1];
+    if (index->op != IR_PHI) return false;
+    IrBlock* header = index->block;
+    if (header->loop == NULL || header->induction != index) return false;
+
+    bool* in_loop = ir_loop_blocks(function, header);
+    bool hoisted = in_loop[access->block->id] && !in_loop[access->operands[0]->block->id];
+    free(in_loop);
+    return hoisted;
+}
+
+bool ir_eliminate_bounds_checks(IrFunction* function) {
+    ir_compute_dominators(function);
+    bool changed = false;
+
+    // An access proven here still holds its index in bounds, so later
+    // accesses may lean on it whatever order the blocks come in
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (block->rpo_index < 0) continue;
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* access = block->instrs[i];
+            if ((access->op != IR_LOAD && access->op != IR_STORE) || access->bounds != IR_BOUNDS_CHECKED) continue;
+
+            IrPoint point = {block, i};
+            IrInstr* sequence = access->operands[0];
+            IrInstr* index = access->operands[1];
+            if (is_nonnegative(function, index, point, 0) && is_below_length(function, index, sequence, point, 0)) {
+                access->bounds = IR_BOUNDS_PROVEN;
+                changed = true;
+            }
+        }
+    }
+
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (block->rpo_index < 0) continue;
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* access = block->instrs[i];
+            if ((access->op != IR_LOAD && access->op != IR_STORE) || access->bounds != IR_BOUNDS_CHECKED) continue;
+            if (hoist_access(function, access)) {
+                access->bounds = IR_BOUNDS_HOISTED;
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+void ir_dump_bounds_report(IrFunction* function, FILE* out) {
+    int counts[3] = {0, 0, 0};
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* access = block->instrs[i];
+            if (access->op == IR_LOAD || access->op == IR_STORE) counts[access->bounds]++;
+        }
+    }
+
+    int total = counts[IR_BOUNDS_CHECKED] + counts[IR_BOUNDS_PROVEN] + counts[IR_BOUNDS_HOISTED];
+    fprintf(out, "function %s: %d of %d bounds checks removed (%d proven, %d hoisted out of loops)\n",
+            function->name, counts[IR_BOUNDS_PROVEN] + counts[IR_BOUNDS_HOISTED], total,
+            counts[IR_BOUNDS_PROVEN], counts[IR_BOUNDS_HOISTED]);
+}
+
+IrBoundsFact* ir_collect_bounds_facts(IrModule* module, int* count) {
+    *count = 0;
+    IrBoundsFact* facts = NULL;
+    int capacity = 0;
+    for (int f = 0; f < module->function_count; f++) {
+        IrFunction* function = module->functions[f];
+        for (int b = 0; b < function->block_count; b++) {
+            IrBlock* block = function->blocks[b];
+            for (int i = 0; i < block->instr_count; i++) {
+                IrInstr* access = block->instrs[i];
+                if ((access->op != IR_LOAD && access->op != IR_STORE) || access->bounds == IR_BOUNDS_CHECKED ||
+                    access->source == NULL) {
+                    continue;
+                }
+                if (*count == capacity) {
+                    capacity = capacity == 0 ? 8 : capacity * 2;
+                    facts = realloc(facts, sizeof(IrBoundsFact) * capacity);
+                }
+                facts[*count].source = access->source;
+                facts[*count].loop = access->bounds == IR_BOUNDS_HOISTED ? access->operands[1]->block->loop : NULL;
+                (*count)++;
+            }
+        }
+    }
+    return facts;
+}
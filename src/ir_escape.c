@@ -0,0 +1,272 @@
+#include "../include/ir.h"
+
+static int find_function(IrModule* module, const char* name) {
+    for (int f = 0; f < module->function_count; f++) {
+        if (strcmp(module->functions[f]->name, name) == 0) return f;
+    }
+    return -1;
+}
+
+// Bytes of one element of an array that may live in a frame; strings stay
+// out of frames
+static int element_size(DataType type) {
+    switch (type) {
+        case TYPE_U8:
+        case TYPE_I8:
+        case TYPE_BOOL:
+            return 1;
+        case TYPE_U16:
+        case TYPE_I16:
+            return 2;
+        case TYPE_U32:
+        case TYPE_I32:
+        case TYPE_F32:
+            return 4;
+        case TYPE_U64:
+        case TYPE_I64:
+        case TYPE_F64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+// Whether the value user defines shares memory with its operands: copies,
+// phis, slices, and whatever a program function hands back, since it may
+// be one of its arguments
+static bool aliases_operands(IrModule* module, IrInstr* user) {
+    switch (user->op) {
+        case IR_COPY:
+        case IR_PHI:
+        case IR_EXTRACT:
+            return true;
+        case IR_CALL:
+            if (find_function(module, user->name) >= 0) {
+                return is_sequence_type(user->type) || user->type == TYPE_TUPLE;
+            }
+            return strcmp(user->name, "slice") == 0;
+        default:
+            return false;
+    }
+}
+
+// Whether passing a value as operand number operand of user lets it
+// outlive the call; if so, why goes to reason. keeps says which
+// parameters of each program function escape.
+static bool use_escapes(IrModule* module, bool** keeps, IrInstr* user, int operand, char* reason, size_t size) {
+    switch (user->op) {
+        case IR_COPY:
+        case IR_PHI:
+        case IR_EXTRACT:
+        case IR_LOAD:
+        case IR_LENGTH:
+            return false;
+        case IR_STORE:
+            if (operand != 2) return false;
+            snprintf(reason, size, "it is stored at line %d", user->line);
+            return true;
+        case IR_RETURN:
+            snprintf(reason, size, "it is returned at line %d", user->line);
+            return true;
+        case IR_SPAWN:
+            // The task may run on after this call has returned
+            snprintf(reason, size, "it is passed to a task at line %d", user->line);
+            return true;
+        case IR_CALL: {
+            int callee = find_function(module, user->name);
+            if (callee >= 0) {
+                if (operand < module->functions[callee]->param_count && !keeps[callee][operand]) return false;
+                snprintf(reason, size, "it is passed to %s at line %d, which lets it escape", user->name, user->line);
+                return true;
+            }
+            if (strcmp(user->name, "append") == 0 && operand == 1) {
+                snprintf(reason, size, "it is appended to a list at line %d", user->line);
+                return true;
+            }
+            // The other builtins read their arguments and keep none of them
+            return false;
+        }
+        default:
+            snprintf(reason, size, "it is used by %s at line %d", ir_opcode_name(user->op), user->line);
+            return true;
+    }
+}
+
+// Whether root, or any value sharing its memory, escapes function
+static bool escapes(IrModule* module, bool** keeps, IrFunction* function, IrInstr* root, char* reason,
+                    size_t size) {
+    bool* seen = calloc(function->next_value_id + 1, sizeof(bool));
+    IrInstr** worklist = malloc(sizeof(IrInstr*) * (function->next_value_id + 1));
+    int count = 0;
+    seen[root->id] = true;
+    worklist[count++] = root;
+
+    bool escaped = false;
+    while (count > 0 && !escaped) {
+        IrInstr* value = worklist[--count];
+        for (int b = 0; b < function->block_count && !escaped; b++) {
+            IrBlock* block = function->blocks[b];
+            for (int i = 0; i < block->instr_count && !escaped; i++) {
+                IrInstr* user = block->instrs[i];
+                for (int o = 0; o < user->operand_count && !escaped; o++) {
+                    if (user->operands[o] != value) continue;
+                    escaped = use_escapes(module, keeps, user, o, reason, size);
+                    if (!escaped && aliases_operands(module, user) && !seen[user->id]) {
+                        seen[user->id] = true;
+                        worklist[count++] = user;
+                    }
+                }
+            }
+        }
+    }
+    free(worklist);
+    free(seen);
+    return escaped;
+}
+
+// Per function and parameter, whether an array or list passed there
+// escapes. Every parameter starts out kept and is marked escaping once
+// some use shows it, until nothing changes; recursion settles because a
+// parameter never goes back.
+static bool** parameter_escapes(IrModule* module) {
+    bool** keeps = malloc(sizeof(bool*) * (module->function_count + 1));
+    for (int f = 0; f < module->function_count; f++) {
+        keeps[f] = calloc(module->functions[f]->param_count + 1, sizeof(bool));
+    }
+
+    char reason[96];
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int f = 0; f < module->function_count; f++) {
+            IrFunction* function = module->functions[f];
+            for (int b = 0; b < function->block_count; b++) {
+                IrBlock* block = function->blocks[b];
+                for (int i = 0; i < block->instr_count; i++) {
+                    IrInstr* param = block->instrs[i];
+                    if (param->op != IR_PARAM || !is_sequence_type(param->type) || keeps[f][param->index]) continue;
+                    if (escapes(module, keeps, function, param, reason, sizeof(reason))) {
+                        keeps[f][param->index] = true;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+    return keeps;
+}
+
+static void free_parameter_escapes(IrModule* module, bool** keeps) {
+    for (int f = 0; f < module->function_count; f++) {
+        free(keeps[f]);
+    }
+    free(keeps);
+}
+
+static int compare_lines(const void* a, const void* b) {
+    return ((const IrAllocation*)a)->line - ((const IrAllocation*)b)->line;
+}
+
+static int place_allocations(IrModule* module, bool** keeps, IrFunction* function, IrAllocation** allocations) {
+    ir_compute_dominators(function);
+    bool* in_loops = ir_blocks_in_loops(function);
+
+    int count = 0;
+    int capacity = 0;
+    *allocations = NULL;
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* call = block->instrs[i];
+            // Copies made by the inliner have no source; the callee decides for its own
+            if (call->op != IR_CALL || call->source == NULL) continue;
+            if (count == capacity) {
+                capacity = capacity == 0 ? 8 : capacity * 2;
+                *allocations = realloc(*allocations, sizeof(IrAllocation) * capacity);
+            }
+            IrAllocation* allocation = &(*allocations)[count++];
+            allocation->source = call->source;
+            allocation->function = function->source;
+            allocation->line = call->line;
+            allocation->type = call->type;
+            allocation->length = 0;
+            allocation->reason[0] = '\0';
+
+            IrInstr* length = call->operand_count > 0 ? call->operands[0] : NULL;
+            int size = element_size(type_element(call->type));
+            if (escapes(module, keeps, function, call, allocation->reason, sizeof(allocation->reason))) {
+                allocation->placement = IR_PLACE_HEAP;
+            } else if (type_element(call->type) == TYPE_STR) {
+                // The collector does not scan frames' arrays or regions for strings
+                snprintf(allocation->reason, sizeof(allocation->reason),
+                         "its strings must be visible to the collector");
+                allocation->placement = IR_PLACE_HEAP;
+            } else if (in_loops[block->id]) {
+                // A region is only freed when the call returns, so one
+                // allocation per iteration would grow it without bound
+                snprintf(allocation->reason, sizeof(allocation->reason),
+                         "it is made on every iteration of a loop");
+                allocation->placement = IR_PLACE_HEAP;
+            } else if (type_kind(call->type) == TYPE_ARRAY && length != NULL &&
+                       length->op == IR_CONST && length->imm.i >= 0 && size > 0 &&
+                       length->imm.i <= IR_FRAME_BYTES / size) {
+                // Created at most once per call, so one slot of the frame serves it
+                allocation->placement = IR_PLACE_FRAME;
+                allocation->length = length->imm.i;
+            } else {
+                allocation->placement = IR_PLACE_REGION;
+            }
+        }
+    }
+    free(in_loops);
+
+    if (count > 1) qsort(*allocations, count, sizeof(IrAllocation), compare_lines);
+    return count;
+}
+
+int ir_place_allocations(IrModule* module, IrFunction* function, IrAllocation** allocations) {
+    bool** keeps = parameter_escapes(module);
+    int count = place_allocations(module, keeps, function, allocations);
+    free_parameter_escapes(module, keeps);
+    return count;
+}
+
+void ir_dump_escape_report(IrModule* module, IrFunction* function, FILE* out) {
+    IrAllocation* allocations;
+    int count = ir_place_allocations(module, function, &allocations);
+    for (int i = 0; i < count; i++) {
+        IrAllocation* allocation = &allocations[i];
+        const char* type = data_type_to_string(allocation->type);
+        switch (allocation->placement) {
+            case IR_PLACE_FRAME:
+                fprintf(out, "function %s, line %d: %s of %lld elements in the frame\n", function->name,
+                        allocation->line, type, (long long)allocation->length);
+                break;
+            case IR_PLACE_REGION:
+                fprintf(out, "function %s, line %d: %s in the call's region\n", function->name, allocation->line,
+                        type);
+                break;
+            case IR_PLACE_HEAP:
+                fprintf(out, "function %s, line %d: %s on the heap: %s\n", function->name, allocation->line, type,
+                        allocation->reason);
+                break;
+        }
+    }
+    free(allocations);
+}
+
+IrAllocation* ir_collect_allocations(IrModule* module, int* count) {
+    bool** keeps = parameter_escapes(module);
+    *count = 0;
+    IrAllocation* all = NULL;
+    for (int f = 0; f < module->function_count; f++) {
+        IrAllocation* allocations;
+        int allocation_count = place_allocations(module, keeps, module->functions[f], &allocations);
+        all = realloc(all, sizeof(IrAllocation) * (*count + allocation_count + 1));
+        if (allocation_count > 0) memcpy(all + *count, allocations, sizeof(IrAllocation) * allocation_count);
+        *count += allocation_count;
+        free(allocations);
+    }
+    free_parameter_escapes(module, keeps);
+    return all;
+}
@@ -0,0 +1,461 @@
+#include "../include/ir.h"
+
+// Largest callee, in instructions, inlined at a call anywhere; inside a
+// loop, where the call is paid on every iteration; and at a call a profile
+// saw run at least INLINE_HOT_CALLS times
+#define INLINE_BUDGET 12
+#define INLINE_LOOP_BUDGET 48
+#define INLINE_HOT_BUDGET 96
+#define INLINE_HOT_CALLS 1000
+
+// Largest a caller may grow to by inlining
+#define INLINE_CALLER_LIMIT 2000
+
+// Instructions that cost something once compiled; parameters, constants,
+// phis, copies and jumps mostly disappear into registers and fall-through
+static int function_size(IrFunction* function) {
+    int size = 0;
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            switch (block->instrs[i]->op) {
+                case IR_PARAM:
+                case IR_CONST:
+                case IR_PHI:
+                case IR_COPY:
+                case IR_JUMP:
+                    break;
+                default:
+                    size++;
+                    break;
+            }
+        }
+    }
+    return size;
+}
+
+static int find_function(IrModule* module, const char* name) {
+    for (int f = 0; f < module->function_count; f++) {
+        if (strcmp(module->functions[f]->name, name) == 0) return f;
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Call graph
+
+typedef struct {
+    int count;
+    bool* calls;            // calls[caller * count + callee]
+    bool* recursive;        // Functions that can reach a call of themselves
+    int* order;             // Callees before their callers
+} CallGraph;
+
+static void find_reachable(CallGraph* graph, int from, bool* reached) {
+    for (int to = 0; to < graph->count; to++) {
+        if (graph->calls[from * graph->count + to] && !reached[to]) {
+            reached[to] = true;
+            find_reachable(graph, to, reached);
+        }
+    }
+}
+
+static void postorder(CallGraph* graph, int function, bool* visited, int* count) {
+    visited[function] = true;
+    for (int callee = 0; callee < graph->count; callee++) {
+        if (graph->calls[function * graph->count + callee] && !visited[callee]) {
+            postorder(graph, callee, visited, count);
+        }
+    }
+    graph->order[(*count)++] = function;
+}
+
+static CallGraph build_call_graph(IrModule* module) {
+    CallGraph graph;
+    graph.count = module->function_count;
+    graph.calls = calloc((size_t)graph.count * graph.count + 1, sizeof(bool));
+    graph.recursive = calloc(graph.count + 1, sizeof(bool));
+    graph.order = calloc(graph.count + 1, sizeof(int));
+
+    for (int f = 0; f < graph.count; f++) {
+        IrFunction* function = module->functions[f];
+        for (int b = 0; b < function->block_count; b++) {
+            IrBlock* block = function->blocks[b];
+            for (int i = 0; i < block->instr_count; i++) {
+                if (block->instrs[i]->op != IR_CALL) continue;
+                int callee = find_function(module, block->instrs[i]->name);
+                if (callee >= 0) graph.calls[f * graph.count + callee] = true;
+            }
+        }
+    }
+
+    bool* reached = calloc(graph.count + 1, sizeof(bool));
+    for (int f = 0; f < graph.count; f++) {
+        memset(reached, 0, sizeof(bool) * graph.count);
+        find_reachable(&graph, f, reached);
+        graph.recursive[f] = reached[f];
+    }
+
+    int count = 0;
+    memset(reached, 0, sizeof(bool) * graph.count);
+    for (int f = 0; f < graph.count; f++) {
+        if (!reached[f]) postorder(&graph, f, reached, &count);
+    }
+    free(reached);
+    return graph;
+}
+
+static void free_call_graph(CallGraph* graph) {
+    free(graph->calls);
+    free(graph->recursive);
+    free(graph->order);
+}
+
+// ---------------------------------------------------------------------------
+// Decisions
+
+// Blocks of function inside any loop, indexed by block id. Needs dominators.
+// Calls the profile saw at a call site, or -1 without a profile
+static int64_t profiled_calls(IrModule* module, const char* caller, int line, const char* callee) {
+    if (module->call_profile == NULL) return -1;
+    uint64_t calls = 0;
+    for (int i = 0; i < module->call_profile_count; i++) {
+        const IrCallCount* count = &module->call_profile[i];
+        if (count->line == line && strcmp(count->caller, caller) == 0 && strcmp(count->callee, callee) == 0) {
+            calls += count->count;
+        }
+    }
+    return calls > INT64_MAX ? INT64_MAX : (int64_t)calls;
+}
+
+// A multi-value call whose results are only taken apart can be replaced
+// value by value
+static bool results_only_extracted(IrFunction* function, IrInstr* call) {
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* instr = block->instrs[i];
+            for (int o = 0; o < instr->operand_count; o++) {
+                if (instr->operands[o] == call && instr->op != IR_EXTRACT) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Whether call of callee from caller should be inlined; fills in the
+// site's size, budget and, if not, the reason
+static bool should_inline(IrModule* module, CallGraph* graph, IrFunction* caller, IrInstr* call, int callee_index,
+                          bool in_loop, IrInlineSite* site) {
+    IrFunction* callee = module->functions[callee_index];
+    int64_t calls = profiled_calls(module, caller->name, call->line, callee->name);
+    site->size = function_size(callee);
+    site->budget = calls >= INLINE_HOT_CALLS ? INLINE_HOT_BUDGET : in_loop ? INLINE_LOOP_BUDGET : INLINE_BUDGET;
+
+    if (graph->recursive[callee_index]) {
+        snprintf(site->reason, sizeof(site->reason), "%s is recursive", callee->name);
+        return false;
+    }
+    if (callee->block_count == 0 || callee->blocks[0]->pred_count > 0) {
+        snprintf(site->reason, sizeof(site->reason), "%s loops back to its entry", callee->name);
+        return false;
+    }
+    if (call->type == TYPE_TUPLE && !results_only_extracted(caller, call)) {
+        snprintf(site->reason, sizeof(site->reason), "the results of %s are used together", callee->name);
+        return false;
+    }
+    if (calls == 0) {
+        snprintf(site->reason, sizeof(site->reason), "the profile never reached this call");
+        return false;
+    }
+    if (site->size > site->budget) {
+        snprintf(site->reason, sizeof(site->reason), "%s has %d instructions, over the budget of %d",
+                 callee->name, site->size, site->budget);
+        return false;
+    }
+    if (function_size(caller) + site->size > INLINE_CALLER_LIMIT) {
+        snprintf(site->reason, sizeof(site->reason), "%s would grow past %d instructions", caller->name,
+                 INLINE_CALLER_LIMIT);
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Inlining one call
+
+static IrInstr* clone_instr(IrFunction* function, IrInstr* instr) {
+    IrInstr* copy = ir_new_instr(function, instr->op, instr->type);
+    copy->imm = instr->imm;
+    copy->name = instr->name != NULL ? strdup(instr->name) : NULL;
+    copy->index = instr->index;
+    copy->line = instr->line;
+    // Bounds checks start out checked and are decided again in the caller;
+    // the copy has no AST node of its own for the C backend to find
+    copy->bounds = IR_BOUNDS_CHECKED;
+    copy->source = NULL;
+    return copy;
+}
+
+// Replace call, an instruction of caller, with a copy of callee's body:
+// the call's block jumps to the copied entry, the copied returns jump to a
+// new block holding the rest of the call's block, and the call's results
+// become the returned values, merged by phis when there are several returns
+static void inline_call(IrFunction* caller, IrFunction* callee, IrInstr* call) {
+    IrBlock* block = call->block;
+    int position = 0;
+    while (block->instrs[position] != call) position++;
+
+    IrBlock* rest = ir_new_block(caller);
+    for (int i = position + 1; i < block->instr_count; i++) {
+        ir_append_instr(rest, block->instrs[i]);
+    }
+    block->instr_count = position + 1;
+    for (int s = 0; s < ir_successor_count(rest); s++) {
+        IrBlock* successor = ir_successor(rest, s);
+        for (int p = 0; p < successor->pred_count; p++) {
+            if (successor->preds[p] == block) successor->preds[p] = rest;
+        }
+    }
+
+    // Copy the blocks, then wire up operands, targets and predecessors;
+    // parameters become the call's arguments
+    IrBlock** blocks = calloc(callee->next_block_id + 1, sizeof(IrBlock*));
+    IrInstr** values = calloc(callee->next_value_id + 1, sizeof(IrInstr*));
+    for (int b = 0; b < callee->block_count; b++) {
+        IrBlock* original = callee->blocks[b];
+        blocks[original->id] = ir_new_block(caller);
+        for (int i = 0; i < original->instr_count; i++) {
+            IrInstr* instr = original->instrs[i];
+            if (instr->op == IR_PARAM) {
+                values[instr->id] = call->operands[instr->index];
+            } else {
+                values[instr->id] = clone_instr(caller, instr);
+                ir_append_instr(blocks[original->id], values[instr->id]);
+            }
+        }
+    }
+
+    int result_count = call->type == TYPE_NULL ? 0 : callee->return_type_count;
+    IrInstr** returns = calloc(callee->block_count + 1, sizeof(IrInstr*));
+    int return_count = 0;
+    for (int b = 0; b < callee->block_count; b++) {
+        IrBlock* original = callee->blocks[b];
+        IrBlock* copy = blocks[original->id];
+        for (int p = 0; p < original->pred_count; p++) {
+            ir_add_pred(copy, blocks[original->preds[p]->id]);
+        }
+        for (int i = 0; i < original->instr_count; i++) {
+            IrInstr* instr = original->instrs[i];
+            if (instr->op == IR_PARAM) continue;
+            IrInstr* clone = values[instr->id];
+            for (int o = 0; o < instr->operand_count; o++) {
+                ir_add_operand(clone, values[instr->operands[o]->id]);
+            }
+            for (int t = 0; t < 2; t++) {
+                if (instr->targets[t] != NULL) clone->targets[t] = blocks[instr->targets[t]->id];
+            }
+            if (instr->op == IR_RETURN) returns[return_count++] = clone;
+        }
+    }
+
+    IrInstr** results = calloc(result_count + 1, sizeof(IrInstr*));
+    for (int r = 0; r < result_count; r++) {
+        DataType type = callee->return_types[r];
+        if (return_count == 1) {
+            results[r] = returns[0]->operands[r];
+            continue;
+        }
+        // No return means the callee never comes back and rest is dead
+        results[r] = ir_new_instr(caller, return_count == 0 ? IR_UNDEF : IR_PHI, type);
+        results[r]->line = call->line;
+        for (int i = 0; i < return_count; i++) {
+            ir_add_operand(results[r], returns[i]->operands[r]);
+        }
+        ir_insert_instr(rest, r, results[r]);
+    }
+    for (int i = 0; i < return_count; i++) {
+        returns[i]->op = IR_JUMP;
+        returns[i]->operand_count = 0;
+        returns[i]->targets[0] = rest;
+        ir_add_pred(rest, returns[i]->block);
+    }
+
+    if (call->type == TYPE_TUPLE) {
+        for (int b = 0; b < caller->block_count; b++) {
+            IrBlock* other = caller->blocks[b];
+            for (int i = 0; i < other->instr_count; i++) {
+                IrInstr* extract = other->instrs[i];
+                if (extract->op != IR_EXTRACT || extract->operands[0] != call) continue;
+                extract->op = IR_COPY;
+                extract->operands[0] = results[extract->index];
+                extract->index = 0;
+            }
+        }
+    } else if (result_count == 1) {
+        ir_replace_uses(caller, call, results[0]);
+    }
+
+    IrInstr* jump = ir_new_instr(caller, IR_JUMP, TYPE_NULL);
+    jump->line = call->line;
+    ir_remove_instr_at(block, position);
+    jump->targets[0] = blocks[callee->blocks[0]->id];
+    ir_append_instr(block, jump);
+    ir_add_pred(jump->targets[0], block);
+
+    free(results);
+    free(returns);
+    free(values);
+    free(blocks);
+}
+
+static void record_site(IrModule* module, IrInlineSite* site) {
+    module->inline_sites = realloc(module->inline_sites, sizeof(IrInlineSite) * (module->inline_site_count + 1));
+    module->inline_sites[module->inline_site_count++] = *site;
+}
+
+// Decide and inline every call caller makes of a program function
+static bool inline_calls(IrModule* module, CallGraph* graph, IrFunction* caller) {
+    ir_compute_dominators(caller);
+    bool* in_loops = ir_blocks_in_loops(caller);
+
+    // Collected first: inlining moves instructions to new blocks and adds
+    // the callee's own calls, which were decided when it was processed
+    int call_count = 0;
+    for (int b = 0; b < caller->block_count; b++) {
+        for (int i = 0; i < caller->blocks[b]->instr_count; i++) {
+            if (caller->blocks[b]->instrs[i]->op == IR_CALL) call_count++;
+        }
+    }
+    IrInstr** calls = malloc(sizeof(IrInstr*) * (call_count + 1));
+    bool* looped = malloc(sizeof(bool) * (call_count + 1));
+    call_count = 0;
+    for (int b = 0; b < caller->block_count; b++) {
+        IrBlock* block = caller->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            if (block->instrs[i]->op != IR_CALL || find_function(module, block->instrs[i]->name) < 0) continue;
+            looped[call_count] = in_loops[block->id];
+            calls[call_count++] = block->instrs[i];
+        }
+    }
+
+    bool changed = false;
+    for (int c = 0; c < call_count; c++) {
+        int callee = find_function(module, calls[c]->name);
+        IrInlineSite site;
+        memset(&site, 0, sizeof(site));
+        site.caller = caller->name;
+        site.callee = module->functions[callee]->name;
+        site.line = calls[c]->line;
+        site.inlined = should_inline(module, graph, caller, calls[c], callee, looped[c], &site);
+        record_site(module, &site);
+        if (site.inlined) {
+            inline_call(caller, module->functions[callee], calls[c]);
+            changed = true;
+        }
+    }
+
+    if (changed) ir_remove_unreachable_blocks(caller);
+    free(looped);
+    free(calls);
+    free(in_loops);
+    return changed;
+}
+
+bool ir_inline_module(IrModule* module) {
+    free(module->inline_sites);
+    module->inline_sites = NULL;
+    module->inline_site_count = 0;
+
+    CallGraph graph = build_call_graph(module);
+    bool changed = false;
+    for (int i = 0; i < graph.count; i++) {
+        changed |= inline_calls(module, &graph, module->functions[graph.order[i]]);
+    }
+    free_call_graph(&graph);
+    return changed;
+}
+
+// ---------------------------------------------------------------------------
+// Profiles and reports
+
+void ir_set_call_profile(IrModule* module, const IrCallCount* counts, int count) {
+    module->call_profile = counts;
+    module->call_profile_count = count;
+}
+
+IrCallCount* ir_read_call_profile(const char* path, int* count) {
+    FILE* in = fopen(path, "r");
+    *count = 0;
+    if (in == NULL) return NULL;
+
+    IrCallCount* counts = malloc(sizeof(IrCallCount));
+    int capacity = 1;
+    char line[1024];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char caller[256];
+        char callee[256];
+        int call_line;
+        unsigned long long calls;
+        if (line[0] == '#' || sscanf(line, "%255s %d %255s %llu", caller, &call_line, callee, &calls) != 4) {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity *= 2;
+            counts = realloc(counts, sizeof(IrCallCount) * capacity);
+        }
+        IrCallCount* entry = &counts[(*count)++];
+        entry->caller = strdup(caller);
+        entry->line = call_line;
+        entry->callee = strdup(callee);
+        entry->count = calls;
+    }
+    fclose(in);
+    return counts;
+}
+
+void ir_free_call_profile(IrCallCount* counts, int count) {
+    if (counts == NULL) return;
+    for (int i = 0; i < count; i++) {
+        free(counts[i].caller);
+        free(counts[i].callee);
+    }
+    free(counts);
+}
+
+static int compare_sites(const void* a, const void* b) {
+    const IrInlineSite* x = a;
+    const IrInlineSite* y = b;
+    if (x->line != y->line) return x->line - y->line;
+    return strcmp(x->callee, y->callee);
+}
+
+void ir_dump_inline_report(IrModule* module, IrFunction* function, FILE* out) {
+    IrInlineSite* sites = malloc(sizeof(IrInlineSite) * (module->inline_site_count + 1));
+    int count = 0;
+    for (int i = 0; i < module->inline_site_count; i++) {
+        if (module->inline_sites[i].caller == function->name) sites[count++] = module->inline_sites[i];
+    }
+    qsort(sites, count, sizeof(IrInlineSite), compare_sites);
+
+    for (int i = 0; i < count; i++) {
+        if (sites[i].inlined) {
+            fprintf(out, "function %s, line %d: inlined %s (%d instructions, budget %d)\n", function->name,
+                    sites[i].line, sites[i].callee, sites[i].size, sites[i].budget);
+        } else {
+            fprintf(out, "function %s, line %d: %s not inlined: %s\n", function->name, sites[i].line,
+                    sites[i].callee, sites[i].reason);
+        }
+    }
+    free(sites);
+}
+
+bool ir_inlined_everywhere(IrModule* module, const char* callee) {
+    int sites = 0;
+    for (int i = 0; i < module->inline_site_count; i++) {
+        if (strcmp(module->inline_sites[i].callee, callee) != 0) continue;
+        if (!module->inline_sites[i].inlined) return false;
+        sites++;
+    }
+    return sites > 0;
+}
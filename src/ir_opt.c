@@ -0,0 +1,799 @@
+#include "../include/ir.h"
+
+#define MAX_OPTIMIZE_ROUNDS 8
+
+static bool is_integer_type(DataType type) {
+    return type <= TYPE_I64;
+}
+
+static bool is_float_type(DataType type) {
+    return type == TYPE_F32 || type == TYPE_F64;
+}
+
+static bool is_constant(IrInstr* instr) {
+    return instr->op == IR_CONST;
+}
+
+// Pure instructions compute a value from their operands alone
+static bool is_pure(IrInstr* instr) {
+    switch (instr->op) {
+        case IR_CONST:
+        case IR_STRING:
+        case IR_PARAM:
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+        case IR_MOD:
+        case IR_NEG:
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_LE:
+        case IR_GT:
+        case IR_GE:
+        case IR_CONVERT:
+        case IR_COPY:
+        case IR_EXTRACT:
+            return true;
+        case IR_LENGTH:
+            // A list's length changes as it grows; an array's never does
+            return type_kind(instr->operands[0]->type) == TYPE_ARRAY;
+        default:
+            return false;
+    }
+}
+
+// Rewrite an instruction in place into a constant
+static void make_constant(IrInstr* instr, DataType type) {
+    instr->op = IR_CONST;
+    instr->type = type;
+    instr->operand_count = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Copy propagation: forward uses of copies and of phis whose incoming values
+// are all the same (or the phi itself) to the underlying value
+
+static IrInstr* trivial_phi_value(IrInstr* phi) {
+    IrInstr* same = NULL;
+    for (int i = 0; i < phi->operand_count; i++) {
+        IrInstr* operand = phi->operands[i];
+        if (operand == phi || operand == same) continue;
+        if (same != NULL) return NULL;
+        same = operand;
+    }
+    return same;
+}
+
+bool ir_copy_propagation(IrFunction* function) {
+    bool changed = false;
+    bool progress = true;
+
+    while (progress) {
+        progress = false;
+        for (int b = 0; b < function->block_count; b++) {
+            IrBlock* block = function->blocks[b];
+            for (int i = 0; i < block->instr_count; i++) {
+                IrInstr* instr = block->instrs[i];
+                IrInstr* source = NULL;
+
+                if (instr->op == IR_COPY) {
+                    source = instr->operands[0];
+                } else if (instr->op == IR_PHI) {
+                    source = trivial_phi_value(instr);
+                }
+                if (source == NULL) continue;
+
+                ir_replace_uses(function, instr, source);
+                ir_remove_instr_at(block, i);
+                i--;
+                progress = true;
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+// ---------------------------------------------------------------------------
+// Constant folding and algebraic simplification
+
+// Wrap a folded integer to the width of its type
+static int64_t wrap_to_type(int64_t value, DataType type) {
+    switch (type) {
+#define WRAP_CASE(data_type, suffix, c_type, min, max, is_signed) \
+        case data_type: return (int64_t)(c_type)value;
+        PF_INTEGER_TYPES(WRAP_CASE)
+#undef WRAP_CASE
+        default: return value;
+    }
+}
+
+// Fold add, sub, mul, div or mod at the width of type with the same
+// pf_arith.h routines generated programs use. Returns false when checked
+// arithmetic overflows or a division is by zero, leaving the error to happen
+// at run time.
+static bool fold_arith(IrOpcode op, DataType type, pf_overflow_mode mode, int64_t a, int64_t b,
+                       int64_t* result) {
+#define FOLD_OP(ir_op, op_name, suffix) \
+        case ir_op: \
+            if (mode == PF_OVERFLOW_SATURATE) { \
+                r = pf_##op_name##_sat_##suffix(x, y); \
+            } else if (pf_##op_name##_checked_##suffix(x, y, &r) && mode == PF_OVERFLOW_CHECKED) { \
+                return false; \
+            } \
+            break;
+#define FOLD_DIVISION(ir_op, op_name, suffix, c_type, max) \
+        case ir_op: \
+            if (y == 0) return false; \
+            if (pf_##op_name##_checked_##suffix(x, y, &r)) { \
+                if (mode == PF_OVERFLOW_CHECKED) return false; \
+                if (mode == PF_OVERFLOW_SATURATE) r = (c_type)(max); \
+            } \
+            break;
+#define FOLD_CASE(data_type, suffix, c_type, min, max, is_signed) \
+    case data_type: { \
+        c_type x = (c_type)a; \
+        c_type y = (c_type)b; \
+        c_type r; \
+        switch (op) { \
+            FOLD_OP(IR_ADD, add, suffix) \
+            FOLD_OP(IR_SUB, sub, suffix) \
+            FOLD_OP(IR_MUL, mul, suffix) \
+            FOLD_DIVISION(IR_DIV, div, suffix, c_type, max) \
+            FOLD_DIVISION(IR_MOD, mod, suffix, c_type, max) \
+            default: return false; \
+        } \
+        *result = (int64_t)r; \
+        return true; \
+    }
+
+    switch (type) {
+        PF_INTEGER_TYPES(FOLD_CASE)
+        default: return false;
+    }
+#undef FOLD_CASE
+#undef FOLD_DIVISION
+#undef FOLD_OP
+}
+
+static bool is_unsigned(DataType type) {
+    return type == TYPE_U8 || type == TYPE_U16 || type == TYPE_U32 || type == TYPE_U64;
+}
+
+static bool fold_integer(IrInstr* instr, int64_t a, int64_t b) {
+    DataType type = instr->operands[0]->type;
+    bool is_u = is_unsigned(type);
+    uint64_t ua = (uint64_t)a;
+    uint64_t ub = (uint64_t)b;
+    int64_t result;
+
+    // Signed against unsigned compares values, as the generated C does
+    if (is_u != is_unsigned(instr->operands[1]->type)) {
+        int order = is_u ? pf_compare_unsigned_signed(ua, b) : pf_compare_signed_unsigned(a, ub);
+        switch (instr->op) {
+            case IR_EQ: result = order == 0; break;
+            case IR_NE: result = order != 0; break;
+            case IR_LT: result = order < 0; break;
+            case IR_LE: result = order <= 0; break;
+            case IR_GT: result = order > 0; break;
+            case IR_GE: result = order >= 0; break;
+            default: return false;
+        }
+        make_constant(instr, instr->type);
+        instr->imm.i = result;
+        return true;
+    }
+
+    switch (instr->op) {
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_DIV:
+        case IR_MOD:
+            if (!fold_arith(instr->op, instr->type, instr->block->function->overflow_mode, a, b, &result)) {
+                return false;
+            }
+            break;
+        case IR_EQ: result = a == b; break;
+        case IR_NE: result = a != b; break;
+        case IR_LT: result = is_u ? ua < ub : a < b; break;
+        case IR_LE: result = is_u ? ua <= ub : a <= b; break;
+        case IR_GT: result = is_u ? ua > ub : a > b; break;
+        case IR_GE: result = is_u ? ua >= ub : a >= b; break;
+        default: return false;
+    }
+
+    make_constant(instr, instr->type);
+    instr->imm.i = instr->type == TYPE_BOOL ? result : wrap_to_type(result, instr->type);
+    return true;
+}
+
+static bool fold_float(IrInstr* instr, double a, double b) {
+    double result;
+    bool comparison = true;
+    switch (instr->op) {
+        case IR_ADD: result = a + b; comparison = false; break;
+        case IR_SUB: result = a - b; comparison = false; break;
+        case IR_MUL: result = a * b; comparison = false; break;
+        case IR_DIV: result = a / b; comparison = false; break;
+        case IR_EQ: result = a == b; break;
+        case IR_NE: result = a != b; break;
+        case IR_LT: result = a < b; break;
+        case IR_LE: result = a <= b; break;
+        case IR_GT: result = a > b; break;
+        case IR_GE: result = a >= b; break;
+        default: return false;
+    }
+
+    make_constant(instr, instr->type);
+    if (comparison) {
+        instr->imm.i = (int64_t)result;
+    } else {
+        instr->imm.f = instr->type == TYPE_F32 ? (float)result : result;
+    }
+    return true;
+}
+
+static bool fold_convert(IrInstr* instr) {
+    IrInstr* operand = instr->operands[0];
+    DataType from = operand->type;
+    DataType to = instr->type;
+
+    if (is_integer_type(from) && is_integer_type(to)) {
+        int64_t value = operand->imm.i;
+        make_constant(instr, to);
+        instr->imm.i = wrap_to_type(value, to);
+    } else if (is_integer_type(from) && is_float_type(to)) {
+        double value = is_unsigned(from) ? (double)(uint64_t)operand->imm.i : (double)operand->imm.i;
+        make_constant(instr, to);
+        instr->imm.f = to == TYPE_F32 ? (float)value : value;
+    } else if (is_float_type(from) && to == TYPE_F64) {
+        double value = operand->imm.f;
+        make_constant(instr, to);
+        instr->imm.f = value;
+    } else if (is_float_type(from) && to == TYPE_F32) {
+        double value = operand->imm.f;
+        make_constant(instr, to);
+        instr->imm.f = (float)value;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static bool is_constant_value(IrInstr* instr, int64_t value) {
+    return is_constant(instr) && is_integer_type(instr->type) && instr->imm.i == value;
+}
+
+// x + 0, x - 0, x * 1, x / 1 become copies of x
+static bool simplify_identity(IrInstr* instr) {
+    if (instr->operand_count != 2) return false;
+    IrInstr* left = instr->operands[0];
+    IrInstr* right = instr->operands[1];
+    IrInstr* source = NULL;
+
+    switch (instr->op) {
+        case IR_ADD:
+            if (is_constant_value(right, 0)) source = left;
+            else if (is_constant_value(left, 0)) source = right;
+            break;
+        case IR_SUB:
+            if (is_constant_value(right, 0)) source = left;
+            break;
+        case IR_MUL:
+            if (is_constant_value(right, 1)) source = left;
+            else if (is_constant_value(left, 1)) source = right;
+            break;
+        case IR_DIV:
+            if (is_constant_value(right, 1)) source = left;
+            break;
+        default:
+            break;
+    }
+    if (source == NULL) return false;
+
+    instr->op = IR_COPY;
+    instr->operands[0] = source;
+    instr->operand_count = 1;
+    return true;
+}
+
+// branch on a constant becomes a jump; the untaken edge disappears
+static bool fold_branch(IrInstr* branch) {
+    IrInstr* condition = branch->operands[0];
+    if (!is_constant(condition)) return false;
+
+    IrBlock* taken = branch->targets[condition->imm.i != 0 ? 0 : 1];
+    IrBlock* dropped = branch->targets[condition->imm.i != 0 ? 1 : 0];
+    if (taken != dropped) ir_remove_pred(dropped, branch->block);
+
+    branch->op = IR_JUMP;
+    branch->operand_count = 0;
+    branch->targets[0] = taken;
+    branch->targets[1] = NULL;
+    return true;
+}
+
+bool ir_fold_constants(IrFunction* function) {
+    bool changed = false;
+
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* instr = block->instrs[i];
+
+            if (instr->op == IR_BRANCH) {
+                changed |= fold_branch(instr);
+                continue;
+            }
+            if (!is_pure(instr) || instr->op == IR_CONST || instr->operand_count == 0) continue;
+
+            bool all_constant = true;
+            for (int o = 0; o < instr->operand_count; o++) {
+                if (!is_constant(instr->operands[o])) all_constant = false;
+            }
+
+            if (!all_constant) {
+                changed |= simplify_identity(instr);
+                continue;
+            }
+
+            IrInstr* left = instr->operands[0];
+            if (instr->op == IR_CONVERT) {
+                changed |= fold_convert(instr);
+            } else if (instr->op == IR_NEG) {
+                if (is_float_type(instr->type)) {
+                    double value = -left->imm.f;
+                    make_constant(instr, instr->type);
+                    instr->imm.f = value;
+                    changed = true;
+                } else {
+                    int64_t value;
+                    if (fold_arith(IR_SUB, instr->type, function->overflow_mode, 0, left->imm.i, &value)) {
+                        make_constant(instr, instr->type);
+                        instr->imm.i = value;
+                        changed = true;
+                    }
+                }
+            } else if (instr->operand_count == 2) {
+                IrInstr* right = instr->operands[1];
+                if (is_integer_type(left->type) && is_integer_type(right->type)) {
+                    changed |= fold_integer(instr, left->imm.i, right->imm.i);
+                } else if (is_float_type(left->type) && is_float_type(right->type)) {
+                    changed |= fold_float(instr, left->imm.f, right->imm.f);
+                }
+            }
+        }
+    }
+
+    if (changed) ir_remove_unreachable_blocks(function);
+    return changed;
+}
+
+// ---------------------------------------------------------------------------
+// Global value numbering over the dominator tree. An expression already
+// computed in a dominating block is reused; the table is scoped so entries
+// disappear when the walk leaves the subtree of the block that added them.
+
+typedef struct {
+    IrInstr* instr;
+    int next;       // Next entry in the same bucket, -1 at the end
+    int bucket;
+} GvnEntry;
+
+typedef struct {
+    int* buckets;
+    int bucket_count;
+    GvnEntry* entries;
+    int entry_count;
+    int entry_capacity;
+    IrBlock*** children;
+    int* child_counts;
+    bool changed;
+} GvnState;
+
+static bool is_commutative(IrOpcode op) {
+    return op == IR_ADD || op == IR_MUL || op == IR_EQ || op == IR_NE;
+}
+
+// Pure, deterministic and cheap to compare; DIV and MOD are included
+// because the dominating copy always runs first
+static bool is_numberable(IrInstr* instr) {
+    return is_pure(instr) && instr->op != IR_COPY;
+}
+
+static IrInstr* operand_in_order(IrInstr* instr, int index) {
+    if (instr->operand_count == 2 && is_commutative(instr->op) &&
+        instr->operands[0]->id > instr->operands[1]->id) {
+        return instr->operands[1 - index];
+    }
+    return instr->operands[index];
+}
+
+static unsigned gvn_hash(IrInstr* instr) {
+    unsigned hash = (unsigned)instr->op * 31u + (unsigned)instr->type;
+    for (int i = 0; i < instr->operand_count; i++) {
+        hash = hash * 31u + (unsigned)operand_in_order(instr, i)->id;
+    }
+    if (instr->op == IR_CONST) hash = hash * 31u + (unsigned)(instr->imm.i ^ (instr->imm.i >> 32));
+    if (instr->op == IR_PARAM || instr->op == IR_EXTRACT) hash = hash * 31u + (unsigned)instr->index;
+    if (instr->op == IR_STRING) {
+        for (const char* c = instr->name; *c != '\0'; c++) hash = hash * 31u + (unsigned char)*c;
+    }
+    return hash;
+}
+
+static bool gvn_equal(IrInstr* a, IrInstr* b) {
+    if (a->op != b->op || a->type != b->type || a->operand_count != b->operand_count) return false;
+    for (int i = 0; i < a->operand_count; i++) {
+        if (operand_in_order(a, i) != operand_in_order(b, i)) return false;
+    }
+    switch (a->op) {
+        case IR_CONST: return a->imm.i == b->imm.i;
+        case IR_PARAM:
+        case IR_EXTRACT:
+            return a->index == b->index;
+        case IR_STRING: return strcmp(a->name, b->name) == 0;
+        default: return true;
+    }
+}
+
+static void gvn_visit(GvnState* state, IrFunction* function, IrBlock* block) {
+    int scope = state->entry_count;
+
+    for (int i = 0; i < block->instr_count; i++) {
+        IrInstr* instr = block->instrs[i];
+        if (!is_numberable(instr)) continue;
+
+        int bucket = (int)(gvn_hash(instr) % (unsigned)state->bucket_count);
+        IrInstr* existing = NULL;
+        for (int e = state->buckets[bucket]; e >= 0; e = state->entries[e].next) {
+            if (gvn_equal(state->entries[e].instr, instr)) {
+                existing = state->entries[e].instr;
+                break;
+            }
+        }
+
+        if (existing != NULL) {
+            ir_replace_uses(function, instr, existing);
+            ir_remove_instr_at(block, i);
+            i--;
+            state->changed = true;
+            continue;
+        }
+
+        if (state->entry_count == state->entry_capacity) {
+            state->entry_capacity = state->entry_capacity == 0 ? 64 : state->entry_capacity * 2;
+            state->entries = realloc(state->entries, sizeof(GvnEntry) * state->entry_capacity);
+        }
+        GvnEntry* entry = &state->entries[state->entry_count];
+        entry->instr = instr;
+        entry->bucket = bucket;
+        entry->next = state->buckets[bucket];
+        state->buckets[bucket] = state->entry_count++;
+    }
+
+    for (int c = 0; c < state->child_counts[block->id]; c++) {
+        gvn_visit(state, function, state->children[block->id][c]);
+    }
+
+    // Entries sit at the head of their buckets in insertion order, so
+    // popping them in reverse restores the parent scope
+    while (state->entry_count > scope) {
+        GvnEntry* entry = &state->entries[--state->entry_count];
+        state->buckets[entry->bucket] = entry->next;
+    }
+}
+
+bool ir_global_value_numbering(IrFunction* function) {
+    ir_compute_dominators(function);
+
+    GvnState state;
+    memset(&state, 0, sizeof(state));
+    state.bucket_count = 251;
+    state.buckets = malloc(sizeof(int) * state.bucket_count);
+    for (int i = 0; i < state.bucket_count; i++) state.buckets[i] = -1;
+
+    int id_count = function->next_block_id;
+    state.children = calloc(id_count, sizeof(IrBlock**));
+    state.child_counts = calloc(id_count, sizeof(int));
+    for (int b = 1; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (block->idom == NULL) continue;
+        int parent = block->idom->id;
+        state.children[parent] = realloc(state.children[parent],
+                                         sizeof(IrBlock*) * (state.child_counts[parent] + 1));
+        state.children[parent][state.child_counts[parent]++] = block;
+    }
+
+    gvn_visit(&state, function, function->blocks[0]);
+
+    for (int i = 0; i < id_count; i++) free(state.children[i]);
+    free(state.children);
+    free(state.child_counts);
+    free(state.entries);
+    free(state.buckets);
+    return state.changed;
+}
+
+// ---------------------------------------------------------------------------
+// Loop-invariant code motion. Natural loops are found from back edges
+// (an edge to a block that dominates its source); pure instructions whose
+// operands are all defined outside the loop move to the preheader.
+
+// Division can trap and the loop body may never run, so it stays put
+static bool is_hoistable(IrInstr* instr) {
+    return is_pure(instr) && instr->op != IR_DIV && instr->op != IR_MOD && instr->op != IR_PARAM;
+}
+
+static void collect_loop(IrBlock* header, IrBlock* latch, bool* in_loop, int block_capacity) {
+    IrBlock** worklist = malloc(sizeof(IrBlock*) * block_capacity);
+    int count = 0;
+
+    in_loop[header->id] = true;
+    if (!in_loop[latch->id]) {
+        in_loop[latch->id] = true;
+        worklist[count++] = latch;
+    }
+    while (count > 0) {
+        IrBlock* block = worklist[--count];
+        for (int p = 0; p < block->pred_count; p++) {
+            IrBlock* pred = block->preds[p];
+            if (!in_loop[pred->id]) {
+                in_loop[pred->id] = true;
+                worklist[count++] = pred;
+            }
+        }
+    }
+    free(worklist);
+}
+
+// The single outside predecessor of the header, if it only jumps there
+static IrBlock* find_preheader(IrBlock* header, bool* in_loop) {
+    IrBlock* preheader = NULL;
+    for (int p = 0; p < header->pred_count; p++) {
+        IrBlock* pred = header->preds[p];
+        if (in_loop[pred->id]) continue;
+        if (preheader != NULL) return NULL;
+        preheader = pred;
+    }
+    if (preheader == NULL || ir_successor_count(preheader) != 1) return NULL;
+    return preheader;
+}
+
+static bool hoist_loop(IrFunction* function, IrBlock* header, IrBlock* latch) {
+    bool* in_loop = calloc(function->next_block_id, sizeof(bool));
+    collect_loop(header, latch, in_loop, function->block_count);
+
+    IrBlock* preheader = find_preheader(header, in_loop);
+    bool changed = false;
+
+    // Blocks are in reverse postorder, so definitions are seen before uses
+    bool progress = preheader != NULL;
+    while (progress) {
+        progress = false;
+        for (int b = 0; b < function->block_count; b++) {
+            IrBlock* block = function->blocks[b];
+            if (!in_loop[block->id]) continue;
+
+            for (int i = 0; i < block->instr_count; i++) {
+                IrInstr* instr = block->instrs[i];
+                if (!is_hoistable(instr)) continue;
+
+                bool invariant = true;
+                for (int o = 0; o < instr->operand_count; o++) {
+                    if (in_loop[instr->operands[o]->block->id]) invariant = false;
+                }
+                if (!invariant) continue;
+
+                memmove(&block->instrs[i], &block->instrs[i + 1],
+                        sizeof(IrInstr*) * (block->instr_count - i - 1));
+                block->instr_count--;
+                i--;
+                ir_insert_instr(preheader, preheader->instr_count - 1, instr);
+                progress = true;
+                changed = true;
+            }
+        }
+    }
+
+    free(in_loop);
+    return changed;
+}
+
+bool ir_loop_invariant_code_motion(IrFunction* function) {
+    ir_compute_dominators(function);
+    bool changed = false;
+
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (block->idom == NULL) continue;
+        for (int s = 0; s < ir_successor_count(block); s++) {
+            IrBlock* header = ir_successor(block, s);
+            if (ir_dominates(header, block)) {
+                changed |= hoist_loop(function, header, block);
+            }
+        }
+    }
+
+    return changed;
+}
+
+// ---------------------------------------------------------------------------
+// Dead code elimination: drop unreachable blocks, then every instruction
+// that nothing with a side effect transitively depends on
+
+bool ir_dead_code_elimination(IrFunction* function) {
+    int before = function->block_count;
+    ir_remove_unreachable_blocks(function);
+    bool changed = function->block_count != before;
+
+    bool* live = calloc(function->next_value_id, sizeof(bool));
+    int instr_total = 0;
+    for (int b = 0; b < function->block_count; b++) {
+        instr_total += function->blocks[b]->instr_count;
+    }
+
+    IrInstr** worklist = malloc(sizeof(IrInstr*) * (instr_total + 1));
+    int count = 0;
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* instr = block->instrs[i];
+            if (ir_has_side_effects(instr)) {
+                live[instr->id] = true;
+                worklist[count++] = instr;
+            }
+        }
+    }
+
+    while (count > 0) {
+        IrInstr* instr = worklist[--count];
+        for (int o = 0; o < instr->operand_count; o++) {
+            IrInstr* operand = instr->operands[o];
+            if (!live[operand->id]) {
+                live[operand->id] = true;
+                worklist[count++] = operand;
+            }
+        }
+    }
+
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            if (!live[block->instrs[i]->id]) {
+                ir_remove_instr_at(block, i);
+                i--;
+                changed = true;
+            }
+        }
+    }
+
+    free(worklist);
+    free(live);
+    return changed;
+}
+
+// ---------------------------------------------------------------------------
+// Tail calls: a function that returns the result of a call of itself
+// jumps back to its start instead, with its parameters carried by phis
+
+static bool is_self_tail_call(IrFunction* function, IrBlock* block) {
+    IrInstr* ret = ir_terminator(block);
+    if (ret == NULL || ret->op != IR_RETURN || block->instr_count < 2) return false;
+    IrInstr* call = block->instrs[block->instr_count - 2];
+    if (call->op != IR_CALL || strcmp(call->name, function->name) != 0 ||
+        call->operand_count != function->param_count) {
+        return false;
+    }
+    if (ret->operand_count == 0) return call->type == TYPE_NULL;
+    return ret->operand_count == 1 && ret->operands[0] == call;
+}
+
+bool ir_eliminate_tail_calls(IrFunction* function) {
+    IrBlock** tails = malloc(sizeof(IrBlock*) * (function->block_count + 1));
+    int tail_count = 0;
+    for (int b = 0; b < function->block_count; b++) {
+        if (is_self_tail_call(function, function->blocks[b])) tails[tail_count++] = function->blocks[b];
+    }
+    if (tail_count == 0) {
+        free(tails);
+        return false;
+    }
+
+    // The entry keeps the parameters and falls into a new loop header
+    // holding the rest of it
+    IrBlock* entry = function->blocks[0];
+    IrBlock* header = ir_new_block(function);
+    int kept = 0;
+    for (int i = 0; i < entry->instr_count; i++) {
+        IrInstr* instr = entry->instrs[i];
+        if (instr->op == IR_PARAM) {
+            entry->instrs[kept++] = instr;
+        } else {
+            ir_append_instr(header, instr);
+        }
+    }
+    entry->instr_count = kept;
+    for (int s = 0; s < ir_successor_count(header); s++) {
+        IrBlock* successor = ir_successor(header, s);
+        for (int p = 0; p < successor->pred_count; p++) {
+            if (successor->preds[p] == entry) successor->preds[p] = header;
+        }
+    }
+    IrInstr* jump = ir_new_instr(function, IR_JUMP, TYPE_NULL);
+    jump->line = function->line;
+    jump->targets[0] = header;
+    ir_append_instr(entry, jump);
+    ir_add_pred(header, entry);
+
+    // Each parameter becomes a phi of its value on entry and the matching
+    // argument of every tail call; uses are redirected first, so arguments
+    // computed from a parameter read the phi
+    IrInstr** phis = malloc(sizeof(IrInstr*) * (kept + 1));
+    for (int i = 0; i < kept; i++) {
+        IrInstr* param = entry->instrs[i];
+        phis[i] = ir_new_instr(function, IR_PHI, param->type);
+        phis[i]->line = function->line;
+        ir_replace_uses(function, param, phis[i]);
+        ir_add_operand(phis[i], param);
+        ir_insert_instr(header, i, phis[i]);
+    }
+    for (int t = 0; t < tail_count; t++) {
+        IrBlock* block = tails[t];
+        IrInstr* call = block->instrs[block->instr_count - 2];
+        for (int i = 0; i < kept; i++) {
+            ir_add_operand(phis[i], call->operands[entry->instrs[i]->index]);
+        }
+        IrInstr* back = ir_new_instr(function, IR_JUMP, TYPE_NULL);
+        back->line = call->line;
+        back->targets[0] = header;
+        ir_remove_instr_at(block, block->instr_count - 1);
+        ir_remove_instr_at(block, block->instr_count - 1);
+        ir_append_instr(block, back);
+        ir_add_pred(header, block);
+    }
+
+    free(phis);
+    free(tails);
+    return true;
+}
+
+static void optimize_function(IrFunction* function) {
+    for (int round = 0; round < MAX_OPTIMIZE_ROUNDS; round++) {
+        bool changed = false;
+        changed |= ir_copy_propagation(function);
+        changed |= ir_fold_constants(function);
+        changed |= ir_copy_propagation(function);
+        changed |= ir_global_value_numbering(function);
+        changed |= ir_loop_invariant_code_motion(function);
+        changed |= ir_dead_code_elimination(function);
+        if (!changed) break;
+    }
+}
+
+void ir_optimize_module(IrModule* module) {
+    for (int f = 0; f < module->function_count; f++) {
+        ir_eliminate_tail_calls(module->functions[f]);
+        optimize_function(module->functions[f]);
+    }
+
+    // An inlined body sees its caller's constant arguments and unused
+    // results, so folding and dead code elimination run again over it. The
+    // jumps into and out of the copy go too, leaving one straight run of
+    // instructions where the call was.
+    if (ir_inline_module(module)) {
+        for (int f = 0; f < module->function_count; f++) {
+            optimize_function(module->functions[f]);
+            ir_merge_blocks(module->functions[f]);
+        }
+    }
+
+    for (int f = 0; f < module->function_count; f++) {
+        ir_compute_dominators(module->functions[f]);
+        ir_eliminate_bounds_checks(module->functions[f]);
+    }
+}
@@ -0,0 +1,225 @@
+#include "../include/ir.h"
+
+static bool is_integer(DataType type) {
+    return type <= TYPE_I64;
+}
+
+static bool is_float(DataType type) {
+    return type == TYPE_F32 || type == TYPE_F64;
+}
+
+// Uses of value by instructions of the loop
+static int loop_uses(IrFunction* function, const bool* in_loop, IrInstr* value) {
+    int uses = 0;
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (!in_loop[block->id]) continue;
+        for (int i = 0; i < block->instr_count; i++) {
+            for (int o = 0; o < block->instrs[i]->operand_count; o++) {
+                if (block->instrs[i]->operands[o] == value) uses++;
+            }
+        }
+    }
+    return uses;
+}
+
+// Operand of phi that arrives over the back edge
+static IrInstr* back_edge_value(IrInstr* phi, const bool* in_loop) {
+    for (int p = 0; p < phi->block->pred_count && p < phi->operand_count; p++) {
+        if (in_loop[phi->block->preds[p]->id]) return phi->operands[p];
+    }
+    return NULL;
+}
+
+// A value carried between iterations is fine when it is an integer sum:
+// the next value is phi + x or phi - x and nothing else in the loop reads
+// either one, so the lanes can keep partial sums. Wrapping addition gives
+// the same total in any order; float addition does not.
+static bool is_sum(IrFunction* function, const bool* in_loop, IrInstr* phi, char* reason, size_t size) {
+    IrInstr* next = back_edge_value(phi, in_loop);
+    if (next == NULL || next == phi) return true;
+
+    bool sum = (next->op == IR_ADD && (next->operands[0] == phi || next->operands[1] == phi)) ||
+               (next->op == IR_SUB && next->operands[0] == phi);
+    if (sum && is_float(phi->type)) {
+        snprintf(reason, size, "the floating-point sum at line %d would be added in a different order", next->line);
+        return false;
+    }
+    if (!sum || !is_integer(phi->type) || loop_uses(function, in_loop, phi) != 1 ||
+        loop_uses(function, in_loop, next) != 1) {
+        snprintf(reason, size, "a value computed at line %d is used by the next iteration", next->line);
+        return false;
+    }
+    return true;
+}
+
+// Whether the for loop headed by header can run several iterations at
+// once; if not, the first reason found goes to reason
+static bool vectorizable(IrFunction* function, IrBlock* header, char* reason, size_t size) {
+    IrInstr* counter = header->induction;
+    if (counter == NULL) {
+        snprintf(reason, size, "its counter was optimized away");
+        return false;
+    }
+
+    bool* in_loop = ir_loop_blocks(function, header);
+    bool ok = false;
+    IrInstr* increment = back_edge_value(counter, in_loop);
+    int64_t step = 0;
+    if (increment != NULL && increment->op == IR_ADD && increment->operands[0] == counter &&
+        increment->operands[1]->op == IR_CONST) {
+        step = increment->operands[1]->imm.i;
+    }
+
+    // Elements read at one index on every iteration, checked against the
+    // stores once all accesses are known
+    IrInstr** fixed_loads = malloc(sizeof(IrInstr*) * (function->next_value_id + 1));
+    int fixed_count = 0;
+    bool stored[TYPE_MAP + 1] = {false};
+
+    if (step != 1) {
+        snprintf(reason, size, "it does not count up by 1");
+        goto done;
+    }
+
+    int body_blocks = 0;
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        if (!in_loop[block->id]) continue;
+        if (block != header) {
+            IrInstr* terminator = ir_terminator(block);
+            if (++body_blocks > 1 || terminator == NULL || terminator->op != IR_JUMP) {
+                snprintf(reason, size, "its body branches");
+                goto done;
+            }
+        }
+
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* instr = block->instrs[i];
+            switch (instr->op) {
+                case IR_CALL:
+                case IR_SPAWN:
+                    snprintf(reason, size, "it calls %s at line %d", instr->name, instr->line);
+                    goto done;
+                case IR_STRING:
+                case IR_FORMAT:
+                    snprintf(reason, size, "it builds strings at line %d", instr->line);
+                    goto done;
+                case IR_DIV:
+                case IR_MOD:
+                    if (is_integer(instr->type)) {
+                        snprintf(reason, size, "the integer division at line %d checks for zero", instr->line);
+                        goto done;
+                    }
+                    break;
+                case IR_ADD:
+                case IR_SUB:
+                case IR_MUL:
+                case IR_NEG:
+                    if (instr != increment && is_integer(instr->type) &&
+                        function->overflow_mode != PF_OVERFLOW_WRAP) {
+                        snprintf(reason, size, "the arithmetic at line %d checks for overflow", instr->line);
+                        goto done;
+                    }
+                    break;
+                case IR_PHI:
+                    if (instr != counter && !is_sum(function, in_loop, instr, reason, size)) goto done;
+                    break;
+                case IR_LOAD:
+                case IR_STORE: {
+                    IrInstr* sequence = instr->operands[0];
+                    IrInstr* index = instr->operands[1];
+                    DataType element = type_element(sequence->type);
+                    if (!is_integer(element) && !is_float(element) && element != TYPE_BOOL) {
+                        snprintf(reason, size, "line %d accesses %s elements", instr->line,
+                                 data_type_to_string(element));
+                        goto done;
+                    }
+                    if (in_loop[sequence->block->id]) {
+                        snprintf(reason, size, "the array accessed at line %d changes inside the loop", instr->line);
+                        goto done;
+                    }
+                    if (instr->bounds == IR_BOUNDS_CHECKED) {
+                        snprintf(reason, size, "the bounds check at line %d stays in the loop", instr->line);
+                        goto done;
+                    }
+                    if (index == counter) {
+                        if (instr->op == IR_STORE) stored[element] = true;
+                    } else if (instr->op == IR_LOAD && !in_loop[index->block->id]) {
+                        fixed_loads[fixed_count++] = instr;
+                    } else {
+                        snprintf(reason, size, "the index at line %d is not the loop variable", instr->line);
+                        goto done;
+                    }
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    // xs[0] read while xs[i] is written changes from one iteration to the
+    // next; any array of the same element type might be xs
+    for (int i = 0; i < fixed_count; i++) {
+        if (stored[type_element(fixed_loads[i]->operands[0]->type)]) {
+            snprintf(reason, size, "line %d reads an element the loop may overwrite", fixed_loads[i]->line);
+            goto done;
+        }
+    }
+    ok = true;
+
+done:
+    free(fixed_loads);
+    free(in_loop);
+    return ok;
+}
+
+static int compare_lines(const void* a, const void* b) {
+    return ((const IrVectorLoop*)a)->line - ((const IrVectorLoop*)b)->line;
+}
+
+int ir_vectorize_loops(IrFunction* function, IrVectorLoop** loops) {
+    ir_compute_dominators(function);
+    int count = 0;
+    *loops = malloc(sizeof(IrVectorLoop) * (function->block_count + 1));
+    for (int b = 0; b < function->block_count; b++) {
+        IrBlock* header = function->blocks[b];
+        if (header->loop == NULL || header->rpo_index < 0) continue;
+        IrVectorLoop* loop = &(*loops)[count++];
+        loop->loop = header->loop;
+        loop->line = header->loop->line;
+        loop->reason[0] = '\0';
+        loop->vectorized = vectorizable(function, header, loop->reason, sizeof(loop->reason));
+    }
+    qsort(*loops, count, sizeof(IrVectorLoop), compare_lines);
+    return count;
+}
+
+void ir_dump_vector_report(IrFunction* function, FILE* out) {
+    IrVectorLoop* loops;
+    int count = ir_vectorize_loops(function, &loops);
+    for (int i = 0; i < count; i++) {
+        if (loops[i].vectorized) {
+            fprintf(out, "function %s, line %d: loop vectorized\n", function->name, loops[i].line);
+        } else {
+            fprintf(out, "function %s, line %d: loop not vectorized: %s\n", function->name, loops[i].line,
+                    loops[i].reason);
+        }
+    }
+    free(loops);
+}
+
+IrVectorLoop* ir_collect_vector_loops(IrModule* module, int* count) {
+    *count = 0;
+    IrVectorLoop* all = NULL;
+    for (int f = 0; f < module->function_count; f++) {
+        IrVectorLoop* loops;
+        int loop_count = ir_vectorize_loops(module->functions[f], &loops);
+        all = realloc(all, sizeof(IrVectorLoop) * (*count + loop_count + 1));
+        memcpy(all + *count, loops, sizeof(IrVectorLoop) * loop_count);
+        *count += loop_count;
+        free(loops);
+    }
+    return all;
+}
@@ -60,9 +60,9 @@ static void skip_whitespace(Lexer* lexer) {
                 advance_lexer(lexer);
                 break;
             case '\n':
+                advance_lexer(lexer);
                 lexer->line++;
                 lexer->column = 1;
-                advance_lexer(lexer);
                 break;
             case '#':  // Comments
                 while (peek(lexer) != '\n' && !is_at_end(lexer)) advance_lexer(lexer);
@@ -75,11 +75,12 @@ static void skip_whitespace(Lexer* lexer) {
 
 static Token string(Lexer* lexer) {
     while (peek(lexer) != '"' && !is_at_end(lexer)) {
-        if (peek(lexer) == '\n') {
+        bool newline = peek(lexer) == '\n';
+        advance_lexer(lexer);
+        if (newline) {
             lexer->line++;
             lexer->column = 1;
         }
-        advance_lexer(lexer);
     }
 
     if (is_at_end(lexer)) {
@@ -151,21 +152,28 @@ static TokenType identifier_type(Lexer* lexer) {
             }
             break;
         case 'n': return check_keyword(lexer, 1, 3, "ull", TOKEN_NULL);
-        case 's': return check_keyword(lexer, 1, 2, "tr", TOKEN_STR);
+        case 'w': return check_keyword(lexer, 1, 4, "hile", TOKEN_WHILE);
+        case 's':
+            if (lexer->current - lexer->start > 1) {
+                switch (lexer->source[lexer->start + 1]) {
+                    case 't': return check_keyword(lexer, 1, 2, "tr", TOKEN_STR);
+                    case 'e': return check_keyword(lexer, 1, 5, "elect", TOKEN_SELECT);
+                }
+            }
+            break;
         case 'b': return check_keyword(lexer, 1, 3, "ool", TOKEN_BOOL);
         case 'o': return check_keyword(lexer, 1, 7, "ptional", TOKEN_OPTIONAL);
+        case 'g': return check_keyword(lexer, 1, 1, "o", TOKEN_GO);
+        case 'p': return check_keyword(lexer, 1, 2, "ar", TOKEN_PAR);
         case 'e':
             if (lexer->current - lexer->start > 1) {
                 switch (lexer->source[lexer->start + 1]) {
                     case 'l':
-                        if (lexer->current - lexer->start > 2) {
-                            if (lexer->source[lexer->start + 2] == 's') {
-                                return check_keyword(lexer, 2, 3, "sif", TOKEN_ELSIF);
-                            } else {
-                                return check_keyword(lexer, 2, 2, "se", TOKEN_ELSE);
-                            }
+                        // "else" and "elsif" share their first three letters
+                        if (lexer->current - lexer->start == 4) {
+                            return check_keyword(lexer, 2, 2, "se", TOKEN_ELSE);
                         }
-                        break;
+                        return check_keyword(lexer, 2, 3, "sif", TOKEN_ELSIF);
                     case 'r':
                         return check_keyword(lexer, 1, 4, "rror", TOKEN_ERROR);
                 }
@@ -179,6 +187,7 @@ static TokenType identifier_type(Lexer* lexer) {
                 switch (lexer->source[lexer->start + 1]) {
                     case '3': return check_keyword(lexer, 1, 2, "32", TOKEN_F32);
                     case '6': return check_keyword(lexer, 1, 2, "64", TOKEN_F64);
+                    case 'o': return check_keyword(lexer, 1, 2, "or", TOKEN_FOR);
                 }
             }
             break;
@@ -207,6 +216,8 @@ Token scan_token(Lexer* lexer) {
         case ')': return make_token(lexer, TOKEN_RIGHT_PAREN);
         case '{': return make_token(lexer, TOKEN_LEFT_BRACE);
         case '}': return make_token(lexer, TOKEN_RIGHT_BRACE);
+        case '[': return make_token(lexer, TOKEN_LEFT_BRACKET);
+        case ']': return make_token(lexer, TOKEN_RIGHT_BRACKET);
         case ':': return make_token(lexer, TOKEN_COLON);
         case ',': return make_token(lexer, TOKEN_COMMA);
         case '.': return make_token(lexer, TOKEN_DOT);
@@ -228,6 +239,15 @@ Token scan_token(Lexer* lexer) {
         case '<':
             if (match_lexer(lexer, '=')) return make_token(lexer, TOKEN_LESS_EQUAL);
             return make_token(lexer, TOKEN_LESS);
+        case '!':
+            if (match_lexer(lexer, '=')) return make_token(lexer, TOKEN_NOT_EQUAL);
+            break;
+        case '&':
+            if (match_lexer(lexer, '&')) return make_token(lexer, TOKEN_AND);
+            break;
+        case '|':
+            if (match_lexer(lexer, '|')) return make_token(lexer, TOKEN_OR);
+            break;
         case '"': return string(lexer);
     }
 
@@ -5,39 +5,259 @@
 #include "../include/lexer.h"
 #include "../include/ast.h"
 #include "../include/parser.h"
+#include "../include/codegen_c.h"
+#include "../include/ir.h"
+#include "../include/regalloc.h"
 #include "../include/utils.h"
 
-// Implementation of data_type_to_string
-const char* data_type_to_string(DataType type) {
-    switch (type) {
-        case TYPE_U8: return "u8";
-        case TYPE_U16: return "u16";
-        case TYPE_U32: return "u32";
-        case TYPE_U64: return "u64";
-        case TYPE_I8: return "i8";
-        case TYPE_I16: return "i16";
-        case TYPE_I32: return "i32";
-        case TYPE_I64: return "i64";
-        case TYPE_F32: return "f32";
-        case TYPE_F64: return "f64";
-        case TYPE_STR: return "str";
-        case TYPE_BOOL: return "bool";
-        case TYPE_NULL: return "null";
-        case TYPE_ERROR: return "error";
-        case TYPE_TUPLE: return "tuple";
-        default: return "unknown";
+// Translate a whole program to C and, when an output path is given, build it
+static int compile_program(const char* path, const char* c_path, const char* output_path,
+                           const CodegenCOptions* options) {
+    char* source = read_file(path);
+
+    Lexer lexer;
+    init_lexer(&lexer, source);
+
+    Parser parser;
+    init_parser(&parser, &lexer);
+
+    AstNode* program = parse_program(&parser);
+    if (program == NULL) {
+        fprintf(stderr, "Failed to parse\n");
+        free(source);
+        return 1;
+    }
+
+    char default_c_path[4096];
+    if (c_path == NULL) {
+        snprintf(default_c_path, sizeof(default_c_path), "%s.c", output_path);
+        c_path = default_c_path;
+    }
+
+    FILE* out = fopen(c_path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "Could not open \"%s\" for writing.\n", c_path);
+        free_ast(program);
+        free(source);
+        return 74;
+    }
+
+    bool ok = codegen_c_emit_with_options(program, path, options, out);
+    fclose(out);
+
+    if (ok && output_path != NULL) {
+        ok = codegen_c_compile(c_path, output_path);
     }
+
+    free_ast(program);
+    free(source);
+    return ok ? 0 : 1;
+}
+
+// Translate a program to C only to list its tail calls and which of them
+// the C backend turns into jumps
+static int report_tail_calls(const char* path, CodegenCOptions* options) {
+    char* source = read_file(path);
+
+    Lexer lexer;
+    init_lexer(&lexer, source);
+
+    Parser parser;
+    init_parser(&parser, &lexer);
+
+    AstNode* program = parse_program(&parser);
+    if (program == NULL) {
+        fprintf(stderr, "Failed to parse\n");
+        free(source);
+        return 1;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    options->tail_call_report = stdout;
+    bool ok = codegen_c_emit_with_options(program, path, options, out);
+    fclose(out);
+    free(code);
+
+    free_ast(program);
+    free(source);
+    return ok ? 0 : 1;
+}
+
+// What dump_ir prints for each function
+typedef struct {
+    bool optimize;      // Optimize before printing; off with -O0
+    bool ir;            // The SSA form (--dump-ir)
+    bool registers;     // Its register allocation (--regalloc-report)
+    bool bounds;        // Bounds checks the optimizer removed (--bounds-report)
+    bool vectors;       // Which for loops the C backend vectorizes (--vector-report)
+    bool inlining;      // Which calls were inlined (--inline-report)
+    bool escapes;       // Where each array and list is allocated (--escape-report)
+} IrReports;
+
+static bool any_ir_report(const IrReports* reports) {
+    return reports->ir || reports->registers || reports->bounds || reports->vectors || reports->inlining ||
+           reports->escapes;
+}
+
+// Lower a program to SSA form and print the reports asked for
+static int dump_ir(const char* path, const IrReports* reports, const CodegenCOptions* options) {
+    char* source = read_file(path);
+
+    Lexer lexer;
+    init_lexer(&lexer, source);
+
+    Parser parser;
+    init_parser(&parser, &lexer);
+
+    AstNode* program = parse_program(&parser);
+    if (program == NULL) {
+        fprintf(stderr, "Failed to parse\n");
+        free(source);
+        return 1;
+    }
+
+    IrModule* module = ir_lower_program(program);
+    if (module != NULL) {
+        ir_set_overflow_mode(module, options->overflow_mode);
+        ir_set_call_profile(module, options->call_profile, options->call_profile_count);
+        if (reports->optimize) {
+            ir_optimize_module(module);
+        }
+        for (int f = 0; f < module->function_count; f++) {
+            IrFunction* function = module->functions[f];
+            if (reports->ir) {
+                if (f > 0) printf("\n");
+                ir_dump_function(function, stdout);
+            }
+            if (reports->registers) {
+                RegAllocation* allocation = regalloc_function(function, regalloc_target_x86_64());
+                regalloc_dump(allocation, reports->ir, stdout);
+                regalloc_free(allocation);
+            }
+            if (reports->bounds) {
+                ir_dump_bounds_report(function, stdout);
+            }
+            if (reports->vectors) {
+                ir_dump_vector_report(function, stdout);
+            }
+            if (reports->inlining) {
+                ir_dump_inline_report(module, function, stdout);
+            }
+            if (reports->escapes) {
+                ir_dump_escape_report(module, function, stdout);
+            }
+        }
+        ir_free_module(module);
+    }
+
+    free_ast(program);
+    free(source);
+    return module != NULL ? 0 : 1;
 }
 
 int main(int argc, char* argv[]) {
+    const char* input_path = NULL;
+    const char* c_path = NULL;
+    const char* output_path = NULL;
+    IrReports reports = {.optimize = true};
+    const char* profile_path = NULL;
+    bool tail_requested = false;
+    CodegenCOptions options = {.overflow_mode = PF_OVERFLOW_WRAP};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--emit-c") == 0 && i + 1 < argc) {
+            c_path = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--dump-ir") == 0) {
+            reports.ir = true;
+        } else if (strcmp(argv[i], "--regalloc-report") == 0) {
+            reports.registers = true;
+        } else if (strcmp(argv[i], "--bounds-report") == 0) {
+            reports.bounds = true;
+        } else if (strcmp(argv[i], "--vector-report") == 0) {
+            reports.vectors = true;
+        } else if (strcmp(argv[i], "--inline-report") == 0) {
+            reports.inlining = true;
+        } else if (strcmp(argv[i], "--escape-report") == 0) {
+            reports.escapes = true;
+        } else if (strcmp(argv[i], "--inline-profile") == 0 && i + 1 < argc) {
+            profile_path = argv[++i];
+        } else if (strcmp(argv[i], "--profile-calls") == 0) {
+            options.count_calls = true;
+        } else if (strcmp(argv[i], "--perf-map") == 0) {
+            options.perf_map = true;
+        } else if (strcmp(argv[i], "--tail-call-report") == 0) {
+            tail_requested = true;
+        } else if (strcmp(argv[i], "-O0") == 0) {
+            reports.optimize = false;
+        } else if (strncmp(argv[i], "--overflow=", 11) == 0) {
+            const char* mode = argv[i] + 11;
+            if (strcmp(mode, "wrap") == 0) {
+                options.overflow_mode = PF_OVERFLOW_WRAP;
+            } else if (strcmp(mode, "checked") == 0) {
+                options.overflow_mode = PF_OVERFLOW_CHECKED;
+            } else if (strcmp(mode, "saturate") == 0) {
+                options.overflow_mode = PF_OVERFLOW_SATURATE;
+            } else {
+                fprintf(stderr, "Unknown overflow mode \"%s\"; expected wrap, checked or saturate\n", mode);
+                return 64;
+            }
+        } else {
+            input_path = argv[i];
+        }
+    }
+
+    // Call counts from a run of a program built with --profile-calls
+    IrCallCount* profile = NULL;
+    if (profile_path != NULL) {
+        profile = ir_read_call_profile(profile_path, &options.call_profile_count);
+        if (profile == NULL) {
+            fprintf(stderr, "Could not read call profile \"%s\".\n", profile_path);
+            return 66;
+        }
+        options.call_profile = profile;
+    }
+
+    int status = -1;
+    if (any_ir_report(&reports)) {
+        if (input_path == NULL) {
+            fprintf(stderr, "Usage: pflang [--dump-ir] [--regalloc-report] [--bounds-report] [--vector-report] "
+                            "[--inline-report] [--escape-report] [--inline-profile file] [-O0] [--overflow=mode] "
+                            "file.pf\n");
+            status = 64;
+        } else {
+            status = dump_ir(input_path, &reports, &options);
+        }
+    } else if (tail_requested) {
+        if (input_path == NULL) {
+            fprintf(stderr, "Usage: pflang --tail-call-report file.pf\n");
+            status = 64;
+        } else {
+            status = report_tail_calls(input_path, &options);
+        }
+    } else if (c_path != NULL || output_path != NULL) {
+        if (input_path == NULL) {
+            fprintf(stderr, "Usage: pflang [--emit-c out.c] [-o executable] [--overflow=mode] "
+                            "[--profile-calls] [--inline-profile file] [--perf-map] file.pf\n");
+            status = 64;
+        } else {
+            status = compile_program(input_path, c_path, output_path, &options);
+        }
+    }
+    ir_free_call_profile(profile, options.call_profile_count);
+    if (status >= 0) return status;
+
     char* source;
     
-    if (argc != 2) {
+    if (input_path == NULL) {
         // If no file is provided, use the test_function.pf file
         source = read_file("test_function.pf");
         printf("No file provided, using test_function.pf\n");
     } else {
-        source = read_file(argv[1]);
+        source = read_file(input_path);
     }
     
     printf("Debug: Source code:\n%s\n", source);
@@ -1,8 +1,10 @@
 #include "../include/parser.h"
+#include <ctype.h>
 
 // Forward declarations
 static AstNode* parse_expression(Parser* parser);
 static AstNode* parse_comparison(Parser* parser);
+static AstNode* parse_block(Parser* parser, int parent_column);
 
 static void advance_parser(Parser* parser) {
     parser->previous = parser->current;
@@ -40,6 +42,14 @@ static void error(Parser* parser, const char* message) {
             message);
 }
 
+// Allocate a node stamped with the line of the token just consumed
+static AstNode* new_node(Parser* parser, NodeType type) {
+    AstNode* node = malloc(sizeof(AstNode));
+    node->type = type;
+    node->line = parser->previous.line;
+    return node;
+}
+
 static DataType token_type_to_data_type(TokenType type) {
     switch (type) {
         case TOKEN_U8: return TYPE_U8;
@@ -67,9 +77,60 @@ static bool is_type_token(TokenType type) {
            type == TOKEN_NULL || type == TOKEN_ERROR;
 }
 
+static bool is_identifier_named(Token* token, const char* name) {
+    return token->type == TOKEN_IDENTIFIER && strcmp(token->lexeme, name) == 0;
+}
+
+// int, array, list and chan are names rather than keywords, so they
+// remain usable as function names such as array(16)
+static bool is_type_start(Parser* parser) {
+    return is_type_token(parser->current.type) || is_identifier_named(&parser->current, "int") ||
+           is_identifier_named(&parser->current, "array") || is_identifier_named(&parser->current, "list") ||
+           is_identifier_named(&parser->current, "chan");
+}
+
+// Parse a type: a primitive, the int alias, or array[T] / list[T] /
+// chan[T] of a number, str or bool element type
+static bool parse_type(Parser* parser, DataType* type) {
+    if (is_identifier_named(&parser->current, "array") || is_identifier_named(&parser->current, "list") ||
+        is_identifier_named(&parser->current, "chan")) {
+        const char* name = parser->current.lexeme;
+        DataType kind = strcmp(name, "array") == 0 ? TYPE_ARRAY : strcmp(name, "list") == 0 ? TYPE_LIST : TYPE_CHAN;
+        advance_parser(parser);
+        if (!match_parser(parser, TOKEN_LEFT_BRACKET)) {
+            error(parser, "Expected '[' and an element type");
+            return false;
+        }
+
+        DataType element;
+        if (!parse_type(parser, &element)) return false;
+        if (element > TYPE_BOOL) {
+            error(parser, "Elements must be numbers, str or bool");
+            return false;
+        }
+        if (!match_parser(parser, TOKEN_RIGHT_BRACKET)) {
+            error(parser, "Expected ']' after element type");
+            return false;
+        }
+        *type = compound_type(kind, element);
+        return true;
+    }
+
+    if (is_identifier_named(&parser->current, "int")) {
+        *type = TYPE_I32;
+    } else if (is_type_token(parser->current.type)) {
+        *type = token_type_to_data_type(parser->current.type);
+    } else {
+        return false;
+    }
+    advance_parser(parser);
+    return true;
+}
+
 static AstNode* make_binary_op(AstNode* left, TokenType operator, AstNode* right) {
     AstNode* node = malloc(sizeof(AstNode));
     node->type = NODE_BINARY_OP;
+    node->line = left != NULL ? left->line : 0;
     node->value.binary_op.left = left;
     node->value.binary_op.right = right;
     node->value.binary_op.operator = operator;
@@ -77,8 +138,7 @@ static AstNode* make_binary_op(AstNode* left, TokenType operator, AstNode* right
 }
 
 static AstNode* parse_literal(Parser* parser) {
-    AstNode* node = malloc(sizeof(AstNode));
-    node->type = NODE_LITERAL;
+    AstNode* node = new_node(parser, NODE_LITERAL);
 
     switch (parser->current.type) {
         case TOKEN_NUMBER:
@@ -125,8 +185,7 @@ static AstNode* parse_primary(Parser* parser) {
 
         // If next token is opening parenthesis - it's a function call
         if (match_parser(parser, TOKEN_LEFT_PAREN)) {
-            AstNode* node = malloc(sizeof(AstNode));
-            node->type = NODE_FUNCTION_CALL;
+            AstNode* node = new_node(parser, NODE_FUNCTION_CALL);
             node->value.function_call.name = name;
 
             int capacity = 2;
@@ -177,8 +236,7 @@ static AstNode* parse_primary(Parser* parser) {
 
             return node;
         } else {
-            AstNode* node = malloc(sizeof(AstNode));
-            node->type = NODE_LITERAL;
+            AstNode* node = new_node(parser, NODE_LITERAL);
             node->value.literal.value = name;
             node->value.literal.type = token_type == TOKEN_ERROR ? TYPE_ERROR : TYPE_I32;
             return node;
@@ -186,24 +244,21 @@ static AstNode* parse_primary(Parser* parser) {
     }
 
     if (match_parser(parser, TOKEN_NUMBER)) {
-        AstNode* node = malloc(sizeof(AstNode));
-        node->type = NODE_LITERAL;
+        AstNode* node = new_node(parser, NODE_LITERAL);
         node->value.literal.value = strdup(parser->previous.lexeme);
         node->value.literal.type = TYPE_I32;
         return node;
     }
 
     if (match_parser(parser, TOKEN_STRING)) {
-        AstNode* node = malloc(sizeof(AstNode));
-        node->type = NODE_LITERAL;
+        AstNode* node = new_node(parser, NODE_LITERAL);
         node->value.literal.value = strdup(parser->previous.lexeme);
         node->value.literal.type = TYPE_STR;
         return node;
     }
 
     if (match_parser(parser, TOKEN_NULL)) {
-        AstNode* node = malloc(sizeof(AstNode));
-        node->type = NODE_LITERAL;
+        AstNode* node = new_node(parser, NODE_LITERAL);
         node->value.literal.value = strdup("null");
         node->value.literal.type = TYPE_NULL;
         return node;
@@ -213,6 +268,33 @@ static AstNode* parse_primary(Parser* parser) {
     return NULL;
 }
 
+// xs[i], xs[i][j], ...
+static AstNode* parse_postfix(Parser* parser) {
+    AstNode* expr = parse_primary(parser);
+
+    while (expr != NULL && match_parser(parser, TOKEN_LEFT_BRACKET)) {
+        AstNode* index = parse_expression(parser);
+        if (index == NULL) {
+            free_ast(expr);
+            return NULL;
+        }
+        if (!match_parser(parser, TOKEN_RIGHT_BRACKET)) {
+            error(parser, "Expected ']' after index");
+            free_ast(expr);
+            free_ast(index);
+            return NULL;
+        }
+
+        AstNode* node = new_node(parser, NODE_INDEX);
+        node->line = expr->line;
+        node->value.index.target = expr;
+        node->value.index.index = index;
+        expr = node;
+    }
+
+    return expr;
+}
+
 static AstNode* parse_unary(Parser* parser) {
     if (match_parser(parser, TOKEN_MINUS) ||
         match_parser(parser, TOKEN_PLUS) ||
@@ -221,14 +303,13 @@ static AstNode* parse_unary(Parser* parser) {
         TokenType operator = parser->previous.type;
         AstNode* right = parse_unary(parser);
 
-        AstNode* node = malloc(sizeof(AstNode));
-        node->type = NODE_UNARY_OP;
+        AstNode* node = new_node(parser, NODE_UNARY_OP);
         node->value.unary_op.operator = operator;
         node->value.unary_op.operand = right;
         return node;
     }
 
-    return parse_primary(parser);
+    return parse_postfix(parser);
 }
 
 static AstNode* parse_factor(Parser* parser) {
@@ -292,8 +373,8 @@ static AstNode* parse_function(Parser* parser) {
         return NULL;
     }
 
-    AstNode* node = malloc(sizeof(AstNode));
-    node->type = NODE_FUNCTION;
+    AstNode* node = new_node(parser, NODE_FUNCTION);
+    int node_column = parser->previous.column;
 
     if (!match_parser(parser, TOKEN_IDENTIFIER)) {
         error(parser, "Expected function name");
@@ -362,40 +443,12 @@ static AstNode* parse_function(Parser* parser) {
                 );
             }
 
-            if (match_parser(parser, TOKEN_NULL)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_NULL;
-            } else if (match_parser(parser, TOKEN_ERROR)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_ERROR;
-            } else if (match_parser(parser, TOKEN_BOOL)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_BOOL;
-            } else if (match_parser(parser, TOKEN_I8)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_I8;
-            } else if (match_parser(parser, TOKEN_I16)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_I16;
-            } else if (match_parser(parser, TOKEN_I32)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_I32;
-            } else if (match_parser(parser, TOKEN_I64)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_I64;
-            } else if (match_parser(parser, TOKEN_F32)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_F32;
-            } else if (match_parser(parser, TOKEN_F64)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_F64;
-            } else if (match_parser(parser, TOKEN_STR)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_STR;
-            } else if (match_parser(parser, TOKEN_U8)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_U8;
-            } else if (match_parser(parser, TOKEN_U16)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_U16;
-            } else if (match_parser(parser, TOKEN_U32)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_U32;
-            } else if (match_parser(parser, TOKEN_U64)) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_U64;
-            } else if (match_parser(parser, TOKEN_IDENTIFIER) && strcmp(parser->previous.lexeme, "int") == 0) {
-                node->value.function.return_types[node->value.function.return_type_count++] = TYPE_I32;
-            } else {
+            DataType type;
+            if (!parse_type(parser, &type)) {
                 error(parser, "Expected return type");
                 return NULL;
             }
+            node->value.function.return_types[node->value.function.return_type_count++] = type;
 
         } while (match_parser(parser, TOKEN_COMMA));
 
@@ -407,37 +460,7 @@ static AstNode* parse_function(Parser* parser) {
         node->value.function.return_types = malloc(sizeof(DataType));
         node->value.function.return_type_count = 1;
 
-        if (match_parser(parser, TOKEN_NULL)) {
-            node->value.function.return_types[0] = TYPE_NULL;
-        } else if (match_parser(parser, TOKEN_ERROR)) {
-            node->value.function.return_types[0] = TYPE_ERROR;
-        } else if (match_parser(parser, TOKEN_BOOL)) {
-            node->value.function.return_types[0] = TYPE_BOOL;
-        } else if (match_parser(parser, TOKEN_I8)) {
-            node->value.function.return_types[0] = TYPE_I8;
-        } else if (match_parser(parser, TOKEN_I16)) {
-            node->value.function.return_types[0] = TYPE_I16;
-        } else if (match_parser(parser, TOKEN_I32)) {
-            node->value.function.return_types[0] = TYPE_I32;
-        } else if (match_parser(parser, TOKEN_I64)) {
-            node->value.function.return_types[0] = TYPE_I64;
-        } else if (match_parser(parser, TOKEN_F32)) {
-            node->value.function.return_types[0] = TYPE_F32;
-        } else if (match_parser(parser, TOKEN_F64)) {
-            node->value.function.return_types[0] = TYPE_F64;
-        } else if (match_parser(parser, TOKEN_STR)) {
-            node->value.function.return_types[0] = TYPE_STR;
-        } else if (match_parser(parser, TOKEN_U8)) {
-            node->value.function.return_types[0] = TYPE_U8;
-        } else if (match_parser(parser, TOKEN_U16)) {
-            node->value.function.return_types[0] = TYPE_U16;
-        } else if (match_parser(parser, TOKEN_U32)) {
-            node->value.function.return_types[0] = TYPE_U32;
-        } else if (match_parser(parser, TOKEN_U64)) {
-            node->value.function.return_types[0] = TYPE_U64;
-        } else if (match_parser(parser, TOKEN_IDENTIFIER) && strcmp(parser->previous.lexeme, "int") == 0) {
-            node->value.function.return_types[0] = TYPE_I32;
-        } else {
+        if (!parse_type(parser, &node->value.function.return_types[0])) {
             error(parser, "Expected return type");
             return NULL;
         }
@@ -448,29 +471,32 @@ static AstNode* parse_function(Parser* parser) {
         return NULL;
     }
 
-    AstNode* block = malloc(sizeof(AstNode));
-    block->type = NODE_BLOCK;
-    block->value.block.statements = malloc(sizeof(AstNode*) * 8);
-    block->value.block.statement_count = 0;
-    int capacity = 8;
+    AstNode* block = parse_block(parser, node_column);
+    if (block == NULL) {
+        return NULL;
+    }
+
+    node->value.function.body = block;
+    return node;
+}
 
-    // Parse first statement (must have at least one)
-    AstNode* first_stmt = parse_statement(parser);
-    if (first_stmt == NULL) {
-        free(block->value.block.statements);
-        free(block);
+// Parse the statements indented deeper than the line that opened the block.
+// The lexer does not produce indentation tokens, so blocks are delimited by
+// the column of their first statement.
+static AstNode* parse_block(Parser* parser, int parent_column) {
+    int column = parser->current.column;
+    if (check(parser, TOKEN_EOF) || column <= parent_column) {
+        error(parser, "Expected an indented block");
         return NULL;
     }
-    block->value.block.statements[block->value.block.statement_count++] = first_stmt;
 
-    // Parse any additional statements
-    while (!check(parser, TOKEN_EOF) &&
-           (check(parser, TOKEN_IF) ||
-            check(parser, TOKEN_RETURN) ||
-            check(parser, TOKEN_IDENTIFIER) ||
-            check(parser, TOKEN_OPTIONAL) ||
-            is_type_token(parser->current.type))) {
+    AstNode* block = new_node(parser, NODE_BLOCK);
+    block->line = parser->current.line;
+    block->value.block.statements = malloc(sizeof(AstNode*) * 8);
+    block->value.block.statement_count = 0;
+    int capacity = 8;
 
+    do {
         if (block->value.block.statement_count == capacity) {
             capacity *= 2;
             block->value.block.statements = realloc(
@@ -481,22 +507,26 @@ static AstNode* parse_function(Parser* parser) {
 
         AstNode* stmt = parse_statement(parser);
         if (stmt == NULL) {
-            for (int i = 0; i < block->value.block.statement_count; i++) {
-                free_ast(block->value.block.statements[i]);
-            }
-            free(block->value.block.statements);
-            free(block);
+            free_ast(block);
             return NULL;
         }
 
         block->value.block.statements[block->value.block.statement_count++] = stmt;
+    } while (!check(parser, TOKEN_EOF) && parser->current.column == column &&
+             parser->current.line != parser->previous.line);
+
+    if (!check(parser, TOKEN_EOF) && parser->current.column > column) {
+        error(parser, "Unexpected indentation");
+        free_ast(block);
+        return NULL;
     }
 
-    node->value.function.body = block;
-    return node;
+    return block;
 }
 
 static AstNode* parse_if_statement(Parser* parser) {
+    int line = parser->previous.line;
+    int column = parser->previous.column;
     AstNode* condition = parse_expression(parser);
     if (condition == NULL) return NULL;
 
@@ -506,65 +536,339 @@ static AstNode* parse_if_statement(Parser* parser) {
         return NULL;
     }
 
-    int capacity = 2;
-    struct AstNode** then_branches = malloc(sizeof(AstNode*) * capacity);
-    int then_count = 0;
-
-    AstNode* then_branch = parse_statement(parser);
+    AstNode* then_branch = parse_block(parser, column);
     if (then_branch == NULL) {
         free_ast(condition);
-        free(then_branches);
         return NULL;
     }
-    then_branches[then_count++] = then_branch;
 
-    while (match_parser(parser, TOKEN_ELSIF)) {
-        if (then_count == capacity) {
-            capacity *= 2;
-            then_branches = realloc(then_branches, sizeof(AstNode*) * capacity);
-        }
-
-        AstNode* elsif_branch = parse_statement(parser);
-        if (elsif_branch == NULL) {
-            for (int i = 0; i < then_count; i++) {
-                free_ast(then_branches[i]);
-            }
-            free(then_branches);
+    // elsif chains nest as an if in the else branch
+    AstNode* else_branch = NULL;
+    if (match_parser(parser, TOKEN_ELSIF)) {
+        else_branch = parse_if_statement(parser);
+        if (else_branch == NULL) {
             free_ast(condition);
+            free_ast(then_branch);
             return NULL;
         }
-        then_branches[then_count++] = elsif_branch;
-    }
-
-    AstNode* else_branch = NULL;
-    if (match_parser(parser, TOKEN_ELSE)) {
+    } else if (match_parser(parser, TOKEN_ELSE)) {
         if (!match_parser(parser, TOKEN_COLON)) {
             error(parser, "Expected ':' after else");
-            for (int i = 0; i < then_count; i++) {
-                free_ast(then_branches[i]);
-            }
-            free(then_branches);
             free_ast(condition);
+            free_ast(then_branch);
+            return NULL;
+        }
+        else_branch = parse_block(parser, column);
+        if (else_branch == NULL) {
+            free_ast(condition);
+            free_ast(then_branch);
             return NULL;
         }
-        else_branch = parse_statement(parser);
     }
 
-    AstNode* node = malloc(sizeof(AstNode));
-    node->type = NODE_IF;
+    AstNode* node = new_node(parser, NODE_IF);
+    node->line = line;
     node->value.if_stmt.condition = condition;
-    node->value.if_stmt.then_branches = then_branches;
-    node->value.if_stmt.then_branches_count = then_count;
+    node->value.if_stmt.then_branches = malloc(sizeof(AstNode*));
+    node->value.if_stmt.then_branches[0] = then_branch;
+    node->value.if_stmt.then_branches_count = 1;
     node->value.if_stmt.else_branch = else_branch;
 
     return node;
 }
 
+static AstNode* parse_while_statement(Parser* parser) {
+    int line = parser->previous.line;
+    int column = parser->previous.column;
+    AstNode* condition = parse_expression(parser);
+    if (condition == NULL) return NULL;
+
+    if (!match_parser(parser, TOKEN_COLON)) {
+        error(parser, "Expected ':' after while condition");
+        free_ast(condition);
+        return NULL;
+    }
+
+    AstNode* body = parse_block(parser, column);
+    if (body == NULL) {
+        free_ast(condition);
+        return NULL;
+    }
+
+    AstNode* node = new_node(parser, NODE_WHILE);
+    node->line = line;
+    node->value.while_stmt.condition = condition;
+    node->value.while_stmt.body = body;
+    return node;
+}
+
+// "[par] for [type] name = range([start,] end[, step]):"; range() here is
+// part of the loop header rather than a call, so no iterator object ever
+// exists. column is where the statement starts, at par if there is one.
+static AstNode* parse_for_statement(Parser* parser, int column, bool parallel) {
+    int line = parser->previous.line;
+
+    DataType type = TYPE_I64;
+    if (is_type_start(parser) && !parse_type(parser, &type)) {
+        error(parser, "Expected type name");
+        return NULL;
+    }
+    if (type > TYPE_I64) {
+        error(parser, "Loop variable must be an integer");
+        return NULL;
+    }
+    if (!match_parser(parser, TOKEN_IDENTIFIER)) {
+        error(parser, "Expected loop variable name");
+        return NULL;
+    }
+    char* name = strdup(parser->previous.lexeme);
+
+    if (!match_parser(parser, TOKEN_ASSIGNMENT)) {
+        error(parser, "Expected '=' after loop variable");
+        free(name);
+        return NULL;
+    }
+
+    AstNode* range = parse_expression(parser);
+    if (range == NULL) {
+        free(name);
+        return NULL;
+    }
+    int count = range->type == NODE_FUNCTION_CALL ? range->value.function_call.argument_count : 0;
+    if (range->type != NODE_FUNCTION_CALL || strcmp(range->value.function_call.name, "range") != 0 ||
+        count < 1 || count > 3) {
+        error(parser, "Expected range(end), range(start, end) or range(start, end, step)");
+        free(name);
+        free_ast(range);
+        return NULL;
+    }
+
+    if (!match_parser(parser, TOKEN_COLON)) {
+        error(parser, "Expected ':' after range()");
+        free(name);
+        free_ast(range);
+        return NULL;
+    }
+
+    AstNode* body = parse_block(parser, column);
+    if (body == NULL) {
+        free(name);
+        free_ast(range);
+        return NULL;
+    }
+
+    AstNode** arguments = range->value.function_call.arguments;
+    AstNode* node = new_node(parser, NODE_FOR);
+    node->line = line;
+    node->value.for_stmt.name = name;
+    node->value.for_stmt.type = type;
+    if (count == 1) {
+        node->value.for_stmt.start = create_literal_node(strdup("0"), TYPE_I32);
+        node->value.for_stmt.start->line = line;
+        node->value.for_stmt.end = arguments[0];
+    } else {
+        node->value.for_stmt.start = arguments[0];
+        node->value.for_stmt.end = arguments[1];
+    }
+    node->value.for_stmt.step = count == 3 ? arguments[2] : NULL;
+    node->value.for_stmt.body = body;
+    node->value.for_stmt.parallel = parallel;
+
+    free(range->value.function_call.name);
+    free(arguments);
+    free(range);
+    return node;
+}
+
+// "go call(args)" runs the call on a new task; the statement itself
+// finishes as soon as the arguments are evaluated
+static AstNode* parse_go_statement(Parser* parser) {
+    int line = parser->previous.line;
+    AstNode* call = parse_expression(parser);
+    if (call == NULL) return NULL;
+    if (call->type != NODE_FUNCTION_CALL) {
+        error(parser, "Expected a function call after 'go'");
+        free_ast(call);
+        return NULL;
+    }
+
+    AstNode* node = new_node(parser, NODE_GO);
+    node->line = line;
+    node->value.go_stmt.call = call;
+    return node;
+}
+
+// Whether node is a call of the builtin name with count arguments
+static bool is_call_named(AstNode* node, const char* name, int count) {
+    return node != NULL && node->type == NODE_FUNCTION_CALL && strcmp(node->value.function_call.name, name) == 0 &&
+           node->value.function_call.argument_count == count;
+}
+
+// A case of select: send(c, v), recv(c), "T x = recv(c)" or
+// "T x, bool ok = recv(c)"
+static bool is_select_case(AstNode* node) {
+    if (is_call_named(node, "send", 2) || is_call_named(node, "recv", 1)) return true;
+    if (node->type == NODE_VARIABLE) {
+        return !node->value.variable.is_optional && is_call_named(node->value.variable.init_value, "recv", 1);
+    }
+    return node->type == NODE_DESTRUCTURE && node->value.destructure.target_count == 2 &&
+           is_call_named(node->value.destructure.value, "recv", 1);
+}
+
+// "select:" followed by indented cases, each a channel operation, ':' and
+// a block, and optionally "else:" and a block last
+static AstNode* parse_select_statement(Parser* parser) {
+    int line = parser->previous.line;
+    int column = parser->previous.column;
+    if (!match_parser(parser, TOKEN_COLON)) {
+        error(parser, "Expected ':' after select");
+        return NULL;
+    }
+
+    AstNode* node = new_node(parser, NODE_SELECT);
+    node->line = line;
+    int capacity = 4;
+    node->value.select_stmt.cases = malloc(sizeof(AstNode*) * capacity);
+    node->value.select_stmt.bodies = malloc(sizeof(AstNode*) * capacity);
+    node->value.select_stmt.case_count = 0;
+    node->value.select_stmt.else_branch = NULL;
+
+    int case_column = parser->current.column;
+    if (check(parser, TOKEN_EOF) || case_column <= column) {
+        error(parser, "Expected an indented case");
+        free_ast(node);
+        return NULL;
+    }
+    do {
+        if (match_parser(parser, TOKEN_ELSE)) {
+            if (!match_parser(parser, TOKEN_COLON)) {
+                error(parser, "Expected ':' after else");
+                free_ast(node);
+                return NULL;
+            }
+            node->value.select_stmt.else_branch = parse_block(parser, case_column);
+            if (node->value.select_stmt.else_branch == NULL) {
+                free_ast(node);
+                return NULL;
+            }
+            break;
+        }
+
+        AstNode* head = parse_statement(parser);
+        if (head == NULL) {
+            free_ast(node);
+            return NULL;
+        }
+        if (!is_select_case(head)) {
+            error(parser, "Expected send(c, v), recv(c) or a declaration from recv(c)");
+            free_ast(head);
+            free_ast(node);
+            return NULL;
+        }
+        if (!match_parser(parser, TOKEN_COLON)) {
+            error(parser, "Expected ':' after select case");
+            free_ast(head);
+            free_ast(node);
+            return NULL;
+        }
+        AstNode* body = parse_block(parser, case_column);
+        if (body == NULL) {
+            free_ast(head);
+            free_ast(node);
+            return NULL;
+        }
+
+        if (node->value.select_stmt.case_count == capacity) {
+            capacity *= 2;
+            node->value.select_stmt.cases = realloc(node->value.select_stmt.cases, sizeof(AstNode*) * capacity);
+            node->value.select_stmt.bodies = realloc(node->value.select_stmt.bodies, sizeof(AstNode*) * capacity);
+        }
+        node->value.select_stmt.cases[node->value.select_stmt.case_count] = head;
+        node->value.select_stmt.bodies[node->value.select_stmt.case_count++] = body;
+    } while (!check(parser, TOKEN_EOF) && parser->current.column == case_column &&
+             parser->current.line != parser->previous.line);
+
+    if (node->value.select_stmt.case_count == 0) {
+        error(parser, "select needs at least one case");
+        free_ast(node);
+        return NULL;
+    }
+    return node;
+}
+
 static AstNode* parse_expression(Parser* parser) {
     return parse_equality(parser);
 }
 
+// Parse "type name"; returns the name, or NULL after reporting an error
+static char* parse_typed_name(Parser* parser, DataType* type) {
+    if (!parse_type(parser, type)) {
+        error(parser, "Expected type name");
+        return NULL;
+    }
+
+    if (!match_parser(parser, TOKEN_IDENTIFIER)) {
+        error(parser, "Expected variable name");
+        return NULL;
+    }
+    return strdup(parser->previous.lexeme);
+}
+
+// "int q, error err = div(a, b)" unpacks the values of a multi-value call
+static AstNode* parse_destructuring(Parser* parser, int line, char* first_name, DataType first_type) {
+    int capacity = 4;
+    AstNode** targets = malloc(sizeof(AstNode*) * capacity);
+    int count = 0;
+    targets[count] = create_variable_node(first_name, NULL, first_type, false);
+    targets[count++]->line = line;
+
+    do {
+        DataType type;
+        char* name = parse_typed_name(parser, &type);
+        if (name == NULL) {
+            for (int i = 0; i < count; i++) {
+                free_ast(targets[i]);
+            }
+            free(targets);
+            return NULL;
+        }
+        if (count == capacity) {
+            capacity *= 2;
+            targets = realloc(targets, sizeof(AstNode*) * capacity);
+        }
+        targets[count] = create_variable_node(name, NULL, type, false);
+        targets[count++]->line = line;
+    } while (match_parser(parser, TOKEN_COMMA));
+
+    AstNode* value = NULL;
+    if (!match_parser(parser, TOKEN_ASSIGNMENT)) {
+        error(parser, "Expected '=' after variable names");
+    } else {
+        value = parse_expression(parser);
+        if (value != NULL && value->type != NODE_FUNCTION_CALL) {
+            error(parser, "Only a function call can initialize several variables");
+            free_ast(value);
+            value = NULL;
+        }
+    }
+    if (value == NULL) {
+        for (int i = 0; i < count; i++) {
+            free_ast(targets[i]);
+        }
+        free(targets);
+        return NULL;
+    }
+
+    AstNode* node = new_node(parser, NODE_DESTRUCTURE);
+    node->line = line;
+    node->value.destructure.targets = targets;
+    node->value.destructure.target_count = count;
+    node->value.destructure.value = value;
+    return node;
+}
+
 static AstNode* parse_variable_declaration(Parser* parser) {
+    int line = parser->current.line;
     bool is_optional = false;
 
     if (parser->current.type == TOKEN_OPTIONAL) {
@@ -572,26 +876,15 @@ static AstNode* parse_variable_declaration(Parser* parser) {
         advance_parser(parser);
     }
 
-    if (!is_type_token(parser->current.type) && 
-        !(parser->current.type == TOKEN_IDENTIFIER && strcmp(parser->current.lexeme, "int") == 0)) {
-        error(parser, "Expected type name");
+    DataType var_type;
+    char* var_name = parse_typed_name(parser, &var_type);
+    if (var_name == NULL) {
         return NULL;
     }
 
-    DataType var_type;
-    if (parser->current.type == TOKEN_IDENTIFIER && strcmp(parser->current.lexeme, "int") == 0) {
-        var_type = TYPE_I32;
-    } else {
-        var_type = token_type_to_data_type(parser->current.type);
+    if (!is_optional && match_parser(parser, TOKEN_COMMA)) {
+        return parse_destructuring(parser, line, var_name, var_type);
     }
-    advance_parser(parser);
-
-    if (!match_parser(parser, TOKEN_IDENTIFIER)) {
-        error(parser, "Expected variable name");
-        return NULL;
-    }
-    
-    char* var_name = strdup(parser->previous.lexeme);
 
     if (!match_parser(parser, TOKEN_ASSIGNMENT)) {
         error(parser, "Expected '=' after variable name");
@@ -615,7 +908,9 @@ static AstNode* parse_variable_declaration(Parser* parser) {
         return NULL;
     }
 
-    return create_variable_node(var_name, init_value, var_type, is_optional);
+    AstNode* node = create_variable_node(var_name, init_value, var_type, is_optional);
+    node->line = line;
+    return node;
 }
 
 static AstNode* parse_statement(Parser* parser) {
@@ -625,21 +920,67 @@ static AstNode* parse_statement(Parser* parser) {
     if (match_parser(parser, TOKEN_IF)) {
         return parse_if_statement(parser);
     }
+    if (match_parser(parser, TOKEN_WHILE)) {
+        return parse_while_statement(parser);
+    }
+    if (match_parser(parser, TOKEN_FOR)) {
+        return parse_for_statement(parser, parser->previous.column, false);
+    }
+    if (match_parser(parser, TOKEN_PAR)) {
+        int column = parser->previous.column;
+        if (!match_parser(parser, TOKEN_FOR)) {
+            error(parser, "Expected 'for' after 'par'");
+            return NULL;
+        }
+        return parse_for_statement(parser, column, true);
+    }
+    if (match_parser(parser, TOKEN_GO)) {
+        return parse_go_statement(parser);
+    }
+    if (match_parser(parser, TOKEN_SELECT)) {
+        return parse_select_statement(parser);
+    }
 
     // Check for variable declaration
-    if (parser->current.type == TOKEN_OPTIONAL || 
-        is_type_token(parser->current.type) || 
-        (parser->current.type == TOKEN_IDENTIFIER && strcmp(parser->current.lexeme, "int") == 0)) {
-        
+    if (parser->current.type == TOKEN_OPTIONAL || is_type_start(parser)) {
         return parse_variable_declaration(parser);
     }
 
-    return parse_expression(parser);
+    AstNode* expr = parse_expression(parser);
+    if (expr != NULL && match_parser(parser, TOKEN_ASSIGNMENT)) {
+        // name = value or name[index] = value
+        AstNode* target = expr->type == NODE_INDEX ? expr->value.index.target : expr;
+        if (target->type != NODE_LITERAL || target->value.literal.type != TYPE_I32 ||
+            !(isalpha((unsigned char)target->value.literal.value[0]) || target->value.literal.value[0] == '_')) {
+            error(parser, "Invalid assignment target");
+            free_ast(expr);
+            return NULL;
+        }
+
+        AstNode* value = parse_expression(parser);
+        if (value == NULL) {
+            free_ast(expr);
+            return NULL;
+        }
+
+        AstNode* node = new_node(parser, NODE_ASSIGNMENT);
+        node->line = expr->line;
+        node->value.assignment.name = target->value.literal.value;
+        node->value.assignment.index = NULL;
+        node->value.assignment.value = value;
+        if (expr->type == NODE_INDEX) {
+            node->value.assignment.index = expr->value.index.index;
+            free(expr);
+        }
+        free(target);
+        return node;
+    }
+
+    return expr;
 }
 
 static AstNode* parse_return_statement(Parser* parser) {
-    AstNode* node = malloc(sizeof(AstNode));
-    node->type = NODE_RETURN;
+    AstNode* node = new_node(parser, NODE_RETURN);
 
     if (match_parser(parser, TOKEN_LEFT_PAREN)) {
         // Multi-value return
@@ -677,8 +1018,7 @@ static AstNode* parse_return_statement(Parser* parser) {
         }
 
         if (count > 1) {
-            AstNode* tuple = malloc(sizeof(AstNode));
-            tuple->type = NODE_TUPLE;
+            AstNode* tuple = new_node(parser, NODE_TUPLE);
             tuple->value.tuple.values = values;
             tuple->value.tuple.value_count = count;
             node->value.return_stmt.return_value = tuple;
@@ -704,8 +1044,7 @@ static AstNode* parse_parameter(Parser* parser) {
         return NULL;
     }
 
-    AstNode* param = malloc(sizeof(AstNode));
-    param->type = NODE_PARAMETER;
+    AstNode* param = new_node(parser, NODE_PARAMETER);
     param->value.parameter.name = strdup(parser->previous.lexeme);
 
     if (!match_parser(parser, TOKEN_COLON)) {
@@ -714,40 +1053,7 @@ static AstNode* parse_parameter(Parser* parser) {
         return NULL;
     }
 
-    // Handle STR type explicitly
-    if (match_parser(parser, TOKEN_STR)) {
-        param->value.parameter.type = TYPE_STR;
-    } 
-    // Handle other type tokens
-    else if (match_parser(parser, TOKEN_U8)) {
-        param->value.parameter.type = TYPE_U8;
-    } else if (match_parser(parser, TOKEN_U16)) {
-        param->value.parameter.type = TYPE_U16;
-    } else if (match_parser(parser, TOKEN_U32)) {
-        param->value.parameter.type = TYPE_U32;
-    } else if (match_parser(parser, TOKEN_U64)) {
-        param->value.parameter.type = TYPE_U64;
-    } else if (match_parser(parser, TOKEN_I8)) {
-        param->value.parameter.type = TYPE_I8;
-    } else if (match_parser(parser, TOKEN_I16)) {
-        param->value.parameter.type = TYPE_I16;
-    } else if (match_parser(parser, TOKEN_I32)) {
-        param->value.parameter.type = TYPE_I32;
-    } else if (match_parser(parser, TOKEN_I64)) {
-        param->value.parameter.type = TYPE_I64;
-    } else if (match_parser(parser, TOKEN_F32)) {
-        param->value.parameter.type = TYPE_F32;
-    } else if (match_parser(parser, TOKEN_F64)) {
-        param->value.parameter.type = TYPE_F64;
-    } else if (match_parser(parser, TOKEN_BOOL)) {
-        param->value.parameter.type = TYPE_BOOL;
-    } else if (match_parser(parser, TOKEN_NULL)) {
-        param->value.parameter.type = TYPE_NULL;
-    } else if (match_parser(parser, TOKEN_ERROR)) {
-        param->value.parameter.type = TYPE_ERROR;
-    } else if (match_parser(parser, TOKEN_IDENTIFIER) && strcmp(parser->previous.lexeme, "int") == 0) {
-        param->value.parameter.type = TYPE_I32;
-    } else {
+    if (!parse_type(parser, &param->value.parameter.type)) {
         error(parser, "Expected parameter type");
         free_ast(param);
         return NULL;
@@ -779,6 +1085,38 @@ AstNode* parse(Parser* parser) {
     return ast;
 }
 
+AstNode* parse_program(Parser* parser) {
+    AstNode* program = new_node(parser, NODE_BLOCK);
+    program->value.block.statements = malloc(sizeof(AstNode*) * 8);
+    program->value.block.statement_count = 0;
+    int capacity = 8;
+
+    while (!check(parser, TOKEN_EOF)) {
+        if (program->value.block.statement_count == capacity) {
+            capacity *= 2;
+            program->value.block.statements = realloc(
+                    program->value.block.statements,
+                    sizeof(AstNode*) * capacity
+            );
+        }
+
+        AstNode* function = parse_function(parser);
+        if (function == NULL) {
+            free_ast(program);
+            return NULL;
+        }
+
+        program->value.block.statements[program->value.block.statement_count++] = function;
+    }
+
+    if (parser->had_error) {
+        free_ast(program);
+        return NULL;
+    }
+
+    return program;
+}
+
 bool had_parser_error(Parser* parser) {
     return parser->had_error;
 }
@@ -0,0 +1,11 @@
+#include "../include/perf_map.h"
+
+void perf_symbol_name(char* buffer, size_t size, const AstNode* function, const char* source_file) {
+    const char* name = function->type == NODE_FUNCTION ? function->value.function.name : "<anonymous>";
+
+    if (source_file != NULL && function->line > 0) {
+        snprintf(buffer, size, "pf:%s (%s:%d)", name, source_file, function->line);
+    } else {
+        snprintf(buffer, size, "pf:%s", name);
+    }
+}
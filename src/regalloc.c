@@ -0,0 +1,458 @@
+#include "../include/regalloc.h"
+
+static const RegAllocTarget x86_64_target = {
+    "x86-64 System V",
+    {
+        // Caller-saved first: values that do not live across a call should
+        // not force a save/restore in the prologue
+        {"rax", REG_CLASS_INT, false},
+        {"rcx", REG_CLASS_INT, false},
+        {"rdx", REG_CLASS_INT, false},
+        {"rsi", REG_CLASS_INT, false},
+        {"rdi", REG_CLASS_INT, false},
+        {"r8", REG_CLASS_INT, false},
+        {"r9", REG_CLASS_INT, false},
+        {"r10", REG_CLASS_INT, false},
+        {"r11", REG_CLASS_INT, false},
+        {"rbx", REG_CLASS_INT, true},
+        {"r12", REG_CLASS_INT, true},
+        {"r13", REG_CLASS_INT, true},
+        {"r14", REG_CLASS_INT, true},
+        {"r15", REG_CLASS_INT, true},
+        {"xmm0", REG_CLASS_SSE, false},
+        {"xmm1", REG_CLASS_SSE, false},
+        {"xmm2", REG_CLASS_SSE, false},
+        {"xmm3", REG_CLASS_SSE, false},
+        {"xmm4", REG_CLASS_SSE, false},
+        {"xmm5", REG_CLASS_SSE, false},
+        {"xmm6", REG_CLASS_SSE, false},
+        {"xmm7", REG_CLASS_SSE, false},
+        {"xmm8", REG_CLASS_SSE, false},
+        {"xmm9", REG_CLASS_SSE, false},
+        {"xmm10", REG_CLASS_SSE, false},
+        {"xmm11", REG_CLASS_SSE, false},
+        {"xmm12", REG_CLASS_SSE, false},
+        {"xmm13", REG_CLASS_SSE, false},
+        {"xmm14", REG_CLASS_SSE, false},
+        {"xmm15", REG_CLASS_SSE, false},
+    },
+    30,
+};
+
+const RegAllocTarget* regalloc_target_x86_64(void) {
+    return &x86_64_target;
+}
+
+// Liveness sets are bit vectors indexed by value id
+typedef struct {
+    uint64_t* live_in;
+    uint64_t* live_out;
+    int from;               // Position before the first instruction
+    int to;                 // Position after the terminator
+} BlockLiveness;
+
+typedef struct {
+    IrFunction* function;
+    int word_count;
+    BlockLiveness* blocks;  // Indexed by rpo_index
+    int block_count;
+    int* positions;         // Instruction position by value id
+} Liveness;
+
+static void* regalloc_alloc(size_t size) {
+    void* memory = calloc(1, size);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: Failed to allocate memory for register allocation\n");
+        exit(1);
+    }
+    return memory;
+}
+
+static void set_bit(uint64_t* set, int bit) {
+    set[bit / 64] |= 1ULL << (bit % 64);
+}
+
+static void clear_bit(uint64_t* set, int bit) {
+    set[bit / 64] &= ~(1ULL << (bit % 64));
+}
+
+static bool test_bit(const uint64_t* set, int bit) {
+    return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+static RegClass value_class(IrInstr* value) {
+    return value->type == TYPE_F32 || value->type == TYPE_F64 ? REG_CLASS_SSE : REG_CLASS_INT;
+}
+
+static int pred_index(IrBlock* block, IrBlock* pred) {
+    for (int p = 0; p < block->pred_count; p++) {
+        if (block->preds[p] == pred) return p;
+    }
+    return -1;
+}
+
+// Number the instructions in block order, two apart so that block
+// boundaries get positions of their own
+static void number_instructions(Liveness* liveness) {
+    IrFunction* function = liveness->function;
+    int position = 0;
+    for (int b = 0; b < liveness->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        liveness->blocks[b].from = position;
+        position += 2;
+        for (int i = 0; i < block->instr_count; i++) {
+            liveness->positions[block->instrs[i]->id] = position;
+            position += 2;
+        }
+        liveness->blocks[b].to = position;
+        position += 2;
+    }
+}
+
+// live_out(b) is the union over successors s of live_in(s) and the phi
+// operands s takes from b; live_in(b) is live_out(b) without b's
+// definitions, plus b's non-phi uses. Iterated backwards to a fixed point.
+static void compute_liveness(Liveness* liveness) {
+    IrFunction* function = liveness->function;
+    uint64_t* scratch = regalloc_alloc(sizeof(uint64_t) * liveness->word_count);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int b = liveness->block_count - 1; b >= 0; b--) {
+            IrBlock* block = function->blocks[b];
+            BlockLiveness* info = &liveness->blocks[b];
+
+            memset(scratch, 0, sizeof(uint64_t) * liveness->word_count);
+            for (int s = 0; s < ir_successor_count(block); s++) {
+                IrBlock* successor = ir_successor(block, s);
+                if (successor->rpo_index < 0) continue;
+                uint64_t* successor_in = liveness->blocks[successor->rpo_index].live_in;
+                for (int w = 0; w < liveness->word_count; w++) {
+                    scratch[w] |= successor_in[w];
+                }
+                int index = pred_index(successor, block);
+                for (int i = 0; i < successor->instr_count && successor->instrs[i]->op == IR_PHI; i++) {
+                    set_bit(scratch, successor->instrs[i]->operands[index]->id);
+                }
+            }
+            memcpy(info->live_out, scratch, sizeof(uint64_t) * liveness->word_count);
+
+            for (int i = block->instr_count - 1; i >= 0; i--) {
+                IrInstr* instr = block->instrs[i];
+                clear_bit(scratch, instr->id);
+                if (instr->op == IR_PHI) continue;
+                for (int o = 0; o < instr->operand_count; o++) {
+                    set_bit(scratch, instr->operands[o]->id);
+                }
+            }
+
+            if (memcmp(scratch, info->live_in, sizeof(uint64_t) * liveness->word_count) != 0) {
+                memcpy(info->live_in, scratch, sizeof(uint64_t) * liveness->word_count);
+                changed = true;
+            }
+        }
+    }
+
+    free(scratch);
+}
+
+static void extend(LiveInterval* interval, int position) {
+    if (interval->start < 0 || position < interval->start) interval->start = position;
+    if (position > interval->end) interval->end = position;
+}
+
+static int compare_by_start(const void* a, const void* b) {
+    const LiveInterval* left = a;
+    const LiveInterval* right = b;
+    if (left->start != right->start) return left->start - right->start;
+    return left->value->id - right->value->id;
+}
+
+static void build_intervals(RegAllocation* allocation, Liveness* liveness) {
+    IrFunction* function = liveness->function;
+
+    // One interval per value-defining instruction in a reachable block
+    LiveInterval* intervals = regalloc_alloc(sizeof(LiveInterval) * function->next_value_id);
+    int count = 0;
+    int* index = regalloc_alloc(sizeof(int) * function->next_value_id);
+    for (int v = 0; v < function->next_value_id; v++) index[v] = -1;
+
+    for (int b = 0; b < liveness->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* instr = block->instrs[i];
+            if (!ir_defines_value(instr)) continue;
+            LiveInterval* interval = &intervals[count];
+            interval->value = instr;
+            interval->reg_class = value_class(instr);
+            interval->start = -1;
+            interval->end = -1;
+            interval->reg = -1;
+            interval->spill_slot = -1;
+            index[instr->id] = count++;
+        }
+    }
+
+    // The interval is the hull of every point the value is live at
+    for (int b = 0; b < liveness->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        BlockLiveness* info = &liveness->blocks[b];
+        for (int v = 0; v < function->next_value_id; v++) {
+            if (index[v] < 0) continue;
+            if (test_bit(info->live_in, v)) extend(&intervals[index[v]], info->from);
+            if (test_bit(info->live_out, v)) extend(&intervals[index[v]], info->to);
+        }
+        for (int i = 0; i < block->instr_count; i++) {
+            IrInstr* instr = block->instrs[i];
+            int position = liveness->positions[instr->id];
+            if (index[instr->id] >= 0) extend(&intervals[index[instr->id]], position);
+            if (instr->op == IR_PHI) continue;
+            for (int o = 0; o < instr->operand_count; o++) {
+                int operand = index[instr->operands[o]->id];
+                if (operand >= 0) extend(&intervals[operand], position);
+            }
+        }
+    }
+
+    // A call clobbers the caller-saved registers of everything live past it
+    for (int b = 0; b < liveness->block_count; b++) {
+        IrBlock* block = function->blocks[b];
+        for (int i = 0; i < block->instr_count; i++) {
+            if (block->instrs[i]->op != IR_CALL && block->instrs[i]->op != IR_SPAWN) continue;
+            int position = liveness->positions[block->instrs[i]->id];
+            for (int n = 0; n < count; n++) {
+                if (intervals[n].start < position && intervals[n].end > position) {
+                    intervals[n].crosses_call = true;
+                }
+            }
+        }
+    }
+
+    // A back edge from latch to header spans the loop body in block order
+    for (int b = 0; b < liveness->block_count; b++) {
+        IrBlock* header = function->blocks[b];
+        for (int p = 0; p < header->pred_count; p++) {
+            IrBlock* latch = header->preds[p];
+            if (latch->rpo_index < header->rpo_index) continue;
+            int loop_from = liveness->blocks[header->rpo_index].from;
+            int loop_to = liveness->blocks[latch->rpo_index].to;
+            for (int n = 0; n < count; n++) {
+                if (intervals[n].start <= loop_to && intervals[n].end >= loop_from) {
+                    intervals[n].in_loop = true;
+                }
+            }
+        }
+    }
+
+    qsort(intervals, count, sizeof(LiveInterval), compare_by_start);
+    for (int n = 0; n < count; n++) {
+        index[intervals[n].value->id] = n;
+    }
+
+    allocation->intervals = intervals;
+    allocation->interval_count = count;
+    allocation->value_intervals = index;
+    allocation->value_count = function->next_value_id;
+}
+
+// Active intervals are kept sorted by increasing end
+typedef struct {
+    LiveInterval** intervals;
+    int count;
+} ActiveList;
+
+static void active_insert(ActiveList* active, LiveInterval* interval) {
+    int i = active->count++;
+    while (i > 0 && active->intervals[i - 1]->end > interval->end) {
+        active->intervals[i] = active->intervals[i - 1];
+        i--;
+    }
+    active->intervals[i] = interval;
+}
+
+static void active_remove(ActiveList* active, int index) {
+    memmove(&active->intervals[index], &active->intervals[index + 1],
+            sizeof(LiveInterval*) * (active->count - index - 1));
+    active->count--;
+}
+
+static bool register_fits(const RegisterInfo* info, LiveInterval* interval) {
+    return info->reg_class == interval->reg_class && (info->callee_saved || !interval->crosses_call);
+}
+
+static void linear_scan(RegAllocation* allocation) {
+    const RegAllocTarget* target = allocation->target;
+    bool is_free[REGALLOC_MAX_REGISTERS];
+    for (int r = 0; r < target->register_count; r++) is_free[r] = true;
+
+    ActiveList active;
+    active.intervals = regalloc_alloc(sizeof(LiveInterval*) * (allocation->interval_count + 1));
+    active.count = 0;
+
+    for (int n = 0; n < allocation->interval_count; n++) {
+        LiveInterval* current = &allocation->intervals[n];
+
+        // Expire intervals that end before this one starts. An operand whose
+        // last use defines current can hand its register over.
+        while (active.count > 0 && active.intervals[0]->end <= current->start) {
+            is_free[active.intervals[0]->reg] = true;
+            active_remove(&active, 0);
+        }
+
+        int chosen = -1;
+        for (int r = 0; r < target->register_count; r++) {
+            if (is_free[r] && register_fits(&target->registers[r], current)) {
+                chosen = r;
+                break;
+            }
+        }
+
+        if (chosen >= 0) {
+            current->reg = chosen;
+            is_free[chosen] = false;
+            active_insert(&active, current);
+            continue;
+        }
+
+        // Spill whichever compatible interval ends last
+        int victim = -1;
+        for (int a = active.count - 1; a >= 0; a--) {
+            if (register_fits(&target->registers[active.intervals[a]->reg], current)) {
+                victim = a;
+                break;
+            }
+        }
+
+        if (victim >= 0 && active.intervals[victim]->end > current->end) {
+            LiveInterval* spilled = active.intervals[victim];
+            current->reg = spilled->reg;
+            spilled->reg = -1;
+            active_remove(&active, victim);
+            active_insert(&active, current);
+        }
+    }
+
+    free(active.intervals);
+}
+
+// Spilled intervals get stack slots in a second scan so that slots can be
+// reused once the interval holding them has ended
+static void assign_spill_slots(RegAllocation* allocation) {
+    LiveInterval** holders = regalloc_alloc(sizeof(LiveInterval*) * (allocation->interval_count + 1));
+
+    for (int n = 0; n < allocation->interval_count; n++) {
+        LiveInterval* interval = &allocation->intervals[n];
+        if (interval->reg >= 0) {
+            allocation->used_registers |= 1u << interval->reg;
+            continue;
+        }
+
+        allocation->spill_count++;
+        if (interval->in_loop) allocation->loop_spill_count++;
+
+        int slot = -1;
+        for (int s = 0; s < allocation->spill_slot_count; s++) {
+            if (holders[s]->end <= interval->start) {
+                slot = s;
+                break;
+            }
+        }
+        if (slot < 0) slot = allocation->spill_slot_count++;
+        holders[slot] = interval;
+        interval->spill_slot = slot;
+    }
+
+    free(holders);
+}
+
+RegAllocation* regalloc_function(IrFunction* function, const RegAllocTarget* target) {
+    RegAllocation* allocation = regalloc_alloc(sizeof(RegAllocation));
+    allocation->function = function;
+    allocation->target = target;
+
+    ir_compute_dominators(function);
+
+    Liveness liveness;
+    liveness.function = function;
+    liveness.word_count = (function->next_value_id + 63) / 64;
+    liveness.block_count = 0;
+    while (liveness.block_count < function->block_count &&
+           function->blocks[liveness.block_count]->rpo_index >= 0) {
+        liveness.block_count++;
+    }
+    liveness.blocks = regalloc_alloc(sizeof(BlockLiveness) * (liveness.block_count + 1));
+    for (int b = 0; b < liveness.block_count; b++) {
+        liveness.blocks[b].live_in = regalloc_alloc(sizeof(uint64_t) * (liveness.word_count + 1));
+        liveness.blocks[b].live_out = regalloc_alloc(sizeof(uint64_t) * (liveness.word_count + 1));
+    }
+    liveness.positions = regalloc_alloc(sizeof(int) * (function->next_value_id + 1));
+
+    number_instructions(&liveness);
+    compute_liveness(&liveness);
+    build_intervals(allocation, &liveness);
+    linear_scan(allocation);
+    assign_spill_slots(allocation);
+
+    for (int b = 0; b < liveness.block_count; b++) {
+        free(liveness.blocks[b].live_in);
+        free(liveness.blocks[b].live_out);
+    }
+    free(liveness.blocks);
+    free(liveness.positions);
+    return allocation;
+}
+
+void regalloc_free(RegAllocation* allocation) {
+    if (allocation == NULL) return;
+    free(allocation->intervals);
+    free(allocation->value_intervals);
+    free(allocation);
+}
+
+LiveInterval* regalloc_interval(RegAllocation* allocation, IrInstr* value) {
+    if (value->id >= allocation->value_count) return NULL;
+    int index = allocation->value_intervals[value->id];
+    return index >= 0 ? &allocation->intervals[index] : NULL;
+}
+
+void regalloc_dump(RegAllocation* allocation, bool verbose, FILE* out) {
+    const RegAllocTarget* target = allocation->target;
+
+    int int_registers = 0;
+    int sse_registers = 0;
+    for (int r = 0; r < target->register_count; r++) {
+        if (!(allocation->used_registers & (1u << r))) continue;
+        if (target->registers[r].reg_class == REG_CLASS_SSE) {
+            sse_registers++;
+        } else {
+            int_registers++;
+        }
+    }
+
+    fprintf(out, "function %s: %d values, %d int and %d sse registers, %d spilled (%d in loops), %d spill slots",
+            allocation->function->name, allocation->interval_count, int_registers, sse_registers,
+            allocation->spill_count, allocation->loop_spill_count, allocation->spill_slot_count);
+
+    // Callee-saved registers cost a save and restore in the prologue
+    bool first = true;
+    for (int r = 0; r < target->register_count; r++) {
+        if (!(allocation->used_registers & (1u << r)) || !target->registers[r].callee_saved) continue;
+        fprintf(out, "%s%s", first ? ", saves " : " ", target->registers[r].name);
+        first = false;
+    }
+    fputs("\n", out);
+
+    if (!verbose) return;
+    for (int n = 0; n < allocation->interval_count; n++) {
+        LiveInterval* interval = &allocation->intervals[n];
+        fprintf(out, "    v%d [%d, %d] ", interval->value->id, interval->start, interval->end);
+        if (interval->reg >= 0) {
+            fputs(target->registers[interval->reg].name, out);
+        } else {
+            fprintf(out, "spill %d", interval->spill_slot);
+        }
+        if (interval->crosses_call) fputs(" ; across call", out);
+        fputs("\n", out);
+    }
+}
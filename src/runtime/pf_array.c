@@ -0,0 +1,146 @@
+#include "../../include/runtime/pf_array.h"
+#include "../../include/runtime/pf_output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define MIN_CAPACITY 8
+
+// Regions allocate in blocks of this many bytes, or one block for a larger
+// allocation, and keep up to REGION_SPARE_BLOCKS freed blocks per thread
+#define REGION_BLOCK_SIZE 16384
+#define REGION_SPARE_BLOCKS 8
+#define REGION_ALIGNMENT 16
+
+struct pf_region_block {
+    pf_region_block* next;
+    size_t used;
+    size_t size;
+    max_align_t data[];
+};
+
+static _Thread_local pf_region_block* spare_blocks;
+static _Thread_local int spare_block_count;
+
+_Noreturn void pf_index_error(int64_t index, int64_t length, int line) {
+    pf_output_flush();
+    fprintf(stderr, "[line %d] Error: index %" PRId64 " out of bounds for length %" PRId64 "\n",
+            line, index, length);
+    exit(1);
+}
+
+_Noreturn void pf_slice_error(int64_t start, int64_t end, int64_t length, int line) {
+    pf_output_flush();
+    fprintf(stderr, "[line %d] Error: slice [%" PRId64 ", %" PRId64 ") out of bounds for length %" PRId64 "\n",
+            line, start, end, length);
+    exit(1);
+}
+
+static void check_length(int64_t count, int line) {
+    if (count < 0) {
+        pf_output_flush();
+        fprintf(stderr, "[line %d] Error: negative length %" PRId64 "\n", line, count);
+        exit(1);
+    }
+}
+
+void* pf_array_allocate(int64_t count, size_t element_size, pf_gc_kind kind, int line) {
+    check_length(count, line);
+
+    // One spare element keeps empty arrays from sharing a null data pointer
+    if ((uint64_t)count >= UINT32_MAX / element_size) {
+        fprintf(stderr, "Error: out of memory allocating %" PRId64 " elements\n", count);
+        exit(1);
+    }
+    return pf_gc_allocate(((size_t)count + 1) * element_size, kind);
+}
+
+void pf_list_grow(void** data, int64_t length, int64_t* capacity, size_t element_size, pf_gc_kind kind,
+                  pf_region* region) {
+    int64_t grown = *capacity < MIN_CAPACITY ? MIN_CAPACITY : *capacity * 2;
+    void* memory = region != NULL ? pf_region_allocate(region, grown, element_size, 0)
+                                  : pf_array_allocate(grown, element_size, kind, 0);
+
+    // The old buffer stays where it is: slices of the list may still view it
+    memcpy(memory, *data, (size_t)length * element_size);
+    *data = memory;
+    *capacity = grown;
+    if (region == NULL) pf_gc_note_pointer(data);
+}
+
+static pf_region_block* new_region_block(size_t bytes) {
+    if (bytes <= REGION_BLOCK_SIZE && spare_blocks != NULL) {
+        pf_region_block* block = spare_blocks;
+        spare_blocks = block->next;
+        spare_block_count--;
+        block->used = 0;
+        return block;
+    }
+
+    size_t size = bytes > REGION_BLOCK_SIZE ? bytes : REGION_BLOCK_SIZE;
+    pf_region_block* block = malloc(sizeof(pf_region_block) + size);
+    if (block == NULL) {
+        fprintf(stderr, "Error: out of memory allocating a %zu byte region block\n", size);
+        exit(1);
+    }
+    block->used = 0;
+    block->size = size;
+    return block;
+}
+
+void* pf_region_allocate(pf_region* region, int64_t count, size_t element_size, int line) {
+    check_length(count, line);
+    // One spare element, as in pf_array_allocate
+    if ((uint64_t)count >= SIZE_MAX / element_size - REGION_ALIGNMENT) {
+        fprintf(stderr, "Error: out of memory allocating %" PRId64 " elements\n", count);
+        exit(1);
+    }
+    size_t bytes = ((size_t)count + 1) * element_size;
+    bytes = (bytes + REGION_ALIGNMENT - 1) & ~(size_t)(REGION_ALIGNMENT - 1);
+
+    pf_region_block* block = region->blocks;
+    if (block == NULL || block->size - block->used < bytes) {
+        block = new_region_block(bytes);
+        if (bytes > REGION_BLOCK_SIZE / 2 && region->blocks != NULL) {
+            // A large allocation fills its own block; the current one keeps going
+            block->next = region->blocks->next;
+            region->blocks->next = block;
+        } else {
+            block->next = region->blocks;
+            region->blocks = block;
+        }
+    }
+
+    void* memory = (unsigned char*)block->data + block->used;
+    block->used += bytes;
+    memset(memory, 0, bytes);
+    return memory;
+}
+
+void pf_region_free(pf_region* region) {
+    pf_region_block* block = region->blocks;
+    while (block != NULL) {
+        pf_region_block* next = block->next;
+        if (block->size == REGION_BLOCK_SIZE && spare_block_count < REGION_SPARE_BLOCKS) {
+            block->next = spare_blocks;
+            spare_blocks = block;
+            spare_block_count++;
+        } else {
+            free(block);
+        }
+        block = next;
+    }
+    region->blocks = NULL;
+}
+
+pf_list_str* pf_string_split_list(pf_string string, pf_string separator) {
+    // Counting first sizes the list exactly; the parts are slices, so the
+    // second pass allocates nothing
+    int64_t count = (int64_t)pf_string_split(string, separator, NULL, 0);
+    pf_list_str* list = pf_list_str_new(count, 0);
+    pf_string_split(string, separator, list->data, (size_t)count);
+    list->length = count;
+    return list;
+}
@@ -0,0 +1,621 @@
+// Channels: rings of stamped slots, owned and shared ends, and waiting
+#define _GNU_SOURCE
+#include "../../include/runtime/pf_chan.h"
+#include "../../include/runtime/pf_task.h"
+#include "../../include/runtime/pf_output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#endif
+
+// Ring size of unbounded channels, before values queue behind it
+#define UNBOUNDED_RING 256
+#define MIN_QUEUE 64
+// Cases of a select waited on without allocating
+#define LOCAL_WAITERS 8
+// An owned end is shared once waiters have fenced its owner this many
+// times, and more than once per this many of its operations
+#define OWNED_BARRIERS 64
+#define OPERATIONS_PER_BARRIER 16
+
+// Owners of an end other than a task or thread (pf_task_identity)
+#define UNCLAIMED ((const void*)0)
+#define SHARED ((const void*)1)
+#define REVOKING ((const void*)2)
+
+typedef enum {
+    DONE,
+    WOULD_BLOCK,
+    CLOSED,
+} Outcome;
+
+// A task or thread waiting on one end of a channel, on its own stack
+typedef struct Waiter {
+    struct Waiter* previous;
+    struct Waiter* next;
+    pf_parker* parker;
+    int index;                      // Token for the parker: the case it waits in
+    bool linked;
+} Waiter;
+
+typedef struct {
+    _Alignas(64) _Atomic uint64_t position;     // Lap and index of the next slot
+    _Atomic(const void*) owner;
+    _Atomic int busy;               // The owner is partway through an operation
+    _Atomic int waiting;            // Waiters in the list
+    _Atomic uint64_t operations;    // Counted by the owner
+    _Atomic uint64_t barriers;      // Times a waiter fenced the owner
+    Waiter* first;                  // Under the channel's lock
+    Waiter* last;
+} End;
+
+struct pf_chan {
+    End send;
+    End receive;                    // Waiters here wait for values, at send for room
+
+    _Alignas(64) char* slots;
+    size_t slot_bytes;              // A stamp, then the value
+    size_t element_size;
+    uint64_t capacity;
+    uint64_t one_lap;               // The power of two above capacity; lap numbers count in it
+    pf_gc_kind kind;
+    bool unbounded;
+    _Atomic bool closed;
+    pthread_mutex_t lock;
+
+    // Values sent to a full unbounded channel, oldest first, under lock
+    char* queue;
+    int64_t queue_head;
+    int64_t queue_capacity;
+    _Atomic int64_t queued;
+};
+
+static struct {
+    pthread_once_t once;
+    bool owners;                    // Whether ends may be owned at all
+    _Atomic uint64_t waits;
+    _Atomic uint64_t owned;
+    _Atomic uint64_t shared;
+} channels = {.once = PTHREAD_ONCE_INIT};
+
+static void* checked_allocate(size_t size) {
+    void* memory = malloc(size);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: out of memory allocating a %zu byte channel buffer\n", size);
+        exit(1);
+    }
+    return memory;
+}
+
+_Noreturn static void channel_error(const char* message, int line) {
+    pf_output_flush();
+    fprintf(stderr, "[line %d] Error: %s\n", line, message);
+    exit(1);
+}
+
+// ---------------------------------------------------------------------------
+// Ownership
+//
+// An owner brackets each operation with busy, and between the two checks
+// that it still owns the end, with no fence: a compiler barrier keeps the
+// check after the store. Whoever takes the end away sets REVOKING and runs
+// membarrier, a fence on every running thread of the process, so the owner
+// either already set busy, and is waited for, or sees REVOKING. The same
+// barrier stands in for the fence an owner skips before looking for
+// waiters to wake, when a waiter registers across from an owned end. That
+// makes waiting dear, so an end whose operations keep leaving the other
+// side waiting, as in a ping-pong, is shared after a while.
+
+static void start_channels(void) {
+    if (getenv("PFLANG_CHAN_SHARED") != NULL) return;
+#if defined(__linux__) && defined(SYS_membarrier)
+    long commands = syscall(SYS_membarrier, MEMBARRIER_CMD_QUERY, 0, 0);
+    if (commands >= 0 && (commands & MEMBARRIER_CMD_PRIVATE_EXPEDITED) &&
+        syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0) {
+        channels.owners = true;
+    }
+#endif
+}
+
+static void heavy_barrier(void) {
+#if defined(__linux__) && defined(SYS_membarrier)
+    syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+#endif
+}
+
+static void relax(int spins) {
+    if (spins % 64 == 63) {
+        sched_yield();
+    } else {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+// Take an end nobody has used yet for me
+static bool claim(End* end, const void* me) {
+    const void* expected = UNCLAIMED;
+    if (atomic_load_explicit(&end->owner, memory_order_relaxed) != UNCLAIMED) return false;
+    if (!atomic_compare_exchange_strong(&end->owner, &expected, me)) return false;
+    atomic_fetch_add_explicit(&channels.owned, 1, memory_order_relaxed);
+    return true;
+}
+
+// Share an end before using it with compare-and-swap; an owner partway
+// through an operation finishes it first
+static void share(pf_chan* chan, End* end) {
+    if (atomic_load_explicit(&end->owner, memory_order_acquire) == SHARED) return;
+    pthread_mutex_lock(&chan->lock);
+    const void* owner = atomic_load(&end->owner);
+    while (owner != SHARED && !atomic_compare_exchange_weak(&end->owner, &owner, REVOKING)) {
+    }
+    if (owner != SHARED) {
+        if (owner != UNCLAIMED) {
+            heavy_barrier();
+            for (int spins = 0; atomic_load_explicit(&end->busy, memory_order_acquire); spins++) {
+                relax(spins);
+            }
+            atomic_fetch_add_explicit(&channels.shared, 1, memory_order_relaxed);
+        }
+        atomic_store_explicit(&end->owner, SHARED, memory_order_release);
+    }
+    pthread_mutex_unlock(&chan->lock);
+}
+
+// Whether the calling thread may go ahead as the owner of end; it must
+// call leave afterwards
+static bool enter_owned(End* end, const void* me) {
+    if (atomic_load_explicit(&end->owner, memory_order_acquire) != me && !claim(end, me)) return false;
+    atomic_store_explicit(&end->busy, 1, memory_order_relaxed);
+    atomic_signal_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&end->owner, memory_order_relaxed) != me) {
+        atomic_store_explicit(&end->busy, 0, memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+static void leave_owned(End* end) {
+    atomic_store_explicit(&end->busy, 0, memory_order_release);
+}
+
+static void count_operation(End* end) {
+    uint64_t operations = atomic_load_explicit(&end->operations, memory_order_relaxed);
+    atomic_store_explicit(&end->operations, operations + 1, memory_order_relaxed);
+}
+
+// Before waiting across from end: whether the caller must fence its owner
+// with heavy_barrier, or nothing because it is shared, or shared now
+static bool fence_owner(pf_chan* chan, End* end) {
+    if (atomic_load(&end->owner) == SHARED) return false;
+    uint64_t barriers = atomic_fetch_add_explicit(&end->barriers, 1, memory_order_relaxed) + 1;
+    uint64_t operations = atomic_load_explicit(&end->operations, memory_order_relaxed);
+    if (barriers < OWNED_BARRIERS || barriers * OPERATIONS_PER_BARRIER < operations) return true;
+    // Revoking fences the owner too
+    share(chan, end);
+    return false;
+}
+
+// ---------------------------------------------------------------------------
+// The ring
+
+static inline _Atomic uint64_t* slot_stamp(pf_chan* chan, uint64_t position) {
+    return (_Atomic uint64_t*)(chan->slots + (position & (chan->one_lap - 1)) * chan->slot_bytes);
+}
+
+static inline void* slot_value(_Atomic uint64_t* stamp) {
+    return (char*)stamp + sizeof(uint64_t);
+}
+
+// The position after position: the next index, or index 0 of the next lap
+static inline uint64_t next_position(pf_chan* chan, uint64_t position) {
+    if ((position & (chan->one_lap - 1)) + 1 < chan->capacity) return position + 1;
+    return (position & ~(chan->one_lap - 1)) + chan->one_lap;
+}
+
+// A slot is free for the sender at position when its stamp is position,
+// and holds the value for the receiver at position when it is position + 1.
+// Anything else means the ring is full or empty, or another thread is
+// partway through the slot; either way it waits, and whoever finishes the
+// slot wakes it.
+static Outcome ring_push(pf_chan* chan, const void* value) {
+    End* end = &chan->send;
+    if (enter_owned(end, pf_task_identity())) {
+        uint64_t tail = atomic_load_explicit(&end->position, memory_order_relaxed);
+        _Atomic uint64_t* stamp = slot_stamp(chan, tail);
+        Outcome outcome = WOULD_BLOCK;
+        if (atomic_load_explicit(stamp, memory_order_acquire) == tail) {
+            memcpy(slot_value(stamp), value, chan->element_size);
+            atomic_store_explicit(stamp, tail + 1, memory_order_release);
+            atomic_store_explicit(&end->position, next_position(chan, tail), memory_order_relaxed);
+            count_operation(end);
+            outcome = DONE;
+        }
+        leave_owned(end);
+        return outcome;
+    }
+
+    share(chan, end);
+    uint64_t tail = atomic_load_explicit(&end->position, memory_order_relaxed);
+    for (;;) {
+        _Atomic uint64_t* stamp = slot_stamp(chan, tail);
+        uint64_t seen = atomic_load_explicit(stamp, memory_order_acquire);
+        if (seen == tail) {
+            if (atomic_compare_exchange_weak_explicit(&end->position, &tail, next_position(chan, tail),
+                                                      memory_order_seq_cst, memory_order_relaxed)) {
+                memcpy(slot_value(stamp), value, chan->element_size);
+                atomic_store_explicit(stamp, tail + 1, memory_order_release);
+                // Orders the stamp before notify's look for waiters
+                atomic_thread_fence(memory_order_seq_cst);
+                return DONE;
+            }
+        } else if (seen + chan->one_lap == tail + 1) {
+            // Still holds the value sent a lap ago
+            return WOULD_BLOCK;
+        } else {
+            tail = atomic_load_explicit(&end->position, memory_order_relaxed);
+        }
+    }
+}
+
+static Outcome ring_pop(pf_chan* chan, void* value) {
+    End* end = &chan->receive;
+    if (enter_owned(end, pf_task_identity())) {
+        uint64_t head = atomic_load_explicit(&end->position, memory_order_relaxed);
+        _Atomic uint64_t* stamp = slot_stamp(chan, head);
+        Outcome outcome = WOULD_BLOCK;
+        if (atomic_load_explicit(stamp, memory_order_acquire) == head + 1) {
+            memcpy(value, slot_value(stamp), chan->element_size);
+            atomic_store_explicit(stamp, head + chan->one_lap, memory_order_release);
+            atomic_store_explicit(&end->position, next_position(chan, head), memory_order_relaxed);
+            count_operation(end);
+            outcome = DONE;
+        }
+        leave_owned(end);
+        return outcome;
+    }
+
+    share(chan, end);
+    uint64_t head = atomic_load_explicit(&end->position, memory_order_relaxed);
+    for (;;) {
+        _Atomic uint64_t* stamp = slot_stamp(chan, head);
+        uint64_t seen = atomic_load_explicit(stamp, memory_order_acquire);
+        if (seen == head + 1) {
+            if (atomic_compare_exchange_weak_explicit(&end->position, &head, next_position(chan, head),
+                                                      memory_order_seq_cst, memory_order_relaxed)) {
+                memcpy(value, slot_value(stamp), chan->element_size);
+                atomic_store_explicit(stamp, head + chan->one_lap, memory_order_release);
+                atomic_thread_fence(memory_order_seq_cst);
+                return DONE;
+            }
+        } else if (seen == head) {
+            return WOULD_BLOCK;
+        } else {
+            head = atomic_load_explicit(&end->position, memory_order_relaxed);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Waiting
+
+// With the channel's lock held
+static void add_waiter(End* end, Waiter* waiter) {
+    waiter->next = NULL;
+    waiter->previous = end->last;
+    if (end->last != NULL) {
+        end->last->next = waiter;
+    } else {
+        end->first = waiter;
+    }
+    end->last = waiter;
+    waiter->linked = true;
+    atomic_fetch_add(&end->waiting, 1);
+}
+
+static void remove_waiter(End* end, Waiter* waiter) {
+    if (!waiter->linked) return;
+    if (waiter->previous != NULL) {
+        waiter->previous->next = waiter->next;
+    } else {
+        end->first = waiter->next;
+    }
+    if (waiter->next != NULL) {
+        waiter->next->previous = waiter->previous;
+    } else {
+        end->last = waiter->previous;
+    }
+    waiter->linked = false;
+    atomic_fetch_sub(&end->waiting, 1);
+}
+
+// Wake the first waiter that nothing else has woken yet. A select waits
+// at several ends and is woken only once; those who lose keep looking.
+static void wake_locked(End* end) {
+    while (end->first != NULL) {
+        Waiter* waiter = end->first;
+        remove_waiter(end, waiter);
+        if (pf_parker_unpark(waiter->parker, waiter->index)) return;
+    }
+}
+
+static void wake_all_locked(End* end) {
+    while (end->first != NULL) {
+        Waiter* waiter = end->first;
+        remove_waiter(end, waiter);
+        pf_parker_unpark(waiter->parker, waiter->index);
+    }
+}
+
+// After an operation that may let a waiter at end go ahead. A shared end
+// fenced after its operation; an owner relies on heavy_barrier in whoever
+// registered.
+static void notify(pf_chan* chan, End* end) {
+    if (atomic_load(&end->waiting) == 0) return;
+    pthread_mutex_lock(&chan->lock);
+    wake_locked(end);
+    pthread_mutex_unlock(&chan->lock);
+}
+
+// ---------------------------------------------------------------------------
+// Operations that do not wait
+
+// Queue a value behind the ring of an unbounded channel
+static Outcome queue_push(pf_chan* chan, const void* value) {
+    pthread_mutex_lock(&chan->lock);
+    if (atomic_load(&chan->closed)) {
+        pthread_mutex_unlock(&chan->lock);
+        return CLOSED;
+    }
+    int64_t queued = atomic_load(&chan->queued);
+    if (queued == chan->queue_capacity) {
+        int64_t capacity = chan->queue_capacity == 0 ? MIN_QUEUE : chan->queue_capacity * 2;
+        char* queue = checked_allocate((size_t)capacity * chan->element_size);
+        for (int64_t i = 0; i < queued; i++) {
+            int64_t from = (chan->queue_head + i) % chan->queue_capacity;
+            memcpy(queue + i * chan->element_size, chan->queue + from * chan->element_size, chan->element_size);
+        }
+        if (chan->kind == PF_GC_STRINGS) {
+            pf_gc_add_roots(queue, (size_t)capacity * chan->element_size);
+            if (chan->queue != NULL) pf_gc_remove_roots(chan->queue);
+        }
+        free(chan->queue);
+        chan->queue = queue;
+        chan->queue_head = 0;
+        chan->queue_capacity = capacity;
+    }
+    int64_t to = (chan->queue_head + queued) % chan->queue_capacity;
+    memcpy(chan->queue + to * chan->element_size, value, chan->element_size);
+    atomic_store(&chan->queued, queued + 1);
+    wake_locked(&chan->receive);
+    pthread_mutex_unlock(&chan->lock);
+    return DONE;
+}
+
+static bool queue_pop(pf_chan* chan, void* value) {
+    pthread_mutex_lock(&chan->lock);
+    int64_t queued = atomic_load(&chan->queued);
+    if (queued > 0) {
+        memcpy(value, chan->queue + chan->queue_head * chan->element_size, chan->element_size);
+        chan->queue_head = (chan->queue_head + 1) % chan->queue_capacity;
+        atomic_store(&chan->queued, queued - 1);
+    }
+    pthread_mutex_unlock(&chan->lock);
+    return queued > 0;
+}
+
+static Outcome try_send(pf_chan* chan, const void* value) {
+    if (atomic_load_explicit(&chan->closed, memory_order_acquire)) return CLOSED;
+    // Once values queue, later ones queue behind them to keep their order
+    if (chan->unbounded && atomic_load(&chan->queued) > 0) return queue_push(chan, value);
+
+    Outcome outcome = ring_push(chan, value);
+    if (outcome == DONE) {
+        notify(chan, &chan->receive);
+    } else if (chan->unbounded) {
+        outcome = queue_push(chan, value);
+    }
+    return outcome;
+}
+
+static Outcome try_receive(pf_chan* chan, void* value) {
+    if (ring_pop(chan, value) == DONE) {
+        notify(chan, &chan->send);
+        return DONE;
+    }
+    if (chan->unbounded && atomic_load(&chan->queued) > 0 && queue_pop(chan, value)) return DONE;
+    if (!atomic_load_explicit(&chan->closed, memory_order_acquire)) return WOULD_BLOCK;
+
+    // Values sent before the close are still delivered
+    if (ring_pop(chan, value) == DONE) return DONE;
+    if (chan->unbounded && queue_pop(chan, value)) return DONE;
+    memset(value, 0, chan->element_size);
+    return CLOSED;
+}
+
+// ---------------------------------------------------------------------------
+// Interface
+
+pf_chan* pf_chan_new(size_t element_size, int64_t capacity, pf_gc_kind kind, int line) {
+    if (capacity < 1 && capacity != PF_CHAN_UNBOUNDED) {
+        pf_output_flush();
+        fprintf(stderr, "[line %d] Error: channel capacity %" PRId64 " is not positive\n", line, capacity);
+        exit(1);
+    }
+    pthread_once(&channels.once, start_channels);
+
+    pf_chan* chan = aligned_alloc(_Alignof(pf_chan), sizeof(pf_chan));
+    if (chan == NULL) {
+        fprintf(stderr, "Error: out of memory allocating a channel\n");
+        exit(1);
+    }
+    memset(chan, 0, sizeof(pf_chan));
+    chan->unbounded = capacity == PF_CHAN_UNBOUNDED;
+    chan->capacity = chan->unbounded ? UNBOUNDED_RING : (uint64_t)capacity;
+    chan->one_lap = 1;
+    while (chan->one_lap <= chan->capacity) {
+        chan->one_lap <<= 1;
+    }
+    chan->element_size = element_size;
+    chan->slot_bytes = (sizeof(uint64_t) + element_size + 7) & ~(size_t)7;
+    chan->kind = kind;
+    chan->slots = checked_allocate(chan->capacity * chan->slot_bytes);
+    for (uint64_t i = 0; i < chan->capacity; i++) {
+        atomic_init(slot_stamp(chan, i), i);
+    }
+    // Values in flight are seen by the collector like those on a stack
+    if (kind == PF_GC_STRINGS) pf_gc_add_roots(chan->slots, chan->capacity * chan->slot_bytes);
+
+    const void* owner = channels.owners ? UNCLAIMED : SHARED;
+    atomic_init(&chan->send.owner, owner);
+    atomic_init(&chan->receive.owner, owner);
+    pthread_mutex_init(&chan->lock, NULL);
+    return chan;
+}
+
+static void check_channel(pf_chan* chan, int line) {
+    if (chan == NULL) channel_error("channel is null", line);
+}
+
+void pf_chan_send(pf_chan* chan, const void* value, int line) {
+    check_channel(chan, line);
+    Outcome outcome = try_send(chan, value);
+    if (outcome == WOULD_BLOCK) {
+        pf_chan_case single = {chan, true, (void*)value};
+        bool ok;
+        pf_chan_select(&single, 1, true, &ok, line);
+    } else if (outcome == CLOSED) {
+        channel_error("send on a closed channel", line);
+    }
+}
+
+bool pf_chan_recv(pf_chan* chan, void* value, int line) {
+    check_channel(chan, line);
+    Outcome outcome = try_receive(chan, value);
+    if (outcome == WOULD_BLOCK) {
+        pf_chan_case single = {chan, false, value};
+        bool ok;
+        pf_chan_select(&single, 1, true, &ok, line);
+        return ok;
+    }
+    return outcome == DONE;
+}
+
+void pf_chan_close(pf_chan* chan, int line) {
+    check_channel(chan, line);
+    pthread_mutex_lock(&chan->lock);
+    if (atomic_load(&chan->closed)) {
+        pthread_mutex_unlock(&chan->lock);
+        channel_error("close of a closed channel", line);
+    }
+    atomic_store(&chan->closed, true);
+    wake_all_locked(&chan->send);
+    wake_all_locked(&chan->receive);
+    pthread_mutex_unlock(&chan->lock);
+}
+
+static End* waiting_end(pf_chan_case* c) {
+    return c->send ? &c->chan->send : &c->chan->receive;
+}
+
+// The end whose operations let a waiter in c go ahead
+static End* other_end(pf_chan_case* c) {
+    return c->send ? &c->chan->receive : &c->chan->send;
+}
+
+// Try every case once, from start on
+static int attempt(pf_chan_case* cases, int count, int start, bool* ok, int line) {
+    for (int n = 0; n < count; n++) {
+        int i = (start + n) % count;
+        Outcome outcome = cases[i].send ? try_send(cases[i].chan, cases[i].value)
+                                        : try_receive(cases[i].chan, cases[i].value);
+        if (outcome == WOULD_BLOCK) continue;
+        if (outcome == CLOSED && cases[i].send) channel_error("send on a closed channel", line);
+        *ok = outcome == DONE;
+        return i;
+    }
+    return -1;
+}
+
+// A wake from the end of case woken that went unused: the value or room it
+// announced may still be there for another waiter
+static void pass_on(pf_chan_case* cases, int woken, int chosen) {
+    if (woken >= 0 && woken != chosen) notify(cases[woken].chan, waiting_end(&cases[woken]));
+}
+
+int pf_chan_select(pf_chan_case* cases, int count, bool blocking, bool* ok, int line) {
+    for (int i = 0; i < count; i++) {
+        check_channel(cases[i].chan, line);
+    }
+    static _Thread_local unsigned seed = 1;
+    seed = seed * 1103515245u + 12345u;
+    int start = count > 1 ? (int)((seed >> 16) % (unsigned)count) : 0;
+
+    Waiter local[LOCAL_WAITERS];
+    Waiter* waiters = NULL;
+    int woken = -1;
+    for (;;) {
+        int chosen = attempt(cases, count, start, ok, line);
+        if (chosen >= 0 || !blocking) {
+            pass_on(cases, woken, chosen);
+            if (waiters != local) free(waiters);
+            return chosen;
+        }
+        // Whatever woke this last is gone again
+        woken = -1;
+
+        if (waiters == NULL) waiters = count <= LOCAL_WAITERS ? local : checked_allocate(sizeof(Waiter) * count);
+        pf_parker parker;
+        pf_parker_prepare(&parker);
+        bool barrier = false;
+        for (int i = 0; i < count; i++) {
+            waiters[i].parker = &parker;
+            waiters[i].index = i;
+            pthread_mutex_lock(&cases[i].chan->lock);
+            add_waiter(waiting_end(&cases[i]), &waiters[i]);
+            pthread_mutex_unlock(&cases[i].chan->lock);
+            if (fence_owner(cases[i].chan, other_end(&cases[i]))) barrier = true;
+        }
+        if (barrier) {
+            heavy_barrier();
+        } else {
+            atomic_thread_fence(memory_order_seq_cst);
+        }
+
+        // Anything that happened before registering is seen here; anything
+        // after wakes the parker
+        chosen = attempt(cases, count, start, ok, line);
+        if (chosen < 0) {
+            atomic_fetch_add_explicit(&channels.waits, 1, memory_order_relaxed);
+            pf_parker_park(&parker);
+        }
+        for (int i = 0; i < count; i++) {
+            pthread_mutex_lock(&cases[i].chan->lock);
+            remove_waiter(waiting_end(&cases[i]), &waiters[i]);
+            pthread_mutex_unlock(&cases[i].chan->lock);
+        }
+        woken = pf_parker_token(&parker);
+        if (chosen >= 0) {
+            pass_on(cases, woken, chosen);
+            if (waiters != local) free(waiters);
+            return chosen;
+        }
+    }
+}
+
+void pf_chan_get_statistics(pf_chan_statistics* statistics) {
+    statistics->waits = atomic_load(&channels.waits);
+    statistics->owned = atomic_load(&channels.owned);
+    statistics->shared = atomic_load(&channels.shared);
+}
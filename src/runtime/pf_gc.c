@@ -0,0 +1,1299 @@
+// pthread_getattr_np, for the bounds of a thread's stack
+#define _GNU_SOURCE
+
+#include "../../include/runtime/pf_gc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#define DEFAULT_NURSERY_BYTES ((size_t)4 << 20)
+#define MIN_NURSERY_BYTES ((size_t)64 << 10)
+#define TLAB_BYTES ((size_t)32 << 10)
+#define PAGE_BYTES ((size_t)256 << 10)
+
+// The old generation is collected once it reaches twice its size after the
+// last collection, and never below this
+#define MIN_MAJOR_TRIGGER ((size_t)32 << 20)
+
+// Marking threads when PFLANG_GC_THREADS does not say, at most one per core
+#define DEFAULT_MARK_THREADS 8
+#define MAX_MARK_THREADS 64
+
+// Strings of an array marked per work item; longer arrays are split so
+// other threads can steal the rest
+#define MARK_CHUNK 1024
+
+// Header flags; marks live in side bitmaps so marking threads never write headers
+#define PINNED 1
+#define FORWARDED 2
+#define REMEMBERED 4
+#define FREE 8
+
+// Scanning stacks reads every word of other functions' frames
+#if defined(__GNUC__) || defined(__clang__)
+#define NO_SANITIZE __attribute__((no_sanitize_address))
+#define NO_INLINE __attribute__((noinline))
+#else
+#define NO_SANITIZE
+#define NO_INLINE
+#endif
+
+// Cell sizes of the old generation's pages, header included; anything
+// larger is a large object with a block of its own
+static const uint32_t cell_sizes[] = {
+    32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192,
+};
+#define SIZE_CLASSES (int)(sizeof(cell_sizes) / sizeof(cell_sizes[0]))
+#define MAX_CELL 8192
+#define PAGE_MARK_WORDS (PAGE_BYTES / 32 / 64)
+
+// A PAGE_BYTES-aligned page of equal cells; cells past used were never
+// handed out. After a major collection a page's dead cells only go on the
+// free list once allocation needs them.
+typedef struct Page {
+    struct Page* next;
+    struct Page* next_unswept;
+    char* cells;
+    uint32_t cell_size;
+    uint32_t cell_count;
+    uint32_t used;
+    int size_class;
+    bool swept;
+    _Atomic uint64_t marks[PAGE_MARK_WORDS];    // One bit per cell
+} Page;
+
+typedef struct {
+    char* start;
+    char* end;
+} Fragment;
+
+typedef struct {
+    const char* start;
+    size_t size;
+    bool strings;           // Holds only pf_string values, traced precisely
+} RootRange;
+
+typedef struct {
+    pf_gc_header** items;
+    size_t count;
+    size_t capacity;
+} ObjectStack;
+
+static struct {
+    bool initialized;
+    pthread_mutex_t lock;
+    size_t nursery_bytes;
+
+    // Free space of the nursery between pinned objects, handed out in order
+    Fragment* fragments;
+    int fragment_count;
+    int fragment_capacity;
+    int next_fragment;
+
+    Page* pages;
+    uintptr_t* page_table;          // Open-addressing set of page addresses
+    size_t page_table_capacity;
+    size_t page_count;
+    pf_gc_header* free_cells[SIZE_CLASSES];
+    Page* current_pages[SIZE_CLASSES];
+    Page* unswept[SIZE_CLASSES];
+    ObjectStack large;              // Sorted by address
+    _Atomic uint8_t* large_marks;   // Parallel to large while marking
+    _Atomic uint64_t* nursery_marks;    // One bit per granule
+
+    ObjectStack remembered;         // Old objects that may point into the nursery
+    ObjectStack pinned;
+    ObjectStack gray;
+    RootRange* roots;
+    int root_count;
+    int root_capacity;
+
+    size_t old_bytes;
+    size_t major_trigger;
+    pf_gc_statistics statistics;
+    struct timespec started;
+} heap = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+_Thread_local pf_gc_tlab pf_gc_local_tlab;
+char* pf_gc_nursery_start;
+char* pf_gc_nursery_end;
+uint8_t* pf_gc_object_starts;
+_Atomic int pf_gc_stop_requested;
+
+// A thread that allocates. While it is stopped, its stack from stack_low
+// up holds everything it refers to.
+typedef struct Mutator {
+    struct Mutator* next;
+    pf_gc_tlab* tlab;
+    char* stack_top;                // One past the highest address of the stack it runs on
+    char* stack_low;
+    bool stopped;
+} Mutator;
+
+// Collections run with every other mutator stopped at a safepoint or
+// inside pf_gc_blocking
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t stopped;         // A mutator stopped
+    pthread_cond_t resumed;         // The collection is over
+    Mutator* mutators;
+    int running;
+    bool stopping;
+    void (*walk_stacks)(void (*visit)(const void* low, const void* high));
+} world = {.lock = PTHREAD_MUTEX_INITIALIZER, .stopped = PTHREAD_COND_INITIALIZER,
+           .resumed = PTHREAD_COND_INITIALIZER};
+
+static _Thread_local Mutator* self;
+
+static void* checked_allocate(size_t size) {
+    void* memory = malloc(size);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: out of memory allocating %zu bytes\n", size);
+        exit(1);
+    }
+    return memory;
+}
+
+static void push(ObjectStack* stack, pf_gc_header* object) {
+    if (stack->count == stack->capacity) {
+        stack->capacity = stack->capacity == 0 ? 256 : stack->capacity * 2;
+        stack->items = realloc(stack->items, sizeof(pf_gc_header*) * stack->capacity);
+        if (stack->items == NULL) {
+            fprintf(stderr, "Error: out of memory growing the collector's work list\n");
+            exit(1);
+        }
+    }
+    stack->items[stack->count++] = object;
+}
+
+static size_t cell_bytes(size_t size) {
+    return (sizeof(pf_gc_header) + size + PF_GC_GRANULE - 1) & ~(size_t)(PF_GC_GRANULE - 1);
+}
+
+static double milliseconds_since(const struct timespec* start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) * 1e3 + (double)(now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+// ---------------------------------------------------------------------------
+// Setup
+
+static size_t configured_nursery_bytes(void) {
+    const char* text = getenv("PFLANG_GC_NURSERY");
+    if (text == NULL || text[0] == '\0') return DEFAULT_NURSERY_BYTES;
+    char* end;
+    unsigned long long bytes = strtoull(text, &end, 10);
+    if (*end == 'k' || *end == 'K') bytes <<= 10;
+    if (*end == 'm' || *end == 'M') bytes <<= 20;
+    if (bytes < MIN_NURSERY_BYTES) bytes = MIN_NURSERY_BYTES;
+    // Whole bytes of the start bitmap
+    return (size_t)bytes & ~(size_t)(PF_GC_GRANULE * 8 - 1);
+}
+
+static char* find_stack_top(void) {
+    char* top = NULL;
+    pthread_attr_t attributes;
+    if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+        void* address;
+        size_t size;
+        if (pthread_attr_getstack(&attributes, &address, &size) == 0) top = (char*)address + size;
+        pthread_attr_destroy(&attributes);
+    }
+    // Without it, scan from here up: only frames of callers of this one
+    return top != NULL ? top : __builtin_frame_address(0);
+}
+
+// Add the calling thread to the mutators, waiting out a collection in
+// progress since it is not stopped
+static void register_thread(void) {
+    Mutator* mutator = checked_allocate(sizeof(Mutator));
+    mutator->tlab = &pf_gc_local_tlab;
+    mutator->stack_top = find_stack_top();
+    mutator->stack_low = NULL;
+    mutator->stopped = false;
+    pthread_mutex_lock(&world.lock);
+    while (world.stopping) {
+        pthread_cond_wait(&world.resumed, &world.lock);
+    }
+    mutator->next = world.mutators;
+    world.mutators = mutator;
+    world.running++;
+    pthread_mutex_unlock(&world.lock);
+    self = mutator;
+}
+
+void pf_gc_init(void) {
+    pthread_mutex_lock(&heap.lock);
+    if (!heap.initialized) {
+        heap.nursery_bytes = configured_nursery_bytes();
+        pf_gc_nursery_start = aligned_alloc(PAGE_BYTES, heap.nursery_bytes);
+        pf_gc_object_starts = calloc(heap.nursery_bytes / PF_GC_GRANULE / 8, 1);
+        heap.nursery_marks = calloc(heap.nursery_bytes / PF_GC_GRANULE / 64 + 1, sizeof(uint64_t));
+        if (pf_gc_nursery_start == NULL || pf_gc_object_starts == NULL || heap.nursery_marks == NULL) {
+            fprintf(stderr, "Error: out of memory allocating a %zu byte nursery\n", heap.nursery_bytes);
+            exit(1);
+        }
+        pf_gc_nursery_end = pf_gc_nursery_start + heap.nursery_bytes;
+
+        heap.fragment_capacity = 16;
+        heap.fragments = checked_allocate(sizeof(Fragment) * heap.fragment_capacity);
+        heap.fragments[0] = (Fragment){pf_gc_nursery_start, pf_gc_nursery_end};
+        heap.fragment_count = 1;
+        heap.next_fragment = 0;
+        heap.major_trigger = MIN_MAJOR_TRIGGER;
+        clock_gettime(CLOCK_MONOTONIC, &heap.started);
+        heap.initialized = true;
+    }
+    pthread_mutex_unlock(&heap.lock);
+    if (self == NULL) register_thread();
+}
+
+const void* pf_gc_set_stack_top(const void* top) {
+    if (self == NULL) pf_gc_init();
+    const void* previous = self->stack_top;
+    self->stack_top = (char*)top;
+    return previous;
+}
+
+void pf_gc_set_stack_walker(void (*walk)(void (*visit)(const void* low, const void* high))) {
+    pthread_mutex_lock(&world.lock);
+    world.walk_stacks = walk;
+    pthread_mutex_unlock(&world.lock);
+}
+
+// ---------------------------------------------------------------------------
+// Old generation
+
+static size_t page_slot(uintptr_t page, size_t capacity) {
+    return (size_t)((page / PAGE_BYTES) * 0x9E3779B97F4A7C15ull) & (capacity - 1);
+}
+
+static void insert_page_address(uintptr_t page) {
+    size_t slot = page_slot(page, heap.page_table_capacity);
+    while (heap.page_table[slot] != 0) {
+        slot = (slot + 1) & (heap.page_table_capacity - 1);
+    }
+    heap.page_table[slot] = page;
+}
+
+static void add_page(Page* page) {
+    if ((heap.page_count + 1) * 2 > heap.page_table_capacity) {
+        uintptr_t* old = heap.page_table;
+        size_t old_capacity = heap.page_table_capacity;
+        heap.page_table_capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+        heap.page_table = calloc(heap.page_table_capacity, sizeof(uintptr_t));
+        if (heap.page_table == NULL) {
+            fprintf(stderr, "Error: out of memory growing the page table\n");
+            exit(1);
+        }
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i] != 0) insert_page_address(old[i]);
+        }
+        free(old);
+    }
+    insert_page_address((uintptr_t)page);
+    heap.page_count++;
+}
+
+static Page* find_page(const void* address) {
+    if (heap.page_table_capacity == 0) return NULL;
+    uintptr_t page = (uintptr_t)address & ~(uintptr_t)(PAGE_BYTES - 1);
+    size_t slot = page_slot(page, heap.page_table_capacity);
+    while (heap.page_table[slot] != 0) {
+        if (heap.page_table[slot] == page) return (Page*)page;
+        slot = (slot + 1) & (heap.page_table_capacity - 1);
+    }
+    return NULL;
+}
+
+static Page* new_page(int size_class) {
+    Page* page = aligned_alloc(PAGE_BYTES, PAGE_BYTES);
+    if (page == NULL) {
+        fprintf(stderr, "Error: out of memory allocating a heap page\n");
+        exit(1);
+    }
+    size_t offset = (sizeof(Page) + PF_GC_GRANULE - 1) & ~(size_t)(PF_GC_GRANULE - 1);
+    page->cells = (char*)page + offset;
+    page->cell_size = cell_sizes[size_class];
+    page->cell_count = (uint32_t)((PAGE_BYTES - offset) / page->cell_size);
+    page->used = 0;
+    page->size_class = size_class;
+    page->swept = true;
+    page->next_unswept = NULL;
+    memset(page->marks, 0, sizeof(page->marks));
+    page->next = heap.pages;
+    heap.pages = page;
+    heap.current_pages[size_class] = page;
+    add_page(page);
+    return page;
+}
+
+// Index in heap.large of the last object starting at or before address, or -1
+static ptrdiff_t large_index(const void* address) {
+    ptrdiff_t low = 0;
+    ptrdiff_t high = (ptrdiff_t)heap.large.count - 1;
+    ptrdiff_t found = -1;
+    while (low <= high) {
+        ptrdiff_t middle = (low + high) / 2;
+        if ((const void*)heap.large.items[middle] <= address) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found;
+}
+
+// Put the cells of page the last major collection left unmarked on the
+// free list of its size class
+static void sweep_page(Page* page) {
+    pf_gc_header** free_cells = &heap.free_cells[page->size_class];
+    for (uint32_t i = 0; i < page->used; i++) {
+        if (atomic_load_explicit(&page->marks[i / 64], memory_order_relaxed) & ((uint64_t)1 << (i % 64))) continue;
+        pf_gc_header* object = (pf_gc_header*)(page->cells + (size_t)i * page->cell_size);
+        object->flags = FREE;
+        object->forward = *free_cells;
+        *free_cells = object;
+    }
+    memset(page->marks, 0, sizeof(page->marks));
+    page->swept = true;
+}
+
+static void finish_sweeping(void) {
+    for (int c = 0; c < SIZE_CLASSES; c++) {
+        for (Page* page = heap.unswept[c]; page != NULL; page = page->next_unswept) {
+            if (!page->swept) sweep_page(page);
+        }
+        heap.unswept[c] = NULL;
+    }
+}
+
+// Header of a cell or large block for size payload bytes; its contents are
+// the caller's to set
+static pf_gc_header* allocate_old_cell(size_t size) {
+    size_t cell = cell_bytes(size);
+    if (cell > MAX_CELL) {
+        if (size > SIZE_MAX - sizeof(pf_gc_header)) {
+            fprintf(stderr, "Error: out of memory allocating %zu bytes\n", size);
+            exit(1);
+        }
+        pf_gc_header* object = checked_allocate(sizeof(pf_gc_header) + size);
+        // Keep the blocks sorted for lookups by address
+        size_t position = (size_t)(large_index(object) + 1);
+        push(&heap.large, object);
+        memmove(heap.large.items + position + 1, heap.large.items + position,
+                sizeof(pf_gc_header*) * (heap.large.count - 1 - position));
+        heap.large.items[position] = object;
+        heap.old_bytes += sizeof(pf_gc_header) + size;
+        return object;
+    }
+
+    int size_class = 0;
+    while (cell_sizes[size_class] < cell) size_class++;
+    // Sweep pages until one yields a cell; once none is left unswept, the
+    // current page has been swept too and fresh cells can be carved from it
+    while (heap.free_cells[size_class] == NULL && heap.unswept[size_class] != NULL) {
+        Page* page = heap.unswept[size_class];
+        heap.unswept[size_class] = page->next_unswept;
+        if (!page->swept) sweep_page(page);
+    }
+    pf_gc_header* object = heap.free_cells[size_class];
+    if (object != NULL) {
+        heap.free_cells[size_class] = object->forward;
+    } else {
+        Page* page = heap.current_pages[size_class];
+        if (page == NULL || page->used == page->cell_count) page = new_page(size_class);
+        object = (pf_gc_header*)(page->cells + (size_t)page->used++ * page->cell_size);
+    }
+    heap.old_bytes += cell_sizes[size_class];
+    return object;
+}
+
+static void* allocate_old(size_t size, pf_gc_kind kind) {
+    pf_gc_header* object = allocate_old_cell(size);
+    object->size = (uint32_t)size;
+    object->kind = (uint8_t)kind;
+    object->flags = 0;
+    object->reserved = 0;
+    object->forward = NULL;
+    memset(object + 1, 0, size);
+    heap.statistics.bytes_allocated += size;
+    return object + 1;
+}
+
+// The old object address points into, or NULL
+static pf_gc_header* old_object(const void* address) {
+    Page* page = find_page(address);
+    if (page != NULL) {
+        if ((const char*)address < page->cells) return NULL;
+        size_t index = (size_t)((const char*)address - page->cells) / page->cell_size;
+        if (index >= page->used) return NULL;
+        pf_gc_header* object = (pf_gc_header*)(page->cells + index * page->cell_size);
+        return (object->flags & FREE) ? NULL : object;
+    }
+
+    ptrdiff_t index = large_index(address);
+    if (index < 0) return NULL;
+    pf_gc_header* object = heap.large.items[index];
+    return (const char*)address < (const char*)(object + 1) + object->size ? object : NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Nursery
+
+// The nursery object address points into, found by walking the start
+// bitmap back from it, or NULL
+static pf_gc_header* nursery_object(const void* address) {
+    size_t granule = (size_t)((const char*)address - pf_gc_nursery_start) / PF_GC_GRANULE;
+    size_t lowest = granule > MAX_CELL / PF_GC_GRANULE ? granule - MAX_CELL / PF_GC_GRANULE : 0;
+    for (size_t g = granule + 1; g-- > lowest;) {
+        uint8_t bits = pf_gc_object_starts[g / 8];
+        if (bits == 0) {
+            // Skip the rest of an empty byte in one step
+            g -= g % 8;
+            continue;
+        }
+        if (bits & (1u << (g % 8))) {
+            pf_gc_header* object = (pf_gc_header*)(pf_gc_nursery_start + g * PF_GC_GRANULE);
+            return (const char*)address < (const char*)object + cell_bytes(object->size) ? object : NULL;
+        }
+    }
+    return NULL;
+}
+
+static void retire_tlab(pf_gc_tlab* tlab) {
+    heap.statistics.bytes_allocated -= (size_t)(tlab->end - tlab->top);
+    tlab->top = NULL;
+    tlab->end = NULL;
+}
+
+// Give the calling thread a fresh TLAB with room for cell bytes
+static bool refill_tlab(size_t cell) {
+    while (heap.next_fragment < heap.fragment_count) {
+        Fragment* fragment = &heap.fragments[heap.next_fragment];
+        size_t available = (size_t)(fragment->end - fragment->start);
+        if (available < cell) {
+            heap.next_fragment++;
+            continue;
+        }
+        size_t size = available < TLAB_BYTES ? available : TLAB_BYTES;
+        if (size < cell) size = cell;
+        pf_gc_tlab* tlab = &pf_gc_local_tlab;
+        tlab->top = fragment->start;
+        tlab->end = fragment->start + size;
+        fragment->start += size;
+        memset(tlab->top, 0, size);
+        heap.statistics.bytes_allocated += size;
+        return true;
+    }
+    return false;
+}
+
+static void add_fragment(char* start, char* end) {
+    if (end - start < (ptrdiff_t)cell_bytes(0)) return;
+    if (heap.fragment_count == heap.fragment_capacity) {
+        heap.fragment_capacity *= 2;
+        heap.fragments = realloc(heap.fragments, sizeof(Fragment) * heap.fragment_capacity);
+        if (heap.fragments == NULL) {
+            fprintf(stderr, "Error: out of memory growing the nursery's free list\n");
+            exit(1);
+        }
+    }
+    heap.fragments[heap.fragment_count++] = (Fragment){start, end};
+}
+
+// ---------------------------------------------------------------------------
+// Roots
+
+NO_SANITIZE static void scan_range(const char* start, const char* end, void (*visit)(const void*)) {
+    uintptr_t first = ((uintptr_t)start + sizeof(void*) - 1) & ~(uintptr_t)(sizeof(void*) - 1);
+    for (const char* word = (const char*)first; word + sizeof(void*) <= end; word += sizeof(void*)) {
+        visit(*(void* const*)word);
+    }
+}
+
+static void (*stack_visit)(const void*);
+
+static void scan_stack(const void* low, const void* high) {
+    scan_range(low, high, stack_visit);
+}
+
+// Every word of the stacks and the registered ranges, with the registers
+// spilled first so references held only in them are seen too. Stopped
+// threads spilled theirs into the frame that stopped them.
+NO_INLINE NO_SANITIZE static void scan_roots(void (*visit)(const void*)) {
+    jmp_buf registers;
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_unwind_init();
+#endif
+    setjmp(registers);
+    scan_range((const char*)&registers, (const char*)&registers + sizeof(registers), visit);
+    volatile char here = 0;
+    scan_range((const char*)&here, self->stack_top, visit);
+    for (Mutator* mutator = world.mutators; mutator != NULL; mutator = mutator->next) {
+        if (mutator != self) scan_range(mutator->stack_low, mutator->stack_top, visit);
+    }
+    if (world.walk_stacks != NULL) {
+        stack_visit = visit;
+        world.walk_stacks(scan_stack);
+    }
+    for (int i = 0; i < heap.root_count; i++) {
+        if (!heap.roots[i].strings) {
+            scan_range(heap.roots[i].start, heap.roots[i].start + heap.roots[i].size, visit);
+        }
+    }
+}
+
+// The byte pointer of every long string in the ranges of strings
+static void visit_string_roots(void (*visit)(void* slot)) {
+    for (int i = 0; i < heap.root_count; i++) {
+        if (!heap.roots[i].strings) continue;
+        pf_string* strings = (pf_string*)heap.roots[i].start;
+        size_t count = heap.roots[i].size / sizeof(pf_string);
+        for (size_t j = 0; j < count; j++) {
+            if (!pf_string_is_inline(&strings[j])) visit(&strings[j].as.data);
+        }
+    }
+}
+
+static void add_root_range(const void* start, size_t size, bool strings) {
+    pthread_mutex_lock(&heap.lock);
+    if (heap.root_count == heap.root_capacity) {
+        heap.root_capacity = heap.root_capacity == 0 ? 16 : heap.root_capacity * 2;
+        heap.roots = realloc(heap.roots, sizeof(RootRange) * heap.root_capacity);
+        if (heap.roots == NULL) {
+            fprintf(stderr, "Error: out of memory registering collector roots\n");
+            exit(1);
+        }
+    }
+    heap.roots[heap.root_count++] = (RootRange){start, size, strings};
+    pthread_mutex_unlock(&heap.lock);
+}
+
+void pf_gc_add_roots(const void* start, size_t size) {
+    add_root_range(start, size, false);
+}
+
+void pf_gc_add_string_roots(const pf_string* strings, size_t count) {
+    add_root_range(strings, count * sizeof(pf_string), true);
+}
+
+void pf_gc_remove_roots(const void* start) {
+    pthread_mutex_lock(&heap.lock);
+    for (int i = 0; i < heap.root_count; i++) {
+        if (heap.roots[i].start == start) {
+            heap.roots[i] = heap.roots[--heap.root_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&heap.lock);
+}
+
+void pf_gc_remember(const void* slot) {
+    pthread_mutex_lock(&heap.lock);
+    pf_gc_header* object = old_object(slot);
+    if (object != NULL && !(object->flags & REMEMBERED)) {
+        object->flags |= REMEMBERED;
+        push(&heap.remembered, object);
+    }
+    pthread_mutex_unlock(&heap.lock);
+}
+
+// ---------------------------------------------------------------------------
+// Minor collection
+
+static void pin(const void* word) {
+    if (!pf_gc_is_young(word)) return;
+    pf_gc_header* object = nursery_object(word);
+    if (object == NULL || (object->flags & PINNED)) return;
+    object->flags |= PINNED;
+    push(&heap.pinned, object);
+}
+
+// Promote the nursery object the pointer at slot refers to, unless it is
+// pinned, and redirect the pointer to the copy. Returns true if the
+// pointer still refers to the nursery afterwards.
+static bool trace_slot(void* slot) {
+    char* pointer;
+    memcpy(&pointer, slot, sizeof(pointer));
+    if (!pf_gc_is_young(pointer)) return false;
+    pf_gc_header* object = nursery_object(pointer);
+    if (object == NULL) return false;
+    if (object->flags & PINNED) return true;
+
+    if (!(object->flags & FORWARDED)) {
+        pf_gc_header* copy = allocate_old_cell(object->size);
+        memcpy(copy, object, sizeof(pf_gc_header) + object->size);
+        copy->flags = 0;
+        copy->forward = NULL;
+        object->forward = copy;
+        object->flags |= FORWARDED;
+        heap.statistics.bytes_promoted += object->size;
+        push(&heap.gray, copy);
+    }
+    pointer = (char*)object->forward + (pointer - (char*)object);
+    memcpy(slot, &pointer, sizeof(pointer));
+    return false;
+}
+
+static void trace_root_slot(void* slot) {
+    trace_slot(slot);
+}
+
+// Trace the references object holds; true if one still points into the nursery
+static bool trace_object(pf_gc_header* object) {
+    bool young = false;
+    if (object->kind == PF_GC_STRINGS) {
+        pf_string* strings = (pf_string*)(object + 1);
+        size_t count = object->size / sizeof(pf_string);
+        for (size_t i = 0; i < count; i++) {
+            if (!pf_string_is_inline(&strings[i])) young |= trace_slot(&strings[i].as.data);
+        }
+    } else if (object->kind == PF_GC_LIST) {
+        young = trace_slot(object + 1);
+    }
+    return young;
+}
+
+static void remember_object(pf_gc_header* object) {
+    if (!(object->flags & REMEMBERED)) {
+        object->flags |= REMEMBERED;
+        push(&heap.remembered, object);
+    }
+}
+
+static int compare_addresses(const void* a, const void* b) {
+    uintptr_t left = (uintptr_t)*(pf_gc_header* const*)a;
+    uintptr_t right = (uintptr_t)*(pf_gc_header* const*)b;
+    return left < right ? -1 : left > right;
+}
+
+static void minor_collection(void) {
+    // Nothing referenced from a stack may move, so pin before copying anything
+    scan_roots(pin);
+
+    for (size_t i = 0; i < heap.pinned.count; i++) {
+        trace_object(heap.pinned.items[i]);
+    }
+    // Strings outside the heap that are known to be strings move like any
+    // other reference; their ranges are scanned again every collection, so
+    // they need no remembered set
+    visit_string_roots(trace_root_slot);
+    ObjectStack remembered = heap.remembered;
+    heap.remembered = (ObjectStack){NULL, 0, 0};
+    for (size_t i = 0; i < remembered.count; i++) {
+        pf_gc_header* object = remembered.items[i];
+        object->flags &= ~REMEMBERED;
+        if (trace_object(object)) remember_object(object);
+    }
+    free(remembered.items);
+    // Promoted objects pointing at pinned ones are old objects pointing into the nursery
+    while (heap.gray.count > 0) {
+        pf_gc_header* object = heap.gray.items[--heap.gray.count];
+        if (trace_object(object)) remember_object(object);
+    }
+
+    // The nursery is free again around the pinned objects, which stay young
+    memset(pf_gc_object_starts, 0, heap.nursery_bytes / PF_GC_GRANULE / 8);
+    qsort(heap.pinned.items, heap.pinned.count, sizeof(pf_gc_header*), compare_addresses);
+    heap.fragment_count = 0;
+    heap.next_fragment = 0;
+    char* free_start = pf_gc_nursery_start;
+    for (size_t i = 0; i < heap.pinned.count; i++) {
+        pf_gc_header* object = heap.pinned.items[i];
+        add_fragment(free_start, (char*)object);
+        size_t granule = (size_t)((char*)object - pf_gc_nursery_start) / PF_GC_GRANULE;
+        pf_gc_object_starts[granule / 8] |= (uint8_t)(1u << (granule % 8));
+        object->flags &= ~PINNED;
+        free_start = (char*)object + cell_bytes(object->size);
+    }
+    add_fragment(free_start, pf_gc_nursery_end);
+    heap.pinned.count = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Major collection
+//
+// Marking runs on a pool of threads, each with a work-stealing deque in
+// the style of Chase and Lev: its owner pushes and takes at the bottom
+// without locks, and threads out of work steal from the top. Marks are set
+// with an atomic or in side bitmaps, so an object two threads reach at
+// once is traced by one of them. Work items are object headers, or a
+// string element with the low bit set, standing for the next MARK_CHUNK
+// strings of a large array.
+
+typedef struct {
+    int64_t capacity;               // Power of two
+    _Atomic uintptr_t slots[];
+} DequeBuffer;
+
+typedef struct {
+    _Alignas(64) _Atomic int64_t top;
+    _Atomic int64_t bottom;
+    _Atomic(DequeBuffer*) buffer;
+    DequeBuffer** retired;          // Outgrown buffers thieves may still read; freed after marking
+    int retired_count;
+    int retired_capacity;
+    size_t live_bytes;              // Old generation bytes this thread marked
+    unsigned seed;
+} Marker;
+
+static struct {
+    Marker* markers;                // markers[0] is the collecting thread's
+    int count;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    uint64_t epoch;                 // Bumped to start a round of marking
+    int finished;
+    _Atomic int idle;
+} pool = {.lock = PTHREAD_MUTEX_INITIALIZER, .start = PTHREAD_COND_INITIALIZER, .done = PTHREAD_COND_INITIALIZER};
+
+static DequeBuffer* new_deque_buffer(int64_t capacity) {
+    DequeBuffer* buffer = checked_allocate(sizeof(DequeBuffer) + sizeof(_Atomic uintptr_t) * (size_t)capacity);
+    buffer->capacity = capacity;
+    return buffer;
+}
+
+static void deque_push(Marker* marker, uintptr_t item) {
+    int64_t bottom = atomic_load_explicit(&marker->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&marker->top, memory_order_acquire);
+    DequeBuffer* buffer = atomic_load_explicit(&marker->buffer, memory_order_relaxed);
+    if (bottom - top > buffer->capacity - 1) {
+        DequeBuffer* grown = new_deque_buffer(buffer->capacity * 2);
+        for (int64_t i = top; i < bottom; i++) {
+            uintptr_t moved = atomic_load_explicit(&buffer->slots[i & (buffer->capacity - 1)], memory_order_relaxed);
+            atomic_store_explicit(&grown->slots[i & (grown->capacity - 1)], moved, memory_order_relaxed);
+        }
+        if (marker->retired_count == marker->retired_capacity) {
+            marker->retired_capacity = marker->retired_capacity == 0 ? 8 : marker->retired_capacity * 2;
+            marker->retired = realloc(marker->retired, sizeof(DequeBuffer*) * marker->retired_capacity);
+            if (marker->retired == NULL) {
+                fprintf(stderr, "Error: out of memory growing the collector's mark stack\n");
+                exit(1);
+            }
+        }
+        marker->retired[marker->retired_count++] = buffer;
+        atomic_store_explicit(&marker->buffer, grown, memory_order_release);
+        buffer = grown;
+    }
+    atomic_store_explicit(&buffer->slots[bottom & (buffer->capacity - 1)], item, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&marker->bottom, bottom + 1, memory_order_relaxed);
+}
+
+// The newest item of the owner's deque, or 0
+static uintptr_t deque_take(Marker* marker) {
+    int64_t bottom = atomic_load_explicit(&marker->bottom, memory_order_relaxed) - 1;
+    DequeBuffer* buffer = atomic_load_explicit(&marker->buffer, memory_order_relaxed);
+    atomic_store_explicit(&marker->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&marker->top, memory_order_relaxed);
+
+    uintptr_t item = 0;
+    if (top <= bottom) {
+        item = atomic_load_explicit(&buffer->slots[bottom & (buffer->capacity - 1)], memory_order_relaxed);
+        if (top == bottom) {
+            // The last item: race thieves for it
+            if (!atomic_compare_exchange_strong_explicit(&marker->top, &top, top + 1, memory_order_seq_cst,
+                                                         memory_order_relaxed)) {
+                item = 0;
+            }
+            atomic_store_explicit(&marker->bottom, bottom + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&marker->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return item;
+}
+
+// The oldest item of victim's deque, or 0 if it is empty or another thread
+// took it first
+static uintptr_t deque_steal(Marker* victim) {
+    int64_t top = atomic_load_explicit(&victim->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&victim->bottom, memory_order_acquire);
+    if (top >= bottom) return 0;
+
+    DequeBuffer* buffer = atomic_load_explicit(&victim->buffer, memory_order_acquire);
+    uintptr_t item = atomic_load_explicit(&buffer->slots[top & (buffer->capacity - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&victim->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return 0;
+    }
+    return item;
+}
+
+// Set bit of word; true if this call set it
+static bool set_mark(_Atomic uint64_t* word, unsigned bit) {
+    uint64_t mask = (uint64_t)1 << bit;
+    if (atomic_load_explicit(word, memory_order_relaxed) & mask) return false;
+    return !(atomic_fetch_or_explicit(word, mask, memory_order_relaxed) & mask);
+}
+
+// Mark the object address points into, if any, and queue it for tracing
+// when this thread is the one that marked it
+static void mark(Marker* marker, const void* address) {
+    pf_gc_header* object;
+    if (pf_gc_is_young(address)) {
+        object = nursery_object(address);
+        if (object == NULL) return;
+        size_t granule = (size_t)((char*)object - pf_gc_nursery_start) / PF_GC_GRANULE;
+        if (!set_mark(&heap.nursery_marks[granule / 64], granule % 64)) return;
+    } else {
+        Page* page = find_page(address);
+        if (page != NULL) {
+            if ((const char*)address < page->cells) return;
+            size_t index = (size_t)((const char*)address - page->cells) / page->cell_size;
+            if (index >= page->used) return;
+            object = (pf_gc_header*)(page->cells + index * page->cell_size);
+            if ((object->flags & FREE) || !set_mark(&page->marks[index / 64], index % 64)) return;
+            marker->live_bytes += page->cell_size;
+        } else {
+            ptrdiff_t index = large_index(address);
+            if (index < 0) return;
+            object = heap.large.items[index];
+            if ((const char*)address >= (const char*)(object + 1) + object->size) return;
+            if (atomic_exchange_explicit(&heap.large_marks[index], 1, memory_order_relaxed) != 0) return;
+            marker->live_bytes += sizeof(pf_gc_header) + object->size;
+        }
+    }
+    if (object->kind != PF_GC_BYTES) deque_push(marker, (uintptr_t)object);
+}
+
+static void mark_root(const void* word) {
+    mark(&pool.markers[0], word);
+}
+
+static void mark_root_slot(void* slot) {
+    mark_root(*(void* const*)slot);
+}
+
+// Mark the strings of object from from on, leaving all but the first
+// MARK_CHUNK of them as a work item others can steal
+static void mark_strings(Marker* marker, pf_gc_header* object, const pf_string* from) {
+    const pf_string* end = (const pf_string*)(object + 1) + object->size / sizeof(pf_string);
+    if (end - from > MARK_CHUNK) {
+        deque_push(marker, (uintptr_t)(from + MARK_CHUNK) | 1);
+        end = from + MARK_CHUNK;
+    }
+    for (const pf_string* string = from; string < end; string++) {
+        if (!pf_string_is_inline(string)) mark(marker, string->as.data);
+    }
+}
+
+static void trace_item(Marker* marker, uintptr_t item) {
+    if (item & 1) {
+        // Only old arrays are long enough to be split
+        const pf_string* from = (const pf_string*)(item & ~(uintptr_t)1);
+        mark_strings(marker, old_object(from), from);
+        return;
+    }
+    pf_gc_header* object = (pf_gc_header*)item;
+    if (object->kind == PF_GC_STRINGS) {
+        mark_strings(marker, object, (const pf_string*)(object + 1));
+    } else if (object->kind == PF_GC_LIST) {
+        void* buffer;
+        memcpy(&buffer, object + 1, sizeof(buffer));
+        mark(marker, buffer);
+    }
+}
+
+static bool any_work(void) {
+    for (int i = 0; i < pool.count; i++) {
+        Marker* marker = &pool.markers[i];
+        if (atomic_load(&marker->bottom) - atomic_load(&marker->top) > 0) return true;
+    }
+    return false;
+}
+
+static uintptr_t steal_work(Marker* marker) {
+    if (pool.count < 2) return 0;
+    marker->seed = marker->seed * 1103515245u + 12345u;
+    int first = (int)((marker->seed >> 16) % (unsigned)pool.count);
+    for (int i = 0; i < pool.count; i++) {
+        Marker* victim = &pool.markers[(first + i) % pool.count];
+        if (victim == marker) continue;
+        uintptr_t item = deque_steal(victim);
+        if (item != 0) return item;
+    }
+    return 0;
+}
+
+// Trace until every thread runs out of work at the same time. Only a
+// thread with work can make more, so once all are idle marking is done.
+static void drain(Marker* marker) {
+    for (;;) {
+        uintptr_t item;
+        while ((item = deque_take(marker)) != 0) {
+            trace_item(marker, item);
+        }
+        item = steal_work(marker);
+        if (item != 0) {
+            trace_item(marker, item);
+            continue;
+        }
+
+        atomic_fetch_add(&pool.idle, 1);
+        for (;;) {
+            if (atomic_load(&pool.idle) == pool.count) return;
+            if (any_work()) break;
+            sched_yield();
+        }
+        atomic_fetch_sub(&pool.idle, 1);
+    }
+}
+
+static void* marker_thread(void* argument) {
+    Marker* marker = argument;
+    uint64_t seen = 0;
+    for (;;) {
+        pthread_mutex_lock(&pool.lock);
+        while (pool.epoch == seen) {
+            pthread_cond_wait(&pool.start, &pool.lock);
+        }
+        seen = pool.epoch;
+        pthread_mutex_unlock(&pool.lock);
+
+        drain(marker);
+
+        pthread_mutex_lock(&pool.lock);
+        pool.finished++;
+        pthread_cond_signal(&pool.done);
+        pthread_mutex_unlock(&pool.lock);
+    }
+    return NULL;
+}
+
+static int configured_mark_threads(void) {
+    const char* text = getenv("PFLANG_GC_THREADS");
+    long count = text != NULL ? strtol(text, NULL, 10) : 0;
+    if (count <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cores < DEFAULT_MARK_THREADS ? cores : DEFAULT_MARK_THREADS;
+    }
+    if (count < 1) count = 1;
+    return count > MAX_MARK_THREADS ? MAX_MARK_THREADS : (int)count;
+}
+
+// Set up the markers and their threads before the first major collection
+static void start_markers(void) {
+    if (pool.markers != NULL) return;
+    int count = configured_mark_threads();
+    pool.markers = aligned_alloc(_Alignof(Marker), sizeof(Marker) * (size_t)count);
+    if (pool.markers == NULL) {
+        fprintf(stderr, "Error: out of memory starting the collector's marking threads\n");
+        exit(1);
+    }
+    memset(pool.markers, 0, sizeof(Marker) * (size_t)count);
+    for (int i = 0; i < count; i++) {
+        atomic_init(&pool.markers[i].buffer, new_deque_buffer(1024));
+        pool.markers[i].seed = (unsigned)i + 1;
+    }
+
+    // With fewer threads than asked for, mark with the ones there are
+    pool.count = 1;
+    for (int i = 1; i < count; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, marker_thread, &pool.markers[i]) != 0) break;
+        pthread_detach(thread);
+        pool.count++;
+    }
+}
+
+// Whether the last marking reached old object
+static bool is_marked(pf_gc_header* object) {
+    Page* page = find_page(object);
+    if (page != NULL) {
+        size_t index = (size_t)((char*)object - page->cells) / page->cell_size;
+        return atomic_load_explicit(&page->marks[index / 64], memory_order_relaxed) & ((uint64_t)1 << (index % 64));
+    }
+    ptrdiff_t index = large_index(object);
+    return index >= 0 && atomic_load_explicit(&heap.large_marks[index], memory_order_relaxed) != 0;
+}
+
+static void sweep_large_objects(void) {
+    size_t kept = 0;
+    for (size_t i = 0; i < heap.large.count; i++) {
+        if (atomic_load_explicit(&heap.large_marks[i], memory_order_relaxed) != 0) {
+            heap.large.items[kept++] = heap.large.items[i];
+        } else {
+            free(heap.large.items[i]);
+        }
+    }
+    heap.large.count = kept;
+    free(heap.large_marks);
+    heap.large_marks = NULL;
+}
+
+// Runs right after a minor collection, so the nursery holds only the
+// objects that were pinned. Only marking happens in the pause: large
+// objects are freed right after, and pages are swept as allocation reaches
+// them.
+static void major_collection(void) {
+    // Marks of the last collection are still in the pages it left unswept
+    finish_sweeping();
+    start_markers();
+    heap.large_marks = calloc(heap.large.count + 1, sizeof(_Atomic uint8_t));
+    if (heap.large_marks == NULL) {
+        fprintf(stderr, "Error: out of memory marking the heap\n");
+        exit(1);
+    }
+    for (int i = 0; i < pool.count; i++) {
+        pool.markers[i].live_bytes = 0;
+    }
+
+    // This thread finds the roots, marking as markers[0], then joins the others
+    scan_roots(mark_root);
+    visit_string_roots(mark_root_slot);
+    pthread_mutex_lock(&pool.lock);
+    atomic_store(&pool.idle, 0);
+    pool.finished = 0;
+    pool.epoch++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+    drain(&pool.markers[0]);
+    pthread_mutex_lock(&pool.lock);
+    while (pool.finished < pool.count - 1) {
+        pthread_cond_wait(&pool.done, &pool.lock);
+    }
+    pthread_mutex_unlock(&pool.lock);
+
+    size_t live_bytes = 0;
+    for (int i = 0; i < pool.count; i++) {
+        Marker* marker = &pool.markers[i];
+        live_bytes += marker->live_bytes;
+        for (int r = 0; r < marker->retired_count; r++) {
+            free(marker->retired[r]);
+        }
+        marker->retired_count = 0;
+    }
+
+    // Remembered objects about to be freed must leave the set first
+    size_t kept = 0;
+    for (size_t i = 0; i < heap.remembered.count; i++) {
+        pf_gc_header* object = heap.remembered.items[i];
+        if (is_marked(object)) {
+            heap.remembered.items[kept++] = object;
+        } else {
+            object->flags &= ~REMEMBERED;
+        }
+    }
+    heap.remembered.count = kept;
+    sweep_large_objects();
+
+    // Free lists are rebuilt from the marks, page by page
+    for (int c = 0; c < SIZE_CLASSES; c++) {
+        heap.free_cells[c] = NULL;
+        heap.unswept[c] = NULL;
+    }
+    for (Page* page = heap.pages; page != NULL; page = page->next) {
+        page->swept = false;
+        page->next_unswept = heap.unswept[page->size_class];
+        heap.unswept[page->size_class] = page;
+    }
+    memset(heap.nursery_marks, 0, (heap.nursery_bytes / PF_GC_GRANULE / 64 + 1) * sizeof(uint64_t));
+
+    heap.old_bytes = live_bytes;
+    heap.major_trigger = live_bytes * 2 > MIN_MAJOR_TRIGGER ? live_bytes * 2 : MIN_MAJOR_TRIGGER;
+}
+
+// With the lock held and the world stopped
+static void collect(bool major) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (Mutator* mutator = world.mutators; mutator != NULL; mutator = mutator->next) {
+        retire_tlab(mutator->tlab);
+    }
+    minor_collection();
+    heap.statistics.minor_collections++;
+    major = major || heap.old_bytes > heap.major_trigger;
+    if (major) {
+        major_collection();
+        heap.statistics.major_collections++;
+    }
+
+    double pause = milliseconds_since(&start);
+    if (major) {
+        heap.statistics.major_pause_ms += pause;
+    } else {
+        heap.statistics.minor_pause_ms += pause;
+    }
+    if (pause > heap.statistics.max_pause_ms) heap.statistics.max_pause_ms = pause;
+}
+
+// ---------------------------------------------------------------------------
+// Stopping the world
+
+// Stop the calling thread until the collection under way is over. The
+// registers are spilled into this frame, which stays put while it waits.
+// With world.lock held.
+NO_INLINE static void stop_here(void) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_unwind_init();
+#endif
+    volatile char here = 0;
+    self->stack_low = (char*)&here;
+    self->stopped = true;
+    world.running--;
+    pthread_cond_signal(&world.stopped);
+    while (world.stopping) {
+        pthread_cond_wait(&world.resumed, &world.lock);
+    }
+    self->stopped = false;
+    world.running++;
+}
+
+void pf_gc_park(void) {
+    if (self == NULL) return;
+    pthread_mutex_lock(&world.lock);
+    if (world.stopping) stop_here();
+    pthread_mutex_unlock(&world.lock);
+}
+
+NO_INLINE void pf_gc_blocking(void (*block)(void*), void* argument) {
+    if (self == NULL) {
+        block(argument);
+        return;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_unwind_init();
+#endif
+    volatile char here = 0;
+    pthread_mutex_lock(&world.lock);
+    self->stack_low = (char*)&here;
+    self->stopped = true;
+    world.running--;
+    pthread_cond_signal(&world.stopped);
+    pthread_mutex_unlock(&world.lock);
+
+    block(argument);
+
+    pthread_mutex_lock(&world.lock);
+    while (world.stopping) {
+        pthread_cond_wait(&world.resumed, &world.lock);
+    }
+    self->stopped = false;
+    world.running++;
+    pthread_mutex_unlock(&world.lock);
+}
+
+// Return once the calling thread is the only mutator running. A thread
+// that finds another one collecting stops for it first.
+static void stop_the_world(void) {
+    pthread_mutex_lock(&world.lock);
+    while (world.stopping) {
+        stop_here();
+    }
+    world.stopping = true;
+    atomic_store(&pf_gc_stop_requested, 1);
+    while (world.running > 1) {
+        pthread_cond_wait(&world.stopped, &world.lock);
+    }
+    pthread_mutex_unlock(&world.lock);
+}
+
+static void start_the_world(void) {
+    pthread_mutex_lock(&world.lock);
+    world.stopping = false;
+    atomic_store(&pf_gc_stop_requested, 0);
+    pthread_cond_broadcast(&world.resumed);
+    pthread_mutex_unlock(&world.lock);
+}
+
+// Collect with the world stopped, unless another thread collected while
+// this one waited, so that more than seen minor collections have run;
+// only a forced collection runs regardless. Called without the lock.
+static void collect_stopped(bool major, bool forced, uint64_t seen) {
+    stop_the_world();
+    pthread_mutex_lock(&heap.lock);
+    if (forced || heap.statistics.minor_collections == seen) collect(major);
+    pthread_mutex_unlock(&heap.lock);
+    start_the_world();
+}
+
+// ---------------------------------------------------------------------------
+// Allocation
+
+void* pf_gc_allocate_slow(size_t size, pf_gc_kind kind) {
+    if (!heap.initialized || self == NULL) pf_gc_init();
+    pf_gc_safepoint();
+    pthread_mutex_lock(&heap.lock);
+
+    if (size > PF_GC_MAX_YOUNG) {
+        // Too large to copy cheaply: it starts out old
+        if (heap.old_bytes + size > heap.major_trigger) {
+            uint64_t seen = heap.statistics.minor_collections;
+            pthread_mutex_unlock(&heap.lock);
+            collect_stopped(true, false, seen);
+            pthread_mutex_lock(&heap.lock);
+        }
+        void* payload = allocate_old(size, kind);
+        pthread_mutex_unlock(&heap.lock);
+        return payload;
+    }
+
+    size_t cell = cell_bytes(size);
+    retire_tlab(&pf_gc_local_tlab);
+    if (!refill_tlab(cell)) {
+        uint64_t seen = heap.statistics.minor_collections;
+        pthread_mutex_unlock(&heap.lock);
+        collect_stopped(false, false, seen);
+        pthread_mutex_lock(&heap.lock);
+        if (!refill_tlab(cell)) {
+            // Pinned objects, or other threads' TLABs, left no gap this large
+            void* payload = allocate_old(size, kind);
+            pthread_mutex_unlock(&heap.lock);
+            return payload;
+        }
+    }
+    pthread_mutex_unlock(&heap.lock);
+    return pf_gc_allocate(size, kind);
+}
+
+void pf_gc_collect(bool major) {
+    if (!heap.initialized || self == NULL) pf_gc_init();
+    collect_stopped(major, true, 0);
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+
+void pf_gc_get_statistics(pf_gc_statistics* statistics) {
+    if (!heap.initialized) pf_gc_init();
+    pthread_mutex_lock(&heap.lock);
+    *statistics = heap.statistics;
+    // The unused rest of this thread's TLAB is not allocated yet
+    pf_gc_tlab* tlab = &pf_gc_local_tlab;
+    statistics->bytes_allocated -= (size_t)(tlab->end - tlab->top);
+    statistics->heap_bytes = heap.old_bytes;
+    statistics->mark_threads = pool.count;
+    double seconds = milliseconds_since(&heap.started) / 1e3;
+    statistics->allocation_rate = seconds > 0 ? (double)statistics->bytes_allocated / 1e6 / seconds : 0;
+    pthread_mutex_unlock(&heap.lock);
+}
+
+void pf_gc_print_statistics(FILE* out) {
+    pf_gc_statistics statistics;
+    pf_gc_get_statistics(&statistics);
+    fprintf(out, "gc: %llu minor and %llu major collections, %.3f ms paused, longest pause %.3f ms\n",
+            (unsigned long long)statistics.minor_collections, (unsigned long long)statistics.major_collections,
+            statistics.minor_pause_ms + statistics.major_pause_ms, statistics.max_pause_ms);
+    if (statistics.mark_threads > 0) {
+        fprintf(out, "gc: old generation marked by %d threads, %.3f ms in major collections\n",
+                statistics.mark_threads, statistics.major_pause_ms);
+    }
+    fprintf(out, "gc: %.1f MB allocated at %.1f MB/s, %.1f MB promoted, %.1f MB in the old generation\n",
+            (double)statistics.bytes_allocated / 1e6, statistics.allocation_rate,
+            (double)statistics.bytes_promoted / 1e6, (double)statistics.heap_bytes / 1e6);
+}
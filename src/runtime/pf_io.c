@@ -0,0 +1,627 @@
+// Asynchronous I/O: the epoll thread, io_uring for files, and waiting
+#define _GNU_SOURCE
+#include "../../include/runtime/pf_io.h"
+#include "../../include/runtime/pf_task.h"
+#include "../../include/runtime/pf_gc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+// Descriptors are found through a table of chunks made on first use
+#define TABLE_CHUNK 1024
+#define TABLE_CHUNKS 4096
+#define EVENTS_PER_WAIT 256
+#define RING_ENTRIES 256
+// Reads into a string of up to this many bytes go through the stack
+#define LOCAL_READ 4096
+
+typedef enum {
+    UNKNOWN,                        // Not used since it was opened
+    POLLED,                         // Non-blocking and registered with epoll
+    FILE_LIKE,                      // A regular file or block device
+    BLOCKING,                       // Neither; operations run in place
+} Kind;
+
+enum { READING, WRITING };
+
+// A task or thread waiting for a descriptor to be ready, on its own stack
+typedef struct Waiter {
+    pf_parker parker;
+    struct Waiter* next;
+} Waiter;
+
+// What a descriptor is and who waits on it. ready records an event that
+// came while nobody waited, so that the next one to wait tries again
+// instead: with edge-triggered epoll that event will not come twice.
+typedef struct {
+    pthread_mutex_t lock;
+    Kind kind;
+    bool ready[2];
+    Waiter* waiters[2];
+} Descriptor;
+
+// An operation submitted to io_uring, on the submitter's stack
+typedef struct {
+    pf_parker parker;
+    int64_t result;                 // Bytes, or minus errno
+} Request;
+
+#ifdef HAVE_IO_URING
+typedef struct {
+    int fd;
+    pthread_mutex_t lock;           // Submissions come from every worker
+    _Atomic int in_flight;          // Kept below the completion queue size
+    unsigned completions;
+    _Atomic unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    _Atomic unsigned* cq_head;
+    _Atomic unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+} Ring;
+#endif
+
+static struct {
+    pthread_once_t once;
+    int epoll;
+    _Atomic(Descriptor*) table[TABLE_CHUNKS];
+    bool uring;
+#ifdef HAVE_IO_URING
+    Ring ring;
+#endif
+
+    _Atomic uint64_t waits;
+    _Atomic uint64_t submitted;
+    _Atomic uint64_t in_place;
+} io = {.once = PTHREAD_ONCE_INIT, .epoll = -1};
+
+static Descriptor* descriptor(int fd) {
+    if (fd < 0 || fd >= TABLE_CHUNK * TABLE_CHUNKS) return NULL;
+    _Atomic(Descriptor*)* slot = &io.table[fd / TABLE_CHUNK];
+    Descriptor* chunk = atomic_load_explicit(slot, memory_order_acquire);
+    if (chunk == NULL) {
+        Descriptor* fresh = calloc(TABLE_CHUNK, sizeof(Descriptor));
+        if (fresh == NULL) {
+            fprintf(stderr, "Error: out of memory for descriptor %d\n", fd);
+            exit(1);
+        }
+        for (int i = 0; i < TABLE_CHUNK; i++) {
+            pthread_mutex_init(&fresh[i].lock, NULL);
+        }
+        if (atomic_compare_exchange_strong(slot, &chunk, fresh)) {
+            chunk = fresh;
+        } else {
+            free(fresh);
+        }
+    }
+    return &chunk[fd % TABLE_CHUNK];
+}
+
+// Wake everyone on a list taken off a descriptor; each may be gone as soon
+// as it is unparked
+static void wake_all(Waiter* waiter) {
+    while (waiter != NULL) {
+        Waiter* next = waiter->next;
+        pf_parker_unpark(&waiter->parker, 0);
+        waiter = next;
+    }
+}
+
+static void notify(Descriptor* descriptor, int direction) {
+    pthread_mutex_lock(&descriptor->lock);
+    Waiter* waiters = descriptor->waiters[direction];
+    descriptor->waiters[direction] = NULL;
+    if (waiters == NULL) descriptor->ready[direction] = true;
+    pthread_mutex_unlock(&descriptor->lock);
+    wake_all(waiters);
+}
+
+// Park until the descriptor may be ready in direction, unless an event
+// came since the last wait
+static void wait_until_ready(Descriptor* descriptor, int direction) {
+    Waiter waiter;
+    pthread_mutex_lock(&descriptor->lock);
+    if (descriptor->ready[direction] || descriptor->kind != POLLED) {
+        descriptor->ready[direction] = false;
+        pthread_mutex_unlock(&descriptor->lock);
+        return;
+    }
+    pf_parker_prepare(&waiter.parker);
+    waiter.next = descriptor->waiters[direction];
+    descriptor->waiters[direction] = &waiter;
+    pthread_mutex_unlock(&descriptor->lock);
+    atomic_fetch_add_explicit(&io.waits, 1, memory_order_relaxed);
+    pf_parker_park(&waiter.parker);
+}
+
+// ---------------------------------------------------------------------------
+// io_uring, through its system calls: one ring whose submissions are made
+// under a lock and whose completions the I/O thread reaps
+
+#ifdef HAVE_IO_URING
+static bool start_ring(Ring* ring) {
+    const char* setting = getenv("PFLANG_IO_URING");
+    if (setting != NULL && strcmp(setting, "0") == 0) return false;
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params);
+    if (fd < 0) return false;
+    // One mapping for both rings, no dropped completions, and offset -1
+    // meaning the file position, as with read and write
+    unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+    if ((params.features & needed) != needed) {
+        close(fd);
+        return false;
+    }
+
+    size_t sq_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_bytes = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t ring_bytes = sq_bytes > cq_bytes ? sq_bytes : cq_bytes;
+    char* rings = mmap(NULL, ring_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (rings == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    size_t sqe_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(NULL, sqe_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(rings, ring_bytes);
+        close(fd);
+        return false;
+    }
+
+    ring->fd = fd;
+    pthread_mutex_init(&ring->lock, NULL);
+    ring->completions = params.cq_entries;
+    ring->sq_tail = (_Atomic unsigned*)(rings + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(rings + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(rings + params.sq_off.array);
+    ring->sqes = sqes;
+    ring->cq_head = (_Atomic unsigned*)(rings + params.cq_off.head);
+    ring->cq_tail = (_Atomic unsigned*)(rings + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(rings + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(rings + params.cq_off.cqes);
+    return true;
+}
+
+// Submit a read or write at the file position; false if the ring is full
+// or refused it, leaving the caller to run it in place
+static bool submit(Ring* ring, int opcode, int fd, void* buffer, size_t length, Request* request) {
+    pthread_mutex_lock(&ring->lock);
+    if (atomic_load_explicit(&ring->in_flight, memory_order_relaxed) >= (int)ring->completions) {
+        pthread_mutex_unlock(&ring->lock);
+        return false;
+    }
+    // Counted before it goes in, since it may complete at once
+    atomic_fetch_add_explicit(&ring->in_flight, 1, memory_order_relaxed);
+    // The kernel reads the queue only in io_uring_enter, which is called
+    // under the lock, so the queue is empty whenever the lock is free
+    unsigned tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = (uint8_t)opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)buffer;
+    sqe->len = length > UINT32_MAX ? UINT32_MAX : (uint32_t)length;
+    sqe->off = (uint64_t)-1;
+    sqe->user_data = (uint64_t)(uintptr_t)request;
+    ring->sq_array[index] = index;
+    atomic_store_explicit(ring->sq_tail, tail + 1, memory_order_release);
+
+    long submitted;
+    do {
+        submitted = syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted != 1) {
+        atomic_store_explicit(ring->sq_tail, tail, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&ring->in_flight, 1, memory_order_relaxed);
+        pthread_mutex_unlock(&ring->lock);
+        return false;
+    }
+    pthread_mutex_unlock(&ring->lock);
+    return true;
+}
+
+static void reap(Ring* ring) {
+    unsigned head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+    while (head != atomic_load_explicit(ring->cq_tail, memory_order_acquire)) {
+        struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        Request* request = (Request*)(uintptr_t)cqe->user_data;
+        int64_t result = cqe->res;
+        atomic_store_explicit(ring->cq_head, ++head, memory_order_release);
+        atomic_fetch_sub_explicit(&ring->in_flight, 1, memory_order_relaxed);
+        request->result = result;
+        pf_parker_unpark(&request->parker, 0);
+    }
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// The I/O thread
+
+static void* poll_loop(void* argument) {
+    (void)argument;
+    struct epoll_event events[EVENTS_PER_WAIT];
+    for (;;) {
+        int count = epoll_wait(io.epoll, events, EVENTS_PER_WAIT, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            perror("Error: epoll_wait");
+            exit(1);
+        }
+        for (int i = 0; i < count; i++) {
+            uint32_t flags = events[i].events;
+#ifdef HAVE_IO_URING
+            if (events[i].data.ptr == &io.ring) {
+                reap(&io.ring);
+                continue;
+            }
+#endif
+            Descriptor* descriptor = events[i].data.ptr;
+            if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) notify(descriptor, READING);
+            if (flags & (EPOLLOUT | EPOLLHUP | EPOLLERR)) notify(descriptor, WRITING);
+        }
+    }
+    return NULL;
+}
+
+static void start_io(void) {
+    io.epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (io.epoll < 0) {
+        perror("Error: epoll_create1");
+        exit(1);
+    }
+#ifdef HAVE_IO_URING
+    if (start_ring(&io.ring)) {
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = &io.ring};
+        io.uring = epoll_ctl(io.epoll, EPOLL_CTL_ADD, io.ring.fd, &event) == 0;
+    }
+#endif
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, poll_loop, NULL) != 0) {
+        fprintf(stderr, "Error: could not start the I/O thread\n");
+        exit(1);
+    }
+    pthread_detach(thread);
+}
+
+// The descriptor of fd, sorted out on its first use since it was opened
+static Descriptor* prepare(int fd, Kind* kind) {
+    pthread_once(&io.once, start_io);
+    Descriptor* descriptor_of_fd = descriptor(fd);
+    if (descriptor_of_fd == NULL) {
+        errno = EBADF;
+        return NULL;
+    }
+    pthread_mutex_lock(&descriptor_of_fd->lock);
+    if (descriptor_of_fd->kind == UNKNOWN) {
+        struct stat status;
+        if (fstat(fd, &status) != 0) {
+            pthread_mutex_unlock(&descriptor_of_fd->lock);
+            return NULL;
+        }
+        if (S_ISREG(status.st_mode) || S_ISBLK(status.st_mode)) {
+            descriptor_of_fd->kind = FILE_LIKE;
+        } else {
+            int flags = fcntl(fd, F_GETFL);
+            struct epoll_event event = {.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+                                        .data.ptr = descriptor_of_fd};
+            // A number closed behind our back may still be registered
+            // through a duplicate of it
+            if (flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0 &&
+                (epoll_ctl(io.epoll, EPOLL_CTL_ADD, fd, &event) == 0 ||
+                 (errno == EEXIST && epoll_ctl(io.epoll, EPOLL_CTL_MOD, fd, &event) == 0))) {
+                descriptor_of_fd->kind = POLLED;
+            } else {
+                descriptor_of_fd->kind = BLOCKING;
+            }
+        }
+        descriptor_of_fd->ready[READING] = false;
+        descriptor_of_fd->ready[WRITING] = false;
+    }
+    *kind = descriptor_of_fd->kind;
+    pthread_mutex_unlock(&descriptor_of_fd->lock);
+    return descriptor_of_fd;
+}
+
+// A descriptor just opened may reuse the number of one closed behind our
+// back, so whatever was known about that number is dropped
+static int adopt(int fd) {
+    Descriptor* fresh = descriptor(fd);
+    if (fresh != NULL) {
+        pthread_mutex_lock(&fresh->lock);
+        fresh->kind = UNKNOWN;
+        pthread_mutex_unlock(&fresh->lock);
+    }
+    return fd;
+}
+
+// ---------------------------------------------------------------------------
+// Operations
+
+typedef struct {
+    bool writing;
+    int fd;
+    void* buffer;
+    size_t length;
+    int64_t result;
+    int error;
+} Call;
+
+static void call_in_place(void* argument) {
+    Call* call = argument;
+    ssize_t result;
+    do {
+        result = call->writing ? write(call->fd, call->buffer, call->length) : read(call->fd, call->buffer, call->length);
+    } while (result < 0 && errno == EINTR);
+    call->result = result;
+    call->error = errno;
+}
+
+// One read or write of a file, or of a descriptor epoll cannot watch
+static int64_t transfer_once(Kind kind, bool writing, int fd, void* buffer, size_t length) {
+#ifdef HAVE_IO_URING
+    if (kind == FILE_LIKE && io.uring) {
+        Request request;
+        pf_parker_prepare(&request.parker);
+        if (submit(&io.ring, writing ? IORING_OP_WRITE : IORING_OP_READ, fd, buffer, length, &request)) {
+            atomic_fetch_add_explicit(&io.submitted, 1, memory_order_relaxed);
+            pf_parker_park(&request.parker);
+            if (request.result < 0) {
+                errno = (int)-request.result;
+                return -1;
+            }
+            return request.result;
+        }
+    }
+#else
+    (void)kind;
+#endif
+    atomic_fetch_add_explicit(&io.in_place, 1, memory_order_relaxed);
+    Call call = {writing, fd, buffer, length, 0, 0};
+    pf_gc_blocking(call_in_place, &call);
+    errno = call.error;
+    return call.result;
+}
+
+// One read or write: some bytes, 0 at the end, or -1 with errno set
+static int64_t transfer(bool writing, int fd, void* buffer, size_t length) {
+    Kind kind;
+    Descriptor* state = prepare(fd, &kind);
+    if (state == NULL) return -1;
+    if (kind != POLLED) return transfer_once(kind, writing, fd, buffer, length);
+    for (;;) {
+        ssize_t result = writing ? write(fd, buffer, length) : read(fd, buffer, length);
+        if (result >= 0) return result;
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) return -1;
+        wait_until_ready(state, writing ? WRITING : READING);
+    }
+}
+
+int64_t pf_io_read(int fd, void* buffer, size_t length) {
+    return transfer(false, fd, buffer, length);
+}
+
+int64_t pf_io_write(int fd, const void* buffer, size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        int64_t result = transfer(true, fd, (char*)buffer + written, length - written);
+        if (result < 0) return -1;
+        if (result == 0) {
+            errno = EIO;
+            return -1;
+        }
+        written += (size_t)result;
+    }
+    return (int64_t)length;
+}
+
+int pf_io_open(const char* path, int flags, int mode) {
+    int fd;
+    do {
+        fd = open(path, flags | O_CLOEXEC, mode);
+    } while (fd < 0 && errno == EINTR);
+    return fd < 0 ? -1 : adopt(fd);
+}
+
+int pf_io_close(int fd) {
+    Descriptor* closing = descriptor(fd);
+    if (closing == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+    pthread_mutex_lock(&closing->lock);
+    if (closing->kind == POLLED) epoll_ctl(io.epoll, EPOLL_CTL_DEL, fd, NULL);
+    closing->kind = UNKNOWN;
+    Waiter* readers = closing->waiters[READING];
+    Waiter* writers = closing->waiters[WRITING];
+    closing->waiters[READING] = NULL;
+    closing->waiters[WRITING] = NULL;
+    int result = close(fd);
+    pthread_mutex_unlock(&closing->lock);
+    wake_all(readers);
+    wake_all(writers);
+    return result;
+}
+
+int pf_io_listen_tcp(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons((uint16_t)port),
+                                  .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (port < 0 || port > 65535 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(fd, SOMAXCONN) != 0) {
+        int error = port < 0 || port > 65535 ? EINVAL : errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return adopt(fd);
+}
+
+int pf_io_accept(int fd) {
+    Kind kind;
+    Descriptor* listening = prepare(fd, &kind);
+    if (listening == NULL) return -1;
+    for (;;) {
+        int connection = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (connection >= 0) return adopt(connection);
+        // A connection that went away before it was accepted is skipped
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        if ((errno != EAGAIN && errno != EWOULDBLOCK) || kind != POLLED) return -1;
+        wait_until_ready(listening, READING);
+    }
+}
+
+// Connect fd, non-blocking, and wait for the outcome
+static int connect_socket(int fd, const struct sockaddr* address, socklen_t length) {
+    if (connect(fd, address, length) == 0) return 0;
+    if (errno != EINPROGRESS && errno != EINTR) return -1;
+    Kind kind;
+    Descriptor* connecting = prepare(fd, &kind);
+    if (connecting == NULL) return -1;
+    for (;;) {
+        int error = 0;
+        socklen_t size = sizeof(error);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &size) != 0) return -1;
+        if (error != 0) {
+            errno = error;
+            return -1;
+        }
+        // Connected once the peer's address is known
+        struct sockaddr_storage peer;
+        socklen_t peer_length = sizeof(peer);
+        if (getpeername(fd, (struct sockaddr*)&peer, &peer_length) == 0) return 0;
+        if (errno != ENOTCONN) return -1;
+        wait_until_ready(connecting, WRITING);
+    }
+}
+
+int pf_io_connect_tcp(pf_string host, int port) {
+    char service[16];
+    snprintf(service, sizeof(service), "%d", port);
+    char* name = pf_string_to_cstr(host);
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo* addresses;
+    int found = getaddrinfo(name, service, &hints, &addresses);
+    free(name);
+    if (found != 0) {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+    int fd = -1;
+    int error = ECONNREFUSED;
+    for (struct addrinfo* address = addresses; address != NULL; address = address->ai_next) {
+        fd = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) {
+            error = errno;
+            continue;
+        }
+        adopt(fd);
+        if (connect_socket(fd, address->ai_addr, address->ai_addrlen) == 0) break;
+        error = errno;
+        pf_io_close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0) {
+        errno = error;
+        return -1;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+int pf_io_local_port(int fd) {
+    struct sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, (struct sockaddr*)&address, &length) != 0) return -1;
+    if (address.ss_family == AF_INET) return ntohs(((struct sockaddr_in*)&address)->sin_port);
+    if (address.ss_family == AF_INET6) return ntohs(((struct sockaddr_in6*)&address)->sin6_port);
+    errno = EAFNOSUPPORT;
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Builtins
+
+int64_t pf_io_open_file(pf_string path, pf_string mode) {
+    static const struct {
+        const char* mode;
+        int flags;
+    } modes[] = {
+        {"r", O_RDONLY},
+        {"w", O_WRONLY | O_CREAT | O_TRUNC},
+        {"a", O_WRONLY | O_CREAT | O_APPEND},
+        {"rw", O_RDWR | O_CREAT},
+    };
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        if (pf_string_equal(mode, pf_string_from_cstr(modes[i].mode))) {
+            char* name = pf_string_to_cstr(path);
+            int fd = pf_io_open(name, modes[i].flags, 0666);
+            free(name);
+            return fd;
+        }
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+pf_string pf_io_read_string(int64_t fd, int64_t max) {
+    if (max <= 0 || fd > INT32_MAX) return PF_STRING_EMPTY;
+    if (max > UINT32_MAX) max = UINT32_MAX;
+    char local[LOCAL_READ];
+    char* buffer = max <= LOCAL_READ ? local : malloc((size_t)max);
+    if (buffer == NULL) return PF_STRING_EMPTY;
+    int64_t length = pf_io_read((int)fd, buffer, (size_t)max);
+    pf_string result = length > 0 ? pf_string_from(buffer, (size_t)length) : PF_STRING_EMPTY;
+    if (buffer != local) free(buffer);
+    return result;
+}
+
+int64_t pf_io_write_string(int64_t fd, pf_string data) {
+    if (fd > INT32_MAX) {
+        errno = EBADF;
+        return -1;
+    }
+    // data stays on this stack until the write is done, which keeps its
+    // bytes from moving in a collection
+    return pf_io_write((int)fd, pf_string_data(&data), data.length);
+}
+
+void pf_io_get_statistics(pf_io_statistics* statistics) {
+    statistics->waits = atomic_load(&io.waits);
+    statistics->submitted = atomic_load(&io.submitted);
+    statistics->in_place = atomic_load(&io.in_place);
+    statistics->uring = io.uring;
+}
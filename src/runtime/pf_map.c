@@ -0,0 +1,293 @@
+#include "../../include/runtime/pf_map.h"
+#include "../../include/runtime/pf_gc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define MIN_CAPACITY PF_MAP_GROUP_WIDTH
+
+static void* allocate(size_t size) {
+    void* memory = calloc(1, size);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: out of memory growing a map to %zu bytes\n", size);
+        exit(1);
+    }
+    return memory;
+}
+
+// Bit i set where window byte i equals h2
+static inline uint32_t window_matches(const uint8_t* window, uint8_t h2) {
+#ifdef __SSE2__
+    __m128i bytes = _mm_loadu_si128((const __m128i*)window);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)h2)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < PF_MAP_GROUP_WIDTH; i++) {
+        if (window[i] == h2) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+// Bit i set where window byte i is empty: the only control byte with the
+// high bit set
+static inline uint32_t window_empties(const uint8_t* window) {
+#ifdef __SSE2__
+    return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)window));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < PF_MAP_GROUP_WIDTH; i++) {
+        if (window[i] & PF_MAP_EMPTY) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+// Spread a key hash over 64 bits; the low 7 bits become the control byte
+// and the rest pick the home slot
+static inline uint64_t mix(uint64_t hash) {
+    hash *= 0x9E3779B97F4A7C15ull;
+    return hash ^ (hash >> 32);
+}
+
+static inline uint64_t hash_int(int64_t key) {
+    return mix((uint64_t)key);
+}
+
+static inline bool equal_int(int64_t a, int64_t b) {
+    return a == b;
+}
+
+// Stored str keys always have their hash cached
+static inline uint64_t hash_str(pf_string key) {
+    return mix(key.hash != 0 ? key.hash : pf_string_hash(&key));
+}
+
+static inline bool equal_str(pf_string a, pf_string b) {
+    return pf_string_equal(a, b);
+}
+
+static inline pf_string prepare_str(pf_string key) {
+    pf_string_hash(&key);
+    return key;
+}
+
+static inline int64_t prepare_int(int64_t key) {
+    return key;
+}
+
+// Tables live outside the collected heap, so the collector scans them as
+// roots: the values of every map conservatively, and the keys of str maps
+// precisely, so that long keys are promoted out of the nursery instead of
+// pinning it. A slot a key leaves is zeroed, an inline empty string.
+static inline void track_keys_int(const int64_t* keys, size_t size) {
+    (void)keys;
+    (void)size;
+}
+
+static inline void untrack_keys_int(const int64_t* keys) {
+    (void)keys;
+}
+
+static inline void track_keys_str(const pf_string* keys, size_t size) {
+    pf_gc_add_string_roots(keys, size / sizeof(pf_string));
+}
+
+static inline void untrack_keys_str(const pf_string* keys) {
+    pf_gc_remove_roots(keys);
+}
+
+// Windows starting near the end read past it into the mirrored head
+static inline void set_control(uint8_t* control, size_t capacity, size_t slot, uint8_t value) {
+    control[slot] = value;
+    if (slot < PF_MAP_GROUP_WIDTH - 1) {
+        control[capacity + slot] = value;
+    }
+}
+
+#define PF_MAP_DEFINE(name, key_type, suffix) \
+    void pf_##name##_init(pf_##name* map, size_t value_size) { \
+        memset(map, 0, sizeof(*map)); \
+        map->value_size = value_size; \
+    } \
+    \
+    void pf_##name##_free(pf_##name* map) { \
+        if (map->capacity != 0) { \
+            untrack_keys_##suffix(map->keys); \
+            pf_gc_remove_roots(map->values); \
+        } \
+        free(map->control); \
+        free(map->keys); \
+        free(map->values); \
+        pf_##name##_init(map, map->value_size); \
+    } \
+    \
+    /* Slot holding key, or capacity */ \
+    static size_t name##_lookup(const pf_##name* map, key_type key, uint64_t hash) { \
+        if (map->capacity == 0) return 0; \
+        size_t mask = map->capacity - 1; \
+        size_t position = (size_t)(hash >> 7) & mask; \
+        uint8_t h2 = (uint8_t)(hash & 0x7F); \
+        for (;;) { \
+            const uint8_t* window = map->control + position; \
+            uint32_t matches = window_matches(window, h2); \
+            while (matches != 0) { \
+                size_t slot = (position + (size_t)__builtin_ctz(matches)) & mask; \
+                if (equal_##suffix(map->keys[slot], key)) return slot; \
+                matches &= matches - 1; \
+            } \
+            /* A key is never stored past the first empty slot of its run */ \
+            if (window_empties(window) != 0) return map->capacity; \
+            position = (position + PF_MAP_GROUP_WIDTH) & mask; \
+        } \
+    } \
+    \
+    /* First empty slot at or after key's home; the load factor keeps one */ \
+    static size_t name##_free_slot(const pf_##name* map, uint64_t hash) { \
+        size_t mask = map->capacity - 1; \
+        size_t position = (size_t)(hash >> 7) & mask; \
+        for (;;) { \
+            uint32_t empties = window_empties(map->control + position); \
+            if (empties != 0) return (position + (size_t)__builtin_ctz(empties)) & mask; \
+            position = (position + PF_MAP_GROUP_WIDTH) & mask; \
+        } \
+    } \
+    \
+    static void name##_resize(pf_##name* map, size_t capacity) { \
+        pf_##name old = *map; \
+        map->capacity = capacity; \
+        map->control = allocate(capacity + PF_MAP_GROUP_WIDTH - 1); \
+        memset(map->control, PF_MAP_EMPTY, capacity + PF_MAP_GROUP_WIDTH - 1); \
+        map->keys = allocate(capacity * sizeof(key_type)); \
+        map->values = allocate(capacity * map->value_size + 1); \
+        track_keys_##suffix(map->keys, capacity * sizeof(key_type)); \
+        pf_gc_add_roots(map->values, capacity * map->value_size); \
+        \
+        for (size_t slot = 0; slot < old.capacity; slot++) { \
+            if (old.control[slot] & PF_MAP_EMPTY) continue; \
+            uint64_t hash = hash_##suffix(old.keys[slot]); \
+            size_t target = name##_free_slot(map, hash); \
+            set_control(map->control, capacity, target, (uint8_t)(hash & 0x7F)); \
+            map->keys[target] = old.keys[slot]; \
+            memcpy(map->values + target * map->value_size, old.values + slot * old.value_size, \
+                   map->value_size); \
+        } \
+        if (old.capacity != 0) { \
+            untrack_keys_##suffix(old.keys); \
+            pf_gc_remove_roots(old.values); \
+        } \
+        free(old.control); \
+        free(old.keys); \
+        free(old.values); \
+    } \
+    \
+    void* pf_##name##_find(const pf_##name* map, key_type key) { \
+        size_t slot = name##_lookup(map, key, hash_##suffix(key)); \
+        return slot < map->capacity ? map->values + slot * map->value_size : NULL; \
+    } \
+    \
+    void* pf_##name##_insert(pf_##name* map, key_type key, bool* inserted) { \
+        key = prepare_##suffix(key); \
+        uint64_t hash = hash_##suffix(key); \
+        size_t slot = name##_lookup(map, key, hash); \
+        if (slot < map->capacity) { \
+            if (inserted != NULL) *inserted = false; \
+            return map->values + slot * map->value_size; \
+        } \
+        \
+        /* Grow at 7/8 full so probe runs stay short */ \
+        if ((map->count + 1) * 8 > map->capacity * 7) { \
+            name##_resize(map, map->capacity == 0 ? MIN_CAPACITY : map->capacity * 2); \
+        } \
+        slot = name##_free_slot(map, hash); \
+        set_control(map->control, map->capacity, slot, (uint8_t)(hash & 0x7F)); \
+        map->keys[slot] = key; \
+        map->count++; \
+        if (inserted != NULL) *inserted = true; \
+        return memset(map->values + slot * map->value_size, 0, map->value_size); \
+    } \
+    \
+    /* Backward-shift deletion: pull later entries of the run into the hole */ \
+    /* unless that would move them before their home slot */ \
+    bool pf_##name##_remove(pf_##name* map, key_type key) { \
+        size_t hole = name##_lookup(map, key, hash_##suffix(key)); \
+        if (hole >= map->capacity) return false; \
+        \
+        size_t mask = map->capacity - 1; \
+        size_t next = hole; \
+        for (;;) { \
+            next = (next + 1) & mask; \
+            if (map->control[next] & PF_MAP_EMPTY) break; \
+            size_t home = (size_t)(hash_##suffix(map->keys[next]) >> 7) & mask; \
+            bool stays = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next); \
+            if (stays) continue; \
+            \
+            set_control(map->control, map->capacity, hole, map->control[next]); \
+            map->keys[hole] = map->keys[next]; \
+            memcpy(map->values + hole * map->value_size, map->values + next * map->value_size, \
+                   map->value_size); \
+            hole = next; \
+        } \
+        set_control(map->control, map->capacity, hole, PF_MAP_EMPTY); \
+        memset(&map->keys[hole], 0, sizeof(key_type)); \
+        map->count--; \
+        return true; \
+    } \
+    \
+    bool pf_##name##_next(const pf_##name* map, size_t* cursor, size_t* slot) { \
+        while (*cursor < map->capacity) { \
+            size_t current = (*cursor)++; \
+            if (!(map->control[current] & PF_MAP_EMPTY)) { \
+                *slot = current; \
+                return true; \
+            } \
+        } \
+        return false; \
+    }
+
+PF_MAP_DEFINE(map_int, int64_t, int)
+PF_MAP_DEFINE(map_str, pf_string, str)
+
+#undef PF_MAP_DEFINE
+
+static pf_map_str* from_handle(int64_t map) {
+    return (pf_map_str*)(uintptr_t)map;
+}
+
+int64_t pf_map_new(void) {
+    pf_map_str* map = allocate(sizeof(pf_map_str));
+    pf_map_str_init(map, sizeof(int64_t));
+    return (int64_t)(uintptr_t)map;
+}
+
+void pf_map_set(int64_t map, pf_string key, int64_t value) {
+    int64_t* slot = pf_map_str_insert(from_handle(map), key, NULL);
+    *slot = value;
+}
+
+int64_t pf_map_get(int64_t map, pf_string key, int64_t missing) {
+    const int64_t* slot = pf_map_str_find(from_handle(map), key);
+    return slot != NULL ? *slot : missing;
+}
+
+bool pf_map_has(int64_t map, pf_string key) {
+    return pf_map_str_find(from_handle(map), key) != NULL;
+}
+
+bool pf_map_remove(int64_t map, pf_string key) {
+    return pf_map_str_remove(from_handle(map), key);
+}
+
+int64_t pf_map_count(int64_t map) {
+    return (int64_t)from_handle(map)->count;
+}
+
+void pf_map_free(int64_t map) {
+    pf_map_str_free(from_handle(map));
+    free(from_handle(map));
+}
@@ -0,0 +1,427 @@
+#include "../../include/runtime/pf_numeric.h"
+#include "../../include/runtime/pf_output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PF_NUMERIC_X86 1
+#endif
+
+// Elements summed into narrow lanes before they are flushed into the 64-bit
+// total; small enough that no lane of a sum or dot product can overflow
+#define BLOCK 65536
+
+#define MASK_CHUNK 64
+
+// X(suffix, c_type, total_type, wide_type, arith_type, sum_lane, sum_widen,
+// dot_lane, dot_widen). Totals accumulate in wide_type, unsigned for
+// integers so that they wrap instead of overflowing; arith_type is where
+// scale multiplies; sum_lane and dot_lane are the lanes that vector kernels
+// accumulate in, and the widen columns name the loads that fill them.
+#define KERNEL_TYPES(X) \
+    X(u8, uint8_t, uint64_t, uint64_t, uint8_t, uint32_t, u8_32, uint32_t, u8_32) \
+    X(u16, uint16_t, uint64_t, uint64_t, uint16_t, uint32_t, u16_32, uint64_t, u16_64) \
+    X(u32, uint32_t, uint64_t, uint64_t, uint32_t, uint64_t, u32_64, uint64_t, u32_64) \
+    X(u64, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, same, uint64_t, same) \
+    X(i8, int8_t, int64_t, uint64_t, uint8_t, int32_t, i8_32, int32_t, i8_32) \
+    X(i16, int16_t, int64_t, uint64_t, uint16_t, int32_t, i16_32, int64_t, i16_64) \
+    X(i32, int32_t, int64_t, uint64_t, uint32_t, int64_t, i32_64, uint64_t, i32_64) \
+    X(i64, int64_t, int64_t, uint64_t, uint64_t, uint64_t, same, uint64_t, same) \
+    X(f32, float, float, float, float, float, same, float, same) \
+    X(f64, double, double, double, double, double, same, double, same)
+
+#define DEFINE_SCALAR_KERNELS(suffix, c_type, total_type, wide_type, arith_type, ...) \
+    static total_type sum_##suffix##_scalar(const c_type* data, size_t length) { \
+        wide_type total = 0; \
+        for (size_t i = 0; i < length; i++) total += (wide_type)(total_type)data[i]; \
+        return (total_type)total; \
+    } \
+    \
+    static total_type dot_##suffix##_scalar(const c_type* a, const c_type* b, size_t length) { \
+        wide_type total = 0; \
+        for (size_t i = 0; i < length; i++) total += (wide_type)(total_type)a[i] * (wide_type)(total_type)b[i]; \
+        return (total_type)total; \
+    } \
+    \
+    static c_type min_##suffix##_scalar(const c_type* data, size_t length) { \
+        c_type result = data[0]; \
+        for (size_t i = 1; i < length; i++) if (data[i] < result) result = data[i]; \
+        return result; \
+    } \
+    \
+    static c_type max_##suffix##_scalar(const c_type* data, size_t length) { \
+        c_type result = data[0]; \
+        for (size_t i = 1; i < length; i++) if (data[i] > result) result = data[i]; \
+        return result; \
+    } \
+    \
+    static void scale_##suffix##_scalar(c_type* data, size_t length, c_type factor) { \
+        for (size_t i = 0; i < length; i++) data[i] = (c_type)((wide_type)(total_type)data[i] * (wide_type)(total_type)factor); \
+    } \
+    \
+    static void mask_lt_##suffix##_scalar(const c_type* restrict data, size_t length, c_type value, bool* restrict out) { \
+        for (size_t i = 0; i < length; i++) out[i] = data[i] < value; \
+    } \
+    \
+    static void mask_gt_##suffix##_scalar(const c_type* restrict data, size_t length, c_type value, bool* restrict out) { \
+        for (size_t i = 0; i < length; i++) out[i] = data[i] > value; \
+    } \
+    \
+    static void mask_eq_##suffix##_scalar(const c_type* restrict data, size_t length, c_type value, bool* restrict out) { \
+        for (size_t i = 0; i < length; i++) out[i] = data[i] == value; \
+    }
+
+KERNEL_TYPES(DEFINE_SCALAR_KERNELS)
+
+#ifdef PF_NUMERIC_X86
+// Loads of one register of lanes from narrower elements: widen_u8_32 reads
+// 4 (SSE2) or 8 (AVX2) bytes and zero-extends them to 32-bit lanes. SSE2
+// has no extending loads, so it interleaves with zeros or with copies of
+// the sign.
+static inline int32_t load_32(const void* data) {
+    int32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_same_sse2(const void* data) {
+    return _mm_loadu_si128((const __m128i*)data);
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_u8_32_sse2(const void* data) {
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(load_32(data)), zero), zero);
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_i8_32_sse2(const void* data) {
+    __m128i bytes = _mm_cvtsi32_si128(load_32(data));
+    __m128i words = _mm_unpacklo_epi8(bytes, bytes);
+    return _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 24);
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_u16_32_sse2(const void* data) {
+    return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)data), _mm_setzero_si128());
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_i16_32_sse2(const void* data) {
+    __m128i words = _mm_loadl_epi64((const __m128i*)data);
+    return _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_u16_64_sse2(const void* data) {
+    __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi32(_mm_unpacklo_epi16(_mm_cvtsi32_si128(load_32(data)), zero), zero);
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_i16_64_sse2(const void* data) {
+    __m128i words = _mm_cvtsi32_si128(load_32(data));
+    __m128i values = _mm_srai_epi32(_mm_unpacklo_epi16(words, words), 16);
+    return _mm_unpacklo_epi32(values, _mm_srai_epi32(values, 31));
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_u32_64_sse2(const void* data) {
+    return _mm_unpacklo_epi32(_mm_loadl_epi64((const __m128i*)data), _mm_setzero_si128());
+}
+
+__attribute__((target("sse2"))) static inline __m128i widen_i32_64_sse2(const void* data) {
+    __m128i values = _mm_loadl_epi64((const __m128i*)data);
+    return _mm_unpacklo_epi32(values, _mm_srai_epi32(values, 31));
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_same_avx2(const void* data) {
+    return _mm256_loadu_si256((const __m256i*)data);
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_u8_32_avx2(const void* data) {
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)data));
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_i8_32_avx2(const void* data) {
+    return _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)data));
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_u16_32_avx2(const void* data) {
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)data));
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_i16_32_avx2(const void* data) {
+    return _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)data));
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_u16_64_avx2(const void* data) {
+    return _mm256_cvtepu16_epi64(_mm_loadl_epi64((const __m128i*)data));
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_i16_64_avx2(const void* data) {
+    return _mm256_cvtepi16_epi64(_mm_loadl_epi64((const __m128i*)data));
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_u32_64_avx2(const void* data) {
+    return _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*)data));
+}
+
+__attribute__((target("avx2"))) static inline __m256i widen_i32_64_avx2(const void* data) {
+    return _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i*)data));
+}
+
+// The vector kernels are written once with GCC vector extensions and
+// compiled for each instruction set by the target attribute: a 32-byte
+// vector becomes one AVX2 register. Sums and dot products keep four
+// accumulators so consecutive adds do not wait on each other; min and max
+// select with a compare mask.
+#define DEFINE_VECTOR_KERNELS(isa, width, suffix, c_type, total_type, wide_type, arith_type, sum_lane, sum_widen, \
+                              dot_lane, dot_widen) \
+    typedef c_type isa##_##suffix##_vector __attribute__((vector_size(width))); \
+    typedef arith_type isa##_##suffix##_arith __attribute__((vector_size(width))); \
+    typedef sum_lane isa##_##suffix##_sum __attribute__((vector_size(width))); \
+    typedef dot_lane isa##_##suffix##_dot __attribute__((vector_size(width))); \
+    \
+    __attribute__((target(#isa))) \
+    static inline isa##_##suffix##_vector isa##_##suffix##_load(const c_type* data) { \
+        isa##_##suffix##_vector block; \
+        memcpy(&block, data, sizeof(block)); \
+        return block; \
+    } \
+    \
+    /* As many elements as fill a register once widened to lanes */ \
+    __attribute__((target(#isa))) \
+    static inline isa##_##suffix##_sum isa##_##suffix##_load_sum(const c_type* data) { \
+        return (isa##_##suffix##_sum)widen_##sum_widen##_##isa(data); \
+    } \
+    \
+    __attribute__((target(#isa))) \
+    static inline isa##_##suffix##_dot isa##_##suffix##_load_dot(const c_type* data) { \
+        return (isa##_##suffix##_dot)widen_##dot_widen##_##isa(data); \
+    } \
+    \
+    __attribute__((target(#isa))) \
+    static total_type sum_##suffix##_##isa(const c_type* data, size_t length) { \
+        enum { LANES = width / sizeof(sum_lane) }; \
+        wide_type total = 0; \
+        size_t i = 0; \
+        while (i + LANES <= length) { \
+            isa##_##suffix##_sum acc[4] = {{0}}; \
+            size_t end = length - i > BLOCK ? i + BLOCK : length; \
+            for (; i + 4 * LANES <= end; i += 4 * LANES) { \
+                for (int k = 0; k < 4; k++) acc[k] += isa##_##suffix##_load_sum(data + i + k * LANES); \
+            } \
+            for (; i + LANES <= end; i += LANES) { \
+                acc[0] += isa##_##suffix##_load_sum(data + i); \
+            } \
+            isa##_##suffix##_sum lanes = (acc[0] + acc[1]) + (acc[2] + acc[3]); \
+            for (int l = 0; l < LANES; l++) total += (wide_type)(total_type)lanes[l]; \
+        } \
+        return (total_type)(total + (wide_type)sum_##suffix##_scalar(data + i, length - i)); \
+    } \
+    \
+    __attribute__((target(#isa))) \
+    static total_type dot_##suffix##_##isa(const c_type* a, const c_type* b, size_t length) { \
+        enum { LANES = width / sizeof(dot_lane) }; \
+        wide_type total = 0; \
+        size_t i = 0; \
+        while (i + LANES <= length) { \
+            isa##_##suffix##_dot acc[4] = {{0}}; \
+            size_t end = length - i > BLOCK ? i + BLOCK : length; \
+            for (; i + 4 * LANES <= end; i += 4 * LANES) { \
+                for (int k = 0; k < 4; k++) { \
+                    acc[k] += isa##_##suffix##_load_dot(a + i + k * LANES) * isa##_##suffix##_load_dot(b + i + k * LANES); \
+                } \
+            } \
+            for (; i + LANES <= end; i += LANES) { \
+                acc[0] += isa##_##suffix##_load_dot(a + i) * isa##_##suffix##_load_dot(b + i); \
+            } \
+            isa##_##suffix##_dot lanes = (acc[0] + acc[1]) + (acc[2] + acc[3]); \
+            for (int l = 0; l < LANES; l++) total += (wide_type)(total_type)lanes[l]; \
+        } \
+        return (total_type)(total + (wide_type)dot_##suffix##_scalar(a + i, b + i, length - i)); \
+    } \
+    \
+    DEFINE_VECTOR_EXTREME(isa, width, suffix, c_type, min, <) \
+    DEFINE_VECTOR_EXTREME(isa, width, suffix, c_type, max, >) \
+    \
+    __attribute__((target(#isa))) \
+    static void scale_##suffix##_##isa(c_type* data, size_t length, c_type factor) { \
+        enum { LANES = width / sizeof(c_type) }; \
+        size_t i = 0; \
+        for (; i + LANES <= length; i += LANES) { \
+            isa##_##suffix##_arith block; \
+            memcpy(&block, data + i, sizeof(block)); \
+            block *= (arith_type)factor; \
+            memcpy(data + i, &block, sizeof(block)); \
+        } \
+        scale_##suffix##_scalar(data + i, length - i, factor); \
+    } \
+    \
+    DEFINE_VECTOR_MASK(isa, width, suffix, c_type, mask_lt, <) \
+    DEFINE_VECTOR_MASK(isa, width, suffix, c_type, mask_gt, >) \
+    DEFINE_VECTOR_MASK(isa, width, suffix, c_type, mask_eq, ==)
+
+// Keep the lanes of block that win the comparison against best
+#define DEFINE_VECTOR_EXTREME(isa, width, suffix, c_type, name, op) \
+    __attribute__((target(#isa))) \
+    static c_type name##_##suffix##_##isa(const c_type* data, size_t length) { \
+        enum { LANES = width / sizeof(c_type) }; \
+        if (length < LANES) return name##_##suffix##_scalar(data, length); \
+        isa##_##suffix##_vector best = isa##_##suffix##_load(data); \
+        size_t i = LANES; \
+        for (; i + LANES <= length; i += LANES) { \
+            isa##_##suffix##_vector block = isa##_##suffix##_load(data + i); \
+            __typeof__(block op best) wins = block op best; \
+            best = (isa##_##suffix##_vector)(((__typeof__(wins))block & wins) | ((__typeof__(wins))best & ~wins)); \
+        } \
+        c_type result = best[0]; \
+        for (int l = 1; l < LANES; l++) if (best[l] op result) result = best[l]; \
+        for (; i < length; i++) if (data[i] op result) result = data[i]; \
+        return result; \
+    }
+
+// Narrowing compare results to bools is left to the compiler's own
+// vectorizer, which packs them with the instruction set's saturating packs;
+// chunks of a fixed size let it do so without a runtime trip count check
+#define DEFINE_VECTOR_MASK(isa, width, suffix, c_type, name, op) \
+    __attribute__((target(#isa))) \
+    static void name##_##suffix##_##isa(const c_type* restrict data, size_t length, c_type value, \
+                                        bool* restrict out) { \
+        size_t i = 0; \
+        for (; i + MASK_CHUNK <= length; i += MASK_CHUNK) { \
+            for (size_t j = 0; j < MASK_CHUNK; j++) out[i + j] = data[i + j] op value; \
+        } \
+        name##_##suffix##_scalar(data + i, length - i, value, out + i); \
+    }
+
+#define DEFINE_SSE2_KERNELS(...) DEFINE_VECTOR_KERNELS(sse2, 16, __VA_ARGS__)
+#define DEFINE_AVX2_KERNELS(...) DEFINE_VECTOR_KERNELS(avx2, 32, __VA_ARGS__)
+
+KERNEL_TYPES(DEFINE_SSE2_KERNELS)
+KERNEL_TYPES(DEFINE_AVX2_KERNELS)
+#endif
+
+#define KERNEL_FIELDS(suffix, c_type, total_type, ...) \
+    total_type (*sum_##suffix)(const c_type* data, size_t length); \
+    total_type (*dot_##suffix)(const c_type* a, const c_type* b, size_t length); \
+    c_type (*min_##suffix)(const c_type* data, size_t length); \
+    c_type (*max_##suffix)(const c_type* data, size_t length); \
+    void (*scale_##suffix)(c_type* data, size_t length, c_type factor); \
+    void (*mask_lt_##suffix)(const c_type* data, size_t length, c_type value, bool* out); \
+    void (*mask_gt_##suffix)(const c_type* data, size_t length, c_type value, bool* out); \
+    void (*mask_eq_##suffix)(const c_type* data, size_t length, c_type value, bool* out);
+
+// One kernel per operation and element type; min and max need at least one
+// element
+typedef struct {
+    const char* name;
+    KERNEL_TYPES(KERNEL_FIELDS)
+} NumericKernels;
+
+#define KERNEL_ENTRIES(isa, suffix, ...) \
+    .sum_##suffix = sum_##suffix##_##isa, \
+    .dot_##suffix = dot_##suffix##_##isa, \
+    .min_##suffix = min_##suffix##_##isa, \
+    .max_##suffix = max_##suffix##_##isa, \
+    .scale_##suffix = scale_##suffix##_##isa, \
+    .mask_lt_##suffix = mask_lt_##suffix##_##isa, \
+    .mask_gt_##suffix = mask_gt_##suffix##_##isa, \
+    .mask_eq_##suffix = mask_eq_##suffix##_##isa,
+
+#define SCALAR_ENTRIES(...) KERNEL_ENTRIES(scalar, __VA_ARGS__)
+static const NumericKernels scalar_kernels = {.name = "scalar", KERNEL_TYPES(SCALAR_ENTRIES)};
+
+#ifdef PF_NUMERIC_X86
+#define SSE2_ENTRIES(...) KERNEL_ENTRIES(sse2, __VA_ARGS__)
+#define AVX2_ENTRIES(...) KERNEL_ENTRIES(avx2, __VA_ARGS__)
+static const NumericKernels sse2_kernels = {.name = "sse2", KERNEL_TYPES(SSE2_ENTRIES)};
+static const NumericKernels avx2_kernels = {.name = "avx2", KERNEL_TYPES(AVX2_ENTRIES)};
+#endif
+
+static _Atomic(const NumericKernels*) active_kernels = NULL;
+
+static const NumericKernels* best_kernels(void) {
+#ifdef PF_NUMERIC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &avx2_kernels;
+    if (__builtin_cpu_supports("sse2")) return &sse2_kernels;
+#endif
+    return &scalar_kernels;
+}
+
+static const NumericKernels* kernels(void) {
+    const NumericKernels* selected = atomic_load_explicit(&active_kernels, memory_order_acquire);
+    if (selected == NULL) {
+        // Racing threads all pick the same set
+        selected = best_kernels();
+        atomic_store_explicit(&active_kernels, selected, memory_order_release);
+    }
+    return selected;
+}
+
+const char* pf_numeric_kernels(void) {
+    return kernels()->name;
+}
+
+bool pf_numeric_use_kernels(const char* name) {
+    const NumericKernels* selected = NULL;
+    if (strcmp(name, "scalar") == 0) selected = &scalar_kernels;
+#ifdef PF_NUMERIC_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) selected = &sse2_kernels;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) selected = &avx2_kernels;
+#endif
+    if (selected == NULL) return false;
+    atomic_store_explicit(&active_kernels, selected, memory_order_release);
+    return true;
+}
+
+static _Noreturn void empty_error(const char* function, int line) {
+    pf_output_flush();
+    fprintf(stderr, "[line %d] Error: %s() of an empty array\n", line, function);
+    exit(1);
+}
+
+static _Noreturn void length_error(const char* function, int64_t a, int64_t b, int line) {
+    pf_output_flush();
+    fprintf(stderr, "[line %d] Error: %s() of arrays of lengths %" PRId64 " and %" PRId64 "\n",
+            line, function, a, b);
+    exit(1);
+}
+
+#define DEFINE_MASK(suffix, c_type, name) \
+    pf_array_bool pf_##name##_##suffix(pf_array_##suffix xs, c_type value, int line) { \
+        pf_array_bool mask = pf_array_bool_new(xs.length, line); \
+        kernels()->name##_##suffix(xs.data, (size_t)xs.length, value, mask.data); \
+        return mask; \
+    }
+
+#define DEFINE_NUMERIC(suffix, c_type, total_type, ...) \
+    total_type pf_sum_##suffix(pf_array_##suffix xs) { \
+        return kernels()->sum_##suffix(xs.data, (size_t)xs.length); \
+    } \
+    \
+    total_type pf_dot_##suffix(pf_array_##suffix a, pf_array_##suffix b, int line) { \
+        if (a.length != b.length) length_error("dot", a.length, b.length, line); \
+        return kernels()->dot_##suffix(a.data, b.data, (size_t)a.length); \
+    } \
+    \
+    c_type pf_min_##suffix(pf_array_##suffix xs, int line) { \
+        if (xs.length == 0) empty_error("min", line); \
+        return kernels()->min_##suffix(xs.data, (size_t)xs.length); \
+    } \
+    \
+    c_type pf_max_##suffix(pf_array_##suffix xs, int line) { \
+        if (xs.length == 0) empty_error("max", line); \
+        return kernels()->max_##suffix(xs.data, (size_t)xs.length); \
+    } \
+    \
+    void pf_scale_##suffix(pf_array_##suffix xs, c_type factor) { \
+        kernels()->scale_##suffix(xs.data, (size_t)xs.length, factor); \
+    } \
+    \
+    DEFINE_MASK(suffix, c_type, mask_lt) \
+    DEFINE_MASK(suffix, c_type, mask_gt) \
+    DEFINE_MASK(suffix, c_type, mask_eq)
+
+KERNEL_TYPES(DEFINE_NUMERIC)
@@ -0,0 +1,90 @@
+#include "../../include/runtime/pf_output.h"
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+typedef struct {
+    char data[PF_OUTPUT_BUFFER_SIZE];
+    size_t length;
+} OutputBuffer;
+
+static _Thread_local OutputBuffer buffer;
+
+static bool line_buffered = false;
+
+static _Atomic uint64_t stat_bytes = 0;
+static _Atomic uint64_t stat_syscalls = 0;
+static _Atomic uint64_t stat_flushes = 0;
+
+void pf_output_init(void) {
+    // Someone watching a terminal wants each line as it is printed; pipes
+    // and files only care about throughput
+    line_buffered = isatty(STDOUT_FILENO);
+}
+
+// Write every byte of the vectors, resuming after short writes
+static void write_all(struct iovec* vectors, int count) {
+    while (count > 0) {
+        ssize_t written = count == 1 ? write(STDOUT_FILENO, vectors[0].iov_base, vectors[0].iov_len)
+                                     : writev(STDOUT_FILENO, vectors, count);
+        atomic_fetch_add_explicit(&stat_syscalls, 1, memory_order_relaxed);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        atomic_fetch_add_explicit(&stat_bytes, (uint64_t)written, memory_order_relaxed);
+
+        size_t remaining = (size_t)written;
+        while (count > 0 && remaining >= vectors[0].iov_len) {
+            remaining -= vectors[0].iov_len;
+            vectors++;
+            count--;
+        }
+        if (count > 0) {
+            vectors[0].iov_base = (char*)vectors[0].iov_base + remaining;
+            vectors[0].iov_len -= remaining;
+        }
+    }
+}
+
+void pf_output_flush(void) {
+    if (buffer.length == 0) return;
+
+    struct iovec vector = {buffer.data, buffer.length};
+    write_all(&vector, 1);
+    buffer.length = 0;
+    atomic_fetch_add_explicit(&stat_flushes, 1, memory_order_relaxed);
+}
+
+void pf_output_write(const char* data, size_t length) {
+    if (length > PF_OUTPUT_BUFFER_SIZE - buffer.length) {
+        // Send what is buffered and the new bytes in one system call
+        struct iovec vectors[2] = {
+            {buffer.data, buffer.length},
+            {(void*)data, length},
+        };
+        write_all(buffer.length > 0 ? vectors : vectors + 1, buffer.length > 0 ? 2 : 1);
+        buffer.length = 0;
+        atomic_fetch_add_explicit(&stat_flushes, 1, memory_order_relaxed);
+        return;
+    }
+
+    memcpy(buffer.data + buffer.length, data, length);
+    buffer.length += length;
+
+    if (line_buffered && memchr(data, '\n', length) != NULL) {
+        pf_output_flush();
+    }
+}
+
+pf_output_stats pf_output_get_stats(void) {
+    pf_output_stats stats;
+    stats.bytes = atomic_load_explicit(&stat_bytes, memory_order_relaxed);
+    stats.syscalls = atomic_load_explicit(&stat_syscalls, memory_order_relaxed);
+    stats.flushes = atomic_load_explicit(&stat_flushes, memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,190 @@
+// Parallel loops: timing the grain, chunks on helper tasks, and reductions
+#include "../../include/runtime/pf_par.h"
+#include "../../include/runtime/pf_task.h"
+#include "../../include/runtime/pf_gc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define DEFAULT_CHUNK_US 50
+// Chunks per worker to aim for, so that workers finishing early find more
+#define CHUNKS_PER_WORKER 8
+// Partial results up to this size live on the caller's stack while timing
+#define LOCAL_PARTIAL 256
+
+typedef struct {
+    pf_par_body body;
+    pf_par_reduce_body reduce;      // Instead of body for a reduction
+    void* context;
+    int64_t first;                  // Where the first chunk starts
+    int64_t count;
+    int64_t grain;
+    int64_t chunk_count;
+    _Atomic int64_t next_chunk;
+    char* partials;                 // One per chunk for a reduction
+    size_t size;
+    _Atomic int helpers;            // Spawned and not through yet
+    pf_parker parker;               // The caller waiting for them
+} Loop;
+
+static struct {
+    pthread_once_t once;
+    int64_t chunk_ns;
+    _Atomic uint64_t loops;
+    _Atomic uint64_t sequential;
+    _Atomic uint64_t chunks;
+    _Atomic uint64_t helpers;
+    _Atomic int64_t last_grain;
+} parallel = {.once = PTHREAD_ONCE_INIT};
+
+static void configure(void) {
+    const char* text = getenv("PFLANG_PAR_CHUNK_US");
+    long microseconds = text != NULL ? strtol(text, NULL, 10) : 0;
+    parallel.chunk_ns = (int64_t)(microseconds > 0 ? microseconds : DEFAULT_CHUNK_US) * 1000;
+}
+
+static int64_t now_ns(void) {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+static void run_piece(Loop* loop, int64_t first, int64_t last, void* partial) {
+    if (loop->reduce != NULL) {
+        loop->reduce(loop->context, first, last, partial);
+    } else {
+        loop->body(loop->context, first, last);
+    }
+}
+
+static void run_chunks(Loop* loop) {
+    for (;;) {
+        int64_t chunk = atomic_fetch_add_explicit(&loop->next_chunk, 1, memory_order_relaxed);
+        if (chunk >= loop->chunk_count) return;
+        int64_t first = loop->first + chunk * loop->grain;
+        int64_t last = loop->count - first > loop->grain ? first + loop->grain : loop->count;
+        run_piece(loop, first, last, loop->partials != NULL ? loop->partials + (size_t)chunk * loop->size : NULL);
+    }
+}
+
+// The loop lives on the caller's stack and may be gone as soon as the
+// last helper has unparked the caller
+static void help(void* argument) {
+    Loop* loop = *(Loop**)argument;
+    run_chunks(loop);
+    if (atomic_fetch_sub(&loop->helpers, 1) == 1) pf_parker_unpark(&loop->parker, 0);
+}
+
+static void* allocate_partials(size_t size) {
+    void* partials = calloc(1, size);
+    if (partials == NULL) {
+        fprintf(stderr, "Error: out of memory in a parallel loop\n");
+        exit(1);
+    }
+    pf_gc_add_roots(partials, size);
+    return partials;
+}
+
+static void free_partials(void* partials) {
+    pf_gc_remove_roots(partials);
+    free(partials);
+}
+
+static void run_loop(int64_t count, pf_par_body body, pf_par_reduce_body reduce, pf_par_combine combine,
+                     void* context, void* result, size_t size) {
+    pthread_once(&parallel.once, configure);
+    atomic_fetch_add_explicit(&parallel.loops, 1, memory_order_relaxed);
+    if (count <= 0) {
+        atomic_fetch_add_explicit(&parallel.sequential, 1, memory_order_relaxed);
+        return;
+    }
+
+    Loop loop = {.body = body, .reduce = reduce, .context = context, .count = count, .size = size};
+    _Alignas(16) char local[LOCAL_PARTIAL] = {0};
+    void* scratch = reduce == NULL ? NULL : size <= LOCAL_PARTIAL ? local : allocate_partials(size);
+
+    // Time pieces of 1, 2, 4, ... iterations until they have taken a
+    // fifth of a chunk; the first piece's partial is the result so far
+    int64_t done = 0;
+    int64_t piece = 1;
+    int64_t start = now_ns();
+    int64_t elapsed = 0;
+    while (done < count && elapsed < parallel.chunk_ns / 5) {
+        int64_t last = count - done > piece ? done + piece : count;
+        run_piece(&loop, done, last, done == 0 ? result : scratch);
+        if (done > 0 && reduce != NULL) combine(context, result, scratch);
+        done = last;
+        piece *= 2;
+        elapsed = now_ns() - start;
+    }
+
+    int64_t remaining = count - done;
+    int helpers = 0;
+    if (remaining > 0) {
+        int64_t grain = (int64_t)((double)parallel.chunk_ns * (double)done / (double)(elapsed > 0 ? elapsed : 1));
+        int workers = pf_task_worker_count();
+        int64_t balanced = remaining / ((int64_t)workers * CHUNKS_PER_WORKER);
+        if (grain < balanced) grain = balanced;
+        if (grain < 1) grain = 1;
+        loop.first = done;
+        loop.grain = grain;
+        loop.chunk_count = (remaining + grain - 1) / grain;
+
+        // A caller on a task already occupies one of the workers
+        int idle = pf_task_in_task() ? workers - 1 : workers;
+        helpers = loop.chunk_count - 1 < idle ? (int)(loop.chunk_count - 1) : idle;
+        if (helpers > 0) atomic_store_explicit(&parallel.last_grain, grain, memory_order_relaxed);
+    }
+
+    if (remaining > 0 && helpers == 0) {
+        run_piece(&loop, done, count, scratch);
+        if (reduce != NULL) combine(context, result, scratch);
+    }
+    if (helpers == 0) {
+        atomic_fetch_add_explicit(&parallel.sequential, 1, memory_order_relaxed);
+        if (scratch != NULL && scratch != local) free_partials(scratch);
+        return;
+    }
+
+    if (reduce != NULL) loop.partials = allocate_partials((size_t)loop.chunk_count * size);
+    atomic_init(&loop.next_chunk, 0);
+    atomic_init(&loop.helpers, helpers);
+    pf_parker_prepare(&loop.parker);
+    Loop* shared = &loop;
+    for (int i = 0; i < helpers; i++) {
+        pf_task_spawn(help, &shared, sizeof(shared));
+    }
+    atomic_fetch_add_explicit(&parallel.helpers, (uint64_t)helpers, memory_order_relaxed);
+    atomic_fetch_add_explicit(&parallel.chunks, (uint64_t)loop.chunk_count, memory_order_relaxed);
+    run_chunks(&loop);
+    pf_parker_park(&loop.parker);
+
+    if (reduce != NULL) {
+        for (int64_t chunk = 0; chunk < loop.chunk_count; chunk++) {
+            combine(context, result, loop.partials + (size_t)chunk * size);
+        }
+        free_partials(loop.partials);
+        if (scratch != local) free_partials(scratch);
+    }
+}
+
+void pf_parallel_for(int64_t count, pf_par_body body, void* context) {
+    run_loop(count, body, NULL, NULL, context, NULL, 0);
+}
+
+void pf_parallel_reduce(int64_t count, pf_par_reduce_body body, pf_par_combine combine, void* context,
+                        void* result, size_t size) {
+    run_loop(count, NULL, body, combine, context, result, size);
+}
+
+void pf_par_get_statistics(pf_par_statistics* statistics) {
+    statistics->loops = atomic_load(&parallel.loops);
+    statistics->sequential = atomic_load(&parallel.sequential);
+    statistics->chunks = atomic_load(&parallel.chunks);
+    statistics->helpers = atomic_load(&parallel.helpers);
+    statistics->last_grain = atomic_load(&parallel.last_grain);
+}
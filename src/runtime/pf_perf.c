@@ -0,0 +1,239 @@
+#include "../../include/runtime/pf_perf.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define JITDUMP_MAGIC 0x4A695444
+#define JITDUMP_VERSION 1
+
+// Record ids from tools/perf/util/jitdump.h
+#define JIT_CODE_LOAD 0
+#define JIT_CODE_DEBUG_INFO 2
+
+#if defined(__x86_64__)
+#define JITDUMP_ELF_MACH 62   // EM_X86_64
+#elif defined(__aarch64__)
+#define JITDUMP_ELF_MACH 183  // EM_AARCH64
+#elif defined(__i386__)
+#define JITDUMP_ELF_MACH 3    // EM_386
+#else
+#define JITDUMP_ELF_MACH 0
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+} JitDumpHeader;
+
+typedef struct {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+} JitDumpRecordPrefix;
+
+// perf matches jitdump records against samples using CLOCK_MONOTONIC
+// (perf record -k 1)
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t current_tid(void) {
+#ifdef __linux__
+    return (uint32_t)syscall(SYS_gettid);
+#else
+    return (uint32_t)getpid();
+#endif
+}
+
+bool perf_map_open(PerfMap* map) {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+    return perf_map_open_path(map, path);
+}
+
+bool perf_map_open_path(PerfMap* map, const char* path) {
+    map->file = fopen(path, "a");
+    if (map->file == NULL) {
+        fprintf(stderr, "Warning: Could not open perf map \"%s\"\n", path);
+        return false;
+    }
+    return true;
+}
+
+void perf_map_write_entry(PerfMap* map, const void* code, size_t size, const char* name) {
+    if (map->file == NULL) return;
+
+    fprintf(map->file, "%lx %zx %s\n", (unsigned long)(uintptr_t)code, size, name);
+    // perf may read the map while we are still running, so never leave a
+    // partial line buffered
+    fflush(map->file);
+}
+
+void perf_map_close(PerfMap* map) {
+    if (map->file != NULL) {
+        fclose(map->file);
+        map->file = NULL;
+    }
+}
+
+bool jitdump_open(JitDump* dump, const char* directory) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/jit-%d.dump", directory, (int)getpid());
+
+    dump->file = fopen(path, "w+");
+    dump->marker = NULL;
+    dump->marker_size = 0;
+    dump->code_index = 0;
+    if (dump->file == NULL) {
+        fprintf(stderr, "Warning: Could not open jitdump \"%s\"\n", path);
+        return false;
+    }
+
+    // perf record only notices the dump through an executable mmap of it
+    long page_size = sysconf(_SC_PAGESIZE);
+    void* marker = mmap(NULL, (size_t)page_size, PROT_READ | PROT_EXEC, MAP_PRIVATE,
+                        fileno(dump->file), 0);
+    if (marker != MAP_FAILED) {
+        dump->marker = marker;
+        dump->marker_size = (size_t)page_size;
+    }
+
+    JitDumpHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = JITDUMP_MAGIC;
+    header.version = JITDUMP_VERSION;
+    header.total_size = sizeof(header);
+    header.elf_mach = JITDUMP_ELF_MACH;
+    header.pid = (uint32_t)getpid();
+    header.timestamp = monotonic_ns();
+
+    fwrite(&header, sizeof(header), 1, dump->file);
+    fflush(dump->file);
+    return true;
+}
+
+static void write_debug_info(JitDump* dump, const void* code, const char* source_file, int line) {
+    size_t file_length = strlen(source_file) + 1;
+
+    JitDumpRecordPrefix prefix;
+    prefix.id = JIT_CODE_DEBUG_INFO;
+    prefix.total_size = (uint32_t)(sizeof(prefix) + 2 * sizeof(uint64_t) +
+                                   sizeof(uint64_t) + 2 * sizeof(uint32_t) + file_length);
+    prefix.timestamp = monotonic_ns();
+
+    uint64_t code_addr = (uint64_t)(uintptr_t)code;
+    uint64_t entry_count = 1;
+    uint32_t line_number = (uint32_t)line;
+    uint32_t discriminator = 0;
+
+    fwrite(&prefix, sizeof(prefix), 1, dump->file);
+    fwrite(&code_addr, sizeof(code_addr), 1, dump->file);
+    fwrite(&entry_count, sizeof(entry_count), 1, dump->file);
+    fwrite(&code_addr, sizeof(code_addr), 1, dump->file);
+    fwrite(&line_number, sizeof(line_number), 1, dump->file);
+    fwrite(&discriminator, sizeof(discriminator), 1, dump->file);
+    fwrite(source_file, file_length, 1, dump->file);
+}
+
+void jitdump_write_code_load(JitDump* dump, const void* code, size_t size, const char* name,
+                             const char* source_file, int line) {
+    if (dump->file == NULL) return;
+
+    // Debug info has to precede the load record it describes
+    if (source_file != NULL && line > 0) {
+        write_debug_info(dump, code, source_file, line);
+    }
+
+    size_t name_length = strlen(name) + 1;
+
+    JitDumpRecordPrefix prefix;
+    prefix.id = JIT_CODE_LOAD;
+    prefix.total_size = (uint32_t)(sizeof(prefix) + 2 * sizeof(uint32_t) +
+                                   4 * sizeof(uint64_t) + name_length + size);
+    prefix.timestamp = monotonic_ns();
+
+    uint32_t pid = (uint32_t)getpid();
+    uint32_t tid = current_tid();
+    uint64_t vma = (uint64_t)(uintptr_t)code;
+    uint64_t code_size = size;
+    uint64_t code_index = dump->code_index++;
+
+    fwrite(&prefix, sizeof(prefix), 1, dump->file);
+    fwrite(&pid, sizeof(pid), 1, dump->file);
+    fwrite(&tid, sizeof(tid), 1, dump->file);
+    fwrite(&vma, sizeof(vma), 1, dump->file);
+    fwrite(&vma, sizeof(vma), 1, dump->file);
+    fwrite(&code_size, sizeof(code_size), 1, dump->file);
+    fwrite(&code_index, sizeof(code_index), 1, dump->file);
+    fwrite(name, name_length, 1, dump->file);
+    // perf inject rebuilds an ELF image from the bytes, so copy the code itself
+    fwrite(code, size, 1, dump->file);
+    fflush(dump->file);
+}
+
+void jitdump_close(JitDump* dump) {
+    if (dump->marker != NULL) {
+        munmap(dump->marker, dump->marker_size);
+        dump->marker = NULL;
+    }
+    if (dump->file != NULL) {
+        fclose(dump->file);
+        dump->file = NULL;
+    }
+}
+
+static int compare_code(const void* a, const void* b) {
+    uintptr_t x = (uintptr_t)((const pf_perf_symbol*)a)->code;
+    uintptr_t y = (uintptr_t)((const pf_perf_symbol*)b)->code;
+    return (x > y) - (x < y);
+}
+
+void pf_perf_register(const pf_perf_symbol* symbols, int count, const void* code_end, const char* source_file) {
+    PerfMap map;
+    const char* path = getenv("PFLANG_PERF_MAP");
+    if (path != NULL && path[0] != '\0') {
+        perf_map_open_path(&map, path);
+    } else {
+        perf_map_open(&map);
+    }
+    JitDump dump = {NULL, NULL, 0, 0};
+    const char* directory = getenv("PFLANG_JITDUMP");
+    if (directory != NULL && directory[0] != '\0') jitdump_open(&dump, directory);
+
+    // The functions fill their section back to back, so each one ends
+    // where the next one starts and the last one at the section's end
+    pf_perf_symbol* sorted = malloc(sizeof(pf_perf_symbol) * (size_t)(count > 0 ? count : 1));
+    if (sorted == NULL) {
+        fprintf(stderr, "Error: out of memory registering perf symbols\n");
+        exit(1);
+    }
+    memcpy(sorted, symbols, sizeof(pf_perf_symbol) * (size_t)count);
+    qsort(sorted, (size_t)count, sizeof(pf_perf_symbol), compare_code);
+    for (int i = 0; i < count; i++) {
+        const void* end = i + 1 < count ? sorted[i + 1].code : code_end;
+        size_t size = (size_t)((uintptr_t)end - (uintptr_t)sorted[i].code);
+        if (size == 0) continue;
+        perf_map_write_entry(&map, sorted[i].code, size, sorted[i].name);
+        jitdump_write_code_load(&dump, sorted[i].code, size, sorted[i].name, source_file, sorted[i].line);
+    }
+    free(sorted);
+
+    // perf record has seen the dump mapped by now; perf inject reads the
+    // file itself afterwards
+    jitdump_close(&dump);
+    perf_map_close(&map);
+}
@@ -0,0 +1,351 @@
+#include "../../include/runtime/pf_runtime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <math.h>
+
+#define FORMAT_BUFFER_COUNT 8
+#define FORMAT_BUFFER_SIZE 1024
+
+// A slot starts out in its static storage and moves to the heap for good
+// once a result outgrows it
+typedef struct {
+    char* data;                 // Null until the slot is first used
+    size_t capacity;
+} FormatBuffer;
+
+static _Thread_local char format_storage[FORMAT_BUFFER_COUNT][FORMAT_BUFFER_SIZE];
+static _Thread_local FormatBuffer format_buffers[FORMAT_BUFFER_COUNT];
+static _Thread_local int next_format_buffer = 0;
+
+static void flush_at_exit(void) {
+    pf_output_flush();
+}
+
+void pf_runtime_init(void) {
+    pf_output_init();
+    pf_gc_init();
+    // Output printed before an exit() from anywhere must not be lost
+    atexit(flush_at_exit);
+}
+
+void pf_runtime_shutdown(void) {
+    // The program ends once main and every task it started have returned
+    pf_task_wait();
+    pf_output_flush();
+
+    if (getenv("PFLANG_RUNTIME_STATS") != NULL) {
+        pf_output_stats stats = pf_output_get_stats();
+        fprintf(stderr, "pflang runtime: %" PRIu64 " bytes written in %" PRIu64 " syscalls (%" PRIu64 " flushes)\n",
+                stats.bytes, stats.syscalls, stats.flushes);
+    }
+    const char* gc_stats = getenv("PFLANG_GC_STATS");
+    if (gc_stats != NULL && gc_stats[0] != '\0') {
+        pf_gc_print_statistics(stderr);
+    }
+}
+
+void pf_write_call_profile(const pf_call_site* sites, const uint64_t* counts, int count) {
+    const char* path = getenv("PFLANG_CALL_PROFILE");
+    if (path == NULL || path[0] == '\0') path = "pflang.prof";
+
+    FILE* out = fopen(path, "w");
+    if (out == NULL) {
+        fprintf(stderr, "pflang runtime: could not write call profile \"%s\"\n", path);
+        return;
+    }
+    fputs("# caller line callee calls\n", out);
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "%s %d %s %" PRIu64 "\n", sites[i].caller, sites[i].line, sites[i].callee, counts[i]);
+    }
+    fclose(out);
+}
+
+pf_error pf_error_new(pf_str message) {
+    pf_error error = {message != NULL ? message : ""};
+    return error;
+}
+
+// Messages are raw bytes on the collected heap. Errors are only ever held
+// in locals, results and task arguments, whose stacks the collector scans,
+// so a message lives as long as some error still points at it.
+static pf_error collected_error(const char* message, size_t length) {
+    char* copy = pf_gc_allocate(length + 1, PF_GC_BYTES);
+    memcpy(copy, message, length);
+    return pf_error_new(copy);
+}
+
+pf_error pf_error_copy(pf_str message) {
+    if (message == NULL) return pf_error_new(NULL);
+    return collected_error(message, strlen(message));
+}
+
+pf_error pf_error_from_string(pf_string message) {
+    return collected_error(pf_string_data(&message), message.length);
+}
+
+_Noreturn void pf_arith_overflow(const char* operation, int line) {
+    // Keep what the program printed before the error in order with it
+    pf_output_flush();
+    fprintf(stderr, "[line %d] Error: %s overflow\n", line, operation);
+    exit(1);
+}
+
+_Noreturn void pf_arith_divide_by_zero(int line) {
+    pf_output_flush();
+    fprintf(stderr, "[line %d] Error: division by zero\n", line);
+    exit(1);
+}
+
+_Noreturn void pf_range_step_error(int line) {
+    pf_output_flush();
+    fprintf(stderr, "[line %d] Error: range() step is zero\n", line);
+    exit(1);
+}
+
+pf_fmt pf_fmt_begin(void) {
+    int slot = next_format_buffer;
+    next_format_buffer = (next_format_buffer + 1) % FORMAT_BUFFER_COUNT;
+    FormatBuffer* buffer = &format_buffers[slot];
+    if (buffer->data == NULL) {
+        buffer->data = format_storage[slot];
+        buffer->capacity = FORMAT_BUFFER_SIZE;
+    }
+    pf_fmt fmt = {buffer->data, 0, buffer->capacity, slot};
+    return fmt;
+}
+
+// Move the result to a bigger heap buffer, which becomes its slot's
+static void grow_format(pf_fmt* fmt, size_t needed) {
+    size_t capacity = fmt->capacity * 2;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    char* data = malloc(capacity);
+    if (data == NULL) {
+        fprintf(stderr, "Error: out of memory formatting a %zu byte string\n", needed);
+        exit(1);
+    }
+    memcpy(data, fmt->data, fmt->length);
+    FormatBuffer* buffer = &format_buffers[fmt->slot];
+    if (buffer->data != format_storage[fmt->slot]) free(buffer->data);
+    buffer->data = data;
+    buffer->capacity = capacity;
+    fmt->data = data;
+    fmt->capacity = capacity;
+}
+
+void pf_fmt_literal(pf_fmt* fmt, const char* text, size_t length) {
+    // One byte always stays free for pf_fmt_end's terminator
+    if (length >= fmt->capacity - fmt->length) grow_format(fmt, fmt->length + length + 1);
+    memcpy(fmt->data + fmt->length, text, length);
+    fmt->length += length;
+}
+
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+// Write value in decimal, two digits per division, ending at end; returns
+// where the digits start
+static char* decimal_digits(char* end, uint64_t value) {
+    char* p = end;
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        unsigned pair = (unsigned)value * 2;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    } else {
+        *--p = (char)('0' + value);
+    }
+    return p;
+}
+
+void pf_fmt_uint(pf_fmt* fmt, uint64_t value) {
+    char digits[20];
+    char* start = decimal_digits(digits + sizeof(digits), value);
+    pf_fmt_literal(fmt, start, (size_t)(digits + sizeof(digits) - start));
+}
+
+void pf_fmt_int(pf_fmt* fmt, int64_t value) {
+    char digits[21];
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    char* start = decimal_digits(digits + sizeof(digits), magnitude);
+    if (value < 0) *--start = '-';
+    pf_fmt_literal(fmt, start, (size_t)(digits + sizeof(digits) - start));
+}
+
+void pf_fmt_float(pf_fmt* fmt, double value) {
+    // %g prints integral values below a million without exponent or
+    // fraction, which is exactly what the integer path produces
+    if (value == (double)(int64_t)value && value > -1e6 && value < 1e6 &&
+        !(value == 0 && signbit(value))) {
+        pf_fmt_int(fmt, (int64_t)value);
+        return;
+    }
+
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%g", value);
+    if (length > 0) pf_fmt_literal(fmt, text, (size_t)length);
+}
+
+static void format_double(pf_fmt* fmt, const char* conversion, double value, int precision) {
+    if (precision < 0) precision = 0;
+    if (precision > PF_FMT_MAX_PRECISION) precision = PF_FMT_MAX_PRECISION;
+
+    // Room for the 309 integer digits of DBL_MAX in fixed notation, its
+    // sign and point, and the longest precision
+    char text[416];
+    int length = snprintf(text, sizeof(text), conversion, precision, value);
+    if (length > 0) pf_fmt_literal(fmt, text, (size_t)length);
+}
+
+void pf_fmt_fixed(pf_fmt* fmt, double value, int precision) {
+    format_double(fmt, "%.*f", value, precision);
+}
+
+void pf_fmt_exponent(pf_fmt* fmt, double value, int precision) {
+    format_double(fmt, "%.*e", value, precision);
+}
+
+void pf_fmt_general(pf_fmt* fmt, double value, int precision) {
+    format_double(fmt, "%.*g", value, precision);
+}
+
+void pf_fmt_str(pf_fmt* fmt, pf_str value) {
+    pf_fmt_literal(fmt, value, strlen(value));
+}
+
+void pf_fmt_string(pf_fmt* fmt, pf_string value) {
+    pf_fmt_literal(fmt, pf_string_data(&value), value.length);
+}
+
+void pf_fmt_bool(pf_fmt* fmt, bool value) {
+    if (value) {
+        PF_FMT_LITERAL(fmt, "true");
+    } else {
+        PF_FMT_LITERAL(fmt, "false");
+    }
+}
+
+void pf_fmt_error(pf_fmt* fmt, pf_error value) {
+    if (pf_error_is_null(value)) {
+        PF_FMT_LITERAL(fmt, "null");
+        return;
+    }
+    PF_FMT_LITERAL(fmt, "error(");
+    pf_fmt_str(fmt, value.message);
+    PF_FMT_LITERAL(fmt, ")");
+}
+
+pf_str pf_fmt_end(pf_fmt* fmt) {
+    fmt->data[fmt->length] = '\0';
+    return fmt->data;
+}
+
+void pf_print_int(int64_t value) {
+    char digits[21];
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    char* start = decimal_digits(digits + sizeof(digits), magnitude);
+    if (value < 0) *--start = '-';
+    pf_output_write(start, (size_t)(digits + sizeof(digits) - start));
+}
+
+void pf_print_uint(uint64_t value) {
+    char digits[20];
+    char* start = decimal_digits(digits + sizeof(digits), value);
+    pf_output_write(start, (size_t)(digits + sizeof(digits) - start));
+}
+
+void pf_print_float(double value) {
+    char text[32];
+    int length = snprintf(text, sizeof(text), "%g", value);
+    if (length > 0) pf_output_write(text, (size_t)length);
+}
+
+void pf_print_str(pf_str value) {
+    pf_output_write(value, strlen(value));
+}
+
+void pf_print_string(pf_string value) {
+    pf_output_write(pf_string_data(&value), value.length);
+}
+
+void pf_print_bool(bool value) {
+    pf_print_str(value ? "true" : "false");
+}
+
+void pf_print_error(pf_error value) {
+    if (pf_error_is_null(value)) {
+        pf_print_str("null");
+        return;
+    }
+    pf_print_str("error(");
+    pf_print_str(value.message);
+    pf_print_str(")");
+}
+
+// Append one argument; the value's own kind decides how it is rendered,
+// and for floats the conversion letter and precision (-1 if none) pick the
+// notation
+static void format_value(pf_fmt* fmt, const pf_value* value, char conversion, int precision) {
+    switch (value->kind) {
+        case PF_VALUE_INT: pf_fmt_int(fmt, value->as.i); break;
+        case PF_VALUE_UINT: pf_fmt_uint(fmt, value->as.u); break;
+        case PF_VALUE_FLOAT:
+            if (conversion == 'f') {
+                pf_fmt_fixed(fmt, value->as.f, precision >= 0 ? precision : 6);
+            } else if (conversion == 'e') {
+                pf_fmt_exponent(fmt, value->as.f, precision >= 0 ? precision : 6);
+            } else if (precision >= 0) {
+                pf_fmt_general(fmt, value->as.f, precision);
+            } else {
+                pf_fmt_float(fmt, value->as.f);
+            }
+            break;
+        case PF_VALUE_STR: pf_fmt_str(fmt, value->as.s); break;
+        case PF_VALUE_BOOL: pf_fmt_bool(fmt, value->as.b); break;
+    }
+}
+
+pf_str pf_format(pf_str format, int count, const pf_value* args) {
+    pf_fmt out = pf_fmt_begin();
+    int arg = 0;
+    for (const char* p = format; *p != '\0'; p++) {
+        if (*p != '%') {
+            size_t run = strcspn(p, "%");
+            pf_fmt_literal(&out, p, run);
+            p += run - 1;
+            continue;
+        }
+
+        p++;
+        if (*p == '%') {
+            PF_FMT_LITERAL(&out, "%");
+            continue;
+        }
+        int precision = -1;
+        if (*p == '.') {
+            precision = 0;
+            for (p++; *p >= '0' && *p <= '9'; p++) precision = precision * 10 + (*p - '0');
+        }
+        if (*p == '\0' || arg >= count) break;
+        format_value(&out, &args[arg++], *p, precision);
+    }
+    return pf_fmt_end(&out);
+}
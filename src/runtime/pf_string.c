@@ -0,0 +1,471 @@
+#include "../../include/runtime/pf_string.h"
+#include "../../include/runtime/pf_gc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PF_STRING_X86 1
+#endif
+
+// Literals are interned into an open-addressing set keyed by content
+typedef struct {
+    pf_string* entries;
+    size_t count;
+    size_t capacity;            // Power of two, or 0 before the first literal
+} InternTable;
+
+static InternTable interned;
+
+static void* allocate(size_t size) {
+    void* memory = malloc(size);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: out of memory allocating a %zu byte string\n", size);
+        exit(1);
+    }
+    return memory;
+}
+
+// FNV-1a, with 0 reserved for "not computed yet"
+static uint32_t hash_bytes(const char* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+static pf_string make_inline(const char* data, size_t length) {
+    pf_string string = PF_STRING_EMPTY;
+    string.length = (uint32_t)length;
+    memcpy(string.as.bytes, data, length);
+    return string;
+}
+
+// A long string over bytes that outlive it
+static pf_string make_shared(const char* data, size_t length) {
+    pf_string string = PF_STRING_EMPTY;
+    string.length = (uint32_t)length;
+    string.as.data = data;
+    return string;
+}
+
+static void check_length(size_t length) {
+    if (length > UINT32_MAX) {
+        fprintf(stderr, "Error: string of %zu bytes is too long\n", length);
+        exit(1);
+    }
+}
+
+pf_string pf_string_from(const char* data, size_t length) {
+    check_length(length);
+    if (length <= PF_STRING_INLINE_CAPACITY) {
+        return make_inline(data, length);
+    }
+
+    char* copy = pf_gc_allocate(length, PF_GC_BYTES);
+    memcpy(copy, data, length);
+    return make_shared(copy, length);
+}
+
+pf_string pf_string_from_cstr(const char* text) {
+    return pf_string_from(text, strlen(text));
+}
+
+static void grow_intern_table(void) {
+    size_t capacity = interned.capacity == 0 ? 64 : interned.capacity * 2;
+    pf_string* entries = calloc(capacity, sizeof(pf_string));
+    if (entries == NULL) {
+        fprintf(stderr, "Error: out of memory interning strings\n");
+        exit(1);
+    }
+
+    for (size_t i = 0; i < interned.capacity; i++) {
+        pf_string* entry = &interned.entries[i];
+        if (entry->length == 0) continue;
+        size_t slot = entry->hash & (capacity - 1);
+        while (entries[slot].length != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        entries[slot] = *entry;
+    }
+
+    free(interned.entries);
+    interned.entries = entries;
+    interned.capacity = capacity;
+}
+
+pf_string pf_string_intern(const char* data, size_t length) {
+    check_length(length);
+    uint32_t hash = hash_bytes(data, length);
+
+    // Short strings carry their bytes; only the hash is worth precomputing
+    if (length <= PF_STRING_INLINE_CAPACITY) {
+        pf_string string = make_inline(data, length);
+        string.hash = hash;
+        return string;
+    }
+
+    if (interned.count * 2 >= interned.capacity) {
+        grow_intern_table();
+    }
+
+    size_t slot = hash & (interned.capacity - 1);
+    while (interned.entries[slot].length != 0) {
+        pf_string* entry = &interned.entries[slot];
+        if (entry->hash == hash && entry->length == length && memcmp(entry->as.data, data, length) == 0) {
+            return *entry;
+        }
+        slot = (slot + 1) & (interned.capacity - 1);
+    }
+
+    // Literals have static storage, so the first one is used in place
+    pf_string string = make_shared(data, length);
+    string.hash = hash;
+    interned.entries[slot] = string;
+    interned.count++;
+    return string;
+}
+
+pf_string pf_string_slice(pf_string string, size_t start, size_t end) {
+    if (end > string.length) end = string.length;
+    if (start > end) start = end;
+
+    const char* data = pf_string_data(&string) + start;
+    size_t length = end - start;
+    if (length <= PF_STRING_INLINE_CAPACITY) {
+        return make_inline(data, length);
+    }
+    return make_shared(data, length);
+}
+
+bool pf_string_equal(pf_string a, pf_string b) {
+    if (a.length != b.length) return false;
+    if (pf_string_is_inline(&a)) {
+        return memcmp(a.as.bytes, b.as.bytes, PF_STRING_INLINE_CAPACITY) == 0;
+    }
+    if (a.as.data == b.as.data) return true;
+    if (a.hash != 0 && b.hash != 0 && a.hash != b.hash) return false;
+    return memcmp(a.as.data, b.as.data, a.length) == 0;
+}
+
+uint32_t pf_string_hash(pf_string* string) {
+    if (string->hash == 0) {
+        string->hash = hash_bytes(pf_string_data(string), string->length);
+    }
+    return string->hash;
+}
+
+char* pf_string_to_cstr(pf_string string) {
+    char* text = allocate((size_t)string.length + 1);
+    memcpy(text, pf_string_data(&string), string.length);
+    text[string.length] = '\0';
+    return text;
+}
+
+// Kernels for the scanning loops; everything else is built on them
+typedef struct {
+    const char* name;
+    // First offset of needle (at least two bytes) in haystack, or length
+    size_t (*find)(const char* haystack, size_t length, const char* needle, size_t needle_length);
+    // Copy in to out, flipping the case bit of bytes in [first, last]
+    void (*flip_case)(char* out, const char* in, size_t length, char first, char last);
+    // Length of a leading run of ASCII; may stop short of the true run
+    size_t (*ascii_prefix)(const char* data, size_t length);
+} StringKernels;
+
+static size_t find_scalar(const char* haystack, size_t length, const char* needle, size_t needle_length) {
+    for (size_t i = 0; i + needle_length <= length; i++) {
+        if (haystack[i] == needle[0] && memcmp(haystack + i + 1, needle + 1, needle_length - 1) == 0) {
+            return i;
+        }
+    }
+    return length;
+}
+
+static void flip_case_scalar(char* out, const char* in, size_t length, char first, char last) {
+    for (size_t i = 0; i < length; i++) {
+        char c = in[i];
+        out[i] = c >= first && c <= last ? (char)(c ^ 0x20) : c;
+    }
+}
+
+static size_t ascii_prefix_scalar(const char* data, size_t length) {
+    size_t i = 0;
+    while (i < length && (uint8_t)data[i] < 0x80) i++;
+    return i;
+}
+
+static const StringKernels scalar_kernels = {"scalar", find_scalar, flip_case_scalar, ascii_prefix_scalar};
+
+#ifdef PF_STRING_X86
+// Substring search compares a block against the needle's first and last
+// bytes at once and only verifies positions where both match, so typical
+// text is rejected a full vector at a time.
+__attribute__((target("sse2")))
+static size_t find_sse2(const char* haystack, size_t length, const char* needle, size_t needle_length) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+    size_t i = 0;
+    for (; i + 16 + needle_length - 1 <= length; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + i + needle_length - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        while (mask != 0) {
+            size_t candidate = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(haystack + candidate + 1, needle + 1, needle_length - 2) == 0) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = find_scalar(haystack + i, length - i, needle, needle_length);
+    return rest == length - i ? length : i + rest;
+}
+
+// Bytes in [first, last] land below -128 + range after a biased add
+__attribute__((target("sse2")))
+static void flip_case_sse2(char* out, const char* in, size_t length, char first, char last) {
+    const __m128i bias = _mm_set1_epi8((char)(-128 - first));
+    const __m128i limit = _mm_set1_epi8((char)(-128 + (last - first + 1)));
+    const __m128i bit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i in_range = _mm_cmplt_epi8(_mm_add_epi8(block, bias), limit);
+        _mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(block, _mm_and_si128(in_range, bit)));
+    }
+    flip_case_scalar(out + i, in + i, length - i, first, last);
+}
+
+__attribute__((target("sse2")))
+static size_t ascii_prefix_sse2(const char* data, size_t length) {
+    size_t i = 0;
+    while (i + 16 <= length && _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(data + i))) == 0) {
+        i += 16;
+    }
+    return i + ascii_prefix_scalar(data + i, length - i < 16 ? length - i : 16);
+}
+
+static const StringKernels sse2_kernels = {"sse2", find_sse2, flip_case_sse2, ascii_prefix_sse2};
+
+__attribute__((target("avx2")))
+static size_t find_avx2(const char* haystack, size_t length, const char* needle, size_t needle_length) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+    size_t i = 0;
+    for (; i + 32 + needle_length - 1 <= length; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(haystack + i + needle_length - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+        while (mask != 0) {
+            size_t candidate = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(haystack + candidate + 1, needle + 1, needle_length - 2) == 0) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = find_sse2(haystack + i, length - i, needle, needle_length);
+    return rest == length - i ? length : i + rest;
+}
+
+__attribute__((target("avx2")))
+static void flip_case_avx2(char* out, const char* in, size_t length, char first, char last) {
+    const __m256i bias = _mm256_set1_epi8((char)(-128 - first));
+    const __m256i limit = _mm256_set1_epi8((char)(-128 + (last - first + 1)));
+    const __m256i bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i in_range = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(block, bias));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_xor_si256(block, _mm256_and_si256(in_range, bit)));
+    }
+    flip_case_sse2(out + i, in + i, length - i, first, last);
+}
+
+__attribute__((target("avx2")))
+static size_t ascii_prefix_avx2(const char* data, size_t length) {
+    size_t i = 0;
+    while (i + 32 <= length && _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)(data + i))) == 0) {
+        i += 32;
+    }
+    return i + ascii_prefix_sse2(data + i, length - i);
+}
+
+static const StringKernels avx2_kernels = {"avx2", find_avx2, flip_case_avx2, ascii_prefix_avx2};
+#endif
+
+static _Atomic(const StringKernels*) active_kernels = NULL;
+
+static const StringKernels* best_kernels(void) {
+#ifdef PF_STRING_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return &avx2_kernels;
+    if (__builtin_cpu_supports("sse2")) return &sse2_kernels;
+#endif
+    return &scalar_kernels;
+}
+
+static const StringKernels* kernels(void) {
+    const StringKernels* selected = atomic_load_explicit(&active_kernels, memory_order_acquire);
+    if (selected == NULL) {
+        // Racing threads all pick the same set
+        selected = best_kernels();
+        atomic_store_explicit(&active_kernels, selected, memory_order_release);
+    }
+    return selected;
+}
+
+const char* pf_string_kernels(void) {
+    return kernels()->name;
+}
+
+bool pf_string_use_kernels(const char* name) {
+    const StringKernels* selected = NULL;
+    if (strcmp(name, "scalar") == 0) selected = &scalar_kernels;
+#ifdef PF_STRING_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) selected = &sse2_kernels;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) selected = &avx2_kernels;
+#endif
+    if (selected == NULL) return false;
+    atomic_store_explicit(&active_kernels, selected, memory_order_release);
+    return true;
+}
+
+// Offset of needle in data at or after start, or length
+static size_t find_from(const char* data, size_t length, size_t start, const char* needle, size_t needle_length) {
+    if (needle_length > length - start) return length;
+    const char* found;
+    if (needle_length == 1) {
+        // libc's memchr is already vectorized
+        found = memchr(data + start, needle[0], length - start);
+        return found != NULL ? (size_t)(found - data) : length;
+    }
+    size_t offset = kernels()->find(data + start, length - start, needle, needle_length);
+    return offset == length - start ? length : start + offset;
+}
+
+int64_t pf_string_find(pf_string haystack, pf_string needle) {
+    if (needle.length == 0) return 0;
+    size_t offset = find_from(pf_string_data(&haystack), haystack.length, 0, pf_string_data(&needle),
+                              needle.length);
+    return offset == haystack.length ? -1 : (int64_t)offset;
+}
+
+int64_t pf_string_count(pf_string haystack, pf_string needle) {
+    if (needle.length == 0) return 0;
+    const char* data = pf_string_data(&haystack);
+    const char* pattern = pf_string_data(&needle);
+    int64_t count = 0;
+    size_t offset = find_from(data, haystack.length, 0, pattern, needle.length);
+    while (offset != haystack.length) {
+        count++;
+        offset = find_from(data, haystack.length, offset + needle.length, pattern, needle.length);
+    }
+    return count;
+}
+
+size_t pf_string_split(pf_string string, pf_string separator, pf_string* parts, size_t max_parts) {
+    if (separator.length == 0) {
+        if (max_parts > 0) parts[0] = string;
+        return 1;
+    }
+
+    const char* data = pf_string_data(&string);
+    const char* pattern = pf_string_data(&separator);
+    size_t count = 0;
+    size_t start = 0;
+    for (;;) {
+        size_t end = find_from(data, string.length, start, pattern, separator.length);
+        if (count < max_parts) parts[count] = pf_string_slice(string, start, end);
+        count++;
+        if (end == string.length) return count;
+        start = end + separator.length;
+    }
+}
+
+bool pf_string_starts_with(pf_string string, pf_string prefix) {
+    return prefix.length <= string.length &&
+           memcmp(pf_string_data(&string), pf_string_data(&prefix), prefix.length) == 0;
+}
+
+bool pf_string_ends_with(pf_string string, pf_string suffix) {
+    return suffix.length <= string.length &&
+           memcmp(pf_string_data(&string) + string.length - suffix.length, pf_string_data(&suffix),
+                  suffix.length) == 0;
+}
+
+int32_t pf_string_compare(pf_string a, pf_string b) {
+    size_t shorter = a.length < b.length ? a.length : b.length;
+    int order = memcmp(pf_string_data(&a), pf_string_data(&b), shorter);
+    if (order != 0) return order < 0 ? -1 : 1;
+    if (a.length == b.length) return 0;
+    return a.length < b.length ? -1 : 1;
+}
+
+static pf_string flip_case(pf_string string, char first, char last) {
+    if (pf_string_is_inline(&string)) {
+        pf_string result = string;
+        result.hash = 0;
+        flip_case_scalar(result.as.bytes, string.as.bytes, string.length, first, last);
+        return result;
+    }
+
+    char* bytes = pf_gc_allocate(string.length, PF_GC_BYTES);
+    kernels()->flip_case(bytes, string.as.data, string.length, first, last);
+    return make_shared(bytes, string.length);
+}
+
+pf_string pf_string_to_upper(pf_string string) {
+    return flip_case(string, 'a', 'z');
+}
+
+pf_string pf_string_to_lower(pf_string string) {
+    return flip_case(string, 'A', 'Z');
+}
+
+// Length of the well-formed sequence starting at data, or 0
+static size_t utf8_sequence(const uint8_t* data, size_t length) {
+    uint8_t lead = data[0];
+    size_t size;
+    uint8_t low = 0x80;
+    uint8_t high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        size = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        size = 3;
+        if (lead == 0xE0) low = 0xA0;       // Overlong
+        if (lead == 0xED) high = 0x9F;      // Surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        size = 4;
+        if (lead == 0xF0) low = 0x90;       // Overlong
+        if (lead == 0xF4) high = 0x8F;      // Past U+10FFFF
+    } else {
+        return 0;
+    }
+
+    if (size > length) return 0;
+    if (data[1] < low || data[1] > high) return 0;
+    for (size_t i = 2; i < size; i++) {
+        if (data[i] < 0x80 || data[i] > 0xBF) return 0;
+    }
+    return size;
+}
+
+bool pf_string_is_utf8(pf_string string) {
+    const uint8_t* data = (const uint8_t*)pf_string_data(&string);
+    size_t length = string.length;
+    size_t i = 0;
+    while (i < length) {
+        // Skip ASCII a vector at a time, then check one multibyte sequence
+        i += kernels()->ascii_prefix((const char*)data + i, length - i);
+        if (i == length) break;
+        size_t size = utf8_sequence(data + i, length - i);
+        if (size == 0) return false;
+        i += size;
+    }
+    return true;
+}
@@ -0,0 +1,841 @@
+// Green threads: stacks, context switches and the work-stealing scheduler
+#define _GNU_SOURCE
+#include "../../include/runtime/pf_task.h"
+#include "../../include/runtime/pf_gc.h"
+#include "../../include/runtime/pf_output.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define DEFAULT_STACK_BYTES ((size_t)256 << 10)
+#define MIN_STACK_BYTES ((size_t)16 << 10)
+#define MAX_WORKERS 256
+// Stacks of finished tasks kept for new ones instead of being unmapped
+#define SPARE_STACKS 1024
+// Each worker's stack for signal handlers, which a task that overflowed its
+// own cannot provide
+#define SIGNAL_STACK_BYTES ((size_t)64 << 10)
+
+#if defined(__x86_64__) && defined(__ELF__) && !defined(PF_TASK_UCONTEXT)
+#define SWITCH_IN_ASSEMBLY 1
+#else
+#include <ucontext.h>
+#endif
+
+struct Worker;
+
+// A task lives at the top of its own stack mapping, with a copy of its
+// arguments just below; its stack starts below those
+typedef struct pf_task {
+    void* sp;                       // Lowest live address of its stack while switched out
+#ifndef SWITCH_IN_ASSEMBLY
+    ucontext_t context;
+#endif
+    char* mapping;                  // Guard page first
+    size_t mapping_bytes;
+    pf_task_entry entry;
+    void* arguments;
+    struct Worker* worker;          // The worker it is bound to once started
+    struct pf_task* next;           // In a ready queue, the injected queue or the spare stacks
+    struct pf_task* previous_alive; // Among the started tasks of its worker
+    struct pf_task* next_alive;
+    pf_parker* parker;              // Set while it switches out to wait
+    int line;                       // Of the go statement that spawned it, or 0
+    bool finished;
+} pf_task;
+
+// ---------------------------------------------------------------------------
+// Work-stealing deques of tasks that have not started, as in pf_gc.c: the
+// owner pushes and takes at the bottom, thieves steal from the top
+
+typedef struct {
+    int64_t capacity;               // Power of two
+    _Atomic(pf_task*) slots[];
+} DequeBuffer;
+
+typedef struct Worker {
+    _Alignas(64) _Atomic int64_t top;
+    _Atomic int64_t bottom;
+    _Atomic(DequeBuffer*) buffer;   // Outgrown buffers are never freed: thieves may still read them
+
+    // Started tasks ready to resume here; other threads add to it
+    pthread_mutex_t ready_lock;
+    pf_task* ready_head;
+    pf_task* ready_tail;
+
+    pf_task* alive;                 // Started, unfinished tasks bound here
+    pf_task* current;               // The task running on it, or NULL in the scheduler
+#ifdef SWITCH_IN_ASSEMBLY
+    void* sp;                       // The scheduler's stack while a task runs
+#else
+    ucontext_t context;
+#endif
+    pthread_cond_t wake;
+    _Atomic bool sleeping;
+    unsigned seed;
+    unsigned tick;
+} Worker;
+
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t lock;
+    pthread_cond_t all_finished;
+    Worker* workers;
+    _Atomic int count;              // Started workers, read by those already running
+    size_t stack_bytes;             // Usable stack, not counting the guard page
+    size_t page_bytes;
+
+    // Tasks spawned outside the pool, under lock
+    pf_task* injected_head;
+    pf_task* injected_tail;
+    _Atomic int64_t injected_count;
+
+    _Atomic int sleeping;           // Workers waiting for work
+    _Atomic int64_t alive;          // Spawned and not finished
+
+    pthread_mutex_t stacks_lock;
+    pf_task* spare;
+    int spare_count;
+
+    _Atomic uint64_t spawned;
+    _Atomic uint64_t finished;
+    _Atomic uint64_t stolen;
+    _Atomic uint64_t switches;
+    _Atomic uint64_t parks;
+    _Atomic int64_t most_alive;
+} scheduler = {
+    .once = PTHREAD_ONCE_INIT,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .all_finished = PTHREAD_COND_INITIALIZER,
+    .stacks_lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static _Thread_local Worker* current_worker;
+
+enum { PARK_RUNNING, PARK_PARKED, PARK_NOTIFIED };
+
+// What a thread outside tasks waits on when it parks; it outlives every
+// parker of the thread, so a waker may still touch it after the wait ends
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} ThreadParking;
+
+static _Thread_local ThreadParking thread_parking = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+static void* checked_allocate(size_t size) {
+    void* memory = malloc(size);
+    if (memory == NULL) {
+        fprintf(stderr, "Error: out of memory allocating %zu bytes\n", size);
+        exit(1);
+    }
+    return memory;
+}
+
+static DequeBuffer* new_deque_buffer(int64_t capacity) {
+    DequeBuffer* buffer = checked_allocate(sizeof(DequeBuffer) + sizeof(_Atomic(pf_task*)) * (size_t)capacity);
+    buffer->capacity = capacity;
+    return buffer;
+}
+
+static void deque_push(Worker* worker, pf_task* task) {
+    int64_t bottom = atomic_load_explicit(&worker->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&worker->top, memory_order_acquire);
+    DequeBuffer* buffer = atomic_load_explicit(&worker->buffer, memory_order_relaxed);
+    if (bottom - top > buffer->capacity - 1) {
+        DequeBuffer* grown = new_deque_buffer(buffer->capacity * 2);
+        for (int64_t i = top; i < bottom; i++) {
+            pf_task* moved = atomic_load_explicit(&buffer->slots[i & (buffer->capacity - 1)], memory_order_relaxed);
+            atomic_store_explicit(&grown->slots[i & (grown->capacity - 1)], moved, memory_order_relaxed);
+        }
+        atomic_store_explicit(&worker->buffer, grown, memory_order_release);
+        buffer = grown;
+    }
+    atomic_store_explicit(&buffer->slots[bottom & (buffer->capacity - 1)], task, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+}
+
+static pf_task* deque_take(Worker* worker) {
+    int64_t bottom = atomic_load_explicit(&worker->bottom, memory_order_relaxed) - 1;
+    DequeBuffer* buffer = atomic_load_explicit(&worker->buffer, memory_order_relaxed);
+    atomic_store_explicit(&worker->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&worker->top, memory_order_relaxed);
+
+    pf_task* task = NULL;
+    if (top <= bottom) {
+        task = atomic_load_explicit(&buffer->slots[bottom & (buffer->capacity - 1)], memory_order_relaxed);
+        if (top == bottom) {
+            if (!atomic_compare_exchange_strong_explicit(&worker->top, &top, top + 1, memory_order_seq_cst,
+                                                         memory_order_relaxed)) {
+                task = NULL;
+            }
+            atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+        }
+    } else {
+        atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+static pf_task* deque_steal(Worker* victim) {
+    int64_t top = atomic_load_explicit(&victim->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&victim->bottom, memory_order_acquire);
+    if (top >= bottom) return NULL;
+
+    DequeBuffer* buffer = atomic_load_explicit(&victim->buffer, memory_order_acquire);
+    pf_task* task = atomic_load_explicit(&buffer->slots[top & (buffer->capacity - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&victim->top, &top, top + 1, memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+        return NULL;
+    }
+    return task;
+}
+
+// ---------------------------------------------------------------------------
+// Context switches
+
+static char* task_end(const pf_task* task) {
+    return task->mapping + task->mapping_bytes;
+}
+
+__attribute__((used, noreturn)) void pf_task_main(pf_task* task);
+
+#ifdef SWITCH_IN_ASSEMBLY
+// pf_task_switch(&from, to) saves the callee-saved registers and the
+// floating-point control words on the current stack, stores the stack
+// pointer in from and resumes the stack to was saved from. A new task's
+// stack is laid out as if it had been switched out just before
+// pf_task_start, which calls pf_task_main with the task left in r12.
+void pf_task_switch(void** from, void* to);
+void pf_task_start(void);
+
+__asm__(
+    ".text\n"
+    ".globl pf_task_switch\n"
+    ".type pf_task_switch, @function\n"
+    "pf_task_switch:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw 4(%rsp)\n"
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size pf_task_switch, .-pf_task_switch\n"
+    ".globl pf_task_start\n"
+    ".type pf_task_start, @function\n"
+    "pf_task_start:\n"
+    "    movq %r12, %rdi\n"
+    "    call pf_task_main@PLT\n"
+    "    ud2\n"
+    ".size pf_task_start, .-pf_task_start\n");
+
+static void prepare_context(pf_task* task) {
+    // Popped in order: control words, r15, r14, r13, r12, rbx, rbp, then
+    // the return into pf_task_start with the stack 16-byte aligned
+    uint64_t* frame = (uint64_t*)(((uintptr_t)task->arguments & ~(uintptr_t)15) - 8 * sizeof(uint64_t));
+    frame[0] = 0x1F80 | ((uint64_t)0x037F << 32);   // Default MXCSR and x87 control word
+    for (int i = 1; i < 7; i++) {
+        frame[i] = 0;
+    }
+    frame[4] = (uint64_t)(uintptr_t)task;
+    frame[7] = (uint64_t)(uintptr_t)pf_task_start;
+    task->sp = frame;
+}
+
+static void switch_to_task(Worker* worker, pf_task* task) {
+    pf_task_switch(&worker->sp, task->sp);
+}
+
+static void switch_to_worker(pf_task* task) {
+    pf_task_switch(&task->sp, task->worker->sp);
+}
+#else
+// Portable switching through ucontext, which also saves the signal mask
+// with a system call on every switch. The registers of a task switched
+// out are saved in its context, which lies within the range scanned.
+static void start_current_task(void) {
+    pf_task_main(current_worker->current);
+}
+
+static void prepare_context(pf_task* task) {
+    if (getcontext(&task->context) != 0) {
+        fprintf(stderr, "Error: could not create a task context\n");
+        exit(1);
+    }
+    task->context.uc_stack.ss_sp = task->mapping + scheduler.page_bytes;
+    task->context.uc_stack.ss_size = (size_t)((char*)task->arguments - task->mapping) - scheduler.page_bytes;
+    task->context.uc_link = NULL;
+    makecontext(&task->context, start_current_task, 0);
+    task->sp = task->arguments;
+}
+
+static void switch_to_task(Worker* worker, pf_task* task) {
+    swapcontext(&worker->context, &task->context);
+}
+
+static void switch_to_worker(pf_task* task) {
+    task->sp = __builtin_frame_address(0);
+    swapcontext(&task->context, &task->worker->context);
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Stacks
+
+static size_t configured_stack_bytes(void) {
+    const char* text = getenv("PFLANG_TASK_STACK");
+    unsigned long long bytes = DEFAULT_STACK_BYTES;
+    if (text != NULL && text[0] != '\0') {
+        char* end;
+        bytes = strtoull(text, &end, 10);
+        if (*end == 'k' || *end == 'K') bytes <<= 10;
+        if (*end == 'm' || *end == 'M') bytes <<= 20;
+    }
+    if (bytes < MIN_STACK_BYTES) bytes = MIN_STACK_BYTES;
+    return ((size_t)bytes + scheduler.page_bytes - 1) & ~(scheduler.page_bytes - 1);
+}
+
+// A task ready to run entry with a copy of size bytes of arguments
+static pf_task* new_task(pf_task_entry entry, const void* arguments, size_t size, int line) {
+    pf_task* task = NULL;
+    pthread_mutex_lock(&scheduler.stacks_lock);
+    if (scheduler.spare != NULL) {
+        task = scheduler.spare;
+        scheduler.spare = task->next;
+        scheduler.spare_count--;
+    }
+    pthread_mutex_unlock(&scheduler.stacks_lock);
+
+    if (task == NULL) {
+        size_t mapping_bytes = scheduler.stack_bytes + scheduler.page_bytes;
+        char* mapping = mmap(NULL, mapping_bytes, PROT_READ | PROT_WRITE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+        if (mapping == MAP_FAILED || mprotect(mapping, scheduler.page_bytes, PROT_NONE) != 0) {
+            fprintf(stderr, "Error: out of memory allocating a task stack\n");
+            exit(1);
+        }
+        uintptr_t end = (uintptr_t)mapping + mapping_bytes;
+        task = (pf_task*)((end - sizeof(pf_task)) & ~(uintptr_t)63);
+        task->mapping = mapping;
+        task->mapping_bytes = mapping_bytes;
+    }
+
+    task->entry = entry;
+    task->arguments = (void*)(((uintptr_t)task - size) & ~(uintptr_t)15);
+    if (size > 0) memcpy(task->arguments, arguments, size);
+    task->worker = NULL;
+    task->next = NULL;
+    task->previous_alive = NULL;
+    task->next_alive = NULL;
+    task->parker = NULL;
+    task->line = line;
+    task->finished = false;
+    prepare_context(task);
+    return task;
+}
+
+static void release_stack(pf_task* task) {
+    pthread_mutex_lock(&scheduler.stacks_lock);
+    if (scheduler.spare_count < SPARE_STACKS) {
+        task->next = scheduler.spare;
+        scheduler.spare = task;
+        scheduler.spare_count++;
+        task = NULL;
+    }
+    pthread_mutex_unlock(&scheduler.stacks_lock);
+    if (task != NULL) munmap(task->mapping, task->mapping_bytes);
+}
+
+// Report every task stack not in use by a thread to the collector. Runs
+// with every worker stopped, so no task moves between queues meanwhile.
+static void walk_stacks(void (*visit)(const void* low, const void* high)) {
+    for (int w = 0; w < scheduler.count; w++) {
+        Worker* worker = &scheduler.workers[w];
+        for (pf_task* task = worker->alive; task != NULL; task = task->next_alive) {
+            if (task != worker->current) visit(task->sp, task_end(task));
+        }
+        int64_t top = atomic_load(&worker->top);
+        int64_t bottom = atomic_load(&worker->bottom);
+        DequeBuffer* buffer = atomic_load(&worker->buffer);
+        for (int64_t i = top; i < bottom; i++) {
+            pf_task* task = atomic_load(&buffer->slots[i & (buffer->capacity - 1)]);
+            visit(task->sp, task_end(task));
+        }
+    }
+    pthread_mutex_lock(&scheduler.lock);
+    for (pf_task* task = scheduler.injected_head; task != NULL; task = task->next) {
+        visit(task->sp, task_end(task));
+    }
+    pthread_mutex_unlock(&scheduler.lock);
+}
+
+// ---------------------------------------------------------------------------
+// Scheduling
+
+static pf_task* pop_ready(Worker* worker) {
+    pthread_mutex_lock(&worker->ready_lock);
+    pf_task* task = worker->ready_head;
+    if (task != NULL) {
+        worker->ready_head = task->next;
+        if (worker->ready_head == NULL) worker->ready_tail = NULL;
+    }
+    pthread_mutex_unlock(&worker->ready_lock);
+    return task;
+}
+
+static void push_ready(Worker* worker, pf_task* task) {
+    task->next = NULL;
+    pthread_mutex_lock(&worker->ready_lock);
+    if (worker->ready_tail != NULL) {
+        worker->ready_tail->next = task;
+    } else {
+        worker->ready_head = task;
+    }
+    worker->ready_tail = task;
+    pthread_mutex_unlock(&worker->ready_lock);
+}
+
+static pf_task* pop_injected(void) {
+    if (atomic_load(&scheduler.injected_count) == 0) return NULL;
+    pthread_mutex_lock(&scheduler.lock);
+    pf_task* task = scheduler.injected_head;
+    if (task != NULL) {
+        scheduler.injected_head = task->next;
+        if (scheduler.injected_head == NULL) scheduler.injected_tail = NULL;
+        atomic_fetch_sub(&scheduler.injected_count, 1);
+    }
+    pthread_mutex_unlock(&scheduler.lock);
+    return task;
+}
+
+static pf_task* steal(Worker* worker) {
+    int count = atomic_load_explicit(&scheduler.count, memory_order_acquire);
+    if (count < 2) return NULL;
+    worker->seed = worker->seed * 1103515245u + 12345u;
+    int first = (int)((worker->seed >> 16) % (unsigned)count);
+    for (int i = 0; i < count; i++) {
+        Worker* victim = &scheduler.workers[(first + i) % count];
+        if (victim == worker) continue;
+        pf_task* task = deque_steal(victim);
+        if (task != NULL) {
+            atomic_fetch_add_explicit(&scheduler.stolen, 1, memory_order_relaxed);
+            return task;
+        }
+    }
+    return NULL;
+}
+
+// Tasks that resumed go first every other time, so that neither they nor
+// new ones starve
+static pf_task* next_task(Worker* worker) {
+    pf_task* task;
+    if ((++worker->tick & 1) && (task = pop_ready(worker)) != NULL) return task;
+    if ((task = deque_take(worker)) != NULL) return task;
+    if ((task = pop_ready(worker)) != NULL) return task;
+    if ((task = pop_injected()) != NULL) return task;
+    return steal(worker);
+}
+
+static bool work_available(Worker* worker) {
+    if (atomic_load(&scheduler.injected_count) > 0) return true;
+    pthread_mutex_lock(&worker->ready_lock);
+    bool ready = worker->ready_head != NULL;
+    pthread_mutex_unlock(&worker->ready_lock);
+    if (ready) return true;
+    int count = atomic_load_explicit(&scheduler.count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        Worker* other = &scheduler.workers[i];
+        if (atomic_load(&other->bottom) - atomic_load(&other->top) > 0) return true;
+    }
+    return false;
+}
+
+// With scheduler.lock held
+static void wake(Worker* worker) {
+    if (atomic_load(&worker->sleeping)) {
+        atomic_store(&worker->sleeping, false);
+        atomic_fetch_sub(&scheduler.sleeping, 1);
+        pthread_cond_signal(&worker->wake);
+    }
+}
+
+// Wake a sleeping worker for a task anyone may take. The fence pairs with
+// the one in sleep_until_work: either the sleeper sees the task, or this
+// sees the sleeper.
+static void wake_one(void) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&scheduler.sleeping) == 0) return;
+    pthread_mutex_lock(&scheduler.lock);
+    for (int i = 0; i < scheduler.count; i++) {
+        if (atomic_load(&scheduler.workers[i].sleeping)) {
+            wake(&scheduler.workers[i]);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&scheduler.lock);
+}
+
+static void sleep_until_work(void* argument) {
+    Worker* worker = argument;
+    pthread_mutex_lock(&scheduler.lock);
+    atomic_store(&worker->sleeping, true);
+    atomic_fetch_add(&scheduler.sleeping, 1);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (work_available(worker)) wake(worker);
+    while (atomic_load(&worker->sleeping)) {
+        pthread_cond_wait(&worker->wake, &scheduler.lock);
+    }
+    pthread_mutex_unlock(&scheduler.lock);
+}
+
+// Put a parked task back on its worker's ready queue, waking the worker if
+// it sleeps. The fence pairs with the one in sleep_until_work.
+static void resume(pf_task* task) {
+    Worker* worker = task->worker;
+    push_ready(worker, task);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&worker->sleeping)) {
+        pthread_mutex_lock(&scheduler.lock);
+        wake(worker);
+        pthread_mutex_unlock(&scheduler.lock);
+    }
+}
+
+static void finish(Worker* worker, pf_task* task) {
+    if (task->previous_alive != NULL) {
+        task->previous_alive->next_alive = task->next_alive;
+    } else {
+        worker->alive = task->next_alive;
+    }
+    if (task->next_alive != NULL) task->next_alive->previous_alive = task->previous_alive;
+    release_stack(task);
+
+    atomic_fetch_add_explicit(&scheduler.finished, 1, memory_order_relaxed);
+    if (atomic_fetch_sub(&scheduler.alive, 1) == 1) {
+        pthread_mutex_lock(&scheduler.lock);
+        pthread_cond_broadcast(&scheduler.all_finished);
+        pthread_mutex_unlock(&scheduler.lock);
+    }
+}
+
+// Run task until it switches out. The collector finds a running task's
+// stack through the thread, and a switched-out one through walk_stacks.
+static void run(Worker* worker, pf_task* task) {
+    if (task->worker == NULL) {
+        task->worker = worker;
+        task->next_alive = worker->alive;
+        if (worker->alive != NULL) worker->alive->previous_alive = task;
+        worker->alive = task;
+    }
+    worker->current = task;
+    const void* own_stack = pf_gc_set_stack_top(task_end(task));
+    atomic_fetch_add_explicit(&scheduler.switches, 1, memory_order_relaxed);
+    switch_to_task(worker, task);
+    pf_gc_set_stack_top(own_stack);
+    worker->current = NULL;
+    if (task->parker != NULL) {
+        // It switched out to wait, and stays off every queue until woken;
+        // if that already happened, it is ready at once
+        pf_parker* parker = task->parker;
+        task->parker = NULL;
+        int expected = PARK_RUNNING;
+        if (!atomic_compare_exchange_strong(&parker->state, &expected, PARK_PARKED)) push_ready(worker, task);
+    }
+    if (task->finished) finish(worker, task);
+}
+
+void pf_task_main(pf_task* task) {
+    task->entry(task->arguments);
+    pf_output_flush();
+    task->finished = true;
+    switch_to_worker(task);
+    abort();
+}
+
+// ---------------------------------------------------------------------------
+// Stack overflow
+//
+// Stacks do not grow past what they reserve. A task that runs off the end
+// of its stack faults on the guard page below it; the fault is taken on the
+// worker's signal stack, which tells it apart from any other by its address
+// and stops the program with the line of the go statement.
+
+static struct sigaction previous_segv;
+
+static void append_text(char* buffer, size_t* length, const char* text) {
+    while (*text != '\0') buffer[(*length)++] = *text++;
+}
+
+static void append_number(char* buffer, size_t* length, size_t value) {
+    char digits[24];
+    int count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) buffer[(*length)++] = digits[--count];
+}
+
+// Only async-signal-safe calls from here on
+static void stack_overflow(int signal, siginfo_t* info, void* context) {
+    (void)context;
+    Worker* worker = current_worker;
+    pf_task* task = worker != NULL ? worker->current : NULL;
+    const char* address = info->si_addr;
+    if (task == NULL || address < task->mapping || address >= task->mapping + scheduler.page_bytes) {
+        // Not ours: the fault comes back with the previous handler in place
+        sigaction(signal, &previous_segv, NULL);
+        return;
+    }
+
+    char message[160];
+    size_t length = 0;
+    if (task->line > 0) {
+        append_text(message, &length, "[line ");
+        append_number(message, &length, (size_t)task->line);
+        append_text(message, &length, "] ");
+    }
+    append_text(message, &length, "Error: stack overflow in task (");
+    append_number(message, &length, scheduler.stack_bytes >> 10);
+    append_text(message, &length, "k stack; PFLANG_TASK_STACK sets its size)\n");
+    ssize_t written = write(STDERR_FILENO, message, length);
+    (void)written;
+    _exit(1);
+}
+
+static void catch_stack_overflows(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = stack_overflow;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, &previous_segv);
+}
+
+static void* worker_thread(void* argument) {
+    Worker* worker = argument;
+    current_worker = worker;
+    stack_t signal_stack = {.ss_sp = malloc(SIGNAL_STACK_BYTES), .ss_size = SIGNAL_STACK_BYTES, .ss_flags = 0};
+    if (signal_stack.ss_sp == NULL || sigaltstack(&signal_stack, NULL) != 0) {
+        fprintf(stderr, "Error: out of memory starting a task worker\n");
+        exit(1);
+    }
+    pf_gc_init();
+    for (;;) {
+        pf_gc_safepoint();
+        pf_task* task = next_task(worker);
+        if (task != NULL) {
+            run(worker, task);
+        } else {
+            pf_gc_blocking(sleep_until_work, worker);
+        }
+    }
+    return NULL;
+}
+
+static int configured_workers(void) {
+    const char* text = getenv("PFLANG_TASK_THREADS");
+    long count = text != NULL ? strtol(text, NULL, 10) : 0;
+    if (count <= 0) count = sysconf(_SC_NPROCESSORS_ONLN);
+    if (count < 1) count = 1;
+    return count > MAX_WORKERS ? MAX_WORKERS : (int)count;
+}
+
+static void start_workers(void) {
+    scheduler.page_bytes = (size_t)sysconf(_SC_PAGESIZE);
+    scheduler.stack_bytes = configured_stack_bytes();
+    int count = configured_workers();
+    scheduler.workers = aligned_alloc(_Alignof(Worker), sizeof(Worker) * (size_t)count);
+    if (scheduler.workers == NULL) {
+        fprintf(stderr, "Error: out of memory starting the task scheduler\n");
+        exit(1);
+    }
+    memset(scheduler.workers, 0, sizeof(Worker) * (size_t)count);
+    for (int i = 0; i < count; i++) {
+        Worker* worker = &scheduler.workers[i];
+        atomic_init(&worker->buffer, new_deque_buffer(256));
+        pthread_mutex_init(&worker->ready_lock, NULL);
+        pthread_cond_init(&worker->wake, NULL);
+        worker->seed = (unsigned)i + 1;
+    }
+    pf_gc_init();
+    pf_gc_set_stack_walker(walk_stacks);
+    catch_stack_overflows();
+
+    // Workers are counted only once started, since walk_stacks reads them
+    for (int i = 0; i < count; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, worker_thread, &scheduler.workers[i]) != 0) break;
+        pthread_detach(thread);
+        atomic_fetch_add_explicit(&scheduler.count, 1, memory_order_release);
+    }
+    if (scheduler.count == 0) {
+        fprintf(stderr, "Error: could not start a task worker thread\n");
+        exit(1);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Interface
+
+void pf_task_spawn(pf_task_entry entry, const void* arguments, size_t size) {
+    pf_task_spawn_at(entry, arguments, size, 0);
+}
+
+void pf_task_spawn_at(pf_task_entry entry, const void* arguments, size_t size, int line) {
+    pthread_once(&scheduler.once, start_workers);
+    // What the spawner printed so far goes out before anything the task prints
+    pf_output_flush();
+
+    pf_task* task = new_task(entry, arguments, size, line);
+    atomic_fetch_add_explicit(&scheduler.spawned, 1, memory_order_relaxed);
+    int64_t alive = atomic_fetch_add(&scheduler.alive, 1) + 1;
+    int64_t most = atomic_load_explicit(&scheduler.most_alive, memory_order_relaxed);
+    while (alive > most && !atomic_compare_exchange_weak(&scheduler.most_alive, &most, alive)) {
+    }
+
+    Worker* worker = current_worker;
+    if (worker != NULL) {
+        deque_push(worker, task);
+    } else {
+        pthread_mutex_lock(&scheduler.lock);
+        if (scheduler.injected_tail != NULL) {
+            scheduler.injected_tail->next = task;
+        } else {
+            scheduler.injected_head = task;
+        }
+        scheduler.injected_tail = task;
+        atomic_fetch_add(&scheduler.injected_count, 1);
+        pthread_mutex_unlock(&scheduler.lock);
+    }
+    wake_one();
+}
+
+bool pf_task_in_task(void) {
+    return current_worker != NULL && current_worker->current != NULL;
+}
+
+int pf_task_worker_count(void) {
+    pthread_once(&scheduler.once, start_workers);
+    return scheduler.count;
+}
+
+const void* pf_task_identity(void) {
+    if (pf_task_in_task()) return current_worker->current;
+    return &thread_parking;
+}
+
+void pf_task_yield(void) {
+    if (!pf_task_in_task()) {
+        sched_yield();
+        return;
+    }
+    pf_output_flush();
+    pf_task* task = current_worker->current;
+    push_ready(current_worker, task);
+    switch_to_worker(task);
+}
+
+static void wait_for_tasks(void* argument) {
+    (void)argument;
+    pthread_mutex_lock(&scheduler.lock);
+    while (atomic_load(&scheduler.alive) > 0) {
+        pthread_cond_wait(&scheduler.all_finished, &scheduler.lock);
+    }
+    pthread_mutex_unlock(&scheduler.lock);
+}
+
+void pf_task_wait(void) {
+    pf_output_flush();
+    if (pf_task_in_task()) {
+        fprintf(stderr, "Error: wait() called from a task would wait for itself\n");
+        exit(1);
+    }
+    if (atomic_load(&scheduler.alive) == 0) return;
+    pf_gc_blocking(wait_for_tasks, NULL);
+}
+
+void pf_parker_prepare(pf_parker* parker) {
+    atomic_init(&parker->state, PARK_RUNNING);
+    atomic_init(&parker->token, -1);
+    parker->task = pf_task_in_task() ? current_worker->current : NULL;
+    parker->thread = &thread_parking;
+}
+
+static void wait_for_unpark(void* argument) {
+    pf_parker* parker = argument;
+    ThreadParking* parking = parker->thread;
+    pthread_mutex_lock(&parking->lock);
+    while (atomic_load(&parker->state) != PARK_NOTIFIED) {
+        pthread_cond_wait(&parking->wake, &parking->lock);
+    }
+    pthread_mutex_unlock(&parking->lock);
+}
+
+void pf_parker_park(pf_parker* parker) {
+    if (atomic_load(&parker->state) == PARK_NOTIFIED) return;
+    pf_output_flush();
+    if (parker->task == NULL) {
+        pf_gc_blocking(wait_for_unpark, parker);
+        return;
+    }
+    atomic_fetch_add_explicit(&scheduler.parks, 1, memory_order_relaxed);
+    parker->task->parker = parker;
+    switch_to_worker(parker->task);
+}
+
+// The parker lives on the stack of whoever parks, and may be gone as soon
+// as it sees PARK_NOTIFIED, so nothing reads it after that is stored
+bool pf_parker_unpark(pf_parker* parker, int token) {
+    int expected = -1;
+    if (!atomic_compare_exchange_strong(&parker->token, &expected, token)) return false;
+
+    pf_task* task = parker->task;
+    if (task == NULL) {
+        ThreadParking* parking = parker->thread;
+        pthread_mutex_lock(&parking->lock);
+        atomic_store(&parker->state, PARK_NOTIFIED);
+        pthread_cond_signal(&parking->wake);
+        pthread_mutex_unlock(&parking->lock);
+        return true;
+    }
+    // A task that has not switched out yet finds this in run() and goes
+    // straight back on the ready queue
+    if (atomic_exchange(&parker->state, PARK_NOTIFIED) == PARK_PARKED) resume(task);
+    return true;
+}
+
+void pf_task_get_statistics(pf_task_statistics* statistics) {
+    statistics->spawned = atomic_load(&scheduler.spawned);
+    statistics->finished = atomic_load(&scheduler.finished);
+    statistics->stolen = atomic_load(&scheduler.stolen);
+    statistics->switches = atomic_load(&scheduler.switches);
+    statistics->parks = atomic_load(&scheduler.parks);
+    statistics->most_alive = atomic_load(&scheduler.most_alive);
+    statistics->workers = scheduler.count;
+}
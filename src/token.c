@@ -17,6 +17,9 @@ const char* token_type_to_string(TokenType type) {
         case TOKEN_WHILE: return "WHILE";
         case TOKEN_FOR: return "FOR";
         case TOKEN_OPTIONAL: return "OPTIONAL";
+        case TOKEN_GO: return "GO";
+        case TOKEN_SELECT: return "SELECT";
+        case TOKEN_PAR: return "PAR";
         case TOKEN_NULL: return "NULL";
         case TOKEN_ERROR: return "ERROR";
         case TOKEN_I8: return "I8";
@@ -48,6 +51,8 @@ const char* token_type_to_string(TokenType type) {
         case TOKEN_RIGHT_PAREN: return "RIGHT_PAREN";
         case TOKEN_LEFT_BRACE: return "LEFT_BRACE";
         case TOKEN_RIGHT_BRACE: return "RIGHT_BRACE";
+        case TOKEN_LEFT_BRACKET: return "LEFT_BRACKET";
+        case TOKEN_RIGHT_BRACKET: return "RIGHT_BRACKET";
         case TOKEN_COMMA: return "COMMA";
         case TOKEN_DOT: return "DOT";
         case TOKEN_COLON: return "COLON";
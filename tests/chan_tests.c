@@ -0,0 +1,285 @@
+#include "../include/test_framework.h"
+#include "../include/runtime/pf_chan.h"
+#include "../include/runtime/pf_task.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+    pf_chan* chan;
+    int64_t first;
+    int64_t count;
+    pf_chan* done;                  // Told when all are sent, unless NULL
+} SendArguments;
+
+static void send_range(void* argument) {
+    SendArguments* arguments = argument;
+    for (int64_t i = 0; i < arguments->count; i++) {
+        pf_chan_i64_send(arguments->chan, arguments->first + i, 0);
+    }
+    if (arguments->done != NULL) pf_chan_bool_send(arguments->done, true, 0);
+}
+
+static _Atomic int64_t received_total;
+static _Atomic int64_t received_count;
+
+static void receive_all(void* argument) {
+    pf_chan* chan = *(pf_chan**)argument;
+    bool ok;
+    for (int64_t value = pf_chan_i64_recv_ok(chan, &ok, 0); ok; value = pf_chan_i64_recv_ok(chan, &ok, 0)) {
+        atomic_fetch_add(&received_total, value);
+        atomic_fetch_add(&received_count, 1);
+    }
+}
+
+// Test sending and receiving on one thread, in order, on bounded and
+// unbounded channels, and receiving after close
+void test_chan_basics() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Channel Basics ===\n");
+
+    pf_chan* bounded = pf_chan_i64_new(4, 0);
+    for (int64_t i = 0; i < 4; i++) {
+        pf_chan_i64_send(bounded, i * 10, 0);
+    }
+    bool in_order = true;
+    for (int64_t i = 0; i < 4; i++) {
+        if (pf_chan_i64_recv(bounded, 0) != i * 10) in_order = false;
+    }
+    ASSERT_TRUE(in_order, "A bounded channel delivers values in the order sent");
+
+    // Many laps around a small ring
+    in_order = true;
+    for (int64_t i = 0; i < 999; i++) {
+        pf_chan_i64_send(bounded, i, 0);
+        if (i % 3 == 2) {
+            for (int64_t j = i - 2; j <= i; j++) {
+                if (pf_chan_i64_recv(bounded, 0) != j) in_order = false;
+            }
+        }
+    }
+    ASSERT_TRUE(in_order, "Order holds across laps of the ring");
+
+    pf_chan* unbounded = pf_chan_str_new(PF_CHAN_UNBOUNDED, 0);
+    for (int64_t i = 0; i < 5000; i++) {
+        char text[32];
+        int length = snprintf(text, sizeof(text), "value %lld", (long long)i);
+        pf_chan_str_send(unbounded, pf_string_from(text, (size_t)length), 0);
+    }
+    pf_gc_collect(true);
+    pf_chan_close(unbounded, 0);
+    in_order = true;
+    for (int64_t i = 0; i < 5000; i++) {
+        char text[32];
+        int length = snprintf(text, sizeof(text), "value %lld", (long long)i);
+        bool ok;
+        pf_string value = pf_chan_str_recv_ok(unbounded, &ok, 0);
+        if (!ok || !pf_string_equal(value, pf_string_from(text, (size_t)length))) in_order = false;
+    }
+    ASSERT_TRUE(in_order, "An unbounded channel queues past its ring, keeps strings alive and drains after close");
+    bool ok = true;
+    pf_string empty = pf_chan_str_recv_ok(unbounded, &ok, 0);
+    ASSERT_FALSE(ok, "Receiving from a closed, empty channel reports it");
+    ASSERT_EQUAL_INT(0, (int)empty.length, "and yields the zero value");
+
+    pf_chan_case none[1] = {{bounded, false, &(int64_t){0}}};
+    ASSERT_EQUAL_INT(-1, pf_chan_select(none, 1, false, &ok, 0), "A select that cannot wait gives up on an empty channel");
+
+    print_test_results(&stats);
+}
+
+// Test many producers and consumers on tasks, across workers, with a
+// small buffer so that both ends park
+void test_chan_tasks() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Channels Between Tasks ===\n");
+
+    setenv("PFLANG_TASK_THREADS", "4", 0);
+    pf_task_statistics tasks_before;
+    pf_task_get_statistics(&tasks_before);
+
+    pf_chan* chan = pf_chan_i64_new(8, 0);
+    atomic_store(&received_total, 0);
+    atomic_store(&received_count, 0);
+    for (int i = 0; i < 16; i++) {
+        pf_task_spawn(receive_all, &chan, sizeof(chan));
+    }
+    pf_chan* done = pf_chan_bool_new(PF_CHAN_UNBOUNDED, 0);
+    for (int64_t p = 0; p < 32; p++) {
+        SendArguments arguments = {chan, p * 1000, 1000, done};
+        pf_task_spawn(send_range, &arguments, sizeof(arguments));
+    }
+    // The main thread parks until every sender is through, then closes
+    for (int64_t p = 0; p < 32; p++) {
+        pf_chan_bool_recv(done, 0);
+    }
+    pf_chan_close(chan, 0);
+    pf_task_wait();
+
+    ASSERT_EQUAL_INT(32000, (int)atomic_load(&received_count), "Every value is received exactly once");
+    ASSERT_TRUE(atomic_load(&received_total) == (int64_t)31999 * 32000 / 2, "and none is duplicated or lost");
+
+    pf_task_statistics tasks_after;
+    pf_task_get_statistics(&tasks_after);
+    ASSERT_TRUE(tasks_after.parks > tasks_before.parks, "Tasks waiting on a channel park rather than spin");
+
+    print_test_results(&stats);
+}
+
+typedef struct {
+    pf_chan* ping;
+    pf_chan* pong;
+    int rounds;
+} PingArguments;
+
+static void ping_pong(void* argument) {
+    PingArguments* arguments = argument;
+    for (int i = 0; i < arguments->rounds; i++) {
+        pf_chan_i64_send(arguments->pong, pf_chan_i64_recv(arguments->ping, 0) + 1, 0);
+    }
+}
+
+static void* sending_thread(void* argument) {
+    send_range(argument);
+    return NULL;
+}
+
+// Test that an end used by one task stays owned, that ends whose owners
+// keep being fenced by waiters are shared, and that a second user revokes
+// an end without losing values
+void test_chan_ownership() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Channel Ownership ===\n");
+
+    // A stream through a roomy buffer, where waits are rare
+    pf_chan_statistics before;
+    pf_chan_get_statistics(&before);
+    pf_chan* stream = pf_chan_i64_new(1024, 0);
+    atomic_store(&received_total, 0);
+    atomic_store(&received_count, 0);
+    pf_task_spawn(receive_all, &stream, sizeof(stream));
+    SendArguments streamed = {stream, 0, 20000, NULL};
+    send_range(&streamed);
+    pf_chan_close(stream, 0);
+    pf_task_wait();
+    ASSERT_EQUAL_INT(20000, (int)atomic_load(&received_count), "A stream between two parties arrives whole");
+
+    pf_chan_statistics after;
+    pf_chan_get_statistics(&after);
+    bool owners = getenv("PFLANG_CHAN_SHARED") == NULL && after.owned > before.owned;
+    if (owners) {
+        ASSERT_EQUAL_INT(2, (int)(after.owned - before.owned), "Each end of a channel between two parties is owned");
+    }
+
+    // A ping-pong, where every receive waits
+    PingArguments arguments = {pf_chan_i64_new(1, 0), pf_chan_i64_new(1, 0), 10000};
+    pf_task_spawn(ping_pong, &arguments, sizeof(arguments));
+    int64_t value = 0;
+    for (int i = 0; i < arguments.rounds; i++) {
+        pf_chan_i64_send(arguments.ping, value, 0);
+        value = pf_chan_i64_recv(arguments.pong, 0);
+    }
+    pf_task_wait();
+    ASSERT_EQUAL_INT(10000, (int)value, "A value passed back and forth is bumped every round");
+    pf_chan_statistics pinged;
+    pf_chan_get_statistics(&pinged);
+    if (owners) ASSERT_TRUE(pinged.shared > after.shared, "Ends that leave the other side waiting are shared");
+    after = pinged;
+
+    // A sender on the main thread, then three more threads on the same end
+    pf_chan* chan = pf_chan_i64_new(16, 0);
+    atomic_store(&received_total, 0);
+    atomic_store(&received_count, 0);
+    pf_task_spawn(receive_all, &chan, sizeof(chan));
+    SendArguments first = {chan, 0, 1000, NULL};
+    send_range(&first);
+    pthread_t threads[3];
+    SendArguments others[3];
+    for (int t = 0; t < 3; t++) {
+        others[t] = (SendArguments){chan, (t + 1) * 1000, 1000, NULL};
+        pthread_create(&threads[t], NULL, sending_thread, &others[t]);
+    }
+    for (int t = 0; t < 3; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    pf_chan_close(chan, 0);
+    pf_task_wait();
+    ASSERT_EQUAL_INT(4000, (int)atomic_load(&received_count), "Values sent before and after an end is shared all arrive");
+    ASSERT_TRUE(atomic_load(&received_total) == (int64_t)3999 * 4000 / 2, "each once");
+
+    pf_chan_statistics revoked;
+    pf_chan_get_statistics(&revoked);
+    if (owners) ASSERT_TRUE(revoked.shared > after.shared, "A second sender shares an owned end");
+
+    print_test_results(&stats);
+}
+
+typedef struct {
+    pf_chan* chan;
+    int count;
+} CloseArguments;
+
+static void send_then_close(void* argument) {
+    CloseArguments* arguments = argument;
+    for (int i = 0; i < arguments->count; i++) {
+        pf_chan_i64_send(arguments->chan, 1, 0);
+    }
+    pf_chan_close(arguments->chan, 0);
+}
+
+// Test select across channels filled by tasks, until all are closed
+void test_chan_select() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Channel Select ===\n");
+
+    pf_chan* chans[3];
+    for (int c = 0; c < 3; c++) {
+        chans[c] = pf_chan_i64_new(c + 1, 0);
+        CloseArguments arguments = {chans[c], 500 * (c + 1)};
+        pf_task_spawn(send_then_close, &arguments, sizeof(arguments));
+    }
+    int64_t values[3];
+    pf_chan_case cases[3];
+    int counts[3] = {0, 0, 0};
+    int open = 3;
+    while (open > 0) {
+        int n = 0;
+        int which[3];
+        for (int c = 0; c < 3; c++) {
+            if (chans[c] == NULL) continue;
+            cases[n] = (pf_chan_case){chans[c], false, &values[c]};
+            which[n++] = c;
+        }
+        bool ok;
+        int chosen = pf_chan_select(cases, n, true, &ok, 0);
+        if (ok) {
+            counts[which[chosen]] += (int)values[which[chosen]];
+        } else {
+            chans[which[chosen]] = NULL;
+            open--;
+        }
+    }
+    pf_task_wait();
+    ASSERT_EQUAL_INT(500, counts[0], "Select receives every value of the first channel");
+    ASSERT_EQUAL_INT(1000, counts[1], "of the second");
+    ASSERT_EQUAL_INT(1500, counts[2], "and of the third, and sees each close");
+
+    pf_chan* room = pf_chan_i64_new(1, 0);
+    pf_chan* empty = pf_chan_i64_new(1, 0);
+    int64_t sent = 7, into = 0;
+    pf_chan_case mixed[2] = {{empty, false, &into}, {room, true, &sent}};
+    bool ok;
+    ASSERT_EQUAL_INT(1, pf_chan_select(mixed, 2, false, &ok, 0), "Select sends where there is room");
+    ASSERT_EQUAL_INT(7, (int)pf_chan_i64_recv(room, 0), "and the value arrives");
+
+    print_test_results(&stats);
+}
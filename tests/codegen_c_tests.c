@@ -0,0 +1,1934 @@
+#include "../include/test_framework.h"
+#include "../include/codegen_c.h"
+#include "../include/parser.h"
+#include "../include/utils.h"
+#include <unistd.h>
+
+static AstNode* parse_program_source(const char* source, Parser* parser, Lexer* lexer) {
+    init_lexer(lexer, source);
+    init_parser(parser, lexer);
+    return parse_program(parser);
+}
+
+// Test the C emitted for a function returning (int, error)
+void test_codegen_c_tuple_return() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Tuple Returns ===\n");
+
+    const char* source =
+        "f div(a: int, b: int) -> (int, error):\n"
+        "    if b == 0:\n"
+        "        return (0, error(\"Division by zero\"))\n"
+        "    return (a / b, null)";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t code_size = 0;
+    FILE* out = open_memstream(&code, &code_size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+
+    ASSERT_TRUE(strstr(code, "    int32_t v0;\n    pf_error v1;\n} pf_ret_div;") != NULL,
+                "Return tuple becomes a struct");
+    ASSERT_TRUE(strstr(code, "static pf_ret_div pf_fn_div(int32_t a, int32_t b)") != NULL,
+                "Signature uses fixed-width parameter types");
+    ASSERT_TRUE(strstr(code, "return (pf_ret_div){0, pf_error_new(\"Division by zero\")};") != NULL,
+                "Error return builds the tuple in place");
+    ASSERT_TRUE(strstr(code, "return (pf_ret_div){pf_div_wrap_i32(a, b, 4), PF_NO_ERROR};") != NULL,
+                "null in an error slot becomes PF_NO_ERROR");
+    ASSERT_TRUE(strstr(code, "int main(void)") == NULL, "No entry point without a main function");
+
+    free(code);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test building and running a native executable
+void test_codegen_c_executable() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Executable ===\n");
+
+    const char* source =
+        "f square(x: i64) -> i64:\n"
+        "    return x * x\n"
+        "f main() -> null:\n"
+        "    i64 value = square(12)\n"
+        "    print(\"%d squared is %d\\n\" % 12, value)\n"
+        "    print(value > 100)\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-codegen-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-codegen-%d", (int)getpid());
+
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit(program, "square.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "Generated C compiles");
+
+    FILE* run = popen(exe_path, "r");
+    char output[256] = {0};
+    size_t length = fread(output, 1, sizeof(output) - 1, run);
+    output[length] = '\0';
+    ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("12 squared is 144\ntrue", output, "Executable prints the expected output");
+
+    // Quotes and backslashes in the source path are escaped in #line
+    out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit(program, "odd \"dir\"\\square.pf", PF_OVERFLOW_WRAP, out),
+                "C is emitted for an odd path");
+    fclose(out);
+    char* code = read_file(c_path);
+    ASSERT_TRUE(strstr(code, "#line 1 \"odd \\\"dir\\\"\\\\square.pf\"\n") != NULL, "The path is escaped");
+    free(code);
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C with an odd path compiles");
+
+    remove(c_path);
+    remove(exe_path);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+static int count_substrings(const char* text, const char* pattern) {
+    int count = 0;
+    for (const char* p = strstr(text, pattern); p != NULL; p = strstr(p + 1, pattern)) {
+        count++;
+    }
+    return count;
+}
+
+// Build a program with the given overflow mode and capture what it prints
+static int run_with_overflow_mode(AstNode* program, pf_overflow_mode mode, char* output, size_t size) {
+    char c_path[64];
+    char exe_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-overflow-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-overflow-%d", (int)getpid());
+
+    FILE* out = fopen(c_path, "w");
+    bool ok = codegen_c_emit(program, "overflow.pf", mode, out);
+    fclose(out);
+    output[0] = '\0';
+    if (!ok || !codegen_c_compile(c_path, exe_path)) {
+        remove(c_path);
+        return -1;
+    }
+
+    char command[128];
+    snprintf(command, sizeof(command), "%s 2>/dev/null", exe_path);
+    FILE* run = popen(command, "r");
+    size_t length = fread(output, 1, size - 1, run);
+    output[length] = '\0';
+    int status = pclose(run);
+
+    remove(c_path);
+    remove(exe_path);
+    return status;
+}
+
+// Test wrapping, checked and saturating integer arithmetic
+void test_codegen_c_overflow_modes() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Overflow Modes ===\n");
+
+    const char* source =
+        "f main() -> null:\n"
+        "    u8 a = 250\n"
+        "    u8 b = a + 10\n"
+        "    i8 c = 0 - 128\n"
+        "    i8 d = c - 1\n"
+        "    print(\"%d %d\\n\" % b, d)\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Wrapping program exits cleanly");
+    ASSERT_EQUAL_STRING("4 127\n", output, "u8 and i8 wrap at their own width");
+
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_SATURATE, output, sizeof(output)),
+                     "Saturating program exits cleanly");
+    ASSERT_EQUAL_STRING("255 -128\n", output, "u8 and i8 clamp to their bounds");
+
+    int status = run_with_overflow_mode(program, PF_OVERFLOW_CHECKED, output, sizeof(output));
+    ASSERT_TRUE(status > 0, "Checked program fails on overflow");
+    ASSERT_EQUAL_STRING("", output, "Nothing is printed after the overflow");
+    free_ast(program);
+
+    const char* division =
+        "f quotient(a: i32, b: i32) -> i32:\n"
+        "    return a / b\n"
+        "f remainder(a: i32, b: i32) -> i32:\n"
+        "    return a % b\n"
+        "f main() -> null:\n"
+        "    i32 low = 0 - 2147483647 - 1\n"
+        "    print(\"%d \" % remainder(low, 0 - 1))\n"
+        "    print(\"%d %d\\n\" % quotient(low, 0 - 1), quotient(0 - 7, 2))\n"
+        "    return null\n";
+    program = parse_program_source(division, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Division program parses");
+    if (program != NULL) {
+        ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                         "Wrapping division exits cleanly");
+        ASSERT_EQUAL_STRING("0 -2147483648 -3\n", output, "The minimum over -1 wraps to itself, with remainder 0");
+        ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_SATURATE, output, sizeof(output)),
+                         "Saturating division exits cleanly");
+        ASSERT_EQUAL_STRING("0 2147483647 -3\n", output, "and clamps to the maximum");
+        ASSERT_TRUE(run_with_overflow_mode(program, PF_OVERFLOW_CHECKED, output, sizeof(output)) > 0,
+                    "Checked division fails on overflow");
+        ASSERT_EQUAL_STRING("0 ", output, "after the remainder, which cannot overflow");
+        free_ast(program);
+    }
+
+    // Constants are computed at their slot's width, or their literals' if
+    // wider, and signed against unsigned compares values
+    const char* constants =
+        "f main() -> null:\n"
+        "    i64 sum = 5000000000 + 1\n"
+        "    i64 product = 3000000000 * 2\n"
+        "    i64 wide = 2000000000 + 2000000000\n"
+        "    u64 top = 18446744073709551615\n"
+        "    u64 one = 1\n"
+        "    i64 minus = 0 - 1\n"
+        "    u32 one32 = 1\n"
+        "    i32 minus32 = 0 - 1\n"
+        "    print(\"%d %d %d %d %d\\n\" % sum, product, wide, top, 5000000000 + 1)\n"
+        "    print(\"%s %s %s %s\\n\" % (one > minus), (one32 > minus32), (minus < top), (one == minus))\n"
+        "    return null\n";
+    program = parse_program_source(constants, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Constant program parses");
+    if (program != NULL) {
+        ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_CHECKED, output, sizeof(output)),
+                         "Wide constants do not overflow in checked mode");
+        ASSERT_EQUAL_STRING("5000000001 6000000000 4000000000 18446744073709551615 5000000001\n"
+                            "true true true false\n",
+                            output, "Wide constants keep their value and mixed signs compare by value");
+        free_ast(program);
+    }
+
+    const char* by_zero =
+        "f quotient(a: u8, b: u8) -> u8:\n"
+        "    return a / b\n"
+        "f main() -> null:\n"
+        "    print(\"%d\\n\" % quotient(7, 0))\n"
+        "    return null\n";
+    program = parse_program_source(by_zero, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Division by zero parses");
+    if (program != NULL) {
+        pf_overflow_mode modes[] = {PF_OVERFLOW_WRAP, PF_OVERFLOW_CHECKED, PF_OVERFLOW_SATURATE};
+        for (int m = 0; m < 3; m++) {
+            char c_path[64];
+            char exe_path[64];
+            snprintf(c_path, sizeof(c_path), "/tmp/pflang-by-zero-%d.c", (int)getpid());
+            snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-by-zero-%d", (int)getpid());
+            FILE* out = fopen(c_path, "w");
+            ASSERT_TRUE(codegen_c_emit(program, "by_zero.pf", modes[m], out), "Division by zero compiles");
+            fclose(out);
+            ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "in every overflow mode");
+
+            char command[128];
+            snprintf(command, sizeof(command), "%s 2>&1", exe_path);
+            FILE* run = popen(command, "r");
+            size_t length = fread(output, 1, sizeof(output) - 1, run);
+            output[length] = '\0';
+            ASSERT_TRUE(pclose(run) > 0, "Dividing by zero stops the program");
+            ASSERT_EQUAL_STRING("[line 2] Error: division by zero\n", output, "with the line of the division");
+            remove(c_path);
+            remove(exe_path);
+        }
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test (T, error) results unpacked into locals
+void test_codegen_c_error_results() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Error Results ===\n");
+
+    const char* source =
+        "f div(a: int, b: int) -> (int, error):\n"
+        "    if b == 0:\n"
+        "        return (0, error(\"Division by zero\"))\n"
+        "    return (a / b, null)\n"
+        "f main() -> null:\n"
+        "    int q, error err = div(7, 2)\n"
+        "    if err == null:\n"
+        "        print(\"%d\\n\" % q)\n"
+        "    int r, error bad = div(1, 0)\n"
+        "    if bad != null:\n"
+        "        print(bad)\n"
+        "    error first = error(\"failure number %d\" % 1)\n"
+        "    for i = range(9):\n"
+        "        print(\"%d\" % i)\n"
+        "    print(first)\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    ASSERT_TRUE(strstr(code, "pf_ret_div pf_tuple_0 = pf_fn_div(7, 2);") != NULL, "Results come back by value");
+    ASSERT_TRUE(strstr(code, "pf_error err = pf_tuple_0.v1;") != NULL, "Error is unpacked into its local");
+    ASSERT_TRUE(strstr(code, "malloc") == NULL, "Nothing is heap allocated");
+    free(code);
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("3\nerror(Division by zero)012345678error(failure number 1)", output,
+                        "Both results are checked, and a formatted message outlives later formats");
+    free_ast(program);
+
+    // Two million formatted errors: with the messages on the collected
+    // heap, the program fits in a fraction of what keeping them would take
+    const char* churn =
+        "f check(i: i64) -> (i64, error):\n"
+        "    if i % 2 == 0:\n"
+        "        return (0, error(\"request %d failed with a message long enough to matter\" % i))\n"
+        "    return (i, null)\n"
+        "f main() -> null:\n"
+        "    i64 failures = 0\n"
+        "    for i = range(4000000):\n"
+        "        i64 v, error err = check(i)\n"
+        "        if err != null:\n"
+        "            failures = failures + 1\n"
+        "    print(\"%d\\n\" % failures)\n"
+        "    return null\n";
+    program = parse_program_source(churn, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Error churn program parses");
+    if (program != NULL) {
+        char c_path[64];
+        char exe_path[64];
+        snprintf(c_path, sizeof(c_path), "/tmp/pflang-errors-%d.c", (int)getpid());
+        snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-errors-%d", (int)getpid());
+        out = fopen(c_path, "w");
+        ASSERT_TRUE(codegen_c_emit(program, "errors.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+        fclose(out);
+        ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+
+        char command[160];
+        snprintf(command, sizeof(command), "ulimit -v 150000; PFLANG_GC_NURSERY=64k %s 2>&1", exe_path);
+        FILE* run = popen(command, "r");
+        size_t length = fread(output, 1, sizeof(output) - 1, run);
+        output[length] = '\0';
+        ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly within 150 MB");
+        ASSERT_EQUAL_STRING("2000000\n", output, "Every error is seen");
+
+        remove(c_path);
+        remove(exe_path);
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test formats compiled into typed appends, and conversions checked against types
+void test_codegen_c_compiled_formats() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Compiled Formats ===\n");
+
+    const char* source =
+        "f main() -> null:\n"
+        "    u64 big = 4000000000\n"
+        "    i64 base = 1234567890123\n"
+        "    i64 low = 0 - base\n"
+        "    f64 half = 0.5\n"
+        "    f64 whole = 0.0 - 42.0\n"
+        "    bool small = half < 1.0\n"
+        "    print(\"%d|%d|%g|%f|%s|%s|100%%\\n\" % big, low, half, whole, \"text\", small)\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    ASSERT_TRUE(strstr(code, "pf_format(") == NULL, "Format is not parsed at run time");
+    ASSERT_TRUE(strstr(code, "pf_fmt_uint(&out, a0);") != NULL, "u64 uses the unsigned conversion");
+    free(code);
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("4000000000|-1234567890123|0.5|-42.000000|text|true|100%\n", output,
+                        "Values are formatted like the generic formatter");
+    free_ast(program);
+
+    // Results longer than the format buffers start out are not cut short
+    char long_source[1024];
+    char word[701];
+    memset(word, 'x', 700);
+    word[700] = '\0';
+    snprintf(long_source, sizeof(long_source),
+             "f main() -> null:\n"
+             "    str word = \"%s\"\n"
+             "    print(\"%%s|%%s|%%d\\n\" %% word, word, 42)\n"
+             "    return null\n",
+             word);
+    program = parse_program_source(long_source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Long program parses");
+    if (program != NULL) {
+        char long_output[2048];
+        ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, long_output, sizeof(long_output)),
+                         "Long format exits cleanly");
+        ASSERT_EQUAL_INT(700 + 1 + 700 + 4, (int)strlen(long_output), "A 1405 byte result is printed whole");
+        ASSERT_TRUE(strcmp(long_output + 1401, "|42\n") == 0, "up to its last value and newline");
+        free_ast(program);
+    }
+
+    const char* mismatched =
+        "f main() -> null:\n"
+        "    print(\"%d\\n\" % \"text\")\n"
+        "    return null\n";
+    program = parse_program_source(mismatched, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Mismatched program parses");
+    if (program != NULL) {
+        out = open_memstream(&code, &size);
+        ASSERT_FALSE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "%d of a str is rejected");
+        fclose(out);
+        free(code);
+        free_ast(program);
+    }
+
+    // Each float conversion keeps its own notation and follows a precision
+    const char* floats =
+        "f main() -> null:\n"
+        "    f64 big = 100000000000000000000.0\n"
+        "    f64 third = 1.0 / 3.0\n"
+        "    print(\"%f|%.2f|%e|%.3e|%g|%.3g|%.0f\\n\" % big, third, big, third, big, third, 2.5)\n"
+        "    return null\n";
+    program = parse_program_source(floats, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Float program parses");
+    if (program != NULL) {
+        char float_output[256];
+        ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, float_output, sizeof(float_output)),
+                         "Float formats exit cleanly");
+        ASSERT_EQUAL_STRING("100000000000000000000.000000|0.33|1.000000e+20|3.333e-01|1e+20|0.333|2\n",
+                            float_output, "%f, %e and %g print like printf");
+        free_ast(program);
+    }
+
+    const char* int_precision =
+        "f main() -> null:\n"
+        "    print(\"%.2d\\n\" % 7)\n"
+        "    return null\n";
+    program = parse_program_source(int_precision, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Integer precision program parses");
+    if (program != NULL) {
+        out = open_memstream(&code, &size);
+        ASSERT_FALSE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "A precision on %d is rejected");
+        fclose(out);
+        free(code);
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test that printed lines are batched into few writes when stdout is a pipe
+void test_codegen_c_buffered_output() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Buffered Output ===\n");
+
+    const char* source =
+        "f main() -> null:\n"
+        "    int i = 0\n"
+        "    while i < 10000:\n"
+        "        print(\"line %d\\n\" % i)\n"
+        "        i = i + 1\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-output-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-output-%d", (int)getpid());
+
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit(program, "output.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    bool built = codegen_c_compile(c_path, exe_path);
+    ASSERT_TRUE(built, "Executable builds");
+
+    if (built) {
+        char command[160];
+        snprintf(command, sizeof(command), "%s | tail -n 1", exe_path);
+        FILE* run = popen(command, "r");
+        char last[64] = {0};
+        if (fgets(last, sizeof(last), run) == NULL) last[0] = '\0';
+        pclose(run);
+        ASSERT_EQUAL_STRING("line 9999\n", last, "Every line reaches the pipe in order");
+
+        snprintf(command, sizeof(command), "PFLANG_RUNTIME_STATS=1 %s 2>&1 >/dev/null", exe_path);
+        run = popen(command, "r");
+        unsigned long long bytes = 0, syscalls = 0, flushes = 0;
+        int fields = fscanf(run, "pflang runtime: %llu bytes written in %llu syscalls (%llu flushes)",
+                            &bytes, &syscalls, &flushes);
+        pclose(run);
+        ASSERT_EQUAL_INT(3, fields, "Runtime stats are reported on request");
+        ASSERT_EQUAL_INT(98890, (int)bytes, "Every byte is written");
+        ASSERT_TRUE(syscalls > 0 && syscalls < 10, "10000 lines take a handful of syscalls");
+    }
+
+    remove(c_path);
+    remove(exe_path);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test str values: interned literals, content equality and formatted copies
+void test_codegen_c_strings() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Strings ===\n");
+
+    const char* source =
+        "f greet(name: str) -> str:\n"
+        "    return \"hello, %s\" % name\n"
+        "f main() -> null:\n"
+        "    str key = \"key\"\n"
+        "    str text = \"a literal well past sixteen bytes\"\n"
+        "    str same = \"a literal well past sixteen bytes\"\n"
+        "    bool keys_match = key == \"key\"\n"
+        "    bool texts_match = text == same\n"
+        "    bool differ = key != text\n"
+        "    str greeting = greet(\"world\")\n"
+        "    print(\"%s|%s|%s|%s|%s\\n\" % keys_match, texts_match, differ, greeting, key)\n"
+        "    print(error(greeting))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    const char* literal = "PF_STRING_LITERAL(\"a literal well past sixteen bytes\")";
+    char* first = strstr(code, literal);
+    ASSERT_TRUE(first != NULL && strstr(first + 1, literal) == NULL, "Identical literals are interned once");
+    ASSERT_TRUE(strstr(code, "pf_intern_literals();") != NULL, "Literals are interned at load time");
+    ASSERT_TRUE(strstr(code, "pf_string_equal(key, pf_literals[0])") != NULL, "== compares contents");
+    free(code);
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("true|true|true|hello, world|key\nerror(hello, world)", output,
+                        "Strings compare and format by content");
+
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test calls to the builtin string library
+void test_codegen_c_string_builtins() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend String Builtins ===\n");
+
+    const char* source =
+        "f main() -> null:\n"
+        "    str line = \"GET /users/42 HTTP/1.1\"\n"
+        "    i64 at = find(line, \"/42\")\n"
+        "    i64 slashes = count(line, \"/\")\n"
+        "    bool get = starts_with(line, \"GET\")\n"
+        "    bool valid = is_utf8(line)\n"
+        "    print(\"%d %d %s %s %s\\n\" % at, slashes, get, valid, to_lower(line))\n"
+        "    list[str] words = split(line, \" \")\n"
+        "    append(words, \"!\")\n"
+        "    print(\"%d %s %s\\n\" % len(words), words[1], words[3])\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("10 3 true true get /users/42 http/1.1\n4 /users/42 !\n", output,
+                        "Builtins run on the runtime library");
+    free_ast(program);
+
+    const char* mistyped =
+        "f main() -> null:\n"
+        "    i64 at = find(\"text\", 4)\n"
+        "    return null\n";
+    program = parse_program_source(mistyped, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Mistyped program parses");
+    if (program != NULL) {
+        char* code = NULL;
+        size_t size = 0;
+        FILE* out = open_memstream(&code, &size);
+        ASSERT_FALSE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "find() of an int is rejected");
+        fclose(out);
+        free(code);
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test the map builtins counting words
+void test_codegen_c_maps() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Maps ===\n");
+
+    const char* source =
+        "f main() -> null:\n"
+        "    i64 counts = map_new()\n"
+        "    list[str] words = split(\"GET /a POST /b GET /a DELETE /a-much-longer-route\", \" \")\n"
+        "    for i = range(len(words)):\n"
+        "        map_set(counts, words[i], map_get(counts, words[i], 0) + 1)\n"
+        "    bool removed = map_remove(counts, \"DELETE\")\n"
+        "    print(\"%d %d %d %s %s\\n\" % map_get(counts, \"/a\", 0), map_get(counts, \"/a-much-longer-route\", 0),\n"
+        "          map_count(counts), removed, map_has(counts, \"DELETE\"))\n"
+        "    map_free(counts)\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char output[64];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("2 1 5 true false\n", output, "Maps count, remove and look up keys");
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test element-typed arrays and lists
+void test_codegen_c_arrays() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Arrays and Lists ===\n");
+
+    const char* source =
+        "f total(xs: array[u8]) -> i64:\n"
+        "    i64 sum = 0\n"
+        "    i64 i = 0\n"
+        "    while i < len(xs):\n"
+        "        sum = sum + xs[i]\n"
+        "        i = i + 1\n"
+        "    return sum\n"
+        "f main() -> null:\n"
+        "    array[u8] bytes = array(4)\n"
+        "    bytes[0] = 200\n"
+        "    bytes[3] = 100\n"
+        "    array[u8] tail = slice(bytes, 2, 4)\n"
+        "    tail[0] = 7\n"
+        "    list[f64] values = list()\n"
+        "    i64 i = 0\n"
+        "    while i < 20:\n"
+        "        append(values, 0.5)\n"
+        "        i = i + 1\n"
+        "    print(\"%d %d %d %d %g\\n\" % total(bytes), len(tail), bytes[2], len(values), values[19])\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    ASSERT_TRUE(strstr(code, "int64_t pf_fn_total(pf_array_u8 xs)") != NULL, "Arrays are passed by value");
+    ASSERT_TRUE(strstr(code, "pf_list_f64* values = pf_list_f64_new_in(&pf_region, 0, ") != NULL,
+                "list() takes its element type from the declaration");
+    ASSERT_TRUE(strstr(code, "*pf_array_u8_at(bytes, 0, ") != NULL, "Stores go through the checked accessor");
+    free(code);
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("307 2 7 20 0.5\n", output, "Slices share their parent's elements and lists grow");
+    free_ast(program);
+
+    const char* out_of_bounds =
+        "f main() -> null:\n"
+        "    array[i32] xs = array(3)\n"
+        "    print(xs[3])\n"
+        "    return null\n";
+    program = parse_program_source(out_of_bounds, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Out-of-bounds program parses");
+    if (program != NULL) {
+        int status = run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output));
+        ASSERT_TRUE(status > 0, "Indexing past the end fails");
+        ASSERT_EQUAL_STRING("", output, "Nothing is printed for the bad index");
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+void test_codegen_c_numeric_builtins() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Numeric Builtins ===\n");
+
+    const char* source =
+        "f main() -> null:\n"
+        "    array[i32] xs = array(100)\n"
+        "    list[f64] ys = list()\n"
+        "    i64 i = 0\n"
+        "    while i < 100:\n"
+        "        xs[i] = i - 1\n"
+        "        append(ys, 0.5)\n"
+        "        i = i + 1\n"
+        "    scale(xs, 2)\n"
+        "    array[bool] big = mask_gt(xs, 189)\n"
+        "    print(\"%d %d %d %d %g\\n\" % sum(xs), min(xs), max(xs), dot(xs, xs), sum(ys))\n"
+        "    print(big[99])\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    ASSERT_TRUE(strstr(code, "pf_sum_i32(xs)") != NULL, "sum calls the kernel for the element type");
+    ASSERT_TRUE(strstr(code, "pf_sum_f64(pf_list_f64_view(ys))") != NULL, "Lists are passed as their view");
+    free(code);
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("9700 -2 196 1274200 50\ntrue", output, "Builtins agree with the loops they replace");
+    free_ast(program);
+
+    const char* empty =
+        "f main() -> null:\n"
+        "    array[u8] xs = array(0)\n"
+        "    print(min(xs))\n"
+        "    return null\n";
+    program = parse_program_source(empty, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Empty-array program parses");
+    if (program != NULL) {
+        int status = run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output));
+        ASSERT_TRUE(status > 0, "min of an empty array fails");
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+void test_codegen_c_for_range() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend For Range ===\n");
+
+    const char* source =
+        "f total(xs: array[i32], step: i64) -> i64:\n"
+        "    i64 sum = 0\n"
+        "    for i = range(0, len(xs), step):\n"
+        "        sum = sum + xs[i]\n"
+        "    return sum\n"
+        "f main() -> null:\n"
+        "    array[i32] xs = array(10)\n"
+        "    for i32 i = range(10):\n"
+        "        xs[i] = i * i\n"
+        "    for u8 b = range(253, 256):\n"
+        "        print(\"%d \" % b)\n"
+        "    for i = range(9, -1, -3):\n"
+        "        print(\"%d \" % i)\n"
+        "        i = 100\n"
+        "    print(\"%d %d\\n\" % total(xs, 1), total(xs, 4))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    ASSERT_TRUE(strstr(code, "pf_range_count(") != NULL, "range() becomes a trip count");
+    ASSERT_TRUE(strstr(code, "uint8_t b = (uint8_t)(") != NULL, "The variable has its declared width");
+    free(code);
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("253 254 255 9 6 3 0 285 80\n", output,
+                        "Loops stop at the end of a narrow type, count down and ignore assignments to i");
+    free_ast(program);
+
+    const char* zero_step =
+        "f main() -> null:\n"
+        "    for i = range(0, 10, 0):\n"
+        "        print(i)\n"
+        "    return null\n";
+    program = parse_program_source(zero_step, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Zero-step program parses");
+    if (program != NULL) {
+        out = open_memstream(&code, &size);
+        ASSERT_FALSE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "A zero step is rejected");
+        fclose(out);
+        free(code);
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test that accesses the IR proves in bounds lose their checks and that a
+// for loop checks its range once, falling back to checked code if it does
+// not fit
+void test_codegen_c_bounds_checks() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Bounds Checks ===\n");
+
+    const char* source =
+        "f total(xs: array[i64], ys: list[i64], n: i64) -> i64:\n"
+        "    i64 sum = 0\n"
+        "    for i = range(len(xs)):\n"
+        "        sum = sum + xs[i]\n"
+        "    for i = range(n):\n"
+        "        sum = sum + xs[i] * ys[i]\n"
+        "        ys[i] = 0\n"
+        "    return sum\n"
+        "f main() -> null:\n"
+        "    array[i64] xs = array(4)\n"
+        "    list[i64] ys = list()\n"
+        "    for i = range(4):\n"
+        "        xs[i] = i + 1\n"
+        "        append(ys, 10)\n"
+        "    print(\"%d \" % total(xs, ys, 4))\n"
+        "    print(\"%d\\n\" % total(xs, ys, 5))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    ASSERT_TRUE(strstr(code, "((xs).data + (i))") != NULL, "A proven access reads the element directly");
+    ASSERT_TRUE(strstr(code, "pf_range_fits(pf_start_1, pf_count_1, pf_step_1, xs.length) && "
+                             "pf_range_fits(pf_start_1, pf_count_1, pf_step_1, ys->length)") != NULL,
+                "Each sequence of the loop is checked once against its range");
+    ASSERT_EQUAL_INT(1, count_substrings(code, "pf_list_i64_at(ys, i, "),
+                     "Only the read of ys[i] in the other copy is checked; ys[i] = 0 follows it");
+    ASSERT_TRUE(strstr(code, "*((ys)->data + (i)) = 0") != NULL, "The store after a checked read is unchecked");
+    free(code);
+
+    char output[256];
+    int status = run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output));
+    ASSERT_TRUE(status != 0, "An index past the end still stops the program");
+    ASSERT_EQUAL_STRING("110 ", output, "Both copies of the loop compute the same sums");
+    free_ast(program);
+
+    print_test_results(&stats);
+}
+
+// Test that vectorizable for loops run in blocks with a scalar epilogue,
+// give the results of the plain loop, and fall back to it when a written
+// array overlaps another
+void test_codegen_c_vector_loops() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Vector Loops ===\n");
+
+    const char* source =
+        "f add(a: array[i32], b: list[i32], out: array[i32]) -> null:\n"
+        "    for i = range(len(out)):\n"
+        "        out[i] = a[i] + b[i]\n"
+        "    return null\n"
+        "f total(xs: array[i32]) -> i64:\n"
+        "    i64 sum = 0\n"
+        "    for i = range(len(xs)):\n"
+        "        sum = sum + xs[i]\n"
+        "    return sum\n"
+        "f main() -> null:\n"
+        "    array[i32] xs = array(41)\n"
+        "    list[i32] ys = list()\n"
+        "    for i = range(41):\n"
+        "        xs[i] = i\n"
+        "        append(ys, 1000)\n"
+        "    array[i32] out = array(37)\n"
+        "    add(xs, ys, out)\n"
+        "    print(\"%d %d %d \" % total(out), out[0], out[36])\n"
+        "    add(xs, ys, xs)\n"
+        "    print(\"%d \" % total(xs))\n"
+        "    array[i32] zs = array(41)\n"
+        "    add(slice(zs, 0, 40), ys, slice(zs, 1, 41))\n"
+        "    print(\"%d\\n\" % zs[40])\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    ASSERT_EQUAL_INT(2, count_substrings(code, "PF_VECTORIZE"), "add and total run in blocks");
+    ASSERT_TRUE(strstr(code, "pf_array_i32 b = pf_view_") != NULL, "A list is read through an array view");
+    ASSERT_TRUE(strstr(code, "pf_same_or_disjoint(out.data, out.length, a.data, a.length, sizeof(*out.data))") != NULL,
+                "The written array is checked against the others");
+    ASSERT_TRUE(strstr(code, "for (; pf_k_0 < pf_count_0; pf_k_0++)") != NULL, "Leftover iterations run one by one");
+    free(code);
+
+    // 37 elements are two blocks of 16 and five leftovers; 10 * 1000
+    // added to each element of zs in turn makes zs[40] 40000
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("37666 1000 1036 41820 40000\n", output,
+                        "Blocks, leftovers, arrays written in place and overlapping slices all match the plain loop");
+    free_ast(program);
+
+    print_test_results(&stats);
+}
+
+// Test that functions the IR inlined everywhere are marked for the C
+// compiler, and that a program built to count its calls writes a profile
+// the inliner can read back
+void test_codegen_c_call_profile() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Call Profiles ===\n");
+
+    const char* source =
+        "f twice(x: i64) -> i64:\n"
+        "    return x * 2\n"
+        "f fact(n: i64) -> i64:\n"
+        "    if n < 2:\n"
+        "        return 1\n"
+        "    return n * fact(n - 1)\n"
+        "f main() -> null:\n"
+        "    i64 total = 0\n"
+        "    for i = range(10):\n"
+        "        total = total + twice(i)\n"
+        "    print(\"%d %d\\n\" % total, fact(5))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    char profile_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-profile-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-profile-%d", (int)getpid());
+    snprintf(profile_path, sizeof(profile_path), "/tmp/pflang-profile-%d.prof", (int)getpid());
+
+    CodegenCOptions options = {.overflow_mode = PF_OVERFLOW_WRAP, .count_calls = true};
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit_with_options(program, "profile.pf", &options, out), "C is emitted without errors");
+    fclose(out);
+
+    char* code = read_file(c_path);
+    ASSERT_TRUE(strstr(code, "static PF_ALWAYS_INLINE int64_t pf_fn_twice(int64_t x)") != NULL,
+                "A function inlined at every call is inlined by the C compiler too");
+    ASSERT_TRUE(strstr(code, "static int64_t pf_fn_fact(int64_t n)") != NULL, "A recursive function is not");
+    ASSERT_TRUE(strstr(code, "(pf_call_counts[0]++, pf_fn_fact(") != NULL, "Calls bump their site's counter");
+    ASSERT_TRUE(strstr(code, "pf_write_call_profile(pf_call_sites, pf_call_counts, ") != NULL,
+                "The counts are written when main returns");
+    free(code);
+
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "Generated C compiles");
+    char command[256];
+    snprintf(command, sizeof(command), "PFLANG_CALL_PROFILE=%s %s", profile_path, exe_path);
+    FILE* run = popen(command, "r");
+    char output[64];
+    size_t length = fread(output, 1, sizeof(output) - 1, run);
+    output[length] = '\0';
+    ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("90 120\n", output, "Counting calls does not change the results");
+
+    // A loop emitted in more than one copy counts each copy of a call on
+    // its own line of the profile; the inliner adds them up
+    int count = 0;
+    IrCallCount* profile = ir_read_call_profile(profile_path, &count);
+    ASSERT_TRUE(profile != NULL && count >= 3, "The profile has a line per call site");
+    uint64_t recursive_calls = 0;
+    uint64_t loop_calls = 0;
+    uint64_t other_calls = 0;
+    for (int i = 0; i < count; i++) {
+        if (profile[i].line == 6) {
+            recursive_calls += profile[i].count;
+        } else if (profile[i].line == 10) {
+            loop_calls += profile[i].count;
+        } else {
+            other_calls += profile[i].count;
+        }
+    }
+    ASSERT_TRUE(recursive_calls == 4 && loop_calls == 10 && other_calls == 1, "Each site counts its own calls");
+    ir_free_call_profile(profile, count);
+
+    remove(c_path);
+    remove(exe_path);
+    remove(profile_path);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test that a program built for perf writes a map entry per function
+void test_codegen_c_perf_map() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Perf Maps ===\n");
+
+    const char* source =
+        "f twice(x: i64) -> i64:\n"
+        "    return x * 2\n"
+        "f main() -> null:\n"
+        "    print(\"%d\\n\" % twice(21))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    char map_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-perf-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-perf-%d", (int)getpid());
+    snprintf(map_path, sizeof(map_path), "/tmp/pflang-perf-%d.map", (int)getpid());
+    remove(map_path);
+
+    CodegenCOptions options = {.overflow_mode = PF_OVERFLOW_WRAP, .perf_map = true};
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit_with_options(program, "perf.pf", &options, out), "C is emitted without errors");
+    fclose(out);
+
+    char* code = read_file(c_path);
+    ASSERT_EQUAL_INT(4, count_substrings(code, "PF_PERF_CODE"), "Both functions go in the perf section");
+    ASSERT_TRUE(strstr(code, "{(const void*)pf_fn_twice, \"pf:twice (perf.pf:1)\", 1},") != NULL,
+                "Symbols are named after the function and its line");
+    ASSERT_TRUE(strstr(code, "pf_perf_register(pf_perf_symbols, 2, __stop_pf_code, \"perf.pf\");") != NULL,
+                "main registers them on start");
+    free(code);
+
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "Generated C compiles");
+    char command[256];
+    snprintf(command, sizeof(command), "PFLANG_PERF_MAP=%s %s", map_path, exe_path);
+    FILE* run = popen(command, "r");
+    char output[64];
+    size_t length = fread(output, 1, sizeof(output) - 1, run);
+    output[length] = '\0';
+    ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("42\n", output, "Registering does not change the results");
+
+    // START SIZE name, sorted by address, one range after the other
+    char* map = read_file(map_path);
+    ASSERT_TRUE(map != NULL, "The perf map was written");
+    if (map != NULL) {
+        unsigned long starts[2] = {0, 0};
+        size_t sizes[2] = {0, 0};
+        char names[2][64];
+        int entries = 0;
+        const char* line = map;
+        while (entries < 2 && sscanf(line, "%lx %zx %63[^\n]", &starts[entries], &sizes[entries], names[entries]) == 3) {
+            entries++;
+            line = strchr(line, '\n');
+            if (line == NULL) break;
+            line++;
+        }
+        ASSERT_EQUAL_INT(2, entries, "The map has a line per function");
+        ASSERT_EQUAL_INT(2, count_substrings(map, "\n"), "and nothing else");
+        ASSERT_TRUE(strstr(map, " pf:twice (perf.pf:1)\n") != NULL && strstr(map, " pf:main (perf.pf:3)\n") != NULL,
+                    "Entries carry the .pf names and lines");
+        ASSERT_TRUE(sizes[0] > 0 && sizes[1] > 0 && starts[0] + sizes[0] <= starts[1],
+                    "Each function ends before the next one starts");
+        free(map);
+    }
+
+    // The path goes into the names and the registration call escaped
+    out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit_with_options(program, "a\"b\\perf.pf", &options, out), "C is emitted for an odd path");
+    fclose(out);
+    code = read_file(c_path);
+    ASSERT_TRUE(strstr(code, "\"pf:twice (a\\\"b\\\\perf.pf:1)\", 1},") != NULL, "Symbol names are escaped");
+    ASSERT_TRUE(strstr(code, "__stop_pf_code, \"a\\\"b\\\\perf.pf\");") != NULL, "The registered path is escaped");
+    free(code);
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C with an odd path compiles");
+
+    remove(c_path);
+    remove(exe_path);
+    remove(map_path);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test that tail calls closing a cycle become jumps, for a function
+// calling itself and for two functions calling each other, and that the
+// report says which tail calls were left alone
+void test_codegen_c_tail_calls() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Tail Calls ===\n");
+
+    const char* source =
+        "f count(n: i64, acc: i64) -> i64:\n"
+        "    if n == 0:\n"
+        "        return acc\n"
+        "    return count(n - 1, acc + n)\n"
+        "f even(n: i64) -> i64:\n"
+        "    if n == 0:\n"
+        "        return 1\n"
+        "    return odd(n - 1)\n"
+        "f odd(n: i64) -> i64:\n"
+        "    if n == 0:\n"
+        "        return 0\n"
+        "    return even(n - 1)\n"
+        "f half(n: i32) -> i64:\n"
+        "    return count(n, 0)\n"
+        "f small(n: i64) -> i32:\n"
+        "    return 3\n"
+        "f widen(n: i64) -> i64:\n"
+        "    return small(n)\n"
+        "f main() -> null:\n"
+        "    print(\"%d %d %d %d\\n\" % count(10000000, 0), even(10000001), half(10), widen(1))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    char* report = NULL;
+    size_t report_size = 0;
+    FILE* out = open_memstream(&code, &size);
+    FILE* report_out = open_memstream(&report, &report_size);
+    CodegenCOptions options = {.overflow_mode = PF_OVERFLOW_WRAP, .tail_call_report = report_out};
+    ASSERT_TRUE(codegen_c_emit_with_options(program, NULL, &options, out), "C is emitted without errors");
+    fclose(out);
+    fclose(report_out);
+
+    ASSERT_EQUAL_STRING("function count, line 4: tail call of count becomes a jump\n"
+                        "function even, line 8: tail call of odd becomes a jump\n"
+                        "function odd, line 12: tail call of even becomes a jump\n"
+                        "function half, line 14: tail call of count not optimized: "
+                        "half and count take different parameters\n"
+                        "function widen, line 18: tail call of small not optimized: "
+                        "its i32 result is converted to i64\n",
+                        report, "Each tail call is listed with what became of it");
+    ASSERT_TRUE(strstr(code, "pf_tail_call:;\n") != NULL && strstr(code, "goto pf_tail_call;") != NULL,
+                "A function calling itself jumps back to its top");
+    ASSERT_TRUE(strstr(code, "static int64_t pf_tail_even(int pf_entry, int64_t pf_arg_0)") != NULL,
+                "Functions calling each other share one C function");
+    ASSERT_TRUE(strstr(code, "goto pf_enter_odd;") != NULL && strstr(code, "goto pf_enter_even;") != NULL,
+                "Their tail calls jump between entry labels");
+    ASSERT_TRUE(strstr(code, "return pf_tail_even(1, n);") != NULL, "odd enters the shared function");
+    free(code);
+    free(report);
+
+    // Ten million frames would overflow the stack without the jumps
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("50000005000000 0 55 3\n", output, "Deep tail recursion runs to completion");
+    free_ast(program);
+
+    print_test_results(&stats);
+}
+
+// Test that arrays and lists escape analysis keeps to one call live in its
+// frame or region, and that the region is freed on every way out
+void test_codegen_c_allocations() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Allocations ===\n");
+
+    const char* source =
+        "f make(n: i64) -> array[i64]:\n"
+        "    array[i64] xs = array(n)\n"
+        "    return xs\n"
+        "f squares(n: i64) -> i64:\n"
+        "    list[i64] values = list()\n"
+        "    for i = range(n):\n"
+        "        append(values, i * i)\n"
+        "    array[i64] total = array(1)\n"
+        "    for i = range(len(values)):\n"
+        "        total[0] = total[0] + values[i]\n"
+        "    return total[0]\n"
+        "f main() -> null:\n"
+        "    i64 sum = 0\n"
+        "    for i = range(100000):\n"
+        "        sum = sum + squares(10)\n"
+        "    array[i64] kept = make(4)\n"
+        "    print(\"%d %d\\n\" % sum, len(kept))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char* code = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&code, &size);
+    ASSERT_TRUE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+    ASSERT_TRUE(strstr(code, "pf_array_i64 xs = pf_array_i64_new(n, ") != NULL, "A returned array is on the heap");
+    ASSERT_TRUE(strstr(code, "pf_list_i64* values = pf_list_i64_new_in(&pf_region, 0, ") != NULL,
+                "A list used only by its function is in its region");
+    ASSERT_TRUE(strstr(code, "int64_t pf_frame_2[2];") != NULL &&
+                strstr(code, "pf_array_i64 total = pf_array_i64_on_frame(pf_frame_2, 1);") != NULL,
+                "A small array used only by its function is in its frame");
+    ASSERT_TRUE(strstr(code, "int64_t pf_result = ") != NULL &&
+                strstr(code, "pf_region_free(&pf_region);\n        return pf_result;") != NULL,
+                "The result is computed before the region is freed");
+    ASSERT_EQUAL_INT(1, count_substrings(code, "pf_region pf_region = PF_REGION_INIT;"),
+                     "Only a function with allocations there has a region");
+    free(code);
+
+    char output[256];
+    ASSERT_EQUAL_INT(0, run_with_overflow_mode(program, PF_OVERFLOW_WRAP, output, sizeof(output)),
+                     "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("28500000 4\n", output, "Region and frame allocations hold their values");
+    free_ast(program);
+
+    // Arrays made on every iteration of a loop or of a self tail call would
+    // pile up in a region freed only at return: 1.6 GB each here
+    const char* churn =
+        "f churn(n: i64, total: i64) -> i64:\n"
+        "    if n == 0:\n"
+        "        return total\n"
+        "    array[i64] xs = array(1000)\n"
+        "    xs[0] = n\n"
+        "    return churn(n - 1, total + xs[0] % 2)\n"
+        "f main() -> null:\n"
+        "    i64 total = 0\n"
+        "    for i = range(200000):\n"
+        "        array[i64] xs = array(1000)\n"
+        "        xs[999] = i\n"
+        "        total = total + xs[999] % 2\n"
+        "    print(\"%d %d\\n\" % total, churn(200000, 0))\n"
+        "    return null\n";
+    program = parse_program_source(churn, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Churn program parses");
+    if (program != NULL) {
+        char c_path[64];
+        char exe_path[64];
+        snprintf(c_path, sizeof(c_path), "/tmp/pflang-churn-%d.c", (int)getpid());
+        snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-churn-%d", (int)getpid());
+        out = fopen(c_path, "w");
+        ASSERT_TRUE(codegen_c_emit(program, "churn.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+        fclose(out);
+        ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+
+        char command[160];
+        snprintf(command, sizeof(command), "ulimit -v 200000; %s 2>&1", exe_path);
+        FILE* run = popen(command, "r");
+        size_t length = fread(output, 1, sizeof(output) - 1, run);
+        output[length] = '\0';
+        ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly within 200 MB");
+        ASSERT_EQUAL_STRING("100000 100000\n", output, "Every iteration sees its own array");
+
+        remove(c_path);
+        remove(exe_path);
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test a program allocating many times its nursery: strings reached from
+// lists and arrays survive the collections it triggers
+void test_codegen_c_garbage_collection() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Garbage Collection ===\n");
+
+    const char* source =
+        "f shout(s: str, n: i64) -> list[str]:\n"
+        "    list[str] words = list()\n"
+        "    for i = range(n):\n"
+        "        append(words, to_upper(s))\n"
+        "    return words\n"
+        "f main() -> null:\n"
+        "    array[str] keep = array(2)\n"
+        "    i64 total = 0\n"
+        "    for r = range(2000):\n"
+        "        list[str] words = shout(\"Garbage Collected Strings\", 50)\n"
+        "        array[f64] scratch = array(64)\n"
+        "        total = total + len(words) + len(scratch)\n"
+        "        keep[0] = words[7]\n"
+        "        keep[1] = to_lower(words[9])\n"
+        "    print(\"%d %d %d\\n\" % total, count(keep[0], \"GARBAGE\"), count(keep[1], \"garbage\"))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-gc-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-gc-%d", (int)getpid());
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit(program, "gc.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+
+    FILE* code = fopen(c_path, "r");
+    char text[65536];
+    size_t length = fread(text, 1, sizeof(text) - 1, code);
+    text[length] = '\0';
+    fclose(code);
+    ASSERT_TRUE(strstr(text, "pf_gc_store_string(") != NULL, "Storing a string goes through the write barrier");
+
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+    char command[160];
+    snprintf(command, sizeof(command), "PFLANG_GC_NURSERY=64k PFLANG_GC_STATS=1 %s 2>&1", exe_path);
+    char output[512];
+    FILE* run = popen(command, "r");
+    length = fread(output, 1, sizeof(output) - 1, run);
+    output[length] = '\0';
+    ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+    ASSERT_TRUE(strncmp(output, "228000 1 1\n", 11) == 0, "Strings survive the collections");
+
+    int minor = 0;
+    const char* statistics = strstr(output, "gc: ");
+    ASSERT_TRUE(statistics != NULL && sscanf(statistics, "gc: %d minor", &minor) == 1 && minor > 10,
+                "A small nursery is collected many times and PFLANG_GC_STATS reports it");
+
+    remove(c_path);
+    remove(exe_path);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test a program running tens of thousands of tasks that write to an
+// array shared with main, yield, and allocate while others collect
+void test_codegen_c_tasks() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Tasks ===\n");
+
+    const char* source =
+        "f fill(out: array[i64], i: i64) -> null:\n"
+        "    list[str] words = list()\n"
+        "    for k = range(4):\n"
+        "        append(words, to_upper(\"green thread\"))\n"
+        "        if k == i % 4:\n"
+        "            yield()\n"
+        "    if compare(words[3], \"GREEN THREAD\") == 0:\n"
+        "        out[i] = i * len(words)\n"
+        "    return null\n"
+        "f main() -> null:\n"
+        "    array[i64] out = array(20000)\n"
+        "    for i = range(20000):\n"
+        "        go fill(out, i)\n"
+        "    wait()\n"
+        "    i64 total = 0\n"
+        "    i64 i = 0\n"
+        "    while i < 20000:\n"
+        "        total = total + out[i]\n"
+        "        i = i + 1\n"
+        "    print(\"%d\\n\" % total)\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-tasks-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-tasks-%d", (int)getpid());
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit(program, "tasks.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+
+    FILE* code = fopen(c_path, "r");
+    char text[65536];
+    size_t length = fread(text, 1, sizeof(text) - 1, code);
+    text[length] = '\0';
+    fclose(code);
+    ASSERT_TRUE(strstr(text, "pf_task_spawn_at(pf_go_0, &pf_go, sizeof(pf_go), 13);") != NULL,
+                "go spawns a task through a trampoline");
+    ASSERT_TRUE(strstr(text, "pf_array_i64 out = pf_array_i64_new(20000, ") != NULL,
+                "An array passed to a task is on the heap");
+    ASSERT_TRUE(count_substrings(text, "pf_gc_safepoint();") >= 3, "Loops reach safepoints");
+
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+    char command[160];
+    snprintf(command, sizeof(command), "PFLANG_GC_NURSERY=64k PFLANG_TASK_THREADS=4 %s 2>&1", exe_path);
+    char output[512];
+    FILE* run = popen(command, "r");
+    length = fread(output, 1, sizeof(output) - 1, run);
+    output[length] = '\0';
+    ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("799960000\n", output, "Every task wrote its element before wait returned");
+    remove(c_path);
+    remove(exe_path);
+    free_ast(program);
+
+    // Recursion past the end of a task's stack is reported, not a crash
+    const char* deep =
+        "f depth(n: i64) -> i64:\n"
+        "    if n == 0:\n"
+        "        return 0\n"
+        "    i64 below = depth(n - 1)\n"
+        "    if below > n:\n"
+        "        print(\"never\\n\")\n"
+        "    return below + 1\n"
+        "f run(n: i64) -> null:\n"
+        "    print(\"%d\\n\" % depth(n))\n"
+        "    return null\n"
+        "f main() -> null:\n"
+        "    go run(1000)\n"
+        "    wait()\n"
+        "    go run(100000000)\n"
+        "    wait()\n"
+        "    return null\n";
+    program = parse_program_source(deep, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Deep program parses");
+    if (program != NULL) {
+        out = fopen(c_path, "w");
+        ASSERT_TRUE(codegen_c_emit(program, "deep.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+        fclose(out);
+        ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+
+        snprintf(command, sizeof(command), "PFLANG_TASK_STACK=64k %s 2>&1", exe_path);
+        run = popen(command, "r");
+        length = fread(output, 1, sizeof(output) - 1, run);
+        output[length] = '\0';
+        ASSERT_TRUE(pclose(run) > 0, "A task overflowing its stack stops the program");
+        ASSERT_EQUAL_STRING("1000\n[line 14] Error: stack overflow in task (64k stack; PFLANG_TASK_STACK sets its "
+                            "size)\n",
+                            output, "with the line of its go statement");
+
+        remove(c_path);
+        remove(exe_path);
+        free_ast(program);
+    }
+    print_test_results(&stats);
+}
+
+// Test that channels carry values between tasks: a bounded pipeline, an
+// unbounded channel, recv with its ok value, and select with and without
+// else
+void test_codegen_c_channels() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Channels ===\n");
+
+    const char* source =
+        "f produce(out: chan[i64], n: i64) -> null:\n"
+        "    for i = range(n):\n"
+        "        send(out, i)\n"
+        "    close(out)\n"
+        "    return null\n"
+        "f square(input: chan[i64], out: chan[i64]) -> null:\n"
+        "    bool open = 1 == 1\n"
+        "    while open:\n"
+        "        i64 v, bool ok = recv(input)\n"
+        "        open = ok\n"
+        "        if ok:\n"
+        "            send(out, v * v)\n"
+        "    send(out, -1)\n"
+        "    return null\n"
+        "f main() -> null:\n"
+        "    chan[i64] numbers = chan(16)\n"
+        "    chan[i64] squares = chan()\n"
+        "    chan[str] words = chan(1)\n"
+        "    go produce(numbers, 1000)\n"
+        "    go square(numbers, squares)\n"
+        "    i64 total = 0\n"
+        "    i64 sent = 0\n"
+        "    i64 done = 0\n"
+        "    while done == 0:\n"
+        "        select:\n"
+        "            i64 s = recv(squares):\n"
+        "                if s < 0:\n"
+        "                    done = 1\n"
+        "                else:\n"
+        "                    total = total + s\n"
+        "            send(words, \"word\"):\n"
+        "                sent = sent + 1\n"
+        "            str w = recv(words):\n"
+        "                total = total + compare(w, \"word\")\n"
+        "    wait()\n"
+        "    select:\n"
+        "        recv(squares):\n"
+        "            print(\"ready\\n\")\n"
+        "        else:\n"
+        "            print(\"%d\\n\" % total)\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-channels-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-channels-%d", (int)getpid());
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit(program, "channels.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+
+    FILE* code = fopen(c_path, "r");
+    char text[65536];
+    size_t length = fread(text, 1, sizeof(text) - 1, code);
+    text[length] = '\0';
+    fclose(code);
+    ASSERT_TRUE(strstr(text, "pf_chan_i64_new(16, ") != NULL, "chan(16) is bounded");
+    ASSERT_TRUE(strstr(text, "pf_chan_i64_new(PF_CHAN_UNBOUNDED, ") != NULL, "chan() is unbounded");
+    ASSERT_TRUE(strstr(text, "pf_chan_i64_recv_ok(input, &ok, ") != NULL, "recv can report a closed channel");
+    ASSERT_TRUE(count_substrings(text, "pf_chan_select(") == 2, "Each select is one runtime call");
+    ASSERT_TRUE(strstr(text, ", 3, true, &pf_sel_ok_") != NULL && strstr(text, ", 1, false, &pf_sel_ok_") != NULL,
+                "Only a select with else does not wait");
+
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+    char command[160];
+    snprintf(command, sizeof(command), "PFLANG_TASK_THREADS=4 %s 2>&1", exe_path);
+    char output[512];
+    FILE* run = popen(command, "r");
+    length = fread(output, 1, sizeof(output) - 1, run);
+    output[length] = '\0';
+    ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+    ASSERT_EQUAL_STRING("332833500\n", output, "Every square arrived once and the drained channel is not ready");
+
+    remove(c_path);
+    remove(exe_path);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test par for with writes to disjoint elements and reduction variables,
+// par_map and par_reduce over numbers and strings, and that bodies sharing
+// other writes are rejected
+void test_codegen_c_parallel_loops() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Parallel Loops ===\n");
+
+    const char* source =
+        "f square(x: i64) -> i64:\n"
+        "    return x * x\n"
+        "f add(a: i64, b: i64) -> i64:\n"
+        "    return a + b\n"
+        "f shout(s: str) -> str:\n"
+        "    return to_upper(s)\n"
+        "f later(a: str, b: str) -> str:\n"
+        "    if compare(a, b) > 0:\n"
+        "        return a\n"
+        "    return b\n"
+        "f main() -> null:\n"
+        "    array[i64] xs = array(100000)\n"
+        "    par for i = range(len(xs)):\n"
+        "        xs[i] = i % 1000\n"
+        "    i64 total = 0\n"
+        "    i64 count = 0\n"
+        "    i64 product = 1\n"
+        "    par for i = range(len(xs)):\n"
+        "        total = total + xs[i] * 2\n"
+        "        ++count\n"
+        "        if i < 10:\n"
+        "            product = product * 2\n"
+        "    array[i64] squares = par_map(xs, square)\n"
+        "    i64 sum = par_reduce(squares, add, 0)\n"
+        "    array[str] words = array(5000)\n"
+        "    par for i = range(5000):\n"
+        "        words[i] = \"fig\"\n"
+        "    words[4321] = \"zebra\"\n"
+        "    array[str] loud = par_map(words, shout)\n"
+        "    print(\"%d %d %d %d %s\\n\" % total, count, product, sum, par_reduce(loud, later, \"\"))\n"
+        "    return null\n";
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-parallel-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-parallel-%d", (int)getpid());
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit(program, "parallel.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+
+    FILE* code = fopen(c_path, "r");
+    char text[131072];
+    size_t length = fread(text, 1, sizeof(text) - 1, code);
+    text[length] = '\0';
+    fclose(code);
+    ASSERT_TRUE(count_substrings(text, "pf_parallel_for(") == 4, "Loops writing elements and par_map run chunks in parallel");
+    ASSERT_TRUE(count_substrings(text, "pf_parallel_reduce(") == 3, "Reductions combine partial results");
+
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+    const char* threads[] = {"1", "4"};
+    for (int t = 0; t < 2; t++) {
+        char command[192];
+        snprintf(command, sizeof(command), "PFLANG_GC_NURSERY=64k PFLANG_TASK_THREADS=%s %s 2>&1", threads[t], exe_path);
+        char output[512];
+        FILE* run = popen(command, "r");
+        length = fread(output, 1, sizeof(output) - 1, run);
+        output[length] = '\0';
+        ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+        ASSERT_EQUAL_STRING("99900000 100000 1024 33283350000 ZEBRA\n", output,
+                            "Elements, reductions and mapped values match a sequential run");
+    }
+    remove(c_path);
+    remove(exe_path);
+    free_ast(program);
+
+    // Slices share elements under another name, which only a test at run
+    // time can see: overlapping views run in order, separate ones in parallel
+    const char* views =
+        "f main() -> null:\n"
+        "    array[i64] xs = array(100000)\n"
+        "    array[i64] ys = slice(xs, 1, len(xs))\n"
+        "    par for i = range(len(ys)):\n"
+        "        xs[i] = ys[i] + 1\n"
+        "    array[i64] low = slice(xs, 0, 50000)\n"
+        "    array[i64] high = slice(xs, 50000, 100000)\n"
+        "    i64 total = 0\n"
+        "    par for i = range(len(low)):\n"
+        "        high[i] = low[i] * 2\n"
+        "        total = total + low[i]\n"
+        "    i64 ahead = 0\n"
+        "    par for i = range(len(ys)):\n"
+        "        ahead = ahead + ys[len(ys) - 1 - i]\n"
+        "        xs[i] = 7\n"
+        "    print(\"%d %d %d %d %d\\n\" % xs[0], xs[99998], high[0], total, ahead)\n"
+        "    return null\n";
+    program = parse_program_source(views, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program with slices parses");
+    if (program != NULL) {
+        out = fopen(c_path, "w");
+        ASSERT_TRUE(codegen_c_emit(program, "views.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+        fclose(out);
+        code = fopen(c_path, "r");
+        length = fread(text, 1, sizeof(text) - 1, code);
+        text[length] = '\0';
+        fclose(code);
+        ASSERT_EQUAL_INT(2, count_substrings(text, "pf_same_or_disjoint("),
+                         "Sequences read only at the loop variable may be the same view or separate");
+        ASSERT_EQUAL_INT(1, count_substrings(text, "pf_disjoint("), "one read by a reduction must be separate");
+        ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+        for (int t = 0; t < 2; t++) {
+            char command[192];
+            snprintf(command, sizeof(command), "PFLANG_TASK_THREADS=%s %s 2>&1", threads[t], exe_path);
+            char output[512];
+            FILE* run = popen(command, "r");
+            length = fread(output, 1, sizeof(output) - 1, run);
+            output[length] = '\0';
+            ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+            ASSERT_EQUAL_STRING("7 7 7 50000 449993\n", output, "Results match a sequential run");
+        }
+        remove(c_path);
+        remove(exe_path);
+        free_ast(program);
+    }
+
+    const char* shared[] = {
+        "    par for i = range(len(xs)):\n"
+        "        xs[i + 1] = 0\n",
+        "    par for i = range(len(xs)):\n"
+        "        last = i\n",
+        "    par for i = range(1, len(xs)):\n"
+        "        xs[i] = xs[i - 1]\n",
+        "    par for i = range(len(xs)):\n"
+        "        append(ys, i)\n",
+        "    par for i = range(len(xs)):\n"
+        "        clear(xs)\n",
+        "    par for i = range(len(xs)):\n"
+        "        total = total + i\n"
+        "        xs[i] = total\n",
+        "    par for i = range(len(xs)):\n"
+        "        return null\n",
+    };
+    const char* messages[] = {
+        "Writing an element other than the loop's own is rejected",
+        "Assigning a shared variable is rejected",
+        "Reading an element another iteration writes is rejected",
+        "Appending to a shared list is rejected",
+        "Passing a shared array to a function that writes it is rejected",
+        "Reading a reduction variable is rejected",
+        "Returning from a parallel loop is rejected",
+    };
+    for (int s = 0; s < 7; s++) {
+        char rejected[1024];
+        snprintf(rejected, sizeof(rejected),
+                 "f clear(xs: array[i64]) -> null:\n"
+                 "    xs[0] = 0\n"
+                 "    return null\n"
+                 "f main() -> null:\n"
+                 "    array[i64] xs = array(100)\n"
+                 "    list[i64] ys = list()\n"
+                 "    i64 last = 0\n"
+                 "    i64 total = 0\n"
+                 "%s"
+                 "    print(\"%%d %%d %%d\\n\" %% last, total, len(ys))\n"
+                 "    return null\n",
+                 shared[s]);
+        program = parse_program_source(rejected, &parser, &lexer);
+        ASSERT_TRUE(program != NULL, "Program parses");
+        if (program == NULL) continue;
+        char* c = NULL;
+        size_t size = 0;
+        out = open_memstream(&c, &size);
+        ASSERT_FALSE(codegen_c_emit(program, NULL, PF_OVERFLOW_WRAP, out), messages[s]);
+        fclose(out);
+        free(c);
+        free_ast(program);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test the I/O builtins: a file written and read back, and a loopback echo
+// server with a hundred clients, all on tasks, with and without io_uring
+void test_codegen_c_async_io() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing C Backend Asynchronous I/O ===\n");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/pflang-io-%d.txt", (int)getpid());
+    char source[2048];
+    snprintf(source, sizeof(source),
+             "f echo(c: i64) -> null:\n"
+             "    str s = read(c, 100)\n"
+             "    write(c, to_upper(s))\n"
+             "    close_fd(c)\n"
+             "    return null\n"
+             "f serve(listener: i64, n: i64) -> null:\n"
+             "    for k = range(n):\n"
+             "        go echo(accept(listener))\n"
+             "    return null\n"
+             "f ask(port: i64, out: chan[i64]) -> null:\n"
+             "    i64 fd = connect_tcp(\"127.0.0.1\", port)\n"
+             "    write(fd, \"hello\")\n"
+             "    if read(fd, 100) == \"HELLO\":\n"
+             "        send(out, 1)\n"
+             "    else:\n"
+             "        send(out, 0)\n"
+             "    close_fd(fd)\n"
+             "    return null\n"
+             "f main() -> null:\n"
+             "    i64 file = open_file(\"%s\", \"w\")\n"
+             "    write(file, \"line one\\n\")\n"
+             "    write(file, \"line two\\n\")\n"
+             "    close_fd(file)\n"
+             "    file = open_file(\"%s\", \"r\")\n"
+             "    print(\"%%s\" %% read(file, 1000))\n"
+             "    close_fd(file)\n"
+             "    i64 listener = listen_tcp(0)\n"
+             "    i64 port = local_port(listener)\n"
+             "    go serve(listener, 100)\n"
+             "    chan[i64] results = chan(100)\n"
+             "    for i = range(100):\n"
+             "        go ask(port, results)\n"
+             "    i64 answered = 0\n"
+             "    for i = range(100):\n"
+             "        answered = answered + recv(results)\n"
+             "    wait()\n"
+             "    close_fd(listener)\n"
+             "    print(\"%%d %%d\\n\" %% answered, open_file(\"/nonexistent/pflang\", \"r\"))\n"
+             "    return null\n",
+             path, path);
+    Lexer lexer;
+    Parser parser;
+    AstNode* program = parse_program_source(source, &parser, &lexer);
+    ASSERT_TRUE(program != NULL, "Program parses");
+    if (program == NULL) {
+        print_test_results(&stats);
+        return;
+    }
+
+    char c_path[64];
+    char exe_path[64];
+    snprintf(c_path, sizeof(c_path), "/tmp/pflang-async-io-%d.c", (int)getpid());
+    snprintf(exe_path, sizeof(exe_path), "/tmp/pflang-async-io-%d", (int)getpid());
+    FILE* out = fopen(c_path, "w");
+    ASSERT_TRUE(codegen_c_emit(program, "async_io.pf", PF_OVERFLOW_WRAP, out), "C is emitted without errors");
+    fclose(out);
+
+    FILE* code = fopen(c_path, "r");
+    char text[65536];
+    size_t length = fread(text, 1, sizeof(text) - 1, code);
+    text[length] = '\0';
+    fclose(code);
+    ASSERT_TRUE(strstr(text, "pf_io_read_string(c, 100)") != NULL, "read() is a call into the I/O runtime");
+    ASSERT_TRUE(strstr(text, "pf_io_accept(listener)") != NULL, "and so is accept()");
+
+    ASSERT_TRUE(codegen_c_compile(c_path, exe_path), "C compiles");
+    const char* settings[] = {"PFLANG_TASK_THREADS=2", "PFLANG_TASK_THREADS=2 PFLANG_IO_URING=0"};
+    for (int s = 0; s < 2; s++) {
+        char command[192];
+        snprintf(command, sizeof(command), "%s %s 2>&1", settings[s], exe_path);
+        char output[512];
+        FILE* run = popen(command, "r");
+        length = fread(output, 1, sizeof(output) - 1, run);
+        output[length] = '\0';
+        ASSERT_EQUAL_INT(0, pclose(run), "Executable exits cleanly");
+        ASSERT_EQUAL_STRING("line one\nline two\n100 -1\n", output,
+                            "The file reads back, every client is answered and a missing file gives -1");
+    }
+
+    remove(path);
+    remove(c_path);
+    remove(exe_path);
+    free_ast(program);
+    print_test_results(&stats);
+}
@@ -0,0 +1,157 @@
+#include "../include/test_framework.h"
+#include "../include/runtime/pf_array.h"
+#include "../include/runtime/pf_gc.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static pf_string numbered(const char* prefix, int i) {
+    char text[64];
+    int length = snprintf(text, sizeof(text), "%s number %d of the test", prefix, i);
+    return pf_string_from(text, (size_t)length);
+}
+
+// Only the list points at the strings, so a collection is free to move them
+__attribute__((noinline)) static pf_list_str* make_strings(int count) {
+    pf_list_str* list = pf_list_str_new(0, 0);
+    for (int i = 0; i < count; i++) {
+        pf_list_str_append(list, numbered("string", i));
+    }
+    return list;
+}
+
+static bool strings_intact(const pf_list_str* list, const char* prefix, int count) {
+    if (list->length != count) return false;
+    for (int i = 0; i < count; i++) {
+        pf_string expected = numbered(prefix, i);
+        if (!pf_string_equal(list->data[i], expected)) return false;
+    }
+    return true;
+}
+
+// Test that collections keep what the stack reaches, moving only what it
+// does not point at directly
+void test_gc_collections() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing GC Collections ===\n");
+
+    // Mark on several threads even on one core, so stealing is exercised
+    setenv("PFLANG_GC_THREADS", "4", 0);
+
+    pf_list_str* list = make_strings(2000);
+    pf_string local = numbered("local", 1);
+    const char* local_bytes = local.as.data;
+    ASSERT_TRUE(pf_gc_is_young(local_bytes), "New strings start in the nursery");
+
+    pf_gc_statistics before;
+    pf_gc_get_statistics(&before);
+
+    pf_gc_collect(false);
+    pf_gc_statistics after;
+    pf_gc_get_statistics(&after);
+    ASSERT_EQUAL_INT(1, (int)(after.minor_collections - before.minor_collections), "A minor collection ran");
+    ASSERT_TRUE(after.bytes_promoted > before.bytes_promoted, "Survivors are promoted");
+    ASSERT_TRUE(strings_intact(list, "string", 2000), "A list's strings survive being moved");
+    ASSERT_TRUE(local.as.data == local_bytes, "What the stack points at is pinned, not moved");
+    ASSERT_TRUE(pf_string_equal(local, numbered("local", 1)), "A pinned string keeps its bytes");
+
+    pf_gc_collect(true);
+    pf_gc_get_statistics(&after);
+    ASSERT_EQUAL_INT(1, (int)(after.major_collections - before.major_collections), "A major collection ran");
+    ASSERT_TRUE(strings_intact(list, "string", 2000), "A major collection keeps reachable strings");
+
+    // Garbage many times the nursery forces collections on its own
+    int64_t total = 0;
+    for (int round = 0; round < 200; round++) {
+        pf_array_i64 garbage = pf_array_i64_new(1000, 0);
+        garbage.data[999] = round;
+        total += garbage.data[999];
+    }
+    pf_gc_get_statistics(&after);
+    ASSERT_EQUAL_INT(19900, (int)total, "Fresh arrays are zeroed and usable");
+    ASSERT_TRUE(after.minor_collections >= before.minor_collections + 2, "A full nursery triggers a collection");
+    ASSERT_TRUE(after.bytes_allocated - before.bytes_allocated >= 200 * 8000, "Allocated bytes are counted");
+    ASSERT_TRUE(strings_intact(list, "string", 2000), "Strings survive collections triggered by allocation");
+
+    print_test_results(&stats);
+}
+
+// Test that young strings stored into an old array survive through the
+// remembered set
+void test_gc_remembered_set() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing GC Remembered Set ===\n");
+
+    // Too large for the nursery, so it starts out old
+    pf_array_str old = pf_array_str_new(1000, 0);
+    ASSERT_FALSE(pf_gc_is_young(old.data), "Large arrays start in the old generation");
+    for (int i = 0; i < 1000; i++) {
+        pf_gc_store_string(&old.data[i], numbered("remembered", i));
+    }
+    ASSERT_TRUE(pf_gc_is_young(old.data[999].as.data), "The stored strings are young");
+
+    pf_gc_collect(false);
+    bool intact = true;
+    int still_young = 0;
+    for (int i = 0; i < 1000; i++) {
+        if (!pf_string_equal(old.data[i], numbered("remembered", i))) intact = false;
+        still_young += pf_gc_is_young(old.data[i].as.data);
+    }
+    ASSERT_TRUE(intact, "Strings reached only from an old array survive");
+    // A stale copy of a pointer left on the stack may pin one or two
+    ASSERT_TRUE(still_young <= 2, "They are moved out of the nursery");
+
+    pf_gc_collect(true);
+    ASSERT_TRUE(pf_string_equal(old.data[500], numbered("remembered", 500)), "They survive a major collection");
+
+    print_test_results(&stats);
+}
+
+// Test that marking on several threads finds everything in a heap with
+// arrays long enough to be split between them, and that cells freed by
+// lazy sweeping are reused without touching live ones
+void test_gc_parallel_marking() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing GC Parallel Marking ===\n");
+
+    pf_list_str* lists[8];
+    for (int l = 0; l < 8; l++) {
+        lists[l] = make_strings(5000);
+    }
+    pf_gc_collect(true);
+    pf_gc_statistics first;
+    pf_gc_get_statistics(&first);
+    ASSERT_TRUE(first.mark_threads >= 1, "Marking threads are reported");
+
+    bool intact = true;
+    for (int l = 0; l < 8; l++) {
+        if (!strings_intact(lists[l], "string", 5000)) intact = false;
+    }
+    ASSERT_TRUE(intact, "Every string of every list is marked");
+
+    // Half the lists die; their cells are swept as promotions need them
+    for (int l = 0; l < 8; l += 2) {
+        lists[l] = NULL;
+    }
+    pf_gc_collect(true);
+    pf_gc_statistics second;
+    pf_gc_get_statistics(&second);
+    ASSERT_TRUE(second.heap_bytes < first.heap_bytes, "Dead lists leave the old generation");
+
+    for (int l = 0; l < 8; l += 2) {
+        lists[l] = make_strings(5000);
+    }
+    pf_gc_collect(false);
+    intact = true;
+    for (int l = 0; l < 8; l++) {
+        if (!strings_intact(lists[l], "string", 5000)) intact = false;
+    }
+    ASSERT_TRUE(intact, "Reused cells never held live strings");
+
+    print_test_results(&stats);
+}
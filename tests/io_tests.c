@@ -0,0 +1,246 @@
+#include "../include/test_framework.h"
+#include "../include/runtime/pf_io.h"
+#include "../include/runtime/pf_task.h"
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+typedef struct {
+    int fd;
+    int64_t bytes;
+    int pieces;                     // Writes to split the bytes into
+} WriteArguments;
+
+static _Atomic int64_t read_total;
+static _Atomic int finished_readers;
+
+// Byte i of every stream
+static char pattern(int64_t i) {
+    return (char)('a' + i % 23);
+}
+
+static void write_stream(void* argument) {
+    WriteArguments* arguments = argument;
+    char* data = malloc((size_t)arguments->bytes);
+    for (int64_t i = 0; i < arguments->bytes; i++) {
+        data[i] = pattern(i);
+    }
+    int64_t piece = arguments->bytes / arguments->pieces;
+    for (int p = 0; p < arguments->pieces; p++) {
+        int64_t first = p * piece;
+        int64_t length = p == arguments->pieces - 1 ? arguments->bytes - first : piece;
+        pf_io_write(arguments->fd, data + first, (size_t)length);
+        pf_task_yield();
+    }
+    pf_io_close(arguments->fd);
+    free(data);
+}
+
+// Read to the end, counting bytes that match the pattern
+static void read_stream(void* argument) {
+    int fd = *(int*)argument;
+    char buffer[1500];
+    int64_t offset = 0;
+    int64_t matching = 0;
+    for (int64_t length = pf_io_read(fd, buffer, sizeof(buffer)); length > 0;
+         length = pf_io_read(fd, buffer, sizeof(buffer))) {
+        for (int64_t i = 0; i < length; i++) {
+            if (buffer[i] == pattern(offset + i)) matching++;
+        }
+        offset += length;
+    }
+    pf_io_close(fd);
+    atomic_fetch_add(&read_total, matching);
+    atomic_fetch_add(&finished_readers, 1);
+}
+
+// Test thousands of tasks each reading a pipe that another task fills
+// slowly, so that readers park, and a stream bigger than a pipe holds, so
+// that the writer parks too, read by a thread outside tasks
+void test_io_pipes() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing I/O on Pipes ===\n");
+
+    setenv("PFLANG_TASK_THREADS", "4", 0);
+    pf_io_statistics before;
+    pf_io_get_statistics(&before);
+    atomic_store(&read_total, 0);
+    atomic_store(&finished_readers, 0);
+    int streams = 2000;
+    for (int s = 0; s < streams; s++) {
+        int ends[2];
+        if (pipe(ends) != 0) break;
+        pf_task_spawn(read_stream, &ends[0], sizeof(ends[0]));
+        WriteArguments arguments = {ends[1], 3000, 3};
+        pf_task_spawn(write_stream, &arguments, sizeof(arguments));
+    }
+    pf_task_wait();
+    ASSERT_EQUAL_INT(streams, atomic_load(&finished_readers), "Every reader sees the end of its pipe");
+    ASSERT_TRUE(atomic_load(&read_total) == (int64_t)streams * 3000, "after every byte, in order");
+    pf_io_statistics after;
+    pf_io_get_statistics(&after);
+    ASSERT_TRUE(after.waits > before.waits, "Readers of empty pipes park");
+
+    int ends[2];
+    ASSERT_TRUE(pipe(ends) == 0, "A pipe opens");
+    WriteArguments big = {ends[1], 4 << 20, 1};
+    pf_io_get_statistics(&before);
+    pf_task_spawn(write_stream, &big, sizeof(big));
+    atomic_store(&read_total, 0);
+    read_stream(&ends[0]);
+    pf_task_wait();
+    pf_io_get_statistics(&after);
+    ASSERT_TRUE(atomic_load(&read_total) == big.bytes, "A thread outside tasks reads a stream from a task");
+    ASSERT_TRUE(after.waits - before.waits >= 2, "while the writer waits for room and the reader for data");
+
+    print_test_results(&stats);
+}
+
+typedef struct {
+    char path[64];
+    int index;
+} FileArguments;
+
+static _Atomic int files_correct;
+
+// Write a file in pieces, then read it back in other pieces
+static void write_and_read_file(void* argument) {
+    FileArguments* arguments = argument;
+    int fd = pf_io_open(arguments->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+    char line[64];
+    int64_t written = 0;
+    for (int i = 0; i < 100; i++) {
+        int length = snprintf(line, sizeof(line), "file %d line %d\n", arguments->index, i);
+        if (pf_io_write(fd, line, (size_t)length) == length) written += length;
+    }
+    pf_io_close(fd);
+
+    fd = pf_io_open(arguments->path, O_RDONLY, 0);
+    char buffer[700];
+    int64_t total = 0;
+    bool starts_right = false;
+    for (int64_t length = pf_io_read(fd, buffer, sizeof(buffer)); length > 0;
+         length = pf_io_read(fd, buffer, sizeof(buffer))) {
+        if (total == 0) {
+            int expected = snprintf(line, sizeof(line), "file %d line 0\n", arguments->index);
+            starts_right = length >= expected && memcmp(buffer, line, (size_t)expected) == 0;
+        }
+        total += length;
+    }
+    pf_io_close(fd);
+    unlink(arguments->path);
+    if (starts_right && total == written) atomic_fetch_add(&files_correct, 1);
+}
+
+// Test reading and writing regular files from many tasks at once, through
+// io_uring where the kernel has it
+void test_io_files() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing I/O on Files ===\n");
+
+    pf_io_statistics before;
+    pf_io_get_statistics(&before);
+    atomic_store(&files_correct, 0);
+    for (int f = 0; f < 200; f++) {
+        FileArguments arguments;
+        snprintf(arguments.path, sizeof(arguments.path), "/tmp/pflang-io-%d-%d", (int)getpid(), f);
+        arguments.index = f;
+        pf_task_spawn(write_and_read_file, &arguments, sizeof(arguments));
+    }
+    pf_task_wait();
+    ASSERT_EQUAL_INT(200, atomic_load(&files_correct), "Each file reads back as written, from its start");
+
+    pf_io_statistics after;
+    pf_io_get_statistics(&after);
+    uint64_t operations = (after.submitted - before.submitted) + (after.in_place - before.in_place);
+    ASSERT_TRUE(operations >= 200 * 102, "Every file read and write goes to io_uring or runs in place");
+    if (after.uring) {
+        ASSERT_TRUE(after.submitted - before.submitted >= 200 * 102, "With io_uring, all of them are submitted");
+    }
+
+    ASSERT_TRUE(pf_io_open("/nonexistent/pflang", O_RDONLY, 0) == -1, "Opening a missing file fails");
+    char byte;
+    ASSERT_TRUE(pf_io_read(-1, &byte, 1) == -1, "Reading a bad descriptor fails");
+
+    print_test_results(&stats);
+}
+
+static _Atomic int echoes_correct;
+
+static void echo(void* argument) {
+    int fd = *(int*)argument;
+    char buffer[512];
+    for (int64_t length = pf_io_read(fd, buffer, sizeof(buffer)); length > 0;
+         length = pf_io_read(fd, buffer, sizeof(buffer))) {
+        pf_io_write(fd, buffer, (size_t)length);
+    }
+    pf_io_close(fd);
+}
+
+static void serve(void* argument) {
+    int* server = argument;
+    for (int c = 0; c < server[1]; c++) {
+        int connection = pf_io_accept(server[0]);
+        if (connection < 0) break;
+        pf_task_spawn(echo, &connection, sizeof(connection));
+    }
+}
+
+static void call(void* argument) {
+    int port = *(int*)argument;
+    int fd = pf_io_connect_tcp(pf_string_from_cstr("127.0.0.1"), port);
+    if (fd < 0) return;
+    char message[32];
+    int length = snprintf(message, sizeof(message), "hello from %d", fd);
+    char reply[32];
+    int64_t received = 0;
+    if (pf_io_write(fd, message, (size_t)length) == length) {
+        while (received < length) {
+            int64_t got = pf_io_read(fd, reply + received, sizeof(reply) - (size_t)received);
+            if (got <= 0) break;
+            received += got;
+        }
+    }
+    pf_io_close(fd);
+    if (received == length && memcmp(message, reply, (size_t)length) == 0) atomic_fetch_add(&echoes_correct, 1);
+}
+
+// Test a loopback echo server on tasks with a thousand clients on tasks
+void test_io_sockets() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing I/O on Sockets ===\n");
+
+    int listening = pf_io_listen_tcp(0);
+    ASSERT_TRUE(listening >= 0, "A socket listens on a free port");
+    if (listening < 0) {
+        print_test_results(&stats);
+        return;
+    }
+    int port = pf_io_local_port(listening);
+    ASSERT_TRUE(port > 0, "and knows which");
+
+    int clients = 1000;
+    atomic_store(&echoes_correct, 0);
+    int server[2] = {listening, clients};
+    pf_task_spawn(serve, server, sizeof(server));
+    for (int c = 0; c < clients; c++) {
+        pf_task_spawn(call, &port, sizeof(port));
+    }
+    pf_task_wait();
+    pf_io_close(listening);
+    ASSERT_EQUAL_INT(clients, atomic_load(&echoes_correct), "Every client gets its own message back");
+
+    ASSERT_TRUE(pf_io_connect_tcp(pf_string_from_cstr("127.0.0.1"), port) == -1,
+                "Connecting to a closed port fails");
+
+    print_test_results(&stats);
+}
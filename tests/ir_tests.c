@@ -0,0 +1,686 @@
+#include "../include/test_framework.h"
+#include "../include/ir.h"
+#include "../include/parser.h"
+
+// Lower a program, optionally optimize it, and return its textual dump
+static char* lower_and_dump_with_mode(const char* source, bool optimize, pf_overflow_mode mode) {
+    Lexer lexer;
+    init_lexer(&lexer, source);
+
+    Parser parser;
+    init_parser(&parser, &lexer);
+
+    AstNode* program = parse_program(&parser);
+    if (program == NULL) return NULL;
+
+    IrModule* module = ir_lower_program(program);
+    free_ast(program);
+    if (module == NULL) return NULL;
+
+    ir_set_overflow_mode(module, mode);
+    if (optimize) {
+        ir_optimize_module(module);
+    }
+
+    char* dump = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&dump, &size);
+    ir_dump_module(module, out);
+    fclose(out);
+
+    ir_free_module(module);
+    return dump;
+}
+
+static char* lower_and_dump(const char* source, bool optimize) {
+    return lower_and_dump_with_mode(source, optimize, PF_OVERFLOW_WRAP);
+}
+
+static int count_occurrences(const char* text, const char* pattern) {
+    int count = 0;
+    for (const char* p = strstr(text, pattern); p != NULL; p = strstr(p + 1, pattern)) {
+        count++;
+    }
+    return count;
+}
+
+// Test SSA construction of a loop
+void test_ir_ssa_construction() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR SSA Construction ===\n");
+
+    const char* source =
+        "f count(n: int) -> int:\n"
+        "    int i = 0\n"
+        "    while i < n:\n"
+        "        i = i + 1\n"
+        "    return i\n";
+    char* dump = lower_and_dump(source, false);
+    ASSERT_TRUE(dump != NULL, "Program lowers to IR");
+    if (dump != NULL) {
+        printf("%s", dump);
+        ASSERT_TRUE(strstr(dump, "function count(i32) -> i32") != NULL, "Function signature is dumped");
+        ASSERT_EQUAL_INT(2, count_occurrences(dump, " = phi "), "Loop header merges i and n with phis");
+        ASSERT_EQUAL_INT(1, count_occurrences(dump, "branch "), "Loop condition branches once");
+        free(dump);
+    }
+
+    dump = lower_and_dump(source, true);
+    ASSERT_TRUE(dump != NULL, "Program optimizes");
+    if (dump != NULL) {
+        printf("%s", dump);
+        ASSERT_EQUAL_INT(1, count_occurrences(dump, " = phi "), "Copy propagation removes the phi of n");
+        free(dump);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test common subexpression elimination
+void test_ir_value_numbering() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Value Numbering ===\n");
+
+    const char* source =
+        "f twice(a: int, b: int) -> int:\n"
+        "    int x = a * b\n"
+        "    if a > 0:\n"
+        "        int y = a * b\n"
+        "        return x + y\n"
+        "    return x\n";
+    char* dump = lower_and_dump(source, true);
+    ASSERT_TRUE(dump != NULL, "Program lowers and optimizes");
+    if (dump != NULL) {
+        printf("%s", dump);
+        ASSERT_EQUAL_INT(1, count_occurrences(dump, " = mul "), "Dominated a * b is reused");
+        free(dump);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test loop-invariant code motion
+void test_ir_loop_invariant_code_motion() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Loop-Invariant Code Motion ===\n");
+
+    const char* source =
+        "f scaled(n: int, k: int) -> int:\n"
+        "    int total = 0\n"
+        "    int i = 0\n"
+        "    while i < n:\n"
+        "        int step = k * 3\n"
+        "        total = total + step\n"
+        "        i = i + 1\n"
+        "    return total\n";
+    char* dump = lower_and_dump(source, true);
+    ASSERT_TRUE(dump != NULL, "Program lowers and optimizes");
+    if (dump != NULL) {
+        printf("%s", dump);
+        const char* header = strstr(dump, "bb1:");
+        const char* multiply = strstr(dump, " = mul ");
+        ASSERT_TRUE(header != NULL && multiply != NULL && multiply < header,
+                    "k * 3 is hoisted into the preheader");
+        free(dump);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test constant folding and dead code elimination
+void test_ir_folding_and_dead_code() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Constant Folding and Dead Code Elimination ===\n");
+
+    const char* source =
+        "f pick(a: u8) -> u8:\n"
+        "    u8 unused = a + 1\n"
+        "    u8 big = 250 + 10\n"
+        "    if 2 > 1:\n"
+        "        return big\n"
+        "    return a\n";
+    char* dump = lower_and_dump(source, true);
+    ASSERT_TRUE(dump != NULL, "Program lowers and optimizes");
+    if (dump != NULL) {
+        printf("%s", dump);
+        ASSERT_EQUAL_INT(0, count_occurrences(dump, " = add "), "Unused and constant additions are gone");
+        ASSERT_EQUAL_INT(0, count_occurrences(dump, "branch "), "Constant condition is folded away");
+        ASSERT_TRUE(strstr(dump, "const 4 : u8") != NULL, "Folding wraps to the declared width");
+        ASSERT_EQUAL_INT(1, count_occurrences(dump, "return "), "Untaken branch is removed");
+        free(dump);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test that folding follows the overflow mode
+void test_ir_overflow_modes() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Overflow Modes ===\n");
+
+    const char* source =
+        "f clamp() -> u8:\n"
+        "    u8 a = 250\n"
+        "    u8 big = a + 10\n"
+        "    return big\n";
+    char* dump = lower_and_dump_with_mode(source, true, PF_OVERFLOW_SATURATE);
+    ASSERT_TRUE(dump != NULL && strstr(dump, "const 255 : u8") != NULL, "Saturating fold clamps to u8 max");
+    free(dump);
+
+    dump = lower_and_dump_with_mode(source, true, PF_OVERFLOW_CHECKED);
+    ASSERT_TRUE(dump != NULL && count_occurrences(dump, " = add ") == 1, "Overflowing checked add is left for run time");
+    free(dump);
+
+    const char* negate =
+        "f lowest() -> i8:\n"
+        "    i8 low = 0 - 100\n"
+        "    return low * 2\n";
+    dump = lower_and_dump_with_mode(negate, true, PF_OVERFLOW_SATURATE);
+    ASSERT_TRUE(dump != NULL && strstr(dump, "const -128 : i8") != NULL, "Signed saturation clamps to i8 min");
+    free(dump);
+
+    const char* divide =
+        "f halve() -> i8:\n"
+        "    i8 low = 0 - 128\n"
+        "    i8 minus = 0 - 1\n"
+        "    i8 zero = 0\n"
+        "    return low / minus + low % minus + 7 / zero\n";
+    dump = lower_and_dump_with_mode(divide, true, PF_OVERFLOW_WRAP);
+    ASSERT_TRUE(dump != NULL && count_occurrences(dump, " = div ") == 1 && count_occurrences(dump, " = mod ") == 0,
+                "The i8 minimum over -1 folds, and only the division by zero is left for run time");
+    free(dump);
+    dump = lower_and_dump_with_mode(divide, true, PF_OVERFLOW_CHECKED);
+    ASSERT_TRUE(dump != NULL && count_occurrences(dump, " = div ") == 2 && count_occurrences(dump, " = mod ") == 0,
+                "Checked mode leaves the overflowing division too, but folds its remainder");
+    free(dump);
+
+    const char* constants =
+        "f wide() -> i64:\n"
+        "    i64 sum = 5000000000 + 1\n"
+        "    return sum + 3000000000 * 2\n"
+        "f mixed() -> bool:\n"
+        "    u64 one = 1\n"
+        "    i32 minus = 0 - 1\n"
+        "    return one > minus\n";
+    dump = lower_and_dump_with_mode(constants, true, PF_OVERFLOW_CHECKED);
+    ASSERT_TRUE(dump != NULL && strstr(dump, "const 11000000001 : i64") != NULL,
+                "Constants fold at i64 when their literals need it");
+    ASSERT_TRUE(dump != NULL && count_occurrences(dump, " = gt ") == 0 && strstr(dump, "const 1 : bool") != NULL,
+                "u64 against i32 folds by value");
+    free(dump);
+
+    print_test_results(&stats);
+}
+
+// Test element loads, stores and lengths
+void test_ir_arrays() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Arrays ===\n");
+
+    const char* source =
+        "f fill(xs: array[i32], value: i32) -> i32:\n"
+        "    i64 i = 0\n"
+        "    while i < len(xs):\n"
+        "        xs[i] = value\n"
+        "        i = i + 1\n"
+        "    return xs[0]\n";
+    char* dump = lower_and_dump(source, true);
+    ASSERT_TRUE(dump != NULL && strstr(dump, "store v0, ") != NULL, "Indexed assignment becomes a store");
+    ASSERT_TRUE(dump != NULL && strstr(dump, "= load v0, ") != NULL, "Indexing becomes a load");
+
+    // The array's length cannot change, so it is computed once before the loop
+    char* length = dump != NULL ? strstr(dump, "= length v0 : i64") : NULL;
+    char* loop = dump != NULL ? strstr(dump, "bb1:") : NULL;
+    ASSERT_TRUE(length != NULL && loop != NULL && length < loop, "Array length is hoisted out of the loop");
+    free(dump);
+
+    print_test_results(&stats);
+}
+
+void test_ir_for_range() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR For Range ===\n");
+
+    const char* source =
+        "f total(xs: array[i32], n: i64) -> i64:\n"
+        "    i64 sum = 0\n"
+        "    for i32 i = range(n, 0, -2):\n"
+        "        sum = sum + xs[i]\n"
+        "    return sum\n";
+    char* dump = lower_and_dump(source, true);
+    ASSERT_TRUE(dump != NULL && strstr(dump, "call range") == NULL, "range() is not a call");
+    ASSERT_TRUE(dump != NULL && strstr(dump, "= gt ") != NULL, "A negative step counts down");
+    ASSERT_EQUAL_INT(1, dump != NULL ? count_occurrences(dump, "branch") : -1, "The loop has a single test");
+    ASSERT_TRUE(dump != NULL && strstr(dump, "= convert ") != NULL && strstr(dump, " : i32") != NULL,
+                "The counter is converted to the declared width");
+    free(dump);
+
+    const char* dynamic =
+        "f count(n: i64, step: i64) -> i64:\n"
+        "    i64 c = 0\n"
+        "    for i = range(0, n, step):\n"
+        "        c = c + 1\n"
+        "    return c\n";
+    dump = lower_and_dump(dynamic, true);
+    ASSERT_TRUE(dump != NULL && strstr(dump, "= lt ") != NULL && strstr(dump, "= gt ") != NULL,
+                "A step of unknown sign tests both directions");
+    free(dump);
+
+    print_test_results(&stats);
+}
+
+// Test bounds-check elimination: proofs from loop tests and lengths, and
+// accesses of for loops left to a single check before the loop
+void test_ir_bounds_checks() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Bounds Checks ===\n");
+
+    const char* source =
+        "f sums(xs: array[i32], n: i64) -> i64:\n"
+        "    i64 sum = 0\n"
+        "    for i = range(len(xs)):\n"
+        "        sum = sum + xs[i]\n"
+        "    i64 j = 0\n"
+        "    while j < len(xs):\n"
+        "        xs[j] = xs[j] + xs[len(xs) - 1]\n"
+        "        j = j + 1\n"
+        "    for k = range(len(xs) - 1, -1, -1):\n"
+        "        sum = sum + xs[k]\n"
+        "    for m = range(n):\n"
+        "        sum = sum + xs[m]\n"
+        "    i64 p = 0\n"
+        "    while p < len(xs):\n"
+        "        sum = sum + xs[p + 1]\n"
+        "        p = p + 1\n"
+        "    return sum\n";
+    char* dump = lower_and_dump(source, true);
+    ASSERT_EQUAL_INT(4, dump != NULL ? count_occurrences(dump, "; in bounds") : -1,
+                     "Loops tested against the length are proven, xs[len(xs) - 1] and xs[p + 1] are not");
+    ASSERT_EQUAL_INT(1, dump != NULL ? count_occurrences(dump, "; checked before the loop") : -1,
+                     "A for loop over an unrelated range checks it once");
+    ASSERT_EQUAL_INT(7, dump != NULL ? count_occurrences(dump, " load ") + count_occurrences(dump, "store ") : -1,
+                     "Every access is still there");
+    free(dump);
+
+    const char* unproven =
+        "f last(xs: list[i64], i: i64) -> i64:\n"
+        "    if i < len(xs):\n"
+        "        return xs[i]\n"
+        "    return xs[0]\n";
+    dump = lower_and_dump(unproven, true);
+    ASSERT_TRUE(dump != NULL && strstr(dump, "; in bounds") == NULL && strstr(dump, "; checked") == NULL,
+                "An index that may be negative or a list that may be empty stays checked");
+    free(dump);
+
+    const char* repeated =
+        "f swap(xs: list[i64], i: i64) -> null:\n"
+        "    i64 t = xs[i]\n"
+        "    xs[i] = t + xs[i]\n"
+        "    return null\n";
+    dump = lower_and_dump(repeated, true);
+    ASSERT_EQUAL_INT(2, dump != NULL ? count_occurrences(dump, "; in bounds") : -1,
+                     "Accesses after a check of the same index are proven");
+    free(dump);
+
+    Lexer lexer;
+    init_lexer(&lexer, source);
+    Parser parser;
+    init_parser(&parser, &lexer);
+    AstNode* program = parse_program(&parser);
+    IrModule* module = program != NULL ? ir_lower_program(program) : NULL;
+    ASSERT_TRUE(module != NULL, "Program lowers");
+    if (module != NULL) {
+        ir_optimize_module(module);
+        char* report = NULL;
+        size_t size = 0;
+        FILE* out = open_memstream(&report, &size);
+        ir_dump_bounds_report(module->functions[0], out);
+        fclose(out);
+        ASSERT_EQUAL_STRING("function sums: 5 of 7 bounds checks removed (4 proven, 1 hoisted out of loops)\n",
+                            report, "The report counts each kind");
+        free(report);
+        ir_free_module(module);
+    }
+    if (program != NULL) free_ast(program);
+
+    print_test_results(&stats);
+}
+
+// Test which for loops the vectorization analysis accepts, and the reasons
+// it gives for the rest
+void test_ir_vector_loops() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Vector Loops ===\n");
+
+    const char* source =
+        "f kernels(a: array[f32], b: list[f32], xs: array[i32], n: i64) -> i64:\n"
+        "    for i = range(len(a)):\n"
+        "        a[i] = a[i] + b[i] * 2.0\n"
+        "    i64 sum = 0\n"
+        "    for i = range(len(xs)):\n"
+        "        sum = sum + xs[i]\n"
+        "    f32 total = 0.0\n"
+        "    for i = range(len(a)):\n"
+        "        total = total + a[i]\n"
+        "    for i = range(0, len(xs), 2):\n"
+        "        xs[i] = 0\n"
+        "    for i = range(len(xs)):\n"
+        "        if xs[i] > 0:\n"
+        "            xs[i] = 0\n"
+        "    for i = range(len(xs)):\n"
+        "        print(xs[i])\n"
+        "    for i = range(len(xs)):\n"
+        "        xs[i] = xs[i] / 3\n"
+        "    for i = range(len(xs)):\n"
+        "        xs[i] = xs[0]\n"
+        "    for i = range(1, len(xs)):\n"
+        "        sum = sum * xs[i]\n"
+        "    a[0] = total\n"
+        "    return sum\n";
+    Lexer lexer;
+    init_lexer(&lexer, source);
+    Parser parser;
+    init_parser(&parser, &lexer);
+    AstNode* program = parse_program(&parser);
+    IrModule* module = program != NULL ? ir_lower_program(program) : NULL;
+    ASSERT_TRUE(module != NULL, "Program lowers");
+    if (module == NULL) {
+        if (program != NULL) free_ast(program);
+        print_test_results(&stats);
+        return;
+    }
+    ir_optimize_module(module);
+
+    char* report = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&report, &size);
+    ir_dump_vector_report(module->functions[0], out);
+    fclose(out);
+
+    ASSERT_TRUE(strstr(report, "line 2: loop vectorized\n") != NULL, "Elementwise float arithmetic is vectorized");
+    ASSERT_TRUE(strstr(report, "line 5: loop vectorized\n") != NULL, "An integer sum is vectorized");
+    ASSERT_TRUE(strstr(report, "line 8: loop not vectorized: the floating-point sum at line 9") != NULL,
+                "A float sum would be reordered");
+    ASSERT_TRUE(strstr(report, "line 10: loop not vectorized: it does not count up by 1") != NULL,
+                "A stride of 2 is not vectorized");
+    ASSERT_TRUE(strstr(report, "line 12: loop not vectorized: its body branches") != NULL,
+                "Control flow in the body is rejected");
+    ASSERT_TRUE(strstr(report, "line 15: loop not vectorized: it calls print at line 16") != NULL,
+                "Calls are rejected");
+    ASSERT_TRUE(strstr(report, "line 17: loop not vectorized: the integer division at line 18") != NULL,
+                "Integer division is rejected");
+    ASSERT_TRUE(strstr(report, "line 19: loop not vectorized: the bounds check at line 20") != NULL,
+                "An access that keeps its check is rejected");
+    ASSERT_TRUE(strstr(report, "line 21: loop not vectorized: a value computed at line 22") != NULL,
+                "A product carried between iterations is rejected");
+    free(report);
+
+    ir_set_overflow_mode(module, PF_OVERFLOW_CHECKED);
+    report = NULL;
+    out = open_memstream(&report, &size);
+    ir_dump_vector_report(module->functions[0], out);
+    fclose(out);
+    ASSERT_TRUE(strstr(report, "line 5: loop not vectorized: the arithmetic at line 6 checks for overflow") != NULL,
+                "Checked overflow keeps integer arithmetic in order");
+    free(report);
+
+    ir_free_module(module);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+static char* inline_report(IrModule* module) {
+    char* report = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&report, &size);
+    for (int f = 0; f < module->function_count; f++) {
+        ir_dump_inline_report(module, module->functions[f], out);
+    }
+    fclose(out);
+    return report;
+}
+
+// Test which calls the inliner takes, with and without a call profile,
+// and what is left of an inlined call
+void test_ir_inline() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Inlining ===\n");
+
+    const char* source =
+        "f div(a: int, b: int) -> (int, error):\n"
+        "    if b == 0:\n"
+        "        return (0, error(\"Division by zero\"))\n"
+        "    return (a / b, null)\n"
+        "f fact(n: i64) -> i64:\n"
+        "    if n < 2:\n"
+        "        return 1\n"
+        "    return n * fact(n - 1)\n"
+        "f mix(x: i64) -> i64:\n"
+        "    i64 y = x * 3 + 1\n"
+        "    y = y * y - x\n"
+        "    y = y / 7 + x * 5\n"
+        "    y = y - x / 3 + y * 2\n"
+        "    return y % 1000\n"
+        "f main() -> i64:\n"
+        "    i64 total = 0\n"
+        "    for i = range(100):\n"
+        "        int q, error err = div(i, 3)\n"
+        "        total = total + q + mix(i)\n"
+        "    return total + mix(total) + fact(5)\n";
+    Lexer lexer;
+    init_lexer(&lexer, source);
+    Parser parser;
+    init_parser(&parser, &lexer);
+    AstNode* program = parse_program(&parser);
+    IrModule* module = program != NULL ? ir_lower_program(program) : NULL;
+    ASSERT_TRUE(module != NULL, "Program lowers");
+    if (module == NULL) {
+        if (program != NULL) free_ast(program);
+        print_test_results(&stats);
+        return;
+    }
+    ir_optimize_module(module);
+
+    char* report = inline_report(module);
+    ASSERT_TRUE(strstr(report, "function main, line 18: inlined div (") != NULL,
+                "A small helper in a loop is inlined");
+    ASSERT_TRUE(strstr(report, "function main, line 19: inlined mix (") != NULL,
+                "A larger function is inlined inside a loop");
+    ASSERT_TRUE(strstr(report, "function main, line 20: mix not inlined: mix has") != NULL,
+                "The same function outside a loop is over the budget");
+    ASSERT_TRUE(strstr(report, "function main, line 20: fact not inlined: fact is recursive\n") != NULL,
+                "Recursive functions are not inlined");
+    ASSERT_TRUE(strstr(report, "function fact, line 8: fact not inlined: fact is recursive\n") != NULL,
+                "Nor are their calls of themselves");
+    free(report);
+
+    char* dump = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&dump, &size);
+    ir_dump_function(module->functions[3], out);
+    fclose(out);
+    ASSERT_TRUE(strstr(dump, "call div") == NULL && strstr(dump, "extract") == NULL,
+                "The inlined call and its results are gone");
+    ASSERT_TRUE(strstr(dump, "eq") == NULL, "The check of a constant divisor folds away");
+    ASSERT_EQUAL_INT(1, count_occurrences(dump, "call mix"), "One call of mix is left");
+    free(dump);
+    ASSERT_TRUE(ir_inlined_everywhere(module, "div"), "div is inlined at its only call");
+    ASSERT_FALSE(ir_inlined_everywhere(module, "mix"), "mix is not inlined everywhere");
+    ir_free_module(module);
+
+    // A cold call stays a call, a hot one gets a larger budget
+    IrCallCount profile[] = {
+        {"main", 18, "div", 0},
+        {"main", 20, "mix", 5000},
+    };
+    module = ir_lower_program(program);
+    ir_set_call_profile(module, profile, 2);
+    ir_optimize_module(module);
+    report = inline_report(module);
+    ASSERT_TRUE(strstr(report, "function main, line 18: div not inlined: the profile never reached this call\n") !=
+                NULL, "A call the profile never saw is left alone");
+    ASSERT_TRUE(strstr(report, "function main, line 20: inlined mix (") != NULL && strstr(report, "budget 96)") != NULL,
+                "A hot call is inlined with the larger budget");
+    free(report);
+    ir_free_module(module);
+
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test that a function returning a call of itself becomes a loop, which
+// also makes it small and non-recursive enough to inline
+void test_ir_tail_calls() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Tail Calls ===\n");
+
+    const char* source =
+        "f count(n: i64, acc: i64) -> i64:\n"
+        "    if n == 0:\n"
+        "        return acc\n"
+        "    return count(n - 1, acc + n)\n"
+        "f fact(n: i64) -> i64:\n"
+        "    if n < 2:\n"
+        "        return 1\n"
+        "    return n * fact(n - 1)\n"
+        "f main() -> i64:\n"
+        "    return count(10, 0) + fact(5)\n";
+
+    char* dump = lower_and_dump(source, false);
+    ASSERT_EQUAL_INT(2, dump != NULL ? count_occurrences(dump, "call count") : -1,
+                     "Unoptimized, count calls itself and main calls it");
+    free(dump);
+
+    Lexer lexer;
+    init_lexer(&lexer, source);
+    Parser parser;
+    init_parser(&parser, &lexer);
+    AstNode* program = parse_program(&parser);
+    IrModule* module = program != NULL ? ir_lower_program(program) : NULL;
+    ASSERT_TRUE(module != NULL, "Program lowers");
+    if (module == NULL) {
+        if (program != NULL) free_ast(program);
+        print_test_results(&stats);
+        return;
+    }
+    ir_optimize_module(module);
+
+    dump = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&dump, &size);
+    ir_dump_module(module, out);
+    fclose(out);
+    ASSERT_EQUAL_INT(0, count_occurrences(dump, "call count"), "The tail call became a jump");
+    ASSERT_TRUE(strstr(dump, "v14 = phi [v0, bb0], [v9, bb2] : i64") != NULL,
+                "The first parameter is carried around the loop by a phi");
+    ASSERT_EQUAL_INT(2, count_occurrences(dump, "call fact"), "A call that is not in tail position stays");
+    free(dump);
+
+    char* report = inline_report(module);
+    ASSERT_TRUE(strstr(report, "function main, line 10: inlined count (") != NULL,
+                "Without its tail call, count can be inlined");
+    free(report);
+
+    ir_free_module(module);
+    free_ast(program);
+    print_test_results(&stats);
+}
+
+// Test where escape analysis places arrays and lists: returned or handed
+// to a function that keeps them, in the frame, or in the call's region
+void test_ir_escape() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing IR Escape Analysis ===\n");
+
+    const char* source =
+        "f keep(xs: array[i64], n: i64) -> array[i64]:\n"
+        "    if n > 0:\n"
+        "        return slice(keep(xs, n - 1), 0, len(xs))\n"
+        "    return xs\n"
+        "f make(n: i64) -> array[i64]:\n"
+        "    array[i64] xs = array(n)\n"
+        "    return xs\n"
+        "f main() -> i64:\n"
+        "    array[i64] a = array(8)\n"
+        "    array[i64] b = array(8)\n"
+        "    array[i64] c = keep(b, 2)\n"
+        "    list[i64] l = list()\n"
+        "    append(l, 5)\n"
+        "    i64 t = 0\n"
+        "    for i = range(3):\n"
+        "        array[i64] d = array(4)\n"
+        "        t = t + sum(d)\n"
+        "    array[str] e = array(2)\n"
+        "    array[u8] big = array(100000)\n"
+        "    return sum(a) + sum(c) + len(l) + t + len(e) + len(big) + len(make(3))\n";
+
+    Lexer lexer;
+    init_lexer(&lexer, source);
+    Parser parser;
+    init_parser(&parser, &lexer);
+    AstNode* program = parse_program(&parser);
+    IrModule* module = program != NULL ? ir_lower_program(program) : NULL;
+    ASSERT_TRUE(module != NULL, "Program lowers");
+    if (module == NULL) {
+        if (program != NULL) free_ast(program);
+        print_test_results(&stats);
+        return;
+    }
+    ir_optimize_module(module);
+
+    char* report = NULL;
+    size_t size = 0;
+    FILE* out = open_memstream(&report, &size);
+    for (int f = 0; f < module->function_count; f++) {
+        ir_dump_escape_report(module, module->functions[f], out);
+    }
+    fclose(out);
+    ASSERT_EQUAL_STRING("function make, line 6: array[i64] on the heap: it is returned at line 7\n"
+                        "function main, line 9: array[i64] of 8 elements in the frame\n"
+                        "function main, line 10: array[i64] on the heap: it is passed to keep at line 11, "
+                        "which lets it escape\n"
+                        "function main, line 12: list[i64] in the call's region\n"
+                        "function main, line 16: array[i64] on the heap: it is made on every iteration of a "
+                        "loop\n"
+                        "function main, line 18: array[str] on the heap: its strings must be visible to "
+                        "the collector\n"
+                        "function main, line 19: array[u8] in the call's region\n",
+                        report, "Each allocation is placed by how far it gets");
+    free(report);
+
+    int count;
+    IrAllocation* allocations = ir_collect_allocations(module, &count);
+    ASSERT_EQUAL_INT(7, count, "Every array() and list() is collected");
+    ASSERT_TRUE(count > 1 && allocations[1].source != NULL && allocations[1].function != NULL &&
+                allocations[1].length == 8,
+                "Facts point back at the call and its function");
+    free(allocations);
+
+    ir_free_module(module);
+    free_ast(program);
+    print_test_results(&stats);
+}
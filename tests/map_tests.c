@@ -0,0 +1,197 @@
+#include "../include/test_framework.h"
+#include "../include/runtime/pf_map.h"
+#include "../include/runtime/pf_gc.h"
+#include <stdio.h>
+
+// Test integer keys through growth, removal and iteration
+void test_map_int_keys() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Map Integer Keys ===\n");
+
+    pf_map_int map;
+    pf_map_int_init(&map, sizeof(int64_t));
+
+    bool all_new = true;
+    for (int64_t key = 0; key < 10000; key++) {
+        bool inserted = false;
+        int64_t* value = pf_map_int_insert(&map, key * 7919, &inserted);
+        if (!inserted) all_new = false;
+        *value = key;
+    }
+    ASSERT_TRUE(all_new, "Every distinct key is inserted");
+    ASSERT_EQUAL_INT(10000, (int)map.count, "Count follows inserts");
+
+    bool inserted = true;
+    *(int64_t*)pf_map_int_insert(&map, 7919, &inserted) += 100;
+    ASSERT_FALSE(inserted, "Existing key is not inserted again");
+
+    bool all_found = true;
+    for (int64_t key = 0; key < 10000; key++) {
+        int64_t* value = pf_map_int_find(&map, key * 7919);
+        int64_t expected = key == 1 ? 101 : key;
+        if (value == NULL || *value != expected) all_found = false;
+    }
+    ASSERT_TRUE(all_found, "Every key finds its value");
+    ASSERT_TRUE(pf_map_int_find(&map, 5) == NULL, "Missing key is not found");
+
+    for (int64_t key = 0; key < 10000; key += 2) {
+        pf_map_int_remove(&map, key * 7919);
+    }
+    ASSERT_FALSE(pf_map_int_remove(&map, 0), "Removed key cannot be removed again");
+
+    bool survivors_found = true;
+    for (int64_t key = 0; key < 10000; key++) {
+        bool found = pf_map_int_find(&map, key * 7919) != NULL;
+        if (found != (key % 2 == 1)) survivors_found = false;
+    }
+    ASSERT_TRUE(survivors_found, "Removal keeps the other keys reachable");
+
+    size_t cursor = 0;
+    size_t slot;
+    int visited = 0;
+    int64_t sum = 0;
+    while (pf_map_int_next(&map, &cursor, &slot)) {
+        visited++;
+        sum += *(int64_t*)pf_map_int_value_at(&map, slot);
+    }
+    ASSERT_EQUAL_INT(5000, visited, "Iteration visits each entry once");
+    ASSERT_EQUAL_INT(25000000 + 100, (int)sum, "Iteration sees every value");
+
+    pf_map_int_free(&map);
+    print_test_results(&stats);
+}
+
+// Test that insert/remove churn does not degrade the table
+void test_map_churn_without_tombstones() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Map Churn ===\n");
+
+    pf_map_int map;
+    pf_map_int_init(&map, 0);
+    for (int64_t key = 0; key < 100; key++) {
+        pf_map_int_insert(&map, key, NULL);
+    }
+    size_t capacity = map.capacity;
+
+    bool consistent = true;
+    for (int64_t round = 1; round <= 1000; round++) {
+        // Replace the oldest hundred keys with new ones
+        for (int64_t i = 0; i < 100; i++) {
+            pf_map_int_remove(&map, (round - 1) * 100 + i);
+            pf_map_int_insert(&map, round * 100 + i, NULL);
+        }
+        if (map.count != 100 || pf_map_int_find(&map, round * 100 + 50) == NULL ||
+            pf_map_int_find(&map, round * 100 - 50) != NULL) {
+            consistent = false;
+        }
+    }
+    ASSERT_TRUE(consistent, "Map holds exactly the live keys throughout");
+    ASSERT_EQUAL_INT((int)capacity, (int)map.capacity, "Churn never grows or rehashes the table");
+
+    size_t empty = 0;
+    for (size_t slot = 0; slot < map.capacity; slot++) {
+        if (map.control[slot] == PF_MAP_EMPTY) empty++;
+    }
+    ASSERT_EQUAL_INT((int)(map.capacity - 100), (int)empty, "Every free slot is empty, none is a tombstone");
+
+    pf_map_int_free(&map);
+    print_test_results(&stats);
+}
+
+// Test str keys, found by content with or without a cached hash
+void test_map_str_keys() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Map String Keys ===\n");
+
+    pf_map_str map;
+    pf_map_str_init(&map, sizeof(pf_string));
+
+    char key[64];
+    for (int i = 0; i < 1000; i++) {
+        // Short keys are inline, long ones on the heap
+        snprintf(key, sizeof(key), i % 2 == 0 ? "k%d" : "/api/v1/resources/%d/details", i);
+        pf_string* value = pf_map_str_insert(&map, pf_string_from_cstr(key), NULL);
+        *value = pf_string_from_cstr(key);
+    }
+    ASSERT_EQUAL_INT(1000, (int)map.count, "Every key is inserted");
+
+    bool all_found = true;
+    for (int i = 0; i < 1000; i++) {
+        snprintf(key, sizeof(key), i % 2 == 0 ? "k%d" : "/api/v1/resources/%d/details", i);
+        pf_string lookup = pf_string_from_cstr(key);
+        pf_string* value = pf_map_str_find(&map, lookup);
+        if (value == NULL || !pf_string_equal(*value, lookup)) all_found = false;
+    }
+    ASSERT_TRUE(all_found, "Keys are found by content");
+
+    bool hashes_cached = true;
+    size_t cursor = 0;
+    size_t slot;
+    while (pf_map_str_next(&map, &cursor, &slot)) {
+        if (pf_map_str_key_at(&map, slot).hash == 0) hashes_cached = false;
+    }
+    ASSERT_TRUE(hashes_cached, "Stored keys keep their hash for growth and removal");
+
+    pf_string interned = PF_STRING_LITERAL("/api/v1/resources/7/details");
+    ASSERT_TRUE(pf_map_str_remove(&map, interned), "Interned literal removes an equal key");
+    ASSERT_TRUE(pf_map_str_find(&map, interned) == NULL, "Removed key is gone");
+    ASSERT_EQUAL_INT(999, (int)map.count, "Count follows removal");
+
+    pf_map_str_free(&map);
+    print_test_results(&stats);
+}
+
+// Test that long str keys are promoted by minor collections instead of
+// pinning the nursery until it holds nothing else
+void test_map_str_keys_collected() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Map String Keys Under Collection ===\n");
+
+    pf_gc_statistics before;
+    pf_gc_get_statistics(&before);
+
+    pf_map_str map;
+    pf_map_str_init(&map, sizeof(int64_t));
+    char key[64];
+    for (int i = 0; i < 100000; i++) {
+        snprintf(key, sizeof(key), "/api/v1/resources/%d/details", i);
+        int64_t* value = pf_map_str_insert(&map, pf_string_from_cstr(key), NULL);
+        *value = i;
+    }
+    pf_gc_collect(false);
+
+    pf_gc_statistics after;
+    pf_gc_get_statistics(&after);
+    // About 5 MB of keys; with each one pinned this took ~100000 collections
+    ASSERT_TRUE(after.minor_collections - before.minor_collections < 100,
+                "100000 long keys take a bounded number of minor collections");
+
+    // Copies of the last keys left on the stack may still pin them
+    int young = 0;
+    size_t cursor = 0;
+    size_t slot;
+    while (pf_map_str_next(&map, &cursor, &slot)) {
+        pf_string stored = pf_map_str_key_at(&map, slot);
+        if (pf_gc_is_young(stored.as.data)) young++;
+    }
+    ASSERT_TRUE(young <= 8, "Keys are promoted out of the nursery");
+
+    bool all_found = true;
+    for (int i = 0; i < 100000; i += 997) {
+        snprintf(key, sizeof(key), "/api/v1/resources/%d/details", i);
+        int64_t* value = pf_map_str_find(&map, pf_string_from_cstr(key));
+        if (value == NULL || *value != i) all_found = false;
+    }
+    ASSERT_TRUE(all_found, "Moved keys are still found by content");
+
+    pf_map_str_free(&map);
+    print_test_results(&stats);
+}
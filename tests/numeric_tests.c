@@ -0,0 +1,110 @@
+#include "../include/test_framework.h"
+#include "../include/runtime/pf_numeric.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* kernel_sets[] = {"scalar", "sse2", "avx2"};
+
+// Test integer builtins under every kernel set the CPU supports, at lengths
+// that leave a tail after the last full vector
+void test_numeric_integer_kernels() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Numeric Integer Kernels ===\n");
+
+    pf_array_i8 bytes = pf_array_i8_new(203, 0);
+    pf_array_u16 words = pf_array_u16_new(203, 0);
+    pf_array_i64 wide = pf_array_i64_new(203, 0);
+    for (int i = 0; i < 203; i++) {
+        bytes.data[i] = (int8_t)(i * 37 - 100);
+        words.data[i] = (uint16_t)(i * 1021);
+        wide.data[i] = (int64_t)i * 3 - 300;
+    }
+    bytes.data[150] = -128;
+    bytes.data[151] = 127;
+    int64_t byte_sum = 0, byte_dot = 0;
+    uint64_t word_sum = 0;
+    for (int i = 0; i < 203; i++) {
+        byte_sum += bytes.data[i];
+        byte_dot += (int64_t)bytes.data[i] * bytes.data[i];
+        word_sum += words.data[i];
+    }
+
+    for (int k = 0; k < 3; k++) {
+        if (!pf_numeric_use_kernels(kernel_sets[k])) {
+            printf("Skipping %s kernels: not supported by this CPU\n", kernel_sets[k]);
+            continue;
+        }
+        printf("Using %s kernels\n", pf_numeric_kernels());
+
+        bool sums_match = true;
+        for (int64_t length = 0; length <= 203; length++) {
+            int64_t expected = 0;
+            for (int64_t i = 0; i < length; i++) expected += bytes.data[i];
+            if (pf_sum_i8(pf_array_i8_slice(bytes, 0, length, 0)) != expected) sums_match = false;
+        }
+        ASSERT_TRUE(sums_match, "i8 sum is right at every length");
+        ASSERT_TRUE(pf_sum_i8(bytes) == byte_sum, "Negative bytes are sign-extended");
+        ASSERT_TRUE(pf_dot_i8(bytes, bytes, 0) == byte_dot, "i8 dot widens before multiplying");
+        ASSERT_TRUE(pf_sum_u16(words) == word_sum, "u16 sum is zero-extended");
+        ASSERT_EQUAL_INT(-128, pf_min_i8(bytes, 0), "i8 min");
+        ASSERT_EQUAL_INT(127, pf_max_i8(bytes, 0), "i8 max");
+        ASSERT_EQUAL_INT(-300, (int)pf_min_i64(wide, 0), "i64 min");
+        ASSERT_EQUAL_INT(306, (int)pf_max_i64(wide, 0), "i64 max");
+
+        pf_array_u64 huge = pf_array_u64_new(5, 0);
+        for (int i = 0; i < 5; i++) huge.data[i] = UINT64_MAX;
+        ASSERT_TRUE(pf_sum_u64(huge) == (uint64_t)-5, "u64 sum wraps around");
+
+        pf_array_i64 copy = pf_array_i64_new(203, 0);
+        memcpy(copy.data, wide.data, 203 * sizeof(int64_t));
+        pf_scale_i64(copy, -2);
+        bool scaled = true;
+        for (int i = 0; i < 203; i++) {
+            if (copy.data[i] != wide.data[i] * -2) scaled = false;
+        }
+        ASSERT_TRUE(scaled, "scale multiplies every element");
+
+        pf_array_bool below = pf_mask_lt_i64(wide, 0, 0);
+        pf_array_bool equal = pf_mask_eq_i64(wide, 0, 0);
+        int below_count = 0;
+        for (int i = 0; i < 203; i++) below_count += below.data[i];
+        ASSERT_EQUAL_INT(100, below_count, "mask_lt marks elements below the value");
+        ASSERT_TRUE(equal.data[100] && !equal.data[99] && !equal.data[101], "mask_eq marks the equal element");
+    }
+
+    print_test_results(&stats);
+}
+
+// Test float builtins; values are small integers so every order of addition
+// gives the same total
+void test_numeric_float_kernels() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Numeric Float Kernels ===\n");
+
+    pf_array_f32 xs = pf_array_f32_new(77, 0);
+    pf_array_f64 ys = pf_array_f64_new(77, 0);
+    for (int i = 0; i < 77; i++) {
+        xs.data[i] = (float)(i % 9) - 4.0f;
+        ys.data[i] = (double)i * 0.5;
+    }
+
+    for (int k = 0; k < 3; k++) {
+        if (!pf_numeric_use_kernels(kernel_sets[k])) continue;
+        printf("Using %s kernels\n", pf_numeric_kernels());
+
+        ASSERT_TRUE(pf_sum_f32(xs) == -10.0f, "f32 sum");
+        ASSERT_TRUE(pf_dot_f64(ys, ys, 0) == 37306.5, "f64 dot");
+        ASSERT_TRUE(pf_min_f32(xs, 0) == -4.0f && pf_max_f32(xs, 0) == 4.0f, "f32 extremes");
+        ASSERT_TRUE(pf_max_f64(ys, 0) == 38.0, "f64 max in the tail");
+
+        pf_array_bool mask = pf_mask_gt_f64(ys, 30.0, 0);
+        ASSERT_TRUE(!mask.data[60] && mask.data[61] && mask.data[76], "mask_gt compares doubles");
+    }
+
+    print_test_results(&stats);
+}
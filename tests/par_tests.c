@@ -0,0 +1,152 @@
+#include "../include/test_framework.h"
+#include "../include/runtime/pf_par.h"
+#include "../include/runtime/pf_task.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct {
+    _Atomic int* visits;
+    int64_t spin_ns;            // Busy time per iteration
+} VisitContext;
+
+static void spin(int64_t nanoseconds) {
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000 + (now.tv_nsec - start.tv_nsec) < nanoseconds);
+}
+
+static void visit(void* argument, int64_t first, int64_t last) {
+    VisitContext* context = argument;
+    for (int64_t i = first; i < last; i++) {
+        if (context->spin_ns > 0) spin(context->spin_ns);
+        atomic_fetch_add_explicit(&context->visits[i], 1, memory_order_relaxed);
+    }
+}
+
+// Whether every one of count visits happened exactly once
+static bool visited_once(_Atomic int* visits, int64_t count) {
+    for (int64_t i = 0; i < count; i++) {
+        if (atomic_load(&visits[i]) != 1) return false;
+    }
+    return true;
+}
+
+static _Atomic int64_t nested_total;
+
+static void add_indices(void* argument, int64_t first, int64_t last) {
+    (void)argument;
+    for (int64_t i = first; i < last; i++) {
+        atomic_fetch_add_explicit(&nested_total, i, memory_order_relaxed);
+    }
+}
+
+static void inner_loops(void* argument, int64_t first, int64_t last) {
+    (void)argument;
+    for (int64_t i = first; i < last; i++) {
+        pf_parallel_for(1000, add_indices, NULL);
+    }
+}
+
+static void nested_from_task(void* argument) {
+    (void)argument;
+    pf_parallel_for(20, inner_loops, NULL);
+}
+
+// Test that every iteration runs once, across chunks on helper tasks, that
+// the grain follows the cost of an iteration, and that loops nest on tasks
+void test_par_loops() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Parallel Loops ===\n");
+
+    setenv("PFLANG_TASK_THREADS", "4", 0);
+    int64_t count = 2000000;
+    _Atomic int* visits = calloc((size_t)count, sizeof(_Atomic int));
+    VisitContext cheap = {visits, 0};
+    pf_par_statistics before;
+    pf_par_get_statistics(&before);
+    pf_parallel_for(count, visit, &cheap);
+    ASSERT_TRUE(visited_once(visits, count), "A long loop runs every iteration exactly once");
+    pf_par_statistics after;
+    pf_par_get_statistics(&after);
+    ASSERT_TRUE(after.helpers > before.helpers, "and hands chunks to helper tasks");
+    ASSERT_TRUE(after.chunks - before.chunks >= 2, "in several chunks");
+    int64_t cheap_grain = after.last_grain;
+
+    VisitContext costly = {calloc(4000, sizeof(_Atomic int)), 2000};
+    pf_parallel_for(4000, visit, &costly);
+    ASSERT_TRUE(visited_once(costly.visits, 4000), "A loop of slow iterations runs each once too");
+    pf_par_get_statistics(&after);
+    ASSERT_TRUE(after.last_grain < cheap_grain, "and gets smaller chunks than a loop of quick ones");
+
+    VisitContext few = {calloc(3, sizeof(_Atomic int)), 0};
+    pf_par_get_statistics(&before);
+    pf_parallel_for(3, visit, &few);
+    pf_parallel_for(0, visit, &few);
+    pf_par_get_statistics(&after);
+    ASSERT_TRUE(visited_once(few.visits, 3), "A short loop runs its iterations");
+    ASSERT_EQUAL_INT(2, (int)(after.sequential - before.sequential), "on the caller alone, as does an empty one");
+
+    atomic_store(&nested_total, 0);
+    pf_task_spawn(nested_from_task, NULL, 0);
+    pf_task_wait();
+    ASSERT_TRUE(atomic_load(&nested_total) == (int64_t)20 * 999 * 1000 / 2,
+                "Loops started from a task and from inside other loops finish");
+
+    free(visits);
+    free(costly.visits);
+    free(few.visits);
+    print_test_results(&stats);
+}
+
+// The iterations a partial result covers, and whether they came in order
+typedef struct {
+    int64_t first;
+    int64_t last;
+    int64_t total;
+    bool in_order;
+} Span;
+
+static void sum_span(void* argument, int64_t first, int64_t last, void* partial) {
+    (void)argument;
+    Span* span = partial;
+    *span = (Span){first, last, 0, true};
+    for (int64_t i = first; i < last; i++) {
+        span->total += i;
+    }
+}
+
+static void join_spans(void* argument, void* into, const void* from) {
+    (void)argument;
+    Span* left = into;
+    const Span* right = from;
+    left->in_order = left->in_order && right->in_order && left->last == right->first;
+    left->last = right->last;
+    left->total += right->total;
+}
+
+// Test that reductions combine every chunk's partial result once, in the
+// order of the iterations, and leave the result alone for no iterations
+void test_par_reductions() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Parallel Reductions ===\n");
+
+    Span span = {-1, -1, 0, false};
+    pf_parallel_reduce(3000000, sum_span, join_spans, NULL, &span, sizeof(span));
+    ASSERT_TRUE(span.first == 0 && span.last == 3000000, "A reduction covers every iteration");
+    ASSERT_TRUE(span.in_order, "and combines its partial results in order");
+    ASSERT_TRUE(span.total == (int64_t)2999999 * 3000000 / 2, "each once");
+
+    Span empty = {-1, -1, 7, false};
+    pf_parallel_reduce(0, sum_span, join_spans, NULL, &empty, sizeof(empty));
+    ASSERT_EQUAL_INT(7, (int)empty.total, "A reduction over nothing leaves the result as it was");
+
+    print_test_results(&stats);
+}
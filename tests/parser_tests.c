@@ -48,7 +48,7 @@ void test_parser_error_handling() {
 }
 
 AstNode* mock_parse(Parser* parser) {
-    return create_literal_node("42", TYPE_I32);
+    return create_literal_node(strdup("42"), TYPE_I32);
 }
 
 void test_basic_parsing() {
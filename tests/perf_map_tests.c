@@ -0,0 +1,97 @@
+#include "../include/test_framework.h"
+#include "../include/perf_map.h"
+#include "../include/parser.h"
+#include "../include/utils.h"
+#include <stdint.h>
+#include <unistd.h>
+
+// Test perf map line format
+void test_perf_map_entries() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Perf Map Entries ===\n");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/pflang-perf-test-%d.map", (int)getpid());
+    remove(path);
+
+    PerfMap map;
+    ASSERT_TRUE(perf_map_open_path(&map, path), "Perf map opens");
+    perf_map_write_entry(&map, (const void*)(uintptr_t)0x1000, 0x20, "pf:main (main.pf:1)");
+    perf_map_write_entry(&map, (const void*)(uintptr_t)0x2000, 0x8, "pf:div (main.pf:4)");
+    perf_map_close(&map);
+
+    char* contents = read_file(path);
+    ASSERT_TRUE(contents != NULL, "Perf map was written");
+    if (contents != NULL) {
+        ASSERT_EQUAL_STRING("1000 20 pf:main (main.pf:1)\n2000 8 pf:div (main.pf:4)\n",
+                            contents, "Perf map has one START SIZE name line per entry");
+        free(contents);
+    }
+    remove(path);
+
+    print_test_results(&stats);
+}
+
+// Test jitdump header and code load record
+void test_jitdump_records() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Jitdump Records ===\n");
+
+    static const unsigned char code[] = {0xC3};
+    JitDump dump;
+    ASSERT_TRUE(jitdump_open(&dump, "/tmp"), "Jitdump opens");
+    jitdump_write_code_load(&dump, code, sizeof(code), "pf:main", "main.pf", 3);
+    jitdump_close(&dump);
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/jit-%d.dump", (int)getpid());
+    FILE* file = fopen(path, "rb");
+    ASSERT_TRUE(file != NULL, "Jitdump was written");
+    if (file != NULL) {
+        uint32_t header[4];
+        ASSERT_EQUAL_INT(4, (int)fread(header, sizeof(uint32_t), 4, file), "Jitdump header is readable");
+        ASSERT_TRUE(header[0] == 0x4A695444, "Jitdump header has magic");
+        ASSERT_EQUAL_INT(40, (int)header[2], "Jitdump header size");
+
+        // Header, debug info record (16 + 16 + 16 + 8 bytes), code load record (16 + 40 + 8 + 1 bytes)
+        fseek(file, 0, SEEK_END);
+        ASSERT_EQUAL_INT(40 + 56 + 65, (int)ftell(file), "Jitdump holds debug info and code load records");
+        fclose(file);
+    }
+    remove(path);
+
+    print_test_results(&stats);
+}
+
+// Test symbol names built from function nodes
+void test_perf_symbol_name() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Perf Symbol Names ===\n");
+
+    const char* source = "\nf div(a: int, b: int) -> (int, error):\n    return (a / b, null)";
+    Lexer lexer;
+    init_lexer(&lexer, source);
+
+    Parser parser;
+    init_parser(&parser, &lexer);
+
+    AstNode* ast = parse(&parser);
+    ASSERT_TRUE(ast != NULL, "Function parses");
+    if (ast != NULL) {
+        ASSERT_EQUAL_INT(2, ast->line, "Function node records its source line");
+
+        char name[128];
+        perf_symbol_name(name, sizeof(name), ast, "div.pf");
+        ASSERT_EQUAL_STRING("pf:div (div.pf:2)", name, "Symbol name includes file and line");
+
+        free_ast(ast);
+    }
+
+    print_test_results(&stats);
+}
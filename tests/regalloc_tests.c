@@ -0,0 +1,165 @@
+#include "../include/test_framework.h"
+#include "../include/regalloc.h"
+#include "../include/parser.h"
+
+static IrModule* lower_optimized(const char* source) {
+    Lexer lexer;
+    init_lexer(&lexer, source);
+
+    Parser parser;
+    init_parser(&parser, &lexer);
+
+    AstNode* program = parse_program(&parser);
+    if (program == NULL) return NULL;
+
+    IrModule* module = ir_lower_program(program);
+    free_ast(program);
+    if (module != NULL) {
+        ir_optimize_module(module);
+    }
+    return module;
+}
+
+static bool overlaps(LiveInterval* a, LiveInterval* b) {
+    // An interval ending where another starts hands its register over
+    return a->start < b->end && b->start < a->end;
+}
+
+// No two overlapping intervals may share a register or a spill slot
+static bool allocation_is_consistent(RegAllocation* allocation) {
+    for (int i = 0; i < allocation->interval_count; i++) {
+        LiveInterval* a = &allocation->intervals[i];
+        if ((a->reg < 0) == (a->spill_slot < 0)) return false;
+        if (a->reg >= 0 && allocation->target->registers[a->reg].reg_class != a->reg_class) return false;
+        for (int j = i + 1; j < allocation->interval_count; j++) {
+            LiveInterval* b = &allocation->intervals[j];
+            if (!overlaps(a, b)) continue;
+            if (a->reg >= 0 && a->reg == b->reg) return false;
+            if (a->spill_slot >= 0 && a->spill_slot == b->spill_slot) return false;
+        }
+    }
+    return true;
+}
+
+// Test allocation of a loop with values live across a call
+void test_regalloc_loop_across_call() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Register Allocation Across Calls ===\n");
+
+    const char* source =
+        "f fib(n: int) -> null:\n"
+        "    int a = 0\n"
+        "    int b = 1\n"
+        "    while a < n:\n"
+        "        print(a)\n"
+        "        int next = a + b\n"
+        "        a = b\n"
+        "        b = next\n"
+        "    return null\n";
+    IrModule* module = lower_optimized(source);
+    ASSERT_TRUE(module != NULL, "Program lowers to IR");
+    if (module != NULL) {
+        const RegAllocTarget* target = regalloc_target_x86_64();
+        RegAllocation* allocation = regalloc_function(module->functions[0], target);
+        regalloc_dump(allocation, true, stdout);
+
+        ASSERT_TRUE(allocation_is_consistent(allocation), "Overlapping intervals get distinct locations");
+        ASSERT_EQUAL_INT(0, allocation->spill_count, "Small loop needs no spills");
+
+        bool callee_saved_across_calls = true;
+        int crossing = 0;
+        for (int i = 0; i < allocation->interval_count; i++) {
+            LiveInterval* interval = &allocation->intervals[i];
+            if (!interval->crosses_call) continue;
+            crossing++;
+            if (!target->registers[interval->reg].callee_saved) callee_saved_across_calls = false;
+        }
+        ASSERT_TRUE(crossing >= 3, "n, a and b live across print");
+        ASSERT_TRUE(callee_saved_across_calls, "Values live across a call use callee-saved registers");
+
+        regalloc_free(allocation);
+        ir_free_module(module);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test spilling and spill slot reuse when registers run out
+void test_regalloc_spills() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Register Allocation Spills ===\n");
+
+    RegAllocTarget tiny = {"tiny", {{"r0", REG_CLASS_INT, false}, {"r1", REG_CLASS_INT, false}}, 2};
+
+    const char* source =
+        "f crowded(x: int) -> int:\n"
+        "    int a = x * 3\n"
+        "    int b = x * 5\n"
+        "    int c = x * 7\n"
+        "    int d = a + b\n"
+        "    int e = d + c\n"
+        "    int p = x * 11\n"
+        "    int q = x * 13\n"
+        "    int r = p + q\n"
+        "    return e + r\n";
+    IrModule* module = lower_optimized(source);
+    ASSERT_TRUE(module != NULL, "Program lowers to IR");
+    if (module != NULL) {
+        RegAllocation* allocation = regalloc_function(module->functions[0], &tiny);
+        regalloc_dump(allocation, true, stdout);
+
+        ASSERT_TRUE(allocation_is_consistent(allocation), "Overlapping intervals get distinct locations");
+        ASSERT_TRUE(allocation->spill_count > 0, "Two registers are not enough");
+        ASSERT_TRUE(allocation->spill_slot_count < allocation->spill_count, "Spill slots are reused");
+        ASSERT_EQUAL_INT(0, allocation->loop_spill_count, "No loop, so no spills in loops");
+
+        regalloc_free(allocation);
+        ir_free_module(module);
+    }
+
+    print_test_results(&stats);
+}
+
+// Test that floats use the SSE class and spill across calls
+void test_regalloc_register_classes() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Register Classes ===\n");
+
+    const char* source =
+        "f scale(x: f64, n: int) -> f64:\n"
+        "    f64 y = x * 2.5\n"
+        "    print(n)\n"
+        "    return y\n";
+    IrModule* module = lower_optimized(source);
+    ASSERT_TRUE(module != NULL, "Program lowers to IR");
+    if (module != NULL) {
+        IrFunction* function = module->functions[0];
+        RegAllocation* allocation = regalloc_function(function, regalloc_target_x86_64());
+        regalloc_dump(allocation, true, stdout);
+
+        ASSERT_TRUE(allocation_is_consistent(allocation), "Overlapping intervals get distinct locations");
+
+        LiveInterval* x = NULL;
+        LiveInterval* y = NULL;
+        for (int i = 0; i < allocation->interval_count; i++) {
+            IrInstr* value = allocation->intervals[i].value;
+            if (value->op == IR_PARAM && value->index == 0) x = &allocation->intervals[i];
+            if (value->op == IR_MUL) y = &allocation->intervals[i];
+        }
+        ASSERT_TRUE(x != NULL && x->reg_class == REG_CLASS_SSE, "f64 parameter is in the SSE class");
+        ASSERT_TRUE(x != NULL && x->reg >= 0 && !x->crosses_call, "Parameter dead before the call stays in xmm");
+        ASSERT_TRUE(y != NULL && y->crosses_call && y->reg < 0, "f64 live across a call spills");
+        ASSERT_EQUAL_INT(1, allocation->spill_count, "Only the float across the call spills");
+
+        regalloc_free(allocation);
+        ir_free_module(module);
+    }
+
+    print_test_results(&stats);
+}
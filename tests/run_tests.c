@@ -23,6 +23,95 @@ extern void test_function_with_simple_number_return();
 extern void test_function_with_string_return();
 extern void test_function_with_variable_declarations();
 
+// Perf map test functions
+extern void test_perf_map_entries();
+extern void test_jitdump_records();
+extern void test_perf_symbol_name();
+
+// C backend test functions
+extern void test_codegen_c_tuple_return();
+extern void test_codegen_c_executable();
+extern void test_codegen_c_overflow_modes();
+extern void test_codegen_c_error_results();
+extern void test_codegen_c_compiled_formats();
+extern void test_codegen_c_buffered_output();
+extern void test_codegen_c_strings();
+extern void test_codegen_c_string_builtins();
+extern void test_codegen_c_maps();
+extern void test_codegen_c_arrays();
+extern void test_codegen_c_numeric_builtins();
+extern void test_codegen_c_for_range();
+extern void test_codegen_c_bounds_checks();
+extern void test_codegen_c_vector_loops();
+extern void test_codegen_c_call_profile();
+extern void test_codegen_c_perf_map();
+extern void test_codegen_c_tail_calls();
+extern void test_codegen_c_allocations();
+extern void test_codegen_c_garbage_collection();
+extern void test_codegen_c_tasks();
+extern void test_codegen_c_channels();
+extern void test_codegen_c_parallel_loops();
+extern void test_codegen_c_async_io();
+
+// IR test functions
+extern void test_ir_ssa_construction();
+extern void test_ir_value_numbering();
+extern void test_ir_loop_invariant_code_motion();
+extern void test_ir_folding_and_dead_code();
+extern void test_ir_overflow_modes();
+extern void test_ir_arrays();
+extern void test_ir_for_range();
+extern void test_ir_bounds_checks();
+extern void test_ir_vector_loops();
+extern void test_ir_inline();
+extern void test_ir_tail_calls();
+extern void test_ir_escape();
+
+// String runtime test functions
+extern void test_string_small_storage();
+extern void test_string_interning_and_slices();
+extern void test_string_library();
+
+// Map runtime test functions
+extern void test_map_int_keys();
+extern void test_map_churn_without_tombstones();
+extern void test_map_str_keys();
+extern void test_map_str_keys_collected();
+
+// Numeric runtime test functions
+extern void test_numeric_integer_kernels();
+extern void test_numeric_float_kernels();
+
+// Garbage collector test functions
+extern void test_gc_collections();
+extern void test_gc_remembered_set();
+extern void test_gc_parallel_marking();
+
+// Green thread test functions
+extern void test_task_spawn();
+extern void test_task_stealing();
+extern void test_task_collections();
+
+// Channel test functions
+extern void test_chan_basics();
+extern void test_chan_tasks();
+extern void test_chan_ownership();
+extern void test_chan_select();
+
+// Parallel loop test functions
+extern void test_par_loops();
+extern void test_par_reductions();
+
+// I/O test functions
+extern void test_io_pipes();
+extern void test_io_files();
+extern void test_io_sockets();
+
+// Register allocation test functions
+extern void test_regalloc_loop_across_call();
+extern void test_regalloc_spills();
+extern void test_regalloc_register_classes();
+
 int main() {
     printf("==============================\n");
     printf("Running all pflang tests\n");
@@ -62,6 +151,131 @@ int main() {
     test_basic_parsing();
     test_variable_declaration();
 
+    // Run perf map tests
+    printf("\n==============================\n");
+    printf("PERF MAP TESTS\n");
+    printf("==============================\n");
+    test_perf_map_entries();
+    test_jitdump_records();
+    test_perf_symbol_name();
+
+    // Run C backend tests
+    printf("\n==============================\n");
+    printf("C BACKEND TESTS\n");
+    printf("==============================\n");
+    test_codegen_c_tuple_return();
+    test_codegen_c_executable();
+    test_codegen_c_overflow_modes();
+    test_codegen_c_error_results();
+    test_codegen_c_compiled_formats();
+    test_codegen_c_buffered_output();
+    test_codegen_c_strings();
+    test_codegen_c_string_builtins();
+    test_codegen_c_maps();
+    test_codegen_c_arrays();
+    test_codegen_c_numeric_builtins();
+    test_codegen_c_for_range();
+    test_codegen_c_bounds_checks();
+    test_codegen_c_vector_loops();
+    test_codegen_c_call_profile();
+    test_codegen_c_perf_map();
+    test_codegen_c_tail_calls();
+    test_codegen_c_allocations();
+    test_codegen_c_garbage_collection();
+    test_codegen_c_tasks();
+    test_codegen_c_channels();
+    test_codegen_c_parallel_loops();
+    test_codegen_c_async_io();
+
+    // Run IR tests
+    printf("\n==============================\n");
+    printf("IR TESTS\n");
+    printf("==============================\n");
+    test_ir_ssa_construction();
+    test_ir_value_numbering();
+    test_ir_loop_invariant_code_motion();
+    test_ir_folding_and_dead_code();
+    test_ir_overflow_modes();
+    test_ir_arrays();
+    test_ir_for_range();
+    test_ir_bounds_checks();
+    test_ir_vector_loops();
+    test_ir_inline();
+    test_ir_tail_calls();
+    test_ir_escape();
+
+    // Run register allocation tests
+    printf("\n==============================\n");
+    printf("REGISTER ALLOCATION TESTS\n");
+    printf("==============================\n");
+    test_regalloc_loop_across_call();
+    test_regalloc_spills();
+    test_regalloc_register_classes();
+
+    // Run string runtime tests
+    printf("\n==============================\n");
+    printf("STRING RUNTIME TESTS\n");
+    printf("==============================\n");
+    test_string_small_storage();
+    test_string_interning_and_slices();
+    test_string_library();
+
+    // Run map runtime tests
+    printf("\n==============================\n");
+    printf("MAP RUNTIME TESTS\n");
+    printf("==============================\n");
+    test_map_int_keys();
+    test_map_churn_without_tombstones();
+    test_map_str_keys();
+    test_map_str_keys_collected();
+
+    // Run numeric runtime tests
+    printf("\n==============================\n");
+    printf("NUMERIC RUNTIME TESTS\n");
+    printf("==============================\n");
+    test_numeric_integer_kernels();
+    test_numeric_float_kernels();
+
+    // Run garbage collector tests
+    printf("\n==============================\n");
+    printf("GARBAGE COLLECTOR TESTS\n");
+    printf("==============================\n");
+    test_gc_collections();
+    test_gc_remembered_set();
+    test_gc_parallel_marking();
+
+    // Run green thread tests
+    printf("\n==============================\n");
+    printf("GREEN THREAD TESTS\n");
+    printf("==============================\n");
+    test_task_spawn();
+    test_task_stealing();
+    test_task_collections();
+
+    // Run channel tests
+    printf("\n==============================\n");
+    printf("CHANNEL TESTS\n");
+    printf("==============================\n");
+    test_chan_basics();
+    test_chan_tasks();
+    test_chan_ownership();
+    test_chan_select();
+
+    // Run parallel loop tests
+    printf("\n==============================\n");
+    printf("PARALLEL LOOP TESTS\n");
+    printf("==============================\n");
+    test_par_loops();
+    test_par_reductions();
+
+    // Run I/O tests
+    printf("\n==============================\n");
+    printf("I/O TESTS\n");
+    printf("==============================\n");
+    test_io_pipes();
+    test_io_files();
+    test_io_sockets();
+
     printf("\n==============================\n");
     printf("All tests completed\n");
     printf("==============================\n");
@@ -0,0 +1,150 @@
+#include "../include/test_framework.h"
+#include "../include/runtime/pf_string.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static bool has_text(pf_string string, const char* text) {
+    return string.length == strlen(text) && memcmp(pf_string_data(&string), text, string.length) == 0;
+}
+
+// Test inline storage of short strings and heap storage of long ones
+void test_string_small_storage() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Small String Storage ===\n");
+
+    pf_string key = pf_string_from_cstr("user:1234");
+    ASSERT_TRUE(pf_string_is_inline(&key), "Short string is stored inline");
+    ASSERT_TRUE(has_text(key, "user:1234"), "Inline string keeps its bytes");
+
+    pf_string edge = pf_string_from_cstr("0123456789abcdef");
+    ASSERT_TRUE(pf_string_is_inline(&edge), "Sixteen bytes still fit inline");
+
+    const char* text = "a message body that does not fit inline";
+    pf_string body = pf_string_from_cstr(text);
+    ASSERT_FALSE(pf_string_is_inline(&body), "Long string lives on the heap");
+    ASSERT_TRUE(pf_string_data(&body) != text, "Long string is copied");
+    ASSERT_TRUE(has_text(body, text), "Heap string keeps its bytes");
+
+    ASSERT_TRUE(pf_string_equal(key, pf_string_from("user:1234", 9)), "Equal inline strings compare equal");
+    ASSERT_FALSE(pf_string_equal(key, pf_string_from_cstr("user:1235")), "Different strings differ");
+    ASSERT_TRUE(pf_string_equal(body, pf_string_from_cstr(text)), "Equal heap strings compare equal");
+    ASSERT_TRUE(pf_string_equal(PF_STRING_EMPTY, pf_string_from("", 0)), "Empty strings compare equal");
+
+    uint32_t hash = pf_string_hash(&body);
+    ASSERT_TRUE(hash != 0 && body.hash == hash, "Hash is cached in the string");
+    pf_string other = pf_string_from_cstr(text);
+    ASSERT_EQUAL_INT((int)hash, (int)pf_string_hash(&other), "Equal strings hash alike");
+
+    print_test_results(&stats);
+}
+
+// Test that interned literals share one buffer and slices share their parent
+void test_string_interning_and_slices() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing String Interning And Slices ===\n");
+
+    static const char first[] = "GET /index.html HTTP/1.1";
+    static const char second[] = "GET /index.html HTTP/1.1";
+    pf_string a = PF_STRING_LITERAL(first);
+    pf_string b = PF_STRING_LITERAL(second);
+    ASSERT_TRUE(pf_string_data(&a) == first, "Literal is used in place");
+    ASSERT_TRUE(pf_string_data(&b) == first, "Identical literals share one buffer");
+    ASSERT_TRUE(a.hash != 0, "Interned literal has its hash precomputed");
+
+    pf_string method = PF_STRING_LITERAL("GET");
+    ASSERT_TRUE(pf_string_is_inline(&method) && method.hash != 0, "Short literal is inline with its hash");
+
+    pf_string path = pf_string_slice(a, 4, 15);
+    ASSERT_TRUE(pf_string_is_inline(&path), "Short slice is copied inline");
+    ASSERT_TRUE(has_text(path, "/index.html"), "Slice has the selected bytes");
+
+    pf_string tail = pf_string_slice(a, 4, 100);
+    ASSERT_FALSE(pf_string_is_inline(&tail), "Long slice is not copied");
+    ASSERT_TRUE(pf_string_data(&tail) == first + 4, "Long slice points into its parent");
+    ASSERT_TRUE(has_text(tail, "/index.html HTTP/1.1"), "Slice end is clamped to the length");
+    ASSERT_EQUAL_INT(0, (int)pf_string_slice(a, 30, 40).length, "Slice past the end is empty");
+
+    char* text = pf_string_to_cstr(tail);
+    ASSERT_EQUAL_STRING("/index.html HTTP/1.1", text, "C string copy is terminated");
+    free(text);
+
+    print_test_results(&stats);
+}
+
+static int64_t naive_find(const char* haystack, const char* needle) {
+    const char* found = strstr(haystack, needle);
+    return found != NULL ? found - haystack : -1;
+}
+
+// Test the string library under every kernel set the CPU supports
+void test_string_library() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing String Library ===\n");
+
+    // Long enough that matches land inside vectors, across them and in the tail
+    char text[301];
+    for (int i = 0; i < 300; i++) {
+        text[i] = (char)('a' + (i * 7) % 26);
+    }
+    text[300] = '\0';
+    memcpy(text + 31, "needle", 6);
+    memcpy(text + 290, "needle", 6);
+    pf_string haystack = pf_string_from_cstr(text);
+
+    const char* kernel_sets[] = {"scalar", "sse2", "avx2"};
+    for (int k = 0; k < 3; k++) {
+        if (!pf_string_use_kernels(kernel_sets[k])) {
+            printf("Skipping %s kernels: not supported by this CPU\n", kernel_sets[k]);
+            continue;
+        }
+        printf("Using %s kernels\n", pf_string_kernels());
+
+        bool finds_match = true;
+        for (int start = 0; start < 290; start += 13) {
+            for (int length = 1; length <= 40 && start + length <= 300; length += 3) {
+                char needle[64];
+                memcpy(needle, text + start, (size_t)length);
+                needle[length] = '\0';
+                pf_string found = pf_string_from_cstr(needle);
+                if (pf_string_find(haystack, found) != naive_find(text, needle)) finds_match = false;
+            }
+        }
+        ASSERT_TRUE(finds_match, "find agrees with strstr at every offset and length");
+        ASSERT_EQUAL_INT(-1, (int)pf_string_find(haystack, pf_string_from_cstr("needles!")), "Missing needle");
+        ASSERT_EQUAL_INT(2, (int)pf_string_count(haystack, pf_string_from_cstr("needle")), "Needle counted twice");
+
+        pf_string upper = pf_string_to_upper(haystack);
+        ASSERT_TRUE(pf_string_find(upper, pf_string_from_cstr("NEEDLE")) == 31, "to_upper converts every block");
+        ASSERT_TRUE(pf_string_equal(pf_string_to_lower(upper), haystack), "to_lower undoes to_upper");
+        ASSERT_TRUE(pf_string_equal(pf_string_to_upper(pf_string_from_cstr("a-z@[`{")),
+                                    pf_string_from_cstr("A-Z@[`{")), "Only letters change case");
+
+        char mixed[200];
+        memset(mixed, 'x', sizeof(mixed));
+        memcpy(mixed + 70, "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80", 9);
+        ASSERT_TRUE(pf_string_is_utf8(pf_string_from(mixed, sizeof(mixed))), "Multibyte text is valid UTF-8");
+        mixed[71] = 'x';
+        ASSERT_FALSE(pf_string_is_utf8(pf_string_from(mixed, sizeof(mixed))), "Truncated sequence is invalid");
+        ASSERT_FALSE(pf_string_is_utf8(pf_string_from_cstr("\xC0\xAF")), "Overlong form is invalid");
+        ASSERT_FALSE(pf_string_is_utf8(pf_string_from_cstr("\xED\xA0\x80")), "Surrogate is invalid");
+    }
+
+    pf_string parts[4];
+    pf_string line = pf_string_from_cstr("GET /a/b HTTP/1.1");
+    ASSERT_EQUAL_INT(3, (int)pf_string_split(line, pf_string_from_cstr(" "), parts, 4), "Split into three");
+    ASSERT_TRUE(has_text(parts[1], "/a/b"), "Middle part is a slice");
+    ASSERT_EQUAL_INT(4, (int)pf_string_split(pf_string_from_cstr("a,,b,"), pf_string_from_cstr(","), parts, 4),
+                     "Empty parts are kept");
+    ASSERT_TRUE(pf_string_starts_with(line, pf_string_from_cstr("GET ")), "starts_with");
+    ASSERT_TRUE(pf_string_ends_with(line, pf_string_from_cstr("1.1")), "ends_with");
+    ASSERT_TRUE(pf_string_compare(pf_string_from_cstr("abc"), pf_string_from_cstr("abd")) < 0, "compare orders bytes");
+    ASSERT_TRUE(pf_string_compare(pf_string_from_cstr("ab"), pf_string_from_cstr("abc")) < 0, "Prefix sorts first");
+
+    print_test_results(&stats);
+}
@@ -0,0 +1,150 @@
+#include "../include/test_framework.h"
+#include "../include/runtime/pf_array.h"
+#include "../include/runtime/pf_gc.h"
+#include "../include/runtime/pf_task.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static _Atomic int64_t task_total;
+
+typedef struct {
+    int64_t value;
+    int yields;
+} CountArguments;
+
+static void count_task(void* argument) {
+    CountArguments* arguments = argument;
+    for (int i = 0; i < arguments->yields; i++) {
+        pf_task_yield();
+    }
+    atomic_fetch_add(&task_total, arguments->value);
+}
+
+typedef struct {
+    uint64_t* results;
+    int64_t index;
+} BuildArguments;
+
+static pf_string numbered(int64_t i) {
+    char text[64];
+    int length = snprintf(text, sizeof(text), "task string number %lld", (long long)i);
+    return pf_string_from(text, (size_t)length);
+}
+
+// Fill a list of strings, switching out halfway, and publish it in slot
+// index of results, which keeps it alive
+static void build_task(void* argument) {
+    BuildArguments* arguments = argument;
+    pf_list_str* list = pf_list_str_new(0, 0);
+    for (int64_t i = 0; i < 200; i++) {
+        pf_list_str_append(list, numbered(arguments->index * 1000 + i));
+        if (i == 100) pf_task_yield();
+    }
+    arguments->results[arguments->index] = (uint64_t)(uintptr_t)list;
+}
+
+// Test that tens of thousands of tasks run to completion, spawned both
+// from outside the pool and from tasks, while they switch out
+void test_task_spawn() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Task Spawn ===\n");
+
+    // Several workers even on one core, so stealing is exercised
+    setenv("PFLANG_TASK_THREADS", "4", 0);
+
+    atomic_store(&task_total, 0);
+    for (int64_t i = 1; i <= 20000; i++) {
+        CountArguments arguments = {i, (int)(i % 3)};
+        pf_task_spawn(count_task, &arguments, sizeof(arguments));
+    }
+    pf_task_wait();
+    ASSERT_EQUAL_INT(200010000, (int)atomic_load(&task_total), "Every task ran once with its own arguments");
+
+    pf_task_statistics statistics;
+    pf_task_get_statistics(&statistics);
+    ASSERT_TRUE(statistics.workers >= 1, "Workers are started by the first spawn");
+    ASSERT_TRUE(statistics.spawned >= 20000 && statistics.finished == statistics.spawned,
+                "Every spawned task finished");
+    ASSERT_TRUE(statistics.switches > statistics.spawned, "Yielding tasks are switched in more than once");
+    ASSERT_FALSE(pf_task_in_task(), "The test itself is not a task");
+
+    print_test_results(&stats);
+}
+
+static void spawn_more(void* argument) {
+    int64_t count = *(int64_t*)argument;
+    for (int64_t i = 0; i < count; i++) {
+        CountArguments arguments = {1, 1};
+        pf_task_spawn(count_task, &arguments, sizeof(arguments));
+    }
+}
+
+// Test that tasks spawned by tasks land in their worker's deque and are
+// shared out by stealing
+void test_task_stealing() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Task Stealing ===\n");
+
+    atomic_store(&task_total, 0);
+    pf_task_statistics before;
+    pf_task_get_statistics(&before);
+    for (int i = 0; i < 10; i++) {
+        int64_t count = 1000;
+        pf_task_spawn(spawn_more, &count, sizeof(count));
+    }
+    pf_task_wait();
+    pf_task_statistics after;
+    pf_task_get_statistics(&after);
+    ASSERT_EQUAL_INT(10000, (int)atomic_load(&task_total), "Tasks spawned by tasks all run");
+    ASSERT_EQUAL_INT(10010, (int)(after.spawned - before.spawned), "They are counted as spawned");
+    if (after.workers > 1) {
+        ASSERT_TRUE(after.stolen > before.stolen, "Idle workers steal from busy ones");
+    }
+
+    print_test_results(&stats);
+}
+
+// Test that the collector stops every worker and finds references held
+// only on the stacks of tasks, running or switched out
+void test_task_collections() {
+    TestStats stats;
+    init_test_stats(&stats);
+
+    printf("\n=== Testing Task Collections ===\n");
+
+    // The lists are reached only through these addresses, registered as roots
+    pf_array_u64 results = pf_array_u64_new(500, 0);
+    pf_gc_add_roots(results.data, 500 * sizeof(uint64_t));
+    pf_gc_statistics before;
+    pf_gc_get_statistics(&before);
+    for (int64_t t = 0; t < 500; t++) {
+        BuildArguments arguments = {results.data, t};
+        pf_task_spawn(build_task, &arguments, sizeof(arguments));
+    }
+    pf_task_wait();
+    pf_gc_statistics after;
+    pf_gc_get_statistics(&after);
+    ASSERT_TRUE(after.minor_collections > before.minor_collections, "Tasks allocating trigger collections");
+    pf_gc_collect(false);
+
+    bool intact = true;
+    for (int64_t t = 0; t < 500 && intact; t++) {
+        pf_list_str* list = (pf_list_str*)(uintptr_t)results.data[t];
+        if (list == NULL || list->length != 200) {
+            intact = false;
+            break;
+        }
+        for (int64_t i = 0; i < 200; i++) {
+            if (!pf_string_equal(list->data[i], numbered(t * 1000 + i))) intact = false;
+        }
+    }
+    ASSERT_TRUE(intact, "Strings built by tasks survive collections run by any thread");
+    pf_gc_remove_roots(results.data);
+
+    print_test_results(&stats);
+}